@@ -56,7 +56,7 @@ struct acc *search_accounting_structure(struct primitives_ptrs *prim_ptrs)
   // if (pvlen) hash ^= cache_crc32((unsigned char *)pvlen, (PvhdrSz + pvlen->tot_len));
   pos = hash % config.buckets;
 
-  Log(LOG_DEBUG, "DEBUG ( %s/%s ): Selecting bucket %u.\n", config.name, config.type, pos);
+  if (config.debug || debug) Log(LOG_DEBUG, "DEBUG ( %s/%s ): Selecting bucket %u.\n", config.name, config.type, pos);
 
   elem_acc = (struct acc *) a;
   elem_acc += pos;  
@@ -174,7 +174,7 @@ void insert_accounting_structure(struct primitives_ptrs *prim_ptrs)
   // if (pvlen) hash ^= cache_crc32((unsigned char *)pvlen, (PvhdrSz + pvlen->tot_len));
   pos = hash % config.buckets;
       
-  Log(LOG_DEBUG, "DEBUG ( %s/%s ): Selecting bucket %u.\n", config.name, config.type, pos);
+  if (config.debug || debug) Log(LOG_DEBUG, "DEBUG ( %s/%s ): Selecting bucket %u.\n", config.name, config.type, pos);
   /* 
      1st stage: compare data with last used element;
      2nd stage: compare data with elements in the table, following chains
@@ -194,6 +194,7 @@ void insert_accounting_structure(struct primitives_ptrs *prim_ptrs)
           elem_acc->bytes_counter += data->cst.ba;
           elem_acc->flow_counter += data->cst.fa;
         }
+        imt_history_account(elem_acc, data, FALSE);
         return;
       }
     }
@@ -216,12 +217,15 @@ void insert_accounting_structure(struct primitives_ptrs *prim_ptrs)
 	  elem_acc->bytes_counter += data->cst.ba;
           elem_acc->flow_counter += data->cst.fa;
 	}
+        imt_history_account(elem_acc, data, FALSE);
         lru_elem_ptr[config.buckets] = elem_acc;
         return;
       }
     }
     if (!elem_acc->bytes_counter && !elem_acc->packet_counter) { /* hmmm */
+      if (!elem_acc->signature) imt_entries++; /* bucket head never used before */
       if (elem_acc->reset_flag) elem_acc->reset_flag = FALSE; 
+      if (elem_acc->imask) imt_index_del(elem_acc);
       memcpy(&elem_acc->primitives, addr, sizeof(struct pkt_primitives));
 
       if (pbgp) {
@@ -325,13 +329,15 @@ void insert_accounting_structure(struct primitives_ptrs *prim_ptrs)
         elem_acc->bytes_counter += data->cst.ba;
         elem_acc->flow_counter += data->cst.fa;
       }
+      imt_history_account(elem_acc, data, TRUE);
+      imt_index_add(elem_acc);
       lru_elem_ptr[config.buckets] = elem_acc;
       return;
     }
 
     /* Handling collisions */
     else if (elem_acc->next != NULL) {
-      Log(LOG_DEBUG, "DEBUG ( %s/%s ): Walking through the collision-chain.\n", config.name, config.type);
+      if (config.debug || debug) Log(LOG_DEBUG, "DEBUG ( %s/%s ): Walking through the collision-chain.\n", config.name, config.type);
       elem_acc = elem_acc->next;
       solved = FALSE;
     }
@@ -341,7 +347,7 @@ void insert_accounting_structure(struct primitives_ptrs *prim_ptrs)
       if (no_more_space) return;
 
       /* We have to allocate new space for this address */
-      Log(LOG_DEBUG, "DEBUG ( %s/%s ): Creating new element.\n", config.name, config.type);
+      if (config.debug || debug) Log(LOG_DEBUG, "DEBUG ( %s/%s ): Creating new element.\n", config.name, config.type);
 
       if (current_pool->space_left >= sizeof(struct acc)) {
         new_elem = current_pool->ptr;
@@ -364,6 +370,7 @@ void insert_accounting_structure(struct primitives_ptrs *prim_ptrs)
 
       elem_acc->next = (struct acc *) new_elem;
       elem_acc = (struct acc *) new_elem;
+      imt_entries++;
       memcpy(&elem_acc->primitives, addr, sizeof(struct pkt_primitives));
 
       if (pbgp) {
@@ -445,6 +452,8 @@ void insert_accounting_structure(struct primitives_ptrs *prim_ptrs)
         elem_acc->flow_counter += data->cst.fa;
       }
       elem_acc->next = NULL;
+      imt_history_account(elem_acc, data, FALSE);
+      imt_index_add(elem_acc);
       lru_elem_ptr[config.buckets] = elem_acc;
       return;
     }
@@ -465,3 +474,133 @@ void reset_counters(struct acc *elem)
   elem->flow_type = 0;
   memcpy(&elem->rstamp, &cycle_stamp, sizeof(struct timeval));
 }
+
+void imt_history_rotate(time_t now)
+{
+  time_t epoch, step;
+  size_t off;
+
+  if (!hist.bins) return;
+
+  epoch = now/hist.bin_time;
+  if (epoch <= hist.epoch) return;
+
+  /* clearing the bins we are stepping into; after an idle spell longer
+     than the whole ring, this boils down to clearing all of them. Slots
+     past next_slot are never written to, hence always zero */
+  for (step = MAX(hist.epoch+1, epoch-hist.bins+1); step <= epoch; step++) {
+    off = (size_t) (step % hist.bins)*hist.slots;
+    memset(&hist.bytes[off], 0, hist.next_slot*sizeof(pm_counter_t));
+    memset(&hist.packets[off], 0, hist.next_slot*sizeof(pm_counter_t));
+    memset(&hist.flows[off], 0, hist.next_slot*sizeof(pm_counter_t));
+  }
+
+  hist.epoch = epoch;
+}
+
+void imt_history_account(struct acc *elem, struct pkt_data *data, int reused)
+{
+  struct acc *heads = (struct acc *) a;
+  u_int32_t slot, bin;
+  size_t idx;
+
+  if (!hist.bins) return;
+
+  /* element is being recycled for a new set of primitives: history
+     left behind by the previous owner has to go */
+  if (reused && elem->hslot) {
+    for (bin = 0, idx = elem->hslot-1; bin < hist.bins; bin++, idx += hist.slots) {
+      hist.bytes[idx] = 0;
+      hist.packets[idx] = 0;
+      hist.flows[idx] = 0;
+    }
+  }
+
+  if (!elem->hslot) {
+    if (elem >= heads && elem < (heads+config.buckets)) slot = (elem-heads);
+    else if (hist.next_slot < hist.slots) slot = hist.next_slot++;
+    else return;
+
+    elem->hslot = slot+1;
+  }
+
+  idx = (size_t) (hist.epoch % hist.bins)*hist.slots+(elem->hslot-1);
+  hist.bytes[idx] += data->pkt_len;
+  hist.packets[idx] += data->pkt_num;
+  hist.flows[idx] += data->flo_num;
+  if (config.what_to_count & COUNT_CLASS) {
+    hist.bytes[idx] += data->cst.ba;
+    hist.packets[idx] += data->cst.pa;
+    hist.flows[idx] += data->cst.fa;
+  }
+}
+
+static unsigned int imt_index_hash(int ix, struct pkt_primitives *prim)
+{
+  switch (ix) {
+  case IMT_INDEX_SRC_HOST:
+    return (cache_crc32((unsigned char *) &prim->src_ip, sizeof(struct host_addr)) % config.buckets);
+  case IMT_INDEX_DST_HOST:
+    return (cache_crc32((unsigned char *) &prim->dst_ip, sizeof(struct host_addr)) % config.buckets);
+  case IMT_INDEX_SRC_AS:
+    return (prim->src_as % config.buckets);
+  case IMT_INDEX_DST_AS:
+    return (prim->dst_as % config.buckets);
+  }
+
+  return 0;
+}
+
+void imt_index_add(struct acc *elem)
+{
+  unsigned int pos;
+  int ix;
+
+  for (ix = 0; ix < IMT_INDEX_MAX; ix++) {
+    if (!imt_index[ix]) continue;
+
+    pos = imt_index_hash(ix, &elem->primitives);
+    elem->inext[ix] = imt_index[ix][pos];
+    imt_index[ix][pos] = elem;
+    elem->imask |= (1 << ix);
+  }
+}
+
+/* to be called before the primitives of the element get overwritten */
+void imt_index_del(struct acc *elem)
+{
+  struct acc **ptr;
+  unsigned int pos;
+  int ix;
+
+  for (ix = 0; ix < IMT_INDEX_MAX; ix++) {
+    if (!(elem->imask & (1 << ix)) || !imt_index[ix]) continue;
+
+    pos = imt_index_hash(ix, &elem->primitives);
+    for (ptr = &imt_index[ix][pos]; *ptr && *ptr != elem; ptr = &(*ptr)->inext[ix]);
+    if (*ptr) *ptr = elem->inext[ix];
+    elem->inext[ix] = NULL;
+  }
+
+  elem->imask = 0;
+}
+
+/* returns the index able to serve the request, ERR if none */
+int imt_index_select(struct query_entry *request)
+{
+  if ((request->what_to_count & COUNT_SRC_HOST) && imt_index[IMT_INDEX_SRC_HOST]) return IMT_INDEX_SRC_HOST;
+  if ((request->what_to_count & COUNT_DST_HOST) && imt_index[IMT_INDEX_DST_HOST]) return IMT_INDEX_DST_HOST;
+  if ((request->what_to_count & COUNT_SRC_AS) && imt_index[IMT_INDEX_SRC_AS]) return IMT_INDEX_SRC_AS;
+  if ((request->what_to_count & COUNT_DST_AS) && imt_index[IMT_INDEX_DST_AS]) return IMT_INDEX_DST_AS;
+
+  return ERR;
+}
+
+/* returns the head of the chain candidates have to be looked for into;
+   elements are linked via inext[ix] and may carry different keys */
+struct acc *imt_index_lookup(int ix, struct pkt_primitives *prim)
+{
+  if (ix < 0 || ix >= IMT_INDEX_MAX || !imt_index[ix]) return NULL;
+
+  return imt_index[ix][imt_index_hash(ix, prim)];
+}
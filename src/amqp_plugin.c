@@ -98,6 +98,9 @@ void amqp_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
       close_output_file(avro_fp);
     }
 
+    if (!config.avro_buffer_size) config.avro_buffer_size = LARGEBUFLEN;
+    p_avro_encoder_init(&avro_acct_enc, avro_acct_schema, config.avro_buffer_size, config.avro_container);
+
     if (config.amqp_avro_schema_routing_key) {
       if (!config.amqp_avro_schema_refresh_time)
         config.amqp_avro_schema_refresh_time = DEFAULT_AVRO_SCHEMA_REFRESH_TIME;
@@ -271,6 +274,7 @@ void amqp_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
         pollagain = FALSE;
         memcpy(pipebuf, rg->ptr, bufsz);
         rg->ptr += bufsz;
+        stats_shm_update_ring_rd(((struct ch_buf_hdr *) pipebuf)->seq);
       }
       else {
         ret = p_amqp_consume_binary(amqp_host, pipebuf, config.buffer_size);
@@ -344,13 +348,13 @@ void amqp_cache_purge(struct chained_cache *queue[], int index)
   time_t start, duration;
   pid_t writer_pid = getpid();
 
-#ifdef WITH_JANSSON
-  json_t *array = json_array();
-#endif
+  struct p_json_batch json_batch;
+  char *json_msg;
+  size_t json_msg_len;
 
 #ifdef WITH_AVRO
-  avro_writer_t avro_writer;
-  char *avro_buf = NULL;
+  char *avro_msg;
+  size_t avro_msg_len;
   int avro_buffer_full = FALSE;
 #endif
 
@@ -381,7 +385,10 @@ void amqp_cache_purge(struct chained_cache *queue[], int index)
   p_amqp_set_persistent_msg(&amqpp_amqp_host, config.amqp_persistent_msg);
   p_amqp_set_frame_max(&amqpp_amqp_host, config.amqp_frame_max);
 
-  if (config.message_broker_output & PRINT_OUTPUT_JSON) p_amqp_set_content_type_json(&amqpp_amqp_host);
+  if (config.message_broker_output & PRINT_OUTPUT_JSON) {
+    if (config.sql_multi_values && config.message_broker_mv_compress) p_amqp_set_content_type_binary(&amqpp_amqp_host);
+    else p_amqp_set_content_type_json(&amqpp_amqp_host);
+  }
   else if (config.message_broker_output & PRINT_OUTPUT_AVRO) p_amqp_set_content_type_binary(&amqpp_amqp_host);
   else {
     Log(LOG_ERR, "ERROR ( %s/%s ): Unsupported amqp_output value specified. Exiting.\n", config.name, config.type);
@@ -429,19 +436,13 @@ void amqp_cache_purge(struct chained_cache *queue[], int index)
     }
   }
 
-#ifdef WITH_AVRO
-  if (config.message_broker_output & PRINT_OUTPUT_AVRO) {
-    if (!config.avro_buffer_size) config.avro_buffer_size = LARGEBUFLEN;
+  memset(&json_batch, 0, sizeof(json_batch));
+  if ((config.message_broker_output & PRINT_OUTPUT_JSON) && config.sql_multi_values)
+    P_json_batch_init(&json_batch, config.message_broker_mv_format, config.sql_multi_values,
+		      config.message_broker_mv_bytes, config.message_broker_mv_compress);
 
-    avro_buf = malloc(config.avro_buffer_size);
-
-    if (!avro_buf) {
-      Log(LOG_ERR, "ERROR ( %s/%s ): malloc() failed (avro_buf). Exiting ..\n", config.name, config.type);
-      exit_plugin(1);
-    }
-
-    avro_writer = avro_writer_memory(avro_buf, config.avro_buffer_size);
-  }
+#ifdef WITH_AVRO
+  if (config.message_broker_output & PRINT_OUTPUT_AVRO) p_avro_encoder_reset(&avro_acct_enc);
 #endif
 
   for (j = 0; j < index; j++) {
@@ -479,66 +480,58 @@ void amqp_cache_purge(struct chained_cache *queue[], int index)
     }
     else if (config.message_broker_output & PRINT_OUTPUT_AVRO) {
 #ifdef WITH_AVRO
-      avro_value_iface_t *avro_iface = avro_generic_class_from_schema(avro_acct_schema);
-      avro_value_t avro_value = compose_avro(config.what_to_count, config.what_to_count_2, queue[j]->flow_type,
+      avro_value_t *avro_value = p_avro_encoder_value(&avro_acct_enc);
+
+      compose_avro_value(config.what_to_count, config.what_to_count_2, queue[j]->flow_type,
                            &queue[j]->primitives, pbgp, pnat, pmpls, pcust, pvlen, queue[j]->bytes_counter,
                            queue[j]->packet_counter, queue[j]->flow_counter, queue[j]->tcp_flags,
-                           &queue[j]->basetime, queue[j]->stitch, avro_iface);
-      size_t avro_value_size;
+                           &queue[j]->basetime, queue[j]->stitch, avro_value);
 
-      avro_value_sizeof(&avro_value, &avro_value_size);
-
-      if (avro_value_size > config.avro_buffer_size) {
-        Log(LOG_ERR, "ERROR ( %s/%s ): AVRO; insufficient buffer size (avro_buffer_size=%u)\n",
-            config.name, config.type, config.avro_buffer_size);
-        Log(LOG_ERR, "ERROR ( %s/%s ): AVRO: increase value or look for avro_buffer_size in CONFIG-KEYS document.\n\n",
-            config.name, config.type);
-        exit_plugin(1);
-      }
-      else if (avro_value_size >= (config.avro_buffer_size - avro_writer_tell(avro_writer))) {
-        avro_buffer_full = TRUE;
-        j--;
-      }
-      else if (avro_value_write(avro_writer, &avro_value)) {
-        Log(LOG_ERR, "ERROR ( %s/%s ): ARVO: unable to write value: %s\n", config.name, config.type, avro_strerror());
+      if (p_avro_encoder_append(&avro_acct_enc)) {
+        Log(LOG_ERR, "ERROR ( %s/%s ): AVRO: unable to write value: %s\n", config.name, config.type, avro_strerror());
         exit_plugin(1);
       }
       else {
         mv_num++;
       }
 
-      avro_value_decref(&avro_value);
-      avro_value_iface_decref(avro_iface);
+      if (p_avro_encoder_len(&avro_acct_enc) >= config.avro_buffer_size) avro_buffer_full = TRUE;
 #else
       if (config.debug) Log(LOG_DEBUG, "DEBUG ( %s/%s ): compose_avro(): AVRO object not created due to missing --enable-avro\n", config.name, config.type);
 #endif
     }
 
     if (config.message_broker_output & PRINT_OUTPUT_JSON) {
-#ifdef WITH_JANSSON
       if (json_str && config.sql_multi_values) {
-        json_t *elem = NULL;
-        char *tmp_str = json_str;
-        int do_free = FALSE;
-
-        if (json_array_size(array) >= config.sql_multi_values) {
-	  json_str = json_dumps(array, JSON_PRESERVE_ORDER);
-          json_array_clear(array);
-          mv_num_save = mv_num;
-          mv_num = 0;
-        }
-        else do_free = TRUE;
+        size_t json_len = strlen(json_str);
 
-        elem = json_loads(tmp_str, 0, NULL);
-        json_array_append_new(array, elem);
-        mv_num++;
+        if (P_json_batch_is_full(&json_batch, json_len)) {
+          if (config.amqp_routing_key_rr) {
+            P_handle_table_dyn_rr(dyn_amqp_routing_key, SRVBUFLEN, orig_amqp_routing_key, &amqpp_amqp_host.rk_rr);
+            p_amqp_set_routing_key(&amqpp_amqp_host, dyn_amqp_routing_key);
+          }
+
+          json_msg = P_json_batch_finish(&json_batch, &json_msg_len);
+          if (json_msg) {
+            if (!json_batch.compress) Log(LOG_DEBUG, "DEBUG ( %s/%s ): %s\n\n", config.name, config.type, json_msg);
+            ret = p_amqp_publish_binary(&amqpp_amqp_host, json_msg, json_msg_len);
+          }
+          else ret = ERR;
+
+          mv_num_save = json_batch.records;
+          P_json_batch_reset(&json_batch);
 
-        if (do_free) {
-          free(json_str);
-          json_str = NULL;
+          if (!ret) qn += mv_num_save;
+          else {
+            free(json_str);
+            break;
+          }
         }
+
+        P_json_batch_append(&json_batch, json_str, json_len);
+        free(json_str);
+        json_str = NULL;
       }
-#endif
 
       if (json_str) {
         if (is_routing_key_dyn) {
@@ -556,10 +549,7 @@ void amqp_cache_purge(struct chained_cache *queue[], int index)
         free(json_str);
         json_str = NULL;
 
-        if (!ret) {
-          if (!config.sql_multi_values) qn++;
-          else qn += mv_num_save;
-        }
+        if (!ret) qn++;
         else break;
       }
     }
@@ -576,8 +566,9 @@ void amqp_cache_purge(struct chained_cache *queue[], int index)
           p_amqp_set_routing_key(&amqpp_amqp_host, dyn_amqp_routing_key);
         }
 
-        ret = p_amqp_publish_binary(&amqpp_amqp_host, avro_buf, avro_writer_tell(avro_writer));
-        avro_writer_reset(avro_writer);
+        avro_msg = p_avro_encoder_finish(&avro_acct_enc, &avro_msg_len);
+        ret = p_amqp_publish_binary(&amqpp_amqp_host, avro_msg, avro_msg_len);
+        p_avro_encoder_reset(&avro_acct_enc);
         avro_buffer_full = FALSE;
         mv_num_save = mv_num;
         mv_num = 0;
@@ -591,31 +582,25 @@ void amqp_cache_purge(struct chained_cache *queue[], int index)
 
   if (config.sql_multi_values) {
     if (config.message_broker_output & PRINT_OUTPUT_JSON) {
-#ifdef WITH_JANSSON
-      if (json_array_size(array)) {
-        char *json_str;
-
-        json_str = json_dumps(array, JSON_PRESERVE_ORDER);
-        json_array_clear(array);
-        json_decref(array);
-
-        if (json_str) {
-          /* no handling of dyn routing keys here: not compatible */
-          Log(LOG_DEBUG, "DEBUG ( %s/%s ): %s\n\n", config.name, config.type, json_str);
-          ret = p_amqp_publish_string(&amqpp_amqp_host, json_str);
-          free(json_str);
-          json_str = NULL;
-
-          if (!ret) qn += mv_num;
-	}
+      if (json_batch.records) {
+        /* no handling of dyn routing keys here: not compatible */
+        json_msg = P_json_batch_finish(&json_batch, &json_msg_len);
+        if (json_msg) {
+          if (!json_batch.compress) Log(LOG_DEBUG, "DEBUG ( %s/%s ): %s\n\n", config.name, config.type, json_msg);
+          ret = p_amqp_publish_binary(&amqpp_amqp_host, json_msg, json_msg_len);
+
+          if (!ret) qn += json_batch.records;
+        }
       }
-#endif
+
+      P_json_batch_free(&json_batch);
     }
     else if (config.message_broker_output & PRINT_OUTPUT_AVRO) {
 #ifdef WITH_AVRO
-      if (avro_writer_tell(avro_writer)) {
-        ret = p_amqp_publish_binary(&amqpp_amqp_host, avro_buf, avro_writer_tell(avro_writer));
-        avro_writer_free(avro_writer);
+      if (p_avro_encoder_len(&avro_acct_enc)) {
+        avro_msg = p_avro_encoder_finish(&avro_acct_enc, &avro_msg_len);
+        ret = p_amqp_publish_binary(&amqpp_amqp_host, avro_msg, avro_msg_len);
+        p_avro_encoder_reset(&avro_acct_enc);
 
         if (!ret) qn += mv_num;
       }
@@ -651,10 +636,6 @@ void amqp_cache_purge(struct chained_cache *queue[], int index)
   if (config.sql_trigger_exec) P_trigger_exec(config.sql_trigger_exec); 
 
   if (empty_pcust) free(empty_pcust);
-
-#ifdef WITH_AVRO
-  if (avro_buf) free(avro_buf);
-#endif
 }
 
 #ifdef WITH_AVRO
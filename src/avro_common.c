@@ -0,0 +1,244 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2017 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#define __AVRO_COMMON_C
+
+/* includes */
+#include "pmacct.h"
+#include "pmacct-data.h"
+
+/* Functions */
+static void p_avro_encoder_build_hdr(struct p_avro_encoder *enc)
+{
+  avro_writer_t schema_writer;
+  char *schema_buf = NULL, *ptr;
+  size_t schema_buf_len = LARGEBUFLEN, schema_len;
+  int idx, ret;
+
+  /* the schema is serialized as JSON in the file header metadata */
+  for (;;) {
+    schema_buf = realloc(schema_buf, schema_buf_len);
+    if (!schema_buf) {
+      Log(LOG_ERR, "ERROR ( %s/%s ): AVRO: realloc() failed (schema_buf). Exiting ..\n", config.name, config.type);
+      exit_plugin(1);
+    }
+
+    schema_writer = avro_writer_memory(schema_buf, schema_buf_len);
+    ret = avro_schema_to_json(enc->schema, schema_writer);
+    schema_len = avro_writer_tell(schema_writer);
+    avro_writer_free(schema_writer);
+
+    if (!ret) break;
+    else if (ret != ENOSPC) {
+      Log(LOG_ERR, "ERROR ( %s/%s ): AVRO: unable to dump schema: %s\n", config.name, config.type, avro_strerror());
+      exit_plugin(1);
+    }
+
+    schema_buf_len *= 2;
+  }
+
+  for (idx = 0; idx < PM_AVRO_SYNC_LEN; idx++) enc->sync[idx] = (char) (random() & 0xFF);
+
+  enc->hdr = malloc(PM_AVRO_MAGIC_LEN + (6 * PM_AVRO_LONG_LEN) + strlen("avro.schema") + schema_len +
+		    strlen("avro.codec") + strlen("null") + PM_AVRO_SYNC_LEN);
+  if (!enc->hdr) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): AVRO: malloc() failed (hdr). Exiting ..\n", config.name, config.type);
+    exit_plugin(1);
+  }
+
+  ptr = enc->hdr;
+  memcpy(ptr, PM_AVRO_MAGIC, PM_AVRO_MAGIC_LEN);
+  ptr += PM_AVRO_MAGIC_LEN;
+
+  /* metadata map: a single block of two entries, then the end-of-map marker */
+  ptr += p_avro_encode_long(ptr, 2);
+  ptr += p_avro_encode_bytes(ptr, "avro.schema", strlen("avro.schema"));
+  ptr += p_avro_encode_bytes(ptr, schema_buf, schema_len);
+  ptr += p_avro_encode_bytes(ptr, "avro.codec", strlen("avro.codec"));
+  ptr += p_avro_encode_bytes(ptr, "null", strlen("null"));
+  ptr += p_avro_encode_long(ptr, 0);
+
+  memcpy(ptr, enc->sync, PM_AVRO_SYNC_LEN);
+  ptr += PM_AVRO_SYNC_LEN;
+
+  enc->hdr_len = (ptr - enc->hdr);
+
+  free(schema_buf);
+}
+
+static void p_avro_encoder_grow(struct p_avro_encoder *enc)
+{
+  char *new_buf;
+  size_t new_buf_len = (enc->buf_len * 2);
+
+  new_buf = realloc(enc->buf, new_buf_len);
+  if (!new_buf) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): AVRO: realloc() failed (buf, %zu bytes). Exiting ..\n", config.name, config.type, new_buf_len);
+    exit_plugin(1);
+  }
+
+  enc->buf = new_buf;
+  enc->buf_len = new_buf_len;
+}
+
+void p_avro_encoder_init(struct p_avro_encoder *enc, avro_schema_t schema, size_t buf_len, int container)
+{
+  if (!enc || !schema) return;
+
+  memset(enc, 0, sizeof(struct p_avro_encoder));
+
+  enc->schema = avro_schema_incref(schema);
+  enc->iface = avro_generic_class_from_schema(schema);
+  if (!enc->iface) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): AVRO: unable to build value interface: %s\n", config.name, config.type, avro_strerror());
+    exit_plugin(1);
+  }
+
+  if (avro_generic_value_new(enc->iface, &enc->value)) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): AVRO: unable to build value: %s\n", config.name, config.type, avro_strerror());
+    exit_plugin(1);
+  }
+
+  enc->container = container;
+  if (enc->container) {
+    p_avro_encoder_build_hdr(enc);
+    enc->data_off = (enc->hdr_len + PM_AVRO_BLOCK_HDR_LEN);
+  }
+
+  enc->buf_len = (enc->data_off + MAX(buf_len, LARGEBUFLEN) + PM_AVRO_SYNC_LEN);
+  enc->buf = malloc(enc->buf_len);
+  if (!enc->buf) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): AVRO: malloc() failed (buf). Exiting ..\n", config.name, config.type);
+    exit_plugin(1);
+  }
+
+  enc->writer = avro_writer_memory(enc->buf, enc->buf_len);
+  enc->off = enc->data_off;
+}
+
+avro_value_t *p_avro_encoder_value(struct p_avro_encoder *enc)
+{
+  avro_value_reset(&enc->value);
+
+  return &enc->value;
+}
+
+/* serializes the current value after the records already in the buffer */
+int p_avro_encoder_append(struct p_avro_encoder *enc)
+{
+  int ret;
+
+  for (;;) {
+    avro_writer_memory_set_dest(enc->writer, (enc->buf + enc->off), (enc->buf_len - enc->off - PM_AVRO_SYNC_LEN));
+    ret = avro_value_write(enc->writer, &enc->value);
+
+    if (!ret) break;
+    else if (ret == ENOSPC) p_avro_encoder_grow(enc);
+    else return ret;
+  }
+
+  enc->off += avro_writer_tell(enc->writer);
+  enc->records++;
+
+  return SUCCESS;
+}
+
+size_t p_avro_encoder_len(struct p_avro_encoder *enc)
+{
+  return (enc->off - enc->data_off);
+}
+
+/*
+   returns a pointer to the message ready to be sent out: either the bare
+   sequence of records or, if the object container format is selected, the
+   file header followed by a single data block.
+*/
+char *p_avro_encoder_finish(struct p_avro_encoder *enc, size_t *len)
+{
+  char block_hdr[PM_AVRO_BLOCK_HDR_LEN], *ptr;
+  int block_hdr_len;
+
+  if (!enc->container) {
+    (*len) = p_avro_encoder_len(enc);
+    return (enc->buf + enc->data_off);
+  }
+
+  block_hdr_len = p_avro_encode_long(block_hdr, enc->records);
+  block_hdr_len += p_avro_encode_long((block_hdr + block_hdr_len), p_avro_encoder_len(enc));
+
+  ptr = (enc->buf + enc->data_off - block_hdr_len);
+  memcpy(ptr, block_hdr, block_hdr_len);
+
+  ptr -= enc->hdr_len;
+  memcpy(ptr, enc->hdr, enc->hdr_len);
+
+  memcpy((enc->buf + enc->off), enc->sync, PM_AVRO_SYNC_LEN);
+
+  (*len) = ((enc->buf + enc->off + PM_AVRO_SYNC_LEN) - ptr);
+
+  return ptr;
+}
+
+void p_avro_encoder_reset(struct p_avro_encoder *enc)
+{
+  enc->off = enc->data_off;
+  enc->records = 0;
+}
+
+void p_avro_encoder_destroy(struct p_avro_encoder *enc)
+{
+  if (!enc || !enc->iface) return;
+
+  avro_value_decref(&enc->value);
+  avro_value_iface_decref(enc->iface);
+  avro_schema_decref(enc->schema);
+  avro_writer_free(enc->writer);
+
+  if (enc->buf) free(enc->buf);
+  if (enc->hdr) free(enc->hdr);
+
+  memset(enc, 0, sizeof(struct p_avro_encoder));
+}
+
+int p_avro_encode_long(char *dst, int64_t value)
+{
+  u_int64_t n = (((u_int64_t) value << 1) ^ (value >> 63));
+  int len = 0;
+
+  while (n & ~0x7FULL) {
+    dst[len++] = (char) ((n & 0x7F) | 0x80);
+    n >>= 7;
+  }
+
+  dst[len++] = (char) n;
+
+  return len;
+}
+
+int p_avro_encode_bytes(char *dst, char *src, int src_len)
+{
+  int len;
+
+  len = p_avro_encode_long(dst, src_len);
+  memcpy((dst + len), src, src_len);
+
+  return (len + src_len);
+}
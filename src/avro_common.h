@@ -0,0 +1,72 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2017 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+/* defines */
+#define PM_AVRO_MAGIC		"Obj\x01"
+#define PM_AVRO_MAGIC_LEN	4
+#define PM_AVRO_SYNC_LEN	16
+#define PM_AVRO_LONG_LEN	10 /* max zig-zag varint encoded long */
+#define PM_AVRO_BLOCK_HDR_LEN	(2 * PM_AVRO_LONG_LEN)
+
+/* structures */
+/*
+   Encoder state shared by all the records serialized with the same schema:
+   the value interface and the generic value are built once and the value is
+   reset for each record. Records are serialized straight into a buffer which
+   is grown on demand; when the object container format is selected, room for
+   the file header and the block header is reserved at the head of the buffer
+   so that a message can be finalized without moving records around.
+*/
+struct p_avro_encoder {
+  avro_schema_t schema;
+  avro_value_iface_t *iface;
+  avro_value_t value;
+  avro_writer_t writer;
+
+  char *buf;
+  size_t buf_len;
+  size_t data_off;
+  size_t off;
+  u_int32_t records;
+
+  int container;
+  char *hdr;
+  size_t hdr_len;
+  char sync[PM_AVRO_SYNC_LEN];
+};
+
+/* prototypes */
+#if (!defined __AVRO_COMMON_C)
+#define EXT extern
+#else
+#define EXT
+#endif
+EXT void p_avro_encoder_init(struct p_avro_encoder *, avro_schema_t, size_t, int);
+EXT avro_value_t *p_avro_encoder_value(struct p_avro_encoder *);
+EXT int p_avro_encoder_append(struct p_avro_encoder *);
+EXT size_t p_avro_encoder_len(struct p_avro_encoder *);
+EXT char *p_avro_encoder_finish(struct p_avro_encoder *, size_t *);
+EXT void p_avro_encoder_reset(struct p_avro_encoder *);
+EXT void p_avro_encoder_destroy(struct p_avro_encoder *);
+
+EXT int p_avro_encode_long(char *, int64_t);
+EXT int p_avro_encode_bytes(char *, char *, int);
+#undef EXT
@@ -77,7 +77,7 @@ void skinny_bgp_daemon_online()
 #endif
   afi_t afi;
   safi_t safi;
-  int clen = sizeof(client), yes=1, no=0;
+  int clen = sizeof(client), yes=1, no=0, peer_status;
   time_t now, dump_refresh_deadline;
   struct hosts_table allow;
   struct bgp_md5_table bgp_md5;
@@ -351,16 +351,26 @@ void skinny_bgp_daemon_online()
     select_again:
 
     if (recalc_fds) { 
+      u_int32_t peers_num = 0, peers_established = 0;
+
       select_fd = config.bgp_sock;
       max_peers_idx = -1; /* .. since valid indexes include 0 */
 
       for (peers_idx = 0; peers_idx < config.nfacctd_bgp_max_peers; peers_idx++) {
         if (select_fd < peers[peers_idx].fd) select_fd = peers[peers_idx].fd; 
-	if (peers[peers_idx].fd) max_peers_idx = peers_idx;
+	if (peers[peers_idx].fd) {
+	  max_peers_idx = peers_idx;
+	  peers_num++;
+	  if (peers[peers_idx].status == Established) peers_established++;
+	}
       }
       select_fd++;
       max_peers_idx++;
 
+      /* peers counters are published along, for stats_shm_update() to read */
+      bgp_peers_num = peers_num;
+      bgp_peers_established = peers_established;
+
       bkp_select_fd = select_fd;
       recalc_fds = FALSE;
     }
@@ -602,6 +612,7 @@ void skinny_bgp_daemon_online()
 	peer->last_keepalive = now;
       } 
 
+      peer_status = peer->status;
       ret = bgp_parse_msg(peer, now, TRUE);
       if (ret < 0) {
         FD_CLR(peer->fd, &bkp_read_descs);
@@ -609,6 +620,9 @@ void skinny_bgp_daemon_online()
         recalc_fds = TRUE;
         goto select_again;
       }
+
+      /* peers counters need to be published again */
+      if (peer->status != peer_status) recalc_fds = TRUE;
     }
   }
 }
@@ -71,6 +71,15 @@
 #define BGP_ATTR_FLAG_PARTIAL   0x20    /* Attribute is partial. */
 #define BGP_ATTR_FLAG_EXTLEN    0x10    /* Extended length flag. */
 
+/* BGP attribute memo: strings owned by the memo */
+#define BGP_ATTR_MEMO_AS_PATH	0x01
+#define BGP_ATTR_MEMO_STD_COMMS	0x02
+#define BGP_ATTR_MEMO_EXT_COMMS	0x04
+#define BGP_ATTR_MEMO_LRG_COMMS	0x08
+
+/* bgp_update_msg: prefixes list, initial allocation */
+#define BGP_NLRI_PREFIXES_ALLOC	32
+
 /* BGP misc */
 #define MAX_BGP_PEERS_DEFAULT 4
 #define MAX_HOPS_FOLLOW_NH 20
@@ -185,7 +194,7 @@ struct bgp_peer {
   struct bgp_peer_log *log;
 
   /*
-     bmp_peer.self.bmp_se:		pointer to struct bmp_dump_se_ll
+     bmp_peer.self.bmp_se:		pointer to struct bmp_dump_se_store
      bmp_peer.bgp_peers[n].bmp_se:	backpointer to parent struct bmp_peer
   */
   void *bmp_se;
@@ -213,6 +222,23 @@ struct bgp_nlri {
   u_int16_t length;
 };
 
+/* values derived from an interned attribute for the packet handlers:
+   computed when the attribute is interned, released along with it */
+struct bgp_attr_memo {
+  as_t first_asn;			/* first ASN of the AS_PATH */
+  as_t comm_origin_asn;			/* bgp_stdcomm_pattern_to_asn: origin ASN */
+  as_t comm_peer_asn;			/* bgp_stdcomm_pattern_to_asn: peer ASN */
+  char *as_path;			/* bgp_aspath_radius applied */
+  char *std_comms;			/* bgp_stdcomm_pattern applied */
+  char *ext_comms;			/* bgp_extcomm_pattern applied */
+  char *lrg_comms;			/* bgp_lrgcomm_pattern applied */
+  int as_path_len;			/* lengths include the trailing null; 0 if empty */
+  int std_comms_len;
+  int ext_comms_len;
+  int lrg_comms_len;
+  u_int8_t alloc;			/* BGP_ATTR_MEMO_*: strings owned by the memo */
+};
+
 struct bgp_attr {
   struct aspath *aspath;
   struct community *community;
@@ -229,6 +255,34 @@ struct bgp_attr {
     u_char ttl;
   } pathlimit;
   u_char origin;
+  struct bgp_attr_memo *memo;
+};
+
+/* prefix decoded off an NLRI section of an UPDATE message */
+struct bgp_nlri_prefix {
+  struct prefix p;
+  rd_t rd;
+  path_id_t path_id;
+  u_char label[3];
+  afi_t afi;
+  safi_t safi;
+  u_int8_t withdraw;
+};
+
+/* UPDATE message as decoded by bgp_update_msg_decode(): attributes and
+   prefixes are private to the message until bgp_update_msg_process() */
+struct bgp_update_msg {
+  u_int16_t len;		/* whole message, BGP header included */
+  char *withdraw;
+  u_int16_t withdraw_len;
+  char *attr;
+  u_int16_t attr_len;
+  char *update;
+  u_int16_t update_len;
+  struct bgp_attr pattr;	/* parsed attributes, not interned */
+  struct bgp_nlri_prefix *prefixes;
+  int num_prefixes;
+  int max_prefixes;
 };
 
 struct bgp_comm_range {
@@ -264,6 +318,7 @@ EXT int bgp_offline_read_json(char *, char *, int, void **);
 #define EXT
 #endif
 EXT struct bgp_peer *peers;
+EXT u_int32_t bgp_peers_num, bgp_peers_established;	/* published by the BGP thread */
 EXT void *offline_peers;
 EXT char *std_comm_patterns[MAX_BGP_COMM_PATTERNS];
 EXT char *ext_comm_patterns[MAX_BGP_COMM_PATTERNS];
@@ -787,20 +787,15 @@ assegments_parse(char *s, size_t length, int use32bit)
   return assegment_normalise (head);
 }
 
-/* AS path parse function. If there is same AS path in the the AS
-   path hash then return it else make new AS path structure. */
+/* AS path parse function. Returns a new AS path structure, string
+   included, which is not interned yet: this touches no shared structure
+   and aspath_intern() is left to the caller. */
 struct aspath *aspath_parse(struct bgp_peer *peer, char *s, size_t length, int use32bit)
 {
-  struct bgp_rt_structs *inter_domain_routing_db;
-  struct aspath as;
-  struct aspath *find;
+  struct aspath *as;
 
   if (!peer) return NULL;
 
-  inter_domain_routing_db = bgp_select_routing_db(peer->type);
-
-  if (!inter_domain_routing_db) return NULL;
-
   /* If length is odd it's malformed AS path. */
   /* Nit-picking: if (use32bit == 0) it is malformed if odd,
    * otherwise its malformed when length is larger than 2 and (length-2) 
@@ -809,24 +804,13 @@ struct aspath *aspath_parse(struct bgp_peer *peer, char *s, size_t length, int u
    */
   if (length % AS16_VALUE_SIZE ) return NULL;
 
-  memset (&as, 0, sizeof (struct aspath));
-  as.segments = assegments_parse(s, length, use32bit);
-  
-  /* If already same aspath exist then return it. */
-  find = hash_get (peer, inter_domain_routing_db->ashash, &as, aspath_hash_alloc);
-  
-  /* aspath_hash_alloc dupes segments too. that probably could be
-   * optimised out.
-   */
-  assegment_free_all (as.segments);
-  if (as.str)
-    free(as.str);
-  
-  if (! find)
-    return NULL;
-  find->refcnt++;
+  as = aspath_new(peer);
+  if (!as) return NULL;
 
-  return find;
+  as->segments = assegments_parse(s, length, use32bit);
+  aspath_str_update(as);
+
+  return as;
 }
 
 /* When a BGP router receives an UPDATE with an MP_REACH_NLRI
@@ -390,7 +390,8 @@ community_unintern (struct bgp_peer *peer, struct community *com)
   }
 }
 
-/* Create new community attribute. */
+/* Create new community attribute; it is not interned: see
+   community_intern(). */
 struct community *
 community_parse (struct bgp_peer *peer, u_int32_t *pnt, u_short length)
 {
@@ -407,7 +408,7 @@ community_parse (struct bgp_peer *peer, u_int32_t *pnt, u_short length)
 
   new = community_uniq_sort (peer, &tmp);
 
-  return community_intern (peer, new);
+  return new;
 }
 
 /* Make hash value of community attribute. This function is used by
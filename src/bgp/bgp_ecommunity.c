@@ -139,7 +139,8 @@ ecommunity_uniq_sort (struct bgp_peer *peer, struct ecommunity *ecom)
   return new;
 }
 
-/* Parse Extended Communites Attribute in BGP packet.  */
+/* Parse Extended Communites Attribute in BGP packet; the result is not
+   interned: see ecommunity_intern().  */
 struct ecommunity *
 ecommunity_parse (struct bgp_peer *peer, u_int8_t *pnt, u_short length)
 {
@@ -159,7 +160,7 @@ ecommunity_parse (struct bgp_peer *peer, u_int8_t *pnt, u_short length)
      Extended Communities value  */
   new = ecommunity_uniq_sort (peer, &tmp);
 
-  return ecommunity_intern (peer, new);
+  return new;
 }
 
 /* Intern Extended Communities Attribute.  */
@@ -136,7 +136,8 @@ lcommunity_uniq_sort (struct bgp_peer *peer, struct lcommunity *lcom)
   return new;
 }
 
-/* Parse Large Communites Attribute in BGP packet.  */
+/* Parse Large Communites Attribute in BGP packet; the result is not
+   interned: see lcommunity_intern().  */
 struct lcommunity *
 lcommunity_parse (struct bgp_peer *peer, u_int8_t *pnt, u_short length)
 {
@@ -156,7 +157,7 @@ lcommunity_parse (struct bgp_peer *peer, u_int8_t *pnt, u_short length)
      Large Communities value  */
   new = lcommunity_uniq_sort (peer, &tmp);
 
-  return lcommunity_intern (peer, new);
+  return new;
 }
 
 /* Intern Large Communities Attribute.  */
@@ -500,119 +500,198 @@ int bgp_parse_notification_msg(struct bgp_peer *peer, char *pkt, u_int8_t *res_m
 int bgp_parse_update_msg(struct bgp_peer *peer, char *pkt)
 {
   struct bgp_header bhdr;
-  u_char *startp, *endp;
-  struct bgp_attr attr;
-  u_int16_t attribute_len;
-  u_int16_t update_len;
-  u_int16_t withdraw_len;
-  u_int16_t end, tmp;
-  struct bgp_nlri update;
-  struct bgp_nlri withdraw;
-  struct bgp_nlri mp_update;
-  struct bgp_nlri mp_withdraw;
-  int ret;
+  struct bgp_update_msg msg;
 
   if (!peer || !pkt) return ERR;
 
-  /* Set initial values. */
-  memset(&attr, 0, sizeof (struct bgp_attr));
-  memset(&update, 0, sizeof (struct bgp_nlri));
-  memset(&withdraw, 0, sizeof (struct bgp_nlri));
-  memset(&mp_update, 0, sizeof (struct bgp_nlri));
-  memset(&mp_withdraw, 0, sizeof (struct bgp_nlri));
+  memcpy(&bhdr, pkt, sizeof(bhdr));
+  if (bgp_update_msg_decode(peer, pkt, ntohs(bhdr.bgpo_len), &msg) == ERR) return ERR;
+
+  return bgp_update_msg_process(peer, &msg);
+}
+
+/*
+   Decodes an UPDATE message of at most len bytes received from peer: splits
+   it into its sections, parses the path attributes into structures private
+   to msg (not interned) and the NLRI sections into a list of prefixes. It
+   touches no shared structure, hence can run concurrently to RIB updates
+   (ie. BMP workers), leaving only bgp_update_msg_process() to be serialized.
+   On success, msg must be passed on to bgp_update_msg_process().
+*/
+int bgp_update_msg_decode(struct bgp_peer *peer, char *pkt, u_int32_t len, struct bgp_update_msg *msg)
+{
+  struct bgp_header bhdr;
+  struct bgp_nlri nlri, mp_update, mp_withdraw;
+  u_int16_t end, tmp, attr_len;
+  char *ptr;
+  int to_the_end;
+  u_int8_t flag;
+
+  if (!peer || !pkt || !msg || len < (BGP_HEADER_SIZE + 4)) return ERR;
+
+  memset(msg, 0, sizeof(struct bgp_update_msg));
 
   memcpy(&bhdr, pkt, sizeof(bhdr));
-  end = ntohs(bhdr.bgpo_len);
-  end -= BGP_HEADER_SIZE;
+  msg->len = ntohs(bhdr.bgpo_len);
+  if (msg->len < (BGP_HEADER_SIZE + 4) || msg->len > len) return ERR;
+
+  end = msg->len - BGP_HEADER_SIZE;
   pkt += BGP_HEADER_SIZE;
 
   /* handling Unfeasible routes */
   memcpy(&tmp, pkt, 2);
-  withdraw_len = ntohs(tmp);
-  if (withdraw_len > end) return ERR;  
-  else {
-    end -= withdraw_len;
-    pkt += 2; end -= 2;
-  }
+  msg->withdraw_len = ntohs(tmp);
+  pkt += 2; end -= 2;
+  if (msg->withdraw_len > end) return ERR;
 
-  if (withdraw_len > 0) {
-    withdraw.afi = AFI_IP;
-    withdraw.safi = SAFI_UNICAST;
-    withdraw.nlri = pkt;
-    withdraw.length = withdraw_len;
-    pkt += withdraw_len;
-  }
+  msg->withdraw = pkt;
+  pkt += msg->withdraw_len; end -= msg->withdraw_len;
 
   /* handling Attributes */
+  if (end < 2) return ERR;
   memcpy(&tmp, pkt, 2);
-  attribute_len = ntohs(tmp);
-  if (attribute_len > end) return ERR;
-  else {
-    end -= attribute_len;
-    pkt += 2; end -= 2;
+  msg->attr_len = ntohs(tmp);
+  pkt += 2; end -= 2;
+  if (msg->attr_len > end) return ERR;
+
+  msg->attr = pkt;
+  pkt += msg->attr_len; end -= msg->attr_len;
+
+  for (ptr = msg->attr, to_the_end = msg->attr_len; to_the_end > 0; ptr += attr_len, to_the_end -= attr_len) {
+    if (to_the_end < BGP_ATTR_MIN_LEN) return ERR;
+
+    flag = (u_int8_t) ptr[0];
+    ptr += 2; to_the_end -= 2;
+
+    if (flag & BGP_ATTR_FLAG_EXTLEN) {
+      if (to_the_end < 2) return ERR;
+      memcpy(&tmp, ptr, 2); ptr += 2; to_the_end -= 2; attr_len = ntohs(tmp);
+    }
+    else {
+      attr_len = (u_int8_t) ptr[0]; ptr++; to_the_end--;
+    }
+
+    if (attr_len > to_the_end) return ERR;
   }
 
-  if (attribute_len > 0) {
-    ret = bgp_attr_parse(peer, &attr, pkt, attribute_len, &mp_update, &mp_withdraw);
-    if (ret < 0) return ret;
-    pkt += attribute_len;
+  msg->update = pkt;
+  msg->update_len = end;
+
+  memset(&mp_update, 0, sizeof(struct bgp_nlri));
+  memset(&mp_withdraw, 0, sizeof(struct bgp_nlri));
+
+  if (msg->attr_len > 0) {
+    if (bgp_attr_parse(peer, &msg->pattr, msg->attr, msg->attr_len, &mp_update, &mp_withdraw) < 0) {
+      bgp_update_msg_release(msg);
+      return ERR;
+    }
   }
 
-  update_len = end; end = 0;
+  /* NLRI parsing; a malformed section retains the prefixes preceding the
+     error, other sections are not affected */
+  if (msg->withdraw_len > 0) {
+    memset(&nlri, 0, sizeof(struct bgp_nlri));
+    nlri.afi = AFI_IP;
+    nlri.safi = SAFI_UNICAST;
+    nlri.nlri = (u_char *) msg->withdraw;
+    nlri.length = msg->withdraw_len;
 
-  if (update_len > 0) {
-    update.afi = AFI_IP;
-    update.safi = SAFI_UNICAST;
-    update.nlri = pkt;
-    update.length = update_len;
+    bgp_nlri_parse(peer, &nlri, TRUE, msg);
   }
 
-  /* NLRI parsing */
-  if (withdraw.length) bgp_nlri_parse(peer, NULL, &withdraw);
-  if (update.length)  bgp_nlri_parse(peer, &attr, &update);
-	
-  if (mp_update.length
-	  && mp_update.afi == AFI_IP
-	  && (mp_update.safi == SAFI_UNICAST || mp_update.safi == SAFI_MPLS_LABEL ||
-	      mp_update.safi == SAFI_MPLS_VPN))
-    bgp_nlri_parse(peer, &attr, &mp_update);
-
-  if (mp_withdraw.length
-	  && mp_withdraw.afi == AFI_IP
-	  && (mp_withdraw.safi == SAFI_UNICAST || mp_withdraw.safi == SAFI_MPLS_LABEL ||
-	      mp_withdraw.safi == SAFI_MPLS_VPN))
-    bgp_nlri_parse (peer, NULL, &mp_withdraw);
+  if (msg->update_len > 0) {
+    memset(&nlri, 0, sizeof(struct bgp_nlri));
+    nlri.afi = AFI_IP;
+    nlri.safi = SAFI_UNICAST;
+    nlri.nlri = (u_char *) msg->update;
+    nlri.length = msg->update_len;
 
-#if defined ENABLE_IPV6
-  if (mp_update.length
-	  && mp_update.afi == AFI_IP6
-	  && (mp_update.safi == SAFI_UNICAST || mp_update.safi == SAFI_MPLS_LABEL ||
-	      mp_update.safi == SAFI_MPLS_VPN))
-    bgp_nlri_parse(peer, &attr, &mp_update);
-
-  if (mp_withdraw.length
-	  && mp_withdraw.afi == AFI_IP6
-	  && (mp_withdraw.safi == SAFI_UNICAST || mp_withdraw.safi == SAFI_MPLS_LABEL ||
-	      mp_withdraw.safi == SAFI_MPLS_VPN))
-    bgp_nlri_parse(peer, NULL, &mp_withdraw);
-#endif
+    bgp_nlri_parse(peer, &nlri, FALSE, msg);
+  }
+
+  if (bgp_nlri_supported(&mp_update)) bgp_nlri_parse(peer, &mp_update, FALSE, msg);
+  if (bgp_nlri_supported(&mp_withdraw)) bgp_nlri_parse(peer, &mp_withdraw, TRUE, msg);
+
+  return SUCCESS;
+}
+
+/* Frees what bgp_update_msg_decode() allocated and is still owned by msg */
+void bgp_update_msg_release(struct bgp_update_msg *msg)
+{
+  if (!msg) return;
+
+  if (msg->pattr.aspath) aspath_free(msg->pattr.aspath);
+  if (msg->pattr.community) community_free(msg->pattr.community);
+  if (msg->pattr.ecommunity) ecommunity_free(msg->pattr.ecommunity);
+  if (msg->pattr.lcommunity) lcommunity_free(msg->pattr.lcommunity);
+
+  msg->pattr.aspath = NULL;
+  msg->pattr.community = NULL;
+  msg->pattr.ecommunity = NULL;
+  msg->pattr.lcommunity = NULL;
+
+  if (msg->prefixes) free(msg->prefixes);
+
+  msg->prefixes = NULL;
+  msg->num_prefixes = 0;
+  msg->max_prefixes = 0;
+}
+
+/*
+   Applies to the RIB an UPDATE message decoded by bgp_update_msg_decode():
+   this is where the parsed attributes get interned and shared structures
+   are touched, hence the only part to be serialized against RIB users.
+*/
+int bgp_update_msg_process(struct bgp_peer *peer, struct bgp_update_msg *msg)
+{
+  struct bgp_attr *attr;
+  struct bgp_nlri_prefix *pfx;
+  int idx;
+
+  if (!peer || !msg) return ERR;
+
+  attr = &msg->pattr;
+
+  if (attr->aspath)
+    attr->aspath = aspath_intern(peer, attr->aspath);
+  if (attr->community)
+    attr->community = community_intern(peer, attr->community);
+  if (attr->ecommunity)
+    attr->ecommunity = ecommunity_intern(peer, attr->ecommunity);
+  if (attr->lcommunity)
+    attr->lcommunity = lcommunity_intern(peer, attr->lcommunity);
+
+  for (idx = 0; idx < msg->num_prefixes; idx++) {
+    pfx = &msg->prefixes[idx];
+
+    if (pfx->withdraw)
+      bgp_process_withdraw(peer, &pfx->p, NULL, pfx->afi, pfx->safi, &pfx->rd, &pfx->path_id, (char *) pfx->label);
+    else
+      bgp_process_update(peer, &pfx->p, attr, pfx->afi, pfx->safi, &pfx->rd, &pfx->path_id, (char *) pfx->label);
+  }
 
   /* Receipt of End-of-RIB can be processed here; being a silent
 	 BGP receiver only, honestly it doesn't matter to us */
 
   /* Everything is done.  We unintern temporary structures which
-	 interned in bgp_attr_parse(). */
-  if (attr.aspath)
-    aspath_unintern(peer, attr.aspath);
-  if (attr.community)
-    community_unintern(peer, attr.community);
-  if (attr.ecommunity)
-    ecommunity_unintern(peer, attr.ecommunity);
-  if (attr.lcommunity)
-    lcommunity_unintern(peer, attr.lcommunity);
-
-  ret = ntohs(bhdr.bgpo_len);
-  return ret;
+	 interned above. */
+  if (attr->aspath)
+    aspath_unintern(peer, attr->aspath);
+  if (attr->community)
+    community_unintern(peer, attr->community);
+  if (attr->ecommunity)
+    ecommunity_unintern(peer, attr->ecommunity);
+  if (attr->lcommunity)
+    lcommunity_unintern(peer, attr->lcommunity);
+
+  attr->aspath = NULL;
+  attr->community = NULL;
+  attr->ecommunity = NULL;
+  attr->lcommunity = NULL;
+
+  bgp_update_msg_release(msg);
+
+  return msg->len;
 }
 
 /* BGP UPDATE Attribute parsing */
@@ -694,7 +773,7 @@ int bgp_attr_parse(struct bgp_peer *peer, struct bgp_attr *attr, char *ptr, int
 
     /* AS_PATH and AS4_PATH info are now fully merged;
        hence we can free up temporary structures. */
-    aspath_unintern(peer, as4_path);
+    aspath_free(as4_path);
   
     if (ret < 0) return ret;
   }
@@ -893,96 +972,120 @@ int bgp_attr_parse_mp_unreach(struct bgp_peer *peer, u_int16_t len, struct bgp_a
 }
 
 
-/* BGP UPDATE NLRI parsing */
-int bgp_nlri_parse(struct bgp_peer *peer, void *attr, struct bgp_nlri *info)
+/* MP_REACH_NLRI / MP_UNREACH_NLRI sections we do handle */
+int bgp_nlri_supported(struct bgp_nlri *info)
+{
+  if (!info->length) return FALSE;
+
+  if (info->afi != AFI_IP
+#if defined ENABLE_IPV6
+      && info->afi != AFI_IP6
+#endif
+     ) return FALSE;
+
+  if (info->safi != SAFI_UNICAST && info->safi != SAFI_MPLS_LABEL && info->safi != SAFI_MPLS_VPN)
+    return FALSE;
+
+  return TRUE;
+}
+
+/* BGP UPDATE NLRI parsing: prefixes are appended to msg */
+int bgp_nlri_parse(struct bgp_peer *peer, struct bgp_nlri *info, u_int8_t withdraw, struct bgp_update_msg *msg)
 {
+  struct bgp_misc_structs *bms;
+  struct bgp_nlri_prefix *pfx;
   u_char *pnt;
   u_char *lim;
-  u_char safi, label[3];
-  struct prefix p;
-  int psize, end;
-  int ret;
+  int psize;
   u_int32_t tmp32;
   u_int16_t tmp16;
   struct rd_ip  *rdi;
   struct rd_as  *rda;
   struct rd_as4 *rda4;
-  rd_t rd;
-  path_id_t path_id;
 
-  memset(&p, 0, sizeof(struct prefix));
-  memset(&rd, 0, sizeof(rd_t));
-  memset(&path_id, 0, sizeof(path_id_t));
+  bms = bgp_select_misc_db(peer->type);
+
+  if (!bms) return ERR;
 
   pnt = info->nlri;
   lim = pnt + info->length;
-  end = info->length;
-  safi = info->safi;
 
   for (; pnt < lim; pnt += psize) {
+    if (msg->num_prefixes == msg->max_prefixes) {
+      msg->max_prefixes = msg->max_prefixes ? (msg->max_prefixes * 2) : BGP_NLRI_PREFIXES_ALLOC;
+      msg->prefixes = realloc(msg->prefixes, msg->max_prefixes * sizeof(struct bgp_nlri_prefix));
+      if (!msg->prefixes) {
+	Log(LOG_ERR, "ERROR ( %s/%s ): realloc() failed (bgp_nlri_parse). Exiting ..\n", config.name, bms->log_str);
+	exit_all(1);
+      }
+    }
+
+    pfx = &msg->prefixes[msg->num_prefixes];
+    memset(pfx, 0, sizeof(struct bgp_nlri_prefix));
+
+    pfx->afi = info->afi;
+    pfx->safi = info->safi;
+    pfx->withdraw = withdraw;
 
     /* handle path identifier */
     if (peer->cap_add_paths) {
-      memcpy(&path_id, pnt, 4);
-      path_id = ntohl(path_id);
+      if ((lim - pnt) < 4) return ERR;
+
+      memcpy(&pfx->path_id, pnt, 4);
+      pfx->path_id = ntohl(pfx->path_id);
       pnt += 4;
     }
 
-    memset(&p, 0, sizeof(struct prefix));
-
     /* Fetch prefix length and cross-check */
-    p.prefixlen = *pnt++; end--;
-    p.family = bgp_afi2family (info->afi);
+    if (pnt >= lim) return ERR;
 
-    if (info->safi == SAFI_UNICAST) { 
-      if ((info->afi == AFI_IP && p.prefixlen > 32) || (info->afi == AFI_IP6 && p.prefixlen > 128)) return ERR;
+    pfx->p.prefixlen = *pnt++;
+    pfx->p.family = bgp_afi2family (info->afi);
+    psize = ((pfx->p.prefixlen+7)/8);
 
-      psize = ((p.prefixlen+7)/8);
-      if (psize > end) return ERR;
+    if (info->safi == SAFI_UNICAST) { 
+      if ((info->afi == AFI_IP && pfx->p.prefixlen > 32) || (info->afi == AFI_IP6 && pfx->p.prefixlen > 128)) return ERR;
+      if (psize > (lim - pnt)) return ERR;
 
       /* Fetch prefix from NLRI packet. */
-      memcpy(&p.u.prefix, pnt, psize);
+      memcpy(&pfx->p.u.prefix, pnt, psize);
 
       // XXX: check address correctnesss now that we have it?
     }
     else if (info->safi == SAFI_MPLS_LABEL) { /* rfc3107 labeled unicast */
-      if ((info->afi == AFI_IP && p.prefixlen > 56) || (info->afi == AFI_IP6 && p.prefixlen > 152)) return ERR;
-
-      psize = ((p.prefixlen+7)/8);
-      if (psize > end) return ERR;
+      if ((info->afi == AFI_IP && pfx->p.prefixlen > 56) || (info->afi == AFI_IP6 && pfx->p.prefixlen > 152)) return ERR;
+      if (pfx->p.prefixlen < 24 || psize > (lim - pnt)) return ERR;
 
       /* Fetch label (3) and prefix from NLRI packet */
-      memcpy(label, pnt, 3);
-      memcpy(&p.u.prefix, pnt+3, (psize-3));
-      p.prefixlen -= 24;
+      memcpy(pfx->label, pnt, 3);
+      memcpy(&pfx->p.u.prefix, pnt+3, (psize-3));
+      pfx->p.prefixlen -= 24;
     }
     else if (info->safi == SAFI_MPLS_VPN) { /* rfc4364 BGP/MPLS IP Virtual Private Networks */
-      if ((info->afi == AFI_IP && p.prefixlen > 120) || (info->afi == AFI_IP6 && p.prefixlen > 216)) return ERR;
-
-      psize = ((p.prefixlen+7)/8);
-      if (psize > end) return ERR;
+      if ((info->afi == AFI_IP && pfx->p.prefixlen > 120) || (info->afi == AFI_IP6 && pfx->p.prefixlen > 216)) return ERR;
+      if (pfx->p.prefixlen < 88 || psize > (lim - pnt)) return ERR;
 
       /* Fetch label (3), RD (8) and prefix from NLRI packet */
-      memcpy(label, pnt, 3);
+      memcpy(pfx->label, pnt, 3);
 
-      memcpy(&rd.type, pnt+3, 2);
-      rd.type = ntohs(rd.type);
-      switch(rd.type) {
+      memcpy(&pfx->rd.type, pnt+3, 2);
+      pfx->rd.type = ntohs(pfx->rd.type);
+      switch(pfx->rd.type) {
       case RD_TYPE_AS: 
-	rda = (struct rd_as *) &rd;
+	rda = (struct rd_as *) &pfx->rd;
 	memcpy(&tmp16, pnt+5, 2);
 	memcpy(&tmp32, pnt+7, 4);
 	rda->as = ntohs(tmp16);
 	rda->val = ntohl(tmp32);
 	break;
       case RD_TYPE_IP: 
-	rdi = (struct rd_ip *) &rd;
+	rdi = (struct rd_ip *) &pfx->rd;
 	memcpy(&rdi->ip.s_addr, pnt+5, 4);
 	memcpy(&tmp16, pnt+9, 2);
 	rdi->val = ntohs(tmp16);
 	break;
       case RD_TYPE_AS4: 
-	rda4 = (struct rd_as4 *) &rd;
+	rda4 = (struct rd_as4 *) &pfx->rd;
 	memcpy(&tmp32, pnt+5, 4);
 	memcpy(&tmp16, pnt+9, 2);
 	rda4->as = ntohl(tmp32);
@@ -993,15 +1096,12 @@ int bgp_nlri_parse(struct bgp_peer *peer, void *attr, struct bgp_nlri *info)
 	break;
       }
     
-      memcpy(&p.u.prefix, pnt+11, (psize-11));
-      p.prefixlen -= 88;
+      memcpy(&pfx->p.u.prefix, pnt+11, (psize-11));
+      pfx->p.prefixlen -= 88;
     }
+    else return ERR;
 
-    /* Let's do our job now! */
-    if (attr)
-      ret = bgp_process_update(peer, &p, attr, info->afi, safi, &rd, &path_id, label);
-    else
-      ret = bgp_process_withdraw(peer, &p, attr, info->afi, safi, &rd, &path_id, label);
+    msg->num_prefixes++;
   }
 
   return SUCCESS;
@@ -418,6 +418,14 @@ struct bgp_attr *bgp_attr_intern(struct bgp_peer *peer, struct bgp_attr *attr)
   find = (struct bgp_attr *) hash_get(peer, inter_domain_routing_db->attrhash, attr, bgp_attr_hash_alloc);
   find->refcnt++;
 
+  /* memo is filled in here, by the RIB owner, as the attribute is shared
+     read-only with the packet handlers of the core process */
+  if (!find->memo) {
+    struct bgp_misc_structs *bms = bgp_select_misc_db(peer->type);
+
+    if (bms && bms->is_thread) find->memo = bgp_attr_memo_new(find);
+  }
+
   return find;
 }
 
@@ -451,6 +459,7 @@ void bgp_attr_unintern(struct bgp_peer *peer, struct bgp_attr *attr)
     ret = (struct bgp_attr *) hash_release(inter_domain_routing_db->attrhash, attr);
     // assert (ret != NULL);
     if (!ret) Log(LOG_INFO, "INFO ( %s/%s ): bgp_attr_unintern() hash lookup failed.\n", config.name, bms->log_str);
+    if (attr->memo) bgp_attr_memo_free(attr->memo);
     free(attr);
   }
 
@@ -479,11 +488,118 @@ void *bgp_attr_hash_alloc(void *p)
     memset(attr, 0, sizeof (struct bgp_attr));
     memcpy(attr, val, sizeof (struct bgp_attr));
     attr->refcnt = 0;
+    attr->memo = NULL;
   }
 
   return attr;
 }
 
+/* applies patterns, if any, to a community string; 'len' is set to the
+   length of the result including the trailing null, or 0 if empty */
+static char *bgp_attr_memo_comms(char *src, char **patterns, int *len, u_int8_t *alloc, u_int8_t flag)
+{
+  char *dst;
+
+  *len = strlen(src);
+  if (!(*len)) return src;
+
+  (*len)++;
+  if (!patterns) return src;
+
+  dst = malloc(*len);
+  if (!dst) {
+    Log(LOG_ERR, "ERROR ( %s/core/BGP ): malloc() failed (bgp_attr_memo_comms). Exiting ..\n", config.name);
+    exit_all(1);
+  }
+
+  evaluate_comm_patterns(dst, src, patterns, *len);
+  *len = strlen(dst)+1;
+  (*alloc) |= flag;
+
+  return dst;
+}
+
+/* computes the values derived from the attribute; they depend only on
+   the attribute and on global configuration */
+struct bgp_attr_memo *bgp_attr_memo_new(struct bgp_attr *attr)
+{
+  struct bgp_attr_memo *memo;
+  char tmp_stdcomms[MAX_BGP_STD_COMMS], tmp_stdcomms2[MAX_BGP_STD_COMMS];
+
+  memo = malloc(sizeof(struct bgp_attr_memo));
+  if (!memo) {
+    Log(LOG_ERR, "ERROR ( %s/core/BGP ): malloc() failed (bgp_attr_memo_new). Exiting ..\n", config.name);
+    exit_all(1);
+  }
+  memset(memo, 0, sizeof(struct bgp_attr_memo));
+
+  if (attr->aspath && attr->aspath->str) {
+    memo->first_asn = evaluate_first_asn(attr->aspath->str);
+
+    memo->as_path = attr->aspath->str;
+    memo->as_path_len = strlen(attr->aspath->str);
+    if (memo->as_path_len) {
+      memo->as_path_len++;
+
+      if (config.nfacctd_bgp_aspath_radius) {
+	memo->as_path = strndup(attr->aspath->str, memo->as_path_len);
+	if (!memo->as_path) {
+	  Log(LOG_ERR, "ERROR ( %s/core/BGP ): malloc() failed (bgp_attr_memo_new). Exiting ..\n", config.name);
+	  exit_all(1);
+	}
+
+	evaluate_bgp_aspath_radius(memo->as_path, memo->as_path_len, config.nfacctd_bgp_aspath_radius);
+	memo->as_path_len = strlen(memo->as_path)+1;
+	memo->alloc |= BGP_ATTR_MEMO_AS_PATH;
+      }
+    }
+  }
+
+  if (attr->community && attr->community->str) {
+    memo->std_comms = bgp_attr_memo_comms(attr->community->str, config.nfacctd_bgp_stdcomm_pattern ? std_comm_patterns : NULL,
+					  &memo->std_comms_len, &memo->alloc, BGP_ATTR_MEMO_STD_COMMS);
+
+    if (config.nfacctd_bgp_stdcomm_pattern_to_asn) {
+      evaluate_comm_patterns(tmp_stdcomms, attr->community->str, std_comm_patterns_to_asn, MAX_BGP_STD_COMMS);
+      memcpy(tmp_stdcomms2, tmp_stdcomms, MAX_BGP_STD_COMMS);
+      copy_stdcomm_to_asn(tmp_stdcomms, &memo->comm_origin_asn, TRUE);
+      copy_stdcomm_to_asn(tmp_stdcomms2, &memo->comm_peer_asn, FALSE);
+    }
+  }
+
+  if (attr->ecommunity && attr->ecommunity->str)
+    memo->ext_comms = bgp_attr_memo_comms(attr->ecommunity->str, config.nfacctd_bgp_extcomm_pattern ? ext_comm_patterns : NULL,
+					  &memo->ext_comms_len, &memo->alloc, BGP_ATTR_MEMO_EXT_COMMS);
+
+  if (attr->lcommunity && attr->lcommunity->str)
+    memo->lrg_comms = bgp_attr_memo_comms(attr->lcommunity->str, config.nfacctd_bgp_lrgcomm_pattern ? lrg_comm_patterns : NULL,
+					  &memo->lrg_comms_len, &memo->alloc, BGP_ATTR_MEMO_LRG_COMMS);
+
+  return memo;
+}
+
+/* returns the memo of an interned attribute without ever writing to it */
+struct bgp_attr_memo *bgp_attr_memo_get(struct bgp_attr *attr)
+{
+  static struct bgp_attr_memo empty_memo = { 0, 0, 0, "", "", "", "", 0, 0, 0, 0, 0 };
+
+  if (attr->memo) return attr->memo;
+
+  return &empty_memo;
+}
+
+void bgp_attr_memo_free(struct bgp_attr_memo *memo)
+{
+  if (!memo) return;
+
+  if (memo->alloc & BGP_ATTR_MEMO_AS_PATH) free(memo->as_path);
+  if (memo->alloc & BGP_ATTR_MEMO_STD_COMMS) free(memo->std_comms);
+  if (memo->alloc & BGP_ATTR_MEMO_EXT_COMMS) free(memo->ext_comms);
+  if (memo->alloc & BGP_ATTR_MEMO_LRG_COMMS) free(memo->lrg_comms);
+
+  free(memo);
+}
+
 int bgp_peer_init(struct bgp_peer *peer, int type)
 {
   struct bgp_misc_structs *bms;
@@ -619,9 +735,12 @@ int bgp_attr_munge_as4path(struct bgp_peer *peer, struct bgp_attr *attr, struct
   /* pre-requisite for AS4_PATH is AS_PATH indeed */ 
   // XXX if (as4path && !attr->aspath) return ERR;
 
+  /* attr is not interned yet: see bgp_update_msg_decode() */
   newpath = aspath_reconcile_as4(peer, attr->aspath, as4path);
-  aspath_unintern(peer, attr->aspath);
-  attr->aspath = aspath_intern(peer, newpath);
+  if (newpath) {
+    aspath_free(attr->aspath);
+    attr->aspath = newpath;
+  }
 
   return SUCCESS;
 }
@@ -59,6 +59,9 @@ EXT void bgp_attr_init(int, struct bgp_rt_structs *);
 EXT struct bgp_attr *bgp_attr_intern(struct bgp_peer *, struct bgp_attr *);
 EXT void bgp_attr_unintern (struct bgp_peer *, struct bgp_attr *);
 EXT void *bgp_attr_hash_alloc (void *);
+EXT struct bgp_attr_memo *bgp_attr_memo_new(struct bgp_attr *);
+EXT struct bgp_attr_memo *bgp_attr_memo_get(struct bgp_attr *);
+EXT void bgp_attr_memo_free(struct bgp_attr_memo *);
 EXT int bgp_attr_munge_as4path(struct bgp_peer *, struct bgp_attr *, struct aspath *);
 
 EXT int bgp_peer_init(struct bgp_peer *, int);
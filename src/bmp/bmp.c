@@ -38,6 +38,30 @@
 /* variables to be exported away */
 thread_pool_t *bmp_pool;
 
+#if defined ENABLE_THREADS
+/* work items handed over by the reader to the workers */
+#define BMP_WORK_DATA		0
+#define BMP_WORK_CLOSE		1
+
+struct bmp_work {
+  struct bmp_work *next;
+  struct bmp_peer *bmpp;
+  u_int8_t type;
+  u_int32_t len;		/* BMP_WORK_DATA: whole BMP messages following the header */
+};
+
+struct bmp_worker {
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  struct bmp_work *head;
+  struct bmp_work *tail;
+};
+
+static thread_pool_t *bmp_workers_pool;
+static struct bmp_worker *bmp_workers;
+static pthread_mutex_t bmp_rib_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
 /* Functions */
 #if defined ENABLE_THREADS
 void nfacctd_bmp_wrapper()
@@ -56,11 +80,229 @@ void nfacctd_bmp_wrapper()
 }
 #endif
 
+/*
+   RIB, attribute hashes, logs and dumps are shared by all BMP routers: with
+   workers, whoever touches them (workers applying messages, the reader
+   accepting and closing peers or dumping tables) has to hold the RIB lock.
+   Workers decode and validate messages without it: only interning the
+   attributes and applying the prefixes to the RIB is serialized, see
+   bmp_process_msg_route_monitor() and bgp_update_msg_process().
+*/
+void bmp_rib_lock()
+{
+#if defined ENABLE_THREADS
+  if (bmp_workers) pthread_mutex_lock(&bmp_rib_mutex);
+#endif
+}
+
+void bmp_rib_unlock()
+{
+#if defined ENABLE_THREADS
+  if (bmp_workers) pthread_mutex_unlock(&bmp_rib_mutex);
+#endif
+}
+
+#if defined ENABLE_THREADS
+static void bmp_worker_thread(struct bmp_worker *w)
+{
+  struct bmp_work *item;
+  struct bmp_common_hdr *bch;
+  u_int32_t msg_len, remaining_len;
+  char *msg;
+
+  for (;;) {
+    pthread_mutex_lock(&w->mutex);
+    while (!w->head) pthread_cond_wait(&w->cond, &w->mutex);
+
+    item = w->head;
+    w->head = item->next;
+    if (!w->head) w->tail = NULL;
+    pthread_mutex_unlock(&w->mutex);
+
+    if (item->type == BMP_WORK_DATA) {
+      /* messages were framed by the reader; the RIB lock is taken by
+         bmp_process_packet() only to apply what was decoded */
+      for (msg = (char *) (item + 1), remaining_len = item->len; remaining_len >= sizeof(struct bmp_common_hdr);
+	   msg += msg_len, remaining_len -= msg_len) {
+	bch = (struct bmp_common_hdr *) msg;
+	bmp_common_hdr_get_len(bch, &msg_len);
+
+	bmp_process_packet(msg, msg_len, item->bmpp);
+      }
+
+      __sync_fetch_and_sub(&item->bmpp->rx_queued, item->len);
+    }
+    else if (item->type == BMP_WORK_CLOSE) {
+      /* all messages of the router are applied: the socket and the slot
+         belong to the reader, which completes the close */
+      __sync_synchronize();
+      item->bmpp->rx_closing = BMP_RX_CLOSE_READY;
+    }
+
+    free(item);
+  }
+}
+
+static void bmp_workers_init()
+{
+  int idx;
+
+  bmp_workers = malloc(config.nfacctd_bmp_threads * sizeof(struct bmp_worker));
+  if (!bmp_workers) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): Unable to malloc() BMP workers. Terminating thread.\n", config.name, bmp_misc_db->log_str);
+    exit_all(1);
+  }
+
+  bmp_workers_pool = allocate_thread_pool(config.nfacctd_bmp_threads);
+  assert(bmp_workers_pool);
+
+  for (idx = 0; idx < config.nfacctd_bmp_threads; idx++) {
+    pthread_mutex_init(&bmp_workers[idx].mutex, NULL);
+    pthread_cond_init(&bmp_workers[idx].cond, NULL);
+    bmp_workers[idx].head = NULL;
+    bmp_workers[idx].tail = NULL;
+
+    send_to_pool(bmp_workers_pool, bmp_worker_thread, &bmp_workers[idx]);
+  }
+
+  Log(LOG_INFO, "INFO ( %s/%s ): %d BMP worker thread(s) initialized\n", config.name, bmp_misc_db->log_str, config.nfacctd_bmp_threads);
+}
+
+/* messages of a router always go to the same worker, hence are processed in order */
+static void bmp_work_enqueue(struct bmp_peer *bmpp, u_int8_t type, char *data, u_int32_t len)
+{
+  struct bmp_worker *w = &bmp_workers[(bmpp - bmp_peers) % config.nfacctd_bmp_threads];
+  struct bmp_work *item;
+
+  item = malloc(sizeof(struct bmp_work) + len);
+  if (!item) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): Unable to malloc() BMP work item. Terminating thread.\n", config.name, bmp_misc_db->log_str);
+    exit_all(1);
+  }
+
+  item->next = NULL;
+  item->bmpp = bmpp;
+  item->type = type;
+  item->len = len;
+  if (len) {
+    memcpy((char *) (item + 1), data, len);
+    __sync_fetch_and_add(&bmpp->rx_queued, len);
+  }
+
+  pthread_mutex_lock(&w->mutex);
+  if (w->tail) w->tail->next = item;
+  else w->head = item;
+  w->tail = item;
+  pthread_cond_signal(&w->cond);
+  pthread_mutex_unlock(&w->mutex);
+}
+#endif
+
+static void bmp_peer_rx_close(struct bmp_peer *bmpp)
+{
+#if defined ENABLE_THREADS
+  if (bmp_workers) {
+    bmpp->rx_closing = BMP_RX_CLOSE_QUEUED;
+    bmp_work_enqueue(bmpp, BMP_WORK_CLOSE, NULL, 0);
+    return;
+  }
+#endif
+
+  bmp_peer_close(bmpp, FUNC_TYPE_BMP);
+}
+
+/*
+   Reads from a BMP router into its receive buffer, which grows to fit the
+   message being reassembled; whole messages are then framed out and either
+   processed inline or handed over to the router's worker, the remainder is
+   moved to the head of the buffer. Returns ERR if the session is to be closed.
+*/
+static int bmp_peer_recv(struct bmp_peer *bmpp)
+{
+  struct bgp_peer *peer = &bmpp->self;
+  struct bmp_common_hdr *bch;
+  u_int32_t msg_len, consumed, remaining_len;
+  int ret, discard = FALSE;
+
+  if (peer->buf.truncated_len >= sizeof(struct bmp_common_hdr)) {
+    bch = (struct bmp_common_hdr *) peer->buf.base;
+    bmp_common_hdr_get_len(bch, &msg_len);
+
+    if (msg_len > peer->buf.len) {
+      char *new_base;
+
+      if (msg_len > BMP_MAX_MSG_SIZE) {
+	Log(LOG_INFO, "INFO ( %s/%s ): [%s] BMP message too big (%u bytes). Closing connection.\n",
+	    config.name, bmp_misc_db->log_str, peer->addr_str, msg_len);
+	return ERR;
+      }
+
+      new_base = realloc(peer->buf.base, msg_len);
+      if (!new_base) {
+	Log(LOG_ERR, "ERROR ( %s/%s ): [%s] Unable to grow BMP receive buffer (%u bytes). Closing connection.\n",
+	    config.name, bmp_misc_db->log_str, peer->addr_str, msg_len);
+	return ERR;
+      }
+
+      peer->buf.base = new_base;
+      peer->buf.len = msg_len;
+    }
+  }
+
+  ret = recv(peer->fd, &peer->buf.base[peer->buf.truncated_len], (peer->buf.len - peer->buf.truncated_len), 0);
+  if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return SUCCESS;
+
+  if (ret <= 0) {
+    Log(LOG_INFO, "INFO ( %s/%s ): [%s] BMP connection reset by peer (%d).\n", config.name, bmp_misc_db->log_str, peer->addr_str, errno);
+    return ERR;
+  }
+
+  peer->msglen = (ret + peer->buf.truncated_len);
+
+  for (consumed = 0, remaining_len = peer->msglen; remaining_len >= sizeof(struct bmp_common_hdr); ) {
+    bch = (struct bmp_common_hdr *) &peer->buf.base[consumed];
+    bmp_common_hdr_get_len(bch, &msg_len);
+
+    if (bch->version != BMP_V3) {
+      Log(LOG_INFO, "INFO ( %s/%s ): [%s] packet discarded: BMP version != %u\n",
+	  config.name, bmp_misc_db->log_str, peer->addr_str, BMP_V3);
+      discard = TRUE;
+      break;
+    }
+
+    if (msg_len < sizeof(struct bmp_common_hdr)) {
+      Log(LOG_INFO, "INFO ( %s/%s ): [%s] packet discarded: invalid BMP message length (%u)\n",
+	  config.name, bmp_misc_db->log_str, peer->addr_str, msg_len);
+      discard = TRUE;
+      break;
+    }
+
+    if (remaining_len < msg_len) break;
+
+    consumed += msg_len;
+    remaining_len -= msg_len;
+  }
+
+  if (consumed) {
+#if defined ENABLE_THREADS
+    if (bmp_workers) bmp_work_enqueue(bmpp, BMP_WORK_DATA, peer->buf.base, consumed);
+    else
+#endif
+    bmp_process_packet(peer->buf.base, consumed, bmpp);
+  }
+
+  if (discard) remaining_len = 0;
+
+  if (remaining_len && consumed) memmove(peer->buf.base, &peer->buf.base[consumed], remaining_len);
+  peer->buf.truncated_len = remaining_len;
+
+  return SUCCESS;
+}
+
 void skinny_bmp_daemon()
 {
   int slen, clen, ret, rc, peers_idx, allowed, yes=1, no=0;
-  int peers_idx_rr = 0, max_peers_idx = 0;
-  u_int32_t pkt_remaining_len=0;
+  int peers_idx_rr = 0, max_peers_idx = 0, throttled, closing = FALSE;
   time_t now;
   afi_t afi;
   safi_t safi;
@@ -85,6 +327,8 @@ void skinny_bmp_daemon()
   time_t dump_refresh_deadline;
   struct timeval dump_refresh_timeout, *drt_ptr;
 
+  if (!config.nfacctd_bmp_queue_size) config.nfacctd_bmp_queue_size = BMP_QUEUE_SIZE_DEFAULT;
+
 
   /* initial cleanups */
   reload_log_bmp_thread = FALSE;
@@ -346,20 +590,52 @@ void skinny_bmp_daemon()
 
   bmp_link_misc_structs(bmp_misc_db);
 
+  if (config.nfacctd_bmp_threads) {
+#if defined ENABLE_THREADS
+    bmp_workers_init();
+#else
+    Log(LOG_WARNING, "WARN ( %s/%s ): 'bmp_daemon_threads' requires threads support (--enable-threads). Ignored.\n", config.name, bmp_misc_db->log_str);
+#endif
+  }
+
   for (;;) {
     select_again:
 
+#if defined ENABLE_THREADS
+    /* closes handed over to workers are completed here, once they drained
+       the router's queue: only the reader ever touches peer sockets */
+    if (bmp_workers) {
+      for (closing = FALSE, peers_idx = 0; peers_idx < max_peers_idx; peers_idx++) {
+	if (bmp_peers[peers_idx].rx_closing == BMP_RX_CLOSE_READY) {
+	  bmp_rib_lock();
+	  bmp_peer_close(&bmp_peers[peers_idx], FUNC_TYPE_BMP);
+	  bmp_rib_unlock();
+
+	  bmp_peers[peers_idx].rx_closing = FALSE;
+	  recalc_fds = TRUE;
+	}
+	else if (bmp_peers[peers_idx].rx_closing) closing = TRUE;
+      }
+    }
+#endif
+
     if (recalc_fds) {
+      u_int32_t peers_num = 0;
+
       select_fd = config.bmp_sock;
       max_peers_idx = -1; /* .. since valid indexes include 0 */
 
       for (peers_idx = 0; peers_idx < config.nfacctd_bmp_max_peers; peers_idx++) {
         if (select_fd < bmp_peers[peers_idx].self.fd) select_fd = bmp_peers[peers_idx].self.fd;
         if (bmp_peers[peers_idx].self.fd) max_peers_idx = peers_idx;
+        if (bmp_peers[peers_idx].self.fd && !bmp_peers[peers_idx].rx_closing) peers_num++;
       }
       select_fd++;
       max_peers_idx++;
 
+      /* published along, for stats_shm_update() to read */
+      bmp_peers_num = peers_num;
+
       bkp_select_fd = select_fd;
       recalc_fds = FALSE;
     }
@@ -367,6 +643,15 @@ void skinny_bmp_daemon()
 
     memcpy(&read_descs, &bkp_read_descs, sizeof(bkp_read_descs));
 
+    /* routers whose workers lag behind are not read for a while: TCP pushes back on them only */
+    for (throttled = FALSE, peers_idx = 0; peers_idx < max_peers_idx; peers_idx++) {
+      if (bmp_peers[peers_idx].self.fd && !bmp_peers[peers_idx].rx_closing &&
+	  bmp_peers[peers_idx].rx_queued > config.nfacctd_bmp_queue_size) {
+	FD_CLR(bmp_peers[peers_idx].self.fd, &read_descs);
+	throttled = TRUE;
+      }
+    }
+
     if (bmp_misc_db->dump_backend_methods) {
       int delta;
 
@@ -377,10 +662,19 @@ void skinny_bmp_daemon()
     }
     else drt_ptr = NULL;
 
+    /* also polled: closes pending on workers */
+    if (throttled || closing) {
+      dump_refresh_timeout.tv_sec = 0;
+      dump_refresh_timeout.tv_usec = BMP_THROTTLE_USECS;
+      drt_ptr = &dump_refresh_timeout;
+    }
+
     select_num = select(select_fd, &read_descs, NULL, NULL, drt_ptr);
     if (select_num < 0) goto select_again;
 
     if (reload_log_bmp_thread) {
+      bmp_rib_lock();
+
       for (peers_idx = 0; peers_idx < config.nfacctd_bmp_max_peers; peers_idx++) {
         if (bmp_misc_db->peers_log[peers_idx].fd) {
           fclose(bmp_misc_db->peers_log[peers_idx].fd);
@@ -390,6 +684,7 @@ void skinny_bmp_daemon()
         else break;
       }
 
+      bmp_rib_unlock();
       reload_log_bmp_thread = FALSE;
     }
 
@@ -404,7 +699,9 @@ void skinny_bmp_daemon()
           compose_timestamp(bmp_misc_db->dump.tstamp_str, SRVBUFLEN, &bmp_misc_db->dump.tstamp, FALSE, config.timestamps_since_epoch);
 	  bmp_misc_db->dump.period = config.bmp_dump_refresh_time;
 
+          bmp_rib_lock();
           bmp_handle_dump_event();
+          bmp_rib_unlock();
           dump_refresh_deadline += config.bmp_dump_refresh_time;
         }
       }
@@ -457,8 +754,10 @@ void skinny_bmp_daemon()
 	goto read_data;
       }
 
+      bmp_rib_lock();
+
       for (peer = NULL, peers_idx = 0; peers_idx < config.nfacctd_bmp_max_peers; peers_idx++) {
-        if (!bmp_peers[peers_idx].self.fd) {
+        if (!bmp_peers[peers_idx].self.fd && !bmp_peers[peers_idx].rx_closing) {
           now = time(NULL);
 
           /*
@@ -494,6 +793,7 @@ void skinny_bmp_daemon()
             }
 
             close(fd);
+            bmp_rib_unlock();
             goto read_data;
           }
         }
@@ -506,10 +806,12 @@ void skinny_bmp_daemon()
         Log(LOG_ERR, "ERROR ( %s/%s ): Insufficient number of BMP peers has been configured by 'bmp_daemon_max_peers' (%d).\n",
                         config.name, bmp_misc_db->log_str, config.nfacctd_bmp_max_peers);
         close(fd);
+        bmp_rib_unlock();
         goto read_data;
       }
 
       peer->fd = fd;
+      fcntl(peer->fd, F_SETFL, (fcntl(peer->fd, F_GETFL) | O_NONBLOCK));
       FD_SET(peer->fd, &bkp_read_descs);
       peer->addr.family = ((struct sockaddr *)&client)->sa_family;
       if (peer->addr.family == AF_INET) {
@@ -545,46 +847,32 @@ void skinny_bmp_daemon()
       }
 
       Log(LOG_INFO, "INFO ( %s/%s ): [%s] BMP peers usage: %u/%u\n", config.name, bmp_misc_db->log_str, peer->addr_str, peers_num, config.nfacctd_bmp_max_peers);
+      bmp_rib_unlock();
     }
 
     read_data:
 
     /*
-       We have something coming in: let's lookup which peer is that.
-       FvD: To avoid starvation of the "later established" peers, we
-       offset the start of the search in a round-robin style.
+       We have something coming in: let's serve all peers that are ready,
+       one recv() each per round. FvD: To avoid starvation of the "later
+       established" peers, we offset the start in a round-robin style.
     */
-    for (peer = NULL, peers_idx = 0; peers_idx < max_peers_idx; peers_idx++) {
+    for (peers_idx = 0; peers_idx < max_peers_idx; peers_idx++) {
       int loc_idx = (peers_idx + peers_idx_rr) % max_peers_idx;
 
-      if (bmp_peers[loc_idx].self.fd && FD_ISSET(bmp_peers[loc_idx].self.fd, &read_descs)) {
-        peer = &bmp_peers[loc_idx].self;
-	bmpp = &bmp_peers[loc_idx];
-        peers_idx_rr = (peers_idx_rr + 1) % max_peers_idx;
-        break;
-      }
-    }
-
-    if (!peer) goto select_again;
+      bmpp = &bmp_peers[loc_idx];
+      peer = &bmpp->self;
 
-    ret = recv(peer->fd, &peer->buf.base[peer->buf.truncated_len], (peer->buf.len - peer->buf.truncated_len), 0);
-    peer->msglen = (ret + peer->buf.truncated_len);
+      if (!peer->fd || bmpp->rx_closing || !FD_ISSET(peer->fd, &read_descs)) continue;
 
-    if (ret <= 0) {
-      Log(LOG_INFO, "INFO ( %s/%s ): [%s] BMP connection reset by peer (%d).\n", config.name, bmp_misc_db->log_str, peer->addr_str, errno);
-      FD_CLR(peer->fd, &bkp_read_descs);
-      bmp_peer_close(bmpp, FUNC_TYPE_BMP);
-      recalc_fds = TRUE;
-      goto select_again;
+      if (bmp_peer_recv(bmpp) == ERR) {
+        FD_CLR(peer->fd, &bkp_read_descs);
+        bmp_peer_rx_close(bmpp);
+        recalc_fds = TRUE;
+      }
     }
-    else {
-      pkt_remaining_len = bmp_process_packet(peer->buf.base, peer->msglen, bmpp);
 
-      /* handling offset for TCP segment reassembly */
-      if (pkt_remaining_len) peer->buf.truncated_len = bmp_packet_adj_offset(peer->buf.base, peer->buf.len, peer->msglen,
-									     pkt_remaining_len, peer->addr_str);
-      else peer->buf.truncated_len = 0;
-    }
+    if (max_peers_idx) peers_idx_rr = (peers_idx_rr + 1) % max_peers_idx;
   }
 }
 
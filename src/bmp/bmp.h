@@ -28,6 +28,14 @@
 
 #define BMP_MISSING_PEER_UP_LOG_TOUT	60
 
+#define BMP_MAX_MSG_SIZE		(16 * 1024 * 1024)	/* receive buffers grow up to this */
+#define BMP_QUEUE_SIZE_DEFAULT		(8 * 1024 * 1024)	/* per-router bytes queued to workers */
+#define BMP_THROTTLE_USECS		10000
+
+/* bmp_peer.rx_closing */
+#define BMP_RX_CLOSE_QUEUED		1	/* behind the router's queued messages */
+#define BMP_RX_CLOSE_READY		2	/* queue drained, reader to close */
+
 /* definitions originally based on draft-ietf-grow-bmp-07 */
 /* definitions review #1 based on draft-ietf-grow-bmp-17 */
 
@@ -110,6 +118,8 @@ struct bmp_peer {
   struct bgp_peer self;
   void *bgp_peers;
   struct log_notification missing_peer_up;
+  u_int32_t rx_queued;		/* bytes handed over to a worker, not yet processed */
+  u_int8_t rx_closing;		/* BMP_RX_CLOSE_*: close pending, slot not yet free */
 };
 
 #define BMP_STATS_TYPE0		0 /* (32-bit Counter) Number of prefixes rejected by inbound policy */
@@ -182,6 +192,8 @@ EXT void nfacctd_bmp_wrapper();
 EXT void skinny_bmp_daemon();
 EXT void bmp_prepare_thread();
 EXT void bmp_prepare_daemon();
+EXT void bmp_rib_lock();
+EXT void bmp_rib_unlock();
 #undef EXT
 
 /* global variables */
@@ -191,6 +203,7 @@ EXT void bmp_prepare_daemon();
 #define EXT
 #endif
 EXT struct bmp_peer *bmp_peers;
+EXT u_int32_t bmp_peers_num;	/* published by the BMP thread */
 EXT u_int32_t (*bmp_route_info_modulo)(struct bgp_peer *, path_id_t *, int);
 
 EXT struct bgp_rt_structs *bmp_routing_db;
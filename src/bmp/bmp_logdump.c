@@ -373,108 +373,261 @@ void bmp_dump_init_peer(struct bgp_peer *peer)
 
   assert(!peer->bmp_se);
 
-  peer->bmp_se = malloc(sizeof(struct bmp_dump_se_ll));
+  peer->bmp_se = malloc(sizeof(struct bmp_dump_se_store));
   if (!peer->bmp_se) {
     Log(LOG_ERR, "ERROR ( %s/%s ): Unable to malloc() bmp_se structure. Terminating thread.\n", config.name, bms->log_str);
     exit_all(1);
   }
 
-  memset(peer->bmp_se, 0, sizeof(struct bmp_dump_se_ll));
+  memset(peer->bmp_se, 0, sizeof(struct bmp_dump_se_store));
 }
 
 void bmp_dump_close_peer(struct bgp_peer *peer)
 {
-  struct bmp_dump_se_ll *bdsell;
+  struct bmp_dump_se_store *bdss;
 
   if (!peer) return;
 
-  bdsell = (struct bmp_dump_se_ll *) peer->bmp_se;
+  bdss = (struct bmp_dump_se_store *) peer->bmp_se;
 
-  if (bdsell && bdsell->start) bmp_dump_se_ll_destroy(bdsell);
+  if (bdss) {
+    free(bdss->ring);
+    free(bdss->arena);
+  }
  
   free(peer->bmp_se);
   peer->bmp_se = NULL;
 }
 
-void bmp_dump_se_ll_append(struct bgp_peer *peer, struct bmp_data *bdata, void *extra, int log_type)
+static void bmp_dump_se_addr_encode(u_int8_t *dst, u_int8_t *family, struct host_addr *a)
+{
+  *family = a->family;
+
+  if (a->family == AF_INET) memcpy(dst, &a->address.ipv4, 4);
+#if defined ENABLE_IPV6
+  else if (a->family == AF_INET6) memcpy(dst, &a->address.ipv6, 16);
+#endif
+}
+
+static void bmp_dump_se_addr_decode(struct host_addr *a, u_int8_t *src, u_int8_t family)
+{
+  a->family = family;
+
+  if (family == AF_INET) memcpy(&a->address.ipv4, src, 4);
+#if defined ENABLE_IPV6
+  else if (family == AF_INET6) memcpy(&a->address.ipv6, src, 16);
+#endif
+}
+
+/* copies a TLV value, NUL-terminated, into the arena; returns FALSE if it can't be kept */
+static int bmp_dump_se_arena_put(struct bmp_dump_se_store *bdss, char *val, u_int16_t len, u_int32_t *off)
+{
+  u_int32_t needed = (bdss->arena_used + len + 1);
+
+  if (needed > BMP_DUMP_SE_ARENA_MAX) return FALSE;
+
+  if (needed > bdss->arena_alloc) {
+    u_int32_t new_alloc = (bdss->arena_alloc ? bdss->arena_alloc : 1024);
+    char *new_arena;
+
+    while (new_alloc < needed) new_alloc *= 2;
+    if (new_alloc > BMP_DUMP_SE_ARENA_MAX) new_alloc = BMP_DUMP_SE_ARENA_MAX;
+
+    new_arena = realloc(bdss->arena, new_alloc);
+    if (!new_arena) return FALSE;
+
+    bdss->arena = new_arena;
+    bdss->arena_alloc = new_alloc;
+  }
+
+  memcpy(&bdss->arena[bdss->arena_used], val, len);
+  bdss->arena[bdss->arena_used + len] = '\0';
+  *off = bdss->arena_used;
+  bdss->arena_used = needed;
+
+  return TRUE;
+}
+
+static struct bmp_dump_se_rec *bmp_dump_se_slot(struct bmp_dump_se_store *bdss)
+{
+  u_int32_t max_events = config.bmp_dump_max_events;
+
+  if (!max_events) max_events = BMP_DUMP_MAX_EVENTS_DEFAULT;
+
+  /* the ring can only have grown while not wrapped, ie. head is 0 */
+  if (bdss->count == bdss->alloc && bdss->alloc < max_events) {
+    u_int32_t new_alloc = (bdss->alloc ? (bdss->alloc * 2) : 64);
+    struct bmp_dump_se_rec *new_ring;
+
+    if (new_alloc > max_events) new_alloc = max_events;
+
+    new_ring = realloc(bdss->ring, new_alloc * sizeof(struct bmp_dump_se_rec));
+    if (new_ring) {
+      bdss->ring = new_ring;
+      bdss->alloc = new_alloc;
+    }
+  }
+
+  if (!bdss->alloc) return NULL;
+
+  if (bdss->count < bdss->alloc) {
+    bdss->count++;
+    return &bdss->ring[(bdss->head + bdss->count - 1) % bdss->alloc];
+  }
+
+  /* retention bound reached: the oldest event makes room */
+  bdss->head = ((bdss->head + 1) % bdss->alloc);
+  bdss->dropped++;
+
+  return &bdss->ring[(bdss->head + bdss->count - 1) % bdss->alloc];
+}
+
+void bmp_dump_se_append(struct bgp_peer *peer, struct bmp_data *bdata, void *extra, int log_type)
 {
   struct bgp_misc_structs *bms = bgp_select_misc_db(FUNC_TYPE_BMP);
-  struct bmp_dump_se_ll *se_ll;
-  struct bmp_dump_se_ll_elem *se_ll_elem;
+  struct bmp_dump_se_store *bdss;
+  struct bmp_dump_se_rec *rec;
 
   if (!peer) return;
 
   assert(peer->bmp_se);
+  bdss = (struct bmp_dump_se_store *) peer->bmp_se;
 
-  se_ll_elem = malloc(sizeof(struct bmp_dump_se_ll_elem));
-  if (!se_ll_elem) {
-    Log(LOG_ERR, "ERROR ( %s/%s ): Unable to malloc() se_ll_elem structure. Terminating thread.\n", config.name, bms->log_str);
+  rec = bmp_dump_se_slot(bdss);
+  if (!rec) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): Unable to malloc() bmp_se ring. Terminating thread.\n", config.name, bms->log_str);
     exit_all(1);
   }
 
-  memset(se_ll_elem, 0, sizeof(struct bmp_dump_se_ll_elem));
+  memset(rec, 0, sizeof(struct bmp_dump_se_rec));
+
+  if (bdata) {
+    rec->tstamp_sec = bdata->tstamp.tv_sec;
+    rec->tstamp_usec = bdata->tstamp.tv_usec;
+    rec->peer_asn = bdata->peer_asn;
+    rec->family = bdata->family;
+    rec->peer_type = bdata->peer_type;
+    bmp_dump_se_addr_encode(rec->peer_ip, &rec->peer_ip_family, &bdata->peer_ip);
+    bmp_dump_se_addr_encode(rec->bgp_id, &rec->bgp_id_family, &bdata->bgp_id);
+  }
 
-  if (bdata) memcpy(&se_ll_elem->rec.bdata, bdata, sizeof(struct bmp_data));
   if (extra && log_type) {
     switch (log_type) {
     case BMP_LOG_TYPE_STATS:
-      memcpy(&se_ll_elem->rec.se.stats, extra, sizeof(struct bmp_log_stats));
+      {
+	struct bmp_log_stats *blstats = extra;
+
+	rec->se.stats.cnt_type = blstats->cnt_type;
+	rec->se.stats.cnt_data = blstats->cnt_data;
+	rec->se.stats.got_data = blstats->got_data;
+      }
       break;
     case BMP_LOG_TYPE_INIT:
-      memcpy(&se_ll_elem->rec.se.init, extra, sizeof(struct bmp_log_init));
+      {
+	struct bmp_log_init *blinit = extra;
+
+	rec->se.tlv.type = blinit->type;
+	rec->se.tlv.len = blinit->len;
+	if (blinit->val) rec->se.tlv.got_val = bmp_dump_se_arena_put(bdss, blinit->val, blinit->len, &rec->se.tlv.val_off);
+      }
       break;
     case BMP_LOG_TYPE_TERM:
-      memcpy(&se_ll_elem->rec.se.term, extra, sizeof(struct bmp_log_term));
+      {
+	struct bmp_log_term *blterm = extra;
+
+	rec->se.tlv.type = blterm->type;
+	rec->se.tlv.len = blterm->len;
+	rec->se.tlv.reas_type = blterm->reas_type;
+	if (blterm->val) rec->se.tlv.got_val = bmp_dump_se_arena_put(bdss, blterm->val, blterm->len, &rec->se.tlv.val_off);
+      }
       break;
     case BMP_LOG_TYPE_PEER_UP:
-      memcpy(&se_ll_elem->rec.se.peer_up, extra, sizeof(struct bmp_log_peer_up));
+      {
+	struct bmp_log_peer_up *blpu = extra;
+
+	bmp_dump_se_addr_encode(rec->se.peer_up.local_ip, &rec->se.peer_up.local_ip_family, &blpu->local_ip);
+	rec->se.peer_up.loc_port = blpu->loc_port;
+	rec->se.peer_up.rem_port = blpu->rem_port;
+      }
       break;
     case BMP_LOG_TYPE_PEER_DOWN:
-      memcpy(&se_ll_elem->rec.se.peer_down, extra, sizeof(struct bmp_log_peer_down));
+      {
+	struct bmp_log_peer_down *blpd = extra;
+
+	rec->se.peer_down.reason = blpd->reason;
+	rec->se.peer_down.loc_code = blpd->loc_code;
+      }
       break;
     default:
       break;
     }
   }
 
-  se_ll_elem->rec.seq = bms->log_seq;;
-  se_ll_elem->rec.se_type = log_type;
-  se_ll_elem->next = NULL; /* pedantic */
+  rec->seq = bms->log_seq;
+  rec->se_type = log_type;
+}
 
-  se_ll = (struct bmp_dump_se_ll *) peer->bmp_se;
+/* decodes the idx-th oldest event of the store */
+void bmp_dump_se_get(struct bmp_dump_se_store *bdss, u_int32_t idx, struct bmp_dump_se *bdse)
+{
+  struct bmp_dump_se_rec *rec;
 
-  /* append to an empty ll */
-  if (!se_ll->start) {
-    assert(!se_ll->last);
+  memset(bdse, 0, sizeof(struct bmp_dump_se));
 
-    se_ll->start = se_ll_elem;
-    se_ll->last = se_ll_elem;
-  }
-  /* append to an existing ll */
-  else {
-    assert(se_ll->last);
-
-    se_ll->last->next = se_ll_elem;
-    se_ll->last = se_ll_elem;
-  }
-}
+  if (!bdss || idx >= bdss->count) return;
 
-void bmp_dump_se_ll_destroy(struct bmp_dump_se_ll *bdsell)
-{
-  struct bmp_dump_se_ll_elem *se_ll_elem, *se_ll_elem_next;
+  rec = &bdss->ring[(bdss->head + idx) % bdss->alloc];
 
-  if (!bdsell) return;
+  bdse->bdata.family = rec->family;
+  bdse->bdata.peer_asn = rec->peer_asn;
+  bdse->bdata.peer_type = rec->peer_type;
+  bdse->bdata.tstamp.tv_sec = rec->tstamp_sec;
+  bdse->bdata.tstamp.tv_usec = rec->tstamp_usec;
+  bmp_dump_se_addr_decode(&bdse->bdata.peer_ip, rec->peer_ip, rec->peer_ip_family);
+  bmp_dump_se_addr_decode(&bdse->bdata.bgp_id, rec->bgp_id, rec->bgp_id_family);
 
-  if (!bdsell->start) return;
+  bdse->seq = rec->seq;
+  bdse->se_type = rec->se_type;
 
-  assert(bdsell->last);
-  for (se_ll_elem = bdsell->start; se_ll_elem; se_ll_elem = se_ll_elem_next) {
-    se_ll_elem_next = se_ll_elem->next;
-    free(se_ll_elem);
+  switch (rec->se_type) {
+  case BMP_LOG_TYPE_STATS:
+    bdse->se.stats.cnt_type = rec->se.stats.cnt_type;
+    bdse->se.stats.cnt_data = rec->se.stats.cnt_data;
+    bdse->se.stats.got_data = rec->se.stats.got_data;
+    break;
+  case BMP_LOG_TYPE_INIT:
+    bdse->se.init.type = rec->se.tlv.type;
+    bdse->se.init.len = rec->se.tlv.len;
+    if (rec->se.tlv.got_val) bdse->se.init.val = &bdss->arena[rec->se.tlv.val_off];
+    break;
+  case BMP_LOG_TYPE_TERM:
+    bdse->se.term.type = rec->se.tlv.type;
+    bdse->se.term.len = rec->se.tlv.len;
+    bdse->se.term.reas_type = rec->se.tlv.reas_type;
+    if (rec->se.tlv.got_val) bdse->se.term.val = &bdss->arena[rec->se.tlv.val_off];
+    break;
+  case BMP_LOG_TYPE_PEER_UP:
+    bmp_dump_se_addr_decode(&bdse->se.peer_up.local_ip, rec->se.peer_up.local_ip, rec->se.peer_up.local_ip_family);
+    bdse->se.peer_up.loc_port = rec->se.peer_up.loc_port;
+    bdse->se.peer_up.rem_port = rec->se.peer_up.rem_port;
+    break;
+  case BMP_LOG_TYPE_PEER_DOWN:
+    bdse->se.peer_down.reason = rec->se.peer_down.reason;
+    bdse->se.peer_down.loc_code = rec->se.peer_down.loc_code;
+    break;
+  default:
+    break;
   }
+}
 
-  bdsell->start = NULL;
-  bdsell->last = NULL;
+void bmp_dump_se_reset(struct bmp_dump_se_store *bdss)
+{
+  if (!bdss) return;
+
+  bdss->head = 0;
+  bdss->count = 0;
+  bdss->dropped = 0;
+  bdss->arena_used = 0;
 }
 
 void bmp_handle_dump_event()
@@ -494,7 +647,7 @@ void bmp_handle_dump_event()
 
   struct bgp_peer *peer, *saved_peer;
   struct bmp_peer *bmpp, *saved_bmpp;
-  struct bmp_dump_se_ll *bdsell;
+  struct bmp_dump_se_store *bdss;
   struct bgp_peer_log peer_log;      
 
   /* pre-flight check */
@@ -537,7 +690,7 @@ void bmp_handle_dump_event()
         peer = &bmp_peers[peers_idx].self;
         bmpp = &bmp_peers[peers_idx];
         peer->log = &peer_log; /* abusing struct bgp_peer a bit, but we are in a child */
-	bdsell = peer->bmp_se;
+	bdss = peer->bmp_se;
 
         if (config.bmp_dump_file) bgp_peer_log_dynname(current_filename, SRVBUFLEN, config.bmp_dump_file, peer);
         if (config.bmp_dump_amqp_routing_key) bgp_peer_log_dynname(current_filename, SRVBUFLEN, config.bmp_dump_amqp_routing_key, peer);
@@ -624,26 +777,33 @@ void bmp_handle_dump_event()
 	  }
 	}
 
-	if (bdsell && bdsell->start) {
-	  struct bmp_dump_se_ll_elem *se_ll_elem;
+	if (bdss && bdss->count) {
+	  struct bmp_dump_se bdse;
 	  char event_type[] = "dump";
+	  u_int32_t idx;
+
+	  if (bdss->dropped)
+	    Log(LOG_WARNING, "WARN ( %s/%s ): [%s] %u BMP events dropped (reached bmp_dump_max_events)\n",
+		config.name, bms->log_str, peer->addr_str, bdss->dropped);
+
+	  for (idx = 0; idx < bdss->count; idx++) {
+	    bmp_dump_se_get(bdss, idx, &bdse);
 
-	  for (se_ll_elem = bdsell->start; se_ll_elem; se_ll_elem = se_ll_elem->next) {
-	    switch (se_ll_elem->rec.se_type) {
+	    switch (bdse.se_type) {
 	    case BMP_LOG_TYPE_STATS:
-	      bmp_log_msg(peer, &se_ll_elem->rec.bdata, &se_ll_elem->rec.se.stats, se_ll_elem->rec.seq, event_type, config.bmp_dump_output, BMP_LOG_TYPE_STATS);
+	      bmp_log_msg(peer, &bdse.bdata, &bdse.se.stats, bdse.seq, event_type, config.bmp_dump_output, BMP_LOG_TYPE_STATS);
 	      break;
 	    case BMP_LOG_TYPE_INIT:
-	      bmp_log_msg(peer, &se_ll_elem->rec.bdata, &se_ll_elem->rec.se.init, se_ll_elem->rec.seq, event_type, config.bmp_dump_output, BMP_LOG_TYPE_INIT);
+	      bmp_log_msg(peer, &bdse.bdata, &bdse.se.init, bdse.seq, event_type, config.bmp_dump_output, BMP_LOG_TYPE_INIT);
 	      break;
 	    case BMP_LOG_TYPE_TERM:
-	      bmp_log_msg(peer, &se_ll_elem->rec.bdata, &se_ll_elem->rec.se.term, se_ll_elem->rec.seq, event_type, config.bmp_dump_output, BMP_LOG_TYPE_TERM);
+	      bmp_log_msg(peer, &bdse.bdata, &bdse.se.term, bdse.seq, event_type, config.bmp_dump_output, BMP_LOG_TYPE_TERM);
 	      break;
 	    case BMP_LOG_TYPE_PEER_UP:
-	      bmp_log_msg(peer, &se_ll_elem->rec.bdata, &se_ll_elem->rec.se.peer_up, se_ll_elem->rec.seq, event_type, config.bmp_dump_output, BMP_LOG_TYPE_PEER_UP);
+	      bmp_log_msg(peer, &bdse.bdata, &bdse.se.peer_up, bdse.seq, event_type, config.bmp_dump_output, BMP_LOG_TYPE_PEER_UP);
 	      break;
 	    case BMP_LOG_TYPE_PEER_DOWN:
-	      bmp_log_msg(peer, &se_ll_elem->rec.bdata, &se_ll_elem->rec.se.peer_down, se_ll_elem->rec.seq, event_type, config.bmp_dump_output, BMP_LOG_TYPE_PEER_DOWN);
+	      bmp_log_msg(peer, &bdse.bdata, &bdse.se.peer_down, bdse.seq, event_type, config.bmp_dump_output, BMP_LOG_TYPE_PEER_DOWN);
 	      break;
 	    default:
 	      break;
@@ -685,14 +845,14 @@ void bmp_handle_dump_event()
 		config.name, bms->log_str, strerror(errno));
     }
 
-    /* destroy bmp_se linked-list content after dump event */
+    /* reset bmp_se stores after dump event; memory is kept for the next round */
     for (peer = NULL, peers_idx = 0; peers_idx < config.nfacctd_bmp_max_peers; peers_idx++) {
       if (bmp_peers[peers_idx].self.fd) {
         peer = &bmp_peers[peers_idx].self;
         bmpp = &bmp_peers[peers_idx];
-        bdsell = peer->bmp_se;
+        bdss = peer->bmp_se;
 
-	if (bdsell && bdsell->start) bmp_dump_se_ll_destroy(bdsell);
+	bmp_dump_se_reset(bdss);
       }
     }
 
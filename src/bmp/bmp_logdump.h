@@ -30,6 +30,9 @@
 #define BMP_LOG_TYPE_PEER_DOWN	5
 #define BMP_LOG_TYPE_ROUTE	6
 
+#define BMP_DUMP_MAX_EVENTS_DEFAULT	65536
+#define BMP_DUMP_SE_ARENA_MAX		(1024 * 1024)
+
 struct bmp_log_stats {
   u_int16_t cnt_type;
   u_int64_t cnt_data;
@@ -73,14 +76,65 @@ struct bmp_dump_se {
   } se;
 };
 
-struct bmp_dump_se_ll_elem {
-  struct bmp_dump_se rec; 
-  struct bmp_dump_se_ll_elem *next;
+/*
+   Compact encoding of a struct bmp_dump_se as kept, per peer, until the
+   next dump: addresses are stored raw and TLV values (init, term) are
+   copied, NUL-terminated, into the peer arena rather than pointed to.
+*/
+struct bmp_dump_se_rec {
+  u_int64_t seq;
+  u_int32_t tstamp_sec;
+  u_int32_t tstamp_usec;
+  u_int32_t peer_asn;
+  u_int8_t peer_ip[16];
+  u_int8_t bgp_id[16];
+  u_int8_t peer_ip_family;
+  u_int8_t bgp_id_family;
+  u_int8_t family;
+  u_int8_t peer_type;
+  u_int8_t se_type;
+  union {
+    struct {
+      u_int64_t cnt_data;
+      u_int16_t cnt_type;
+      u_int8_t got_data;
+    } stats;
+    struct {
+      u_int32_t val_off;
+      u_int16_t type;
+      u_int16_t len;
+      u_int16_t reas_type;
+      u_int8_t got_val;
+    } tlv; /* init, term */
+    struct {
+      u_int8_t local_ip[16];
+      u_int8_t local_ip_family;
+      u_int16_t loc_port;
+      u_int16_t rem_port;
+    } peer_up;
+    struct {
+      u_int16_t loc_code;
+      u_char reason;
+    } peer_down;
+  } se;
 };
 
-struct bmp_dump_se_ll {
-  struct bmp_dump_se_ll_elem *start;
-  struct bmp_dump_se_ll_elem *last;
+/*
+   Events are kept in a ring of records, grown up to bmp_dump_max_events
+   and then overwriting the oldest ones; both the ring and the arena are
+   retained across dumps, so that resetting the store is O(1) and steady
+   state appends do not allocate.
+*/
+struct bmp_dump_se_store {
+  struct bmp_dump_se_rec *ring;
+  u_int32_t alloc;
+  u_int32_t head;	/* oldest event */
+  u_int32_t count;
+  u_int32_t dropped;	/* overwritten since last reset */
+
+  char *arena;
+  u_int32_t arena_alloc;
+  u_int32_t arena_used;
 };
 
 /* prototypes */
@@ -101,8 +155,9 @@ EXT int bmp_log_msg_term(struct bgp_peer *, struct bmp_data *, struct bmp_log_te
 EXT int bmp_log_msg_peer_up(struct bgp_peer *, struct bmp_data *, struct bmp_log_peer_up *, char *, int, void *);
 EXT int bmp_log_msg_peer_down(struct bgp_peer *, struct bmp_data *, struct bmp_log_peer_down *, char *, int, void *);
 
-EXT void bmp_dump_se_ll_append(struct bgp_peer *, struct bmp_data *, void *, int);
-EXT void bmp_dump_se_ll_destroy(struct bmp_dump_se_ll *);
+EXT void bmp_dump_se_append(struct bgp_peer *, struct bmp_data *, void *, int);
+EXT void bmp_dump_se_get(struct bmp_dump_se_store *, u_int32_t, struct bmp_dump_se *);
+EXT void bmp_dump_se_reset(struct bmp_dump_se_store *);
 
 EXT void bmp_handle_dump_event();
 EXT void bmp_daemon_msglog_init_amqp_host();
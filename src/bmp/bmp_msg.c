@@ -67,13 +67,17 @@ u_int32_t bmp_process_packet(char *bmp_packet, u_int32_t len, struct bmp_peer *b
     }
 
     bmp_common_hdr_get_len(bch, &msg_len);
-    if (pkt_remaining_len < msg_len) return msg_start_len;
+    if (msg_start_len < msg_len) return msg_start_len;
 
     if (bch->type <= BMP_MSG_TYPE_MAX) {
       Log(LOG_DEBUG, "DEBUG ( %s/%s ): [%s] [common] type: %s (%u)\n",
 	  config.name, bms->log_str, peer->addr_str, bmp_msg_types[bch->type], bch->type);
     }
 
+    /* route monitoring takes the RIB lock by itself, only once the BGP UPDATE
+       is decoded; other messages are rare enough to be handled under it */
+    if (bch->type != BMP_MSG_ROUTE_MONITOR) bmp_rib_lock();
+
     switch (bch->type) {
     case BMP_MSG_ROUTE_MONITOR:
       bmp_process_msg_route_monitor(&bmp_packet_ptr, &pkt_remaining_len, bmpp);
@@ -102,6 +106,8 @@ u_int32_t bmp_process_packet(char *bmp_packet, u_int32_t len, struct bmp_peer *b
       break;
     }
 
+    if (bch->type != BMP_MSG_ROUTE_MONITOR) bmp_rib_unlock();
+
     if ((msg_start_len - pkt_remaining_len) < msg_len) {
       /* let's jump forward: we may have been unable to parse some (sub-)element */
       bmp_jump_offset(&bmp_packet_ptr, &pkt_remaining_len, (msg_len - (msg_start_len - pkt_remaining_len)));
@@ -138,7 +144,7 @@ void bmp_process_msg_init(char **bmp_packet, u_int32_t *len, u_int32_t bmp_hdr_l
   }
 
   if (bms->dump_backend_methods)
-    bmp_dump_se_ll_append(peer, &bdata, NULL, BMP_LOG_TYPE_INIT);
+    bmp_dump_se_append(peer, &bdata, NULL, BMP_LOG_TYPE_INIT);
 
   if (bms->msglog_backend_methods || bms->dump_backend_methods)
     bgp_peer_log_seq_increment(&bms->log_seq);
@@ -172,7 +178,7 @@ void bmp_process_msg_init(char **bmp_packet, u_int32_t *len, u_int32_t bmp_hdr_l
       }
 
       if (bms->dump_backend_methods)
-        bmp_dump_se_ll_append(peer, &bdata, &blinit, BMP_LOG_TYPE_INIT);
+        bmp_dump_se_append(peer, &bdata, &blinit, BMP_LOG_TYPE_INIT);
 
       if (bms->msglog_backend_methods || bms->dump_backend_methods)
         bgp_peer_log_seq_increment(&bms->log_seq);
@@ -209,7 +215,7 @@ void bmp_process_msg_term(char **bmp_packet, u_int32_t *len, u_int32_t bmp_hdr_l
   }
 
   if (bms->dump_backend_methods)
-    bmp_dump_se_ll_append(peer, &bdata, NULL, BMP_LOG_TYPE_TERM);
+    bmp_dump_se_append(peer, &bdata, NULL, BMP_LOG_TYPE_TERM);
 
   if (bms->msglog_backend_methods || bms->dump_backend_methods)
     bgp_peer_log_seq_increment(&bms->log_seq);
@@ -246,7 +252,7 @@ void bmp_process_msg_term(char **bmp_packet, u_int32_t *len, u_int32_t bmp_hdr_l
       }
 
       if (bms->dump_backend_methods)
-        bmp_dump_se_ll_append(peer, &bdata, &blterm, BMP_LOG_TYPE_TERM);
+        bmp_dump_se_append(peer, &bdata, &blterm, BMP_LOG_TYPE_TERM);
 
       if (bms->msglog_backend_methods || bms->dump_backend_methods)
         bgp_peer_log_seq_increment(&bms->log_seq);
@@ -330,7 +336,7 @@ void bmp_process_msg_peer_up(char **bmp_packet, u_int32_t *len, struct bmp_peer
       }
 
       if (bms->dump_backend_methods)
-        bmp_dump_se_ll_append(peer, &bdata, &blpu, BMP_LOG_TYPE_PEER_UP);
+        bmp_dump_se_append(peer, &bdata, &blpu, BMP_LOG_TYPE_PEER_UP);
 
       if (bms->msglog_backend_methods || bms->dump_backend_methods)
         bgp_peer_log_seq_increment(&bms->log_seq);
@@ -392,7 +398,7 @@ void bmp_process_msg_peer_down(char **bmp_packet, u_int32_t *len, struct bmp_pee
       }
 
       if (bms->dump_backend_methods)
-        bmp_dump_se_ll_append(peer, &bdata, &blpd, BMP_LOG_TYPE_PEER_DOWN);
+        bmp_dump_se_append(peer, &bdata, &blpd, BMP_LOG_TYPE_PEER_DOWN);
 
       if (bms->msglog_backend_methods || bms->dump_backend_methods)
         bgp_peer_log_seq_increment(&bms->log_seq);
@@ -432,6 +438,7 @@ void bmp_process_msg_route_monitor(char **bmp_packet, u_int32_t *len, struct bmp
   struct bgp_peer *peer, *bmpp_bgp_peer;
   struct bmp_data bdata;
   struct bmp_peer_hdr *bph;
+  struct bgp_update_msg bum;
   char tstamp_str[SRVBUFLEN], peer_ip[INET6_ADDRSTRLEN];
   int bgp_update_len;
   void *ret;
@@ -443,6 +450,9 @@ void bmp_process_msg_route_monitor(char **bmp_packet, u_int32_t *len, struct bmp
 
   if (!bms) return;
 
+  /* peer_ip is looked up with memcmp(): no stale bytes around the address */
+  memset(&bdata, 0, sizeof(bdata));
+
   if (!(bph = (struct bmp_peer_hdr *) bmp_get_and_check_length(bmp_packet, len, sizeof(struct bmp_peer_hdr)))) {
     Log(LOG_INFO, "INFO ( %s/%s ): [%s] [route] packet discarded: failed bmp_get_and_check_length() BMP peer hdr\n",
         config.name, bms->log_str, peer->addr_str);
@@ -463,16 +473,27 @@ void bmp_process_msg_route_monitor(char **bmp_packet, u_int32_t *len, struct bmp
     compose_timestamp(tstamp_str, SRVBUFLEN, &bdata.tstamp, TRUE, config.timestamps_since_epoch);
     addr_to_str(peer_ip, &bdata.peer_ip);
 
+    /* BGP peers of a BMP router are only added and removed by peer up/down
+       messages of the same router, handled in order by the same thread */
     ret = pm_tfind(&bdata.peer_ip, &bmpp->bgp_peers, bgp_peer_host_addr_cmp);
 
     if (ret) {
-      char peer_str[] = "peer_ip", *saved_peer_str = bms->peer_str;
+      char peer_str[] = "peer_ip", *saved_peer_str;
 
       bmpp_bgp_peer = (*(struct bgp_peer **) ret);
 
+      if (bgp_update_msg_decode(bmpp_bgp_peer, (*bmp_packet), (*len), &bum) == ERR) {
+	Log(LOG_INFO, "INFO ( %s/%s ): [%s] [route] packet discarded: malformed BGP UPDATE for peer %s\n",
+		config.name, bms->log_str, peer->addr_str, peer_ip);
+	return;
+      }
+
+      bmp_rib_lock();
+      saved_peer_str = bms->peer_str;
       bms->peer_str = peer_str;
-      bgp_update_len = bgp_parse_update_msg(bmpp_bgp_peer, (*bmp_packet)); 
+      bgp_update_len = bgp_update_msg_process(bmpp_bgp_peer, &bum);
       bms->peer_str = saved_peer_str;
+      bmp_rib_unlock();
 
       bmp_get_and_check_length(bmp_packet, len, bgp_update_len);
     }
@@ -603,7 +624,7 @@ void bmp_process_msg_stats(char **bmp_packet, u_int32_t *len, struct bmp_peer *b
         } 
 
         if (bms->dump_backend_methods)
-          bmp_dump_se_ll_append(peer, &bdata, &blstats, BMP_LOG_TYPE_STATS);
+          bmp_dump_se_append(peer, &bdata, &blstats, BMP_LOG_TYPE_STATS);
 
         if (bms->msglog_backend_methods || bms->dump_backend_methods)
           bgp_peer_log_seq_increment(&bms->log_seq);
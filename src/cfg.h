@@ -83,6 +83,11 @@ struct configuration {
   char *type;
   int type_id;
   int pmacctd_nonroot;
+  int pmacctd_tpacket_v3;
+  u_int32_t pmacctd_tpacket_block_size;
+  u_int32_t pmacctd_tpacket_block_num;
+  int pmacctd_fanout_group;
+  int pmacctd_fanout_type;
   char *proc_name;
   int proc_priority;
   int sock;
@@ -153,6 +158,8 @@ struct configuration {
   char *sql_preprocess;
   int sql_preprocess_type;
   int sql_multi_values;
+  int sql_prepared_statements;
+  int sql_parallel_writers;
   int sql_aggressive_classification;
   char *sql_locking_style;
   int sql_use_copy;
@@ -161,8 +168,12 @@ struct configuration {
   int timestamps_since_epoch;
   int mongo_insert_batch;
   int message_broker_output;
+  int message_broker_mv_format;
+  int message_broker_mv_bytes;
+  int message_broker_mv_compress;
   int avro_buffer_size;
   char *avro_schema_output_file;
+  int avro_container;
   char *amqp_exchange_type;
   int amqp_persistent_msg;
   u_int32_t amqp_frame_max;
@@ -178,10 +189,14 @@ struct configuration {
   char *kafka_avro_schema_topic;
   int kafka_avro_schema_refresh_time;
   char *kafka_config_file;
+  int kafka_async_producer;
+  u_int64_t kafka_inflight_max;
   int print_cache_entries;
   int print_markers;
   int print_output;
   int print_output_file_append;
+  int parquet_row_group_size;
+  int parquet_compression;
   char *print_output_lock_file;
   char *print_output_separator;
   char *print_output_file;
@@ -220,6 +235,7 @@ struct configuration {
   int sfacctd_counter_kafka_retry;
   char *sfacctd_counter_kafka_config_file;
   int nfacctd_disable_checks;
+  int nfacctd_stats_refresh_time;
   int telemetry_daemon;
   int telemetry_sock;
   int telemetry_port_tcp;
@@ -227,6 +243,8 @@ struct configuration {
   char *telemetry_ip;
   char *telemetry_decoder;
   int telemetry_max_peers;
+  int telemetry_threads;
+  int telemetry_queue_size;
   int telemetry_udp_timeout;
   char *telemetry_allow_file;
   int telemetry_pipe_size;
@@ -370,6 +388,8 @@ struct configuration {
   int nfacctd_bmp_port;
   int nfacctd_bmp_pipe_size;
   int nfacctd_bmp_max_peers;
+  int nfacctd_bmp_threads;
+  int nfacctd_bmp_queue_size;
   char *nfacctd_bmp_allow_file;
   int nfacctd_bmp_ipprec;
   int nfacctd_bmp_batch;
@@ -405,6 +425,7 @@ struct configuration {
   char *bmp_dump_file;
   char *bmp_dump_latest_file;
   int bmp_dump_refresh_time;
+  int bmp_dump_max_events;
   char *bmp_dump_amqp_host;
   char *bmp_dump_amqp_vhost;
   char *bmp_dump_amqp_user;
@@ -444,6 +465,8 @@ struct configuration {
 #if defined WITH_GEOIPV2
   MMDB_s geoipv2_db;
 #endif
+  int geoipv2_lpm;
+  int geoipv2_lpm_cache_entries;
   int promisc; /* pcap_open_live() promisc parameter */
   char *clbuf; /* pcap filter */
   char *pcap_savefile;
@@ -453,11 +476,19 @@ struct configuration {
   int num_memory_pools;
   int memory_pool_size;
   int buckets;
+  int imt_history_bins;
+  int imt_history_bin_time;
+  int imt_index;
+  int imt_query_threads;
   int daemon;
   int active_plugins;
   char *logfile; 
   FILE *logfile_fd; 
+  int logfile_async;
+  int logfile_async_ratelimit;
   char *pidfile; 
+  char *stats_shm_file;
+  int stats_shm_refresh_time;
   int networks_mask;
   char *networks_file;
   int networks_file_filter;
@@ -516,7 +547,10 @@ struct configuration {
   int tee_pipe_size;
   int tee_dissect_send_full_pkt;
   int uacctd_group;
+  int uacctd_groups[MAX_NFLOG_GROUPS];
+  int uacctd_groups_num;
   int uacctd_nl_size;
+  int uacctd_nl_batch;
   int uacctd_threshold;
   char *tunnel0;
   char *pkt_len_distrib_bins_str;
@@ -136,6 +136,44 @@ int cfg_key_logfile(char *filename, char *name, char *value_ptr)
   return changes;
 }
 
+int cfg_key_logfile_async(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = parse_truefalse(value_ptr);
+  if (value < 0) return ERR;
+
+#if !defined ENABLE_THREADS
+  if (value) {
+    Log(LOG_WARNING, "WARN: [%s] 'logfile_async' requires threads support. Ignored.\n", filename);
+    value = FALSE;
+  }
+#endif
+
+  for (; list; list = list->next, changes++) list->cfg.logfile_async = value;
+  if (name) Log(LOG_WARNING, "WARN: [%s] plugin name not supported for key 'logfile_async'. Globalized.\n", filename);
+
+  return changes;
+}
+
+int cfg_key_logfile_async_ratelimit(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = atoi(value_ptr);
+  if (value < 0) {
+    Log(LOG_ERR, "WARN: [%s] 'logfile_async_ratelimit' has to be >= 0.\n", filename);
+    return ERR;
+  }
+
+  for (; list; list = list->next, changes++) list->cfg.logfile_async_ratelimit = value;
+  if (name) Log(LOG_WARNING, "WARN: [%s] plugin name not supported for key 'logfile_async_ratelimit'. Globalized.\n", filename);
+
+  return changes;
+}
+
 int cfg_key_pidfile(char *filename, char *name, char *value_ptr)
 {
   struct plugins_list_entry *list = plugins_list;
@@ -147,6 +185,34 @@ int cfg_key_pidfile(char *filename, char *name, char *value_ptr)
   return changes;
 }
 
+int cfg_key_stats_shm_file(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int changes = 0;
+
+  for (; list; list = list->next, changes++) list->cfg.stats_shm_file = value_ptr;
+  if (name) Log(LOG_WARNING, "WARN: [%s] plugin name not supported for key 'stats_shm_file'. Globalized.\n", filename);
+
+  return changes;
+}
+
+int cfg_key_stats_shm_refresh_time(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = atoi(value_ptr);
+  if (value <= 0) {
+    Log(LOG_ERR, "WARN: [%s] 'stats_shm_refresh_time' has to be > 0.\n", filename);
+    return ERR;
+  }
+
+  for (; list; list = list->next, changes++) list->cfg.stats_shm_refresh_time = value;
+  if (name) Log(LOG_WARNING, "WARN: [%s] plugin name not supported for key 'stats_shm_refresh_time'. Globalized.\n", filename);
+
+  return changes;
+}
+
 int cfg_key_daemonize(char *filename, char *name, char *value_ptr)
 {
   struct plugins_list_entry *list = plugins_list;
@@ -697,6 +763,103 @@ int cfg_key_imt_mem_pools_size(char *filename, char *name, char *value_ptr)
   return changes;
 }
 
+int cfg_key_imt_history_bins(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = atoi(value_ptr);
+  if (value < 0 || value > MAX_IMT_HISTORY_BINS) {
+    Log(LOG_WARNING, "WARN: [%s] 'imt_history_bins' has to be in the range 0-%u.\n", filename, MAX_IMT_HISTORY_BINS);
+    return ERR;
+  }
+
+  if (!name) for (; list; list = list->next, changes++) list->cfg.imt_history_bins = value;
+  else {
+    for (; list; list = list->next) {
+      if (!strcmp(name, list->name)) {
+        list->cfg.imt_history_bins = value;
+        changes++;
+        break;
+      }
+    }
+  }
+
+  return changes;
+}
+
+int cfg_key_imt_history_bin_time(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = atoi(value_ptr);
+  if (value <= 0) {
+    Log(LOG_WARNING, "WARN: [%s] 'imt_history_bin_time' has to be > 0.\n", filename);
+    return ERR;
+  }
+
+  if (!name) for (; list; list = list->next, changes++) list->cfg.imt_history_bin_time = value;
+  else {
+    for (; list; list = list->next) {
+      if (!strcmp(name, list->name)) {
+        list->cfg.imt_history_bin_time = value;
+        changes++;
+        break;
+      }
+    }
+  }
+
+  return changes;
+}
+
+int cfg_key_imt_index(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = parse_truefalse(value_ptr);
+  if (value < 0) return ERR;
+
+  if (!name) for (; list; list = list->next, changes++) list->cfg.imt_index = value;
+  else {
+    for (; list; list = list->next) {
+      if (!strcmp(name, list->name)) {
+        list->cfg.imt_index = value;
+        changes++;
+        break;
+      }
+    }
+  }
+
+  return changes;
+}
+
+int cfg_key_imt_query_threads(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = atoi(value_ptr);
+  if (value < 1 || value > MAX_IMT_QUERY_THREADS) {
+    Log(LOG_WARNING, "WARN: [%s] 'imt_query_threads' has to be in the range 1-%u.\n", filename, MAX_IMT_QUERY_THREADS);
+    return ERR;
+  }
+
+  if (!name) for (; list; list = list->next, changes++) list->cfg.imt_query_threads = value;
+  else {
+    for (; list; list = list->next) {
+      if (!strcmp(name, list->name)) {
+        list->cfg.imt_query_threads = value;
+        changes++;
+        break;
+      }
+    }
+  }
+
+  return changes;
+}
+
 int cfg_key_sql_db(char *filename, char *name, char *value_ptr)
 {
   struct plugins_list_entry *list = plugins_list;
@@ -1455,6 +1618,53 @@ int cfg_key_sql_multi_values(char *filename, char *name, char *value_ptr)
   return changes;
 }
 
+int cfg_key_sql_prepared_statements(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = parse_truefalse(value_ptr);
+  if (value < 0) return ERR;
+
+  if (!name) for (; list; list = list->next, changes++) list->cfg.sql_prepared_statements = value;
+  else {
+    for (; list; list = list->next) {
+      if (!strcmp(name, list->name)) {
+        list->cfg.sql_prepared_statements = value;
+        changes++;
+        break;
+      }
+    }
+  }
+
+  return changes;
+}
+
+int cfg_key_sql_parallel_writers(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = atoi(value_ptr);
+  if (value < 1 || value > MAX_SQL_PARALLEL_WRITERS) {
+    Log(LOG_WARNING, "WARN: [%s] invalid 'sql_parallel_writers' value. Allowed values are: 1 <= sql_parallel_writers <= %u.\n", filename, MAX_SQL_PARALLEL_WRITERS);
+    return ERR;
+  }
+
+  if (!name) for (; list; list = list->next, changes++) list->cfg.sql_parallel_writers = value;
+  else {
+    for (; list; list = list->next) {
+      if (!strcmp(name, list->name)) {
+        list->cfg.sql_parallel_writers = value;
+        changes++;
+        break;
+      }
+    }
+  }
+
+  return changes;
+}
+
 int cfg_key_mongo_insert_batch(char *filename, char *name, char *value_ptr)
 {
   struct plugins_list_entry *list = plugins_list;
@@ -1521,6 +1731,87 @@ int cfg_key_message_broker_output(char *filename, char *name, char *value_ptr)
   return changes;
 }
 
+int cfg_key_message_broker_mv_format(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  lower_string(value_ptr);
+  if (!strcmp(value_ptr, "array")) value = P_JSON_BATCH_ARRAY;
+  else if (!strcmp(value_ptr, "ndjson")) value = P_JSON_BATCH_NDJSON;
+  else {
+    Log(LOG_WARNING, "WARN: [%s] Invalid 'multi_values_format' value '%s'\n", filename, value_ptr);
+    return ERR;
+  }
+
+  if (!name) for (; list; list = list->next, changes++) list->cfg.message_broker_mv_format = value;
+  else {
+    for (; list; list = list->next) {
+      if (!strcmp(name, list->name)) {
+        list->cfg.message_broker_mv_format = value;
+        changes++;
+        break;
+      }
+    }
+  }
+
+  return changes;
+}
+
+int cfg_key_message_broker_mv_bytes(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = atoi(value_ptr);
+  if (value <= 0) {
+    Log(LOG_WARNING, "WARN: [%s] 'multi_values_bytes' has to be > 0.\n", filename);
+    return ERR;
+  }
+
+  if (!name) for (; list; list = list->next, changes++) list->cfg.message_broker_mv_bytes = value;
+  else {
+    for (; list; list = list->next) {
+      if (!strcmp(name, list->name)) {
+        list->cfg.message_broker_mv_bytes = value;
+        changes++;
+        break;
+      }
+    }
+  }
+
+  return changes;
+}
+
+int cfg_key_message_broker_mv_compress(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = parse_truefalse(value_ptr);
+  if (value < 0) return ERR;
+
+#if !defined (HAVE_ZLIB)
+  if (value) {
+    Log(LOG_WARNING, "WARN: [%s] 'multi_values_compress' requires zlib. Ignored.\n", filename);
+    return ERR;
+  }
+#endif
+
+  if (!name) for (; list; list = list->next, changes++) list->cfg.message_broker_mv_compress = value;
+  else {
+    for (; list; list = list->next) {
+      if (!strcmp(name, list->name)) {
+        list->cfg.message_broker_mv_compress = value;
+        changes++;
+        break;
+      }
+    }
+  }
+
+  return changes;
+}
+
 int cfg_key_avro_buffer_size(char *filename, char *name, char *value_ptr)
 {
   struct plugins_list_entry *list = plugins_list;
@@ -1566,6 +1857,28 @@ int cfg_key_avro_schema_output_file(char *filename, char *name, char *value_ptr)
   return changes;
 }
 
+int cfg_key_avro_container(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = parse_truefalse(value_ptr);
+  if (value < 0) return ERR;
+
+  if (!name) for (; list; list = list->next, changes++) list->cfg.avro_container = value;
+  else {
+    for (; list; list = list->next) {
+      if (!strcmp(name, list->name)) {
+        list->cfg.avro_container = value;
+        changes++;
+        break;
+      }
+    }
+  }
+
+  return changes;
+}
+
 int cfg_key_amqp_exchange_type(char *filename, char *name, char *value_ptr)
 {
   struct plugins_list_entry *list = plugins_list;
@@ -1850,11 +2163,52 @@ int cfg_key_kafka_avro_schema_refresh_time(char *filename, char *name, char *val
     return ERR;
   }
 
-  if (!name) for (; list; list = list->next, changes++) list->cfg.kafka_avro_schema_refresh_time = value;
+  if (!name) for (; list; list = list->next, changes++) list->cfg.kafka_avro_schema_refresh_time = value;
+  else {
+    for (; list; list = list->next) {
+      if (!strcmp(name, list->name)) {
+        list->cfg.kafka_avro_schema_refresh_time = value;
+        changes++;
+        break;
+      }
+    }
+  }
+
+  return changes;
+}
+
+int cfg_key_kafka_config_file(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int changes = 0;
+
+  if (!name) for (; list; list = list->next, changes++) list->cfg.kafka_config_file = value_ptr;
+  else {
+    for (; list; list = list->next) {
+      if (!strcmp(name, list->name)) {
+        list->cfg.kafka_config_file = value_ptr;
+        changes++;
+        break;
+      }
+    }
+  }
+
+  return changes;
+}
+
+int cfg_key_kafka_async_producer(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = parse_truefalse(value_ptr);
+  if (value < 0) return ERR;
+
+  if (!name) for (; list; list = list->next, changes++) list->cfg.kafka_async_producer = value;
   else {
     for (; list; list = list->next) {
       if (!strcmp(name, list->name)) {
-        list->cfg.kafka_avro_schema_refresh_time = value;
+        list->cfg.kafka_async_producer = value;
         changes++;
         break;
       }
@@ -1864,16 +2218,23 @@ int cfg_key_kafka_avro_schema_refresh_time(char *filename, char *name, char *val
   return changes;
 }
 
-int cfg_key_kafka_config_file(char *filename, char *name, char *value_ptr)
+int cfg_key_kafka_inflight_max(char *filename, char *name, char *value_ptr)
 {
   struct plugins_list_entry *list = plugins_list;
-  int changes = 0;
+  u_int64_t value, changes = 0;
+  char *endptr;
 
-  if (!name) for (; list; list = list->next, changes++) list->cfg.kafka_config_file = value_ptr;
+  value = strtoull(value_ptr, &endptr, 10);
+  if (!value) {
+    Log(LOG_WARNING, "WARN: [%s] 'kafka_inflight_max_bytes' has to be > 0.\n", filename);
+    return ERR;
+  }
+
+  if (!name) for (; list; list = list->next, changes++) list->cfg.kafka_inflight_max = value;
   else {
     for (; list; list = list->next) {
       if (!strcmp(name, list->name)) {
-        list->cfg.kafka_config_file = value_ptr;
+        list->cfg.kafka_inflight_max = value;
         changes++;
         break;
       }
@@ -1931,8 +2292,11 @@ int cfg_key_sql_use_copy(char *filename, char *name, char *value_ptr)
   struct plugins_list_entry *list = plugins_list;
   int value, changes = 0;
 
-  value = parse_truefalse(value_ptr);
-  if (value < 0) return ERR;
+  if (!strcmp(value_ptr, "binary")) value = SQL_COPY_BINARY;
+  else {
+    value = parse_truefalse(value_ptr);
+    if (value < 0) return ERR;
+  }
 
   if (!name) for (; list; list = list->next, changes++) list->cfg.sql_use_copy = value;
   else {
@@ -2740,6 +3104,8 @@ int cfg_key_print_output(char *filename, char *name, char *value_ptr)
     Log(LOG_WARNING, "WARN: [%s] print_output set to avro but will produce no output (missing --enable-avro).\n", filename);
 #endif
   }
+  else if (!strcmp(value_ptr, "parquet"))
+    value = PRINT_OUTPUT_PARQUET;
   else {
     Log(LOG_WARNING, "WARN: [%s] Invalid print output value '%s'\n", filename, value_ptr);
     return ERR;
@@ -2759,6 +3125,66 @@ int cfg_key_print_output(char *filename, char *name, char *value_ptr)
   return changes;
 }
 
+int cfg_key_parquet_row_group_size(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = atoi(value_ptr);
+  if (value <= 0) {
+    Log(LOG_ERR, "WARN: [%s] 'parquet_row_group_size' has to be > 0.\n", filename);
+    return ERR;
+  }
+
+  if (!name) for (; list; list = list->next, changes++) list->cfg.parquet_row_group_size = value;
+  else {
+    for (; list; list = list->next) {
+      if (!strcmp(name, list->name)) {
+        list->cfg.parquet_row_group_size = value;
+        changes++;
+        break;
+      }
+    }
+  }
+
+  return changes;
+}
+
+int cfg_key_parquet_compression(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  lower_string(value_ptr);
+  if (!strcmp(value_ptr, "none"))
+    value = PM_PARQUET_CODEC_NONE;
+  else if (!strcmp(value_ptr, "gzip")) {
+#if defined (HAVE_ZLIB)
+    value = PM_PARQUET_CODEC_GZIP;
+#else
+    Log(LOG_WARNING, "WARN: [%s] parquet_compression set to gzip but zlib is not available. Ignoring.\n", filename);
+    return ERR;
+#endif
+  }
+  else {
+    Log(LOG_WARNING, "WARN: [%s] Invalid parquet_compression value '%s'\n", filename, value_ptr);
+    return ERR;
+  }
+
+  if (!name) for (; list; list = list->next, changes++) list->cfg.parquet_compression = value;
+  else {
+    for (; list; list = list->next) {
+      if (!strcmp(name, list->name)) {
+        list->cfg.parquet_compression = value;
+        changes++;
+        break;
+      }
+    }
+  }
+
+  return changes;
+}
+
 int cfg_key_print_output_separator(char *filename, char *name, char *value_ptr)
 {
   struct plugins_list_entry *list = plugins_list;
@@ -3779,6 +4205,40 @@ int cfg_key_nfacctd_bmp_max_peers(char *filename, char *name, char *value_ptr)
   return changes;
 }
 
+int cfg_key_nfacctd_bmp_threads(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = atoi(value_ptr);
+  if (value < 0) {
+        Log(LOG_ERR, "WARN: [%s] 'bmp_daemon_threads' has to be >= 0.\n", filename);
+        return ERR;
+  }
+
+  for (; list; list = list->next, changes++) list->cfg.nfacctd_bmp_threads = value;
+  if (name) Log(LOG_WARNING, "WARN: [%s] plugin name not supported for key 'bmp_daemon_threads'. Globalized.\n", filename);
+
+  return changes;
+}
+
+int cfg_key_nfacctd_bmp_queue_size(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = atoi(value_ptr);
+  if (value < 1) {
+        Log(LOG_ERR, "WARN: [%s] 'bmp_daemon_queue_size' has to be > 0.\n", filename);
+        return ERR;
+  }
+
+  for (; list; list = list->next, changes++) list->cfg.nfacctd_bmp_queue_size = value;
+  if (name) Log(LOG_WARNING, "WARN: [%s] plugin name not supported for key 'bmp_daemon_queue_size'. Globalized.\n", filename);
+
+  return changes;
+}
+
 int cfg_key_nfacctd_bmp_allow_file(char *filename, char *name, char *value_ptr)
 {
   struct plugins_list_entry *list = plugins_list;
@@ -4171,6 +4631,23 @@ int cfg_key_nfacctd_bmp_dump_refresh_time(char *filename, char *name, char *valu
   return changes;
 }
 
+int cfg_key_nfacctd_bmp_dump_max_events(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = atoi(value_ptr);
+  if (value < 1) {
+    Log(LOG_ERR, "WARN: [%s] 'bmp_dump_max_events' has to be > 0.\n", filename);
+    return ERR;
+  }
+
+  for (; list; list = list->next, changes++) list->cfg.bmp_dump_max_events = value;
+  if (name) Log(LOG_WARNING, "WARN: [%s] plugin name not supported for key 'bmp_dump_max_events'. Globalized.\n", filename);
+
+  return changes;
+}
+
 int cfg_key_nfacctd_bmp_dump_amqp_host(char *filename, char *name, char *value_ptr)
 {
   struct plugins_list_entry *list = plugins_list;
@@ -4558,6 +5035,94 @@ int cfg_key_pmacctd_nonroot(char *filename, char *name, char *value_ptr)
   return changes;
 }
 
+int cfg_key_pmacctd_tpacket_v3(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = parse_truefalse(value_ptr);
+  if (value < 0) return ERR;
+
+  for (; list; list = list->next, changes++) list->cfg.pmacctd_tpacket_v3 = value;
+  if (name) Log(LOG_WARNING, "WARN: [%s] plugin name not supported for key 'pmacctd_tpacket_v3'. Globalized.\n", filename);
+
+  return changes;
+}
+
+int cfg_key_pmacctd_tpacket_block_size(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  u_int64_t value, changes = 0;
+  char *endptr;
+
+  value = strtoull(value_ptr, &endptr, 10);
+  if (!value || value > INT_MAX) {
+    Log(LOG_WARNING, "WARN: [%s] 'pmacctd_tpacket_block_size' has to be > 0 and <= INT_MAX.\n", filename);
+    return ERR;
+  }
+
+  for (; list; list = list->next, changes++) list->cfg.pmacctd_tpacket_block_size = value;
+  if (name) Log(LOG_WARNING, "WARN: [%s] plugin name not supported for key 'pmacctd_tpacket_block_size'. Globalized.\n", filename);
+
+  return changes;
+}
+
+int cfg_key_pmacctd_tpacket_block_num(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = atoi(value_ptr);
+  if (value < 1) {
+    Log(LOG_WARNING, "WARN: [%s] 'pmacctd_tpacket_block_num' has to be >= 1.\n", filename);
+    return ERR;
+  }
+
+  for (; list; list = list->next, changes++) list->cfg.pmacctd_tpacket_block_num = value;
+  if (name) Log(LOG_WARNING, "WARN: [%s] plugin name not supported for key 'pmacctd_tpacket_block_num'. Globalized.\n", filename);
+
+  return changes;
+}
+
+int cfg_key_pmacctd_fanout_group(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = atoi(value_ptr);
+  if (value < 1 || value > 65535) {
+    Log(LOG_WARNING, "WARN: [%s] 'pmacctd_fanout_group' has to be in the range 1-65535.\n", filename);
+    return ERR;
+  }
+
+  for (; list; list = list->next, changes++) list->cfg.pmacctd_fanout_group = value;
+  if (name) Log(LOG_WARNING, "WARN: [%s] plugin name not supported for key 'pmacctd_fanout_group'. Globalized.\n", filename);
+
+  return changes;
+}
+
+int cfg_key_pmacctd_fanout_type(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  lower_string(value_ptr);
+  if (!strcmp(value_ptr, "hash")) value = FANOUT_TYPE_HASH;
+  else if (!strcmp(value_ptr, "lb")) value = FANOUT_TYPE_LB;
+  else if (!strcmp(value_ptr, "cpu")) value = FANOUT_TYPE_CPU;
+  else if (!strcmp(value_ptr, "rnd")) value = FANOUT_TYPE_RND;
+  else if (!strcmp(value_ptr, "qm")) value = FANOUT_TYPE_QM;
+  else {
+    Log(LOG_WARNING, "WARN: [%s] Invalid 'pmacctd_fanout_type' value '%s'\n", filename, value_ptr);
+    return ERR;
+  }
+
+  for (; list; list = list->next, changes++) list->cfg.pmacctd_fanout_type = value;
+  if (name) Log(LOG_WARNING, "WARN: [%s] plugin name not supported for key 'pmacctd_fanout_type'. Globalized.\n", filename);
+
+  return changes;
+}
+
 int cfg_key_sfacctd_renormalize(char *filename, char *name, char *value_ptr)
 {
   struct plugins_list_entry *list = plugins_list;
@@ -4967,6 +5532,30 @@ int cfg_key_nfacctd_disable_checks(char *filename, char *name, char *value_ptr)
   return changes;
 }
 
+int cfg_key_nfacctd_stats_refresh_time(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0, i, len = strlen(value_ptr);
+
+  for (i = 0; i < len; i++) {
+    if (!isdigit(value_ptr[i]) && !isspace(value_ptr[i])) {
+      Log(LOG_ERR, "WARN: [%s] '[ns]facctd_stats_refresh_time' is expected in secs but contains non-digit chars: '%c'\n", filename, value_ptr[i]);
+      return ERR;
+    }
+  }
+
+  value = atoi(value_ptr);
+  if (value < 60 || value > 86400) {
+    Log(LOG_ERR, "WARN: [%s] '[ns]facctd_stats_refresh_time' value has to be >= 60 and <= 86400 secs.\n", filename);
+    return ERR;
+  }
+
+  for (; list; list = list->next, changes++) list->cfg.nfacctd_stats_refresh_time = value;
+  if (name) Log(LOG_WARNING, "WARN: [%s] plugin name not supported for key '[ns]facctd_stats_refresh_time'. Globalized.\n", filename);
+
+  return changes;
+}
+
 
 int cfg_key_classifiers(char *filename, char *name, char *value_ptr)
 {
@@ -5568,12 +6157,32 @@ exit_lane:
 int cfg_key_uacctd_group(char *filename, char *name, char *value_ptr)
 {
   struct plugins_list_entry *list = plugins_list;
-  int value, changes = 0;
+  int groups[MAX_NFLOG_GROUPS], value, idx = 0, more = 0, changes = 0;
+  char *count_token;
 
-  value = atoi(value_ptr);
-  if (value < 0 || value > 65535) return ERR;
+  trim_all_spaces(value_ptr);
+
+  while ((count_token = extract_token(&value_ptr, ','))) {
+    value = atoi(count_token);
+    if (value < 0 || value > 65535) return ERR;
+
+    if (idx < MAX_NFLOG_GROUPS) {
+      groups[idx] = value;
+      idx++;
+    }
+    else more++;
+  }
+
+  if (!idx) return ERR;
+
+  for (; list; list = list->next, changes++) {
+    list->cfg.uacctd_group = groups[0];
+    memcpy(list->cfg.uacctd_groups, groups, sizeof(groups));
+    list->cfg.uacctd_groups_num = idx;
+  }
+  if (more) Log(LOG_WARNING, "WARN: [%s] Only the first %u (on a total of %u) NFLOG groups will be joined.\n",
+		  filename, MAX_NFLOG_GROUPS, MAX_NFLOG_GROUPS+more);
 
-  for (; list; list = list->next, changes++) list->cfg.uacctd_group = value;
   return changes;
 }
 
@@ -5588,6 +6197,21 @@ int cfg_key_uacctd_nl_size(char *filename, char *name, char *value_ptr)
   return changes;
 }
 
+int cfg_key_uacctd_nl_batch(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = atoi(value_ptr);
+  if (value < 1 || value > 1024) {
+    Log(LOG_WARNING, "WARN: [%s] 'uacctd_nl_batch' has to be in the range 1-1024.\n", filename);
+    return ERR;
+  }
+
+  for (; list; list = list->next, changes++) list->cfg.uacctd_nl_batch = value;
+  return changes;
+}
+
 int cfg_key_uacctd_threshold(char *filename, char *name, char *value_ptr)
 {
   struct plugins_list_entry *list = plugins_list;
@@ -5649,6 +6273,37 @@ int cfg_key_geoipv2_file(char *filename, char *name, char *value_ptr)
 
   return changes;
 }
+
+int cfg_key_geoipv2_lpm(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = parse_truefalse(value_ptr);
+  if (value < 0) return ERR;
+
+  for (; list; list = list->next, changes++) list->cfg.geoipv2_lpm = value;
+  if (name) Log(LOG_WARNING, "WARN: [%s] plugin name not supported for key 'geoipv2_lpm'. Globalized.\n", filename);
+
+  return changes;
+}
+
+int cfg_key_geoipv2_lpm_cache_entries(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = atoi(value_ptr);
+  if (value <= 0) {
+    Log(LOG_ERR, "WARN: [%s] 'geoipv2_lpm_cache_entries' has to be > 0.\n", filename);
+    return ERR;
+  }
+
+  for (; list; list = list->next, changes++) list->cfg.geoipv2_lpm_cache_entries = value;
+  if (name) Log(LOG_WARNING, "WARN: [%s] plugin name not supported for key 'geoipv2_lpm_cache_entries'. Globalized.\n", filename);
+
+  return changes;
+}
 #endif
 
 int cfg_key_pkt_len_distrib_bins(char *filename, char *name, char *value_ptr)
@@ -6736,6 +7391,40 @@ int cfg_key_telemetry_max_peers(char *filename, char *name, char *value_ptr)
   return changes;
 }
 
+int cfg_key_telemetry_threads(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = atoi(value_ptr);
+  if (value < 0) {
+        Log(LOG_ERR, "WARN: [%s] 'telemetry_daemon_threads' has to be >= 0.\n", filename);
+        return ERR;
+  }
+
+  for (; list; list = list->next, changes++) list->cfg.telemetry_threads = value;
+  if (name) Log(LOG_WARNING, "WARN: [%s] plugin name not supported for key 'telemetry_daemon_threads'. Globalized.\n", filename);
+
+  return changes;
+}
+
+int cfg_key_telemetry_queue_size(char *filename, char *name, char *value_ptr)
+{
+  struct plugins_list_entry *list = plugins_list;
+  int value, changes = 0;
+
+  value = atoi(value_ptr);
+  if (value < 1) {
+        Log(LOG_ERR, "WARN: [%s] 'telemetry_daemon_queue_size' has to be > 0.\n", filename);
+        return ERR;
+  }
+
+  for (; list; list = list->next, changes++) list->cfg.telemetry_queue_size = value;
+  if (name) Log(LOG_WARNING, "WARN: [%s] plugin name not supported for key 'telemetry_daemon_queue_size'. Globalized.\n", filename);
+
+  return changes;
+}
+
 int cfg_key_telemetry_udp_timeout(char *filename, char *name, char *value_ptr)
 {
   struct plugins_list_entry *list = plugins_list;
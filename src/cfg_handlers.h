@@ -33,7 +33,11 @@ EXT int cfg_key_debug(char *, char *, char *);
 EXT int cfg_key_debug_internal_msg(char *, char *, char *);
 EXT int cfg_key_syslog(char *, char *, char *);
 EXT int cfg_key_logfile(char *, char *, char *);
+EXT int cfg_key_logfile_async(char *, char *, char *);
+EXT int cfg_key_logfile_async_ratelimit(char *, char *, char *);
 EXT int cfg_key_pidfile(char *, char *, char *);
+EXT int cfg_key_stats_shm_file(char *, char *, char *);
+EXT int cfg_key_stats_shm_refresh_time(char *, char *, char *);
 EXT int cfg_key_daemonize(char *, char *, char *);
 EXT int cfg_key_proc_name(char *, char *, char *);
 EXT int cfg_key_proc_priority(char *, char *, char *);
@@ -58,6 +62,10 @@ EXT int cfg_key_imt_passwd(char *, char *, char *);
 EXT int cfg_key_imt_buckets(char *, char *, char *);
 EXT int cfg_key_imt_mem_pools_number(char *, char *, char *);
 EXT int cfg_key_imt_mem_pools_size(char *, char *, char *);
+EXT int cfg_key_imt_history_bins(char *, char *, char *);
+EXT int cfg_key_imt_history_bin_time(char *, char *, char *);
+EXT int cfg_key_imt_index(char *, char *, char *);
+EXT int cfg_key_imt_query_threads(char *, char *, char *);
 EXT int cfg_key_sql_db(char *, char *, char *);
 EXT int cfg_key_sql_table(char *, char *, char *);
 EXT int cfg_key_sql_table_schema(char *, char *, char *);
@@ -81,6 +89,8 @@ EXT int cfg_key_sql_dont_try_update(char *, char *, char *);
 EXT int cfg_key_sql_preprocess(char *, char *, char *);
 EXT int cfg_key_sql_preprocess_type(char *, char *, char *);
 EXT int cfg_key_sql_multi_values(char *, char *, char *);
+EXT int cfg_key_sql_prepared_statements(char *, char *, char *);
+EXT int cfg_key_sql_parallel_writers(char *, char *, char *);
 EXT int cfg_key_sql_aggressive_classification(char *, char *, char *);
 EXT int cfg_key_sql_locking_style(char *, char *, char *);
 EXT int cfg_key_sql_use_copy(char *, char *, char *);
@@ -89,8 +99,12 @@ EXT int cfg_key_timestamps_secs(char *, char *, char *);
 EXT int cfg_key_timestamps_since_epoch(char *, char *, char *);
 EXT int cfg_key_mongo_insert_batch(char *, char *, char *);
 EXT int cfg_key_message_broker_output(char *, char *, char *);
+EXT int cfg_key_message_broker_mv_format(char *, char *, char *);
+EXT int cfg_key_message_broker_mv_bytes(char *, char *, char *);
+EXT int cfg_key_message_broker_mv_compress(char *, char *, char *);
 EXT int cfg_key_avro_buffer_size(char *, char *, char *);
 EXT int cfg_key_avro_schema_output_file(char *, char *, char *);
+EXT int cfg_key_avro_container(char *, char *, char *);
 EXT int cfg_key_amqp_exchange_type(char *, char *, char *);
 EXT int cfg_key_amqp_persistent_msg(char *, char *, char *);
 EXT int cfg_key_amqp_frame_max(char *, char *, char *);
@@ -105,6 +119,8 @@ EXT int cfg_key_kafka_partition_key(char *, char *, char *);
 EXT int cfg_key_kafka_avro_schema_topic(char *, char *, char *);
 EXT int cfg_key_kafka_avro_schema_refresh_time(char *, char *, char *);
 EXT int cfg_key_kafka_config_file(char *, char *, char *);
+EXT int cfg_key_kafka_async_producer(char *, char *, char *);
+EXT int cfg_key_kafka_inflight_max(char *, char *, char *);
 EXT int cfg_key_plugin_pipe_size(char *, char *, char *);
 EXT int cfg_key_plugin_pipe_backlog(char *, char *, char *);
 EXT int cfg_key_plugin_pipe_check_core_pid(char *, char *, char *);
@@ -133,6 +149,8 @@ EXT int cfg_key_ports_file(char *, char *, char *);
 EXT int cfg_key_print_cache_entries(char *, char *, char *);
 EXT int cfg_key_print_markers(char *, char *, char *);
 EXT int cfg_key_print_output(char *, char *, char *);
+EXT int cfg_key_parquet_row_group_size(char *, char *, char *);
+EXT int cfg_key_parquet_compression(char *, char *, char *);
 EXT int cfg_key_print_output_file(char *, char *, char *);
 EXT int cfg_key_print_output_file_append(char *, char *, char *);
 EXT int cfg_key_print_output_lock_file(char *, char *, char *);
@@ -146,6 +164,7 @@ EXT int cfg_key_nfacctd_time_new(char *, char *, char *);
 EXT int cfg_key_nfacctd_as_new(char *, char *, char *);
 EXT int cfg_key_nfacctd_net(char *, char *, char *);
 EXT int cfg_key_nfacctd_disable_checks(char *, char *, char *);
+EXT int cfg_key_nfacctd_stats_refresh_time(char *, char *, char *);
 EXT int cfg_key_nfacctd_mcast_groups(char *, char *, char *);
 EXT int cfg_key_nfacctd_pipe_size(char *, char *, char *);
 EXT int cfg_key_nfacctd_pro_rating(char *, char *, char *);
@@ -160,6 +179,11 @@ EXT int cfg_key_pmacctd_flow_lifetime(char *, char *, char *);
 EXT int cfg_key_pmacctd_flow_tcp_lifetime(char *, char *, char *);
 EXT int cfg_key_pmacctd_ext_sampling_rate(char *, char *, char *);
 EXT int cfg_key_pmacctd_nonroot(char *, char *, char *);
+EXT int cfg_key_pmacctd_tpacket_v3(char *, char *, char *);
+EXT int cfg_key_pmacctd_tpacket_block_size(char *, char *, char *);
+EXT int cfg_key_pmacctd_tpacket_block_num(char *, char *, char *);
+EXT int cfg_key_pmacctd_fanout_group(char *, char *, char *);
+EXT int cfg_key_pmacctd_fanout_type(char *, char *, char *);
 EXT int cfg_key_sfacctd_renormalize(char *, char *, char *);
 EXT int cfg_key_sfacctd_counter_output(char *, char *, char *);
 EXT int cfg_key_sfacctd_counter_file(char *, char *, char *);
@@ -187,6 +211,8 @@ EXT int cfg_key_telemetry_port_udp(char *, char *, char *);
 EXT int cfg_key_telemetry_ip(char *, char *, char *);
 EXT int cfg_key_telemetry_decoder(char *, char *, char *);
 EXT int cfg_key_telemetry_max_peers(char *, char *, char *);
+EXT int cfg_key_telemetry_threads(char *, char *, char *);
+EXT int cfg_key_telemetry_queue_size(char *, char *, char *);
 EXT int cfg_key_telemetry_udp_timeout(char *, char *, char *);
 EXT int cfg_key_telemetry_allow_file(char *, char *, char *);
 EXT int cfg_key_telemetry_pipe_size(char *, char *, char *);
@@ -361,6 +387,8 @@ EXT int cfg_key_nfacctd_bmp_ip(char *, char *, char *);
 EXT int cfg_key_nfacctd_bmp_port(char *, char *, char *);
 EXT int cfg_key_nfacctd_bmp_pipe_size(char *, char *, char *);
 EXT int cfg_key_nfacctd_bmp_max_peers(char *, char *, char *);
+EXT int cfg_key_nfacctd_bmp_threads(char *, char *, char *);
+EXT int cfg_key_nfacctd_bmp_queue_size(char *, char *, char *);
 EXT int cfg_key_nfacctd_bmp_allow_file(char *, char *, char *);
 EXT int cfg_key_nfacctd_bmp_ip_precedence(char *, char *, char *);
 EXT int cfg_key_nfacctd_bmp_batch(char *, char *, char *);
@@ -395,6 +423,7 @@ EXT int cfg_key_nfacctd_bmp_dump_output(char *, char *, char *);
 EXT int cfg_key_nfacctd_bmp_dump_file(char *, char *, char *);
 EXT int cfg_key_nfacctd_bmp_dump_latest_file(char *, char *, char *);
 EXT int cfg_key_nfacctd_bmp_dump_refresh_time(char *, char *, char *);
+EXT int cfg_key_nfacctd_bmp_dump_max_events(char *, char *, char *);
 EXT int cfg_key_nfacctd_bmp_dump_amqp_host(char *, char *, char *);
 EXT int cfg_key_nfacctd_bmp_dump_amqp_vhost(char *, char *, char *);
 EXT int cfg_key_nfacctd_bmp_dump_amqp_user(char *, char *, char *);
@@ -425,8 +454,11 @@ EXT int cfg_key_igp_daemon_map_msglog(char *, char *, char *);
 EXT int cfg_key_geoip_ipv4_file(char *, char *, char *);
 EXT int cfg_key_geoip_ipv6_file(char *, char *, char *);
 EXT int cfg_key_geoipv2_file(char *, char *, char *);
+EXT int cfg_key_geoipv2_lpm(char *, char *, char *);
+EXT int cfg_key_geoipv2_lpm_cache_entries(char *, char *, char *);
 EXT int cfg_key_uacctd_group(char *, char *, char *);
 EXT int cfg_key_uacctd_nl_size(char *, char *, char *);
+EXT int cfg_key_uacctd_nl_batch(char *, char *, char *);
 EXT int cfg_key_uacctd_threshold(char *, char *, char *);
 EXT int cfg_key_tunnel_0(char *, char *, char *);
 EXT int cfg_key_pkt_len_distrib_bins(char *, char *, char *);
@@ -0,0 +1,517 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2017 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#define __GEOIPV2_LPM_C
+
+/* includes */
+#include "pmacct.h"
+#include "geoipv2_lpm.h"
+#include "jhash.h"
+#if defined ENABLE_THREADS
+#include "thread_pool.h"
+#endif
+
+#if defined WITH_GEOIPV2
+/* structures */
+struct geoipv2_lpm_builder {
+  MMDB_s *db;
+  struct geoipv2_lpm *lpm;
+  u_int32_t v4_alloc;
+  u_int32_t v4_value_alloc;
+  u_int32_t v6_alloc;
+  u_int32_t v6_value_alloc;
+  u_int32_t values_alloc;
+  u_int32_t v4_root;		/* IPv4 subtree, aliased in IPv6 space */
+
+  u_int32_t *off_key;		/* data section offset + 1 -> value index */
+  u_int32_t *off_val;
+  u_int32_t off_size;
+  u_int32_t off_num;
+
+  u_int32_t *val_slot;		/* value contents -> value index */
+  u_int32_t val_size;
+};
+
+/* variables */
+#if defined ENABLE_THREADS
+thread_pool_t *geoipv2_lpm_pool;
+static pthread_mutex_t geoipv2_lpm_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t geoipv2_lpm_cond = PTHREAD_COND_INITIALIZER;
+static int geoipv2_lpm_build_req;
+#endif
+static struct geoipv2_lpm_cache_entry *geoipv2_lpm_cache;
+static u_int32_t geoipv2_lpm_cache_mask;
+static u_int32_t geoipv2_lpm_cache_gen;
+
+/* functions */
+void geoipv2_lpm_free(struct geoipv2_lpm *lpm)
+{
+  if (!lpm) return;
+
+  if (lpm->v4_start) free(lpm->v4_start);
+  if (lpm->v4_value) free(lpm->v4_value);
+  if (lpm->v6_start) free(lpm->v6_start);
+  if (lpm->v6_value) free(lpm->v6_value);
+  if (lpm->values) free(lpm->values);
+  free(lpm);
+}
+
+static int geoipv2_lpm_grow(void **ptr, u_int32_t *alloc, u_int32_t num, size_t elem_sz)
+{
+  u_int32_t new_alloc;
+  void *new_ptr;
+
+  if (num < *alloc) return SUCCESS;
+
+  new_alloc = (*alloc ? (*alloc * 2) : 1024);
+  new_ptr = realloc(*ptr, new_alloc * elem_sz);
+  if (!new_ptr) return ERR;
+
+  *ptr = new_ptr;
+  *alloc = new_alloc;
+
+  return SUCCESS;
+}
+
+static void geoipv2_lpm_get_string(MMDB_entry_s *entry, char *key, char *subkey, char *str, int len, u_int8_t *have)
+{
+  MMDB_entry_data_s entry_data;
+  int status, size;
+
+  status = MMDB_get_value(entry, &entry_data, key, subkey, NULL);
+
+  if (status == MMDB_SUCCESS && entry_data.has_data && entry_data.type == MMDB_DATA_TYPE_UTF8_STRING) {
+    size = (entry_data.data_size < (len-1)) ? entry_data.data_size : (len-1);
+    memcpy(str, entry_data.utf8_string, size);
+    str[size] = '\0';
+    (*have) = TRUE;
+  }
+}
+
+static int geoipv2_lpm_val_rehash(struct geoipv2_lpm_builder *b)
+{
+  u_int32_t idx, slot, new_size = (b->val_size ? (b->val_size * 2) : 4096);
+  u_int32_t *new_slot;
+
+  new_slot = calloc(new_size, sizeof(u_int32_t));
+  if (!new_slot) return ERR;
+
+  for (idx = 1; idx < b->lpm->values_num; idx++) {
+    slot = jhash(&b->lpm->values[idx], sizeof(struct geoipv2_lpm_value), 0) & (new_size - 1);
+    while (new_slot[slot]) slot = ((slot + 1) & (new_size - 1));
+    new_slot[slot] = idx;
+  }
+
+  if (b->val_slot) free(b->val_slot);
+  b->val_slot = new_slot;
+  b->val_size = new_size;
+
+  return SUCCESS;
+}
+
+static int geoipv2_lpm_off_rehash(struct geoipv2_lpm_builder *b)
+{
+  u_int32_t idx, slot, new_size = (b->off_size ? (b->off_size * 2) : 4096);
+  u_int32_t *new_key, *new_val;
+
+  new_key = calloc(new_size, sizeof(u_int32_t));
+  new_val = calloc(new_size, sizeof(u_int32_t));
+  if (!new_key || !new_val) {
+    if (new_key) free(new_key);
+    if (new_val) free(new_val);
+    return ERR;
+  }
+
+  for (idx = 0; idx < b->off_size; idx++) {
+    if (!b->off_key[idx]) continue;
+
+    slot = jhash(&b->off_key[idx], sizeof(u_int32_t), 0) & (new_size - 1);
+    while (new_key[slot]) slot = ((slot + 1) & (new_size - 1));
+    new_key[slot] = b->off_key[idx];
+    new_val[slot] = b->off_val[idx];
+  }
+
+  if (b->off_key) free(b->off_key);
+  if (b->off_val) free(b->off_val);
+  b->off_key = new_key;
+  b->off_val = new_val;
+  b->off_size = new_size;
+
+  return SUCCESS;
+}
+
+/* maps a data record onto a value index, extracting strings only once per record */
+static int geoipv2_lpm_value(struct geoipv2_lpm_builder *b, MMDB_entry_s *entry, u_int32_t *value)
+{
+  struct geoipv2_lpm_value val, *vptr;
+  u_int32_t key = entry->offset + 1, slot;
+
+  if ((b->off_num + 1) * 2 > b->off_size && geoipv2_lpm_off_rehash(b) == ERR) return ERR;
+
+  slot = jhash(&key, sizeof(u_int32_t), 0) & (b->off_size - 1);
+  while (b->off_key[slot]) {
+    if (b->off_key[slot] == key) {
+      (*value) = b->off_val[slot];
+      return SUCCESS;
+    }
+    slot = ((slot + 1) & (b->off_size - 1));
+  }
+
+  memset(&val, 0, sizeof(val));
+  geoipv2_lpm_get_string(entry, "country", "iso_code", val.country.str, PM_COUNTRY_T_STRLEN, &val.have_country);
+  geoipv2_lpm_get_string(entry, "postal", "code", val.pocode.str, PM_POCODE_T_STRLEN, &val.have_pocode);
+
+  if (!val.have_country && !val.have_pocode) (*value) = GEOIPV2_LPM_VALUE_NONE;
+  else {
+    u_int32_t vslot;
+
+    if ((b->lpm->values_num + 1) * 2 > b->val_size && geoipv2_lpm_val_rehash(b) == ERR) return ERR;
+
+    vslot = jhash(&val, sizeof(val), 0) & (b->val_size - 1);
+    while (b->val_slot[vslot] && memcmp(&b->lpm->values[b->val_slot[vslot]], &val, sizeof(val)))
+      vslot = ((vslot + 1) & (b->val_size - 1));
+
+    if (!b->val_slot[vslot]) {
+      if (geoipv2_lpm_grow((void **) &b->lpm->values, &b->values_alloc, b->lpm->values_num, sizeof(val)) == ERR) return ERR;
+
+      vptr = &b->lpm->values[b->lpm->values_num];
+      memcpy(vptr, &val, sizeof(val));
+      b->val_slot[vslot] = b->lpm->values_num;
+      b->lpm->values_num++;
+    }
+
+    (*value) = b->val_slot[vslot];
+  }
+
+  b->off_key[slot] = key;
+  b->off_val[slot] = (*value);
+  b->off_num++;
+
+  return SUCCESS;
+}
+
+static int geoipv2_lpm_emit(struct geoipv2_lpm_builder *b, int width, u_int64_t hi, u_int64_t lo, u_int32_t value)
+{
+  struct geoipv2_lpm *lpm = b->lpm;
+
+  if (width == 32) {
+    if (lpm->v4_num && lpm->v4_value[lpm->v4_num-1] == value) return SUCCESS;
+
+    if (geoipv2_lpm_grow((void **) &lpm->v4_start, &b->v4_alloc, lpm->v4_num, sizeof(u_int32_t)) == ERR) return ERR;
+    if (geoipv2_lpm_grow((void **) &lpm->v4_value, &b->v4_value_alloc, lpm->v4_num, sizeof(u_int32_t)) == ERR) return ERR;
+
+    lpm->v4_start[lpm->v4_num] = (u_int32_t) lo;
+    lpm->v4_value[lpm->v4_num] = value;
+    lpm->v4_num++;
+  }
+  else {
+    if (lpm->v6_num && lpm->v6_value[lpm->v6_num-1] == value) return SUCCESS;
+
+    if (geoipv2_lpm_grow((void **) &lpm->v6_start, &b->v6_alloc, lpm->v6_num, sizeof(struct geoipv2_lpm_addr6)) == ERR) return ERR;
+    if (geoipv2_lpm_grow((void **) &lpm->v6_value, &b->v6_value_alloc, lpm->v6_num, sizeof(u_int32_t)) == ERR) return ERR;
+
+    lpm->v6_start[lpm->v6_num].hi = hi;
+    lpm->v6_start[lpm->v6_num].lo = lo;
+    lpm->v6_value[lpm->v6_num] = value;
+    lpm->v6_num++;
+  }
+
+  return SUCCESS;
+}
+
+/*
+   Walks the search tree depth-first, left record first: leaves are then
+   met in ascending address order and, the tree being complete, each one
+   starts right where the previous one ended.
+*/
+static int geoipv2_lpm_record(struct geoipv2_lpm_builder *b, int width, int depth, u_int64_t hi, u_int64_t lo,
+			      u_int8_t type, u_int64_t record, MMDB_entry_s *entry)
+{
+  MMDB_search_node_s node;
+  u_int32_t value;
+  int ret;
+
+  switch (type) {
+  case MMDB_RECORD_TYPE_EMPTY:
+    return geoipv2_lpm_emit(b, width, hi, lo, GEOIPV2_LPM_VALUE_NONE);
+  case MMDB_RECORD_TYPE_DATA:
+    if (geoipv2_lpm_value(b, entry, &value) == ERR) return ERR;
+    return geoipv2_lpm_emit(b, width, hi, lo, value);
+  case MMDB_RECORD_TYPE_SEARCH_NODE:
+    if (width == 128 && record == b->v4_root)
+      return geoipv2_lpm_emit(b, width, hi, lo, GEOIPV2_LPM_VALUE_FALLBACK);
+
+    if (depth >= width) return ERR;
+    if (MMDB_read_node(b->db, (u_int32_t) record, &node) != MMDB_SUCCESS) return ERR;
+
+    ret = geoipv2_lpm_record(b, width, depth + 1, hi, lo, node.left_record_type, node.left_record, &node.left_record_entry);
+    if (ret == ERR) return ERR;
+
+    if (width == 32) lo |= (1ULL << (31 - depth));
+    else if (depth < 64) hi |= (1ULL << (63 - depth));
+    else lo |= (1ULL << (127 - depth));
+
+    return geoipv2_lpm_record(b, width, depth + 1, hi, lo, node.right_record_type, node.right_record, &node.right_record_entry);
+  default:
+    return ERR;
+  }
+}
+
+static struct geoipv2_lpm *geoipv2_lpm_build(char *filename)
+{
+  struct geoipv2_lpm_builder b;
+  MMDB_search_node_s node;
+  MMDB_s db;
+  u_int8_t v4_type;
+  u_int64_t v4_record;
+  MMDB_entry_s v4_entry;
+  int status, idx, ret = SUCCESS;
+
+  memset(&b, 0, sizeof(b));
+  memset(&db, 0, sizeof(db));
+
+  status = MMDB_open(filename, MMDB_MODE_MMAP, &db);
+  if (status != MMDB_SUCCESS) {
+    Log(LOG_WARNING, "WARN ( %s/%s ): geoipv2_lpm: %s can't be loaded (%s).\n", config.name, config.type, filename, MMDB_strerror(status));
+    return NULL;
+  }
+
+  b.db = &db;
+  b.lpm = calloc(1, sizeof(struct geoipv2_lpm));
+  if (!b.lpm || geoipv2_lpm_grow((void **) &b.lpm->values, &b.values_alloc, 0, sizeof(struct geoipv2_lpm_value)) == ERR) {
+    ret = ERR;
+    goto exit_lane;
+  }
+
+  /* values[0] is GEOIPV2_LPM_VALUE_NONE */
+  memset(&b.lpm->values[0], 0, sizeof(struct geoipv2_lpm_value));
+  b.lpm->values_num = 1;
+
+  /* IPv4 subtree: root in an IPv4 database, ::/96 in an IPv6 one */
+  v4_type = MMDB_RECORD_TYPE_SEARCH_NODE;
+  v4_record = 0;
+  memset(&v4_entry, 0, sizeof(v4_entry));
+
+  if (db.metadata.ip_version == 6) {
+    for (idx = 0; idx < 96 && v4_type == MMDB_RECORD_TYPE_SEARCH_NODE; idx++) {
+      if (MMDB_read_node(&db, (u_int32_t) v4_record, &node) != MMDB_SUCCESS) {
+        ret = ERR;
+        goto exit_lane;
+      }
+
+      v4_type = node.left_record_type;
+      v4_record = node.left_record;
+      memcpy(&v4_entry, &node.left_record_entry, sizeof(v4_entry));
+    }
+  }
+
+  b.v4_root = ((v4_type == MMDB_RECORD_TYPE_SEARCH_NODE) ? v4_record : db.metadata.node_count);
+
+  ret = geoipv2_lpm_record(&b, 32, 0, 0, 0, v4_type, v4_record, &v4_entry);
+  if (ret == SUCCESS && db.metadata.ip_version == 6)
+    ret = geoipv2_lpm_record(&b, 128, 0, 0, 0, MMDB_RECORD_TYPE_SEARCH_NODE, 0, NULL);
+
+  exit_lane:
+  if (b.off_key) free(b.off_key);
+  if (b.off_val) free(b.off_val);
+  if (b.val_slot) free(b.val_slot);
+  MMDB_close(&db);
+
+  if (ret == ERR) {
+    Log(LOG_WARNING, "WARN ( %s/%s ): geoipv2_lpm: unable to build snapshot of %s. Using the database directly.\n", config.name, config.type, filename);
+    geoipv2_lpm_free(b.lpm);
+    return NULL;
+  }
+
+  Log(LOG_INFO, "INFO ( %s/%s ): geoipv2_lpm: snapshot of %s built (%u IPv4 ranges, %u IPv6 ranges, %u values)\n",
+	config.name, config.type, filename, b.lpm->v4_num, b.lpm->v6_num, b.lpm->values_num - 1);
+
+  return b.lpm;
+}
+
+static void geoipv2_lpm_publish(struct geoipv2_lpm *lpm)
+{
+  struct geoipv2_lpm *old;
+
+  if (!lpm) return;
+
+  /* contents must be visible before the pointer; a snapshot never swapped in is replaced */
+  __sync_synchronize();
+  old = __sync_lock_test_and_set(&geoipv2_lpm_next, lpm);
+  geoipv2_lpm_free(old);
+}
+
+#if defined ENABLE_THREADS
+static void geoipv2_lpm_builder()
+{
+  for (;;) {
+    pthread_mutex_lock(&geoipv2_lpm_mutex);
+    while (!geoipv2_lpm_build_req) pthread_cond_wait(&geoipv2_lpm_cond, &geoipv2_lpm_mutex);
+    geoipv2_lpm_build_req = FALSE;
+    pthread_mutex_unlock(&geoipv2_lpm_mutex);
+
+    geoipv2_lpm_publish(geoipv2_lpm_build(config.geoipv2_file));
+  }
+}
+#endif
+
+/*
+   Core Process: asks for a (new) snapshot of geoipv2_file, ie. at startup
+   and upon reload. Lookups keep going through the database until the
+   snapshot is swapped in by geoipv2_lpm_swap().
+*/
+void geoipv2_lpm_request()
+{
+  if (!config.geoipv2_lpm || !config.geoipv2_file) return;
+
+  if (!geoipv2_lpm_cache) {
+    u_int32_t entries = 1;
+
+    if (!config.geoipv2_lpm_cache_entries) config.geoipv2_lpm_cache_entries = GEOIPV2_LPM_DEFAULT_CACHE_ENTRIES;
+    while (entries < config.geoipv2_lpm_cache_entries) entries <<= 1;
+
+    geoipv2_lpm_cache = calloc(entries, sizeof(struct geoipv2_lpm_cache_entry));
+    if (!geoipv2_lpm_cache) {
+      Log(LOG_ERR, "ERROR ( %s/%s ): geoipv2_lpm: unable to allocate cache. Exiting.\n", config.name, config.type);
+      exit_all(1);
+    }
+
+    geoipv2_lpm_cache_mask = (entries - 1);
+    geoipv2_lpm_cache_gen = 1;
+  }
+
+#if defined ENABLE_THREADS
+  if (!geoipv2_lpm_pool) {
+    geoipv2_lpm_pool = allocate_thread_pool(1);
+    assert(geoipv2_lpm_pool);
+
+    send_to_pool(geoipv2_lpm_pool, geoipv2_lpm_builder, NULL);
+  }
+
+  pthread_mutex_lock(&geoipv2_lpm_mutex);
+  geoipv2_lpm_build_req = TRUE;
+  pthread_cond_signal(&geoipv2_lpm_cond);
+  pthread_mutex_unlock(&geoipv2_lpm_mutex);
+#else
+  geoipv2_lpm_publish(geoipv2_lpm_build(config.geoipv2_file));
+#endif
+}
+
+/* Core Process: the only reader of geoipv2_lpm, hence it can free the old one */
+void geoipv2_lpm_swap()
+{
+  struct geoipv2_lpm *lpm;
+
+  lpm = __sync_lock_test_and_set(&geoipv2_lpm_next, NULL);
+  if (!lpm) return;
+
+  geoipv2_lpm_free(geoipv2_lpm);
+  geoipv2_lpm = lpm;
+
+  /* invalidates the whole cache */
+  geoipv2_lpm_cache_gen++;
+  if (!geoipv2_lpm_cache_gen) geoipv2_lpm_cache_gen++;
+}
+
+static u_int32_t geoipv2_lpm_search4(struct geoipv2_lpm *lpm, u_int32_t addr)
+{
+  u_int32_t low = 0, high = lpm->v4_num, mid;
+
+  /* last range starting at or before addr; v4_start[0] is always 0 */
+  while (high - low > 1) {
+    mid = low + ((high - low) / 2);
+    if (lpm->v4_start[mid] <= addr) low = mid;
+    else high = mid;
+  }
+
+  return lpm->v4_value[low];
+}
+
+static u_int32_t geoipv2_lpm_search6(struct geoipv2_lpm *lpm, u_int64_t hi, u_int64_t lo)
+{
+  u_int32_t low = 0, high = lpm->v6_num, mid;
+
+  while (high - low > 1) {
+    mid = low + ((high - low) / 2);
+    if (lpm->v6_start[mid].hi < hi || (lpm->v6_start[mid].hi == hi && lpm->v6_start[mid].lo <= lo)) low = mid;
+    else high = mid;
+  }
+
+  return lpm->v6_value[low];
+}
+
+/*
+   Returns TRUE if the snapshot could resolve the address (value is then
+   set, NULL if the database has no entry for it), FALSE if the database
+   has to be queried directly instead.
+*/
+int geoipv2_lpm_lookup(int family, void *addr, struct geoipv2_lpm_value **value)
+{
+  struct geoipv2_lpm_cache_entry *ce;
+  u_int32_t val, len;
+
+  if (!geoipv2_lpm) return FALSE;
+
+  if (family == AF_INET) {
+    if (!geoipv2_lpm->v4_num) return FALSE;
+    len = 4;
+  }
+#if defined ENABLE_IPV6
+  else if (family == AF_INET6) {
+    if (!geoipv2_lpm->v6_num) return FALSE;
+    len = 16;
+  }
+#endif
+  else return FALSE;
+
+  ce = &geoipv2_lpm_cache[jhash(addr, len, 0) & geoipv2_lpm_cache_mask];
+
+  if (ce->gen == geoipv2_lpm_cache_gen && ce->family == family && !memcmp(ce->addr, addr, len)) val = ce->value;
+  else {
+    if (family == AF_INET) {
+      u_int32_t addr4;
+
+      memcpy(&addr4, addr, 4);
+      val = geoipv2_lpm_search4(geoipv2_lpm, ntohl(addr4));
+    }
+    else {
+      u_int32_t addr6[4];
+      u_int64_t hi, lo;
+
+      memcpy(addr6, addr, 16);
+      hi = (((u_int64_t) ntohl(addr6[0])) << 32) | ntohl(addr6[1]);
+      lo = (((u_int64_t) ntohl(addr6[2])) << 32) | ntohl(addr6[3]);
+      val = geoipv2_lpm_search6(geoipv2_lpm, hi, lo);
+    }
+
+    ce->gen = geoipv2_lpm_cache_gen;
+    ce->family = family;
+    memcpy(ce->addr, addr, len);
+    ce->value = val;
+  }
+
+  if (val == GEOIPV2_LPM_VALUE_FALLBACK) return FALSE;
+
+  (*value) = (val ? &geoipv2_lpm->values[val] : NULL);
+
+  return TRUE;
+}
+#endif
@@ -0,0 +1,81 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2017 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#if defined WITH_GEOIPV2
+/* defines */
+#define GEOIPV2_LPM_DEFAULT_CACHE_ENTRIES	65536
+#define GEOIPV2_LPM_VALUE_NONE			0		/* no entry in the database */
+#define GEOIPV2_LPM_VALUE_FALLBACK		0xFFFFFFFF	/* IPv4 aliases in IPv6 space */
+
+/*
+   A snapshot flattens the MaxMind search tree into sorted arrays of
+   contiguous ranges, one per address family: each range starts where the
+   previous one ends and maps onto an index into the values array, where
+   country and pocode are already extracted. Adjacent ranges mapping onto
+   the same value are merged. Snapshots are immutable once built.
+*/
+struct geoipv2_lpm_value {
+  pm_country_t country;
+  pm_pocode_t pocode;
+  u_int8_t have_country;
+  u_int8_t have_pocode;
+};
+
+struct geoipv2_lpm_addr6 {
+  u_int64_t hi;
+  u_int64_t lo;
+};
+
+struct geoipv2_lpm {
+  u_int32_t *v4_start;
+  u_int32_t *v4_value;
+  u_int32_t v4_num;
+
+  struct geoipv2_lpm_addr6 *v6_start;
+  u_int32_t *v6_value;
+  u_int32_t v6_num;
+
+  struct geoipv2_lpm_value *values;	/* values[0] is GEOIPV2_LPM_VALUE_NONE */
+  u_int32_t values_num;
+};
+
+struct geoipv2_lpm_cache_entry {
+  u_int32_t gen;
+  u_int32_t value;
+  u_int8_t family;
+  u_int8_t addr[16];
+};
+
+/* prototypes */
+#if (!defined __GEOIPV2_LPM_C)
+#define EXT extern
+#else
+#define EXT
+#endif
+EXT void geoipv2_lpm_request();
+EXT void geoipv2_lpm_swap();
+EXT int geoipv2_lpm_lookup(int, void *, struct geoipv2_lpm_value **);
+EXT void geoipv2_lpm_free(struct geoipv2_lpm *);
+
+EXT struct geoipv2_lpm *geoipv2_lpm;		/* in use by the Core Process */
+EXT struct geoipv2_lpm *geoipv2_lpm_next;	/* built, waiting to be swapped in */
+#undef EXT
+#endif
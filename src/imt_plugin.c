@@ -52,6 +52,8 @@ void imt_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
   u_int32_t seq = 0;
   int rg_err_count = 0;
   int amqp_timeout = INT_MAX, ret;
+  u_int64_t entries_max;
+  time_t stats_shm_stamp = 0;
   struct pkt_bgp_primitives *pbgp, empty_pbgp;
   struct pkt_legacy_bgp_primitives *plbgp, empty_plbgp;
   struct pkt_nat_primitives *pnat, empty_pnat;
@@ -180,6 +182,20 @@ void imt_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
     exit_plugin(1);
   }
 
+  init_imt_history();
+  init_imt_index();
+
+  /* the first pool holds the buckets, the others chained entries */
+  entries_max = config.buckets + ((u_int64_t) (config.num_memory_pools - 1) * (config.memory_pool_size / sizeof(struct acc)));
+  if (entries_max > UINT32_MAX) entries_max = UINT32_MAX;
+
+#if !defined ENABLE_THREADS
+  if (config.imt_query_threads > 1) {
+    Log(LOG_WARNING, "WARN ( %s/%s ): imt_query_threads requires threads support (--enable-threads). Ignored.\n", config.name, config.type);
+    config.imt_query_threads = 1;
+  }
+#endif
+
   signal(SIGHUP, reload); /* handles reopening of syslog channel */
   signal(SIGINT, exit_now); /* exit lane */
   signal(SIGUSR1, SIG_IGN);
@@ -226,6 +242,12 @@ void imt_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
     num = select(select_fd, &read_descs, NULL, NULL, &select_timeout);
 
     gettimeofday(&cycle_stamp, NULL);
+    imt_history_rotate(cycle_stamp.tv_sec);
+
+    if (stats_shm_stamp != cycle_stamp.tv_sec) {
+      stats_shm_update_cache(imt_entries, entries_max);
+      stats_shm_stamp = cycle_stamp.tv_sec;
+    }
 
 #ifdef WITH_RABBITMQ
     if (config.pipe_amqp && pipe_fd == ERR) {
@@ -307,7 +329,8 @@ void imt_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
 	   reset for individual entries, etc.) are entitled of an exclusive
 	   lock.
 	 - if query is matter of just a single short-lived walk through the
-	   table, we avoid fork(): the plugin will serve the request;
+	   table, we avoid fork(): the plugin will serve the request; this
+	   includes match queries which can be served by secondary indexes;
          - in all other cases, we fork; the newly created child will serve
 	   queries asyncronously.
       */
@@ -327,6 +350,11 @@ void imt_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
         else Log(LOG_DEBUG, "DEBUG ( %s/%s ): %d incoming bytes. ERRNO: %d\n", config.name, config.type, num, errno);
         Log(LOG_DEBUG, "DEBUG ( %s/%s ): Closing connection with client ...\n", config.name, config.type);
       } 
+      else if (((request == WANT_COUNTER) || (request == WANT_MATCH)) && imt_index_query_check(srvbuf, num)) {
+	if (num > 0) process_query_data(sd2, srvbuf, num, &extras, datasize, FALSE);
+        else Log(LOG_DEBUG, "DEBUG ( %s/%s ): %d incoming bytes. ERRNO: %d\n", config.name, config.type, num, errno);
+        Log(LOG_DEBUG, "DEBUG ( %s/%s ): Closing connection with client ...\n", config.name, config.type);
+      }
       else if (request == WANT_CLASS_TABLE) {
 	if (num > 0) process_query_data(sd2, srvbuf, num, &extras, datasize, FALSE);
         else Log(LOG_DEBUG, "DEBUG ( %s/%s ): %d incoming bytes. ERRNO: %d\n", config.name, config.type, num, errno);
@@ -390,7 +418,10 @@ void imt_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
       }
       go_to_clear = FALSE;
       no_more_space = FALSE;
+      imt_entries = 0;
       memcpy(&table_reset_stamp, &cycle_stamp, sizeof(struct timeval));
+      clear_imt_history(cycle_stamp.tv_sec);
+      clear_imt_index();
     }
 
     if (FD_ISSET(pipe_fd, &read_descs)) {
@@ -410,6 +441,7 @@ void imt_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
         }
 
         memcpy(pipebuf, rgptr, config.buffer_size);
+        stats_shm_update_ring_rd(((struct ch_buf_hdr *) pipebuf)->seq);
         if (((struct ch_buf_hdr *)pipebuf)->seq != seq) {
           rg_err_count++;
           if (config.debug || (rg_err_count > MAX_RG_COUNT_ERR)) {
@@ -26,6 +26,14 @@
 #define MEMORY_POOL_SIZE 8192
 #define MAX_HOSTS 32771 
 #define MAX_QUERIES 4096
+#define IMT_HISTORY_BIN_TIME 60
+
+/* secondary indexes */
+#define IMT_INDEX_SRC_HOST	0
+#define IMT_INDEX_DST_HOST	1
+#define IMT_INDEX_SRC_AS	2
+#define IMT_INDEX_DST_AS	3
+#define IMT_INDEX_MAX		4
 
 /* Structures */
 struct acc {
@@ -44,6 +52,9 @@ struct acc {
   struct pkt_mpls_primitives *pmpls;
   char *pcust;
   struct pkt_vlen_hdr_primitives *pvlen;
+  u_int32_t hslot;		/* history: column slot + 1; 0 if none */
+  u_int8_t imask;		/* secondary indexes the element is linked into */
+  struct acc *inext[IMT_INDEX_MAX];	/* secondary indexes: collision chains */
   struct acc *next;
 };
 
@@ -61,6 +72,31 @@ struct memory_pool_desc {
   struct memory_pool_desc *next;
 };
 
+/* history: counters are kept in 'bins' ring-buffered columns of 'slots'
+   entries each; column for bin B starts at B * slots. Bucket heads own
+   slots [0, buckets), chained elements are given slots past that */
+struct imt_history {
+  u_int32_t bins;
+  u_int32_t bin_time;
+  u_int32_t slots;
+  u_int32_t next_slot;
+  time_t epoch;			/* number of the most recent bin */
+  time_t start;			/* history start (plugin start or last erase) */
+  pm_counter_t *bytes;
+  pm_counter_t *packets;
+  pm_counter_t *flows;
+};
+
+struct imt_history_query {
+  u_int32_t num;		/* number of valid bins selected */
+  u_int32_t pos[MAX_IMT_HISTORY_BINS];	/* ring positions of selected bins */
+  u_int32_t span;		/* seconds covered by the selection */
+  u_int32_t slots;		/* slots covered by pre-computed sums */
+  pm_counter_t *bytes;		/* pre-computed sums, full-table scans only */
+  pm_counter_t *packets;
+  pm_counter_t *flows;
+};
+
 struct query_header {
   int type;				/* type of query */
   pm_cfgreg_t what_to_count;		/* aggregation */
@@ -70,6 +106,14 @@ struct query_header {
   unsigned int cnt_sz;			/* counters size (in bytes) */
   struct extra_primitives extras;	/* offsets for non-standard aggregation primitives structures */
   int datasize;				/* total length of aggregation primitives structures */
+  u_int32_t hist_bins;			/* history: number of most recent bins to sum up; 0 = current counters */
+  u_int32_t hist_span;			/* history: seconds covered by the returned sums */
+  pm_cfgreg_t agg_what_to_count;	/* re-aggregation: primitives to keep; 0 = as per the table */
+  pm_cfgreg_t agg_what_to_count_2;	/* re-aggregation: primitives to keep; 0 = as per the table */
+  u_int8_t topN_counter;		/* top-N: rank by 1 bytes, 2 packets, 3 flows; 0 = unsorted */
+  u_int8_t thr_counter;			/* threshold: 1 bytes, 2 packets, 3 flows; 0 = none */
+  u_int32_t topN_howmany;		/* top-N: number of rows to return; 0 = all */
+  pm_counter_t thr_value;		/* threshold: minimum value of the counter */
   char passwd[12];			/* OBSOLETED: password */
 };
 
@@ -85,6 +129,37 @@ struct query_entry {
   struct pkt_vlen_hdr_primitives *pvlen;	/* variable-length data */
 };
 
+/* server-side ranking: a row of a re-aggregated reply, laid out as
+   a pkt_data followed by the extra primitives it carries */
+struct imt_rank_group {
+  struct imt_rank_group *next;
+  u_int32_t hash;
+  struct pkt_data *row;
+};
+
+/* server-side ranking: a min-heap entry, pointing either to a table
+   element or to a re-aggregated row */
+struct imt_rank_entry {
+  pm_counter_t value;
+  void *ptr;
+};
+
+/* a slice of the buckets of the table, scanned by a query thread */
+struct imt_query_job {
+  struct query_entry *request;
+  struct imt_history_query *hq;
+  struct extra_primitives *extras;
+  u_int32_t first;			/* first bucket */
+  u_int32_t last;			/* last bucket, excluded */
+  int type;
+  int reset;
+  int truncated;
+  struct pkt_data abuf;			/* WANT_COUNTER: accumulated counters */
+  struct acc **matches;			/* WANT_MATCH: matching elements */
+  u_int32_t num;
+  u_int32_t size;
+};
+
 struct reply_buffer {
   unsigned char buf[LARGEBUFLEN];
   unsigned char *ptr;
@@ -128,6 +203,12 @@ struct imt_custom_primitives {
 EXT void insert_accounting_structure(struct primitives_ptrs *);
 EXT struct acc *search_accounting_structure(struct primitives_ptrs *);
 EXT int compare_accounting_structure(struct acc *, struct primitives_ptrs *);
+EXT void imt_history_rotate(time_t);
+EXT void imt_history_account(struct acc *, struct pkt_data *, int);
+EXT void imt_index_add(struct acc *);
+EXT void imt_index_del(struct acc *);
+EXT int imt_index_select(struct query_entry *);
+EXT struct acc *imt_index_lookup(int, struct pkt_primitives *);
 #undef EXT
 
 #if (!defined __MEMORY_C)
@@ -138,6 +219,10 @@ EXT int compare_accounting_structure(struct acc *, struct primitives_ptrs *);
 EXT void init_memory_pool_table();
 EXT void clear_memory_pool_table();
 EXT struct memory_pool_desc *request_memory_pool(int);
+EXT void init_imt_history();
+EXT void clear_imt_history(time_t);
+EXT void init_imt_index();
+EXT void clear_imt_index();
 #undef EXT
 
 #if (!defined __SERVER_C)
@@ -152,9 +237,24 @@ EXT void process_query_data(int, unsigned char *, int, struct extra_primitives *
 EXT void mask_elem(struct pkt_primitives *, struct pkt_bgp_primitives *, struct pkt_legacy_bgp_primitives *,
 			struct pkt_nat_primitives *, struct pkt_mpls_primitives *, struct acc *, u_int64_t,
 			u_int64_t, struct extra_primitives *);
+EXT int imt_query_match(struct acc *, struct query_entry *, struct extra_primitives *);
+EXT void enQueue_acc(int, struct reply_buffer *, struct acc *, struct extra_primitives *, int);
 EXT void enQueue_elem(int, struct reply_buffer *, void *, int, int);
 EXT void Accumulate_Counters(struct pkt_data *, struct acc *);
 EXT int test_zero_elem(struct acc *);
+EXT int imt_history_query_init(struct imt_history_query *, u_int32_t);
+EXT void imt_history_query_sum(struct imt_history_query *);
+EXT void imt_history_query_free(struct imt_history_query *);
+EXT struct acc *imt_history_view(struct acc *, struct imt_history_query *, struct acc *);
+EXT int imt_index_query_check(unsigned char *, int);
+EXT int imt_rank_query_check(struct query_header *);
+EXT void imt_query_rank(int, struct reply_buffer *, struct query_header *, struct extra_primitives *,
+			struct imt_history_query *, int);
+#if defined ENABLE_THREADS
+EXT void imt_query_scan_worker(struct imt_query_job *);
+EXT void imt_query_scan(int, struct reply_buffer *, struct query_entry *, struct imt_history_query *,
+			struct extra_primitives *, int, int, int, struct pkt_data *);
+#endif
 #undef EXT
 
 #if (!defined __IMT_PLUGIN_C)
@@ -184,6 +284,9 @@ EXT unsigned char *a;  /* accounting in-memory table */
 EXT struct memory_pool_desc *current_pool; /* pointer to currently used memory pool */
 EXT struct acc **lru_elem_ptr; /* pointer to Last Recently Used (lru) element in a bucket */
 EXT int no_more_space;
+EXT u_int32_t imt_entries; /* entries in use, bucket heads included */
 EXT struct timeval cycle_stamp; /* timestamp for the current cycle */
 EXT struct timeval table_reset_stamp; /* global table reset timestamp */
+EXT struct imt_history hist; /* history time bins, if imt_history_bins is set */
+EXT struct acc **imt_index[IMT_INDEX_MAX]; /* secondary indexes heads, if imt_index is set */
 #undef EXT
@@ -348,12 +348,65 @@ int iso_handler(register struct packet_ptrs *pptrs)
 {
 }
 
+/* Core Process: the only reader of isis_lpm, hence it can free the old one */
+static void isis_lpm_swap()
+{
+  struct isis_lpm *lpm;
+
+  lpm = __sync_lock_test_and_set(&isis_lpm_next, NULL);
+  if (!lpm) return;
+
+  isis_lpm_free(isis_lpm);
+  isis_lpm = lpm;
+}
+
+static struct isis_prefix *isis_lpm_search4(struct isis_lpm *lpm, struct in_addr *addr)
+{
+  u_int32_t low = 0, high = lpm->v4_num, mid, key = ntohl(addr->s_addr);
+
+  if (!lpm->v4_num) return NULL;
+
+  /* last range starting at or before addr; v4_start[0] is always 0 */
+  while (high - low > 1) {
+    mid = low + ((high - low) / 2);
+    if (lpm->v4_start[mid] <= key) low = mid;
+    else high = mid;
+  }
+
+  return (lpm->v4_value[low] ? &lpm->prefixes[lpm->v4_value[low]] : NULL);
+}
+
+#if defined ENABLE_IPV6
+static struct isis_prefix *isis_lpm_search6(struct isis_lpm *lpm, struct in6_addr *addr)
+{
+  u_int32_t low = 0, high = lpm->v6_num, mid, addr6[4];
+  u_int64_t hi, lo;
+
+  if (!lpm->v6_num) return NULL;
+
+  memcpy(addr6, addr, 16);
+  hi = ((((u_int64_t) ntohl(addr6[0])) << 32) | ntohl(addr6[1]));
+  lo = ((((u_int64_t) ntohl(addr6[2])) << 32) | ntohl(addr6[3]));
+
+  while (high - low > 1) {
+    mid = low + ((high - low) / 2);
+    if (lpm->v6_start[mid].hi < hi || (lpm->v6_start[mid].hi == hi && lpm->v6_start[mid].lo <= lo)) low = mid;
+    else high = mid;
+  }
+
+  return (lpm->v6_value[low] ? &lpm->prefixes[lpm->v6_value[low]] : NULL);
+}
+#endif
+
+/*
+   Lookups go through the snapshot published by the IS-IS thread after each
+   SPF run, see isis_spf.c: igp_src/igp_dst point into the snapshot, which
+   stays valid until the next packet. Route info is owned by the IS-IS thread
+   and hence is not exported.
+*/
 void isis_srcdst_lookup(struct packet_ptrs *pptrs)
 {
-  struct route_node *result;
-  struct isis_area *area;
-  char area_tag[] = "default";
-  int level;
+  struct isis_prefix *result;
   struct in_addr pref4;
 #if defined ENABLE_IPV6
   struct in6_addr pref6;
@@ -364,72 +417,57 @@ void isis_srcdst_lookup(struct packet_ptrs *pptrs)
   pptrs->igp_src_info = NULL;
   pptrs->igp_dst_info = NULL;
 
-  area = isis_area_lookup(area_tag);
-
-  if (area) {
-    level = MAX(area->is_type, 2);
+  if (isis_lpm_next) isis_lpm_swap();
+  if (!isis_lpm) return;
 
-    if (pptrs->l3_proto == ETHERTYPE_IP) {
-      if (!pptrs->igp_src) {
-	memcpy(&pref4, &((struct my_iphdr *)pptrs->iph_ptr)->ip_src, sizeof(struct in_addr));
-	result = route_node_match_ipv4(area->route_table[level-1], &pref4);
+  if (pptrs->l3_proto == ETHERTYPE_IP) {
+    memcpy(&pref4, &((struct my_iphdr *)pptrs->iph_ptr)->ip_src, sizeof(struct in_addr));
+    result = isis_lpm_search4(isis_lpm, &pref4);
 
-	if (result) {
-	  pptrs->igp_src = (char *) &result->p;
-	  pptrs->igp_src_info = (char *) result->info;
-	  if (result->p.prefixlen > pptrs->lm_mask_src) {
-	    pptrs->lm_mask_src = result->p.prefixlen;
-	    pptrs->lm_method_src = NF_NET_IGP;
-	  } 
-	}
+    if (result) {
+      pptrs->igp_src = (char *) result;
+      if (result->prefixlen > pptrs->lm_mask_src) {
+	pptrs->lm_mask_src = result->prefixlen;
+	pptrs->lm_method_src = NF_NET_IGP;
       }
+    }
+
+    memcpy(&pref4, &((struct my_iphdr *)pptrs->iph_ptr)->ip_dst, sizeof(struct in_addr));
+    result = isis_lpm_search4(isis_lpm, &pref4);
 
-      if (!pptrs->igp_dst) {
-	memcpy(&pref4, &((struct my_iphdr *)pptrs->iph_ptr)->ip_dst, sizeof(struct in_addr));
-	result = route_node_match_ipv4(area->route_table[level-1], &pref4);
-
-	if (result) {
-	  pptrs->igp_dst = (char *) &result->p;
-	  pptrs->igp_dst_info = (char *) result->info;
-          if (result->p.prefixlen > pptrs->lm_mask_dst) {
-            pptrs->lm_mask_dst = result->p.prefixlen;
-            pptrs->lm_method_dst = NF_NET_IGP;
-          }
-	}
+    if (result) {
+      pptrs->igp_dst = (char *) result;
+      if (result->prefixlen > pptrs->lm_mask_dst) {
+	pptrs->lm_mask_dst = result->prefixlen;
+	pptrs->lm_method_dst = NF_NET_IGP;
       }
     }
+  }
 #if defined ENABLE_IPV6
-    else if (area && pptrs->l3_proto == ETHERTYPE_IPV6) {
-      if (!pptrs->igp_src) {
-        memcpy(&pref6, &((struct ip6_hdr *)pptrs->iph_ptr)->ip6_src, sizeof(struct in6_addr));
-        result = route_node_match_ipv6(area->route_table6[level-1], &pref6);
-
-        if (result) {
-          pptrs->igp_src = (char *) &result->p;
-          pptrs->igp_src_info = (char *) result->info;
-          if (result->p.prefixlen > pptrs->lm_mask_src) {
-            pptrs->lm_mask_src = result->p.prefixlen;
-            pptrs->lm_method_src = NF_NET_IGP;
-          }
-        }
+  else if (pptrs->l3_proto == ETHERTYPE_IPV6) {
+    memcpy(&pref6, &((struct ip6_hdr *)pptrs->iph_ptr)->ip6_src, sizeof(struct in6_addr));
+    result = isis_lpm_search6(isis_lpm, &pref6);
+
+    if (result) {
+      pptrs->igp_src = (char *) result;
+      if (result->prefixlen > pptrs->lm_mask_src) {
+	pptrs->lm_mask_src = result->prefixlen;
+	pptrs->lm_method_src = NF_NET_IGP;
       }
+    }
+
+    memcpy(&pref6, &((struct ip6_hdr *)pptrs->iph_ptr)->ip6_dst, sizeof(struct in6_addr));
+    result = isis_lpm_search6(isis_lpm, &pref6);
 
-      if (!pptrs->igp_dst) {
-        memcpy(&pref6, &((struct ip6_hdr *)pptrs->iph_ptr)->ip6_dst, sizeof(struct in6_addr));
-        result = route_node_match_ipv6(area->route_table6[level-1], &pref6);
-
-	if (result) {
-	  pptrs->igp_dst = (char *) &result->p;
-	  pptrs->igp_dst_info = (char *) result->info;
-          if (result->p.prefixlen > pptrs->lm_mask_dst) {
-            pptrs->lm_mask_dst = result->p.prefixlen;
-            pptrs->lm_method_dst = NF_NET_IGP;
-          }
-	}
+    if (result) {
+      pptrs->igp_dst = (char *) result;
+      if (result->prefixlen > pptrs->lm_mask_dst) {
+	pptrs->lm_mask_dst = result->prefixlen;
+	pptrs->lm_method_dst = NF_NET_IGP;
       }
     }
-#endif
   }
+#endif
 }
 
 int igp_daemon_map_node_handler(char *filename, struct id_entry *e, char *value, struct plugin_requests *req, int acct_type)
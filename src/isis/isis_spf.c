@@ -184,6 +184,9 @@ remove_excess_adjs (struct list *adjs)
   return;
 }
 
+static unsigned int isis_vertex_hash_key (void *);
+static int isis_vertex_hash_cmp (const void *, const void *);
+
 static struct isis_spftree *
 isis_spftree_new ()
 {
@@ -196,8 +199,9 @@ isis_spftree_new ()
       return NULL;
     }
 
-  tree->tents = isis_list_new ();
   tree->paths = isis_list_new ();
+  tree->tents_idx = isis_hash_create_size (ISIS_SPF_IDX_SIZE, isis_vertex_hash_key, isis_vertex_hash_cmp);
+  tree->paths_idx = isis_hash_create_size (ISIS_SPF_IDX_SIZE, isis_vertex_hash_key, isis_vertex_hash_cmp);
   return tree;
 }
 
@@ -215,8 +219,10 @@ isis_vertex_del (struct isis_vertex *vertex)
 static void
 isis_spftree_del (struct isis_spftree *spftree)
 {
-  spftree->tents->del = (void (*)(void *)) isis_vertex_del;
-  isis_list_delete (spftree->tents);
+  while (spftree->tents_num) isis_vertex_del (spftree->tents[--spftree->tents_num]);
+  if (spftree->tents) free(spftree->tents);
+  isis_hash_free (spftree->tents_idx);
+  isis_hash_free (spftree->paths_idx);
 
   spftree->paths->del = (void (*)(void *)) isis_vertex_del;
   isis_list_delete (spftree->paths);
@@ -254,18 +260,9 @@ spftree_area_init (struct isis_area *area)
   return;
 }
 
-static struct isis_vertex *
-isis_vertex_new (void *id, enum vertextype vtype)
+static void
+isis_vertex_id_set (struct isis_vertex *vertex, void *id, enum vertextype vtype)
 {
-  struct isis_vertex *vertex;
-
-  vertex = calloc(1, sizeof (struct isis_vertex));
-  if (vertex == NULL)
-    {
-      Log(LOG_ERR, "ERROR ( %s/core/ISIS ): isis_vertex_new Out of memory!\n", config.name);
-      return NULL;
-    }
-
   vertex->type = vtype;
   switch (vtype)
     {
@@ -291,7 +288,21 @@ isis_vertex_new (void *id, enum vertextype vtype)
     default:
       Log(LOG_ERR, "ERROR ( %s/core/ISIS ): WTF!\n", config.name);
     }
+}
 
+static struct isis_vertex *
+isis_vertex_new (void *id, enum vertextype vtype)
+{
+  struct isis_vertex *vertex;
+
+  vertex = calloc(1, sizeof (struct isis_vertex));
+  if (vertex == NULL)
+    {
+      Log(LOG_ERR, "ERROR ( %s/core/ISIS ): isis_vertex_new Out of memory!\n", config.name);
+      return NULL;
+    }
+
+  isis_vertex_id_set (vertex, id, vtype);
   vertex->Adj_N = isis_list_new ();
 
   return vertex;
@@ -324,52 +335,178 @@ isis_spf_add_self (struct isis_spftree *spftree, struct isis_area *area,
   vertex->lsp = lsp;
 
   isis_listnode_add (spftree->paths, vertex);
+  isis_hash_get (spftree->paths_idx, vertex, isis_hash_alloc_intern);
 
   return;
 }
 
-static struct isis_vertex *
-isis_find_vertex (struct list *list, void *id, enum vertextype vtype)
+/* TENT and PATHS are indexed by vertex type and id */
+static unsigned int
+isis_vertex_hash_key (void *arg)
 {
-  struct listnode *node;
-  struct isis_vertex *vertex;
-  struct isis_prefix *p1, *p2;
+  struct isis_vertex *vertex = arg;
+  unsigned int key = vertex->type, len, idx;
+  u_char *ptr;
 
-  for (ALL_LIST_ELEMENTS_RO (list, node, vertex))
+  switch (vertex->type)
     {
-      if (vertex->type != vtype)
-	continue;
-      switch (vtype)
-	{
-	case VTYPE_ES:
-	case VTYPE_NONPSEUDO_IS:
-	case VTYPE_NONPSEUDO_TE_IS:
-	  if (memcmp ((u_char *) id, vertex->N.id, ISIS_SYS_ID_LEN) == 0)
-	    return vertex;
-	  break;
-	case VTYPE_PSEUDO_IS:
-	case VTYPE_PSEUDO_TE_IS:
-	  if (memcmp ((u_char *) id, vertex->N.id, ISIS_SYS_ID_LEN + 1) == 0)
-	    return vertex;
-	  break;
-	case VTYPE_IPREACH_INTERNAL:
-	case VTYPE_IPREACH_EXTERNAL:
-	case VTYPE_IPREACH_TE:
-#ifdef ENABLE_IPV6
-	case VTYPE_IP6REACH_INTERNAL:
-	case VTYPE_IP6REACH_EXTERNAL:
-#endif /* ENABLE_IPV6 */
-	  p1 = (struct isis_prefix *) id;
-	  p2 = (struct isis_prefix *) &vertex->N.id;
-	  if (p1->family == p2->family && p1->prefixlen == p2->prefixlen &&
-	      memcmp (&p1->u.prefix, &p2->u.prefix,
-		      PSIZE (p1->prefixlen)) == 0)
-	    return vertex;
-	  break;
-	}
+    case VTYPE_ES:
+    case VTYPE_NONPSEUDO_IS:
+    case VTYPE_NONPSEUDO_TE_IS:
+      ptr = vertex->N.id;
+      len = ISIS_SYS_ID_LEN;
+      break;
+    case VTYPE_PSEUDO_IS:
+    case VTYPE_PSEUDO_TE_IS:
+      ptr = vertex->N.id;
+      len = ISIS_SYS_ID_LEN + 1;
+      break;
+    default:
+      key = (key * 33) ^ vertex->N.prefix.prefixlen;
+      ptr = (u_char *) &vertex->N.prefix.u.prefix;
+      len = PSIZE (vertex->N.prefix.prefixlen);
+      break;
+    }
+
+  for (idx = 0; idx < len; idx++)
+    key = (key * 33) ^ ptr[idx];
+
+  return key;
+}
+
+static int
+isis_vertex_hash_cmp (const void *arg1, const void *arg2)
+{
+  const struct isis_vertex *v1 = arg1, *v2 = arg2;
+  const struct isis_prefix *p1, *p2;
+
+  if (v1->type != v2->type)
+    return FALSE;
+
+  switch (v1->type)
+    {
+    case VTYPE_ES:
+    case VTYPE_NONPSEUDO_IS:
+    case VTYPE_NONPSEUDO_TE_IS:
+      return (memcmp (v1->N.id, v2->N.id, ISIS_SYS_ID_LEN) == 0);
+    case VTYPE_PSEUDO_IS:
+    case VTYPE_PSEUDO_TE_IS:
+      return (memcmp (v1->N.id, v2->N.id, ISIS_SYS_ID_LEN + 1) == 0);
+    default:
+      p1 = &v1->N.prefix;
+      p2 = &v2->N.prefix;
+      return (p1->family == p2->family && p1->prefixlen == p2->prefixlen &&
+	      memcmp (&p1->u.prefix, &p2->u.prefix, PSIZE (p1->prefixlen)) == 0);
+    }
+}
+
+static struct isis_vertex *
+isis_find_vertex (struct hash *idx, void *id, enum vertextype vtype)
+{
+  struct isis_vertex key;
+
+  memset (&key, 0, sizeof (key));
+  isis_vertex_id_set (&key, id, vtype);
+
+  return isis_hash_lookup (idx, &key);
+}
+
+/*
+ * TENT is a binary heap ordered by cost, then by vertextype, then first
+ * come first served: the order in which equal vertices are settled, which
+ * sets their depth, depends on the SPT alone, not on the leaves sitting in
+ * TENT. Each vertex knows its slot so that it can be removed in place.
+ */
+static int
+isis_tent_before (struct isis_vertex *a, struct isis_vertex *b)
+{
+  if (a->d_N != b->d_N) return (a->d_N < b->d_N);
+  if (a->type != b->type) return (a->type < b->type);
+
+  return (a->tent_seq < b->tent_seq);
+}
+
+static void
+isis_tent_set (struct isis_spftree *spftree, u_int32_t pos, struct isis_vertex *vertex)
+{
+  spftree->tents[pos] = vertex;
+  vertex->tent_pos = pos;
+}
+
+static void
+isis_tent_up (struct isis_spftree *spftree, u_int32_t pos)
+{
+  struct isis_vertex *vertex = spftree->tents[pos];
+  u_int32_t parent;
+
+  while (pos) {
+    parent = (pos - 1) / 2;
+    if (!isis_tent_before(vertex, spftree->tents[parent])) break;
+    isis_tent_set(spftree, pos, spftree->tents[parent]);
+    pos = parent;
+  }
+
+  isis_tent_set(spftree, pos, vertex);
+}
+
+static void
+isis_tent_down (struct isis_spftree *spftree, u_int32_t pos)
+{
+  struct isis_vertex *vertex = spftree->tents[pos];
+  u_int32_t child;
+
+  while ((child = (2 * pos) + 1) < spftree->tents_num) {
+    if (child + 1 < spftree->tents_num &&
+	isis_tent_before(spftree->tents[child + 1], spftree->tents[child])) child++;
+    if (!isis_tent_before(spftree->tents[child], vertex)) break;
+    isis_tent_set(spftree, pos, spftree->tents[child]);
+    pos = child;
+  }
+
+  isis_tent_set(spftree, pos, vertex);
+}
+
+static int
+isis_tent_add (struct isis_spftree *spftree, struct isis_vertex *vertex)
+{
+  struct isis_vertex **tents;
+  u_int32_t alloc;
+
+  if (spftree->tents_num == spftree->tents_alloc) {
+    alloc = spftree->tents_alloc ? (spftree->tents_alloc * 2) : ISIS_SPF_IDX_SIZE;
+    tents = realloc(spftree->tents, (alloc * sizeof(struct isis_vertex *)));
+    if (!tents) {
+      Log(LOG_ERR, "ERROR ( %s/core/ISIS ): ISIS-Spf: isis_tent_add Out of memory!\n", config.name);
+      return ERR;
     }
 
-  return NULL;
+    spftree->tents = tents;
+    spftree->tents_alloc = alloc;
+  }
+
+  vertex->tent_seq = spftree->tents_seq++;
+  isis_tent_set(spftree, spftree->tents_num++, vertex);
+  isis_tent_up(spftree, vertex->tent_pos);
+  isis_hash_get(spftree->tents_idx, vertex, isis_hash_alloc_intern);
+
+  return SUCCESS;
+}
+
+static void
+isis_tent_del (struct isis_spftree *spftree, struct isis_vertex *vertex)
+{
+  u_int32_t pos = vertex->tent_pos;
+
+  isis_hash_release(spftree->tents_idx, vertex);
+
+  spftree->tents_num--;
+  if (pos == spftree->tents_num) return;
+
+  isis_tent_set(spftree, pos, spftree->tents[spftree->tents_num]);
+  if (pos && isis_tent_before(spftree->tents[pos], spftree->tents[(pos - 1) / 2]))
+    isis_tent_up(spftree, pos);
+  else
+    isis_tent_down(spftree, pos);
 }
 
 /*
@@ -380,8 +517,7 @@ isis_spf_add2tent (struct isis_spftree *spftree, enum vertextype vtype,
 		   void *id, struct isis_adjacency *adj, u_int32_t cost,
 		   int depth, int family)
 {
-  struct isis_vertex *vertex, *v;
-  struct listnode *node;
+  struct isis_vertex *vertex;
 
   u_char buff[BUFSIZ];
 
@@ -397,44 +533,12 @@ isis_spf_add2tent (struct isis_spftree *spftree, enum vertextype vtype,
               config.name, vtype2string (vertex->type), vid2string (vertex, buff),
               vertex->depth, vertex->d_N);
 
-  isis_listnode_add (spftree->tents, vertex);
-  if (isis_list_isempty (spftree->tents))
+  if (isis_tent_add (spftree, vertex) == ERR)
     {
-      isis_listnode_add (spftree->tents, vertex);
-      return vertex;
-    }
-  
-  /* XXX: This cant use the standard ALL_LIST_ELEMENT macro */
-  for (node = listhead (spftree->tents); node; node = listnextnode (node))
-    {
-      v = listgetdata (node);
-      if (v->d_N > vertex->d_N)
-	{
-	  isis_list_add_node_prev (spftree->tents, node, vertex);
-	  break;
-	}
-      else if (v->d_N == vertex->d_N)
-	{
-	  /*  Tie break, add according to type */
-	  while (v && v->d_N == vertex->d_N && v->type > vertex->type)
-	    {
-	      if (v->type > vertex->type)
-		{
-		  break;
-		}
-              /* XXX: this seems dubious, node is the loop iterator */
-	      node = listnextnode (node);
-	      (node) ? (v = listgetdata (node)) : (v = NULL);
-	    }
-	  isis_list_add_node_prev (spftree->tents, node, vertex);
-	  break;
-	}
-      else if (node->next == NULL)
-	{
-	  isis_list_add_node_next (spftree->tents, node, vertex);
-	  break;
-	}
+      isis_vertex_del (vertex);
+      return NULL;
     }
+
   return vertex;
 }
 
@@ -445,7 +549,7 @@ isis_spf_add_local (struct isis_spftree *spftree, enum vertextype vtype,
 {
   struct isis_vertex *vertex;
 
-  vertex = isis_find_vertex (spftree->tents, id, vtype);
+  vertex = isis_find_vertex (spftree->tents_idx, id, vtype);
 
   if (vertex)
     {
@@ -461,7 +565,8 @@ isis_spf_add_local (struct isis_spftree *spftree, enum vertextype vtype,
       /*         f) */
       else if (vertex->d_N > cost)
 	{
-	  isis_listnode_delete (spftree->tents, vertex);
+	  isis_tent_del (spftree, vertex);
+	  isis_vertex_del (vertex);
 	  goto add2tent;
 	}
       /*       e) do nothing */
@@ -483,14 +588,14 @@ process_N (struct isis_spftree *spftree, enum vertextype vtype, void *id,
   if (dist > MAX_PATH_METRIC)
     return;
   /*       c)    */
-  vertex = isis_find_vertex (spftree->paths, id, vtype);
+  vertex = isis_find_vertex (spftree->paths_idx, id, vtype);
   if (vertex)
     {
       assert (dist >= vertex->d_N);
       return;
     }
 
-  vertex = isis_find_vertex (spftree->tents, id, vtype);
+  vertex = isis_find_vertex (spftree->tents_idx, id, vtype);
   /*       d)    */
   if (vertex)
     {
@@ -512,7 +617,8 @@ process_N (struct isis_spftree *spftree, enum vertextype vtype, void *id,
 	}
       else
 	{
-	  isis_listnode_delete (spftree->tents, vertex);
+	  isis_tent_del (spftree, vertex);
+	  isis_vertex_del (vertex);
 	}
     }
 
@@ -521,11 +627,11 @@ process_N (struct isis_spftree *spftree, enum vertextype vtype, void *id,
 }
 
 /*
- * C.2.6 Step 1
+ * C.2.6 Step 1; prc: IS neighbours are skipped, the SPT being already there
  */
 static int
 isis_spf_process_lsp (struct isis_spftree *spftree, struct isis_lsp *lsp,
-		      uint32_t cost, uint16_t depth, int family)
+		      uint32_t cost, uint16_t depth, int family, int prc)
 {
   struct listnode *node, *fragnode = NULL;
   u_int16_t dist;
@@ -554,7 +660,7 @@ lspfragloop:
 
   if (!ISIS_MASK_LSP_OL_BIT (lsp->lsp_header->lsp_bits))
     {
-      if (lsp->tlv_data.is_neighs)
+      if (!prc && lsp->tlv_data.is_neighs)
 	{
           for (ALL_LIST_ELEMENTS_RO (lsp->tlv_data.is_neighs, node, is_neigh))
 	    {
@@ -569,7 +675,7 @@ lspfragloop:
 			 depth + 1, lsp->adj, family);
 	    }
 	}
-      if (lsp->tlv_data.te_is_neighs)
+      if (!prc && lsp->tlv_data.te_is_neighs)
 	{
 	  for (ALL_LIST_ELEMENTS_RO (lsp->tlv_data.te_is_neighs, node,
 				     te_is_neigh))
@@ -700,15 +806,9 @@ pseudofragloop:
 	/* Two way connectivity */
 	if (!memcmp (is_neigh->neigh_id, isis->sysid, ISIS_SYS_ID_LEN))
 	  continue;
-	if (isis_find_vertex
-	    (spftree->tents, (void *) is_neigh->neigh_id, vtype) == NULL
-	    && isis_find_vertex (spftree->paths, (void *) is_neigh->neigh_id,
-			       vtype) == NULL)
-	  {
-	    /* C.2.5 i) */
-	    isis_spf_add2tent (spftree, vtype, is_neigh->neigh_id, lsp->adj,
-			     cost, depth, family);
-	  }
+	/* zero cost edges, a shorter path may be sitting in TENT already */
+	process_N (spftree, vtype, (void *) is_neigh->neigh_id, cost, depth,
+		   lsp->adj, family);
       }
   if (lsp->tlv_data.te_is_neighs)
     for (ALL_LIST_ELEMENTS_RO (lsp->tlv_data.te_is_neighs, node, te_is_neigh))
@@ -718,15 +818,8 @@ pseudofragloop:
 	/* Two way connectivity */
 	if (!memcmp (te_is_neigh->neigh_id, isis->sysid, ISIS_SYS_ID_LEN))
 	  continue;
-	if (isis_find_vertex
-	    (spftree->tents, (void *) te_is_neigh->neigh_id, vtype) == NULL
-	    && isis_find_vertex (spftree->paths, (void *) te_is_neigh->neigh_id,
-				 vtype) == NULL)
-	  {
-	    /* C.2.5 i) */
-	    isis_spf_add2tent (spftree, vtype, te_is_neigh->neigh_id, lsp->adj,
-			       cost, depth, family);
-	  }
+	process_N (spftree, vtype, (void *) te_is_neigh->neigh_id, cost, depth,
+		   lsp->adj, family);
       }
 
   if (fragnode == NULL)
@@ -743,9 +836,10 @@ pseudofragloop:
   return ISIS_OK;
 }
 
+/* prc: only the local prefixes are loaded, the SPT being already there */
 static int
 isis_spf_preload_tent (struct isis_spftree *spftree,
-		       struct isis_area *area, int level, int family)
+		       struct isis_area *area, int level, int family, int prc)
 {
   struct isis_vertex *vertex;
   struct isis_circuit *circuit;
@@ -801,6 +895,8 @@ isis_spf_preload_tent (struct isis_spftree *spftree,
 	    }
 	}
 #endif /* ENABLE_IPV6 */
+      if (prc)
+	continue;
       if (circuit->circ_type == CIRCUIT_T_P2P)
 	{
 	  adj = circuit->u.p2p.neighbor;
@@ -845,6 +941,7 @@ add_to_paths (struct isis_spftree *spftree, struct isis_vertex *vertex,
 	      struct isis_area *area, int level)
 {
   isis_listnode_add (spftree->paths, vertex);
+  isis_hash_get (spftree->paths_idx, vertex, isis_hash_alloc_intern);
 
   if (vertex->type > VTYPE_ES)
     {
@@ -879,12 +976,692 @@ add_to_paths (struct isis_spftree *spftree, struct isis_vertex *vertex,
 static void
 init_spt (struct isis_spftree *spftree)
 {
-  spftree->tents->del = spftree->paths->del = (void (*)(void *)) isis_vertex_del;
-  isis_list_delete_all_node (spftree->tents);
+  while (spftree->tents_num) isis_vertex_del (spftree->tents[--spftree->tents_num]);
+  spftree->tents_seq = 0;
+
+  spftree->paths->del = (void (*)(void *)) isis_vertex_del;
   isis_list_delete_all_node (spftree->paths);
-  spftree->tents->del = spftree->paths->del = NULL;
+  spftree->paths->del = NULL;
+  isis_hash_clean (spftree->tents_idx, NULL);
+  isis_hash_clean (spftree->paths_idx, NULL);
+
+  return;
+}
+
+void
+isis_lpm_free (struct isis_lpm *lpm)
+{
+  if (!lpm) return;
+
+  if (lpm->v4_start) free(lpm->v4_start);
+  if (lpm->v4_value) free(lpm->v4_value);
+  if (lpm->v6_start) free(lpm->v6_start);
+  if (lpm->v6_value) free(lpm->v6_value);
+  if (lpm->prefixes) free(lpm->prefixes);
+  free(lpm);
+}
+
+static int
+isis_lpm_grow (void **ptr, u_int32_t alloc, size_t elem_sz)
+{
+  void *new_ptr;
+
+  new_ptr = realloc((*ptr), (alloc * elem_sz));
+  if (!new_ptr) return ERR;
+
+  (*ptr) = new_ptr;
+
+  return SUCCESS;
+}
+
+/* appends a range starting at hi/lo; a range starting at the same address is replaced */
+static int
+isis_lpm_emit (struct isis_lpm *lpm, int width, u_int64_t hi, u_int64_t lo, u_int32_t value)
+{
+  if (width == 32) {
+    if (lpm->v4_num && lpm->v4_start[lpm->v4_num-1] == (u_int32_t) lo) {
+      lpm->v4_value[lpm->v4_num-1] = value;
+      if (lpm->v4_num > 1 && lpm->v4_value[lpm->v4_num-2] == value) lpm->v4_num--;
+      return SUCCESS;
+    }
+
+    if (lpm->v4_num && lpm->v4_value[lpm->v4_num-1] == value) return SUCCESS;
+
+    if (lpm->v4_num == lpm->v4_alloc) {
+      lpm->v4_alloc = (lpm->v4_alloc ? (lpm->v4_alloc * 2) : 1024);
+      if (isis_lpm_grow((void **) &lpm->v4_start, lpm->v4_alloc, sizeof(u_int32_t)) == ERR) return ERR;
+      if (isis_lpm_grow((void **) &lpm->v4_value, lpm->v4_alloc, sizeof(u_int32_t)) == ERR) return ERR;
+    }
+
+    lpm->v4_start[lpm->v4_num] = (u_int32_t) lo;
+    lpm->v4_value[lpm->v4_num] = value;
+    lpm->v4_num++;
+  }
+  else {
+    if (lpm->v6_num && lpm->v6_start[lpm->v6_num-1].hi == hi && lpm->v6_start[lpm->v6_num-1].lo == lo) {
+      lpm->v6_value[lpm->v6_num-1] = value;
+      if (lpm->v6_num > 1 && lpm->v6_value[lpm->v6_num-2] == value) lpm->v6_num--;
+      return SUCCESS;
+    }
+
+    if (lpm->v6_num && lpm->v6_value[lpm->v6_num-1] == value) return SUCCESS;
+
+    if (lpm->v6_num == lpm->v6_alloc) {
+      lpm->v6_alloc = (lpm->v6_alloc ? (lpm->v6_alloc * 2) : 1024);
+      if (isis_lpm_grow((void **) &lpm->v6_start, lpm->v6_alloc, sizeof(struct isis_lpm_addr6)) == ERR) return ERR;
+      if (isis_lpm_grow((void **) &lpm->v6_value, lpm->v6_alloc, sizeof(u_int32_t)) == ERR) return ERR;
+    }
+
+    lpm->v6_start[lpm->v6_num].hi = hi;
+    lpm->v6_start[lpm->v6_num].lo = lo;
+    lpm->v6_value[lpm->v6_num] = value;
+    lpm->v6_num++;
+  }
+
+  return SUCCESS;
+}
+
+/* first and last address covered by a prefix, host byte order */
+static void
+isis_lpm_bounds (struct isis_prefix *p, int width, struct isis_lpm_addr6 *start, struct isis_lpm_addr6 *end)
+{
+  u_int64_t hi_mask, lo_mask;
+
+  memset(start, 0, sizeof(struct isis_lpm_addr6));
+
+  if (width == 32) {
+    start->lo = ntohl(p->u.prefix4.s_addr);
+    hi_mask = 0;
+    lo_mask = ((p->prefixlen >= 32) ? 0 : (0xFFFFFFFFULL >> p->prefixlen));
+  }
+#ifdef ENABLE_IPV6
+  else {
+    u_int32_t addr6[4];
+
+    memcpy(addr6, &p->u.prefix6, 16);
+    start->hi = ((((u_int64_t) ntohl(addr6[0])) << 32) | ntohl(addr6[1]));
+    start->lo = ((((u_int64_t) ntohl(addr6[2])) << 32) | ntohl(addr6[3]));
+
+    if (p->prefixlen < 64) {
+      hi_mask = (~0ULL >> p->prefixlen);
+      lo_mask = ~0ULL;
+    }
+    else {
+      hi_mask = 0;
+      lo_mask = ((p->prefixlen >= 128) ? 0 : (~0ULL >> (p->prefixlen - 64)));
+    }
+  }
+#endif
+
+  start->hi &= ~hi_mask;
+  start->lo &= ~lo_mask;
+  end->hi = (start->hi | hi_mask);
+  end->lo = (start->lo | lo_mask);
+}
+
+/*
+   Walks the route table in order, ie. parent prefixes before the ones they
+   cover and, the rest, in ascending address order: a stack of the prefixes
+   still open tells which one takes over once a more specific one ends.
+*/
+static int
+isis_lpm_walk (struct isis_lpm *lpm, struct route_table *table, int width)
+{
+  struct {
+    struct isis_lpm_addr6 end;
+    u_int32_t value;
+  } stack[IPV6_MAX_BITLEN + 1];
+  struct isis_lpm_addr6 start, end, next;
+  struct route_node *rnode;
+  struct isis_route_info *rinfo;
+  int depth = 0, closing;
+
+  if (isis_lpm_emit(lpm, width, 0, 0, 0) == ERR) return ERR;
+
+  for (rnode = route_top (table); rnode || depth; rnode = (rnode ? route_next (rnode) : NULL))
+    {
+      if (rnode)
+	{
+	  rinfo = rnode->info;
+	  if (!rinfo || !CHECK_FLAG (rinfo->flag, ISIS_ROUTE_FLAG_ACTIVE))
+	    continue;
+
+	  isis_lpm_bounds (&rnode->p, width, &start, &end);
+	}
+
+      /* close the prefixes ending before this one, or all of them at the end of the table */
+      for (;;)
+	{
+	  if (!depth) break;
+	  closing = (!rnode || stack[depth-1].end.hi < start.hi ||
+		     (stack[depth-1].end.hi == start.hi && stack[depth-1].end.lo < start.lo));
+	  if (!closing) break;
+
+	  depth--;
+	  next = stack[depth].end;
+	  if (width == 32 && next.lo == 0xFFFFFFFFULL) continue;
+	  if (width != 32 && next.hi == ~0ULL && next.lo == ~0ULL) continue;
+
+	  next.lo++;
+	  if (!next.lo) next.hi++;
+
+	  if (isis_lpm_emit(lpm, width, next.hi, next.lo, (depth ? stack[depth-1].value : 0)) == ERR) return ERR;
+	}
+
+      if (!rnode) break;
+
+      if (lpm->prefixes_num == lpm->prefixes_alloc)
+	{
+	  lpm->prefixes_alloc = (lpm->prefixes_alloc ? (lpm->prefixes_alloc * 2) : 1024);
+	  if (isis_lpm_grow((void **) &lpm->prefixes, lpm->prefixes_alloc, sizeof(struct isis_prefix)) == ERR) return ERR;
+	}
+
+      memcpy(&lpm->prefixes[lpm->prefixes_num], &rnode->p, sizeof(struct isis_prefix));
+
+      stack[depth].end = end;
+      stack[depth].value = lpm->prefixes_num;
+      depth++;
+      lpm->prefixes_num++;
+
+      if (isis_lpm_emit(lpm, width, start.hi, start.lo, stack[depth-1].value) == ERR) return ERR;
+    }
+
+  return SUCCESS;
+}
+
+/*
+   Publishes a new snapshot of the routes of the level used for flow
+   correlation: L2, unless the area is L1-only. A snapshot not yet swapped
+   in by the Core Process is simply replaced.
+*/
+static void
+isis_lpm_publish (struct isis_area *area, int level)
+{
+  struct isis_lpm *lpm, *old;
+  int lpm_level = ((area->is_type & IS_LEVEL_2) ? 2 : 1);
+
+  if (level != lpm_level || !area->area_tag || strcmp (area->area_tag, "default"))
+    return;
+
+  lpm = calloc(1, sizeof(struct isis_lpm));
+  if (!lpm) goto failed;
+
+  /* prefixes[0]: no route */
+  lpm->prefixes_alloc = 1024;
+  lpm->prefixes = calloc(lpm->prefixes_alloc, sizeof(struct isis_prefix));
+  if (!lpm->prefixes) goto failed;
+  lpm->prefixes_num = 1;
+
+  if (isis_lpm_walk (lpm, area->route_table[level - 1], 32) == ERR) goto failed;
+#ifdef ENABLE_IPV6
+  if (isis_lpm_walk (lpm, area->route_table6[level - 1], 128) == ERR) goto failed;
+#endif
+
+  /* contents must be visible before the pointer */
+  __sync_synchronize();
+  old = __sync_lock_test_and_set(&isis_lpm_next, lpm);
+  isis_lpm_free(old);
+
+  Log(LOG_DEBUG, "DEBUG ( %s/core/ISIS ): ISIS-Spf (tag: %s, level: %u): lookup snapshot published (prefixes: %u)\n",
+      config.name, area->area_tag, level, lpm->prefixes_num - 1);
 
   return;
+
+failed:
+  Log(LOG_WARNING, "WARN ( %s/core/ISIS ): ISIS-Spf (tag: %s, level: %u): unable to build lookup snapshot\n",
+      config.name, area->area_tag, level);
+  isis_lpm_free(lpm);
+}
+
+/*
+   Incremental SPF. Each run summarises the LSP database (struct
+   isis_spf_db) and compares it against the summary the current SPT was
+   computed from. Changes confined to LSPs of systems not in the SPT, and
+   refreshes, need no run at all; IP reachability changes and IS
+   neighbours added or removed with slack, ie. towards a vertex already
+   in the SPT at a shorter distance than the edge could offer, leave the
+   SPT untouched and only the leaves are recomputed (PRC) off the kept IS
+   vertices. Anything else, ie. local circuits and adjacencies, an LSP of
+   a system in the SPT appearing, disappearing or changing adjacency,
+   nlpids or OL bit, or a tight edge, triggers a full SPF.
+*/
+#define ISIS_SPF_HASH_INIT	0xcbf29ce484222325ULL
+
+static u_int64_t
+isis_spf_hash (u_int64_t hash, void *data, size_t len)
+{
+  u_char *ptr = data;
+  size_t idx;
+
+  for (idx = 0; idx < len; idx++) {
+    hash ^= ptr[idx];
+    hash *= 0x100000001b3ULL;
+  }
+
+  return hash;
+}
+
+static int
+isis_spf_edge_cmp (const void *a, const void *b)
+{
+  const struct isis_spf_edge *e1 = a, *e2 = b;
+  int ret;
+
+  ret = memcmp(e1->id, e2->id, ISIS_SYS_ID_LEN + 1);
+  if (ret) return ret;
+
+  if (e1->vtype != e2->vtype) return ((e1->vtype < e2->vtype) ? -1 : 1);
+  if (e1->metric != e2->metric) return ((e1->metric < e2->metric) ? -1 : 1);
+
+  return 0;
+}
+
+static int
+isis_spf_db_edge (struct isis_spf_db *db, u_char *id, enum vertextype vtype, u_int32_t metric)
+{
+  struct isis_spf_edge *edge;
+  u_int32_t alloc;
+
+  if (db->edges_num == db->edges_alloc) {
+    alloc = (db->edges_alloc ? (db->edges_alloc * 2) : 1024);
+    if (isis_lpm_grow((void **) &db->edges, alloc, sizeof(struct isis_spf_edge)) == ERR) return ERR;
+    db->edges_alloc = alloc;
+  }
+
+  edge = &db->edges[db->edges_num];
+  memset(edge, 0, sizeof(struct isis_spf_edge));
+  memcpy(edge->id, id, ISIS_SYS_ID_LEN + 1);
+  edge->vtype = vtype;
+  edge->metric = metric;
+  db->edges_num++;
+
+  return SUCCESS;
+}
+
+/* hashes IP reachability of an LSP the way isis_spf_process_lsp() reads it */
+static u_int64_t
+isis_spf_db_prefixes (struct isis_lsp *lsp)
+{
+  struct listnode *node;
+  struct ipv4_reachability *ipreach;
+  struct te_ipv4_reachability *te_ipv4_reach;
+  struct in_addr addr;
+  u_int64_t hash = ISIS_SPF_HASH_INIT;
+  u_int32_t value;
+#ifdef ENABLE_IPV6
+  struct ipv6_reachability *ip6reach;
+#endif
+
+  if (lsp->tlv_data.ipv4_addrs)
+    hash = isis_spf_hash(hash, isis_listnode_head(lsp->tlv_data.ipv4_addrs), sizeof(struct in_addr));
+
+  if (lsp->tlv_data.ipv4_int_reachs) {
+    for (ALL_LIST_ELEMENTS_RO (lsp->tlv_data.ipv4_int_reachs, node, ipreach)) {
+      value = (VTYPE_IPREACH_INTERNAL << 8) | ipreach->metrics.metric_default;
+      hash = isis_spf_hash(hash, &value, sizeof(value));
+      hash = isis_spf_hash(hash, &ipreach->prefix, sizeof(struct in_addr));
+      hash = isis_spf_hash(hash, &ipreach->mask, sizeof(struct in_addr));
+    }
+  }
+
+  if (lsp->tlv_data.ipv4_ext_reachs) {
+    for (ALL_LIST_ELEMENTS_RO (lsp->tlv_data.ipv4_ext_reachs, node, ipreach)) {
+      value = (VTYPE_IPREACH_EXTERNAL << 8) | ipreach->metrics.metric_default;
+      hash = isis_spf_hash(hash, &value, sizeof(value));
+      hash = isis_spf_hash(hash, &ipreach->prefix, sizeof(struct in_addr));
+      hash = isis_spf_hash(hash, &ipreach->mask, sizeof(struct in_addr));
+    }
+  }
+
+  if (lsp->tlv_data.te_ipv4_reachs) {
+    for (ALL_LIST_ELEMENTS_RO (lsp->tlv_data.te_ipv4_reachs, node, te_ipv4_reach)) {
+      addr = newprefix2inaddr (&te_ipv4_reach->prefix_start, te_ipv4_reach->control);
+      value = ntohl (te_ipv4_reach->te_metric);
+      hash = isis_spf_hash(hash, &value, sizeof(value));
+      hash = isis_spf_hash(hash, &te_ipv4_reach->control, sizeof(te_ipv4_reach->control));
+      hash = isis_spf_hash(hash, &addr, sizeof(struct in_addr));
+    }
+  }
+
+#ifdef ENABLE_IPV6
+  if (lsp->tlv_data.ipv6_reachs) {
+    for (ALL_LIST_ELEMENTS_RO (lsp->tlv_data.ipv6_reachs, node, ip6reach)) {
+      hash = isis_spf_hash(hash, &ip6reach->metric, sizeof(ip6reach->metric));
+      hash = isis_spf_hash(hash, &ip6reach->control_info, sizeof(ip6reach->control_info));
+      hash = isis_spf_hash(hash, &ip6reach->prefix_len, sizeof(ip6reach->prefix_len));
+      hash = isis_spf_hash(hash, ip6reach->prefix, PSIZE (ip6reach->prefix_len));
+    }
+  }
+#endif
+
+  return hash;
+}
+
+static int
+isis_spf_db_lsp (struct isis_spf_db *db, struct isis_lsp *lsp, int family)
+{
+  struct isis_spf_lsp *entry;
+  struct listnode *node;
+  struct is_neigh *is_neigh;
+  struct te_is_neigh *te_is_neigh;
+  enum vertextype vtype;
+  u_int32_t alloc, metric;
+  u_int8_t value;
+
+  if (db->lsps_num == db->lsps_alloc) {
+    alloc = (db->lsps_alloc ? (db->lsps_alloc * 2) : 256);
+    if (isis_lpm_grow((void **) &db->lsps, alloc, sizeof(struct isis_spf_lsp)) == ERR) return ERR;
+    db->lsps_alloc = alloc;
+  }
+
+  entry = &db->lsps[db->lsps_num];
+  memcpy(entry->lsp_id, lsp->lsp_header->lsp_id, ISIS_SYS_ID_LEN + 2);
+
+  entry->attr = isis_spf_hash(ISIS_SPF_HASH_INIT, &lsp->adj, sizeof(lsp->adj));
+  value = (lsp->tlv_data.nlpids && speaks (lsp->tlv_data.nlpids, family));
+  entry->attr = isis_spf_hash(entry->attr, &value, sizeof(value));
+  value = ISIS_MASK_LSP_OL_BIT (lsp->lsp_header->lsp_bits);
+  entry->attr = isis_spf_hash(entry->attr, &value, sizeof(value));
+  value = (lsp->lsp_header->seq_num == 0);
+  entry->attr = isis_spf_hash(entry->attr, &value, sizeof(value));
+
+  entry->prefixes = isis_spf_db_prefixes(lsp);
+
+  entry->edges = db->edges_num;
+
+  if (lsp->tlv_data.is_neighs) {
+    for (ALL_LIST_ELEMENTS_RO (lsp->tlv_data.is_neighs, node, is_neigh)) {
+      vtype = LSP_PSEUDO_ID (is_neigh->neigh_id) ? VTYPE_PSEUDO_IS : VTYPE_NONPSEUDO_IS;
+      if (isis_spf_db_edge(db, is_neigh->neigh_id, vtype, is_neigh->metrics.metric_default) == ERR) return ERR;
+    }
+  }
+
+  if (lsp->tlv_data.te_is_neighs) {
+    for (ALL_LIST_ELEMENTS_RO (lsp->tlv_data.te_is_neighs, node, te_is_neigh)) {
+      vtype = LSP_PSEUDO_ID (te_is_neigh->neigh_id) ? VTYPE_PSEUDO_TE_IS : VTYPE_NONPSEUDO_TE_IS;
+      metric = 0;
+      memcpy(&metric, te_is_neigh->te_metric, 3);
+      if (isis_spf_db_edge(db, te_is_neigh->neigh_id, vtype, ntohl (metric << 8)) == ERR) return ERR;
+    }
+  }
+
+  entry->edges_num = (db->edges_num - entry->edges);
+  if (entry->edges_num > 1)
+    qsort(&db->edges[entry->edges], entry->edges_num, sizeof(struct isis_spf_edge), isis_spf_edge_cmp);
+
+  db->lsps_num++;
+
+  return SUCCESS;
+}
+
+/* hashes what isis_spf_preload_tent() reads */
+static void
+isis_spf_db_local (struct isis_spf_db *db, struct isis_area *area, int level, int family)
+{
+  struct listnode *cnode, *ipnode;
+  struct isis_circuit *circuit;
+  struct isis_adjacency *adj;
+  struct prefix_ipv4 *ipv4;
+  u_int32_t value;
+#ifdef ENABLE_IPV6
+  struct prefix_ipv6 *ipv6;
+#endif
+
+  db->local_attr = isis_spf_hash(ISIS_SPF_HASH_INIT, isis->sysid, ISIS_SYS_ID_LEN);
+  db->local_attr = isis_spf_hash(db->local_attr, &area->oldmetric, sizeof(area->oldmetric));
+  db->local_prefixes = ISIS_SPF_HASH_INIT;
+
+  for (ALL_LIST_ELEMENTS_RO (area->circuit_list, cnode, circuit)) {
+    db->local_attr = isis_spf_hash(db->local_attr, &circuit, sizeof(circuit));
+    db->local_attr = isis_spf_hash(db->local_attr, &circuit->state, sizeof(circuit->state));
+    value = (circuit->circuit_is_type & level);
+    db->local_attr = isis_spf_hash(db->local_attr, &value, sizeof(value));
+    db->local_attr = isis_spf_hash(db->local_attr, &circuit->ip_router, sizeof(circuit->ip_router));
+#ifdef ENABLE_IPV6
+    db->local_attr = isis_spf_hash(db->local_attr, &circuit->ipv6_router, sizeof(circuit->ipv6_router));
+#endif
+    db->local_attr = isis_spf_hash(db->local_attr, &circuit->circ_type, sizeof(circuit->circ_type));
+    db->local_attr = isis_spf_hash(db->local_attr, &circuit->te_metric[level - 1], sizeof(circuit->te_metric[level - 1]));
+
+    if (circuit->circ_type == CIRCUIT_T_P2P) {
+      adj = circuit->u.p2p.neighbor;
+      db->local_attr = isis_spf_hash(db->local_attr, &adj, sizeof(adj));
+
+      if (adj) {
+	db->local_attr = isis_spf_hash(db->local_attr, adj->sysid, ISIS_SYS_ID_LEN);
+	db->local_attr = isis_spf_hash(db->local_attr, &adj->sys_type, sizeof(adj->sys_type));
+	value = speaks (&adj->nlpids, family);
+	db->local_attr = isis_spf_hash(db->local_attr, &value, sizeof(value));
+      }
+    }
+
+    if (family == AF_INET && circuit->ip_addrs) {
+      for (ALL_LIST_ELEMENTS_RO (circuit->ip_addrs, ipnode, ipv4)) {
+	db->local_prefixes = isis_spf_hash(db->local_prefixes, &ipv4->prefix, sizeof(ipv4->prefix));
+	db->local_prefixes = isis_spf_hash(db->local_prefixes, &ipv4->prefixlen, sizeof(ipv4->prefixlen));
+      }
+    }
+#ifdef ENABLE_IPV6
+    if (family == AF_INET6 && circuit->ipv6_non_link) {
+      for (ALL_LIST_ELEMENTS_RO (circuit->ipv6_non_link, ipnode, ipv6)) {
+	db->local_prefixes = isis_spf_hash(db->local_prefixes, &ipv6->prefix, sizeof(ipv6->prefix));
+	db->local_prefixes = isis_spf_hash(db->local_prefixes, &ipv6->prefixlen, sizeof(ipv6->prefixlen));
+      }
+    }
+#endif
+  }
+}
+
+static int
+isis_spf_db_build (struct isis_spf_db *db, struct isis_area *area, int level, int family)
+{
+  dnode_t *dnode;
+
+  db->valid = FALSE;
+  db->lsps_num = 0;
+  db->edges_num = 0;
+
+  isis_spf_db_local(db, area, level, family);
+
+  for (dnode = dict_first (area->lspdb[level - 1]); dnode; dnode = dict_next (area->lspdb[level - 1], dnode)) {
+    if (isis_spf_db_lsp(db, dnode_get (dnode), family) == ERR) return ERR;
+  }
+
+  db->valid = TRUE;
+
+  return SUCCESS;
+}
+
+/*
+   An edge has slack when the vertex it leads to is in the SPT at a shorter
+   distance than the edge offers: adding or removing it can't change the
+   SPT, see process_N().
+*/
+static int
+isis_spf_edge_slack (struct isis_spftree *spftree, struct isis_vertex *vertex,
+		     u_char *lsp_id, struct isis_spf_edge *edge)
+{
+  struct isis_vertex *far;
+  u_int16_t dist;
+
+  /* Two way connectivity */
+  if (!memcmp(edge->id, isis->sysid, ISIS_SYS_ID_LEN)) return TRUE;
+
+  if (LSP_PSEUDO_ID (lsp_id)) dist = vertex->d_N;
+  else {
+    dist = vertex->d_N + edge->metric;
+    if (dist > MAX_PATH_METRIC) return TRUE;
+  }
+
+  far = isis_find_vertex (spftree->paths_idx, edge->id, edge->vtype);
+
+  return (far && far->d_N < dist);
+}
+
+static int
+isis_spf_classify_lsp (struct isis_spftree *spftree, struct isis_spf_db *old, struct isis_spf_lsp *o,
+		       struct isis_spf_db *new, struct isis_spf_lsp *n)
+{
+  struct isis_spf_edge *o_edges = NULL, *n_edges = NULL, *edge;
+  u_int32_t o_num = 0, n_num = 0, o_idx, n_idx;
+  u_char *lsp_id = (o ? o->lsp_id : n->lsp_id);
+  struct isis_vertex *vertex, *vertices[2];
+  int ret = ISIS_SPF_RUN_SKIP, cmp, idx;
+
+  if (o) {
+    o_edges = &old->edges[o->edges];
+    o_num = o->edges_num;
+  }
+
+  if (n) {
+    n_edges = &new->edges[n->edges];
+    n_num = n->edges_num;
+  }
+
+  /* refresh */
+  if (o && n && o->attr == n->attr && o->prefixes == n->prefixes && o_num == n_num &&
+      (!o_num || !memcmp(o_edges, n_edges, (o_num * sizeof(struct isis_spf_edge)))))
+    return ISIS_SPF_RUN_SKIP;
+
+  /* the SPT vertices the LSP gets processed for */
+  memset(vertices, 0, sizeof(vertices));
+
+  if (LSP_PSEUDO_ID (lsp_id)) {
+    vertices[0] = isis_find_vertex (spftree->paths_idx, lsp_id, VTYPE_PSEUDO_IS);
+    vertices[1] = isis_find_vertex (spftree->paths_idx, lsp_id, VTYPE_PSEUDO_TE_IS);
+  }
+  /* own LSP is not processed: the root is put in PATHS directly */
+  else if (memcmp(lsp_id, isis->sysid, ISIS_SYS_ID_LEN)) {
+    vertices[0] = isis_find_vertex (spftree->paths_idx, lsp_id, VTYPE_NONPSEUDO_IS);
+    vertices[1] = isis_find_vertex (spftree->paths_idx, lsp_id, VTYPE_NONPSEUDO_TE_IS);
+  }
+
+  for (idx = 0; idx < 2; idx++) {
+    vertex = vertices[idx];
+    if (!vertex) continue;
+
+    if (!o || !n || o->attr != n->attr) return ISIS_SPF_RUN_FULL;
+    if (o->prefixes != n->prefixes) ret = ISIS_SPF_RUN_INCR;
+
+    /* edges both sides have in common are skipped */
+    for (o_idx = 0, n_idx = 0; o_idx < o_num || n_idx < n_num;) {
+      if (o_idx < o_num && n_idx < n_num) cmp = isis_spf_edge_cmp(&o_edges[o_idx], &n_edges[n_idx]);
+      else cmp = ((o_idx < o_num) ? -1 : 1);
+
+      if (!cmp) {
+	o_idx++;
+	n_idx++;
+	continue;
+      }
+
+      edge = ((cmp < 0) ? &o_edges[o_idx++] : &n_edges[n_idx++]);
+      if (!isis_spf_edge_slack(spftree, vertex, lsp_id, edge)) return ISIS_SPF_RUN_FULL;
+    }
+  }
+
+  return ret;
+}
+
+/* returns the kind of run needed to bring the SPT from old to new */
+static int
+isis_spf_classify (struct isis_spftree *spftree, struct isis_spf_db *old, struct isis_spf_db *new)
+{
+  struct isis_spf_lsp *o, *n;
+  u_int32_t o_idx = 0, n_idx = 0;
+  int ret = ISIS_SPF_RUN_SKIP, cmp;
+
+  if (!old->valid || !new->valid) return ISIS_SPF_RUN_FULL;
+  if (old->local_attr != new->local_attr) return ISIS_SPF_RUN_FULL;
+  if (old->local_prefixes != new->local_prefixes) ret = ISIS_SPF_RUN_INCR;
+
+  /* both are in LSP ID order */
+  while (o_idx < old->lsps_num || n_idx < new->lsps_num) {
+    o = ((o_idx < old->lsps_num) ? &old->lsps[o_idx] : NULL);
+    n = ((n_idx < new->lsps_num) ? &new->lsps[n_idx] : NULL);
+
+    if (o && n) cmp = memcmp(o->lsp_id, n->lsp_id, ISIS_SYS_ID_LEN + 2);
+    else cmp = (o ? -1 : 1);
+
+    if (cmp < 0) {
+      n = NULL;
+      o_idx++;
+    }
+    else if (cmp > 0) {
+      o = NULL;
+      n_idx++;
+    }
+    else {
+      o_idx++;
+      n_idx++;
+    }
+
+    switch (isis_spf_classify_lsp(spftree, old, o, new, n)) {
+    case ISIS_SPF_RUN_FULL:
+      return ISIS_SPF_RUN_FULL;
+    case ISIS_SPF_RUN_INCR:
+      ret = ISIS_SPF_RUN_INCR;
+      break;
+    default:
+      break;
+    }
+  }
+
+  return ret;
+}
+
+/* PRC: IS vertices go back to TENT in the order they were put in PATHS, leaves are dropped */
+static void
+isis_spf_reload_tent (struct isis_spftree *spftree)
+{
+  struct listnode *node, *nnode;
+  struct isis_vertex *vertex;
+
+  /* the root stays */
+  for (node = listnextnode (listhead (spftree->paths)); node; node = nnode) {
+    nnode = listnextnode (node);
+    vertex = listgetdata (node);
+    isis_list_delete_node (spftree->paths, node);
+    isis_hash_release (spftree->paths_idx, vertex);
+
+    if (vertex->type > VTYPE_ES || isis_tent_add (spftree, vertex) == ERR)
+      isis_vertex_del (vertex);
+  }
+}
+
+static void
+isis_spf_stats (struct isis_spftree *spftree, struct isis_area *area, int level,
+		int run, struct timeval *start)
+{
+  static const char *runs_str[] = { "full", "incremental", "skipped" };
+  struct timeval now;
+  long usecs;
+  u_int32_t avg[ISIS_SPF_RUN_MAX];
+  int idx;
+
+  gettimeofday(&now, NULL);
+  usecs = (((now.tv_sec - start->tv_sec) * 1000000) + (now.tv_usec - start->tv_usec));
+  if (usecs < 0) usecs = 0;
+
+  spftree->runs[run]++;
+  spftree->runs_usecs[run] += usecs;
+  if (usecs > spftree->runs_usecs_max[run]) spftree->runs_usecs_max[run] = usecs;
+
+  Log(LOG_DEBUG, "DEBUG ( %s/core/ISIS ): ISIS-Spf (tag: %s, level: %u): SPF algorithm run (%s, %ld usecs)\n",
+		config.name, area->area_tag, level, runs_str[run], usecs);
+
+  if (now.tv_sec < spftree->runs_logged + ISIS_SPF_STATS_INTERVAL) return;
+
+  for (idx = 0; idx < ISIS_SPF_RUN_MAX; idx++)
+    avg[idx] = (spftree->runs[idx] ? (spftree->runs_usecs[idx] / spftree->runs[idx]) : 0);
+
+  Log(LOG_INFO, "INFO ( %s/core/ISIS ): ISIS-Spf (tag: %s, level: %u): runs full: %u (avg: %u max: %u usecs) "
+		"incremental: %u (avg: %u max: %u usecs) skipped: %u (avg: %u max: %u usecs)\n",
+		config.name, area->area_tag, level,
+		spftree->runs[ISIS_SPF_RUN_FULL], avg[ISIS_SPF_RUN_FULL], spftree->runs_usecs_max[ISIS_SPF_RUN_FULL],
+		spftree->runs[ISIS_SPF_RUN_INCR], avg[ISIS_SPF_RUN_INCR], spftree->runs_usecs_max[ISIS_SPF_RUN_INCR],
+		spftree->runs[ISIS_SPF_RUN_SKIP], avg[ISIS_SPF_RUN_SKIP], spftree->runs_usecs_max[ISIS_SPF_RUN_SKIP]);
+
+  spftree->runs_logged = now.tv_sec;
 }
 
 int
@@ -899,6 +1676,11 @@ isis_run_spf (struct isis_area *area, int level, int family)
   struct route_table *table = NULL;
   struct route_node *rode;
   struct isis_route_info *rinfo;
+  struct isis_spf_db db;
+  struct timeval start;
+  int run;
+
+  gettimeofday(&start, NULL);
 
   if (family == AF_INET)
     spftree = area->spftree[level - 1];
@@ -909,6 +1691,19 @@ isis_run_spf (struct isis_area *area, int level, int family)
 
   assert (spftree);
 
+  if (isis_spf_db_build (&spftree->db_next, area, level, family) == ERR)
+    Log(LOG_WARNING, "WARN ( %s/core/ISIS ): ISIS-Spf (tag: %s, level: %u): unable to summarise LSP database\n",
+		config.name, area->area_tag, level);
+
+  run = isis_spf_classify (spftree, &spftree->db, &spftree->db_next);
+
+  db = spftree->db;
+  spftree->db = spftree->db_next;
+  spftree->db_next = db;
+
+  if (run == ISIS_SPF_RUN_SKIP)
+    goto out;
+
   /* Make all routes in current route table inactive. */
   if (family == AF_INET)
     table = area->route_table[level - 1];
@@ -926,33 +1721,40 @@ isis_run_spf (struct isis_area *area, int level, int family)
       UNSET_FLAG (rinfo->flag, ISIS_ROUTE_FLAG_ACTIVE);
     }
 
-  /*
-   * C.2.5 Step 0
-   */
-  init_spt (spftree);
-  /*              a) */
-  isis_spf_add_self (spftree, area, level);
-  /*              b) */
-  retval = isis_spf_preload_tent (spftree, area, level, family);
+  if (run == ISIS_SPF_RUN_INCR)
+    {
+      isis_spf_reload_tent (spftree);
+      retval = isis_spf_preload_tent (spftree, area, level, family, TRUE);
+    }
+  else
+    {
+      /*
+       * C.2.5 Step 0
+       */
+      init_spt (spftree);
+      /*              a) */
+      isis_spf_add_self (spftree, area, level);
+      /*              b) */
+      retval = isis_spf_preload_tent (spftree, area, level, family, FALSE);
+    }
 
   /*
    * C.2.7 Step 2
    */
-  if (listcount (spftree->tents) == 0)
+  if (spftree->tents_num == 0)
     {
       Log(LOG_WARNING, "WARN ( %s/core/ISIS ): ISIS-Spf: TENT is empty\n", config.name);
       goto out;
     }
 
-  while (listcount (spftree->tents) > 0)
+  while (spftree->tents_num > 0)
     {
-      node = listhead (spftree->tents);
-      vertex = listgetdata (node);
+      vertex = spftree->tents[0];
 
       /* Remove from tent list */
-      isis_list_delete_node (spftree->tents, node);
+      isis_tent_del (spftree, vertex);
 
-      if (isis_find_vertex (spftree->paths, vertex->N.id, vertex->type))
+      if (isis_hash_lookup (spftree->paths_idx, vertex))
 	continue;
 
       add_to_paths (spftree, vertex, area, level);
@@ -968,14 +1770,17 @@ isis_run_spf (struct isis_area *area, int level, int family)
 	    {
 	      if (LSP_PSEUDO_ID (lsp_id))
 		{
-		  isis_spf_process_pseudo_lsp (spftree, lsp, vertex->d_N,
-					       vertex->depth, family);
+		  /* pseudonode LSPs carry no leaves */
+		  if (run != ISIS_SPF_RUN_INCR)
+		    isis_spf_process_pseudo_lsp (spftree, lsp, vertex->d_N,
+						 vertex->depth, family);
 
 		}
 	      else
 		{
 		  isis_spf_process_lsp (spftree, lsp, vertex->d_N,
-					vertex->depth, family);
+					vertex->depth, family,
+					(run == ISIS_SPF_RUN_INCR));
 		}
 	    }
 	  else
@@ -991,8 +1796,11 @@ out:
   spftree->lastrun = time (NULL);
   spftree->pending = 0;
 
-  Log(LOG_DEBUG, "DEBUG ( %s/core/ISIS ): ISIS-Spf (tag: %s, level: %u): SPF algorithm run\n",
-		config.name, area->area_tag, area->is_type);
+  /* routes are unchanged otherwise */
+  if (run != ISIS_SPF_RUN_SKIP)
+    isis_lpm_publish (area, level);
+
+  isis_spf_stats (spftree, area, level, run, &start);
 
   return retval;
 }
@@ -59,17 +59,107 @@ struct isis_vertex
   u_int16_t depth;		/* The depth in the imaginary tree */
 
   struct list *Adj_N;		/* {Adj(N)}  */
+
+  u_int32_t tent_pos;		/* slot in the TENT heap */
+  u_int64_t tent_seq;		/* order of entry into TENT */
+};
+
+/*
+   Summary of the LSP database an SPT was computed from, one entry per LSP
+   in LSP ID order: a hash of what gates the processing of the LSP, a hash
+   of its IP reachability and its IS neighbours (edges), sorted. Compared
+   against the database at the next run to tell refreshes, leaf-only and
+   topology changes apart.
+*/
+struct isis_spf_edge
+{
+  u_char id[ISIS_SYS_ID_LEN + 1];
+  u_char vtype;
+  u_int32_t metric;
+};
+
+struct isis_spf_lsp
+{
+  u_char lsp_id[ISIS_SYS_ID_LEN + 2];
+  u_int64_t attr;		/* adjacency, nlpids, OL bit, seq_num */
+  u_int64_t prefixes;		/* IP reachability */
+  u_int32_t edges;		/* first edge in isis_spf_db.edges */
+  u_int32_t edges_num;
+};
+
+struct isis_spf_db
+{
+  int valid;
+  u_int64_t local_attr;		/* circuits and adjacencies */
+  u_int64_t local_prefixes;	/* circuits IP addresses */
+
+  struct isis_spf_lsp *lsps;
+  u_int32_t lsps_num;
+  u_int32_t lsps_alloc;
+
+  struct isis_spf_edge *edges;
+  u_int32_t edges_num;
+  u_int32_t edges_alloc;
 };
 
+#define ISIS_SPF_RUN_FULL	0	/* Dijkstra from scratch */
+#define ISIS_SPF_RUN_INCR	1	/* SPT kept, leaves recomputed (PRC) */
+#define ISIS_SPF_RUN_SKIP	2	/* nothing relevant changed */
+#define ISIS_SPF_RUN_MAX	3
+
+#define ISIS_SPF_STATS_INTERVAL	300
+#define ISIS_SPF_IDX_SIZE	16384
+
 struct isis_spftree
 {
   struct thread *t_spf;		/* spf threads */
   time_t lastrun;		/* for scheduling */
   int pending;			/* already scheduled */
   struct list *paths;		/* the SPT */
-  struct list *tents;		/* TENT */
+  struct isis_vertex **tents;	/* TENT, binary heap */
+  u_int32_t tents_num;
+  u_int32_t tents_alloc;
+  u_int64_t tents_seq;
+  struct hash *paths_idx;	/* PATHS by vertex type and id */
+  struct hash *tents_idx;	/* TENT by vertex type and id */
 
   u_int32_t timerun;		/* statistics */
+
+  struct isis_spf_db db;	/* what the SPT was computed from */
+  struct isis_spf_db db_next;	/* scratch, swapped with db */
+
+  u_int32_t runs[ISIS_SPF_RUN_MAX];
+  u_int64_t runs_usecs[ISIS_SPF_RUN_MAX];
+  u_int32_t runs_usecs_max[ISIS_SPF_RUN_MAX];
+  time_t runs_logged;
+};
+
+/*
+   Read-optimised copy of the routes used for flow correlation, published
+   by the IS-IS thread after each SPF run: routes are flattened into sorted
+   arrays of contiguous address ranges, one per address family, each range
+   mapping onto the most specific prefix covering it. Snapshots are
+   immutable once published; prefixes[0] stands for no route.
+*/
+struct isis_lpm_addr6 {
+  u_int64_t hi;
+  u_int64_t lo;
+};
+
+struct isis_lpm {
+  u_int32_t *v4_start;
+  u_int32_t *v4_value;
+  u_int32_t v4_num;
+  u_int32_t v4_alloc;
+
+  struct isis_lpm_addr6 *v6_start;
+  u_int32_t *v6_value;
+  u_int32_t v6_num;
+  u_int32_t v6_alloc;
+
+  struct isis_prefix *prefixes;
+  u_int32_t prefixes_num;
+  u_int32_t prefixes_alloc;
 };
 
 #if (!defined __ISIS_SPF_C)
@@ -80,9 +170,13 @@ struct isis_spftree
 EXT void spftree_area_init (struct isis_area *);
 EXT int isis_spf_schedule (struct isis_area *, int);
 EXT int isis_run_spf (struct isis_area *, int, int);
+EXT void isis_lpm_free (struct isis_lpm *);
 #ifdef ENABLE_IPV6
 EXT int isis_spf_schedule6 (struct isis_area *, int);
 #endif
+
+EXT struct isis_lpm *isis_lpm;		/* in use by the Core Process */
+EXT struct isis_lpm *isis_lpm_next;	/* published, waiting to be swapped in */
 #undef EXT
 
 #endif /* _ISIS_SPF_H_ */
@@ -30,7 +30,15 @@
 void p_kafka_init_host(struct p_kafka_host *kafka_host, char *config_file)
 {
   if (kafka_host) {
+#if defined ENABLE_THREADS
+    /* the poller thread, if any, is parked in its pool: keep it for reuse */
+    thread_pool_t *poller_pool = kafka_host->poller_pool;
+#endif
+
     memset(kafka_host, 0, sizeof(struct p_kafka_host));
+#if defined ENABLE_THREADS
+    kafka_host->poller_pool = poller_pool;
+#endif
     P_broker_timers_set_retry_interval(&kafka_host->btimers, PM_KAFKA_DEFAULT_RETRY);
     p_kafka_set_config_file(kafka_host, config_file);
 
@@ -180,6 +188,38 @@ char *p_kafka_get_key(struct p_kafka_host *kafka_host)
   return NULL;
 }
 
+struct p_kafka_stats *p_kafka_get_stats(struct p_kafka_host *kafka_host)
+{
+  if (kafka_host) return &kafka_host->stats;
+
+  return NULL;
+}
+
+/*
+   Sets msecs to the upper bound of the latency bucket holding the given
+   percentile; returns ERR if pct is out of range or no delivery has been
+   sampled yet, so that a real sub-msec latency is not confused with it.
+*/
+int p_kafka_get_latency_pct(struct p_kafka_host *kafka_host, int pct, u_int32_t *msecs)
+{
+  u_int64_t total = 0, acc = 0;
+  int idx;
+
+  if (!kafka_host || !msecs || pct < 1 || pct > 100) return ERR;
+
+  for (idx = 0; idx < PM_KAFKA_LAT_BUCKETS; idx++) total += kafka_host->stats.latency[idx];
+  if (!total) return ERR;
+
+  for (idx = 0; idx < PM_KAFKA_LAT_BUCKETS; idx++) {
+    acc += kafka_host->stats.latency[idx];
+    if ((acc * 100) >= (total * pct)) break;
+  }
+
+  (*msecs) = (1 << MIN(idx, (PM_KAFKA_LAT_BUCKETS - 1)));
+
+  return SUCCESS;
+}
+
 void p_kafka_set_fallback(struct p_kafka_host *kafka_host, char *fallback)
 {
   int res;
@@ -205,6 +245,19 @@ void p_kafka_set_config_file(struct p_kafka_host *kafka_host, char *config_file)
   }
 }
 
+void p_kafka_set_async(struct p_kafka_host *kafka_host, int async, u_int64_t inflight_max)
+{
+  if (kafka_host) {
+#if defined ENABLE_THREADS
+    kafka_host->async = async;
+#else
+    if (async) Log(LOG_WARNING, "WARN ( %s/%s ): Kafka async producer requires threads support (--enable-threads). Disabled.\n",
+		   config.name, config.type);
+#endif
+    kafka_host->inflight_max = inflight_max;
+  }
+}
+
 int p_kafka_parse_config_entry(char *buf, char *type, char **key, char **value)
 {
   char *value_ptr, *token;
@@ -327,10 +380,39 @@ void p_kafka_logger(const rd_kafka_t *rk, int level, const char *fac, const char
   Log(LOG_DEBUG, "DEBUG ( %s/%s ): RDKAFKA-%i-%s: %s: %s\n", config.name, config.type, level, fac, rd_kafka_name(rk), buf);
 }
 
+static u_int32_t p_kafka_tstamp_msec()
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+
+  return ((tv.tv_sec * 1000) + (tv.tv_usec / 1000));
+}
+
 void p_kafka_msg_delivered(rd_kafka_t *rk, void *payload, size_t len, int error_code, void *opaque, void *msg_opaque)
 {
   struct p_kafka_host *kafka_host = (struct p_kafka_host *) opaque; 
 
+  if (kafka_host) {
+    __sync_fetch_and_sub(&kafka_host->stats.queued, 1);
+    __sync_fetch_and_sub(&kafka_host->stats.inflight_bytes, len);
+
+    if (error_code) __sync_fetch_and_add(&kafka_host->stats.failed, 1);
+    else {
+      /* msg_opaque carries the time the message was handed to librdkafka */
+      u_int32_t latency = (p_kafka_tstamp_msec() - (u_int32_t) (uintptr_t) msg_opaque);
+      int bucket = 0;
+
+      while (latency && bucket < (PM_KAFKA_LAT_BUCKETS - 1)) {
+	latency >>= 1;
+	bucket++;
+      }
+
+      __sync_fetch_and_add(&kafka_host->stats.delivered, 1);
+      __sync_fetch_and_add(&kafka_host->stats.latency[bucket], 1);
+    }
+  }
+
   if (error_code) {
     Log(LOG_ERR, "ERROR ( %s/%s ): Kafka message delivery failed: %s\n", config.name, config.type, rd_kafka_err2str(error_code));
   }
@@ -367,6 +449,19 @@ int p_kafka_connect_to_produce(struct p_kafka_host *kafka_host)
     }
 
     if (config.debug) rd_kafka_set_log_level(kafka_host->rk, LOG_DEBUG);
+
+#if defined ENABLE_THREADS
+    if (kafka_host->async) {
+      if (!kafka_host->poller_pool) {
+	kafka_host->poller_pool = allocate_thread_pool(1);
+	assert(kafka_host->poller_pool);
+      }
+
+      kafka_host->poller_stop = FALSE;
+      kafka_host->poller_running = TRUE;
+      send_to_pool(kafka_host->poller_pool, p_kafka_poller, kafka_host);
+    }
+#endif
   }
   else return ERR;
 
@@ -390,29 +485,95 @@ int p_kafka_connect_to_consume(struct p_kafka_host *kafka_host)
   return SUCCESS;
 }
 
-int p_kafka_produce_data(struct p_kafka_host *kafka_host, void *data, u_int32_t data_len)
+/* lets librdkafka make progress on delivery reports while waiting for room */
+static void p_kafka_backpressure_wait(struct p_kafka_host *kafka_host)
+{
+  if (kafka_host->poller_running) usleep(10000);
+  else rd_kafka_poll(kafka_host->rk, 10);
+}
+
+static int p_kafka_produce_data_flags(struct p_kafka_host *kafka_host, void *data, u_int32_t data_len, int flags)
 {
+  time_t bp_start = 0;
   int ret = SUCCESS;
 
   kafkap_ret_err_cb = FALSE;
 
-  if (kafka_host && kafka_host->rk && kafka_host->topic) {
-    ret = rd_kafka_produce(kafka_host->topic, kafka_host->partition, RD_KAFKA_MSG_F_COPY,
-			   data, data_len, kafka_host->key, kafka_host->key_len, NULL);
-
-    if (ret == ERR) {
-      Log(LOG_ERR, "ERROR ( %s/%s ): Failed to produce to topic %s partition %i: %s\n", config.name, config.type,
-          rd_kafka_topic_name(kafka_host->topic), kafka_host->partition, rd_kafka_err2str(rd_kafka_errno2err(errno)));
+  if (!kafka_host || !kafka_host->rk || !kafka_host->topic) return ERR;
+
+  /*
+     Bounded back-pressure: rather than failing (and dropping what is left
+     to purge), wait for in-flight messages to be acknowledged, both when
+     the configured in-flight bytes are exceeded and when the librdkafka
+     queue is full; give up after PM_KAFKA_BACKPRESSURE_WAIT secs.
+  */
+  while (kafka_host->inflight_max && kafka_host->stats.queued &&
+	 (kafka_host->stats.inflight_bytes + data_len) > kafka_host->inflight_max) {
+    if (!bp_start) {
+      bp_start = time(NULL);
+      __sync_fetch_and_add(&kafka_host->stats.backpressure, 1);
+    }
+    else if ((time(NULL) - bp_start) > PM_KAFKA_BACKPRESSURE_WAIT) {
+      Log(LOG_ERR, "ERROR ( %s/%s ): Kafka in-flight bytes not draining (%llu/%llu) for %u secs\n", config.name, config.type,
+	  (unsigned long long) kafka_host->stats.inflight_bytes, (unsigned long long) kafka_host->inflight_max,
+	  PM_KAFKA_BACKPRESSURE_WAIT);
       p_kafka_close(kafka_host, TRUE);
+      return ERR;
     }
+
+    p_kafka_backpressure_wait(kafka_host);
+  }
+
+  __sync_fetch_and_add(&kafka_host->stats.queued, 1);
+  __sync_fetch_and_add(&kafka_host->stats.inflight_bytes, data_len);
+
+  for (;;) {
+    ret = rd_kafka_produce(kafka_host->topic, kafka_host->partition, flags, data, data_len,
+			   kafka_host->key, kafka_host->key_len, (void *) (uintptr_t) p_kafka_tstamp_msec());
+    if (ret != ERR) break;
+
+    if (rd_kafka_errno2err(errno) == RD_KAFKA_RESP_ERR__QUEUE_FULL) {
+      if (!bp_start) {
+	bp_start = time(NULL);
+	__sync_fetch_and_add(&kafka_host->stats.backpressure, 1);
+      }
+
+      if ((time(NULL) - bp_start) <= PM_KAFKA_BACKPRESSURE_WAIT) {
+	p_kafka_backpressure_wait(kafka_host);
+	continue;
+      }
+    }
+
+    __sync_fetch_and_sub(&kafka_host->stats.queued, 1);
+    __sync_fetch_and_sub(&kafka_host->stats.inflight_bytes, data_len);
+
+    Log(LOG_ERR, "ERROR ( %s/%s ): Failed to produce to topic %s partition %i: %s\n", config.name, config.type,
+        rd_kafka_topic_name(kafka_host->topic), kafka_host->partition, rd_kafka_err2str(rd_kafka_errno2err(errno)));
+    p_kafka_close(kafka_host, TRUE);
+
+    return ERR;
   }
-  else return ERR;
 
-  rd_kafka_poll(kafka_host->rk, 0);
+  if (!kafka_host->poller_running) rd_kafka_poll(kafka_host->rk, 0);
 
   return ret; 
 }
 
+int p_kafka_produce_data(struct p_kafka_host *kafka_host, void *data, u_int32_t data_len)
+{
+  return p_kafka_produce_data_flags(kafka_host, data, data_len, RD_KAFKA_MSG_F_COPY);
+}
+
+/*
+   Same as p_kafka_produce_data() but no copy of the payload is made: on
+   success ownership of data, which must be malloc()'ed, passes to librdkafka
+   which frees it once delivered; on failure it stays with the caller.
+*/
+int p_kafka_produce_data_nocopy(struct p_kafka_host *kafka_host, void *data, u_int32_t data_len)
+{
+  return p_kafka_produce_data_flags(kafka_host, data, data_len, RD_KAFKA_MSG_F_FREE);
+}
+
 int p_kafka_manage_consumer(struct p_kafka_host *kafka_host, int is_start)
 {
   int ret = SUCCESS;
@@ -493,7 +654,34 @@ void p_kafka_close(struct p_kafka_host *kafka_host, int set_fail)
     else {
       /* Wait for messages to be delivered */
       if (kafka_host->rk) p_kafka_check_outq_len(kafka_host);
+
+      if (kafka_host->rk && rd_kafka_type(kafka_host->rk) == RD_KAFKA_PRODUCER) {
+	struct p_kafka_stats *stats = &kafka_host->stats;
+	u_int32_t p50, p90, p99;
+	char latency_str[SRVBUFLEN];
+
+	if (p_kafka_get_latency_pct(kafka_host, 50, &p50) == SUCCESS &&
+	    p_kafka_get_latency_pct(kafka_host, 90, &p90) == SUCCESS &&
+	    p_kafka_get_latency_pct(kafka_host, 99, &p99) == SUCCESS)
+	  snprintf(latency_str, sizeof(latency_str), "%u/%u/%u ms", p50, p90, p99);
+	else strlcpy(latency_str, "n/a", sizeof(latency_str));
+
+	Log(LOG_INFO, "INFO ( %s/%s ): Kafka producer: delivered=%llu failed=%llu pending=%llu backpressure=%llu latency p50/p90/p99=%s\n",
+	    config.name, config.type, (unsigned long long) stats->delivered, (unsigned long long) stats->failed,
+	    (unsigned long long) stats->queued, (unsigned long long) stats->backpressure, latency_str);
+      }
+    }
+
+#if defined ENABLE_THREADS
+    /* park the poller thread before tearing librdkafka down */
+    if (kafka_host->poller_running) {
+      kafka_host->poller_stop = TRUE;
+
+      pthread_mutex_lock(kafka_host->poller_pool->mutex);
+      while (!kafka_host->poller_pool->free_list) pthread_cond_wait(kafka_host->poller_pool->cond, kafka_host->poller_pool->mutex);
+      pthread_mutex_unlock(kafka_host->poller_pool->mutex);
     }
+#endif
 
     if (kafka_host->topic) {
       rd_kafka_topic_destroy(kafka_host->topic);
@@ -532,3 +720,13 @@ int p_kafka_check_outq_len(struct p_kafka_host *kafka_host)
 
   return SUCCESS;
 }
+
+/* runs in its own thread: serves delivery reports off the purge path */
+void p_kafka_poller(void *arg)
+{
+  struct p_kafka_host *kafka_host = (struct p_kafka_host *) arg;
+
+  while (!kafka_host->poller_stop) rd_kafka_poll(kafka_host->rk, 100);
+
+  kafka_host->poller_running = FALSE;
+}
@@ -24,6 +24,9 @@
 #define __PLUGIN_COMMON_EXPORT
 #include "plugin_common.h"
 #undef  __PLUGIN_COMMON_EXPORT
+#if defined ENABLE_THREADS
+#include "thread_pool.h"
+#endif
 
 /* defines */
 #define PM_KAFKA_ERRSTR_LEN	512
@@ -33,7 +36,24 @@
 #define PM_KAFKA_CNT_TYPE_STR	1
 #define PM_KAFKA_CNT_TYPE_BIN	2
 
+#define PM_KAFKA_LAT_BUCKETS	16	/* log2 msecs: <1, <2, <4, .. */
+#define PM_KAFKA_BACKPRESSURE_WAIT 30	/* secs */
+
 /* structures */
+/*
+   Producer counters: queued and inflight_bytes are bumped when a message
+   is handed to librdkafka and decremented by the delivery report callback,
+   which may run in the poller thread: updates are atomic.
+*/
+struct p_kafka_stats {
+  u_int64_t queued;
+  u_int64_t inflight_bytes;
+  u_int64_t delivered;
+  u_int64_t failed;
+  u_int64_t backpressure;
+  u_int64_t latency[PM_KAFKA_LAT_BUCKETS];
+};
+
 struct p_kafka_host {
   char broker[SRVBUFLEN];
   char errstr[PM_KAFKA_ERRSTR_LEN];
@@ -50,6 +70,15 @@ struct p_kafka_host {
   struct p_table_rr topic_rr;
 
   struct p_broker_timers btimers;
+
+  int async;
+  u_int64_t inflight_max;
+  struct p_kafka_stats stats;
+  volatile int poller_stop;
+  volatile int poller_running;
+#if defined ENABLE_THREADS
+  thread_pool_t *poller_pool;
+#endif
 };
 
 /* prototypes */
@@ -69,12 +98,15 @@ EXT void p_kafka_set_partition(struct p_kafka_host *, int);
 EXT void p_kafka_set_key(struct p_kafka_host *, char *, int);
 EXT void p_kafka_set_fallback(struct p_kafka_host *, char *);
 EXT void p_kafka_set_config_file(struct p_kafka_host *, char *);
+EXT void p_kafka_set_async(struct p_kafka_host *, int, u_int64_t);
 
 EXT char *p_kafka_get_topic(struct p_kafka_host *);
 EXT int p_kafka_get_topic_rr(struct p_kafka_host *);
 EXT int p_kafka_get_content_type(struct p_kafka_host *);
 EXT int p_kafka_get_partition(struct p_kafka_host *);
 EXT char *p_kafka_get_key(struct p_kafka_host *);
+EXT struct p_kafka_stats *p_kafka_get_stats(struct p_kafka_host *);
+EXT int p_kafka_get_latency_pct(struct p_kafka_host *, int, u_int32_t *);
 
 EXT void p_kafka_unset_topic(struct p_kafka_host *);
 
@@ -88,10 +120,12 @@ EXT void p_kafka_msg_error(rd_kafka_t *, int, const char *, void *);
 EXT int p_kafka_connect_to_produce(struct p_kafka_host *);
 EXT int p_kafka_connect_to_consume(struct p_kafka_host *);
 EXT int p_kafka_produce_data(struct p_kafka_host *, void *, u_int32_t);
+EXT int p_kafka_produce_data_nocopy(struct p_kafka_host *, void *, u_int32_t);
 EXT int p_kafka_consume_poller(struct p_kafka_host *, void **, int);
 EXT int p_kafka_consume_data(struct p_kafka_host *, void *, char *, u_int32_t);
 EXT void p_kafka_close(struct p_kafka_host *, int);
 EXT int p_kafka_check_outq_len(struct p_kafka_host *);
+EXT void p_kafka_poller(void *);
 
 /* global vars */
 EXT struct p_kafka_host kafkap_kafka_host;
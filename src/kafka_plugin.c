@@ -98,6 +98,9 @@ void kafka_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
       close_output_file(avro_fp);
     }
 
+    if (!config.avro_buffer_size) config.avro_buffer_size = LARGEBUFLEN;
+    p_avro_encoder_init(&avro_acct_enc, avro_acct_schema, config.avro_buffer_size, config.avro_container);
+
     if (config.kafka_avro_schema_topic) {
       if (!config.kafka_avro_schema_refresh_time)
 	config.kafka_avro_schema_refresh_time = DEFAULT_AVRO_SCHEMA_REFRESH_TIME;
@@ -271,6 +274,7 @@ void kafka_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
         pollagain = FALSE;
         memcpy(pipebuf, rg->ptr, bufsz);
         rg->ptr += bufsz;
+        stats_shm_update_ring_rd(((struct ch_buf_hdr *) pipebuf)->seq);
       }
 #ifdef WITH_RABBITMQ
       else {
@@ -346,13 +350,13 @@ void kafka_cache_purge(struct chained_cache *queue[], int index)
   time_t start, duration;
   pid_t writer_pid = getpid();
 
-#ifdef WITH_JANSSON
-  json_t *array = json_array();
-#endif
+  struct p_json_batch json_batch;
+  char *json_msg;
+  size_t json_msg_len;
 
 #ifdef WITH_AVRO
-  avro_writer_t avro_writer;
-  char *avro_buf = NULL;
+  char *avro_msg;
+  size_t avro_msg_len;
   int avro_buffer_full = FALSE;
 #endif
 
@@ -386,13 +390,18 @@ void kafka_cache_purge(struct chained_cache *queue[], int index)
   memset(&empty_pmpls, 0, sizeof(struct pkt_mpls_primitives));
   memset(empty_pcust, 0, config.cpptrs.len);
 
+  p_kafka_set_async(&kafkap_kafka_host, config.kafka_async_producer, config.kafka_inflight_max);
   p_kafka_connect_to_produce(&kafkap_kafka_host);
   p_kafka_set_broker(&kafkap_kafka_host, config.sql_host, config.kafka_broker_port);
   if (!is_topic_dyn && !config.amqp_routing_key_rr) p_kafka_set_topic(&kafkap_kafka_host, config.sql_table);
   p_kafka_set_partition(&kafkap_kafka_host, config.kafka_partition);
   p_kafka_set_key(&kafkap_kafka_host, config.kafka_partition_key, config.kafka_partition_keylen);
 
-  if (config.message_broker_output & PRINT_OUTPUT_JSON) p_kafka_set_content_type(&kafkap_kafka_host, PM_KAFKA_CNT_TYPE_STR);
+  if (config.message_broker_output & PRINT_OUTPUT_JSON) {
+    if (config.sql_multi_values && config.message_broker_mv_compress)
+      p_kafka_set_content_type(&kafkap_kafka_host, PM_KAFKA_CNT_TYPE_BIN);
+    else p_kafka_set_content_type(&kafkap_kafka_host, PM_KAFKA_CNT_TYPE_STR);
+  }
   else if (config.message_broker_output & PRINT_OUTPUT_AVRO) p_kafka_set_content_type(&kafkap_kafka_host, PM_KAFKA_CNT_TYPE_BIN);
   else {
     Log(LOG_ERR, "ERROR ( %s/%s ): Unsupported kafka_output value specified. Exiting.\n", config.name, config.type);
@@ -423,19 +432,13 @@ void kafka_cache_purge(struct chained_cache *queue[], int index)
     }
   }
 
-#ifdef WITH_AVRO
-  if (config.message_broker_output & PRINT_OUTPUT_AVRO) {
-    if (!config.avro_buffer_size) config.avro_buffer_size = LARGEBUFLEN;
+  memset(&json_batch, 0, sizeof(json_batch));
+  if ((config.message_broker_output & PRINT_OUTPUT_JSON) && config.sql_multi_values)
+    P_json_batch_init(&json_batch, config.message_broker_mv_format, config.sql_multi_values,
+		      config.message_broker_mv_bytes, config.message_broker_mv_compress);
 
-    avro_buf = malloc(config.avro_buffer_size);
-
-    if (!avro_buf) {
-      Log(LOG_ERR, "ERROR ( %s/%s ): malloc() failed (avro_buf). Exiting ..\n", config.name, config.type);
-      exit_plugin(1);
-    }
-
-    avro_writer = avro_writer_memory(avro_buf, config.avro_buffer_size);
-  }
+#ifdef WITH_AVRO
+  if (config.message_broker_output & PRINT_OUTPUT_AVRO) p_avro_encoder_reset(&avro_acct_enc);
 #endif
 
   for (j = 0; j < index; j++) {
@@ -473,27 +476,14 @@ void kafka_cache_purge(struct chained_cache *queue[], int index)
     }
     else if (config.message_broker_output & PRINT_OUTPUT_AVRO) {
 #ifdef WITH_AVRO
-      avro_value_iface_t *avro_iface = avro_generic_class_from_schema(avro_acct_schema);
-      avro_value_t avro_value = compose_avro(config.what_to_count, config.what_to_count_2, queue[j]->flow_type,
+      avro_value_t *avro_value = p_avro_encoder_value(&avro_acct_enc);
+
+      compose_avro_value(config.what_to_count, config.what_to_count_2, queue[j]->flow_type,
                            &queue[j]->primitives, pbgp, pnat, pmpls, pcust, pvlen, queue[j]->bytes_counter,
                            queue[j]->packet_counter, queue[j]->flow_counter, queue[j]->tcp_flags,
-                           &queue[j]->basetime, queue[j]->stitch, avro_iface);
-      size_t avro_value_size;
-
-      avro_value_sizeof(&avro_value, &avro_value_size);
+                           &queue[j]->basetime, queue[j]->stitch, avro_value);
 
-      if (avro_value_size > config.avro_buffer_size) {
-        Log(LOG_ERR, "ERROR ( %s/%s ): AVRO: insufficient buffer size (avro_buffer_size=%u)\n",
-            config.name, config.type, config.avro_buffer_size);
-        Log(LOG_ERR, "ERROR ( %s/%s ): AVRO: increase value or look for avro_buffer_size in CONFIG-KEYS document.\n\n",
-            config.name, config.type);
-        exit_plugin(1);
-      }
-      else if (avro_value_size >= (config.avro_buffer_size - avro_writer_tell(avro_writer))) {
-        avro_buffer_full = TRUE;
-        j--;
-      }
-      else if (avro_value_write(avro_writer, &avro_value)) {
+      if (p_avro_encoder_append(&avro_acct_enc)) {
         Log(LOG_ERR, "ERROR ( %s/%s ): AVRO: unable to write value: %s\n",
             config.name, config.type, avro_strerror());
         exit_plugin(1);
@@ -502,38 +492,43 @@ void kafka_cache_purge(struct chained_cache *queue[], int index)
         mv_num++;
       }
 
-      avro_value_decref(&avro_value);
-      avro_value_iface_decref(avro_iface);
+      if (p_avro_encoder_len(&avro_acct_enc) >= config.avro_buffer_size) avro_buffer_full = TRUE;
 #else
       if (config.debug) Log(LOG_DEBUG, "DEBUG ( %s/%s ): compose_avro(): AVRO object not created due to missing --enable-avro\n", config.name, config.type);
 #endif
     }
 
     if (config.message_broker_output & PRINT_OUTPUT_JSON) {
-#ifdef WITH_JANSSON
       if (json_str && config.sql_multi_values) {
-        json_t *elem = NULL;
-        char *tmp_str = json_str;
-        int do_free = FALSE;
-
-        if (json_array_size(array) >= config.sql_multi_values) {
-          json_str = json_dumps(array, JSON_PRESERVE_ORDER);
-          json_array_clear(array);
-          mv_num_save = mv_num;
-          mv_num = 0;
-        }
-        else do_free = TRUE;
+        size_t json_len = strlen(json_str);
 
-        elem = json_loads(tmp_str, 0, NULL);
-        json_array_append_new(array, elem);
-        mv_num++;
+        if (P_json_batch_is_full(&json_batch, json_len)) {
+          if (config.amqp_routing_key_rr) {
+            P_handle_table_dyn_rr(dyn_kafka_topic, SRVBUFLEN, orig_kafka_topic, &kafkap_kafka_host.topic_rr);
+            p_kafka_set_topic(&kafkap_kafka_host, dyn_kafka_topic);
+          }
 
-        if (do_free) {
-          free(json_str);
-          json_str = NULL;
+          json_msg = P_json_batch_finish(&json_batch, &json_msg_len);
+          if (json_msg) {
+            if (!json_batch.compress) Log(LOG_DEBUG, "DEBUG ( %s/%s ): %s\n\n", config.name, config.type, json_msg);
+            ret = p_kafka_produce_data(&kafkap_kafka_host, json_msg, json_msg_len);
+          }
+          else ret = ERR;
+
+          mv_num_save = json_batch.records;
+          P_json_batch_reset(&json_batch);
+
+          if (!ret) qn += mv_num_save;
+          else {
+            free(json_str);
+            break;
+          }
         }
+
+        P_json_batch_append(&json_batch, json_str, json_len);
+        free(json_str);
+        json_str = NULL;
       }
-#endif
 
       if (json_str) {
         if (is_topic_dyn) {
@@ -547,15 +542,13 @@ void kafka_cache_purge(struct chained_cache *queue[], int index)
         }
 
         Log(LOG_DEBUG, "DEBUG ( %s/%s ): %s\n\n", config.name, config.type, json_str);
-        ret = p_kafka_produce_data(&kafkap_kafka_host, json_str, strlen(json_str));
+        ret = p_kafka_produce_data_nocopy(&kafkap_kafka_host, json_str, strlen(json_str));
 
-        free(json_str);
+        /* on success json_str is now owned by librdkafka */
+        if (ret) free(json_str);
         json_str = NULL;
 
-        if (!ret) {
-          if (!config.sql_multi_values) qn++;
-          else qn += mv_num_save;
-        }
+        if (!ret) qn++;
         else break;
       }
     }
@@ -572,8 +565,9 @@ void kafka_cache_purge(struct chained_cache *queue[], int index)
           p_kafka_set_topic(&kafkap_kafka_host, dyn_kafka_topic);
         }
 
-        ret = p_kafka_produce_data(&kafkap_kafka_host, avro_buf, avro_writer_tell(avro_writer));
-        avro_writer_reset(avro_writer);
+        avro_msg = p_avro_encoder_finish(&avro_acct_enc, &avro_msg_len);
+        ret = p_kafka_produce_data(&kafkap_kafka_host, avro_msg, avro_msg_len);
+        p_avro_encoder_reset(&avro_acct_enc);
         avro_buffer_full = FALSE;
         mv_num_save = mv_num;
         mv_num = 0;
@@ -587,32 +581,25 @@ void kafka_cache_purge(struct chained_cache *queue[], int index)
 
   if (config.sql_multi_values) {
     if (config.message_broker_output & PRINT_OUTPUT_JSON) {
-#ifdef WITH_JANSSON
-      if (json_array_size(array)) {
-	char *json_str;
-
-	json_str = json_dumps(array, JSON_PRESERVE_ORDER);
-	json_array_clear(array);
-	json_decref(array);
-
-	if (json_str) {
-	  /* no handling of dyn routing keys here: not compatible */
-	  Log(LOG_DEBUG, "DEBUG ( %s/%s ): %s\n\n", config.name, config.type, json_str);
-	  ret = p_kafka_produce_data(&kafkap_kafka_host, json_str, strlen(json_str));
-
-	  free(json_str);
-	  json_str = NULL;
-
-	  if (!ret) qn += mv_num;
+      if (json_batch.records) {
+	/* no handling of dyn routing keys here: not compatible */
+	json_msg = P_json_batch_finish(&json_batch, &json_msg_len);
+	if (json_msg) {
+	  if (!json_batch.compress) Log(LOG_DEBUG, "DEBUG ( %s/%s ): %s\n\n", config.name, config.type, json_msg);
+	  ret = p_kafka_produce_data(&kafkap_kafka_host, json_msg, json_msg_len);
+
+	  if (!ret) qn += json_batch.records;
 	}
       }
-#endif
+
+      P_json_batch_free(&json_batch);
     }
     else if (config.message_broker_output & PRINT_OUTPUT_AVRO) {
 #ifdef WITH_AVRO
-      if (avro_writer_tell(avro_writer)) {
-        ret = p_kafka_produce_data(&kafkap_kafka_host, avro_buf, avro_writer_tell(avro_writer));
-        avro_writer_free(avro_writer);
+      if (p_avro_encoder_len(&avro_acct_enc)) {
+        avro_msg = p_avro_encoder_finish(&avro_acct_enc, &avro_msg_len);
+        ret = p_kafka_produce_data(&kafkap_kafka_host, avro_msg, avro_msg_len);
+        p_avro_encoder_reset(&avro_acct_enc);
 
         if (!ret) qn += mv_num;
       }
@@ -648,10 +635,6 @@ void kafka_cache_purge(struct chained_cache *queue[], int index)
   if (config.sql_trigger_exec) P_trigger_exec(config.sql_trigger_exec); 
 
   if (empty_pcust) free(empty_pcust);
-
-#ifdef WITH_AVRO
-  if (avro_buf) free(avro_buf);
-#endif
 }
 
 #ifdef WITH_AVRO
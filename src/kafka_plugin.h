@@ -54,5 +54,6 @@ EXT struct timeval sbasetime;
 #ifdef WITH_AVRO
 EXT char *avro_buf;
 EXT avro_schema_t avro_acct_schema;
+EXT struct p_avro_encoder avro_acct_enc;
 #endif
 #undef EXT
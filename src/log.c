@@ -24,14 +24,79 @@
 /* includes */
 #include "pmacct.h"
 
+#if defined ENABLE_THREADS
+/* variables */
+static struct log_async log_async;
+static int log_async_init_done;
+
+/* prototypes */
+static struct log_async_ring *log_async_ring_get();
+static void log_async_write(time_t, short int, char *);
+static void log_async_drain_locked();
+static int log_async_ratelimit(struct log_async_ring *, char *, time_t);
+#endif
+
 /* functions */
 void Log(short int level, char *msg, ...)
 {
   va_list ap;
   char syslog_string[LOGSTRLEN];
+#if defined ENABLE_THREADS
+  struct log_async_ring *ring;
+  struct log_async_msg *slot;
+  time_t now;
+#endif
   
   if ((level == LOG_DEBUG) && (!config.debug && !debug)) return;
 
+#if defined ENABLE_THREADS
+  /*
+     A signal handler logging while its thread is already in here, ie. half
+     way through a push, would corrupt the ring or deadlock on the mutex: it
+     falls back to writing synchronously.
+  */
+  if (config.logfile_async && (ring = log_async_ring_get()) && !ring->busy) {
+    ring->busy = TRUE;
+    __sync_synchronize();
+
+    /* errors are written synchronously, after whatever is queued */
+    if (level <= LOG_ERR) {
+      va_start(ap, msg);
+      vsnprintf(syslog_string, LOGSTRLEN, msg, ap);
+      va_end(ap);
+
+      pthread_mutex_lock(&log_async.mutex);
+      log_async_drain_locked();
+      log_async_write(time(NULL), level, syslog_string);
+      if (log_async.logfile_fd) fflush(log_async.logfile_fd);
+      pthread_mutex_unlock(&log_async.mutex);
+    }
+    /* checked before formatting: a burst into a full ring costs little */
+    else if ((ring->head - ring->tail) >= LOG_ASYNC_SLOTS) ring->dropped++;
+    else {
+      now = time(NULL);
+
+      if (!config.logfile_async_ratelimit || !log_async_ratelimit(ring, msg, now)) {
+        slot = &ring->slots[ring->head & (LOG_ASYNC_SLOTS - 1)];
+        slot->stamp = now;
+        slot->level = level;
+        va_start(ap, msg);
+        vsnprintf(slot->str, LOGSTRLEN, msg, ap);
+        va_end(ap);
+
+        /* the slot must be visible before the new head */
+        __sync_synchronize();
+        ring->head++;
+      }
+    }
+
+    __sync_synchronize();
+    ring->busy = FALSE;
+
+    return;
+  }
+#endif
+
   if (!config.syslog && !config.logfile_fd) {
     va_start(ap, msg);
     vfprintf(stderr, msg, ap);
@@ -60,6 +125,308 @@ void Log(short int level, char *msg, ...)
   }
 }
 
+#if defined ENABLE_THREADS
+static void log_async_emit(time_t stamp, short int level, char *str)
+{
+  struct tm tmnow;
+
+  if (config.syslog) syslog(level, "%s", str);
+
+  if (config.logfile) {
+    if (!log_async.logfile_fd) return;
+
+    if (stamp != log_async.tstamp) {
+      localtime_r(&stamp, &tmnow);
+      strftime(log_async.tstamp_str, SRVBUFLEN, "%b %d %H:%M:%S", &tmnow);
+      log_async.tstamp = stamp;
+    }
+
+    fprintf(log_async.logfile_fd, "%s %s", log_async.tstamp_str, str);
+  }
+  else if (!config.syslog) fputs(str, stderr);
+}
+
+static void log_async_repeat_flush()
+{
+  char str[LOGSTRLEN];
+
+  if (log_async.last_repeated) {
+    snprintf(str, LOGSTRLEN, "INFO ( %s/%s ): last message repeated %u times\n", config.name, config.type,
+	     log_async.last_repeated);
+    log_async_emit(time(NULL), log_async.last_level, str);
+    log_async.last_repeated = 0;
+  }
+}
+
+/* identical consecutive messages are counted rather than written */
+static void log_async_write(time_t stamp, short int level, char *str)
+{
+  if (level == log_async.last_level && !strcmp(str, log_async.last_str)) {
+    if (!log_async.last_repeated) log_async.last_stamp = stamp;
+    log_async.last_repeated++;
+
+    return;
+  }
+
+  log_async_repeat_flush();
+  log_async_emit(stamp, level, str);
+
+  log_async.last_level = level;
+  strlcpy(log_async.last_str, str, LOGSTRLEN);
+}
+
+/* follows the log file being rotated away, without relying on SIGHUP */
+static void log_async_reopen(time_t now)
+{
+  struct stat st, st_fd;
+
+  if (!config.logfile || now < (log_async.reopen_check + LOG_ASYNC_REOPEN_INTERVAL)) return;
+  log_async.reopen_check = now;
+
+  if (log_async.logfile_fd) {
+    if (!stat(config.logfile, &st) && !fstat(fileno(log_async.logfile_fd), &st_fd) &&
+	st.st_dev == st_fd.st_dev && st.st_ino == st_fd.st_ino) return;
+
+    fclose(log_async.logfile_fd);
+  }
+
+  log_async.logfile_fd = fopen(config.logfile, "a");
+}
+
+static void log_async_drain_locked()
+{
+  struct log_async_ring *ring;
+  struct log_async_msg *slot;
+  char str[LOGSTRLEN];
+  u_int32_t head, dropped, ratelimited;
+  int reported = FALSE;
+  time_t now;
+
+  now = time(NULL);
+  log_async_reopen(now);
+
+  for (ring = log_async.rings; ring; ring = ring->next) {
+    head = ring->head;
+    __sync_synchronize();
+
+    while (ring->tail != head) {
+      slot = &ring->slots[ring->tail & (LOG_ASYNC_SLOTS - 1)];
+      log_async_write(slot->stamp, slot->level, slot->str);
+
+      /* done with the slot before handing it back */
+      __sync_synchronize();
+      ring->tail++;
+    }
+
+    dropped = ring->dropped;
+    if (dropped != ring->dropped_seen) {
+      snprintf(str, LOGSTRLEN, "WARN ( %s/%s ): log: %u messages dropped (queue full)\n", config.name, config.type,
+	       (dropped - ring->dropped_seen));
+      log_async_write(now, LOG_WARNING, str);
+      ring->dropped_seen = dropped;
+    }
+
+    ratelimited = ring->ratelimited;
+    if (ratelimited != ring->ratelimited_seen && now >= (log_async.ratelimit_report + LOG_ASYNC_REPEAT_INTERVAL)) {
+      snprintf(str, LOGSTRLEN, "WARN ( %s/%s ): log: %u messages suppressed (logfile_async_ratelimit)\n", config.name, config.type,
+	       (ratelimited - ring->ratelimited_seen));
+      log_async_write(now, LOG_WARNING, str);
+      ring->ratelimited_seen = ratelimited;
+      reported = TRUE;
+    }
+  }
+
+  if (reported) log_async.ratelimit_report = now;
+
+  if (log_async.last_repeated && now >= (log_async.last_stamp + LOG_ASYNC_REPEAT_INTERVAL))
+    log_async_repeat_flush();
+}
+
+/* token bucket per call site: up to logfile_async_ratelimit messages per second */
+static int log_async_ratelimit(struct log_async_ring *ring, char *msg, time_t now)
+{
+  struct log_async_site *site = &ring->sites[(((unsigned long) msg) >> 3) % LOG_ASYNC_SITES];
+  u_int32_t limit = config.logfile_async_ratelimit;
+  u_int64_t tokens;
+
+  /* a call site not seen before, or colliding, starts with a full bucket */
+  if (site->msg != msg) {
+    site->msg = msg;
+    site->tokens = limit;
+    site->stamp = now;
+  }
+  else if (now > site->stamp) {
+    tokens = site->tokens + ((u_int64_t) (now - site->stamp) * limit);
+    site->tokens = MIN(tokens, limit);
+    site->stamp = now;
+  }
+
+  if (!site->tokens) {
+    ring->ratelimited++;
+    return TRUE;
+  }
+
+  site->tokens--;
+
+  return FALSE;
+}
+
+void log_async_flush()
+{
+  struct log_async_ring *ring;
+
+  if (log_async.state != LOG_ASYNC_RUNNING) return;
+
+  /*
+     exit() from a signal handler that interrupted this thread in Log() may
+     find the mutex already held by us: then flush only if it is free.
+  */
+  ring = pthread_getspecific(log_async.ring_key);
+  if (ring && ring->busy) {
+    if (pthread_mutex_trylock(&log_async.mutex)) return;
+  }
+  else pthread_mutex_lock(&log_async.mutex);
+
+  log_async_drain_locked();
+  log_async_repeat_flush();
+  if (log_async.logfile_fd) fflush(log_async.logfile_fd);
+  pthread_mutex_unlock(&log_async.mutex);
+}
+
+static void *log_async_writer(void *arg)
+{
+  struct log_async_ring *ring;
+  int pending;
+
+  for (;;) {
+    pthread_mutex_lock(&log_async.mutex);
+    log_async_drain_locked();
+    if (log_async.logfile_fd) fflush(log_async.logfile_fd);
+    else fflush(stderr);
+    pthread_mutex_unlock(&log_async.mutex);
+
+    for (pending = FALSE, ring = log_async.rings; ring && !pending; ring = ring->next)
+      if (ring->tail != ring->head) pending = TRUE;
+
+    if (!pending) usleep(LOG_ASYNC_IDLE_USECS);
+  }
+
+  return NULL;
+}
+
+/* no drain can be in progress across fork(), the child restarts its own writer */
+static void log_async_ring_release(void *ring)
+{
+  __sync_lock_release(&((struct log_async_ring *) ring)->owned);
+}
+
+static void log_async_atfork_prepare()
+{
+  pthread_mutex_lock(&log_async.mutex);
+}
+
+static void log_async_atfork_parent()
+{
+  pthread_mutex_unlock(&log_async.mutex);
+}
+
+static void log_async_atfork_child()
+{
+  struct log_async_ring *ring, *own;
+
+  own = pthread_getspecific(log_async.ring_key);
+
+  /* what is queued is the parent's to write */
+  for (ring = log_async.rings; ring; ring = ring->next) {
+    ring->tail = ring->head;
+    ring->dropped_seen = ring->dropped;
+    ring->ratelimited_seen = ring->ratelimited;
+    if (ring != own) ring->owned = FALSE;
+  }
+
+  if (log_async.logfile_fd) fclose(log_async.logfile_fd);
+  log_async.logfile_fd = NULL;
+  log_async.reopen_check = 0;
+  log_async.last_repeated = 0;
+  log_async.last_str[0] = '\0';
+
+  pthread_mutex_init(&log_async.mutex, NULL);
+  log_async.state = LOG_ASYNC_STOPPED;
+}
+
+static int log_async_start()
+{
+  sigset_t sigs, sigs_old;
+  int ret;
+
+  if (!__sync_bool_compare_and_swap(&log_async.state, LOG_ASYNC_STOPPED, LOG_ASYNC_STARTING))
+    return (log_async.state == LOG_ASYNC_RUNNING);
+
+  if (!log_async_init_done) {
+    pthread_mutex_init(&log_async.mutex, NULL);
+
+    if (pthread_key_create(&log_async.ring_key, log_async_ring_release) ||
+	pthread_atfork(log_async_atfork_prepare, log_async_atfork_parent, log_async_atfork_child) ||
+	atexit(log_async_flush)) {
+      log_async.state = LOG_ASYNC_FAILED;
+      Log(LOG_WARNING, "WARN ( %s/%s ): log: unable to initialize asynchronous logging.\n", config.name, config.type);
+      return FALSE;
+    }
+
+    log_async_init_done = TRUE;
+  }
+
+  log_async_reopen(time(NULL));
+
+  /* signals are for the other threads to handle */
+  sigfillset(&sigs);
+  pthread_sigmask(SIG_BLOCK, &sigs, &sigs_old);
+  ret = pthread_create(&log_async.thread, NULL, log_async_writer, NULL);
+  pthread_sigmask(SIG_SETMASK, &sigs_old, NULL);
+
+  if (ret) {
+    log_async.state = LOG_ASYNC_FAILED;
+    Log(LOG_WARNING, "WARN ( %s/%s ): log: pthread_create(): %s\n", config.name, config.type, strerror(ret));
+    return FALSE;
+  }
+
+  pthread_detach(log_async.thread);
+  __sync_synchronize();
+  log_async.state = LOG_ASYNC_RUNNING;
+
+  return TRUE;
+}
+
+static struct log_async_ring *log_async_ring_get()
+{
+  struct log_async_ring *ring;
+
+  if (log_async.state != LOG_ASYNC_RUNNING && !log_async_start()) return NULL;
+
+  if ((ring = pthread_getspecific(log_async.ring_key))) return ring;
+
+  /* a ring released by a thread gone */
+  for (ring = log_async.rings; ring; ring = ring->next)
+    if (!ring->owned && __sync_bool_compare_and_swap(&ring->owned, FALSE, TRUE)) break;
+
+  if (!ring) {
+    ring = malloc(sizeof(struct log_async_ring));
+    if (!ring) return NULL;
+
+    memset(ring, 0, sizeof(struct log_async_ring));
+    ring->owned = TRUE;
+
+    do {
+      ring->next = log_async.rings;
+    } while (!__sync_bool_compare_and_swap(&log_async.rings, ring->next, ring));
+  }
+
+  pthread_setspecific(log_async.ring_key, ring);
+
+  return ring;
+}
+#endif
+
 int parse_log_facility(const char *facility)
 {
   int i;
@@ -25,6 +25,11 @@
 
 /* defines */
 #define LOGSTRLEN LONGSRVBUFLEN 
+#define LOG_ASYNC_SLOTS			1024	/* per thread, power of 2 */
+#define LOG_ASYNC_IDLE_USECS		10000
+#define LOG_ASYNC_REPEAT_INTERVAL	10	/* secs */
+#define LOG_ASYNC_REOPEN_INTERVAL	1	/* secs */
+#define LOG_ASYNC_SITES			64	/* per thread, rate limited call sites */
 
 struct _facility_map {
   char string[10];
@@ -62,6 +67,70 @@ struct _log_notifications {
   struct log_notification geoip_ipv6_file_null;
 };
 
+#if defined ENABLE_THREADS
+#include <pthread.h>
+
+/*
+   Asynchronous logging: each thread formats its messages into a ring of
+   its own (single producer, single consumer) which a writer thread drains
+   to the log file, syslog or stderr. Producers never block: when their
+   ring is full the message is dropped and counted. Rings are not freed
+   but released when their thread exits and claimed again by new threads.
+*/
+struct log_async_msg {
+  time_t stamp;
+  short int level;
+  char str[LOGSTRLEN];
+};
+
+/* token bucket of a call site, told apart by its format string */
+struct log_async_site {
+  char *msg;
+  time_t stamp;
+  u_int32_t tokens;
+};
+
+struct log_async_ring {
+  struct log_async_ring *next;
+  int owned;
+  volatile sig_atomic_t busy;		/* producer is in Log(), ie. interrupted by a signal */
+  volatile u_int32_t head;		/* written by the producer */
+  volatile u_int32_t tail;		/* written by the writer */
+  volatile u_int32_t dropped;		/* written by the producer */
+  u_int32_t dropped_seen;		/* written by the writer */
+  volatile u_int32_t ratelimited;	/* written by the producer */
+  u_int32_t ratelimited_seen;		/* written by the writer */
+  struct log_async_site sites[LOG_ASYNC_SITES];
+  struct log_async_msg slots[LOG_ASYNC_SLOTS];
+};
+
+#define LOG_ASYNC_STOPPED	0
+#define LOG_ASYNC_STARTING	1
+#define LOG_ASYNC_RUNNING	2
+#define LOG_ASYNC_FAILED	3
+
+struct log_async {
+  int state;
+  struct log_async_ring *rings;
+  pthread_key_t ring_key;
+  pthread_mutex_t mutex;		/* serializes draining */
+  pthread_t thread;
+
+  FILE *logfile_fd;			/* own handle, follows rotations */
+  time_t reopen_check;
+
+  time_t tstamp;			/* cached timestamp string */
+  char tstamp_str[SRVBUFLEN];
+
+  short int last_level;			/* repeated messages */
+  char last_str[LOGSTRLEN];
+  u_int32_t last_repeated;
+  time_t last_stamp;
+
+  time_t ratelimit_report;		/* last suppressed messages report */
+};
+#endif
+
 /* prototypes */
 #if (!defined __LOG_C)
 #define EXT extern
@@ -69,6 +138,9 @@ struct _log_notifications {
 #define EXT
 #endif
 EXT void Log(short int, char *, ...);
+#if defined ENABLE_THREADS
+EXT void log_async_flush();
+#endif
 EXT int parse_log_facility(const char *);
 EXT void log_notification_init(struct log_notification *);
 EXT void log_notifications_init(struct _log_notifications *);
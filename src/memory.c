@@ -133,3 +133,77 @@ struct memory_pool_desc *request_memory_pool(int size)
   new_pool->len = size;
   return new_pool;
 }
+
+void init_imt_history()
+{
+  size_t col_len;
+
+  memset(&hist, 0, sizeof(hist));
+  if (!config.imt_history_bins) return;
+
+  hist.bins = config.imt_history_bins;
+  if (config.imt_history_bin_time) hist.bin_time = config.imt_history_bin_time;
+  else hist.bin_time = IMT_HISTORY_BIN_TIME;
+
+  /* one slot per element the memory table is able to hold */
+  hist.slots = config.buckets+(config.num_memory_pools*(config.memory_pool_size/sizeof(struct acc)));
+  col_len = (size_t) hist.bins*hist.slots;
+
+  /* anonymous mappings come zeroed: pages are touched only once used */
+  hist.bytes = (pm_counter_t *) map_shared(0, col_len*3*sizeof(pm_counter_t), PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+  if (hist.bytes == MAP_FAILED) {
+    Log(LOG_WARNING, "WARN ( %s/%s ): unable to allocate history bins (%llu bytes). History disabled.\n", config.name, config.type,
+	(unsigned long long) (col_len*3*sizeof(pm_counter_t)));
+    memset(&hist, 0, sizeof(hist));
+    return;
+  }
+  hist.packets = hist.bytes+col_len;
+  hist.flows = hist.packets+col_len;
+
+  hist.next_slot = config.buckets;
+  hist.start = time(NULL);
+  hist.epoch = hist.start/hist.bin_time;
+
+  Log(LOG_INFO, "INFO ( %s/%s ): history enabled: %u bins, %u secs each, %u slots.\n", config.name, config.type,
+	hist.bins, hist.bin_time, hist.slots);
+}
+
+void clear_imt_history(time_t now)
+{
+  if (!hist.bins) return;
+
+  memset(hist.bytes, 0, (size_t) hist.bins*hist.slots*3*sizeof(pm_counter_t));
+  hist.next_slot = config.buckets;
+  hist.start = now;
+  hist.epoch = now/hist.bin_time;
+}
+
+void init_imt_index()
+{
+  pm_cfgreg_t index_wtc[IMT_INDEX_MAX] = { COUNT_SRC_HOST, COUNT_DST_HOST, COUNT_SRC_AS, COUNT_DST_AS };
+  int ix;
+
+  memset(imt_index, 0, sizeof(imt_index));
+  if (!config.imt_index) return;
+
+  /* only primitives part of the aggregation method get indexed */
+  for (ix = 0; ix < IMT_INDEX_MAX; ix++) {
+    if (!(config.what_to_count & index_wtc[ix])) continue;
+
+    imt_index[ix] = (struct acc **) map_shared(0, config.buckets*sizeof(struct acc *), PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+    if (imt_index[ix] == MAP_FAILED) {
+      Log(LOG_WARNING, "WARN ( %s/%s ): unable to allocate secondary indexes. Indexes disabled.\n", config.name, config.type);
+      memset(imt_index, 0, sizeof(imt_index));
+      return;
+    }
+  }
+}
+
+void clear_imt_index()
+{
+  int ix;
+
+  for (ix = 0; ix < IMT_INDEX_MAX; ix++) {
+    if (imt_index[ix]) memset(imt_index[ix], 0, config.buckets*sizeof(struct acc *));
+  }
+}
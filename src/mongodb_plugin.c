@@ -220,6 +220,7 @@ void mongodb_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
         pollagain = FALSE;
         memcpy(pipebuf, rg->ptr, bufsz);
         rg->ptr += bufsz;
+        stats_shm_update_ring_rd(((struct ch_buf_hdr *) pipebuf)->seq);
       }
 #ifdef WITH_RABBITMQ
       else {
@@ -198,6 +198,7 @@ void mysql_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
         pollagain = FALSE;
         memcpy(pipebuf, rg->ptr, bufsz);
         rg->ptr += bufsz;
+        stats_shm_update_ring_rd(((struct ch_buf_hdr *) pipebuf)->seq);
       }
 #ifdef WITH_RABBITMQ
       else {
@@ -272,6 +273,10 @@ int MY_cache_dbop(struct DBdesc *db, struct db_cache *cache_elem, struct insert_
   char *ptr_values, *ptr_where, *ptr_mv, *ptr_set, *ptr_insert;
   int num=0, num_set=0, ret=0, have_flows=0, len=0;
 
+  if (config.sql_prepared_statements && !MY_prep_fallback && (idata->mv.last_queue_elem ||
+      (cache_elem->flow_type != NF9_FTYPE_EVENT && cache_elem->flow_type != NF9_FTYPE_OPTION)))
+    return MY_cache_dbop_prepared(db, cache_elem, idata);
+
   if (idata->mv.last_queue_elem) {
     ret = mysql_query(db->desc, multi_values_buffer);
     Log(LOG_DEBUG, "DEBUG ( %s/%s ): %d VALUES statements sent to the MySQL server.\n",
@@ -338,7 +343,8 @@ int MY_cache_dbop(struct DBdesc *db, struct db_cache *cache_elem, struct insert_
 #endif
     }
 
-    if (config.sql_multi_values) { 
+    /* multi-values buffer is in use by prepared statements */
+    if (config.sql_multi_values && (!config.sql_prepared_statements || MY_prep_fallback)) { 
       multi_values_handling:
       len = config.sql_multi_values-idata->mv.buffer_offset; 
       if (!idata->mv.buffer_elem_num) {
@@ -420,6 +426,280 @@ int MY_cache_dbop(struct DBdesc *db, struct db_cache *cache_elem, struct insert_
   else return ret;
 }
 
+/*
+  Same as MY_cache_dbop() but statements are prepared once per table and only
+  the values of the cache entry are bound; with sql_dont_try_update and
+  sql_multi_values, entries are INSERTed MY_PREP_BULK_ROWS at a time.
+*/
+int MY_cache_dbop_prepared(struct DBdesc *db, struct db_cache *cache_elem, struct insert_data *idata)
+{
+  struct MY_prep *prep = (db->type == BE_TYPE_PRIMARY ? &MY_prep_p : &MY_prep_b);
+  struct MY_prep_stmt tail;
+  int ret = FALSE, idx;
+
+  db->errmsg = NULL;
+
+  /* table name may change across purges with dynamic tables */
+  if (strncmp(prep->key, insert_clause, sizeof(prep->key))) {
+    MY_prep_close(prep);
+
+    snprintf(sql_data, sizeof(sql_data), "%s%s%s", insert_clause, insert_counters_clause, sql_prep_values_clause);
+    if ((ret = MY_prep_init(db, &prep->insert, sql_data, 1))) goto signal_error;
+
+    if (!config.sql_dont_try_update) {
+      snprintf(sql_data, sizeof(sql_data), "%s%s%s", update_clause, sql_prep_set_clause, sql_prep_where_clause);
+      if ((ret = MY_prep_init(db, &prep->update, sql_data, 0))) goto signal_error;
+    }
+    else if (config.sql_multi_values) {
+      prep->bulk_rows = MIN(MY_PREP_BULK_ROWS, MY_PREP_MAX_PARAMS/sql_prep_values_num);
+      prep->pending = malloc(prep->bulk_rows*sizeof(struct db_cache *));
+      if (!prep->pending || (ret = MY_prep_init(db, &prep->bulk, NULL, prep->bulk_rows))) {
+	if (!ret) ret = ERR;
+	goto signal_error;
+      }
+    }
+
+    strlcpy(prep->key, insert_clause, sizeof(prep->key));
+  }
+
+  if (prep->bulk_rows) {
+    /* multi-row INSERT: wrap-up, sized on the entries left */
+    if (idata->mv.last_queue_elem) {
+      memset(&tail, 0, sizeof(tail));
+      if ((ret = MY_prep_init(db, &tail, NULL, idata->mv.buffer_elem_num))) {
+	MY_prep_stmt_close(&tail);
+	goto signal_error;
+      }
+      for (idx = 0; idx < idata->mv.buffer_elem_num; idx++) {
+	if (MY_prep_fill(&tail, idx*sql_prep_values_num, sql_prep_values, sql_prep_values_num, prep->pending[idx], idata) == ERR) {
+	  MY_prep_stmt_close(&tail);
+	  return MY_prep_fallback_dbop(db, prep, cache_elem, idata);
+	}
+      }
+      ret = MY_prep_exec(db, &tail);
+      MY_prep_stmt_close(&tail);
+      if (ret) goto signal_error;
+
+      Log(LOG_DEBUG, "DEBUG ( %s/%s ): %d VALUES statements sent to the MySQL server.\n",
+		      config.name, config.type, idata->mv.buffer_elem_num);
+      idata->iqn++;
+      idata->mv.buffer_elem_num = FALSE;
+
+      return FALSE;
+    }
+
+    if (!idata->mv.buffer_elem_num) idata->mv.head_buffer_elem = idata->current_queue_elem;
+    prep->pending[idata->mv.buffer_elem_num] = cache_elem;
+    idata->mv.buffer_elem_num++;
+    idata->een++;
+
+    if (idata->mv.buffer_elem_num == prep->bulk_rows) {
+      for (idx = 0; idx < prep->bulk_rows; idx++) {
+	if (MY_prep_fill(&prep->bulk, idx*sql_prep_values_num, sql_prep_values, sql_prep_values_num, prep->pending[idx], idata) == ERR)
+	  return MY_prep_fallback_dbop(db, prep, cache_elem, idata);
+      }
+      if ((ret = MY_prep_exec(db, &prep->bulk))) goto signal_error;
+
+      Log(LOG_DEBUG, "DEBUG ( %s/%s ): %d VALUES statements sent to the MySQL server.\n",
+		      config.name, config.type, idata->mv.buffer_elem_num);
+      idata->iqn++;
+      idata->mv.buffer_elem_num = FALSE;
+      idata->mv.head_buffer_elem = FALSE;
+    }
+
+    return FALSE;
+  }
+
+  if (prep->update.stmt) {
+    if (MY_prep_fill(&prep->update, 0, sql_prep_set, sql_prep_set_num, cache_elem, idata) == ERR ||
+	MY_prep_fill(&prep->update, sql_prep_set_num, sql_prep_where, sql_prep_where_num, cache_elem, idata) == ERR)
+      return MY_prep_fallback_dbop(db, prep, cache_elem, idata);
+    if ((ret = MY_prep_exec(db, &prep->update))) goto signal_error;
+
+    if (mysql_stmt_affected_rows(prep->update.stmt)) {
+      idata->uqn++;
+      idata->een++;
+
+      return FALSE;
+    }
+  }
+
+  if (MY_prep_fill(&prep->insert, 0, sql_prep_values, sql_prep_values_num, cache_elem, idata) == ERR)
+    return MY_prep_fallback_dbop(db, prep, cache_elem, idata);
+  if ((ret = MY_prep_exec(db, &prep->insert))) goto signal_error;
+  idata->iqn++;
+  idata->een++;
+
+  return FALSE;
+
+  signal_error:
+  if (!prep->key[0]) Log(LOG_DEBUG, "DEBUG ( %s/%s ): FAILED query follows:\n%s\n", config.name, config.type, sql_data);
+  if (idata->mv.buffer_elem_num) {
+    if (!idata->recover || db->type != BE_TYPE_PRIMARY) {
+      /* DB failure: we will rewind the multi-values buffer */
+      idata->current_queue_elem = idata->mv.head_buffer_elem;
+      idata->mv.buffer_elem_num = 0;
+    }
+  }
+  if (!db->errmsg) MY_get_errmsg(db);
+  if (db->errmsg) Log(LOG_ERR, "ERROR ( %s/%s ): %s\n\n", config.name, config.type, db->errmsg);
+
+  if (ret == 1062) return FALSE; /* not signalling duplicate entry problems */
+  else return ret;
+}
+
+/*
+  Prepares either an INSERT, if 'rows' is set, or the UPDATE and binds its
+  parameters to the slots; 'query' is composed here for multi-row INSERTs.
+*/
+int MY_prep_init(struct DBdesc *db, struct MY_prep_stmt *pst, char *query, int rows)
+{
+  struct sql_prep_field *f;
+  char *bulk_query = NULL, *tuple;
+  int idx, len, ret;
+
+  if (rows) pst->nparams = rows*sql_prep_values_num;
+  else pst->nparams = sql_prep_set_num+sql_prep_where_num;
+
+  if (!query) {
+    tuple = sql_prep_values_clause+7; /* cut the initial 'VALUES' */
+    len = strlen(insert_clause)+strlen(insert_counters_clause)+strlen(" VALUES")+rows*(strlen(tuple)+1)+1;
+    if (!(bulk_query = malloc(len))) return ERR;
+
+    snprintf(bulk_query, len, "%s%s VALUES", insert_clause, insert_counters_clause);
+    for (idx = 0; idx < rows; idx++) {
+      if (idx) strcat(bulk_query, ",");
+      strcat(bulk_query, tuple);
+    }
+    query = bulk_query;
+  }
+
+  pst->bind = calloc(pst->nparams, sizeof(MYSQL_BIND));
+  pst->slots = calloc(pst->nparams, sizeof(struct MY_prep_slot));
+  if (!pst->bind || !pst->slots || !(pst->stmt = mysql_stmt_init(db->desc))) {
+    free(bulk_query);
+    return ERR;
+  }
+
+  ret = mysql_stmt_prepare(pst->stmt, query, strlen(query));
+  free(bulk_query);
+  if (ret) goto stmt_error;
+
+  for (idx = 0; idx < pst->nparams; idx++) {
+    if (rows) f = &sql_prep_values[idx % sql_prep_values_num];
+    else if (idx < sql_prep_set_num) f = &sql_prep_set[idx];
+    else f = &sql_prep_where[idx-sql_prep_set_num];
+
+    if (f->source == SQL_BIND_INT) {
+      pst->bind[idx].buffer_type = MYSQL_TYPE_LONGLONG;
+      pst->bind[idx].buffer = &pst->slots[idx].ival;
+      pst->bind[idx].is_unsigned = TRUE;
+    }
+    else {
+      if (!(pst->slots[idx].sval = malloc(LONGSRVBUFLEN))) return ERR;
+      pst->bind[idx].buffer_type = MYSQL_TYPE_STRING;
+      pst->bind[idx].buffer = pst->slots[idx].sval;
+      pst->bind[idx].buffer_length = LONGSRVBUFLEN;
+      pst->bind[idx].length = &pst->slots[idx].len;
+    }
+  }
+
+  if (mysql_stmt_bind_param(pst->stmt, pst->bind)) goto stmt_error;
+
+  return FALSE;
+
+  stmt_error:
+  db->errmsg = (char *) mysql_stmt_error(pst->stmt);
+
+  return mysql_stmt_errno(pst->stmt);
+}
+
+/* fills 'num' slots from 'base' on with the values of a cache entry */
+int MY_prep_fill(struct MY_prep_stmt *pst, int base, struct sql_prep_field *fields, int num, struct db_cache *cache_elem, struct insert_data *idata)
+{
+  struct MY_prep_slot *slot;
+  int idx, len = 0;
+
+  for (idx = 0; idx < num; idx++) {
+    slot = &pst->slots[base+idx];
+    if (sql_prep_value(&fields[idx], cache_elem, idata, &slot->ival, slot->sval, LONGSRVBUFLEN, &len) == ERR) return ERR;
+    slot->len = len;
+  }
+
+  return FALSE;
+}
+
+/*
+  A cache entry could not be bound to the prepared statements: plain queries
+  are used for the rest of the purge. Entries waiting for the multi-row
+  INSERT are moved over to the multi-values buffer, which is flushed if
+  this was the wrap-up call.
+*/
+int MY_prep_fallback_dbop(struct DBdesc *db, struct MY_prep *prep, struct db_cache *cache_elem, struct insert_data *idata)
+{
+  struct multi_values mv;
+  unsigned int iqn = idata->iqn;
+  int idx, ret = FALSE;
+
+  if (!MY_prep_fallback) {
+    Log(LOG_WARNING, "WARN ( %s/%s ): unable to bind values to prepared statements. Using plain queries for the rest of the purge.\n",
+	config.name, config.type);
+    MY_prep_fallback = TRUE;
+  }
+
+  if (!prep->bulk_rows) return MY_cache_dbop(db, cache_elem, idata);
+
+  memcpy(&mv, &idata->mv, sizeof(struct multi_values));
+  memset(&idata->mv, 0, sizeof(struct multi_values));
+  idata->een -= mv.buffer_elem_num;
+
+  for (idx = 0; idx < mv.buffer_elem_num; idx++) {
+    if ((ret = MY_cache_dbop(db, prep->pending[idx], idata))) return ret;
+  }
+
+  /* nothing was flushed meanwhile: on failure rewind to the first pending entry */
+  if (idata->mv.buffer_elem_num && idata->iqn == iqn) idata->mv.head_buffer_elem = mv.head_buffer_elem;
+
+  if (mv.last_queue_elem && idata->mv.buffer_elem_num) {
+    idata->mv.last_queue_elem = TRUE;
+    ret = MY_cache_dbop(db, cache_elem, idata);
+  }
+
+  return ret;
+}
+
+int MY_prep_exec(struct DBdesc *db, struct MY_prep_stmt *pst)
+{
+  if (mysql_stmt_execute(pst->stmt)) {
+    db->errmsg = (char *) mysql_stmt_error(pst->stmt);
+    return mysql_stmt_errno(pst->stmt);
+  }
+
+  return FALSE;
+}
+
+void MY_prep_stmt_close(struct MY_prep_stmt *pst)
+{
+  int idx;
+
+  if (pst->stmt) mysql_stmt_close(pst->stmt);
+  if (pst->slots) {
+    for (idx = 0; idx < pst->nparams; idx++) free(pst->slots[idx].sval);
+    free(pst->slots);
+  }
+  free(pst->bind);
+  memset(pst, 0, sizeof(struct MY_prep_stmt));
+}
+
+void MY_prep_close(struct MY_prep *prep)
+{
+  MY_prep_stmt_close(&prep->insert);
+  MY_prep_stmt_close(&prep->update);
+  MY_prep_stmt_close(&prep->bulk);
+  free(prep->pending);
+  memset(prep, 0, sizeof(struct MY_prep));
+}
+
 void MY_cache_purge(struct db_cache *queue[], int index, struct insert_data *idata)
 {
   struct db_cache *LastElemCommitted = NULL;
@@ -456,6 +736,7 @@ void MY_cache_purge(struct db_cache *queue[], int index, struct insert_data *ida
   strlcpy(orig_insert_clause, insert_clause, LONGSRVBUFLEN);
   strlcpy(orig_update_clause, update_clause, LONGSRVBUFLEN);
   strlcpy(orig_lock_clause, lock_clause, LONGSRVBUFLEN);
+  MY_prep_fallback = FALSE;
 
   start:
   memset(&idata->mv, 0, sizeof(struct multi_values));
@@ -644,6 +925,11 @@ int MY_compose_static_queries()
     }
   }
 
+  if (config.sql_prepared_statements && sql_prep_compile(primitives, have_flows) == ERR) {
+    Log(LOG_WARNING, "WARN ( %s/%s ): sql_prepared_statements disabled.\n", config.name, config.type);
+    config.sql_prepared_statements = FALSE;
+  }
+
   return primitives;
 }
 
@@ -682,6 +968,9 @@ void MY_DB_Connect(struct DBdesc *db, char *host)
 
 void MY_DB_Close(struct BE_descs *bed)
 {
+  MY_prep_close(&MY_prep_p);
+  MY_prep_close(&MY_prep_b);
+
   if (bed->p->connected) mysql_close(bed->p->desc);
   if (bed->b->connected) mysql_close(bed->b->desc);
 }
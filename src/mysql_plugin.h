@@ -26,9 +26,43 @@
 #include <mysql/mysql.h>
 #endif
 
+/* defines */
+#define MY_PREP_BULK_ROWS	256
+#define MY_PREP_MAX_PARAMS	65535
+
+/* structures */
+struct MY_prep_slot {
+  unsigned long long ival;
+  char *sval;
+  unsigned long len;
+};
+
+struct MY_prep_stmt {
+  MYSQL_STMT *stmt;
+  MYSQL_BIND *bind;
+  struct MY_prep_slot *slots;
+  int nparams;
+};
+
+struct MY_prep {
+  char key[LONGSRVBUFLEN];		/* insert_clause the statements were prepared for */
+  struct MY_prep_stmt insert;
+  struct MY_prep_stmt update;
+  struct MY_prep_stmt bulk;		/* multi-row INSERT, see sql_multi_values */
+  int bulk_rows;
+  struct db_cache **pending;		/* entries waiting for the multi-row INSERT */
+};
+
 /* prototypes */
 void mysql_plugin(int, struct configuration *, void *);
 int MY_cache_dbop(struct DBdesc *, struct db_cache *, struct insert_data *);
+int MY_cache_dbop_prepared(struct DBdesc *, struct db_cache *, struct insert_data *);
+int MY_prep_init(struct DBdesc *, struct MY_prep_stmt *, char *, int);
+int MY_prep_fill(struct MY_prep_stmt *, int, struct sql_prep_field *, int, struct db_cache *, struct insert_data *);
+int MY_prep_exec(struct DBdesc *, struct MY_prep_stmt *);
+int MY_prep_fallback_dbop(struct DBdesc *, struct MY_prep *, struct db_cache *, struct insert_data *);
+void MY_prep_stmt_close(struct MY_prep_stmt *);
+void MY_prep_close(struct MY_prep *);
 void MY_cache_purge(struct db_cache *[], int, struct insert_data *);
 int MY_evaluate_history(int);
 int MY_compose_static_queries();
@@ -55,3 +89,5 @@ static char mysql_table_v6[] = "acct_v6";
 static char mysql_table_v7[] = "acct_v7";
 static char mysql_table_v8[] = "acct_v8";
 static char mysql_table_bgp[] = "acct_bgp";
+static struct MY_prep MY_prep_p, MY_prep_b;
+static int MY_prep_fallback;
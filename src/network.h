@@ -303,6 +303,21 @@ struct class_st {
    u_int8_t fa;			/* flow accumulator */
 };
 
+/* packet_ptrs enrichment memo: primitives computed once per packet and
+   shared by all plugin channels; reset by exec_plugins() */
+#define PM_ENRICH_SRC_GEOIP		0x00000001
+#define PM_ENRICH_DST_GEOIP		0x00000002
+#define PM_ENRICH_SRC_GEOIPV2		0x00000004
+#define PM_ENRICH_DST_GEOIPV2		0x00000008
+#define PM_ENRICH_SRC_COUNTRY		0x00000010
+#define PM_ENRICH_DST_COUNTRY		0x00000020
+#define PM_ENRICH_SRC_POCODE		0x00000040
+#define PM_ENRICH_DST_POCODE		0x00000080
+#define PM_ENRICH_SRC_COUNTRY_FOUND	0x00000100
+#define PM_ENRICH_DST_COUNTRY_FOUND	0x00000200
+#define PM_ENRICH_SRC_POCODE_FOUND	0x00000400
+#define PM_ENRICH_DST_POCODE_FOUND	0x00000800
+
 struct packet_ptrs {
   struct pcap_pkthdr *pkthdr; /* ptr to header structure passed by libpcap */
   u_char *f_agent; /* ptr to flow export agent */ 
@@ -345,8 +360,8 @@ struct packet_ptrs {
   char *bgp_dst_info; /* pointer to bgp_info structure for destination prefix, if any */ 
   char *bgp_peer; /* record BGP peer's Router-ID */
   char *bgp_nexthop_info; /* record bgp_info of BGP next-hop in case of follow-up */
-  char *igp_src; /* pointer to IGP node structure for source prefix, if any */
-  char *igp_dst; /* pointer to IGP node structure for destination prefix, if any */
+  char *igp_src; /* pointer to IGP prefix structure for source prefix, if any */
+  char *igp_dst; /* pointer to IGP prefix structure for destination prefix, if any */
   char *igp_src_info; /* pointer to IGP node info structure for source prefix, if any */
   char *igp_dst_info; /* pointer to IGP node info structure for destination prefix, if any */
   u_int8_t lm_mask_src; /* Longest match for source prefix (network mask bits) */
@@ -376,9 +391,20 @@ struct packet_ptrs {
   u_int8_t renormalized; /* Is it renormalized yet ? */
   char *pkt_data_ptrs[CUSTOM_PRIMITIVE_MAX_PPTRS_IDX]; /* indexed packet pointers */
   u_int16_t pkt_proto[CUSTOM_PRIMITIVE_MAX_PPTRS_IDX]; /* indexed packet protocols */
+  u_int32_t enrich; /* enrichment memo: PM_ENRICH_* fields below already computed */
+#if defined (WITH_GEOIP)
+  u_int32_t geoip_src_id;
+  u_int32_t geoip_dst_id;
+#endif
 #if defined (WITH_GEOIPV2)
   MMDB_lookup_result_s geoipv2_src;
   MMDB_lookup_result_s geoipv2_dst;
+  struct geoipv2_lpm_value *geoipv2_src_lpm;
+  struct geoipv2_lpm_value *geoipv2_dst_lpm;
+  pm_country_t geoipv2_src_country;
+  pm_country_t geoipv2_dst_country;
+  pm_pocode_t geoipv2_src_pocode;
+  pm_pocode_t geoipv2_dst_pocode;
 #endif
 };
 
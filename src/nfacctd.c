@@ -104,6 +104,7 @@ int main(int argc,char **argv, char **envp)
   struct id_table sampling_table;
   u_int32_t idx;
   int ret;
+  struct timespec decode_tstamp;
 
 #if defined ENABLE_IPV6
   struct sockaddr_storage server, client;
@@ -913,6 +914,9 @@ int main(int argc,char **argv, char **envp)
   /* fixing NetFlow v9/IPFIX template func pointers */
   get_ext_db_ie_by_type = &ext_db_get_ie;
 
+  /* live statistics for external tools, if a segment is configured */
+  stats_shm_wrapper();
+
   /* Main loop */
   for(;;) {
     ret = recvfrom(config.sock, netflow_packet, NETFLOW_MSG_SIZE, 0, (struct sockaddr *) &client, &clen);
@@ -955,6 +959,9 @@ int main(int argc,char **argv, char **envp)
       gettimeofday(&reload_map_tstamp, NULL);
     }
 
+    if (config.nfacctd_stats_refresh_time) clock_gettime(CLOCK_MONOTONIC, &decode_tstamp);
+    pptrs.v4.f_status = NULL;
+
     if (data_plugins) {
       /* We will change byte ordering in order to avoid a bunch of ntohs() calls */
       ((struct struct_header_v5 *)netflow_packet)->version = ntohs(((struct struct_header_v5 *)netflow_packet)->version);
@@ -990,6 +997,10 @@ int main(int argc,char **argv, char **envp)
     else if (tee_plugins) {
       process_raw_packet(netflow_packet, ret, &pptrs, &req);
     }
+
+    update_datagram_status_table((struct xflow_status_entry *) pptrs.v4.f_status, ret,
+				 config.nfacctd_stats_refresh_time ? &decode_tstamp : NULL);
+    if (config.nfacctd_stats_refresh_time) print_status_table_periodic(&decode_tstamp);
   }
 }
 
@@ -1070,6 +1081,8 @@ void process_v5_packet(unsigned char *pkt, u_int16_t len, struct packet_ptrs *pp
   pptrs->flow_type = NF9_FTYPE_TRAFFIC;
 
   if ((count <= V5_MAXFLOWS) && ((count*NfDataV5Sz)+NfHdrV5Sz == len)) {
+    if (pptrs->f_status) ((struct xflow_status_entry *) pptrs->f_status)->counters.flows += count;
+
     if (config.debug) {
       sa_to_addr((struct sockaddr *)pptrs->f_agent, &debug_a, &debug_agent_port);
       addr_to_str(debug_agent_addr, &debug_a);
@@ -1142,6 +1155,8 @@ void process_v7_packet(unsigned char *pkt, u_int16_t len, struct packet_ptrs *pp
   pptrs->flow_type = NF9_FTYPE_TRAFFIC;
 
   if ((count <= V7_MAXFLOWS) && ((count*NfDataV7Sz)+NfHdrV7Sz == len)) {
+    if (pptrs->f_status) ((struct xflow_status_entry *) pptrs->f_status)->counters.flows += count;
+
     while (count) {
       reset_net_status(pptrs);
       pptrs->f_data = (unsigned char *) exp_v7;
@@ -1207,6 +1222,8 @@ void process_v8_packet(unsigned char *pkt, u_int16_t len, struct packet_ptrs *pp
   pptrs->flow_type = NF9_FTYPE_TRAFFIC;
 
   if ((count <= v8_handlers[hdr_v8->aggregation].max_flows) && ((count*v8_handlers[hdr_v8->aggregation].exp_size)+NfHdrV8Sz <= len)) {
+    if (pptrs->f_status) ((struct xflow_status_entry *) pptrs->f_status)->counters.flows += count;
+
     while (count) {
       reset_net_status(pptrs);
       pptrs->f_data = exp_v8;
@@ -1379,6 +1396,8 @@ void process_v9_packet(unsigned char *pkt, u_int16_t len, struct packet_ptrs_vec
 
     tpl = find_template(data_hdr->flow_id, pptrs, fid, SourceId);
     if (!tpl) {
+      if (pptrs->f_status) ((struct xflow_status_entry *) pptrs->f_status)->counters.tpl_misses++;
+
       sa_to_addr((struct sockaddr *)pptrs->f_agent, &debug_a, &debug_agent_port);
       addr_to_str(debug_agent_addr, &debug_a);
 
@@ -2117,6 +2136,8 @@ void process_v9_packet(unsigned char *pkt, u_int16_t len, struct packet_ptrs_vec
 
   if (off < len) goto process_flowset;
 
+  if (pptrsv->v4.f_status) ((struct xflow_status_entry *) pptrsv->v4.f_status)->counters.flows += FlowSeqInc;
+
   /* Set IPFIX Sequence number increment */
   if (version == 10) {
     struct xflow_status_entry *entry = (struct xflow_status_entry *) pptrsv->v4.f_status;
@@ -1649,6 +1649,7 @@ read_data:
         pollagain = FALSE;
         memcpy(pipebuf, rg->ptr, bufsz);
         rg->ptr += bufsz;
+        stats_shm_update_ring_rd(((struct ch_buf_hdr *) pipebuf)->seq);
       }
 #ifdef WITH_RABBITMQ
       else if (config.pipe_amqp) {
@@ -0,0 +1,891 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2017 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#define __PARQUET_COMMON_C
+
+/* includes */
+#include "pmacct.h"
+#include "pmacct-data.h"
+#include "pmacct-build.h"
+
+/* defines */
+#define PM_PARQUET_CREATED_BY	"pmacct version " PMACCT_VERSION " (build " PMACCT_BUILD ")"
+
+/* Thrift compact protocol, used for page headers and for the file footer */
+#define TC_I32			5
+#define TC_I64			6
+#define TC_BINARY		8
+#define TC_LIST			9
+#define TC_STRUCT		12
+#define TC_MAX_DEPTH		8
+
+struct p_thrift {
+  struct p_parquet_buf *b;
+  int16_t last[TC_MAX_DEPTH];
+  int depth;
+};
+
+/* Functions */
+static void pq_buf_reserve(struct p_parquet_buf *b, size_t len)
+{
+  size_t new_len;
+
+  if (b->off + len <= b->len) return;
+
+  new_len = MAX(b->len * 2, LARGEBUFLEN);
+  while (new_len < b->off + len) new_len *= 2;
+
+  b->base = realloc(b->base, new_len);
+  if (!b->base) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): PARQUET: realloc() failed (buffer). Exiting ..\n", config.name, config.type);
+    exit_plugin(1);
+  }
+
+  b->len = new_len;
+}
+
+static void pq_put(struct p_parquet_buf *b, void *ptr, size_t len)
+{
+  pq_buf_reserve(b, len);
+  memcpy(b->base + b->off, ptr, len);
+  b->off += len;
+}
+
+static void pq_put_byte(struct p_parquet_buf *b, u_char byte)
+{
+  pq_buf_reserve(b, 1);
+  b->base[b->off] = byte;
+  b->off++;
+}
+
+static void pq_put_varint(struct p_parquet_buf *b, u_int64_t value)
+{
+  while (value >= 0x80) {
+    pq_put_byte(b, (value & 0x7F) | 0x80);
+    value >>= 7;
+  }
+
+  pq_put_byte(b, value);
+}
+
+static void pq_put_zigzag(struct p_parquet_buf *b, int64_t value)
+{
+  pq_put_varint(b, ((u_int64_t) value << 1) ^ (u_int64_t) (value >> 63));
+}
+
+static void pq_put_le32(struct p_parquet_buf *b, u_int32_t value)
+{
+  int idx;
+
+  for (idx = 0; idx < 4; idx++, value >>= 8) pq_put_byte(b, value & 0xFF);
+}
+
+static void pq_put_le64(struct p_parquet_buf *b, u_int64_t value)
+{
+  int idx;
+
+  for (idx = 0; idx < 8; idx++, value >>= 8) pq_put_byte(b, value & 0xFF);
+}
+
+/* values are packed LSB first; 'count' is expected to be a multiple of 8 */
+static void pq_put_bitpacked(struct p_parquet_buf *b, u_int64_t *values, int count, int width)
+{
+  u_char acc = 0;
+  int idx, consumed, take, acc_bits = 0;
+
+  if (!width) return;
+
+  for (idx = 0; idx < count; idx++) {
+    for (consumed = 0; consumed < width; consumed += take) {
+      take = MIN(width - consumed, 8 - acc_bits);
+      acc |= ((values[idx] >> consumed) & ((1U << take) - 1)) << acc_bits;
+      acc_bits += take;
+
+      if (acc_bits == 8) {
+	pq_put_byte(b, acc);
+	acc = 0;
+	acc_bits = 0;
+      }
+    }
+  }
+
+  if (acc_bits) pq_put_byte(b, acc);
+}
+
+static int pq_bit_width(u_int64_t value)
+{
+  int width = 0;
+
+  for (; value; value >>= 1) width++;
+
+  return width;
+}
+
+static void th_init(struct p_thrift *t, struct p_parquet_buf *b)
+{
+  memset(t, 0, sizeof(struct p_thrift));
+  t->b = b;
+}
+
+static void th_field(struct p_thrift *t, int16_t id, u_char type)
+{
+  int16_t delta = id - t->last[t->depth];
+
+  if (delta > 0 && delta <= 15) pq_put_byte(t->b, (delta << 4) | type);
+  else {
+    pq_put_byte(t->b, type);
+    pq_put_zigzag(t->b, id);
+  }
+
+  t->last[t->depth] = id;
+}
+
+static void th_struct_begin(struct p_thrift *t)
+{
+  t->depth++;
+  t->last[t->depth] = 0;
+}
+
+static void th_struct_end(struct p_thrift *t)
+{
+  pq_put_byte(t->b, 0);
+  t->depth--;
+}
+
+static void th_struct_field(struct p_thrift *t, int16_t id)
+{
+  th_field(t, id, TC_STRUCT);
+  th_struct_begin(t);
+}
+
+static void th_i32(struct p_thrift *t, int16_t id, int32_t value)
+{
+  th_field(t, id, TC_I32);
+  pq_put_zigzag(t->b, value);
+}
+
+static void th_i64(struct p_thrift *t, int16_t id, int64_t value)
+{
+  th_field(t, id, TC_I64);
+  pq_put_zigzag(t->b, value);
+}
+
+static void th_binary(struct p_thrift *t, int16_t id, void *ptr, u_int32_t len)
+{
+  th_field(t, id, TC_BINARY);
+  pq_put_varint(t->b, len);
+  pq_put(t->b, ptr, len);
+}
+
+static void th_list(struct p_thrift *t, int16_t id, u_char elem_type, u_int32_t size)
+{
+  th_field(t, id, TC_LIST);
+
+  if (size < 15) pq_put_byte(t->b, (size << 4) | elem_type);
+  else {
+    pq_put_byte(t->b, 0xF0 | elem_type);
+    pq_put_varint(t->b, size);
+  }
+}
+
+static int pq_write(struct p_parquet_writer *w, void *ptr, size_t len)
+{
+  if (len && fwrite(ptr, 1, len, w->f) != len) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): PARQUET: write failed: %s\n", config.name, config.type, strerror(errno));
+    return ERR;
+  }
+
+  w->off += len;
+
+  return SUCCESS;
+}
+
+static char *pq_string(struct p_parquet_column *col, u_int32_t row, u_int32_t *len)
+{
+  *len = col->soff[row + 1] - col->soff[row];
+
+  return (char *) col->sbuf.base + col->soff[row];
+}
+
+static int pq_value_cmp(struct p_parquet_column *col, u_int32_t row1, u_int32_t row2)
+{
+  if (col->type == PM_PARQUET_INT64) {
+    if (col->conv == PM_PARQUET_CT_UINT_64) {
+      if (col->ival[row1] < col->ival[row2]) return -1;
+      return (col->ival[row1] > col->ival[row2]);
+    }
+    else {
+      if ((int64_t) col->ival[row1] < (int64_t) col->ival[row2]) return -1;
+      return ((int64_t) col->ival[row1] > (int64_t) col->ival[row2]);
+    }
+  }
+  else {
+    char *str1, *str2;
+    u_int32_t len1, len2;
+    int ret;
+
+    str1 = pq_string(col, row1, &len1);
+    str2 = pq_string(col, row2, &len2);
+
+    ret = memcmp(str1, str2, MIN(len1, len2));
+    if (ret) return ret;
+
+    if (len1 < len2) return -1;
+    return (len1 > len2);
+  }
+}
+
+static u_int32_t pq_value_hash(struct p_parquet_column *col, u_int32_t row)
+{
+  u_char *ptr, tmp[8];
+  u_int32_t len, idx, hash = 2166136261U;
+
+  if (col->type == PM_PARQUET_INT64) {
+    for (idx = 0; idx < 8; idx++) tmp[idx] = (col->ival[row] >> (idx * 8)) & 0xFF;
+    ptr = tmp;
+    len = 8;
+  }
+  else ptr = (u_char *) pq_string(col, row, &len);
+
+  for (idx = 0; idx < len; idx++) {
+    hash ^= ptr[idx];
+    hash *= 16777619U;
+  }
+
+  return hash;
+}
+
+static void pq_put_plain(struct p_parquet_buf *b, struct p_parquet_column *col, u_int32_t row)
+{
+  if (col->type == PM_PARQUET_INT64) pq_put_le64(b, col->ival[row]);
+  else {
+    char *str;
+    u_int32_t len;
+
+    str = pq_string(col, row, &len);
+    pq_put_le32(b, len);
+    pq_put(b, str, len);
+  }
+}
+
+static void pq_chunk_stats(struct p_parquet_writer *w, struct p_parquet_column *col, struct p_parquet_chunk_meta *chunk)
+{
+  u_int32_t row, min_row = 0, max_row = 0;
+  char *str;
+  int idx;
+
+  for (row = 1; row < w->rows; row++) {
+    if (pq_value_cmp(col, row, min_row) < 0) min_row = row;
+    if (pq_value_cmp(col, row, max_row) > 0) max_row = row;
+  }
+
+  if (col->type == PM_PARQUET_INT64) {
+    for (idx = 0; idx < 8; idx++) {
+      chunk->min[idx] = (col->ival[min_row] >> (idx * 8)) & 0xFF;
+      chunk->max[idx] = (col->ival[max_row] >> (idx * 8)) & 0xFF;
+    }
+
+    chunk->min_len = chunk->max_len = 8;
+  }
+  else {
+    str = pq_string(col, min_row, &chunk->min_len);
+    chunk->min_str = malloc(chunk->min_len + 1);
+    if (chunk->min_str) memcpy(chunk->min_str, str, chunk->min_len);
+
+    str = pq_string(col, max_row, &chunk->max_len);
+    chunk->max_str = malloc(chunk->max_len + 1);
+    if (chunk->max_str) memcpy(chunk->max_str, str, chunk->max_len);
+
+    if (!chunk->min_str || !chunk->max_str) {
+      Log(LOG_ERR, "ERROR ( %s/%s ): PARQUET: malloc() failed (stats). Exiting ..\n", config.name, config.type);
+      exit_plugin(1);
+    }
+  }
+}
+
+/*
+   Builds the dictionary of the column values for the current row group;
+   returns the number of entries or zero if dictionary encoding does not pay
+   off (ie. too many distinct values).
+*/
+static u_int32_t pq_build_dict(struct p_parquet_writer *w, struct p_parquet_column *col)
+{
+  u_int32_t row, slot, entry, entries = 0, max_entries, mask = w->dict_tbl_size - 1;
+
+  max_entries = MIN(PM_PARQUET_DICT_MAX, w->dict_tbl_size / 2);
+  memset(w->dict_tbl, 0, w->dict_tbl_size * sizeof(u_int32_t));
+
+  for (row = 0; row < w->rows; row++) {
+    for (slot = pq_value_hash(col, row) & mask; w->dict_tbl[slot]; slot = (slot + 1) & mask) {
+      entry = w->dict_tbl[slot] - 1;
+      if (!pq_value_cmp(col, row, w->dict_rows[entry])) break;
+    }
+
+    if (!w->dict_tbl[slot]) {
+      if (entries == max_entries) return 0;
+
+      w->dict_rows[entries] = row;
+      entries++;
+      w->dict_tbl[slot] = entries;
+    }
+
+    w->dict_idx[row] = w->dict_tbl[slot] - 1;
+  }
+
+  if ((entries * 2) > w->rows) return 0;
+
+  return entries;
+}
+
+static void pq_encode_bitpacked_run(struct p_parquet_buf *b, u_int32_t *values, u_int32_t count, int width)
+{
+  u_int64_t group[8];
+  u_int32_t groups = (count + 7) / 8, idx, vidx;
+
+  pq_put_varint(b, (groups << 1) | 1);
+
+  for (idx = 0; idx < groups; idx++) {
+    memset(group, 0, sizeof(group));
+    for (vidx = 0; vidx < 8 && (idx * 8 + vidx) < count; vidx++) group[vidx] = values[idx * 8 + vidx];
+    pq_put_bitpacked(b, group, 8, width);
+  }
+}
+
+/*
+   RLE / bit-packing hybrid encoding of the dictionary indices: runs of at
+   least 8 repeated indices are RLE encoded, anything else is bit-packed.
+   Bit-packed runs are always closed on a multiple of 8 values, the last one
+   apart, as required by the format.
+*/
+static void pq_encode_dict_idx(struct p_parquet_buf *b, u_int32_t *idx, u_int32_t count, int width)
+{
+  u_int32_t pos = 0, start = 0, run, fill, byte;
+
+  pq_put_byte(b, width);
+
+  while (pos < count) {
+    for (run = 1; (pos + run) < count && idx[pos + run] == idx[pos]; run++);
+
+    fill = (8 - ((pos - start) % 8)) % 8;
+    if (run >= (fill + 8)) {
+      pos += fill;
+      run -= fill;
+
+      if (pos > start) pq_encode_bitpacked_run(b, &idx[start], pos - start, width);
+
+      pq_put_varint(b, run << 1);
+      for (byte = 0; byte < (width + 7) / 8; byte++) pq_put_byte(b, (idx[pos] >> (byte * 8)) & 0xFF);
+
+      pos += run;
+      start = pos;
+    }
+    else pos += run;
+  }
+
+  if (count > start) pq_encode_bitpacked_run(b, &idx[start], count - start, width);
+}
+
+static void pq_encode_delta(struct p_parquet_buf *b, u_int64_t *values, u_int32_t count)
+{
+  u_int64_t deltas[PM_PARQUET_DELTA_BLOCK];
+  u_int32_t idx, cnt, mb, mb_len = PM_PARQUET_DELTA_BLOCK / PM_PARQUET_DELTA_MINIBLOCKS, k;
+  int64_t delta, min_delta = 0;
+  int widths[PM_PARQUET_DELTA_MINIBLOCKS];
+
+  pq_put_varint(b, PM_PARQUET_DELTA_BLOCK);
+  pq_put_varint(b, PM_PARQUET_DELTA_MINIBLOCKS);
+  pq_put_varint(b, count);
+  pq_put_zigzag(b, count ? (int64_t) values[0] : 0);
+
+  for (idx = 1; idx < count; idx += cnt) {
+    cnt = MIN(PM_PARQUET_DELTA_BLOCK, count - idx);
+
+    for (k = 0; k < cnt; k++) {
+      delta = (int64_t) (values[idx + k] - values[idx + k - 1]);
+      if (!k || delta < min_delta) min_delta = delta;
+      deltas[k] = (u_int64_t) delta;
+    }
+
+    for (k = 0; k < PM_PARQUET_DELTA_BLOCK; k++) {
+      if (k < cnt) deltas[k] -= (u_int64_t) min_delta;
+      else deltas[k] = 0;
+    }
+
+    pq_put_zigzag(b, min_delta);
+
+    for (mb = 0; mb < PM_PARQUET_DELTA_MINIBLOCKS; mb++) {
+      u_int64_t max = 0;
+
+      for (k = mb * mb_len; k < (mb + 1) * mb_len; k++) if (deltas[k] > max) max = deltas[k];
+      widths[mb] = pq_bit_width(max);
+      pq_put_byte(b, widths[mb]);
+    }
+
+    for (mb = 0; mb < PM_PARQUET_DELTA_MINIBLOCKS && (mb * mb_len) < cnt; mb++)
+      pq_put_bitpacked(b, &deltas[mb * mb_len], mb_len, widths[mb]);
+  }
+}
+
+static int pq_write_page(struct p_parquet_writer *w, int type, struct p_parquet_buf *body, u_int32_t num_values,
+			 int encoding, struct p_parquet_chunk_meta *chunk)
+{
+  struct p_thrift t;
+  u_char *data = body->base;
+  size_t clen = body->off;
+
+#if defined (HAVE_ZLIB)
+  if (w->codec == PM_PARQUET_CODEC_GZIP) {
+    z_stream zs;
+
+    memset(&zs, 0, sizeof(zs));
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+      Log(LOG_ERR, "ERROR ( %s/%s ): PARQUET: deflateInit2() failed.\n", config.name, config.type);
+      return ERR;
+    }
+
+    w->zpage.off = 0;
+    pq_buf_reserve(&w->zpage, deflateBound(&zs, body->off));
+
+    zs.next_in = body->base;
+    zs.avail_in = body->off;
+    zs.next_out = w->zpage.base;
+    zs.avail_out = w->zpage.len;
+
+    if (deflate(&zs, Z_FINISH) != Z_STREAM_END) {
+      Log(LOG_ERR, "ERROR ( %s/%s ): PARQUET: deflate() failed.\n", config.name, config.type);
+      deflateEnd(&zs);
+      return ERR;
+    }
+
+    data = w->zpage.base;
+    clen = zs.total_out;
+    deflateEnd(&zs);
+  }
+#endif
+
+  w->hdr.off = 0;
+  th_init(&t, &w->hdr);
+  th_i32(&t, 1, type);
+  th_i32(&t, 2, body->off);
+  th_i32(&t, 3, clen);
+
+  if (type == PM_PARQUET_PAGE_DATA) {
+    th_struct_field(&t, 5);
+    th_i32(&t, 1, num_values);
+    th_i32(&t, 2, encoding);
+    th_i32(&t, 3, PM_PARQUET_ENC_RLE);
+    th_i32(&t, 4, PM_PARQUET_ENC_RLE);
+    th_struct_end(&t);
+  }
+  else {
+    th_struct_field(&t, 7);
+    th_i32(&t, 1, num_values);
+    th_i32(&t, 2, encoding);
+    th_struct_end(&t);
+  }
+
+  pq_put_byte(&w->hdr, 0);
+
+  chunk->uncompressed += w->hdr.off + body->off;
+  chunk->compressed += w->hdr.off + clen;
+
+  if (pq_write(w, w->hdr.base, w->hdr.off) == ERR) return ERR;
+
+  return pq_write(w, data, clen);
+}
+
+static void pq_chunk_add_encoding(struct p_parquet_chunk_meta *chunk, int encoding)
+{
+  chunk->encodings[chunk->num_encodings] = encoding;
+  chunk->num_encodings++;
+}
+
+static int pq_write_chunk(struct p_parquet_writer *w, struct p_parquet_column *col)
+{
+  struct p_parquet_chunk_meta *chunk;
+  u_int32_t row, entries = 0;
+  int encoding;
+
+  col->chunks = realloc(col->chunks, (w->num_rgs + 1) * sizeof(struct p_parquet_chunk_meta));
+  if (!col->chunks) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): PARQUET: realloc() failed (chunks). Exiting ..\n", config.name, config.type);
+    exit_plugin(1);
+  }
+
+  chunk = &col->chunks[w->num_rgs];
+  memset(chunk, 0, sizeof(struct p_parquet_chunk_meta));
+  chunk->dict_page_off = -1;
+  chunk->num_values = w->rows;
+
+  pq_chunk_stats(w, col, chunk);
+
+  if (col->hint == PM_PARQUET_HINT_DICT) entries = pq_build_dict(w, col);
+
+  w->page.off = 0;
+
+  if (entries) {
+    w->dict.off = 0;
+    for (row = 0; row < entries; row++) pq_put_plain(&w->dict, col, w->dict_rows[row]);
+
+    chunk->dict_page_off = w->off;
+    if (pq_write_page(w, PM_PARQUET_PAGE_DICTIONARY, &w->dict, entries, PM_PARQUET_ENC_PLAIN, chunk) == ERR)
+      return ERR;
+
+    pq_encode_dict_idx(&w->page, w->dict_idx, w->rows, MAX(pq_bit_width(entries - 1), 1));
+    encoding = PM_PARQUET_ENC_RLE_DICTIONARY;
+    pq_chunk_add_encoding(chunk, PM_PARQUET_ENC_PLAIN);
+  }
+  else if (col->hint == PM_PARQUET_HINT_DELTA && col->type == PM_PARQUET_INT64) {
+    pq_encode_delta(&w->page, col->ival, w->rows);
+    encoding = PM_PARQUET_ENC_DELTA_BINARY;
+  }
+  else {
+    for (row = 0; row < w->rows; row++) pq_put_plain(&w->page, col, row);
+    encoding = PM_PARQUET_ENC_PLAIN;
+  }
+
+  pq_chunk_add_encoding(chunk, PM_PARQUET_ENC_RLE);
+  pq_chunk_add_encoding(chunk, encoding);
+
+  chunk->data_page_off = w->off;
+
+  return pq_write_page(w, PM_PARQUET_PAGE_DATA, &w->page, w->rows, encoding, chunk);
+}
+
+static void pq_reset_rows(struct p_parquet_writer *w)
+{
+  int idx;
+
+  w->rows = 0;
+
+  for (idx = 0; idx < w->num_cols; idx++) {
+    if (w->cols[idx].type == PM_PARQUET_BYTE_ARRAY) {
+      w->cols[idx].sbuf.off = 0;
+      w->cols[idx].soff[0] = 0;
+    }
+  }
+}
+
+static int pq_flush_row_group(struct p_parquet_writer *w)
+{
+  struct p_parquet_chunk_meta *chunk;
+  int64_t bytes = 0;
+  int idx, ret = SUCCESS;
+
+  if (!w->rows) return SUCCESS;
+
+  for (idx = 0; idx < w->num_cols && ret == SUCCESS; idx++) {
+    ret = pq_write_chunk(w, &w->cols[idx]);
+    if (ret == SUCCESS) bytes += w->cols[idx].chunks[w->num_rgs].uncompressed;
+  }
+
+  if (ret == ERR) {
+    /* the row group is lost: never leave rows pending past rg_size */
+    while (idx--) {
+      chunk = &w->cols[idx].chunks[w->num_rgs];
+      if (chunk->min_str) free(chunk->min_str);
+      if (chunk->max_str) free(chunk->max_str);
+      chunk->min_str = chunk->max_str = NULL;
+    }
+
+    pq_reset_rows(w);
+
+    return ERR;
+  }
+
+  w->rg_rows = realloc(w->rg_rows, (w->num_rgs + 1) * sizeof(int64_t));
+  w->rg_bytes = realloc(w->rg_bytes, (w->num_rgs + 1) * sizeof(int64_t));
+  if (!w->rg_rows || !w->rg_bytes) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): PARQUET: realloc() failed (row groups). Exiting ..\n", config.name, config.type);
+    exit_plugin(1);
+  }
+
+  w->rg_rows[w->num_rgs] = w->rows;
+  w->rg_bytes[w->num_rgs] = bytes;
+  w->num_rgs++;
+
+  w->total_rows += w->rows;
+  pq_reset_rows(w);
+
+  return SUCCESS;
+}
+
+static int pq_write_footer(struct p_parquet_writer *w)
+{
+  struct p_parquet_buf *b = &w->hdr;
+  struct p_parquet_column *col;
+  struct p_parquet_chunk_meta *chunk;
+  struct p_thrift t;
+  int idx, rg, enc;
+
+  b->off = 0;
+  th_init(&t, b);
+
+  th_i32(&t, 1, 1);
+
+  th_list(&t, 2, TC_STRUCT, w->num_cols + 1);
+  th_struct_begin(&t);
+  th_binary(&t, 4, "schema", strlen("schema"));
+  th_i32(&t, 5, w->num_cols);
+  th_struct_end(&t);
+
+  for (idx = 0; idx < w->num_cols; idx++) {
+    col = &w->cols[idx];
+
+    th_struct_begin(&t);
+    th_i32(&t, 1, col->type);
+    th_i32(&t, 3, 0); /* REQUIRED */
+    th_binary(&t, 4, col->name, strlen(col->name));
+    if (col->conv != PM_PARQUET_CT_NONE) th_i32(&t, 6, col->conv);
+    th_struct_end(&t);
+  }
+
+  th_i64(&t, 3, w->total_rows);
+
+  th_list(&t, 4, TC_STRUCT, w->num_rgs);
+  for (rg = 0; rg < w->num_rgs; rg++) {
+    th_struct_begin(&t);
+    th_list(&t, 1, TC_STRUCT, w->num_cols);
+
+    for (idx = 0; idx < w->num_cols; idx++) {
+      col = &w->cols[idx];
+      chunk = &col->chunks[rg];
+
+      th_struct_begin(&t);
+      th_i64(&t, 2, (chunk->dict_page_off >= 0) ? chunk->dict_page_off : chunk->data_page_off);
+
+      th_struct_field(&t, 3);
+      th_i32(&t, 1, col->type);
+      th_list(&t, 2, TC_I32, chunk->num_encodings);
+      for (enc = 0; enc < chunk->num_encodings; enc++) pq_put_zigzag(b, chunk->encodings[enc]);
+      th_list(&t, 3, TC_BINARY, 1);
+      pq_put_varint(b, strlen(col->name));
+      pq_put(b, col->name, strlen(col->name));
+      th_i32(&t, 4, w->codec);
+      th_i64(&t, 5, chunk->num_values);
+      th_i64(&t, 6, chunk->uncompressed);
+      th_i64(&t, 7, chunk->compressed);
+      th_i64(&t, 9, chunk->data_page_off);
+      if (chunk->dict_page_off >= 0) th_i64(&t, 11, chunk->dict_page_off);
+
+      th_struct_field(&t, 12);
+      th_i64(&t, 3, 0);
+      th_binary(&t, 5, chunk->max_str ? chunk->max_str : chunk->max, chunk->max_len);
+      th_binary(&t, 6, chunk->min_str ? chunk->min_str : chunk->min, chunk->min_len);
+      th_struct_end(&t);
+
+      th_struct_end(&t);
+      th_struct_end(&t);
+    }
+
+    th_i64(&t, 2, w->rg_bytes[rg]);
+    th_i64(&t, 3, w->rg_rows[rg]);
+    th_struct_end(&t);
+  }
+
+  th_binary(&t, 6, PM_PARQUET_CREATED_BY, strlen(PM_PARQUET_CREATED_BY));
+
+  /* min/max statistics follow the type defined (ie. unsigned for UINT_64) order */
+  th_list(&t, 7, TC_STRUCT, w->num_cols);
+  for (idx = 0; idx < w->num_cols; idx++) {
+    th_struct_begin(&t);
+    th_struct_field(&t, 1);
+    th_struct_end(&t);
+    th_struct_end(&t);
+  }
+
+  pq_put_byte(b, 0);
+
+  idx = b->off;
+  pq_put_le32(b, idx);
+  pq_put(b, PM_PARQUET_MAGIC, PM_PARQUET_MAGIC_LEN);
+
+  return pq_write(w, b->base, b->off);
+}
+
+static void pq_free_chunks(struct p_parquet_writer *w)
+{
+  int idx, rg;
+
+  for (idx = 0; idx < w->num_cols; idx++) {
+    if (!w->cols[idx].chunks) continue;
+
+    for (rg = 0; rg < w->num_rgs; rg++) {
+      if (w->cols[idx].chunks[rg].min_str) free(w->cols[idx].chunks[rg].min_str);
+      if (w->cols[idx].chunks[rg].max_str) free(w->cols[idx].chunks[rg].max_str);
+    }
+
+    free(w->cols[idx].chunks);
+    w->cols[idx].chunks = NULL;
+  }
+
+  w->num_rgs = 0;
+}
+
+void p_parquet_writer_init(struct p_parquet_writer *w, u_int32_t rg_size, int codec)
+{
+  u_int32_t dict_max;
+
+  memset(w, 0, sizeof(struct p_parquet_writer));
+  w->rg_size = rg_size ? rg_size : PM_PARQUET_ROW_GROUP_SIZE;
+  w->codec = codec;
+
+  dict_max = MIN(w->rg_size, PM_PARQUET_DICT_MAX);
+  for (w->dict_tbl_size = 2; w->dict_tbl_size < (2 * dict_max); w->dict_tbl_size *= 2);
+
+  w->dict_idx = malloc(w->rg_size * sizeof(u_int32_t));
+  w->dict_rows = malloc(dict_max * sizeof(u_int32_t));
+  w->dict_tbl = malloc(w->dict_tbl_size * sizeof(u_int32_t));
+
+  if (!w->dict_idx || !w->dict_rows || !w->dict_tbl) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): PARQUET: malloc() failed (dictionary). Exiting ..\n", config.name, config.type);
+    exit_plugin(1);
+  }
+}
+
+int p_parquet_add_column(struct p_parquet_writer *w, char *name, int type, int conv, int hint)
+{
+  struct p_parquet_column *col;
+
+  w->cols = realloc(w->cols, (w->num_cols + 1) * sizeof(struct p_parquet_column));
+  if (!w->cols) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): PARQUET: realloc() failed (columns). Exiting ..\n", config.name, config.type);
+    exit_plugin(1);
+  }
+
+  col = &w->cols[w->num_cols];
+  memset(col, 0, sizeof(struct p_parquet_column));
+  col->name = strdup(name);
+  col->type = type;
+  col->conv = conv;
+  col->hint = hint;
+
+  if (type == PM_PARQUET_INT64) col->ival = malloc(w->rg_size * sizeof(u_int64_t));
+  else col->soff = calloc(w->rg_size + 1, sizeof(u_int32_t));
+
+  if (!col->name || (!col->ival && !col->soff)) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): PARQUET: malloc() failed (column). Exiting ..\n", config.name, config.type);
+    exit_plugin(1);
+  }
+
+  w->num_cols++;
+
+  return (w->num_cols - 1);
+}
+
+int p_parquet_writer_open(struct p_parquet_writer *w, FILE *f)
+{
+  int idx;
+
+  pq_free_chunks(w);
+
+  w->f = f;
+  w->off = 0;
+  w->rows = 0;
+  w->total_rows = 0;
+
+  for (idx = 0; idx < w->num_cols; idx++) {
+    if (w->cols[idx].type == PM_PARQUET_BYTE_ARRAY) {
+      w->cols[idx].sbuf.off = 0;
+      w->cols[idx].soff[0] = 0;
+    }
+  }
+
+  return pq_write(w, PM_PARQUET_MAGIC, PM_PARQUET_MAGIC_LEN);
+}
+
+void p_parquet_put_int64(struct p_parquet_writer *w, int idx, u_int64_t value)
+{
+  w->cols[idx].ival[w->rows] = value;
+}
+
+void p_parquet_put_string(struct p_parquet_writer *w, int idx, char *str)
+{
+  struct p_parquet_column *col = &w->cols[idx];
+
+  col->soff[w->rows] = col->sbuf.off;
+  if (str) pq_put(&col->sbuf, str, strlen(str));
+}
+
+int p_parquet_end_row(struct p_parquet_writer *w)
+{
+  int idx;
+
+  w->rows++;
+
+  for (idx = 0; idx < w->num_cols; idx++) {
+    if (w->cols[idx].type == PM_PARQUET_BYTE_ARRAY) w->cols[idx].soff[w->rows] = w->cols[idx].sbuf.off;
+  }
+
+  if (w->rows == w->rg_size) return pq_flush_row_group(w);
+
+  return SUCCESS;
+}
+
+int p_parquet_writer_close(struct p_parquet_writer *w)
+{
+  int ret;
+
+  ret = pq_flush_row_group(w);
+  if (ret == SUCCESS) ret = pq_write_footer(w);
+
+  w->f = NULL;
+
+  return ret;
+}
+
+/* drops rows and row groups not yet in a footer; the file is left to the caller */
+void p_parquet_writer_abort(struct p_parquet_writer *w)
+{
+  pq_free_chunks(w);
+  pq_reset_rows(w);
+
+  w->f = NULL;
+  w->off = 0;
+  w->total_rows = 0;
+}
+
+void p_parquet_writer_destroy(struct p_parquet_writer *w)
+{
+  int idx;
+
+  pq_free_chunks(w);
+
+  for (idx = 0; idx < w->num_cols; idx++) {
+    free(w->cols[idx].name);
+    if (w->cols[idx].ival) free(w->cols[idx].ival);
+    if (w->cols[idx].soff) free(w->cols[idx].soff);
+    if (w->cols[idx].sbuf.base) free(w->cols[idx].sbuf.base);
+  }
+
+  if (w->cols) free(w->cols);
+  if (w->rg_rows) free(w->rg_rows);
+  if (w->rg_bytes) free(w->rg_bytes);
+  if (w->page.base) free(w->page.base);
+  if (w->zpage.base) free(w->zpage.base);
+  if (w->dict.base) free(w->dict.base);
+  if (w->hdr.base) free(w->hdr.base);
+  if (w->dict_idx) free(w->dict_idx);
+  if (w->dict_rows) free(w->dict_rows);
+  if (w->dict_tbl) free(w->dict_tbl);
+
+  memset(w, 0, sizeof(struct p_parquet_writer));
+}
@@ -0,0 +1,141 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2017 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+/* defines */
+#define PM_PARQUET_MAGIC		"PAR1"
+#define PM_PARQUET_MAGIC_LEN		4
+#define PM_PARQUET_ROW_GROUP_SIZE	65536
+#define PM_PARQUET_DICT_MAX		65536
+#define PM_PARQUET_DELTA_BLOCK		128
+#define PM_PARQUET_DELTA_MINIBLOCKS	4
+
+/* physical types */
+#define PM_PARQUET_INT64		2
+#define PM_PARQUET_BYTE_ARRAY		6
+
+/* converted (logical) types */
+#define PM_PARQUET_CT_NONE		-1
+#define PM_PARQUET_CT_UTF8		0
+#define PM_PARQUET_CT_TIMESTAMP_MICROS	10
+#define PM_PARQUET_CT_UINT_64		14
+
+/* encodings */
+#define PM_PARQUET_ENC_PLAIN		0
+#define PM_PARQUET_ENC_RLE		3
+#define PM_PARQUET_ENC_DELTA_BINARY	5
+#define PM_PARQUET_ENC_RLE_DICTIONARY	8
+
+/* per-column encoding hints */
+#define PM_PARQUET_HINT_PLAIN		0
+#define PM_PARQUET_HINT_DICT		1
+#define PM_PARQUET_HINT_DELTA		2
+
+/* compression codecs */
+#define PM_PARQUET_CODEC_NONE		0
+#define PM_PARQUET_CODEC_GZIP		2
+
+/* page types */
+#define PM_PARQUET_PAGE_DATA		0
+#define PM_PARQUET_PAGE_DICTIONARY	2
+
+/* structures */
+struct p_parquet_buf {
+  u_char *base;
+  size_t len;
+  size_t off;
+};
+
+/* what is needed of a column chunk in order to write the file footer */
+struct p_parquet_chunk_meta {
+  u_int8_t encodings[4];
+  int num_encodings;
+  int64_t data_page_off;
+  int64_t dict_page_off;
+  int64_t uncompressed;
+  int64_t compressed;
+  int64_t num_values;
+  char min[8], max[8];
+  char *min_str, *max_str;
+  u_int32_t min_len, max_len;
+};
+
+/*
+   A column buffers the values of the current row group: INT64 values in
+   'ival', BYTE_ARRAY values back to back in 'sbuf' with 'soff' holding the
+   start offset of each of them. The encoding is picked per row group at
+   flush time according to the hint and to the data actually seen.
+*/
+struct p_parquet_column {
+  char *name;
+  int type;
+  int conv;
+  int hint;
+
+  u_int64_t *ival;
+  u_int32_t *soff;
+  struct p_parquet_buf sbuf;
+
+  struct p_parquet_chunk_meta *chunks;
+};
+
+struct p_parquet_writer {
+  FILE *f;
+  int64_t off;
+  int codec;
+
+  struct p_parquet_column *cols;
+  int num_cols;
+
+  u_int32_t rg_size;
+  u_int32_t rows;
+  u_int64_t total_rows;
+
+  int64_t *rg_rows;
+  int64_t *rg_bytes;
+  int num_rgs;
+
+  /* scratch space, reused across column chunks */
+  struct p_parquet_buf page;
+  struct p_parquet_buf zpage;
+  struct p_parquet_buf dict;
+  struct p_parquet_buf hdr;
+  u_int32_t *dict_idx;
+  u_int32_t *dict_rows;
+  u_int32_t *dict_tbl;
+  u_int32_t dict_tbl_size;
+};
+
+/* prototypes */
+#if (!defined __PARQUET_COMMON_C)
+#define EXT extern
+#else
+#define EXT
+#endif
+EXT void p_parquet_writer_init(struct p_parquet_writer *, u_int32_t, int);
+EXT int p_parquet_add_column(struct p_parquet_writer *, char *, int, int, int);
+EXT int p_parquet_writer_open(struct p_parquet_writer *, FILE *);
+EXT void p_parquet_put_int64(struct p_parquet_writer *, int, u_int64_t);
+EXT void p_parquet_put_string(struct p_parquet_writer *, int, char *);
+EXT int p_parquet_end_row(struct p_parquet_writer *);
+EXT int p_parquet_writer_close(struct p_parquet_writer *);
+EXT void p_parquet_writer_abort(struct p_parquet_writer *);
+EXT void p_parquet_writer_destroy(struct p_parquet_writer *);
+#undef EXT
@@ -24,6 +24,7 @@
 /* includes */
 #include "pmacct.h"
 #include "pmacct-data.h"
+#include "addr.h"
 #include "plugin_hooks.h"
 #include "sql_common.h"
 #include "pgsql_plugin.h"
@@ -197,6 +198,7 @@ void pgsql_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
         pollagain = FALSE;
         memcpy(pipebuf, rg->ptr, bufsz);
         rg->ptr += bufsz;
+        stats_shm_update_ring_rd(((struct ch_buf_hdr *) pipebuf)->seq);
       }
 #ifdef WITH_RABBITMQ
       else {
@@ -324,6 +326,464 @@ int PG_cache_dbop_copy(struct DBdesc *db, struct db_cache *cache_elem, struct in
   return FALSE;
 }
 
+static void PG_copy_bin_put16(char *ptr, u_int16_t value)
+{
+  value = htons(value);
+  memcpy(ptr, &value, 2);
+}
+
+static void PG_copy_bin_put32(char *ptr, u_int32_t value)
+{
+  value = htonl(value);
+  memcpy(ptr, &value, 4);
+}
+
+static void PG_copy_bin_put64(char *ptr, u_int64_t value)
+{
+  value = pm_htonll(value);
+  memcpy(ptr, &value, 8);
+}
+
+/* integer fields: mirror the server which would reject out of range values in text COPY */
+static int PG_copy_bin_put_int(struct PG_copy_bin_encoder *enc, u_int8_t type, int64_t value, int is_signed)
+{
+  char *ptr = enc->buf+enc->len;
+
+  switch (type) {
+  case PG_COPY_BIN_ENC_INT2:
+    if (value > 32767 || (is_signed && value < -32768) || (!is_signed && value < 0)) return ERR;
+    PG_copy_bin_put32(ptr, 2);
+    PG_copy_bin_put16(ptr+4, (u_int16_t) value);
+    enc->len += 6;
+    break;
+  case PG_COPY_BIN_ENC_INT4:
+    if (value > 2147483647LL || (is_signed && value < -2147483647LL-1) || (!is_signed && value < 0)) return ERR;
+    PG_copy_bin_put32(ptr, 4);
+    PG_copy_bin_put32(ptr+4, (u_int32_t) value);
+    enc->len += 8;
+    break;
+  case PG_COPY_BIN_ENC_INT8:
+    if (!is_signed && value < 0) return ERR;
+    PG_copy_bin_put32(ptr, 8);
+    PG_copy_bin_put64(ptr+4, (u_int64_t) value);
+    enc->len += 12;
+    break;
+  }
+
+  return SUCCESS;
+}
+
+int PG_cache_dbop_copy_binary(struct DBdesc *db, struct db_cache *cache_elem, struct insert_data *idata)
+{
+  struct PG_copy_bin_encoder *enc = PG_copy_bin_encoder_get(db);
+  struct PG_copy_bin_field *field;
+  struct sql_bind_value value;
+  char *ptr_values, *ptr_where, *ptr;
+  int idx, text_len;
+
+  /* table could not be bound to the binary encoder */
+  if (!enc->active) return PG_cache_dbop_copy(db, cache_elem, idata);
+
+  if (PG_copy_bin_reserve(db, enc, 2)) goto db_fail;
+  PG_copy_bin_put16(enc->buf+enc->len, PG_copy_bin_num_fields);
+  enc->len += 2;
+
+  for (idx = 0; idx < PG_copy_bin_num_fields; idx++) {
+    field = &PG_copy_bin_fields[idx];
+
+    if (field->source != SQL_BIND_TEXT && enc->enc[idx] < PG_COPY_BIN_ENC_TEXT) {
+      memset(&value, 0, sizeof(value));
+      (*field->get)(cache_elem, idata, field->sub, &value);
+      if (PG_copy_bin_reserve(db, enc, 4+20)) goto db_fail;
+      ptr = enc->buf+enc->len;
+
+      switch (enc->enc[idx]) {
+      case PG_COPY_BIN_ENC_INT2:
+      case PG_COPY_BIN_ENC_INT4:
+      case PG_COPY_BIN_ENC_INT8:
+        if (PG_copy_bin_put_int(enc, enc->enc[idx], (int64_t) value.u64, FALSE)) goto range;
+        break;
+      case PG_COPY_BIN_ENC_INET:
+      case PG_COPY_BIN_ENC_CIDR:
+        /* an unset address is written as 0.0.0.0, same as fake_host */
+#if defined ENABLE_IPV6
+        if (value.addr->family == AF_INET6) {
+          PG_copy_bin_put32(ptr, 20);
+          ptr[4] = PG_AF_INET6;
+          ptr[5] = 128;
+          ptr[6] = (enc->enc[idx] == PG_COPY_BIN_ENC_CIDR);
+          ptr[7] = 16;
+          memcpy(ptr+8, &value.addr->address.ipv6, 16);
+          enc->len += 24;
+          break;
+        }
+#endif
+        if (value.addr->family && value.addr->family != AF_INET) {
+          Log(LOG_ERR, "ERROR ( %s/%s ): binary COPY: unsupported address family %u.\n", config.name, config.type, value.addr->family);
+          goto fail;
+        }
+        PG_copy_bin_put32(ptr, 8);
+        ptr[4] = PG_AF_INET;
+        ptr[5] = 32;
+        ptr[6] = (enc->enc[idx] == PG_COPY_BIN_ENC_CIDR);
+        ptr[7] = 4;
+        if (value.addr->family) memcpy(ptr+8, &value.addr->address.ipv4, 4);
+        else memset(ptr+8, 0, 4);
+        enc->len += 12;
+        break;
+      case PG_COPY_BIN_ENC_MACADDR:
+        PG_copy_bin_put32(ptr, ETH_ADDR_LEN);
+        memcpy(ptr+4, value.mac, ETH_ADDR_LEN);
+        enc->len += 4+ETH_ADDR_LEN;
+        break;
+      case PG_COPY_BIN_ENC_TS:
+        PG_copy_bin_put32(ptr, 8);
+        PG_copy_bin_put64(ptr+4, (u_int64_t) (((int64_t) PG_copy_bin_walltime(value.t)-PG_EPOCH_OFFSET)*1000000));
+        enc->len += 12;
+        break;
+      case PG_COPY_BIN_ENC_TSTZ:
+        PG_copy_bin_put32(ptr, 8);
+        PG_copy_bin_put64(ptr+4, (u_int64_t) (((int64_t) value.t-PG_EPOCH_OFFSET)*1000000));
+        enc->len += 12;
+        break;
+      }
+    }
+    else {
+      /* let the SQL handler render the value, ie. as in text COPY */
+      strlcpy(values[field->num].string, field->fmt, sizeof(values[field->num].string));
+      values_clause[0] = '\0';
+      where_clause[0] = '\0';
+      ptr_values = values_clause;
+      ptr_where = where_clause;
+      (*where[field->num].handler)(cache_elem, idata, field->num, &ptr_values, &ptr_where);
+      text_len = ptr_values-values_clause;
+
+      if (enc->enc[idx] == PG_COPY_BIN_ENC_TEXT) {
+        if (PG_copy_bin_reserve(db, enc, 4+text_len)) goto db_fail;
+        PG_copy_bin_put32(enc->buf+enc->len, text_len);
+        memcpy(enc->buf+enc->len+4, values_clause, text_len);
+        enc->len += 4+text_len;
+      }
+      else {
+        int64_t ival;
+
+        errno = 0;
+        ival = strtoll(values_clause, &ptr, 10);
+        if (errno || ptr == values_clause || *ptr != '\0') goto range;
+        if (PG_copy_bin_reserve(db, enc, 4+8)) goto db_fail;
+        if (PG_copy_bin_put_int(enc, enc->enc[idx]-(PG_COPY_BIN_ENC_TEXT_INT2-PG_COPY_BIN_ENC_INT2), ival, TRUE)) goto range;
+      }
+    }
+  }
+
+  if (enc->len >= PG_COPY_BIN_BUFLEN && PG_copy_bin_send(db, enc)) goto db_fail;
+
+  idata->iqn++;
+  idata->een++;
+
+  return FALSE;
+
+  range:
+  Log(LOG_ERR, "ERROR ( %s/%s ): binary COPY: value out of range for column #%u.\n", config.name, config.type, idx+1);
+  goto fail;
+
+  db_fail:
+  db->errmsg = PQerrorMessage(db->desc);
+  if (db->errmsg) Log(LOG_ERR, "ERROR ( %s/%s ): %s\n", config.name, config.type, db->errmsg);
+
+  fail:
+  enc->active = FALSE;
+  sql_db_fail(db);
+
+  return TRUE;
+}
+
+/*
+   Binary COPY row layout is built once, at startup, out of the primitives list:
+   each primitive contributes as many fields as its value format has conversions
+   and counters come last; natively encodable primitives get a getter, the rest
+   fall back to their SQL handler. Wire encodings are then picked per backend, as
+   each table is met, by PG_copy_bin_bind().
+*/
+void PG_copy_bin_compile(int num_primitives, int have_flows)
+{
+  struct PG_copy_bin_field *field;
+  struct sql_bind_native *native;
+  char delim_buf[SRVBUFLEN], *fmt, *ptr;
+  int num, sub, nfields, idx;
+
+  PG_copy_bin_num_fields = 0;
+  strlcpy(delim_buf, (config.sql_delimiter ? config.sql_delimiter : ","), SRVBUFLEN);
+
+  for (num = 0; num < num_primitives; num++) {
+    fmt = copy_values[num].string;
+    if (num && !strncmp(fmt, delim_buf, strlen(delim_buf))) fmt += strlen(delim_buf);
+
+    for (nfields = 0, ptr = fmt; (ptr = strchr(ptr, '%')); ptr++) {
+      if (*(ptr+1) == '%') ptr++;
+      else nfields++;
+    }
+    if (!nfields) nfields = 1;
+
+    for (sub = 0; sub < nfields && PG_copy_bin_num_fields < PG_COPY_BIN_MAX_FIELDS-3; sub++) {
+      field = &PG_copy_bin_fields[PG_copy_bin_num_fields];
+      memset(field, 0, sizeof(struct PG_copy_bin_field));
+      field->num = num;
+      field->sub = sub;
+      field->nfields = nfields;
+      field->source = SQL_BIND_TEXT;
+      strlcpy(field->fmt, fmt, sizeof(field->fmt));
+
+      if ((native = sql_bind_lookup(where[num].handler))) {
+        field->source = native->source;
+        field->get = native->get;
+      }
+
+      PG_copy_bin_num_fields++;
+    }
+  }
+
+  for (idx = 0; idx < (have_flows ? 3 : 2); idx++) {
+    field = &PG_copy_bin_fields[PG_copy_bin_num_fields];
+    memset(field, 0, sizeof(struct PG_copy_bin_field));
+    field->num = -1;
+    field->nfields = 1;
+    field->source = SQL_BIND_INT;
+    if (idx == 0) field->get = sql_bind_get_packets;
+    else if (idx == 1) field->get = sql_bind_get_bytes;
+    else field->get = sql_bind_get_flows;
+
+    PG_copy_bin_num_fields++;
+  }
+}
+
+/* picks a wire encoding for each field out of the column types of the table */
+int PG_copy_bin_bind(struct DBdesc *db, struct PG_copy_bin_encoder *enc)
+{
+  PGresult *PGret;
+  struct PG_copy_bin_field *field;
+  char query[LONGSRVBUFLEN], table[SRVBUFLEN], *start, *end;
+  const char *int_datetimes;
+  Oid type;
+  int idx;
+
+  /* table and columns are taken from the COPY statement, ie. after dynamic names are resolved */
+  start = copy_clause+strlen("COPY ");
+  end = strstr(start, " (");
+  if (!end || (end-start) >= SRVBUFLEN) return ERR;
+  memcpy(table, start, end-start);
+  table[end-start] = '\0';
+
+  if (enc->bound && !strcmp(enc->table, table)) return (enc->usable ? SUCCESS : ERR);
+
+  start = end+2;
+  end = strstr(start, ") FROM STDIN");
+  if (!end) return ERR;
+  snprintf(query, sizeof(query), "SELECT %.*s FROM %s LIMIT 0", (int)(end-start), start, table);
+
+  strlcpy(enc->table, table, SRVBUFLEN);
+  enc->bound = TRUE;
+  enc->usable = FALSE;
+  memset(enc->enc, 0, sizeof(enc->enc));
+
+  PGret = PQexec(db->desc, query);
+  if (PQresultStatus(PGret) != PGRES_TUPLES_OK) {
+    Log(LOG_WARNING, "WARN ( %s/%s ): binary COPY: unable to read '%s' columns: %s", config.name, config.type, table, PQresultErrorMessage(PGret));
+    PQclear(PGret);
+    return ERR;
+  }
+
+  if (PQnfields(PGret) != PG_copy_bin_num_fields) {
+    Log(LOG_WARNING, "WARN ( %s/%s ): binary COPY: '%s' columns mismatch. Using text COPY.\n", config.name, config.type, table);
+    PQclear(PGret);
+    return ERR;
+  }
+
+  int_datetimes = PQparameterStatus(db->desc, "integer_datetimes");
+
+  for (idx = 0; idx < PG_copy_bin_num_fields; idx++) {
+    field = &PG_copy_bin_fields[idx];
+    type = PQftype(PGret, idx);
+
+    switch (type) {
+    case PG_INT2OID:
+    case PG_INT4OID:
+    case PG_INT8OID:
+      if (field->source == SQL_BIND_INT) enc->enc[idx] = PG_COPY_BIN_ENC_INT2;
+      else if (field->nfields == 1) enc->enc[idx] = PG_COPY_BIN_ENC_TEXT_INT2;
+      if (enc->enc[idx]) enc->enc[idx] += (type == PG_INT2OID ? 0 : (type == PG_INT4OID ? 1 : 2));
+      break;
+    case PG_INETOID:
+    case PG_CIDROID:
+      if (field->source == SQL_BIND_ADDR)
+	enc->enc[idx] = (type == PG_INETOID ? PG_COPY_BIN_ENC_INET : PG_COPY_BIN_ENC_CIDR);
+      break;
+    case PG_MACADDROID:
+      if (field->source == SQL_BIND_MAC) enc->enc[idx] = PG_COPY_BIN_ENC_MACADDR;
+      break;
+    case PG_TIMESTAMPOID:
+    case PG_TIMESTAMPTZOID:
+      if (field->source == SQL_BIND_TIME && int_datetimes && !strcmp(int_datetimes, "on"))
+	enc->enc[idx] = (type == PG_TIMESTAMPOID ? PG_COPY_BIN_ENC_TS : PG_COPY_BIN_ENC_TSTZ);
+      break;
+    case PG_TEXTOID:
+    case PG_VARCHAROID:
+    case PG_BPCHAROID:
+      if (field->nfields == 1 && field->num >= 0) enc->enc[idx] = PG_COPY_BIN_ENC_TEXT;
+      break;
+    }
+
+    if (!enc->enc[idx]) {
+      Log(LOG_WARNING, "WARN ( %s/%s ): binary COPY: can't encode column '%s' (type %u) of '%s'. Using text COPY.\n",
+		config.name, config.type, PQfname(PGret, idx), type, table);
+      PQclear(PGret);
+      return ERR;
+    }
+  }
+
+  PQclear(PGret);
+  enc->usable = TRUE;
+
+  return SUCCESS;
+}
+
+/* writes the header and switches to non-blocking sends, once COPY is in progress */
+void PG_copy_bin_start(struct DBdesc *db)
+{
+  struct PG_copy_bin_encoder *enc = PG_copy_bin_encoder_get(db);
+  static const char header[] = "PGCOPY\n\377\r\n";
+
+  if (!enc->buf) {
+    enc->size = PG_COPY_BIN_BUFLEN+LONGLONGSRVBUFLEN;
+    enc->buf = malloc(enc->size);
+    if (!enc->buf) {
+      Log(LOG_ERR, "ERROR ( %s/%s ): malloc() failed (PG_copy_bin_start). Exiting ..\n", config.name, config.type);
+      exit_plugin(1);
+    }
+  }
+
+  /* signature, flags field, header extension length */
+  memcpy(enc->buf, header, 11);
+  PG_copy_bin_put32(enc->buf+11, 0);
+  PG_copy_bin_put32(enc->buf+15, 0);
+  enc->len = 19;
+  enc->pending = FALSE;
+  enc->active = TRUE;
+
+  /* let the encoding of the next chunk overlap with the sending of the previous one */
+  PQsetnonblocking(db->desc, TRUE);
+}
+
+/* sends the trailer and waits for all data to be handed to the server */
+int PG_copy_bin_end(struct DBdesc *db)
+{
+  struct PG_copy_bin_encoder *enc = PG_copy_bin_encoder_get(db);
+  int ret = SUCCESS;
+
+  if (!enc->active) return SUCCESS;
+  enc->active = FALSE;
+
+  if (PG_copy_bin_reserve(db, enc, 2)) ret = ERR;
+  else {
+    PG_copy_bin_put16(enc->buf+enc->len, 0xffff);
+    enc->len += 2;
+
+    if (PG_copy_bin_send(db, enc) || PG_copy_bin_drain(db, enc)) ret = ERR;
+  }
+
+  if (ret == ERR) {
+    db->errmsg = PQerrorMessage(db->desc);
+    if (db->errmsg) Log(LOG_ERR, "ERROR ( %s/%s ): %s\n", config.name, config.type, db->errmsg);
+  }
+
+  PQsetnonblocking(db->desc, FALSE);
+
+  return ret;
+}
+
+static struct PG_copy_bin_encoder *PG_copy_bin_encoder_get(struct DBdesc *db)
+{
+  if (db->type == BE_TYPE_BACKUP) return &PG_copy_bin_b;
+  else return &PG_copy_bin_p;
+}
+
+/* queues the buffer to libpq after the previous chunk has been fully sent */
+static int PG_copy_bin_send(struct DBdesc *db, struct PG_copy_bin_encoder *enc)
+{
+  int ret;
+
+  if (!enc->len) return SUCCESS;
+  if (enc->pending && PG_copy_bin_drain(db, enc)) return ERR;
+
+  ret = PQputCopyData(db->desc, enc->buf, enc->len);
+  if (ret != 1) return ERR;
+
+  Log(LOG_DEBUG, "DEBUG ( %s/%s ): binary COPY: %u bytes queued\n", config.name, config.type, (u_int32_t) enc->len);
+  enc->len = 0;
+
+  ret = PQflush(db->desc);
+  if (ret < 0) return ERR;
+  enc->pending = ret;
+
+  return SUCCESS;
+}
+
+static int PG_copy_bin_drain(struct DBdesc *db, struct PG_copy_bin_encoder *enc)
+{
+  struct pollfd pfd;
+  int ret;
+
+  while ((ret = PQflush(db->desc)) == 1) {
+    pfd.fd = PQsocket(db->desc);
+    pfd.events = POLLOUT|POLLIN;
+    pfd.revents = 0;
+
+    if (poll(&pfd, 1, -1) < 0 && errno != EINTR) return ERR;
+    if ((pfd.revents & POLLIN) && !PQconsumeInput(db->desc)) return ERR;
+  }
+  enc->pending = FALSE;
+
+  return (ret < 0 ? ERR : SUCCESS);
+}
+
+static int PG_copy_bin_reserve(struct DBdesc *db, struct PG_copy_bin_encoder *enc, size_t len)
+{
+  if (enc->len+len <= enc->size) return SUCCESS;
+  if (len > enc->size) return ERR;
+
+  /* COPY data messages need not be aligned to rows */
+  return PG_copy_bin_send(db, enc);
+}
+
+/* wall clock seconds, as rendered by localtime(), for timestamp without time zone */
+static time_t PG_copy_bin_walltime(time_t t)
+{
+  static time_t last_slot = -1, offset = 0;
+  time_t slot = t-(t%900), days;
+  struct tm *tme;
+  int y, m, era, yoe, doy, doe;
+
+  /* time zone transitions happen at quarter of an hour boundaries */
+  if (slot != last_slot) {
+    tme = localtime(&t);
+    if (!tme) return t;
+
+    y = tme->tm_year+1900;
+    m = tme->tm_mon+1;
+    y -= (m <= 2);
+    era = (y >= 0 ? y : y-399)/400;
+    yoe = y-era*400;
+    doy = (153*(m > 2 ? m-3 : m+9)+2)/5+tme->tm_mday-1;
+    doe = yoe*365+yoe/4-yoe/100+doy;
+    days = (time_t) era*146097+doe-719468;
+
+    offset = (days*86400+tme->tm_hour*3600+tme->tm_min*60+tme->tm_sec)-t;
+    last_slot = slot;
+  }
+
+  return t+offset;
+}
+
 int PG_cache_dbop(struct DBdesc *db, struct db_cache *cache_elem, struct insert_data *idata)
 {
   PGresult *ret;
@@ -555,7 +1015,7 @@ void PG_cache_purge(struct db_cache *queue[], int index, struct insert_data *ida
   /* Finalizing DB transaction */
   if (!p.fail) {
     if (config.sql_use_copy) {
-      if (PQputCopyEnd(p.desc, NULL) < 0) Log(LOG_ERR, "ERROR ( %s/%s ): COPY failed!\n\n", config.name, config.type); 
+      if (PG_copy_bin_end(&p) || PQputCopyEnd(p.desc, NULL) < 0) Log(LOG_ERR, "ERROR ( %s/%s ): COPY failed!\n\n", config.name, config.type); 
     }
 
     ret = PQexec(p.desc, "COMMIT");
@@ -582,7 +1042,7 @@ void PG_cache_purge(struct db_cache *queue[], int index, struct insert_data *ida
 
   if (b.connected) {
     if (config.sql_use_copy) {
-      if (PQputCopyEnd(b.desc, NULL) < 0) Log(LOG_ERR, "ERROR ( %s/%s ): COPY failed!\n\n", config.name, config.type);
+      if (PG_copy_bin_end(&b) || PQputCopyEnd(b.desc, NULL) < 0) Log(LOG_ERR, "ERROR ( %s/%s ): COPY failed!\n\n", config.name, config.type);
     }
     ret = PQexec(b.desc, "COMMIT");
     if (PQresultStatus(ret) != PGRES_COMMAND_OK) sql_db_fail(&b);
@@ -773,6 +1233,8 @@ int PG_compose_static_queries()
     }
   }
 
+  if (config.sql_use_copy == SQL_COPY_BINARY) PG_copy_bin_compile(primitives, have_flows);
+
   return primitives;
 }
 
@@ -812,13 +1274,30 @@ void PG_Lock(struct DBdesc *db)
     
     /* If using COPY, let's initialize it */
     if (config.sql_use_copy) {
-      PGret = PQexec(db->desc, copy_clause);
+      char bin_copy_clause[LONGSRVBUFLEN], *copy_stmt = copy_clause, *ptr;
+      int binary = FALSE;
+
+      if (config.sql_use_copy == SQL_COPY_BINARY) {
+	PG_copy_bin_encoder_get(db)->active = FALSE;
+	ptr = strstr(copy_clause, ") FROM STDIN");
+
+	if (ptr && !PG_copy_bin_bind(db, PG_copy_bin_encoder_get(db))) {
+	  snprintf(bin_copy_clause, sizeof(bin_copy_clause), "%.*s) FROM STDIN BINARY", (int)(ptr-copy_clause), copy_clause);
+	  copy_stmt = bin_copy_clause;
+	  binary = TRUE;
+	}
+      }
+
+      PGret = PQexec(db->desc, copy_stmt);
       if (PQresultStatus(PGret) != PGRES_COPY_IN) {
 	db->errmsg = PQresultErrorMessage(PGret);
 	sql_db_errmsg(db);
 	sql_db_fail(db);
       }
-      else Log(LOG_DEBUG, "DEBUG ( %s/%s ): %s\n", config.name, config.type, copy_clause); 
+      else {
+	Log(LOG_DEBUG, "DEBUG ( %s/%s ): %s\n", config.name, config.type, copy_stmt); 
+	if (binary) PG_copy_bin_start(db);
+      }
       PQclear(PGret);
     }
   }
@@ -887,6 +1366,7 @@ void PG_set_callbacks(struct sqlfunc_cb_registry *cbr)
   cbr->lock = PG_Lock;
   /* cbr->unlock */ 
   if (!config.sql_use_copy) cbr->op = PG_cache_dbop;
+  else if (config.sql_use_copy == SQL_COPY_BINARY) cbr->op = PG_cache_dbop_copy_binary;
   else cbr->op = PG_cache_dbop_copy;
   cbr->create_table = PG_create_dyn_table;
   cbr->purge = PG_cache_purge;
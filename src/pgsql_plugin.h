@@ -26,6 +26,67 @@
 #define REPROCESS_SPECIFIC	1
 #define REPROCESS_BULK		2
 
+/* binary COPY */
+#define PG_COPY_BIN_BUFLEN	(256*1024)
+#define PG_COPY_BIN_MAX_FIELDS	(N_PRIMITIVES+8)
+
+#define PG_COPY_BIN_ENC_INT2	1	/* wire encodings */
+#define PG_COPY_BIN_ENC_INT4	2
+#define PG_COPY_BIN_ENC_INT8	3
+#define PG_COPY_BIN_ENC_INET	4
+#define PG_COPY_BIN_ENC_CIDR	5
+#define PG_COPY_BIN_ENC_MACADDR	6
+#define PG_COPY_BIN_ENC_TS	7
+#define PG_COPY_BIN_ENC_TSTZ	8
+#define PG_COPY_BIN_ENC_TEXT	9
+#define PG_COPY_BIN_ENC_TEXT_INT2	10
+#define PG_COPY_BIN_ENC_TEXT_INT4	11
+#define PG_COPY_BIN_ENC_TEXT_INT8	12
+
+/* type OIDs, from PostgreSQL's catalog/pg_type.h */
+#define PG_INT8OID		20
+#define PG_INT2OID		21
+#define PG_INT4OID		23
+#define PG_TEXTOID		25
+#define PG_CIDROID		650
+#define PG_MACADDROID		829
+#define PG_INETOID		869
+#define PG_BPCHAROID		1042
+#define PG_VARCHAROID		1043
+#define PG_TIMESTAMPOID		1114
+#define PG_TIMESTAMPTZOID	1184
+
+/* address families as in PostgreSQL's utils/inet.h */
+#define PG_AF_INET		2
+#define PG_AF_INET6		3
+
+/* seconds between 1970-01-01 and 2000-01-01, the PostgreSQL epoch */
+#define PG_EPOCH_OFFSET		946684800
+
+/* structures */
+/* built once out of the primitives list */
+struct PG_copy_bin_field {
+  int num;			/* primitive, -1 for counters */
+  int sub;			/* field within the primitive */
+  int nfields;			/* fields of the primitive */
+  u_int8_t source;
+  sql_bind_getter get;
+  char fmt[SRVBUFLEN];		/* for SQL_BIND_TEXT */
+};
+
+/* bound to the columns of a table, one per backend */
+struct PG_copy_bin_encoder {
+  char table[SRVBUFLEN];
+  int bound;
+  int usable;
+  int active;
+  int pending;
+  u_int8_t enc[PG_COPY_BIN_MAX_FIELDS];
+  char *buf;
+  size_t len;
+  size_t size;
+};
+
 /* prototypes */
 void pgsql_plugin(int, struct configuration *, void *);
 int PG_cache_dbop(struct DBdesc *, struct db_cache *, struct insert_data *);
@@ -42,6 +103,16 @@ static int PG_affected_rows(PGresult *);
 void PG_create_backend(struct DBdesc *);
 void PG_set_callbacks(struct sqlfunc_cb_registry *);
 void PG_init_default_values(struct insert_data *);
+int PG_cache_dbop_copy_binary(struct DBdesc *, struct db_cache *, struct insert_data *);
+void PG_copy_bin_compile(int, int);
+int PG_copy_bin_bind(struct DBdesc *, struct PG_copy_bin_encoder *);
+void PG_copy_bin_start(struct DBdesc *);
+int PG_copy_bin_end(struct DBdesc *);
+static struct PG_copy_bin_encoder *PG_copy_bin_encoder_get(struct DBdesc *);
+static int PG_copy_bin_send(struct DBdesc *, struct PG_copy_bin_encoder *);
+static int PG_copy_bin_drain(struct DBdesc *, struct PG_copy_bin_encoder *);
+static int PG_copy_bin_reserve(struct DBdesc *, struct PG_copy_bin_encoder *, size_t);
+static time_t PG_copy_bin_walltime(time_t);
 
 /* global vars */
 int typed = TRUE;
@@ -71,3 +142,6 @@ static char pgsql_table_as_v4[] = "acct_as_v4";
 static char pgsql_table_as_v5[] = "acct_as_v5";
 static char typed_str[] = "typed"; 
 static char unified_str[] = "unified"; 
+static struct PG_copy_bin_field PG_copy_bin_fields[PG_COPY_BIN_MAX_FIELDS];
+static int PG_copy_bin_num_fields;
+static struct PG_copy_bin_encoder PG_copy_bin_p, PG_copy_bin_b;
@@ -35,14 +35,22 @@
 #include "bgp/bgp.h"
 #include "isis/prefix.h"
 #include "isis/table.h"
+#include "geoipv2_lpm.h"
 
 /* functions */
 void evaluate_packet_handlers()
 {
   int primitives, index = 0;
+  int counters_idx, counters_num, sampling_idx;
+
+#if defined (WITH_GEOIPV2)
+  pm_geoipv2_init();
+#endif
 
   while (channels_list[index].aggregation) { 
     primitives = 0;
+    counters_idx = counters_num = 0;
+    sampling_idx = -1;
     memset(&channels_list[index].phandler, 0, N_PRIMITIVES);
 
 #if defined (HAVE_L2)
@@ -565,8 +573,6 @@ void evaluate_packet_handlers()
 #endif
 
 #if defined (WITH_GEOIPV2)
-    pm_geoipv2_init();
-
     if (channels_list[index].aggregation_2 & (COUNT_SRC_HOST_COUNTRY|COUNT_SRC_HOST_POCODE) /* other GeoIP primitives here */) {
       channels_list[index].phandler[primitives] = src_host_geoipv2_lookup_handler;
       primitives++;
@@ -696,6 +702,7 @@ void evaluate_packet_handlers()
     }
 
     if (channels_list[index].aggregation & COUNT_COUNTERS) {
+      counters_idx = primitives;
       if (config.acct_type == ACCT_PM) {
 	channels_list[index].phandler[primitives] = counters_handler;
 	if (config.sfacctd_renormalize && config.ext_sampling_rate) {
@@ -736,6 +743,7 @@ void evaluate_packet_handlers()
 	}
       }
       primitives++;
+      counters_num = primitives - counters_idx;
     }
 
     if (channels_list[index].plugin->type.id == PLUGIN_ID_NFPROBE) {
@@ -810,13 +818,20 @@ void evaluate_packet_handlers()
     /* sfprobe plugin: struct pkt_payload handling */
     if (channels_list[index].aggregation & COUNT_PAYLOAD) {
       if (channels_list[index].plugin->type.id == PLUGIN_ID_SFPROBE) {
-        if (config.acct_type == ACCT_PM) channels_list[index].phandler[primitives] = sfprobe_payload_handler;
+        if (config.acct_type == ACCT_PM) {
+	  channels_list[index].phandler[primitives] = sfprobe_payload_handler;
+
+	  /* fills in pkt_len and pkt_num, which sfprobe_sampling_handler relies on */
+	  counters_idx = primitives;
+	  counters_num = 1;
+	}
         else primitives--; /* This case is filtered out at startup: getting out silently */
       }
       primitives++;
     }
 
     if (channels_list[index].s.rate) {
+      sampling_idx = primitives;
       if (channels_list[index].plugin->type.id == PLUGIN_ID_SFPROBE)
         channels_list[index].phandler[primitives] = sfprobe_sampling_handler;
       else channels_list[index].phandler[primitives] = sampling_handler;
@@ -833,6 +848,30 @@ void evaluate_packet_handlers()
       primitives++;
     }
 
+    /* sampling is decided first: the handlers filling in the counters it is
+       based on and the sampling handler are moved ahead of all others, so that
+       exec_plugins() can drop records not sampled before any enrichment takes
+       place. Lacking such handlers (ie. tee plugin) the order is kept and only
+       the handlers following the sampling one are skipped */
+    if (sampling_idx >= 0 && !counters_num)
+      channels_list[index].phandler_sampling = (sampling_idx + 1);
+    else if (sampling_idx >= 0) {
+      pkt_handler sorted[N_PRIMITIVES];
+      int idx, num = 0;
+
+      for (idx = counters_idx; idx < (counters_idx + counters_num); idx++)
+	sorted[num++] = channels_list[index].phandler[idx];
+      sorted[num++] = channels_list[index].phandler[sampling_idx];
+      channels_list[index].phandler_sampling = num;
+
+      for (idx = 0; idx < primitives; idx++) {
+	if ((idx >= counters_idx && idx < (counters_idx + counters_num)) || idx == sampling_idx) continue;
+	sorted[num++] = channels_list[index].phandler[idx];
+      }
+
+      memcpy(channels_list[index].phandler, sorted, (num * sizeof(pkt_handler)));
+    }
+
     index++;
   }
 
@@ -984,29 +1023,29 @@ void bgp_peer_dst_ip_handler(struct channels_list_entry *chptr, struct packet_pt
 void igp_src_nmask_handler(struct channels_list_entry *chptr, struct packet_ptrs *pptrs, char **data)
 {
   struct pkt_data *pdata = (struct pkt_data *) *data;
-  struct route_node *ret = (struct route_node *) pptrs->igp_src;
+  struct isis_prefix *ret = (struct isis_prefix *) pptrs->igp_src;
 
   /* check network-related primitives against fallback scenarios */
   if (!evaluate_lm_method(pptrs, FALSE, chptr->plugin->cfg.nfacctd_net, NF_NET_IGP)) return;
 
-  if (ret) pdata->primitives.src_nmask = ret->p.prefixlen;
+  if (ret) pdata->primitives.src_nmask = ret->prefixlen;
 }
 
 void igp_dst_nmask_handler(struct channels_list_entry *chptr, struct packet_ptrs *pptrs, char **data)
 {
   struct pkt_data *pdata = (struct pkt_data *) *data;
-  struct route_node *ret = (struct route_node *) pptrs->igp_dst;
+  struct isis_prefix *ret = (struct isis_prefix *) pptrs->igp_dst;
 
   /* check network-related primitives against fallback scenarios */
   if (!evaluate_lm_method(pptrs, TRUE, chptr->plugin->cfg.nfacctd_net, NF_NET_IGP)) return;
 
-  if (ret) pdata->primitives.dst_nmask = ret->p.prefixlen;
+  if (ret) pdata->primitives.dst_nmask = ret->prefixlen;
 }
 
 void igp_peer_dst_ip_handler(struct channels_list_entry *chptr, struct packet_ptrs *pptrs, char **data)
 {
   struct pkt_data *pdata = (struct pkt_data *) *data;
-  struct route_node *ret = (struct route_node *) pptrs->igp_dst;
+  struct isis_prefix *ret = (struct isis_prefix *) pptrs->igp_dst;
   struct pkt_bgp_primitives *pbgp = (struct pkt_bgp_primitives *) ((*data) + chptr->extras.off_pkt_bgp_primitives);
 
   /* check network-related primitives against fallback scenarios */
@@ -1014,7 +1053,7 @@ void igp_peer_dst_ip_handler(struct channels_list_entry *chptr, struct packet_pt
 
   if (ret) {
     pbgp->peer_dst_ip.family = AF_INET;
-    memcpy(&pbgp->peer_dst_ip.address.ipv4, &ret->p.adv_router, 4);
+    memcpy(&pbgp->peer_dst_ip.address.ipv4, &ret->adv_router, 4);
   }
 }
 
@@ -3914,6 +3953,7 @@ void bgp_ext_handler(struct channels_list_entry *chptr, struct packet_ptrs *pptr
   struct bgp_node *dst_ret = (struct bgp_node *) pptrs->bgp_dst;
   struct bgp_peer *peer = (struct bgp_peer *) pptrs->bgp_peer;
   struct bgp_info *info = NULL;
+  struct bgp_attr_memo *memo;
 
   /* variables for vlen primitives */
   char empty_str = '\0', *ptr = &empty_str; 
@@ -3922,104 +3962,67 @@ void bgp_ext_handler(struct channels_list_entry *chptr, struct packet_ptrs *pptr
   if (src_ret && evaluate_lm_method(pptrs, FALSE, chptr->plugin->cfg.nfacctd_as, NF_AS_BGP)) {
     info = (struct bgp_info *) pptrs->bgp_src_info;
     if (info && info->attr) {
+      memo = bgp_attr_memo_get(info->attr);
+
       if (config.nfacctd_as & NF_AS_BGP) {
 	if (chptr->aggregation & COUNT_SRC_AS && info->attr->aspath) {
 	  pdata->primitives.src_as = evaluate_last_asn(info->attr->aspath);
-
-	  if (!pdata->primitives.src_as && config.nfacctd_bgp_stdcomm_pattern_to_asn) {
-	    char tmp_stdcomms[MAX_BGP_STD_COMMS];
-
-	    if (info->attr->community && info->attr->community->str) {
-	      evaluate_comm_patterns(tmp_stdcomms, info->attr->community->str, std_comm_patterns_to_asn, MAX_BGP_STD_COMMS);
-	      copy_stdcomm_to_asn(tmp_stdcomms, &pdata->primitives.src_as, TRUE);
-	    }
-	  }
+	  if (!pdata->primitives.src_as) pdata->primitives.src_as = memo->comm_origin_asn;
 	}
       }
       if (chptr->aggregation & COUNT_SRC_AS_PATH && info->attr->aspath && info->attr->aspath->str) {
         if (chptr->plugin->type.id != PLUGIN_ID_MEMORY) {
-          len = strlen(info->attr->aspath->str);
-
-          if (len && (config.nfacctd_bgp_src_as_path_type & BGP_SRC_PRIMITIVES_BGP)) {
-            len++;
-
-            if (config.nfacctd_bgp_aspath_radius) {
-              ptr = strndup(info->attr->aspath->str, len);
-
-              if (ptr) {
-                evaluate_bgp_aspath_radius(ptr, len, config.nfacctd_bgp_aspath_radius);
-                len = strlen(ptr);
-                len++;
-              }
-              else len = 0;
-            }
-            else ptr = info->attr->aspath->str;
+          if (memo->as_path_len && (config.nfacctd_bgp_src_as_path_type & BGP_SRC_PRIMITIVES_BGP)) {
+            ptr = memo->as_path;
+            len = memo->as_path_len;
+          }
+          else {
+            ptr = &empty_str;
+            len = 0;
           }
-          else ptr = &empty_str;
 
           if (check_pipe_buffer_space(chptr, pvlen, PmLabelTSz + len)) {
             vlen_prims_init(pvlen, 0);
             return;
           }
           else vlen_prims_insert(pvlen, COUNT_INT_SRC_AS_PATH, len, ptr, PM_MSG_STR_COPY);
-
-          if (config.nfacctd_bgp_aspath_radius && ptr && len) free(ptr);
         }
         /* fallback to legacy fixed length behaviour */
         else {
 	  if (config.nfacctd_bgp_src_as_path_type & BGP_SRC_PRIMITIVES_BGP) { 
-            strlcpy(plbgp->src_as_path, info->attr->aspath->str, MAX_BGP_ASPATH);
-            if (strlen(info->attr->aspath->str) >= MAX_BGP_ASPATH) {
+            strlcpy(plbgp->src_as_path, memo->as_path, MAX_BGP_ASPATH);
+            if (memo->as_path_len > MAX_BGP_ASPATH) {
               plbgp->src_as_path[MAX_BGP_ASPATH-2] = '+';
               plbgp->src_as_path[MAX_BGP_ASPATH-1] = '\0';
             }
-            if (config.nfacctd_bgp_aspath_radius)
-              evaluate_bgp_aspath_radius(plbgp->src_as_path, MAX_BGP_ASPATH, config.nfacctd_bgp_aspath_radius);
 	  }
 	  else plbgp->src_as_path[0] = '\0';
         }
       }
       if (chptr->aggregation & COUNT_SRC_STD_COMM && info->attr->community && info->attr->community->str) {
         if (chptr->plugin->type.id != PLUGIN_ID_MEMORY) {
-          len = strlen(info->attr->community->str);
-
-          if (len && (config.nfacctd_bgp_src_std_comm_type & BGP_SRC_PRIMITIVES_BGP)) {
-            len++;
-
-            if (config.nfacctd_bgp_stdcomm_pattern) {
-              ptr = malloc(len);
-
-              if (ptr) {
-                evaluate_comm_patterns(ptr, info->attr->community->str, std_comm_patterns, len);
-                len = strlen(ptr);
-                len++;
-              }
-              else len = 0;
-            }
-            else ptr = info->attr->community->str;
+          if (memo->std_comms_len && (config.nfacctd_bgp_src_std_comm_type & BGP_SRC_PRIMITIVES_BGP)) {
+            ptr = memo->std_comms;
+            len = memo->std_comms_len;
+          }
+          else {
+            ptr = &empty_str;
+            len = 0;
           }
-          else ptr = &empty_str;
 
           if (check_pipe_buffer_space(chptr, pvlen, PmLabelTSz + len)) {
             vlen_prims_init(pvlen, 0);
             return;
           }
-          else {
-            vlen_prims_insert(pvlen, COUNT_INT_SRC_STD_COMM, len, ptr, PM_MSG_STR_COPY);
-            if (config.nfacctd_bgp_stdcomm_pattern && ptr && len) free(ptr);
-          }
+          else vlen_prims_insert(pvlen, COUNT_INT_SRC_STD_COMM, len, ptr, PM_MSG_STR_COPY);
         }
         /* fallback to legacy fixed length behaviour */
         else {
 	  if (config.nfacctd_bgp_src_std_comm_type & BGP_SRC_PRIMITIVES_BGP) {
-            if (config.nfacctd_bgp_stdcomm_pattern)
-              evaluate_comm_patterns(plbgp->src_std_comms, info->attr->community->str, std_comm_patterns, MAX_BGP_STD_COMMS);
-            else {
-              strlcpy(plbgp->src_std_comms, info->attr->community->str, MAX_BGP_STD_COMMS);
-              if (strlen(info->attr->community->str) >= MAX_BGP_STD_COMMS) {
-                plbgp->src_std_comms[MAX_BGP_STD_COMMS-2] = '+';
-                plbgp->src_std_comms[MAX_BGP_STD_COMMS-1] = '\0';
-	      }
+            strlcpy(plbgp->src_std_comms, memo->std_comms, MAX_BGP_STD_COMMS);
+            if (memo->std_comms_len > MAX_BGP_STD_COMMS) {
+              plbgp->src_std_comms[MAX_BGP_STD_COMMS-2] = '+';
+              plbgp->src_std_comms[MAX_BGP_STD_COMMS-1] = '\0';
             }
           }
 	  else plbgp->src_std_comms[0] = '\0';
@@ -4027,45 +4030,28 @@ void bgp_ext_handler(struct channels_list_entry *chptr, struct packet_ptrs *pptr
       }
       if (chptr->aggregation & COUNT_SRC_EXT_COMM && info->attr->ecommunity && info->attr->ecommunity->str) {
         if (chptr->plugin->type.id != PLUGIN_ID_MEMORY) {
-          len = strlen(info->attr->ecommunity->str);
-
-          if (len && (config.nfacctd_bgp_src_ext_comm_type & BGP_SRC_PRIMITIVES_BGP)) {
-            len++;
-
-            if (config.nfacctd_bgp_extcomm_pattern) {
-              ptr = malloc(len);
-
-              if (ptr) {
-                evaluate_comm_patterns(ptr, info->attr->ecommunity->str, ext_comm_patterns, len);
-                len = strlen(ptr);
-                len++;
-              }
-              else len = 0;
-            }
-            else ptr = info->attr->ecommunity->str;
+          if (memo->ext_comms_len && (config.nfacctd_bgp_src_ext_comm_type & BGP_SRC_PRIMITIVES_BGP)) {
+            ptr = memo->ext_comms;
+            len = memo->ext_comms_len;
+          }
+          else {
+            ptr = &empty_str;
+            len = 0;
           }
-          else ptr = &empty_str;
 
           if (check_pipe_buffer_space(chptr, pvlen, PmLabelTSz + len)) {
             vlen_prims_init(pvlen, 0);
             return;
           }
-          else {
-            vlen_prims_insert(pvlen, COUNT_INT_SRC_EXT_COMM, len, ptr, PM_MSG_STR_COPY);
-            if (config.nfacctd_bgp_extcomm_pattern && ptr && len) free(ptr);
-          }
+          else vlen_prims_insert(pvlen, COUNT_INT_SRC_EXT_COMM, len, ptr, PM_MSG_STR_COPY);
         }
         /* fallback to legacy fixed length behaviour */
         else {
 	  if (config.nfacctd_bgp_src_ext_comm_type & BGP_SRC_PRIMITIVES_BGP) {
-            if (config.nfacctd_bgp_extcomm_pattern)
-              evaluate_comm_patterns(plbgp->src_ext_comms, info->attr->ecommunity->str, ext_comm_patterns, MAX_BGP_EXT_COMMS);
-            else {
-              strlcpy(plbgp->src_ext_comms, info->attr->ecommunity->str, MAX_BGP_EXT_COMMS);
-              if (strlen(info->attr->ecommunity->str) >= MAX_BGP_EXT_COMMS) {
-                plbgp->src_ext_comms[MAX_BGP_EXT_COMMS-2] = '+';
-                plbgp->src_ext_comms[MAX_BGP_EXT_COMMS-1] = '\0';
-	      }
+            strlcpy(plbgp->src_ext_comms, memo->ext_comms, MAX_BGP_EXT_COMMS);
+            if (memo->ext_comms_len > MAX_BGP_EXT_COMMS) {
+              plbgp->src_ext_comms[MAX_BGP_EXT_COMMS-2] = '+';
+              plbgp->src_ext_comms[MAX_BGP_EXT_COMMS-1] = '\0';
             }
           }
 	  else plbgp->src_ext_comms[0] = '\0';
@@ -4073,44 +4059,27 @@ void bgp_ext_handler(struct channels_list_entry *chptr, struct packet_ptrs *pptr
       }
       if (chptr->aggregation_2 & COUNT_SRC_LRG_COMM && info->attr->lcommunity && info->attr->lcommunity->str) {
         if (chptr->plugin->type.id != PLUGIN_ID_MEMORY) {
-          len = strlen(info->attr->lcommunity->str);
-
-          if (len && (config.nfacctd_bgp_src_lrg_comm_type & BGP_SRC_PRIMITIVES_BGP)) {
-            len++;
-
-            if (config.nfacctd_bgp_lrgcomm_pattern) {
-              ptr = malloc(len);
-
-              if (ptr) {
-                evaluate_comm_patterns(ptr, info->attr->lcommunity->str, lrg_comm_patterns, len);
-                len = strlen(ptr);
-                len++;
-              }
-              else len = 0;
-            }
-            else ptr = info->attr->lcommunity->str;
+          if (memo->lrg_comms_len && (config.nfacctd_bgp_src_lrg_comm_type & BGP_SRC_PRIMITIVES_BGP)) {
+            ptr = memo->lrg_comms;
+            len = memo->lrg_comms_len;
+          }
+          else {
+            ptr = &empty_str;
+            len = 0;
           }
-          else ptr = &empty_str;
 
           if (check_pipe_buffer_space(chptr, pvlen, PmLabelTSz + len)) {
             vlen_prims_init(pvlen, 0);
             return;
           }
-          else {
-            vlen_prims_insert(pvlen, COUNT_INT_SRC_LRG_COMM, len, ptr, PM_MSG_STR_COPY);
-            if (config.nfacctd_bgp_lrgcomm_pattern && ptr && len) free(ptr);
-          }
+          else vlen_prims_insert(pvlen, COUNT_INT_SRC_LRG_COMM, len, ptr, PM_MSG_STR_COPY);
         }
         else {
 	  if (config.nfacctd_bgp_src_lrg_comm_type & BGP_SRC_PRIMITIVES_BGP) {
-            if (config.nfacctd_bgp_lrgcomm_pattern)
-              evaluate_comm_patterns(plbgp->src_lrg_comms, info->attr->lcommunity->str, lrg_comm_patterns, MAX_BGP_LRG_COMMS);
-            else {
-              strlcpy(plbgp->src_lrg_comms, info->attr->lcommunity->str, MAX_BGP_LRG_COMMS);
-              if (strlen(info->attr->lcommunity->str) >= MAX_BGP_LRG_COMMS) {
-                plbgp->src_lrg_comms[MAX_BGP_LRG_COMMS-2] = '+';
-                plbgp->src_lrg_comms[MAX_BGP_LRG_COMMS-1] = '\0';
-	      }
+            strlcpy(plbgp->src_lrg_comms, memo->lrg_comms, MAX_BGP_LRG_COMMS);
+            if (memo->lrg_comms_len > MAX_BGP_LRG_COMMS) {
+              plbgp->src_lrg_comms[MAX_BGP_LRG_COMMS-2] = '+';
+              plbgp->src_lrg_comms[MAX_BGP_LRG_COMMS-1] = '\0';
             }
           }
 	  else plbgp->src_lrg_comms[0] = '\0';
@@ -4123,16 +4092,8 @@ void bgp_ext_handler(struct channels_list_entry *chptr, struct packet_ptrs *pptr
 	pbgp->src_med = info->attr->med;
 
       if (chptr->aggregation & COUNT_PEER_SRC_AS && config.nfacctd_bgp_peer_as_src_type & BGP_SRC_PRIMITIVES_BGP && info->attr->aspath && info->attr->aspath->str) {
-        pbgp->peer_src_as = evaluate_first_asn(info->attr->aspath->str);
-
-        if (!pbgp->peer_src_as && config.nfacctd_bgp_stdcomm_pattern_to_asn) {
-          char tmp_stdcomms[MAX_BGP_STD_COMMS];
-
-          if (info->attr->community && info->attr->community->str) {
-            evaluate_comm_patterns(tmp_stdcomms, info->attr->community->str, std_comm_patterns_to_asn, MAX_BGP_STD_COMMS);
-            copy_stdcomm_to_asn(tmp_stdcomms, &pbgp->peer_src_as, FALSE);
-          }
-        }
+        pbgp->peer_src_as = memo->first_asn;
+        if (!pbgp->peer_src_as) pbgp->peer_src_as = memo->comm_peer_asn;
       }
     }
   }
@@ -4188,187 +4149,116 @@ void bgp_ext_handler(struct channels_list_entry *chptr, struct packet_ptrs *pptr
   if (dst_ret && evaluate_lm_method(pptrs, TRUE, chptr->plugin->cfg.nfacctd_as, NF_AS_BGP)) {
     info = (struct bgp_info *) pptrs->bgp_dst_info;
     if (info && info->attr) {
+      memo = bgp_attr_memo_get(info->attr);
+
       if (chptr->aggregation & COUNT_STD_COMM && info->attr->community && info->attr->community->str) {
         if (chptr->plugin->type.id != PLUGIN_ID_MEMORY) {
-          len = strlen(info->attr->community->str);
-            
-          if (len) { 
-	    len++;
-
-            if (config.nfacctd_bgp_stdcomm_pattern) {
-              ptr = malloc(len);
-
-              if (ptr) {
-                evaluate_comm_patterns(ptr, info->attr->community->str, std_comm_patterns, len);
-                len = strlen(ptr);
-		len++;
-              }
-              else len = 0;
-            }
-            else ptr = info->attr->community->str; 
+          if (memo->std_comms_len) {
+            ptr = memo->std_comms;
+            len = memo->std_comms_len;
+          }
+          else {
+            ptr = &empty_str;
+            len = 0;
           }
-          else ptr = &empty_str;
         
           if (check_pipe_buffer_space(chptr, pvlen, PmLabelTSz + len)) {
             vlen_prims_init(pvlen, 0);
             return;
           }
-          else {
-            vlen_prims_insert(pvlen, COUNT_INT_STD_COMM, len, ptr, PM_MSG_STR_COPY);
-            if (config.nfacctd_bgp_stdcomm_pattern && ptr && len) free(ptr);
-          }
+          else vlen_prims_insert(pvlen, COUNT_INT_STD_COMM, len, ptr, PM_MSG_STR_COPY);
         }
         /* fallback to legacy fixed length behaviour */
 	else {
-	  if (config.nfacctd_bgp_stdcomm_pattern)
-	    evaluate_comm_patterns(plbgp->std_comms, info->attr->community->str, std_comm_patterns, MAX_BGP_STD_COMMS);
-	  else {
-            strlcpy(plbgp->std_comms, info->attr->community->str, MAX_BGP_STD_COMMS);
-	    if (strlen(info->attr->community->str) >= MAX_BGP_STD_COMMS) {
-	      plbgp->std_comms[MAX_BGP_STD_COMMS-2] = '+';
-	      plbgp->std_comms[MAX_BGP_STD_COMMS-1] = '\0';
-	    }
+	  strlcpy(plbgp->std_comms, memo->std_comms, MAX_BGP_STD_COMMS);
+	  if (memo->std_comms_len > MAX_BGP_STD_COMMS) {
+	    plbgp->std_comms[MAX_BGP_STD_COMMS-2] = '+';
+	    plbgp->std_comms[MAX_BGP_STD_COMMS-1] = '\0';
 	  }
 	}
       }
       if (chptr->aggregation & COUNT_EXT_COMM && info->attr->ecommunity && info->attr->ecommunity->str) {
         if (chptr->plugin->type.id != PLUGIN_ID_MEMORY) {
-          len = strlen(info->attr->ecommunity->str);
-
-          if (len) {
-	    len++;
-
-            if (config.nfacctd_bgp_extcomm_pattern) {
-              ptr = malloc(len);
-
-              if (ptr) {
-                evaluate_comm_patterns(ptr, info->attr->ecommunity->str, ext_comm_patterns, len);
-                len = strlen(ptr);
-		len++;
-              }
-              else len = 0;
-            }
-            else ptr = info->attr->ecommunity->str;
+          if (memo->ext_comms_len) {
+            ptr = memo->ext_comms;
+            len = memo->ext_comms_len;
+          }
+          else {
+            ptr = &empty_str;
+            len = 0;
           }
-          else ptr = &empty_str;
 
           if (check_pipe_buffer_space(chptr, pvlen, PmLabelTSz + len)) {
             vlen_prims_init(pvlen, 0);
             return;
           }
-          else {
-            vlen_prims_insert(pvlen, COUNT_INT_EXT_COMM, len, ptr, PM_MSG_STR_COPY);
-            if (config.nfacctd_bgp_extcomm_pattern && ptr && len) free(ptr);
-          }
+          else vlen_prims_insert(pvlen, COUNT_INT_EXT_COMM, len, ptr, PM_MSG_STR_COPY);
         }
         /* fallback to legacy fixed length behaviour */
         else {
-	  if (config.nfacctd_bgp_extcomm_pattern)
-	    evaluate_comm_patterns(plbgp->ext_comms, info->attr->ecommunity->str, ext_comm_patterns, MAX_BGP_EXT_COMMS);
-	  else {
-            strlcpy(plbgp->ext_comms, info->attr->ecommunity->str, MAX_BGP_EXT_COMMS);
-	    if (strlen(info->attr->ecommunity->str) >= MAX_BGP_EXT_COMMS) {
-	      plbgp->ext_comms[MAX_BGP_EXT_COMMS-2] = '+';
-	      plbgp->ext_comms[MAX_BGP_EXT_COMMS-1] = '\0';
-	    }
+	  strlcpy(plbgp->ext_comms, memo->ext_comms, MAX_BGP_EXT_COMMS);
+	  if (memo->ext_comms_len > MAX_BGP_EXT_COMMS) {
+	    plbgp->ext_comms[MAX_BGP_EXT_COMMS-2] = '+';
+	    plbgp->ext_comms[MAX_BGP_EXT_COMMS-1] = '\0';
 	  }
         }
       }
       if (chptr->aggregation_2 & COUNT_LRG_COMM && info->attr->lcommunity && info->attr->lcommunity->str) {
         if (chptr->plugin->type.id != PLUGIN_ID_MEMORY) {
-          len = strlen(info->attr->lcommunity->str);
-
-          if (len) {
-            len++;
-
-            if (config.nfacctd_bgp_lrgcomm_pattern) {
-              ptr = malloc(len);
-
-              if (ptr) {
-                evaluate_comm_patterns(ptr, info->attr->lcommunity->str, lrg_comm_patterns, len);
-                len = strlen(ptr);
-                len++;
-              }
-              else len = 0;
-            }
-            else ptr = info->attr->lcommunity->str;
+          if (memo->lrg_comms_len) {
+            ptr = memo->lrg_comms;
+            len = memo->lrg_comms_len;
+          }
+          else {
+            ptr = &empty_str;
+            len = 0;
           }
-          else ptr = &empty_str;
 
           if (check_pipe_buffer_space(chptr, pvlen, PmLabelTSz + len)) {
             vlen_prims_init(pvlen, 0);
             return;
           }
-          else {
-            vlen_prims_insert(pvlen, COUNT_INT_LRG_COMM, len, ptr, PM_MSG_STR_COPY);
-            if (config.nfacctd_bgp_lrgcomm_pattern && ptr && len) free(ptr);
-          }
+          else vlen_prims_insert(pvlen, COUNT_INT_LRG_COMM, len, ptr, PM_MSG_STR_COPY);
         }
         /* fallback to legacy fixed length behaviour */
         else {
-          if (config.nfacctd_bgp_lrgcomm_pattern)
-            evaluate_comm_patterns(plbgp->lrg_comms, info->attr->lcommunity->str, lrg_comm_patterns, MAX_BGP_LRG_COMMS);
-          else {
-            strlcpy(plbgp->lrg_comms, info->attr->lcommunity->str, MAX_BGP_LRG_COMMS);
-            if (strlen(info->attr->lcommunity->str) >= MAX_BGP_LRG_COMMS) {
-              plbgp->lrg_comms[MAX_BGP_LRG_COMMS-2] = '+';
-              plbgp->lrg_comms[MAX_BGP_LRG_COMMS-1] = '\0';
-            }
+          strlcpy(plbgp->lrg_comms, memo->lrg_comms, MAX_BGP_LRG_COMMS);
+          if (memo->lrg_comms_len > MAX_BGP_LRG_COMMS) {
+            plbgp->lrg_comms[MAX_BGP_LRG_COMMS-2] = '+';
+            plbgp->lrg_comms[MAX_BGP_LRG_COMMS-1] = '\0';
           }
         }
       }
       if (chptr->aggregation & COUNT_AS_PATH && info->attr->aspath && info->attr->aspath->str) {
 	if (chptr->plugin->type.id != PLUGIN_ID_MEMORY) {
-          len = strlen(info->attr->aspath->str);
-
-          if (len) {
-	    len++;
-
-            if (config.nfacctd_bgp_aspath_radius) {
-              ptr = strndup(info->attr->aspath->str, len);
-
-              if (ptr) {
-                evaluate_bgp_aspath_radius(ptr, len, config.nfacctd_bgp_aspath_radius);
-                len = strlen(ptr);
-		len++;
-              }
-              else len = 0;
-            }
-            else ptr = info->attr->aspath->str;
+          if (memo->as_path_len) {
+            ptr = memo->as_path;
+            len = memo->as_path_len;
+          }
+          else {
+            ptr = &empty_str;
+            len = 0;
           }
-          else ptr = &empty_str;
 
           if (check_pipe_buffer_space(chptr, pvlen, PmLabelTSz + len)) {
             vlen_prims_init(pvlen, 0);
             return;
           }
           else vlen_prims_insert(pvlen, COUNT_INT_AS_PATH, len, ptr, PM_MSG_STR_COPY);
-
-          if (config.nfacctd_bgp_aspath_radius && ptr && len) free(ptr);
 	}
 	/* fallback to legacy fixed length behaviour */
 	else {
-	  strlcpy(plbgp->as_path, info->attr->aspath->str, MAX_BGP_ASPATH);
-	  if (strlen(info->attr->aspath->str) >= MAX_BGP_ASPATH) {
+	  strlcpy(plbgp->as_path, memo->as_path, MAX_BGP_ASPATH);
+	  if (memo->as_path_len > MAX_BGP_ASPATH) {
 	    plbgp->as_path[MAX_BGP_ASPATH-2] = '+';
 	    plbgp->as_path[MAX_BGP_ASPATH-1] = '\0';
 	  }
-	  if (config.nfacctd_bgp_aspath_radius)
-	    evaluate_bgp_aspath_radius(plbgp->as_path, MAX_BGP_ASPATH, config.nfacctd_bgp_aspath_radius);
 	}
       }
       if (config.nfacctd_as & NF_AS_BGP) {
         if (chptr->aggregation & COUNT_DST_AS && info->attr->aspath) {
           pdata->primitives.dst_as = evaluate_last_asn(info->attr->aspath);
-
-          if (!pdata->primitives.dst_as && config.nfacctd_bgp_stdcomm_pattern_to_asn) {
-            char tmp_stdcomms[MAX_BGP_STD_COMMS];
-
-            if (info->attr->community && info->attr->community->str) {
-              evaluate_comm_patterns(tmp_stdcomms, info->attr->community->str, std_comm_patterns_to_asn, MAX_BGP_STD_COMMS);
-              copy_stdcomm_to_asn(tmp_stdcomms, &pdata->primitives.dst_as, TRUE);
-            }
-	  }
+          if (!pdata->primitives.dst_as) pdata->primitives.dst_as = memo->comm_origin_asn;
         }
       }
 
@@ -4377,16 +4267,8 @@ void bgp_ext_handler(struct channels_list_entry *chptr, struct packet_ptrs *pptr
       if (chptr->aggregation & COUNT_MED) pbgp->med = info->attr->med;
 
       if (chptr->aggregation & COUNT_PEER_DST_AS && info->attr->aspath && info->attr->aspath->str) {
-        pbgp->peer_dst_as = evaluate_first_asn(info->attr->aspath->str);
-
-        if (!pbgp->peer_dst_as && config.nfacctd_bgp_stdcomm_pattern_to_asn) {
-          char tmp_stdcomms[MAX_BGP_STD_COMMS];
-
-          if (info->attr->community && info->attr->community->str) {
-            evaluate_comm_patterns(tmp_stdcomms, info->attr->community->str, std_comm_patterns_to_asn, MAX_BGP_STD_COMMS);
-            copy_stdcomm_to_asn(tmp_stdcomms, &pbgp->peer_dst_as, FALSE);
-          }
-        }
+        pbgp->peer_dst_as = memo->first_asn;
+        if (!pbgp->peer_dst_as) pbgp->peer_dst_as = memo->comm_peer_asn;
       }
     }
   }
@@ -4456,7 +4338,7 @@ void sfprobe_bgp_ext_handler(struct channels_list_entry *chptr, struct packet_pt
 	  if (!chptr->plugin->cfg.nfprobe_peer_as)
 	    payload->src_as = evaluate_last_asn(info->attr->aspath);
 	  else
-            payload->src_as = evaluate_first_asn(info->attr->aspath->str);
+            payload->src_as = bgp_attr_memo_get(info->attr)->first_asn;
 	}
       }
     }
@@ -4470,7 +4352,7 @@ void sfprobe_bgp_ext_handler(struct channels_list_entry *chptr, struct packet_pt
 	  if (!chptr->plugin->cfg.nfprobe_peer_as)
             payload->dst_as = evaluate_last_asn(info->attr->aspath);
           else
-	    payload->dst_as = evaluate_first_asn(info->attr->aspath->str);
+	    payload->dst_as = bgp_attr_memo_get(info->attr)->first_asn;
 	}
       }
     }
@@ -4496,7 +4378,7 @@ void nfprobe_bgp_ext_handler(struct channels_list_entry *chptr, struct packet_pt
           if (!chptr->plugin->cfg.nfprobe_peer_as)
             pdata->primitives.src_as = evaluate_last_asn(info->attr->aspath);
           else
-            pdata->primitives.src_as = evaluate_first_asn(info->attr->aspath->str);
+            pdata->primitives.src_as = bgp_attr_memo_get(info->attr)->first_asn;
         }
       }
     }
@@ -4510,7 +4392,7 @@ void nfprobe_bgp_ext_handler(struct channels_list_entry *chptr, struct packet_pt
           if (!chptr->plugin->cfg.nfprobe_peer_as)
             pdata->primitives.dst_as = evaluate_last_asn(info->attr->aspath);
           else
-            pdata->primitives.dst_as = evaluate_first_asn(info->attr->aspath->str);
+            pdata->primitives.dst_as = bgp_attr_memo_get(info->attr)->first_asn;
         }
       }
     }
@@ -4531,14 +4413,9 @@ void bgp_peer_src_as_frommap_handler(struct channels_list_entry *chptr, struct p
 
   if (!pbgp->peer_src_as && config.nfacctd_bgp_stdcomm_pattern_to_asn) {
     if (src_ret) {
-      char tmp_stdcomms[MAX_BGP_STD_COMMS];
-
       info = (struct bgp_info *) pptrs->bgp_src_info;
 
-      if (info && info->attr && info->attr->community && info->attr->community->str) {
-        evaluate_comm_patterns(tmp_stdcomms, info->attr->community->str, std_comm_patterns_to_asn, MAX_BGP_STD_COMMS);
-        copy_stdcomm_to_asn(tmp_stdcomms, &pbgp->peer_src_as, FALSE);
-      }
+      if (info && info->attr) pbgp->peer_src_as = bgp_attr_memo_get(info->attr)->comm_peer_asn;
     }
   }
 }
@@ -5219,38 +5096,54 @@ void src_host_country_geoip_handler(struct channels_list_entry *chptr, struct pa
 {
   struct pkt_data *pdata = (struct pkt_data *) *data;
 
-  pm_geoip_init();
-  pdata->primitives.src_ip_country.id = 0;
+  if (!(pptrs->enrich & PM_ENRICH_SRC_GEOIP)) {
+    pm_geoip_init();
+    pptrs->geoip_src_id = 0;
 
-  if (config.geoip_ipv4) {
-    if (pptrs->l3_proto == ETHERTYPE_IP)
-      pdata->primitives.src_ip_country.id = GeoIP_id_by_ipnum(config.geoip_ipv4, ntohl(((struct my_iphdr *) pptrs->iph_ptr)->ip_src.s_addr));
-  }
+    if (config.geoip_ipv4) {
+      if (pptrs->l3_proto == ETHERTYPE_IP)
+        pptrs->geoip_src_id = GeoIP_id_by_ipnum(config.geoip_ipv4, ntohl(((struct my_iphdr *) pptrs->iph_ptr)->ip_src.s_addr));
+    }
 #if defined ENABLE_IPV6
-  if (config.geoip_ipv6) {
-    if (pptrs->l3_proto == ETHERTYPE_IPV6)
-      pdata->primitives.src_ip_country.id = GeoIP_id_by_ipnum_v6(config.geoip_ipv6, ((struct ip6_hdr *)pptrs->iph_ptr)->ip6_src);
-  }
+    if (config.geoip_ipv6) {
+      if (pptrs->l3_proto == ETHERTYPE_IPV6)
+        pptrs->geoip_src_id = GeoIP_id_by_ipnum_v6(config.geoip_ipv6, ((struct ip6_hdr *)pptrs->iph_ptr)->ip6_src);
+    }
 #endif
+
+    pptrs->enrich |= PM_ENRICH_SRC_GEOIP;
+    enrich_stats.computed++;
+  }
+  else enrich_stats.reused++;
+
+  pdata->primitives.src_ip_country.id = pptrs->geoip_src_id;
 }
 
 void dst_host_country_geoip_handler(struct channels_list_entry *chptr, struct packet_ptrs *pptrs, char **data)
 {
   struct pkt_data *pdata = (struct pkt_data *) *data;
 
-  pm_geoip_init();
-  pdata->primitives.dst_ip_country.id = 0;
+  if (!(pptrs->enrich & PM_ENRICH_DST_GEOIP)) {
+    pm_geoip_init();
+    pptrs->geoip_dst_id = 0;
 
-  if (config.geoip_ipv4) {
-    if (pptrs->l3_proto == ETHERTYPE_IP)
-      pdata->primitives.dst_ip_country.id = GeoIP_id_by_ipnum(config.geoip_ipv4, ntohl(((struct my_iphdr *) pptrs->iph_ptr)->ip_dst.s_addr));
-  }
+    if (config.geoip_ipv4) {
+      if (pptrs->l3_proto == ETHERTYPE_IP)
+        pptrs->geoip_dst_id = GeoIP_id_by_ipnum(config.geoip_ipv4, ntohl(((struct my_iphdr *) pptrs->iph_ptr)->ip_dst.s_addr));
+    }
 #if defined ENABLE_IPV6
-  if (config.geoip_ipv6) {
-    if (pptrs->l3_proto == ETHERTYPE_IPV6)
-      pdata->primitives.dst_ip_country.id = GeoIP_id_by_ipnum_v6(config.geoip_ipv6, ((struct ip6_hdr *)pptrs->iph_ptr)->ip6_dst);
-  }
+    if (config.geoip_ipv6) {
+      if (pptrs->l3_proto == ETHERTYPE_IPV6)
+        pptrs->geoip_dst_id = GeoIP_id_by_ipnum_v6(config.geoip_ipv6, ((struct ip6_hdr *)pptrs->iph_ptr)->ip6_dst);
+    }
 #endif
+
+    pptrs->enrich |= PM_ENRICH_DST_GEOIP;
+    enrich_stats.computed++;
+  }
+  else enrich_stats.reused++;
+
+  pdata->primitives.dst_ip_country.id = pptrs->geoip_dst_id;
 }
 #endif
 
@@ -5269,7 +5162,10 @@ void pm_geoipv2_init()
       log_notification_set(&log_notifications.geoip_ipv4_file_null, FALSE, FALSE);
       memset(&config.geoipv2_db, 0, sizeof(config.geoipv2_db));
     }
-    else Log(LOG_INFO, "INFO ( %s/%s ): geoipv2_file database %s loaded\n", config.name, config.type, config.geoipv2_file);
+    else {
+      Log(LOG_INFO, "INFO ( %s/%s ): geoipv2_file database %s loaded\n", config.name, config.type, config.geoipv2_file);
+      geoipv2_lpm_request();
+    }
   }
 }
 
@@ -5284,13 +5180,21 @@ void src_host_geoipv2_lookup_handler(struct channels_list_entry *chptr, struct p
   struct sockaddr *sa = (struct sockaddr *) &ss;
   int mmdb_error;
 
+  if (pptrs->enrich & PM_ENRICH_SRC_GEOIPV2) {
+    enrich_stats.reused++;
+    return;
+  }
+
   memset(&pptrs->geoipv2_src, 0, sizeof(pptrs->geoipv2_src));
+  pptrs->geoipv2_src_lpm = NULL;
 
   if (pptrs->l3_proto == ETHERTYPE_IP) {
+    if (geoipv2_lpm_lookup(AF_INET, &((struct my_iphdr *) pptrs->iph_ptr)->ip_src.s_addr, &pptrs->geoipv2_src_lpm)) goto exit_lane;
     raw_to_sa(sa, (char *) &((struct my_iphdr *) pptrs->iph_ptr)->ip_src.s_addr, AF_INET);
   }
 #if defined ENABLE_IPV6
   else if (pptrs->l3_proto == ETHERTYPE_IPV6) {
+    if (geoipv2_lpm_lookup(AF_INET6, &((struct ip6_hdr *)pptrs->iph_ptr)->ip6_src, &pptrs->geoipv2_src_lpm)) goto exit_lane;
     raw_to_sa(sa, (char *) &((struct ip6_hdr *)pptrs->iph_ptr)->ip6_src, AF_INET6);
   }
 #endif
@@ -5302,6 +5206,10 @@ void src_host_geoipv2_lookup_handler(struct channels_list_entry *chptr, struct p
       Log(LOG_WARNING, "WARN ( %s/%s ): src_host_geoipv2_lookup_handler(): %s\n", config.name, config.type, MMDB_strerror(mmdb_error));
     }
   }
+
+  exit_lane:
+  pptrs->enrich |= PM_ENRICH_SRC_GEOIPV2;
+  enrich_stats.computed++;
 }
 
 void dst_host_geoipv2_lookup_handler(struct channels_list_entry *chptr, struct packet_ptrs *pptrs, char **data)
@@ -5310,13 +5218,21 @@ void dst_host_geoipv2_lookup_handler(struct channels_list_entry *chptr, struct p
   struct sockaddr *sa = (struct sockaddr *) &ss;
   int mmdb_error;
 
+  if (pptrs->enrich & PM_ENRICH_DST_GEOIPV2) {
+    enrich_stats.reused++;
+    return;
+  }
+
   memset(&pptrs->geoipv2_dst, 0, sizeof(pptrs->geoipv2_dst));
+  pptrs->geoipv2_dst_lpm = NULL;
 
   if (pptrs->l3_proto == ETHERTYPE_IP) {
+    if (geoipv2_lpm_lookup(AF_INET, &((struct my_iphdr *) pptrs->iph_ptr)->ip_dst.s_addr, &pptrs->geoipv2_dst_lpm)) goto exit_lane;
     raw_to_sa(sa, (char *) &((struct my_iphdr *) pptrs->iph_ptr)->ip_dst.s_addr, AF_INET);
   }
 #if defined ENABLE_IPV6
   else if (pptrs->l3_proto == ETHERTYPE_IPV6) {
+    if (geoipv2_lpm_lookup(AF_INET6, &((struct ip6_hdr *)pptrs->iph_ptr)->ip6_dst, &pptrs->geoipv2_dst_lpm)) goto exit_lane;
     raw_to_sa(sa, (char *) &((struct ip6_hdr *)pptrs->iph_ptr)->ip6_dst, AF_INET6);
   }
 #endif
@@ -5328,146 +5244,141 @@ void dst_host_geoipv2_lookup_handler(struct channels_list_entry *chptr, struct p
       Log(LOG_WARNING, "WARN ( %s/%s ): dst_host_geoipv2_lookup_handler(): %s\n", config.name, config.type, MMDB_strerror(mmdb_error));
     }
   }
+
+  exit_lane:
+  pptrs->enrich |= PM_ENRICH_DST_GEOIPV2;
+  enrich_stats.computed++;
 }
 
-void src_host_country_geoipv2_handler(struct channels_list_entry *chptr, struct packet_ptrs *pptrs, char **data)
+/*
+   Fetches a string value out of a GeoIPv2 lookup result. Returns TRUE if
+   the value was found (and copied, possibly truncated, to str); str is
+   zeroed in any case so that it can be copied as-is onto the primitive.
+*/
+static int pm_geoipv2_get_string(MMDB_lookup_result_s *result, char *key, char *subkey, char *str, int len, char *caller)
 {
-  struct pkt_data *pdata = (struct pkt_data *) *data;
   MMDB_entry_data_list_s *entry_data_list = NULL;
-  int status;
+  MMDB_entry_data_s entry_data;
+  int status, size, ret = FALSE;
 
-  if (pptrs->geoipv2_src.found_entry) {
-    MMDB_entry_data_s entry_data;
+  memset(str, 0, len);
 
-    status = MMDB_get_value(&pptrs->geoipv2_src.entry, &entry_data, "country", "iso_code", NULL);
+  if (!result->found_entry) return ret;
 
-    if (entry_data.offset) {
-      MMDB_entry_s entry = { .mmdb = &config.geoipv2_db, .offset = entry_data.offset };
-      status = MMDB_get_entry_data_list(&entry, &entry_data_list);
-    }
+  status = MMDB_get_value(&result->entry, &entry_data, key, subkey, NULL);
 
-    if (status != MMDB_SUCCESS && status != MMDB_LOOKUP_PATH_DOES_NOT_MATCH_DATA_ERROR) {
-      Log(LOG_WARNING, "WARN ( %s/%s ): src_host_country_geoipv2_handler(): %s\n", config.name, config.type, MMDB_strerror(status));
-    }
+  if (entry_data.offset) {
+    MMDB_entry_s entry = { .mmdb = &config.geoipv2_db, .offset = entry_data.offset };
+    status = MMDB_get_entry_data_list(&entry, &entry_data_list);
+  }
 
-    if (entry_data_list != NULL) {
-      if (entry_data_list->entry_data.has_data) {
-	if (entry_data_list->entry_data.type == MMDB_DATA_TYPE_UTF8_STRING) {
-	  int size = (entry_data_list->entry_data.data_size < (PM_COUNTRY_T_STRLEN-1)) ? entry_data_list->entry_data.data_size : (PM_COUNTRY_T_STRLEN-1);
+  if (status != MMDB_SUCCESS && status != MMDB_LOOKUP_PATH_DOES_NOT_MATCH_DATA_ERROR) {
+    Log(LOG_WARNING, "WARN ( %s/%s ): %s(): %s\n", config.name, config.type, caller, MMDB_strerror(status));
+  }
 
-	  memcpy(pdata->primitives.src_ip_country.str, entry_data_list->entry_data.utf8_string, size);
-	  pdata->primitives.src_ip_country.str[size] = '\0';
-	}
-      }
+  if (entry_data_list != NULL) {
+    if (entry_data_list->entry_data.has_data) {
+      if (entry_data_list->entry_data.type == MMDB_DATA_TYPE_UTF8_STRING) {
+        size = (entry_data_list->entry_data.data_size < (len-1)) ? entry_data_list->entry_data.data_size : (len-1);
 
-      MMDB_free_entry_data_list(entry_data_list);
+        memcpy(str, entry_data_list->entry_data.utf8_string, size);
+        str[size] = '\0';
+        ret = TRUE;
+      }
     }
+
+    MMDB_free_entry_data_list(entry_data_list);
   }
+
+  return ret;
 }
 
-void dst_host_country_geoipv2_handler(struct channels_list_entry *chptr, struct packet_ptrs *pptrs, char **data)
+void src_host_country_geoipv2_handler(struct channels_list_entry *chptr, struct packet_ptrs *pptrs, char **data)
 {
   struct pkt_data *pdata = (struct pkt_data *) *data;
-  MMDB_entry_data_list_s *entry_data_list = NULL;
-  int status;
-
-  if (pptrs->geoipv2_dst.found_entry) {
-    MMDB_entry_data_s entry_data;
 
-    status = MMDB_get_value(&pptrs->geoipv2_dst.entry, &entry_data, "country", "iso_code", NULL);
-
-    if (entry_data.offset) {
-      MMDB_entry_s entry = { .mmdb = &config.geoipv2_db, .offset = entry_data.offset };
-      status = MMDB_get_entry_data_list(&entry, &entry_data_list);
+  if (!(pptrs->enrich & PM_ENRICH_SRC_COUNTRY)) {
+    if (pptrs->geoipv2_src_lpm) {
+      memcpy(&pptrs->geoipv2_src_country, &pptrs->geoipv2_src_lpm->country, sizeof(pptrs->geoipv2_src_country));
+      if (pptrs->geoipv2_src_lpm->have_country) pptrs->enrich |= PM_ENRICH_SRC_COUNTRY_FOUND;
     }
+    else if (pm_geoipv2_get_string(&pptrs->geoipv2_src, "country", "iso_code", pptrs->geoipv2_src_country.str,
+			      sizeof(pptrs->geoipv2_src_country.str), "src_host_country_geoipv2_handler"))
+      pptrs->enrich |= PM_ENRICH_SRC_COUNTRY_FOUND;
 
-    if (status != MMDB_SUCCESS && status != MMDB_LOOKUP_PATH_DOES_NOT_MATCH_DATA_ERROR) {
-      Log(LOG_WARNING, "WARN ( %s/%s ): dst_host_country_geoipv2_handler(): %s\n", config.name, config.type, MMDB_strerror(status));
-    }
+    pptrs->enrich |= PM_ENRICH_SRC_COUNTRY;
+    enrich_stats.computed++;
+  }
+  else enrich_stats.reused++;
 
-    if (entry_data_list != NULL) {
-      if (entry_data_list->entry_data.has_data) {
-        if (entry_data_list->entry_data.type == MMDB_DATA_TYPE_UTF8_STRING) {
-          int size = (entry_data_list->entry_data.data_size < (PM_COUNTRY_T_STRLEN-1)) ? entry_data_list->entry_data.data_size : (PM_COUNTRY_T_STRLEN-1);
+  if (pptrs->enrich & PM_ENRICH_SRC_COUNTRY_FOUND)
+    memcpy(pdata->primitives.src_ip_country.str, pptrs->geoipv2_src_country.str, strlen(pptrs->geoipv2_src_country.str)+1);
+}
 
-          memcpy(pdata->primitives.dst_ip_country.str, entry_data_list->entry_data.utf8_string, size);
-          pdata->primitives.dst_ip_country.str[size] = '\0';
-        }
-      }
+void dst_host_country_geoipv2_handler(struct channels_list_entry *chptr, struct packet_ptrs *pptrs, char **data)
+{
+  struct pkt_data *pdata = (struct pkt_data *) *data;
 
-      MMDB_free_entry_data_list(entry_data_list);
+  if (!(pptrs->enrich & PM_ENRICH_DST_COUNTRY)) {
+    if (pptrs->geoipv2_dst_lpm) {
+      memcpy(&pptrs->geoipv2_dst_country, &pptrs->geoipv2_dst_lpm->country, sizeof(pptrs->geoipv2_dst_country));
+      if (pptrs->geoipv2_dst_lpm->have_country) pptrs->enrich |= PM_ENRICH_DST_COUNTRY_FOUND;
     }
+    else if (pm_geoipv2_get_string(&pptrs->geoipv2_dst, "country", "iso_code", pptrs->geoipv2_dst_country.str,
+			      sizeof(pptrs->geoipv2_dst_country.str), "dst_host_country_geoipv2_handler"))
+      pptrs->enrich |= PM_ENRICH_DST_COUNTRY_FOUND;
+
+    pptrs->enrich |= PM_ENRICH_DST_COUNTRY;
+    enrich_stats.computed++;
   }
+  else enrich_stats.reused++;
+
+  if (pptrs->enrich & PM_ENRICH_DST_COUNTRY_FOUND)
+    memcpy(pdata->primitives.dst_ip_country.str, pptrs->geoipv2_dst_country.str, strlen(pptrs->geoipv2_dst_country.str)+1);
 }
 
 void src_host_pocode_geoipv2_handler(struct channels_list_entry *chptr, struct packet_ptrs *pptrs, char **data)
 {
   struct pkt_data *pdata = (struct pkt_data *) *data;
-  MMDB_entry_data_list_s *entry_data_list = NULL;
-  int status;
-
-  if (pptrs->geoipv2_src.found_entry) {
-    MMDB_entry_data_s entry_data;
-
-    status = MMDB_get_value(&pptrs->geoipv2_src.entry, &entry_data, "postal", "code", NULL);
 
-    if (entry_data.offset) {
-      MMDB_entry_s entry = { .mmdb = &config.geoipv2_db, .offset = entry_data.offset };
-      status = MMDB_get_entry_data_list(&entry, &entry_data_list);
+  if (!(pptrs->enrich & PM_ENRICH_SRC_POCODE)) {
+    if (pptrs->geoipv2_src_lpm) {
+      memcpy(&pptrs->geoipv2_src_pocode, &pptrs->geoipv2_src_lpm->pocode, sizeof(pptrs->geoipv2_src_pocode));
+      if (pptrs->geoipv2_src_lpm->have_pocode) pptrs->enrich |= PM_ENRICH_SRC_POCODE_FOUND;
     }
+    else if (pm_geoipv2_get_string(&pptrs->geoipv2_src, "postal", "code", pptrs->geoipv2_src_pocode.str,
+			      sizeof(pptrs->geoipv2_src_pocode.str), "src_host_pocode_geoipv2_handler"))
+      pptrs->enrich |= PM_ENRICH_SRC_POCODE_FOUND;
 
-    if (status != MMDB_SUCCESS && status != MMDB_LOOKUP_PATH_DOES_NOT_MATCH_DATA_ERROR) {
-      Log(LOG_WARNING, "WARN ( %s/%s ): src_host_pocode_geoipv2_handler(): %s\n", config.name, config.type, MMDB_strerror(status));
-    }
-
-    if (entry_data_list != NULL) {
-      if (entry_data_list->entry_data.has_data) {
-        if (entry_data_list->entry_data.type == MMDB_DATA_TYPE_UTF8_STRING) {
-          int size = (entry_data_list->entry_data.data_size < (PM_POCODE_T_STRLEN-1)) ? entry_data_list->entry_data.data_size : (PM_POCODE_T_STRLEN-1);
-
-          memcpy(pdata->primitives.src_ip_pocode.str, entry_data_list->entry_data.utf8_string, size);
-          pdata->primitives.src_ip_pocode.str[size] = '\0';
-        }
-      }
-
-      MMDB_free_entry_data_list(entry_data_list);
-    }
+    pptrs->enrich |= PM_ENRICH_SRC_POCODE;
+    enrich_stats.computed++;
   }
+  else enrich_stats.reused++;
+
+  if (pptrs->enrich & PM_ENRICH_SRC_POCODE_FOUND)
+    memcpy(pdata->primitives.src_ip_pocode.str, pptrs->geoipv2_src_pocode.str, strlen(pptrs->geoipv2_src_pocode.str)+1);
 }
 
 void dst_host_pocode_geoipv2_handler(struct channels_list_entry *chptr, struct packet_ptrs *pptrs, char **data)
 {
   struct pkt_data *pdata = (struct pkt_data *) *data;
-  MMDB_entry_data_list_s *entry_data_list = NULL;
-  int status;
-
-  if (pptrs->geoipv2_dst.found_entry) {
-    MMDB_entry_data_s entry_data;
-
-    status = MMDB_get_value(&pptrs->geoipv2_dst.entry, &entry_data, "postal", "code", NULL);
 
-    if (entry_data.offset) {
-      MMDB_entry_s entry = { .mmdb = &config.geoipv2_db, .offset = entry_data.offset };
-      status = MMDB_get_entry_data_list(&entry, &entry_data_list);
+  if (!(pptrs->enrich & PM_ENRICH_DST_POCODE)) {
+    if (pptrs->geoipv2_dst_lpm) {
+      memcpy(&pptrs->geoipv2_dst_pocode, &pptrs->geoipv2_dst_lpm->pocode, sizeof(pptrs->geoipv2_dst_pocode));
+      if (pptrs->geoipv2_dst_lpm->have_pocode) pptrs->enrich |= PM_ENRICH_DST_POCODE_FOUND;
     }
+    else if (pm_geoipv2_get_string(&pptrs->geoipv2_dst, "postal", "code", pptrs->geoipv2_dst_pocode.str,
+			      sizeof(pptrs->geoipv2_dst_pocode.str), "dst_host_pocode_geoipv2_handler"))
+      pptrs->enrich |= PM_ENRICH_DST_POCODE_FOUND;
 
-    if (status != MMDB_SUCCESS && status != MMDB_LOOKUP_PATH_DOES_NOT_MATCH_DATA_ERROR) {
-      Log(LOG_WARNING, "WARN ( %s/%s ): dst_host_pocode_geoipv2_handler(): %s\n", config.name, config.type, MMDB_strerror(status));
-    }
-
-    if (entry_data_list != NULL) {
-      if (entry_data_list->entry_data.has_data) {
-        if (entry_data_list->entry_data.type == MMDB_DATA_TYPE_UTF8_STRING) {
-          int size = (entry_data_list->entry_data.data_size < (PM_POCODE_T_STRLEN-1)) ? entry_data_list->entry_data.data_size : (PM_POCODE_T_STRLEN-1);
-
-          memcpy(pdata->primitives.dst_ip_pocode.str, entry_data_list->entry_data.utf8_string, size);
-          pdata->primitives.dst_ip_pocode.str[size] = '\0';
-        }
-      }
-
-      MMDB_free_entry_data_list(entry_data_list);
-    }
+    pptrs->enrich |= PM_ENRICH_DST_POCODE;
+    enrich_stats.computed++;
   }
+  else enrich_stats.reused++;
+
+  if (pptrs->enrich & PM_ENRICH_DST_POCODE_FOUND)
+    memcpy(pdata->primitives.dst_ip_pocode.str, pptrs->geoipv2_dst_pocode.str, strlen(pptrs->geoipv2_dst_pocode.str)+1);
 }
 #endif
 
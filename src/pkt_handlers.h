@@ -19,6 +19,12 @@
     Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 */
 
+/* structures */
+struct pkt_enrich_stats {
+  u_int64_t computed;		/* lookups performed */
+  u_int64_t reused;		/* lookups served by the per-packet memo */
+};
+
 #if (defined __PKT_HANDLERS_C)
 extern struct channels_list_entry channels_list[MAX_N_PLUGINS]; /* communication channels: core <-> plugins */
 #endif
@@ -29,6 +35,7 @@ extern struct channels_list_entry channels_list[MAX_N_PLUGINS]; /* communication
 #define EXT
 #endif
 EXT pkt_handler phandler[N_PRIMITIVES];
+EXT struct pkt_enrich_stats enrich_stats;
 #undef EXT
 
 #if (!defined __PKT_HANDLERS_C)
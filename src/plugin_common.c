@@ -478,6 +478,7 @@ void P_cache_insert(struct primitives_ptrs *prim_ptrs, struct insert_data *idata
 
   safe_action:
   {
+    struct timeval purge_start;
     pid_t ret;
 
     Log(LOG_INFO, "INFO ( %s/%s ): Finished cache entries (ie. print_cache_entries). Purging.\n", config.name, config.type);
@@ -486,13 +487,16 @@ void P_cache_insert(struct primitives_ptrs *prim_ptrs, struct insert_data *idata
       Log(LOG_WARNING, "WARN ( %s/%s ): Make sure print_output_file_append is set to true.\n", config.name, config.type);
 
     if (qq_ptr) P_cache_mark_flush(queries_queue, qq_ptr, FALSE);
+    stats_shm_update_cache(qq_ptr, config.print_cache_entries);
 
     /* Writing out to replenish cache space */
     dump_writers_count();
     if (dump_writers_get_flags() != CHLD_ALERT) {
       switch (ret = fork()) {
       case 0: /* Child */
+        gettimeofday(&purge_start, NULL);
         (*purge_func)(queries_queue, qq_ptr);
+        stats_shm_update_purge(&purge_start);
         exit(0);
       default: /* Parent */
         if (ret == -1) Log(LOG_WARNING, "WARN ( %s/%s ): Unable to fork writer: %s\n", config.name, config.type, strerror(errno));
@@ -581,16 +585,20 @@ void P_cache_insert_pending(struct chained_cache *queue[], int index, struct cha
 
 void P_cache_handle_flush_event(struct ports_table *pt)
 {
+  struct timeval purge_start;
   pid_t ret;
 
   if (qq_ptr) P_cache_mark_flush(queries_queue, qq_ptr, FALSE);
+  stats_shm_update_cache(qq_ptr, config.print_cache_entries);
 
   dump_writers_count();
   if (dump_writers_get_flags() != CHLD_ALERT) {
     switch (ret = fork()) {
     case 0: /* Child */
       pm_setproctitle("%s %s [%s]", config.type, "Plugin -- Writer", config.name);
+      gettimeofday(&purge_start, NULL);
       (*purge_func)(queries_queue, qq_ptr);
+      stats_shm_update_purge(&purge_start);
       exit(0);
     default: /* Parent */
       if (ret == -1) Log(LOG_WARNING, "WARN ( %s/%s ): Unable to fork writer: %s\n", config.name, config.type, strerror(errno));
@@ -1024,3 +1032,155 @@ int P_broker_timers_get_retry_interval(struct p_broker_timers *btimers)
 
   return ERR;
 }
+
+/*
+   Multi-values messages for the amqp and kafka plugins: records, which are
+   already serialized to JSON, are concatenated into a single message buffer
+   either as elements of a JSON array or as newline-delimited JSON. A batch
+   is bounded by number of records and, optionally, by size in bytes; it can
+   be optionally gzip-compressed right before being sent out.
+*/
+void P_json_batch_init(struct p_json_batch *batch, int format, u_int32_t max_records, size_t max_bytes, int compress)
+{
+  if (!batch) return;
+
+  memset(batch, 0, sizeof(struct p_json_batch));
+
+  batch->format = format;
+  batch->max_records = max_records;
+  batch->max_bytes = max_bytes;
+  batch->compress = compress;
+
+  batch->buf_len = MAX(max_bytes, LARGEBUFLEN);
+  batch->buf = malloc(batch->buf_len);
+  if (!batch->buf) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): malloc() failed (P_json_batch_init). Exiting ..\n", config.name, config.type);
+    exit_plugin(1);
+  }
+
+  P_json_batch_reset(batch);
+}
+
+void P_json_batch_reset(struct p_json_batch *batch)
+{
+  batch->off = 0;
+  batch->records = 0;
+
+  if (batch->format == P_JSON_BATCH_ARRAY) batch->buf[batch->off++] = '[';
+}
+
+/* returns TRUE if a record of the given length has to go in a new batch */
+int P_json_batch_is_full(struct p_json_batch *batch, size_t len)
+{
+  if (!batch->records) return FALSE;
+  if (batch->max_records && batch->records >= batch->max_records) return TRUE;
+
+  /* record plus separator and closing bracket (or trailing newline) */
+  if (batch->max_bytes && (batch->off + len + 2) > batch->max_bytes) return TRUE;
+
+  return FALSE;
+}
+
+void P_json_batch_append(struct p_json_batch *batch, char *str, size_t len)
+{
+  /* record plus separator, closing bracket (or trailing newline) and string terminator */
+  if ((batch->off + len + 3) > batch->buf_len) {
+    size_t new_buf_len = MAX((batch->buf_len * 2), (batch->off + len + 3));
+    char *new_buf;
+
+    new_buf = realloc(batch->buf, new_buf_len);
+    if (!new_buf) {
+      Log(LOG_ERR, "ERROR ( %s/%s ): realloc() failed (P_json_batch_append). Exiting ..\n", config.name, config.type);
+      exit_plugin(1);
+    }
+
+    batch->buf = new_buf;
+    batch->buf_len = new_buf_len;
+  }
+
+  if (batch->format == P_JSON_BATCH_ARRAY && batch->records) batch->buf[batch->off++] = ',';
+
+  memcpy((batch->buf + batch->off), str, len);
+  batch->off += len;
+
+  if (batch->format == P_JSON_BATCH_NDJSON) batch->buf[batch->off++] = '\n';
+
+  batch->records++;
+}
+
+#if defined (HAVE_ZLIB)
+static char *P_json_batch_compress(struct p_json_batch *batch, size_t in_len, size_t *out_len)
+{
+  z_stream zs;
+  size_t zbuf_len;
+  int ret;
+
+  memset(&zs, 0, sizeof(zs));
+
+  /* 15 window bits plus 16 for a gzip header and trailer */
+  if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, (15 + 16), 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): P_json_batch_compress(): deflateInit2() failed.\n", config.name, config.type);
+    return NULL;
+  }
+
+  zbuf_len = deflateBound(&zs, in_len);
+  if (zbuf_len > batch->zbuf_len) {
+    char *new_zbuf;
+
+    new_zbuf = realloc(batch->zbuf, zbuf_len);
+    if (!new_zbuf) {
+      Log(LOG_ERR, "ERROR ( %s/%s ): realloc() failed (P_json_batch_compress). Exiting ..\n", config.name, config.type);
+      exit_plugin(1);
+    }
+
+    batch->zbuf = new_zbuf;
+    batch->zbuf_len = zbuf_len;
+  }
+
+  zs.next_in = (Bytef *) batch->buf;
+  zs.avail_in = in_len;
+  zs.next_out = (Bytef *) batch->zbuf;
+  zs.avail_out = batch->zbuf_len;
+
+  ret = deflate(&zs, Z_FINISH);
+  (*out_len) = zs.total_out;
+  deflateEnd(&zs);
+
+  if (ret != Z_STREAM_END) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): P_json_batch_compress(): deflate() failed (%d).\n", config.name, config.type, ret);
+    return NULL;
+  }
+
+  return batch->zbuf;
+}
+#endif
+
+/*
+   returns the message ready to be sent out, NULL-terminated if not compressed;
+   the batch has to be reset before being reused.
+*/
+char *P_json_batch_finish(struct p_json_batch *batch, size_t *len)
+{
+  size_t msg_len = batch->off;
+
+  if (batch->format == P_JSON_BATCH_ARRAY) batch->buf[msg_len++] = ']';
+  batch->buf[msg_len] = '\0';
+
+#if defined (HAVE_ZLIB)
+  if (batch->compress) return P_json_batch_compress(batch, msg_len, len);
+#endif
+
+  (*len) = msg_len;
+
+  return batch->buf;
+}
+
+void P_json_batch_free(struct p_json_batch *batch)
+{
+  if (!batch) return;
+
+  if (batch->buf) free(batch->buf);
+  if (batch->zbuf) free(batch->zbuf);
+
+  memset(batch, 0, sizeof(struct p_json_batch));
+}
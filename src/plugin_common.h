@@ -95,6 +95,22 @@ struct p_broker_timers {
 };
 #endif
 
+#ifndef P_JSON_BATCH
+#define P_JSON_BATCH
+struct p_json_batch {
+  char *buf;
+  size_t buf_len;
+  size_t off;
+  u_int32_t records;
+  u_int32_t max_records;
+  size_t max_bytes;
+  u_int8_t format;
+  u_int8_t compress;
+  char *zbuf;
+  size_t zbuf_len;
+};
+#endif
+
 #if (!defined __PLUGIN_COMMON_EXPORT)
 
 #include "preprocess.h"
@@ -134,6 +150,13 @@ EXT void P_broker_timers_unset_last_fail(struct p_broker_timers *);
 EXT time_t P_broker_timers_get_last_fail(struct p_broker_timers *);
 EXT int P_broker_timers_get_retry_interval(struct p_broker_timers *);
 
+EXT void P_json_batch_init(struct p_json_batch *, int, u_int32_t, size_t, int);
+EXT void P_json_batch_reset(struct p_json_batch *);
+EXT int P_json_batch_is_full(struct p_json_batch *, size_t);
+EXT void P_json_batch_append(struct p_json_batch *, char *, size_t);
+EXT char *P_json_batch_finish(struct p_json_batch *, size_t *);
+EXT void P_json_batch_free(struct p_json_batch *);
+
 /* global vars */
 EXT void (*insert_func)(struct primitives_ptrs *, struct insert_data *); /* pointer to INSERT function */
 EXT void (*purge_func)(struct chained_cache *[], int); /* pointer to purge function */ 
@@ -28,6 +28,7 @@
 #include "plugin_hooks.h"
 #include "plugin_common.h"
 #include "pkt_handlers.h"
+#include "geoipv2_lpm.h"
 
 /* functions */
 
@@ -42,7 +43,7 @@ void load_plugins(struct plugin_requests *req)
   u_int64_t buf_pipe_ratio_sz = 0, pipe_idx = 0;
   int snd_buflen = 0, rcv_buflen = 0, socklen = 0, target_buflen = 0, ret;
 
-  int nfprobe_id = 0, min_sz = 0, extra_sz = 0;
+  int nfprobe_id = 0, min_sz = 0, extra_sz = 0, stats_shm_idx = 0;
   struct plugins_list_entry *list = plugins_list;
   int l = sizeof(list->cfg.pipe_size), offset = 0;
   struct channels_list_entry *chptr = NULL;
@@ -50,6 +51,17 @@ void load_plugins(struct plugin_requests *req)
   init_random_seed(); 
   init_pipe_channels();
 
+  if (config.stats_shm_file) {
+    int plugins_num = 0;
+
+    for (list = plugins_list; list; list = list->next) {
+      if ((*list->type.func)) plugins_num++;
+    }
+
+    stats_shm_init(plugins_num);
+    list = plugins_list;
+  }
+
   while (list) {
     if ((*list->type.func)) {
       if (list->cfg.data_type & (PIPE_TYPE_METADATA|PIPE_TYPE_PAYLOAD|PIPE_TYPE_MSG));
@@ -227,6 +239,13 @@ void load_plugins(struct plugin_requests *req)
 	list->cfg.nfprobe_id = nfprobe_id;
 	nfprobe_id++;
       }
+
+      /* the plugin inherits the pointer to its own statistics slot */
+      if (stats_shm) {
+	chptr->stats = stats_shm_plugin_slot(stats_shm_idx, list->name, list->type.string);
+	stats_shm_plugin = chptr->stats;
+	stats_shm_idx++;
+      }
       
       switch (list->pid = fork()) {  
       case -1: /* Something went wrong */
@@ -265,6 +284,7 @@ void load_plugins(struct plugin_requests *req)
     list = list->next;
   }
 
+  stats_shm_plugin = NULL;
   sort_pipe_channels();
 
   /* define pre_tag_map(s) now so that they don't finish unnecessarily in plugin memory space */
@@ -418,8 +438,14 @@ void exec_plugins(struct packet_ptrs *pptrs, struct plugin_requests *req)
 
     reload_geoipv2_file = FALSE;
   }
+
+  if (geoipv2_lpm_next) geoipv2_lpm_swap();
 #endif
 
+  /* enrichment primitives (ie. GeoIP) are computed by the first channel
+     needing them and then shared with the others for this packet */
+  pptrs->enrich = 0;
+
   for (index = 0; channels_list[index].aggregation || channels_list[index].aggregation_2; index++) {
     struct plugins_list_entry *p = channels_list[index].plugin;
 
@@ -479,6 +505,9 @@ reprocess:
       while (channels_list[index].phandler[num]) {
         (*channels_list[index].phandler[num])(&channels_list[index], pptrs, &bptr);
         num++;
+
+	/* not sampled: the remaining handlers, enrichments included, are skipped */
+	if (num == channels_list[index].phandler_sampling && !channels_list[index].s.sampled_pkts) break;
       }
 
       if (channels_list[index].s.rate && !channels_list[index].s.sampled_pkts) {
@@ -488,6 +517,7 @@ reprocess:
 	fixed_size = 0;
 	channels_list[index].var_size = 0;
       }
+      else if (channels_list[index].s.rate) sampling_report(&channels_list[index], time(NULL));
 
       if (channels_list[index].reprocess) {
         /* Let's check if we have an issue with the buffer size */
@@ -774,6 +804,14 @@ void evaluate_sampling(struct sampling *smp, pm_counter_t *pkt_len, pm_counter_t
   }
 
   smp->sampled_pkts = 0;
+  smp->pool_tot += pkts;
+
+  /* fast path: still within the skip drawn at the last sample */
+  if (smp->counter > pkts) {
+    smp->counter -= pkts;
+    smp->sample_pool += pkts;
+    return;
+  }
 
 run_again: 
   if (!smp->counter) smp->counter = (smp->sf)(smp->rate);
@@ -790,6 +828,8 @@ run_again:
     if (pkts > 0) goto run_again;
   }
 
+  smp->sampled_tot += smp->sampled_pkts;
+
   /* Let's handle flows meaningfully */
   if (smp->sampled_pkts && *pkt_num > 1) {
     *pkt_len = ( *pkt_len / *pkt_num ) * smp->sampled_pkts;
@@ -797,6 +837,23 @@ run_again:
   }
 }
 
+/* effective vs configured sampling rate, logged periodically */
+void sampling_report(struct channels_list_entry *chptr, time_t now)
+{
+  struct sampling *smp = &chptr->s;
+
+  if (now < (smp->reported + SAMPLING_REPORT_INTERVAL)) return;
+
+  if (smp->reported && smp->sampled_tot) {
+    Log(LOG_INFO, "INFO ( %s/%s ): sampling rate configured: 1:%llu effective: 1:%.1f (packets: %llu sampled: %llu)\n",
+	chptr->plugin->name, chptr->plugin->type.string, (unsigned long long) smp->rate,
+	((double) smp->pool_tot / smp->sampled_tot), (unsigned long long) smp->pool_tot,
+	(unsigned long long) smp->sampled_tot);
+  }
+
+  smp->reported = now;
+}
+
 /* simple random algorithm */
 pm_counter_t take_simple_random_skip(pm_counter_t mean)
 {
@@ -30,6 +30,7 @@
 #define MAX_FAILS 5 
 #define MAX_SEQNUM 65536 
 #define MAX_RG_COUNT_ERR 3 
+#define SAMPLING_REPORT_INTERVAL 300 /* secs */
 
 struct channels_list_entry;
 typedef void (*pkt_handler) (struct channels_list_entry *, struct packet_ptrs *, char **);
@@ -61,6 +62,9 @@ struct sampling {
   pm_counter_t sample_pool;
   pm_counter_t sampled_pkts;
   skip_func sf;
+  u_int64_t pool_tot;		/* packets seen by the sampler */
+  u_int64_t sampled_tot;	/* packets sampled */
+  time_t reported;
 };
 
 struct aggregate_filter {
@@ -111,6 +115,7 @@ struct channels_list_entry {
   int buffer_immediate;
   int same_aggregate;
   pkt_handler phandler[N_PRIMITIVES];
+  int phandler_sampling;				/* handlers to run before the sampling decision */
   int pipe;
   pid_t core_pid;
   pm_id_t tag;						/* post-tagging tag */
@@ -121,6 +126,7 @@ struct channels_list_entry {
   struct aggregate_filter agg_filter; 			/* filter aggregates basing on L2-L4 primitives */
   struct sampling s;
   struct plugins_list_entry *plugin;			/* backpointer to the plugin the actual channel belongs to */
+  struct stats_shm_plugin *stats;			/* slot in the statistics segment, if any */
   struct extra_primitives extras;			/* offset for non-standard aggregation primitives structures */
 #ifdef WITH_RABBITMQ
   struct p_amqp_host amqp_host;
@@ -175,6 +181,7 @@ EXT int pkt_extras_clean(void *, int);
 EXT void evaluate_sampling(struct sampling *, pm_counter_t *, pm_counter_t *, pm_counter_t *);
 EXT pm_counter_t take_simple_random_skip(pm_counter_t);
 EXT pm_counter_t take_simple_systematic_skip(pm_counter_t);
+EXT void sampling_report(struct channels_list_entry *, time_t);
 #if defined WITH_RABBITMQ
 EXT void plugin_pipe_amqp_init_host(struct p_amqp_host *, struct plugins_list_entry *);
 EXT struct plugin_pipe_amqp_sleeper *plugin_pipe_amqp_sleeper_define(struct p_amqp_host *, int *, struct plugins_list_entry *);
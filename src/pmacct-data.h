@@ -315,7 +315,11 @@ static const struct _dictionary_line dictionary[] = {
   {"debug_internal_msg", cfg_key_debug_internal_msg},
   {"syslog", cfg_key_syslog},
   {"logfile", cfg_key_logfile},
+  {"logfile_async", cfg_key_logfile_async},
+  {"logfile_async_ratelimit", cfg_key_logfile_async_ratelimit},
   {"pidfile", cfg_key_pidfile},
+  {"stats_shm_file", cfg_key_stats_shm_file},
+  {"stats_shm_refresh_time", cfg_key_stats_shm_refresh_time},
   {"daemonize", cfg_key_daemonize},
   {"aggregate", cfg_key_aggregate},
   {"aggregate_primitives", cfg_key_aggregate_primitives},
@@ -370,6 +374,10 @@ static const struct _dictionary_line dictionary[] = {
   {"imt_buckets", cfg_key_imt_buckets},
   {"imt_mem_pools_number", cfg_key_imt_mem_pools_number},
   {"imt_mem_pools_size", cfg_key_imt_mem_pools_size},
+  {"imt_history_bins", cfg_key_imt_history_bins},
+  {"imt_history_bin_time", cfg_key_imt_history_bin_time},
+  {"imt_index", cfg_key_imt_index},
+  {"imt_query_threads", cfg_key_imt_query_threads},
   {"sql_db", cfg_key_sql_db},
   {"sql_table", cfg_key_sql_table},
   {"sql_table_schema", cfg_key_sql_table_schema},
@@ -397,6 +405,8 @@ static const struct _dictionary_line dictionary[] = {
   {"sql_preprocess", cfg_key_sql_preprocess},
   {"sql_preprocess_type", cfg_key_sql_preprocess_type},
   {"sql_multi_values", cfg_key_sql_multi_values},
+  {"sql_prepared_statements", cfg_key_sql_prepared_statements},
+  {"sql_parallel_writers", cfg_key_sql_parallel_writers},
   {"sql_aggressive_classification", cfg_key_sql_aggressive_classification},
   {"sql_locking_style", cfg_key_sql_locking_style},
   {"sql_use_copy", cfg_key_sql_use_copy},
@@ -406,6 +416,8 @@ static const struct _dictionary_line dictionary[] = {
   {"print_cache_entries", cfg_key_print_cache_entries},
   {"print_markers", cfg_key_print_markers},
   {"print_output", cfg_key_print_output},
+  {"parquet_row_group_size", cfg_key_parquet_row_group_size},
+  {"parquet_compression", cfg_key_parquet_compression},
   {"print_output_file", cfg_key_print_output_file},
   {"print_output_file_append", cfg_key_print_output_file_append},
   {"print_output_lock_file", cfg_key_print_output_lock_file},
@@ -440,6 +452,7 @@ static const struct _dictionary_line dictionary[] = {
   {"mongo_num_protos", cfg_key_num_protos},
   {"avro_buffer_size", cfg_key_avro_buffer_size},
   {"avro_schema_output_file", cfg_key_avro_schema_output_file},
+  {"avro_container", cfg_key_avro_container},
   {"amqp_refresh_time", cfg_key_sql_refresh_time},
   {"amqp_history", cfg_key_sql_history},
   {"amqp_history_offset", cfg_key_sql_history_offset},
@@ -461,6 +474,9 @@ static const struct _dictionary_line dictionary[] = {
   {"amqp_startup_delay", cfg_key_sql_startup_delay},
   {"amqp_heartbeat_interval", cfg_key_amqp_heartbeat_interval},
   {"amqp_multi_values", cfg_key_sql_multi_values},
+  {"amqp_multi_values_format", cfg_key_message_broker_mv_format},
+  {"amqp_multi_values_bytes", cfg_key_message_broker_mv_bytes},
+  {"amqp_multi_values_compress", cfg_key_message_broker_mv_compress},
   {"amqp_num_protos", cfg_key_num_protos},
   {"amqp_vhost", cfg_key_amqp_vhost},
   {"amqp_markers", cfg_key_print_markers},
@@ -483,12 +499,17 @@ static const struct _dictionary_line dictionary[] = {
   {"kafka_preprocess_type", cfg_key_sql_preprocess_type},
   {"kafka_startup_delay", cfg_key_sql_startup_delay},
   {"kafka_multi_values", cfg_key_sql_multi_values},
+  {"kafka_multi_values_format", cfg_key_message_broker_mv_format},
+  {"kafka_multi_values_bytes", cfg_key_message_broker_mv_bytes},
+  {"kafka_multi_values_compress", cfg_key_message_broker_mv_compress},
   {"kafka_num_protos", cfg_key_num_protos},
   {"kafka_markers", cfg_key_print_markers},
   {"kafka_output", cfg_key_message_broker_output},
   {"kafka_avro_schema_topic", cfg_key_kafka_avro_schema_topic},
   {"kafka_avro_schema_refresh_time", cfg_key_kafka_avro_schema_refresh_time},
   {"kafka_config_file", cfg_key_kafka_config_file},
+  {"kafka_async_producer", cfg_key_kafka_async_producer},
+  {"kafka_inflight_max_bytes", cfg_key_kafka_inflight_max},
   {"nfacctd_proc_name", cfg_key_proc_name},
   {"nfacctd_port", cfg_key_nfacctd_port},
   {"nfacctd_ip", cfg_key_nfacctd_ip},
@@ -507,6 +528,7 @@ static const struct _dictionary_line dictionary[] = {
   {"nfacctd_ext_sampling_rate", cfg_key_pmacctd_ext_sampling_rate},
   {"nfacctd_renormalize", cfg_key_sfacctd_renormalize},
   {"nfacctd_disable_checks", cfg_key_nfacctd_disable_checks},
+  {"nfacctd_stats_refresh_time", cfg_key_nfacctd_stats_refresh_time},
   {"pmacctd_proc_name", cfg_key_proc_name},
   {"pmacctd_force_frag_handling", cfg_key_pmacctd_force_frag_handling},
   {"pmacctd_frag_buffer_size", cfg_key_pmacctd_frag_buffer_size},
@@ -520,6 +542,11 @@ static const struct _dictionary_line dictionary[] = {
   {"pmacctd_stitching", cfg_key_nfacctd_stitching},
   {"pmacctd_renormalize", cfg_key_sfacctd_renormalize},
   {"pmacctd_nonroot", cfg_key_pmacctd_nonroot},
+  {"pmacctd_tpacket_v3", cfg_key_pmacctd_tpacket_v3},
+  {"pmacctd_tpacket_block_size", cfg_key_pmacctd_tpacket_block_size},
+  {"pmacctd_tpacket_block_num", cfg_key_pmacctd_tpacket_block_num},
+  {"pmacctd_fanout_group", cfg_key_pmacctd_fanout_group},
+  {"pmacctd_fanout_type", cfg_key_pmacctd_fanout_type},
   {"uacctd_proc_name", cfg_key_proc_name},
   {"uacctd_force_frag_handling", cfg_key_pmacctd_force_frag_handling},
   {"uacctd_frag_buffer_size", cfg_key_pmacctd_frag_buffer_size},
@@ -537,6 +564,8 @@ static const struct _dictionary_line dictionary[] = {
   {"telemetry_daemon_ip", cfg_key_telemetry_ip},
   {"telemetry_daemon_decoder", cfg_key_telemetry_decoder},
   {"telemetry_daemon_max_peers", cfg_key_telemetry_max_peers},
+  {"telemetry_daemon_threads", cfg_key_telemetry_threads},
+  {"telemetry_daemon_queue_size", cfg_key_telemetry_queue_size},
   {"telemetry_daemon_udp_timeout", cfg_key_telemetry_udp_timeout},
   {"telemetry_daemon_allow_file", cfg_key_telemetry_allow_file},
   {"telemetry_daemon_pipe_size", cfg_key_telemetry_pipe_size},
@@ -611,6 +640,7 @@ static const struct _dictionary_line dictionary[] = {
   {"sfacctd_pipe_size", cfg_key_nfacctd_pipe_size},
   {"sfacctd_renormalize", cfg_key_sfacctd_renormalize},
   {"sfacctd_disable_checks", cfg_key_nfacctd_disable_checks},
+  {"sfacctd_stats_refresh_time", cfg_key_nfacctd_stats_refresh_time},
   {"sfacctd_mcast_groups", cfg_key_nfacctd_mcast_groups},
   {"sfacctd_stitching", cfg_key_nfacctd_stitching},
   {"sfacctd_ext_sampling_rate", cfg_key_pmacctd_ext_sampling_rate},
@@ -753,6 +783,8 @@ static const struct _dictionary_line dictionary[] = {
   {"bmp_daemon_port", cfg_key_nfacctd_bmp_port},
   {"bmp_daemon_pipe_size", cfg_key_nfacctd_bmp_pipe_size},
   {"bmp_daemon_max_peers", cfg_key_nfacctd_bmp_max_peers},
+  {"bmp_daemon_threads", cfg_key_nfacctd_bmp_threads},
+  {"bmp_daemon_queue_size", cfg_key_nfacctd_bmp_queue_size},
   {"bmp_daemon_allow_file", cfg_key_nfacctd_bmp_allow_file},
   {"bmp_daemon_ipprec", cfg_key_nfacctd_bmp_ip_precedence},
   {"bmp_daemon_batch", cfg_key_nfacctd_bmp_batch},
@@ -787,6 +819,7 @@ static const struct _dictionary_line dictionary[] = {
   {"bmp_dump_file", cfg_key_nfacctd_bmp_dump_file},
   {"bmp_dump_latest_file", cfg_key_nfacctd_bmp_dump_latest_file},
   {"bmp_dump_refresh_time", cfg_key_nfacctd_bmp_dump_refresh_time},
+  {"bmp_dump_max_events", cfg_key_nfacctd_bmp_dump_max_events},
   {"bmp_dump_amqp_host", cfg_key_nfacctd_bmp_dump_amqp_host},
   {"bmp_dump_amqp_vhost", cfg_key_nfacctd_bmp_dump_amqp_vhost},
   {"bmp_dump_amqp_user", cfg_key_nfacctd_bmp_dump_amqp_user},
@@ -823,9 +856,12 @@ static const struct _dictionary_line dictionary[] = {
 #endif
 #if defined WITH_GEOIPV2
   {"geoipv2_file", cfg_key_geoipv2_file},
+  {"geoipv2_lpm", cfg_key_geoipv2_lpm},
+  {"geoipv2_lpm_cache_entries", cfg_key_geoipv2_lpm_cache_entries},
 #endif
   {"uacctd_group", cfg_key_uacctd_group},
   {"uacctd_nl_size", cfg_key_uacctd_nl_size},
+  {"uacctd_nl_batch", cfg_key_uacctd_nl_batch},
   {"uacctd_threshold", cfg_key_uacctd_threshold},
   {"tunnel_0", cfg_key_tunnel_0},
   {"pkt_len_distrib_bins", cfg_key_pkt_len_distrib_bins},
@@ -27,7 +27,7 @@
 #define ARGS_PMTELEMETRYD "hVL:l:f:dDS:F:"
 #define ARGS_PMBGPD "hVL:l:f:dDS:F:"
 #define ARGS_PMBMPD "hVL:l:f:dDS:F:"
-#define ARGS_PMACCT "Ssc:Cetm:p:P:M:arN:n:lT:O:E:uDVUoiIx"
+#define ARGS_PMACCT "Ssc:Cetm:p:P:M:arN:n:lT:O:E:uDVUoiIxH:RG:"
 #define N_PRIMITIVES 57
 #define N_FUNCS 10 
 #define MAX_N_PLUGINS 32
@@ -38,9 +38,12 @@
 #define FOLLOW_BGP_NH_ENTRIES 32 
 #define MAX_PROTOCOL_LEN 16
 #define MAX_PKT_LEN_DISTRIB_BINS 255
+#define MAX_NFLOG_GROUPS 32
 #define MAX_PKT_LEN_DISTRIB_LEN 15
 #define DEFAULT_AVRO_SCHEMA_REFRESH_TIME 60
 #define DEFAULT_IMT_PLUGIN_SELECT_TIMEOUT 5
+#define MAX_IMT_HISTORY_BINS 4096
+#define MAX_IMT_QUERY_THREADS 64
 #define UINT32T_THRESHOLD 4290000000UL
 #define UINT64T_THRESHOLD 18446744073709551360ULL
 #define INT64T_THRESHOLD 9223372036854775807ULL
@@ -88,14 +91,15 @@
 #define PRIMITIVE_DESC_LEN	64
 
 #define MANTAINER "Paolo Lucente <paolo@pmacct.net>"
-#define PMACCTD_USAGE_HEADER "Promiscuous Mode Accounting Daemon, pmacctd 1.6.2-git"
-#define UACCTD_USAGE_HEADER "Linux NetFilter NFLOG Accounting Daemon, uacctd 1.6.2-git"
-#define PMACCT_USAGE_HEADER "pmacct, pmacct client 1.6.2-git"
-#define NFACCTD_USAGE_HEADER "NetFlow Accounting Daemon, nfacctd 1.6.2-git"
-#define SFACCTD_USAGE_HEADER "sFlow Accounting Daemon, sfacctd 1.6.2-git"
-#define PMTELEMETRYD_USAGE_HEADER "Streaming Network Telemetry Daemon, pmtelemetryd 1.6.2-git"
-#define PMBGPD_USAGE_HEADER "pmacct BGP Collector Daemon, pmbgpd 1.6.2-git"
-#define PMBMPD_USAGE_HEADER "pmacct BMP Collector Daemon, pmbmpd 1.6.2-git"
+#define PMACCT_VERSION "1.6.2-git"
+#define PMACCTD_USAGE_HEADER "Promiscuous Mode Accounting Daemon, pmacctd " PMACCT_VERSION
+#define UACCTD_USAGE_HEADER "Linux NetFilter NFLOG Accounting Daemon, uacctd " PMACCT_VERSION
+#define PMACCT_USAGE_HEADER "pmacct, pmacct client " PMACCT_VERSION
+#define NFACCTD_USAGE_HEADER "NetFlow Accounting Daemon, nfacctd " PMACCT_VERSION
+#define SFACCTD_USAGE_HEADER "sFlow Accounting Daemon, sfacctd " PMACCT_VERSION
+#define PMTELEMETRYD_USAGE_HEADER "Streaming Network Telemetry Daemon, pmtelemetryd " PMACCT_VERSION
+#define PMBGPD_USAGE_HEADER "pmacct BGP Collector Daemon, pmbgpd " PMACCT_VERSION
+#define PMBMPD_USAGE_HEADER "pmacct BMP Collector Daemon, pmbmpd " PMACCT_VERSION
 #define PMACCT_COMPILE_ARGS COMPILE_ARGS
 #ifndef TRUE
 #define TRUE 1
@@ -372,6 +376,18 @@
 #define PRINT_OUTPUT_JSON	0x00000004
 #define PRINT_OUTPUT_EVENT	0x00000008
 #define PRINT_OUTPUT_AVRO  	0x00000010
+#define PRINT_OUTPUT_PARQUET	0x00000020
+
+/* multi-values JSON message formats (amqp, kafka) */
+#define P_JSON_BATCH_ARRAY	0
+#define P_JSON_BATCH_NDJSON	1
+
+/* sql_use_copy values (pgsql): FALSE, TRUE (text) or binary */
+#define SQL_COPY_TEXT		1
+#define SQL_COPY_BINARY		2
+
+/* sql_parallel_writers: connections a cache flush is spread across */
+#define MAX_SQL_PARALLEL_WRITERS	64
 
 #define DIRECTION_UNKNOWN	0x00000000
 #define DIRECTION_IN		0x00000001
@@ -379,6 +395,12 @@
 #define DIRECTION_TAG		0x00000004
 #define DIRECTION_TAG2		0x00000008
 
+#define FANOUT_TYPE_HASH	1
+#define FANOUT_TYPE_LB		2
+#define FANOUT_TYPE_CPU		3
+#define FANOUT_TYPE_RND		4
+#define FANOUT_TYPE_QM		5
+
 #define IFINDEX_STATIC		0x00000001
 #define IFINDEX_TAG		0x00000002
 #define IFINDEX_TAG2		0x00000004
@@ -57,6 +57,7 @@ void pmc_custom_primitive_value_print(char *, int, char *, struct imt_custom_pri
 void pmc_vlen_prims_get(struct pkt_vlen_hdr_primitives *, pm_cfgreg_t, char **);
 void pmc_printf_csv_label(struct pkt_vlen_hdr_primitives *, pm_cfgreg_t, char *, char *);
 void pmc_lower_string(char *);
+void pmc_history_rate(struct pkt_data *, u_int32_t);
 
 /* vars */
 struct imt_custom_primitives pmc_custom_primitives_registry;
@@ -87,8 +88,11 @@ void usage_client(char *prog)
   printf("  -n\t<bytes | packets | flows | all> \n\tSelect the counters to print (applies to -N)\n");
   printf("  -S\tSum counters instead of returning a single counter for each request (applies to -N)\n");
   printf("  -a\tDisplay all table fields (even those currently unused)\n");
-  printf("  -c\t< src_mac | dst_mac | vlan | cos | src_host | dst_host | src_net | dst_net | src_mask | dst_mask | \n\t src_port | dst_port | tos | proto | src_as | dst_as | sum_mac | sum_host | sum_net | sum_as | \n\t sum_port | in_iface | out_iface | tag | tag2 | flows | class | std_comm | ext_comm | lrg_comm | as_path | \n\t peer_src_ip | peer_dst_ip | peer_src_as | peer_dst_as | src_as_path | src_std_comm | src_med | \n\t src_ext_comm | src_lrg_comm | src_local_pref | mpls_vpn_rd | etype | sampling_rate | pkt_len_distrib |\n\t post_nat_src_host | post_nat_dst_host | post_nat_src_port | post_nat_dst_port | nat_event |\n\t timestamp_start | timestamp_end | timestamp_arrival | mpls_label_top | mpls_label_bottom | \n\t mpls_stack_depth | label | src_host_country | dst_host_country | export_proto_seqno | \n\t export_proto_version | src_host_pocode | dst_host_pocode> \n\tSelect primitives to match (required by -N and -M)\n");
+  printf("  -c\t< src_mac | dst_mac | vlan | cos | src_host | dst_host | src_net | dst_net | src_mask | dst_mask | \n\t src_port | dst_port | tos | proto | src_as | dst_as | sum_mac | sum_host | sum_net | sum_as | \n\t sum_port | in_iface | out_iface | tag | tag2 | flows | class | std_comm | ext_comm | lrg_comm | as_path | \n\t peer_src_ip | peer_dst_ip | peer_src_as | peer_dst_as | src_as_path | src_std_comm | src_med | \n\t src_ext_comm | src_lrg_comm | src_local_pref | mpls_vpn_rd | etype | sampling_rate | pkt_len_distrib |\n\t post_nat_src_host | post_nat_dst_host | post_nat_src_port | post_nat_dst_port | nat_event |\n\t timestamp_start | timestamp_end | timestamp_arrival | mpls_label_top | mpls_label_bottom | \n\t mpls_stack_depth | label | src_host_country | dst_host_country | export_proto_seqno | \n\t export_proto_version | src_host_pocode | dst_host_pocode> \n\tSelect primitives to match (required by -N and -M); re-aggregate on them at the server (applies to -s)\n");
   printf("  -T\t<bytes | packets | flows>,[<# how many>] \n\tOutput top N statistics (applies to -M and -s)\n");
+  printf("  -G\t<bytes | packets | flows>,<min value> \n\tOutput only statistics whose counter is at least min value (applies to -s)\n");
+  printf("  -H\t<# bins> \n\tReturn counters summed up over the last N history bins (applies to -s, -M and -N; requires imt_history_bins)\n");
+  printf("  -R\tReturn per-second rates instead of totals (applies to -H)\n");
   printf("  -e\tClear statistics\n");
   printf("  -i\tShow time (in seconds) since statistics were last cleared (ie. pmacct -e)\n");
   printf("  -r\tReset counters (applies to -N and -M)\n");
@@ -719,11 +723,12 @@ int main(int argc,char **argv)
   int want_erase_last_tstamp;
   int which_counter, topN_counter, fetch_from_file, sum_counters, num_counters;
   int topN_howmany, topN_printed;
+  int want_hist_rate, thr_counter;
   int datasize;
   pm_cfgreg_t what_to_count, what_to_count_2, have_wtc;
   u_int32_t tmpnum;
   struct extra_primitives extras;
-  char *topN_howmany_ptr, *endptr;
+  char *topN_howmany_ptr, *thr_value_ptr, *endptr;
 
   /* Administrativia */
   clibuf = malloc(clibufsz);
@@ -762,6 +767,7 @@ int main(int argc,char **argv)
   which_counter = FALSE;
   topN_counter = FALSE;
   topN_howmany = FALSE;
+  thr_counter = FALSE;
   tmp_net_own_field = TRUE;
   tmp_comms_same_field = FALSE;
   sum_counters = FALSE;
@@ -773,6 +779,7 @@ int main(int argc,char **argv)
   want_output = PRINT_OUTPUT_FORMATTED;
   is_event = FALSE;
   want_tstamp_since_epoch = FALSE;
+  want_hist_rate = FALSE;
 
   PvhdrSz = sizeof(struct pkt_vlen_hdr_primitives);
   PmLabelTSz = sizeof(pm_label_t);
@@ -1150,9 +1157,34 @@ int main(int argc,char **argv)
       else if (!strcmp(tmpbuf, "flows")) topN_counter = 3;
       else printf("WARN: -T, ignoring unknown counter type: %s.\n", tmpbuf);
       break;
+    case 'G':
+      strlcpy(tmpbuf, optarg, sizeof(tmpbuf));
+      pmc_lower_string(tmpbuf);
+      thr_value_ptr = strchr(tmpbuf, ',');
+      if (thr_value_ptr) {
+	*thr_value_ptr = '\0';
+	thr_value_ptr++;
+	q.thr_value = strtoull(thr_value_ptr, &endptr, 10);
+      }
+
+      if (!strcmp(tmpbuf, "bytes")) thr_counter = 1;
+      else if (!strcmp(tmpbuf, "packets")) thr_counter = 2;
+      else if (!strcmp(tmpbuf, "flows")) thr_counter = 3;
+      else printf("WARN: -G, ignoring unknown counter type: %s.\n", tmpbuf);
+      break;
     case 'S':
       sum_counters = TRUE;
       break;
+    case 'H':
+      q.hist_bins = strtoul(optarg, &endptr, 10);
+      if (!q.hist_bins || q.hist_bins > MAX_IMT_HISTORY_BINS) {
+	printf("ERROR: -H expects a number of bins in the range 1-%u.\n  Exiting...\n\n", MAX_IMT_HISTORY_BINS);
+	exit(1);
+      }
+      break;
+    case 'R':
+      want_hist_rate = TRUE;
+      break;
     case 'M':
       if (CHECK_Q_TYPE(q.type)) print_ex_options_error();
       strlcpy(match_string, optarg, sizeof(match_string));
@@ -1317,12 +1349,44 @@ int main(int argc,char **argv)
     exit(1);
   }
 
+  if (q.hist_bins && (!want_match && !want_stats && !want_counter)) {
+    printf("ERROR: -H option applies only to -s, -M or -N\n  Exiting...\n\n");
+    usage_client(argv[0]);
+    exit(1);
+  }
+
+  if (want_hist_rate && !q.hist_bins) {
+    printf("ERROR: -R option applies only to -H\n  Exiting...\n\n");
+    usage_client(argv[0]);
+    exit(1);
+  }
+
   if (topN_counter && (!want_match && !want_stats)) {
     printf("ERROR: -T option apply only to -M or -s\n  Exiting...\n\n");
     usage_client(argv[0]);
     exit(1);
   }
 
+  if (thr_counter && !want_stats) {
+    printf("ERROR: -G option applies only to -s\n  Exiting...\n\n");
+    usage_client(argv[0]);
+    exit(1);
+  }
+
+  /* -s: re-aggregation, thresholds and top-N are carried out at the server */
+  if (want_stats) {
+    if (custom_primitives_input.num || (what_to_count_2 & COUNT_LABEL)) {
+      printf("ERROR: -s and -c are not supported (yet) against custom and variable-length primitives\n");
+      exit(1);
+    }
+
+    q.agg_what_to_count = what_to_count;
+    q.agg_what_to_count_2 = what_to_count_2;
+    q.topN_counter = topN_counter;
+    q.topN_howmany = topN_howmany;
+    q.thr_counter = thr_counter;
+  }
+
   if (want_counter || want_match) {
     char *ptr = match_string, prefix[] = "file:";
 
@@ -2025,6 +2089,14 @@ int main(int argc,char **argv)
     memcpy(&extras, &((struct query_header *)largebuf)->extras, sizeof(struct extra_primitives));
     if (check_data_sizes((struct query_header *)largebuf, acc_elem)) exit(1);
 
+    /* custom primitives are not part of re-aggregated replies */
+    if (!extras.off_custom_primitives) memset(&pmc_custom_primitives_registry, 0, sizeof(pmc_custom_primitives_registry));
+
+    if (q.hist_bins && !((struct query_header *)largebuf)->hist_bins) {
+      printf("ERROR: history is not enabled at the server (imt_history_bins)\n");
+      exit(1);
+    }
+
     /* Before going on with the output, we need to retrieve the class strings
        from the server */
     if (what_to_count & COUNT_CLASS && !class_table) {
@@ -2113,7 +2185,7 @@ int main(int argc,char **argv)
     acc_elem = (struct pkt_data *) elem;
 
     topN_printed = 0;
-    if (topN_counter) {
+    if (topN_counter && !want_stats) {
       int num = unpacked/datasize;
 
       client_counters_merge_sort((void *)acc_elem, 0, num, datasize, topN_counter);
@@ -2124,6 +2196,7 @@ int main(int argc,char **argv)
 
       topN_printed++;
       acc_elem = (struct pkt_data *) elem;
+      if (want_hist_rate) pmc_history_rate(acc_elem, ((struct query_header *)largebuf)->hist_span);
 
       if (extras.off_pkt_bgp_primitives) pbgp = (struct pkt_bgp_primitives *) ((u_char *)elem + extras.off_pkt_bgp_primitives);
       else pbgp = &empty_pbgp;
@@ -2847,8 +2920,13 @@ int main(int argc,char **argv)
 
     base = largebuf+sizeof(struct query_header);
     if (check_data_sizes((struct query_header *)largebuf, acc_elem)) exit(1);
+    if (q.hist_bins && !((struct query_header *)largebuf)->hist_bins) {
+      printf("ERROR: history is not enabled at the server (imt_history_bins)\n");
+      exit(1);
+    }
     acc_elem = (struct pkt_data *) base;
     for (printed = sizeof(struct query_header); printed < unpacked; printed += sizeof(struct pkt_data), acc_elem++) {
+      if (want_hist_rate) pmc_history_rate(acc_elem, ((struct query_header *)largebuf)->hist_span);
       if (sum_counters) {
 	pcnt += acc_elem->pkt_num;
 	fcnt += acc_elem->flo_num;
@@ -4078,3 +4156,12 @@ void pmc_lower_string(char *string)
     i++;
   }
 }
+
+void pmc_history_rate(struct pkt_data *data, u_int32_t span)
+{
+  if (!span) return;
+
+  data->pkt_len /= span;
+  data->pkt_num /= span;
+  data->flo_num /= span;
+}
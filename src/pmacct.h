@@ -217,6 +217,11 @@ typedef struct {
 #include "cfg.h"
 #include "util.h"
 #include "xflow_status.h"
+#include "stats_shm.h"
+#include "parquet_common.h"
+#ifdef WITH_AVRO
+#include "avro_common.h"
+#endif
 #include "log.h"
 #include "once.h"
 #include "mpls.h"
@@ -36,6 +36,7 @@
 #include "bgp/bgp.h"
 #include "classifier.h"
 #include "isis/isis.h"
+#include "tpacket.h"
 
 /* variables to be exported away */
 struct channels_list_entry channels_list[MAX_N_PLUGINS]; /* communication channels: core <-> plugins */
@@ -91,6 +92,7 @@ int main(int argc,char **argv, char **envp)
 {
   bpf_u_int32 localnet, netmask;  /* pcap library stuff */
   struct bpf_program filter;
+  int filter_set = FALSE;
   struct pcap_device device;
   char errbuf[PCAP_ERRBUF_SIZE];
   int index, logf, ret;
@@ -106,6 +108,8 @@ int main(int argc,char **argv, char **envp)
   struct id_table biss_table;
   struct id_table bta_table;
   struct pcap_callback_data cb_data;
+  struct tpacket_v3_ring tpacket_ring;
+  int capture_fd;
 
   /* getopt() stuff */
   extern char *optarg;
@@ -155,6 +159,7 @@ int main(int argc,char **argv, char **envp)
   memset(&bta_table, 0, sizeof(bta_table));
   memset(&client, 0, sizeof(client));
   memset(&cb_data, 0, sizeof(cb_data));
+  memset(&tpacket_ring, 0, sizeof(tpacket_ring));
   memset(&tunnel_registry, 0, sizeof(tunnel_registry));
   memset(&reload_map_tstamp, 0, sizeof(reload_map_tstamp));
   log_notifications_init(&log_notifications);
@@ -162,6 +167,7 @@ int main(int argc,char **argv, char **envp)
 
   rows = 0;
   glob_pcapt = NULL;
+  glob_tpacket_ring = NULL;
 
   /* getting commandline values */
   while (!errflag && ((cp = getopt(argc, argv, ARGS_PMACCTD)) != -1)) {
@@ -668,7 +674,52 @@ int main(int argc,char **argv, char **envp)
     exit_all(1); 
   }
 
+  if (config.pmacctd_tpacket_v3) {
+#if defined (HAVE_TPACKET_V3)
+    if (config.pcap_savefile) {
+      Log(LOG_ERR, "ERROR ( %s/core ): 'pmacctd_tpacket_v3' and 'pcap_savefile' (-I) directives are mutually exclusive. Exiting.\n", config.name);
+      exit_all(1);
+    }
+#else
+    Log(LOG_ERR, "ERROR ( %s/core ): 'pmacctd_tpacket_v3' is not supported on this platform. Exiting.\n", config.name);
+    exit_all(1);
+#endif
+  }
+
+#if !defined (PCAP_TYPE_linux) || !defined (PACKET_FANOUT)
+  if (config.pmacctd_fanout_group) {
+    Log(LOG_ERR, "ERROR ( %s/core ): 'pmacctd_fanout_group' is not supported on this platform. Exiting.\n", config.name);
+    exit_all(1);
+  }
+#endif
+
+  if (config.pmacctd_fanout_group && config.pcap_savefile) {
+    Log(LOG_ERR, "ERROR ( %s/core ): 'pmacctd_fanout_group' and 'pcap_savefile' (-I) directives are mutually exclusive. Exiting.\n", config.name);
+    exit_all(1);
+  }
+
   throttle_startup:
+#if defined (HAVE_TPACKET_V3)
+  if (config.dev && config.pmacctd_tpacket_v3) {
+    if (tpacket_v3_open(&tpacket_ring, config.dev, psize, config.promisc) == ERR) {
+      if (!config.if_wait) exit_all(1);
+      else {
+        sleep(5); /* XXX: user defined ? */
+        goto throttle_startup;
+      }
+    }
+
+    /* a dead pcap descriptor is kept around for filter compilation
+       and link type evaluation purposes */
+    if ((device.dev_desc = pcap_open_dead(tpacket_ring.link_type, psize)) == NULL) {
+      Log(LOG_ERR, "ERROR ( %s/core ): pcap_open_dead(): failed\n", config.name);
+      exit_all(1);
+    }
+
+    glob_tpacket_ring = &tpacket_ring;
+  }
+  else
+#endif
   if (config.dev) {
     if ((device.dev_desc = pcap_open_live(config.dev, psize, config.promisc, 1000, errbuf)) == NULL) {
       if (!config.if_wait) {
@@ -690,12 +741,23 @@ int main(int argc,char **argv, char **envp)
 
   device.active = TRUE;
   glob_pcapt = device.dev_desc; /* SIGINT/stats handling */ 
-  if (config.nfacctd_pipe_size) {
+
+  if (glob_tpacket_ring) capture_fd = tpacket_ring.fd;
+  else capture_fd = pcap_fileno(device.dev_desc);
+
+#if defined (PCAP_TYPE_linux) && defined (PACKET_FANOUT)
+  if (config.pmacctd_fanout_group) {
+    if (tpacket_set_fanout(capture_fd, config.pmacctd_fanout_group, config.pmacctd_fanout_type) == ERR)
+      exit_all(1);
+  }
+#endif
+
+  if (config.nfacctd_pipe_size && !glob_tpacket_ring) {
     int slen = sizeof(config.nfacctd_pipe_size), x;
 
 #if defined (PCAP_TYPE_linux) || (PCAP_TYPE_snoop)
-    Setsocksize(pcap_fileno(device.dev_desc), SOL_SOCKET, SO_RCVBUF, &config.nfacctd_pipe_size, slen);
-    getsockopt(pcap_fileno(device.dev_desc), SOL_SOCKET, SO_RCVBUF, &x, &slen);
+    Setsocksize(capture_fd, SOL_SOCKET, SO_RCVBUF, &config.nfacctd_pipe_size, slen);
+    getsockopt(capture_fd, SOL_SOCKET, SO_RCVBUF, &x, &slen);
     Log(LOG_DEBUG, "DEBUG ( %s/core ): pmacctd_pipe_size: obtained=%d target=%d.\n", config.name, x, config.nfacctd_pipe_size);
 #endif
   }
@@ -737,6 +799,15 @@ int main(int argc,char **argv, char **envp)
   if (pcap_compile(device.dev_desc, &filter, config.clbuf, 0, netmask) < 0)
     Log(LOG_WARNING, "WARN ( %s/core ): %s (going on without a filter)\n", config.name, pcap_geterr(device.dev_desc));
   else {
+    filter_set = TRUE;
+
+#if defined (HAVE_TPACKET_V3)
+    if (glob_tpacket_ring) {
+      if (tpacket_v3_setfilter(&tpacket_ring, &filter) == ERR)
+        Log(LOG_WARNING, "WARN ( %s/core ): going on without a filter\n", config.name);
+    }
+    else
+#endif
     if (pcap_setfilter(device.dev_desc, &filter) < 0)
       Log(LOG_WARNING, "WARN ( %s/core ): %s (going on without a filter)\n", config.name, pcap_geterr(device.dev_desc));
   }
@@ -872,6 +943,9 @@ int main(int argc,char **argv, char **envp)
     sleep(2);
   }
 
+  /* live statistics for external tools, if a segment is configured */
+  stats_shm_wrapper();
+
   /* Main loop: if pcap_loop() exits maybe an error occurred; we will try closing
      and reopening again our listening device */
   for(;;) {
@@ -879,13 +953,52 @@ int main(int argc,char **argv, char **envp)
       Log(LOG_WARNING, "WARN ( %s/core ): %s has become unavailable; throttling ...\n", config.name, config.dev);
       throttle_loop:
       sleep(5); /* XXX: user defined ? */
-      if ((device.dev_desc = pcap_open_live(config.dev, psize, config.promisc, 1000, errbuf)) == NULL)
-        goto throttle_loop;
-      pcap_setfilter(device.dev_desc, &filter);
+#if defined (HAVE_TPACKET_V3)
+      /* a device coming back without its filter or outside of its fanout
+         group would account for traffic it is not meant to: retry later */
+      if (glob_tpacket_ring) {
+        if (tpacket_v3_open(&tpacket_ring, config.dev, psize, config.promisc) == ERR)
+          goto throttle_loop;
+        if ((filter_set && tpacket_v3_setfilter(&tpacket_ring, &filter) == ERR) ||
+	    (config.pmacctd_fanout_group &&
+	     tpacket_set_fanout(tpacket_ring.fd, config.pmacctd_fanout_group, config.pmacctd_fanout_type) == ERR)) {
+          tpacket_v3_close(&tpacket_ring);
+          goto throttle_loop;
+        }
+      }
+      else
+#endif
+      {
+        if ((device.dev_desc = pcap_open_live(config.dev, psize, config.promisc, 1000, errbuf)) == NULL)
+          goto throttle_loop;
+        if (filter_set && pcap_setfilter(device.dev_desc, &filter) < 0) {
+          Log(LOG_WARNING, "WARN ( %s/core ): %s\n", config.name, pcap_geterr(device.dev_desc));
+          pcap_close(device.dev_desc);
+          goto throttle_loop;
+        }
+#if defined (PCAP_TYPE_linux) && defined (PACKET_FANOUT)
+        if (config.pmacctd_fanout_group &&
+	    tpacket_set_fanout(pcap_fileno(device.dev_desc), config.pmacctd_fanout_group, config.pmacctd_fanout_type) == ERR) {
+          pcap_close(device.dev_desc);
+          goto throttle_loop;
+        }
+#endif
+        glob_pcapt = device.dev_desc;
+      }
       device.active = TRUE;
     }
-    pcap_loop(device.dev_desc, -1, pcap_cb, (u_char *) &cb_data);
-    pcap_close(device.dev_desc);
+
+#if defined (HAVE_TPACKET_V3)
+    if (glob_tpacket_ring) {
+      tpacket_v3_loop(&tpacket_ring, pcap_cb, (u_char *) &cb_data);
+      tpacket_v3_close(&tpacket_ring);
+    }
+    else
+#endif
+    {
+      pcap_loop(device.dev_desc, -1, pcap_cb, (u_char *) &cb_data);
+      pcap_close(device.dev_desc);
+    }
 
     if (config.pcap_savefile) {
       if (config.sf_wait) {
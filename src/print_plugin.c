@@ -108,9 +108,27 @@ void print_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
 
       close_output_file(avro_fp);
     }
+
+    /* records go through the Avro file writer: the encoder buffer is unused */
+    p_avro_encoder_init(&avro_acct_enc, avro_acct_schema, 0, FALSE);
   }
 #endif
 
+  if (config.print_output & PRINT_OUTPUT_PARQUET) {
+    if (!config.sql_table) {
+      Log(LOG_ERR, "ERROR ( %s/%s ): PARQUET: print_output set to parquet requires print_output_file. Exiting ..\n", config.name, config.type);
+      exit_plugin(1);
+    }
+
+    if (config.print_output_file_append) {
+      Log(LOG_WARNING, "WARN ( %s/%s ): PARQUET: print_output_file_append is not supported. Disabling.\n", config.name, config.type);
+      config.print_output_file_append = FALSE;
+    }
+
+    p_parquet_writer_init(&parquet_acct_writer, config.parquet_row_group_size, config.parquet_compression);
+    P_parquet_init_schema(&parquet_acct_writer);
+  }
+
   /* setting function pointers */
   if (config.what_to_count & (COUNT_SUM_HOST|COUNT_SUM_NET))
     insert_func = P_sum_host_insert;
@@ -307,6 +325,7 @@ void print_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
         pollagain = FALSE;
         memcpy(pipebuf, rg->ptr, bufsz);
         rg->ptr += bufsz;
+        stats_shm_update_ring_rd(((struct ch_buf_hdr *) pipebuf)->seq);
       }
 #ifdef WITH_RABBITMQ
       else if (config.pipe_amqp) {
@@ -496,6 +515,17 @@ void P_cache_purge(struct chained_cache *queue[], int index)
     }
 
     if (f) {
+      if (config.print_output & PRINT_OUTPUT_PARQUET) {
+        if (p_parquet_writer_open(&parquet_acct_writer, f) == ERR) {
+          Log(LOG_ERR, "ERROR ( %s/%s ): PARQUET: failed opening %s. Purge aborted.\n", config.name, config.type, current_table);
+          p_parquet_writer_abort(&parquet_acct_writer);
+          close_output_file(f);
+          if (fd_buf) free(fd_buf);
+          if (empty_pcust) free(empty_pcust);
+          return;
+        }
+      }
+
       if (config.print_markers) {
 	if ((config.print_output & PRINT_OUTPUT_CSV) || (config.print_output & PRINT_OUTPUT_FORMATTED))
 	  fprintf(f, "--START (%u)--\n", writer_pid);
@@ -1280,17 +1310,27 @@ void P_cache_purge(struct chained_cache *queue[], int index)
   
         if (json_obj) write_and_free_json(f, json_obj);
       }
+      else if (f && config.print_output & PRINT_OUTPUT_PARQUET) {
+        if (P_parquet_write_entry(&parquet_acct_writer, queue[j], pbgp, pnat, pmpls, pcust, pvlen, start) == ERR) {
+          Log(LOG_ERR, "ERROR ( %s/%s ): PARQUET: failed writing %s. Purge aborted.\n", config.name, config.type, current_table);
+          p_parquet_writer_abort(&parquet_acct_writer);
+          close_output_file(f);
+          if (fd_buf) free(fd_buf);
+          if (empty_pcust) free(empty_pcust);
+          return;
+        }
+      }
       else if (f && config.print_output & PRINT_OUTPUT_AVRO) {
 #ifdef WITH_AVRO
-        avro_value_iface_t *avro_iface = avro_generic_class_from_schema(avro_acct_schema);
+        avro_value_t *avro_value = p_avro_encoder_value(&avro_acct_enc);
 
-        avro_value_t avro_value = compose_avro(config.what_to_count, config.what_to_count_2, queue[j]->flow_type,
+        compose_avro_value(config.what_to_count, config.what_to_count_2, queue[j]->flow_type,
                          &queue[j]->primitives, pbgp, pnat, pmpls, pcust, pvlen, queue[j]->bytes_counter,
                          queue[j]->packet_counter, queue[j]->flow_counter, queue[j]->tcp_flags, NULL,
-                         queue[j]->stitch, avro_iface);
+                         queue[j]->stitch, avro_value);
 
         if (config.sql_table) {
-          if (avro_file_writer_append_value(avro_writer, &avro_value)) {
+          if (avro_file_writer_append_value(avro_writer, avro_value)) {
             Log(LOG_ERR, "ERROR ( %s/%s ): AVRO: failed writing the value: %s\n",
                 config.name, config.type, avro_strerror());
             exit_plugin(1);
@@ -1299,7 +1339,7 @@ void P_cache_purge(struct chained_cache *queue[], int index)
         else {
           char *json_str;
 
-          if (avro_value_to_json(&avro_value, TRUE, &json_str)) {
+          if (avro_value_to_json(avro_value, TRUE, &json_str)) {
             Log(LOG_ERR, "ERROR ( %s/%s ): AVRO: unable to value to JSON: %s\n",
                 config.name, config.type, avro_strerror());
             exit_plugin(1);
@@ -1308,9 +1348,6 @@ void P_cache_purge(struct chained_cache *queue[], int index)
           fprintf(f, "%s\n", json_str);
           free(json_str);
         }
-
-        avro_value_iface_decref(avro_iface);
-        avro_value_decref(&avro_value);
 #else
         if (config.debug) Log(LOG_DEBUG, "DEBUG ( %s/%s ): compose_avro(): AVRO object not created due to missing --enable-avro\n", config.name, config.type);
 #endif
@@ -1337,6 +1374,11 @@ void P_cache_purge(struct chained_cache *queue[], int index)
       avro_file_writer_flush(avro_writer);
 #endif
 
+    if (f && config.print_output & PRINT_OUTPUT_PARQUET) {
+      if (p_parquet_writer_close(&parquet_acct_writer) == ERR)
+        Log(LOG_ERR, "ERROR ( %s/%s ): PARQUET: failed writing %s\n", config.name, config.type, current_table);
+    }
+
     if (config.print_latest_file) {
       memset(tmpbuf, 0, LONGLONGSRVBUFLEN);
       handle_dynname_internal_strings(tmpbuf, LONGSRVBUFLEN, config.print_latest_file, &prim_ptrs);
@@ -1603,3 +1645,241 @@ void P_fprintf_csv_string(FILE *f, struct pkt_vlen_hdr_primitives *pvlen, pm_cfg
   if (!string_ptr) string_ptr = empty_string;
   fprintf(f, "%s%s", sep, string_ptr);
 }
+
+/*
+   Columns are declared in the same order in which P_parquet_write_entry()
+   fills them in: the two functions must be kept in sync. Low-cardinality
+   primitives are hinted for dictionary encoding (the writer falls back to
+   plain encoding per row group if there are too many distinct values);
+   timestamps, sequence numbers and counters are delta encoded.
+*/
+void P_parquet_init_schema(struct p_parquet_writer *w)
+{
+  int cp_idx;
+
+  if (config.what_to_count & COUNT_TAG) p_parquet_add_column(w, "tag", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & COUNT_TAG2) p_parquet_add_column(w, "tag2", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count_2 & COUNT_LABEL) p_parquet_add_column(w, "label", PM_PARQUET_BYTE_ARRAY, PM_PARQUET_CT_UTF8, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & COUNT_CLASS) p_parquet_add_column(w, "class", PM_PARQUET_BYTE_ARRAY, PM_PARQUET_CT_UTF8, PM_PARQUET_HINT_DICT);
+#if defined (HAVE_L2)
+  if (config.what_to_count & (COUNT_SRC_MAC|COUNT_SUM_MAC)) p_parquet_add_column(w, "mac_src", PM_PARQUET_BYTE_ARRAY, PM_PARQUET_CT_UTF8, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & COUNT_DST_MAC) p_parquet_add_column(w, "mac_dst", PM_PARQUET_BYTE_ARRAY, PM_PARQUET_CT_UTF8, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & COUNT_VLAN) p_parquet_add_column(w, "vlan", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & COUNT_COS) p_parquet_add_column(w, "cos", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & COUNT_ETHERTYPE) p_parquet_add_column(w, "etype", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DICT);
+#endif
+  if (config.what_to_count & (COUNT_SRC_AS|COUNT_SUM_AS)) p_parquet_add_column(w, "as_src", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & COUNT_DST_AS) p_parquet_add_column(w, "as_dst", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & COUNT_STD_COMM) p_parquet_add_column(w, "comms", PM_PARQUET_BYTE_ARRAY, PM_PARQUET_CT_UTF8, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & COUNT_EXT_COMM) p_parquet_add_column(w, "ecomms", PM_PARQUET_BYTE_ARRAY, PM_PARQUET_CT_UTF8, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count_2 & COUNT_LRG_COMM) p_parquet_add_column(w, "lcomms", PM_PARQUET_BYTE_ARRAY, PM_PARQUET_CT_UTF8, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & COUNT_SRC_STD_COMM) p_parquet_add_column(w, "src_comms", PM_PARQUET_BYTE_ARRAY, PM_PARQUET_CT_UTF8, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & COUNT_SRC_EXT_COMM) p_parquet_add_column(w, "src_ecomms", PM_PARQUET_BYTE_ARRAY, PM_PARQUET_CT_UTF8, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count_2 & COUNT_SRC_LRG_COMM) p_parquet_add_column(w, "src_lcomms", PM_PARQUET_BYTE_ARRAY, PM_PARQUET_CT_UTF8, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & COUNT_AS_PATH) p_parquet_add_column(w, "as_path", PM_PARQUET_BYTE_ARRAY, PM_PARQUET_CT_UTF8, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & COUNT_SRC_AS_PATH) p_parquet_add_column(w, "src_as_path", PM_PARQUET_BYTE_ARRAY, PM_PARQUET_CT_UTF8, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & COUNT_LOCAL_PREF) p_parquet_add_column(w, "local_pref", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & COUNT_SRC_LOCAL_PREF) p_parquet_add_column(w, "src_local_pref", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & COUNT_MED) p_parquet_add_column(w, "med", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & COUNT_SRC_MED) p_parquet_add_column(w, "src_med", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & COUNT_PEER_SRC_AS) p_parquet_add_column(w, "peer_as_src", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & COUNT_PEER_DST_AS) p_parquet_add_column(w, "peer_as_dst", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & COUNT_PEER_SRC_IP) p_parquet_add_column(w, "peer_ip_src", PM_PARQUET_BYTE_ARRAY, PM_PARQUET_CT_UTF8, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & COUNT_PEER_DST_IP) p_parquet_add_column(w, "peer_ip_dst", PM_PARQUET_BYTE_ARRAY, PM_PARQUET_CT_UTF8, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & COUNT_IN_IFACE) p_parquet_add_column(w, "iface_in", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & COUNT_OUT_IFACE) p_parquet_add_column(w, "iface_out", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & COUNT_MPLS_VPN_RD) p_parquet_add_column(w, "mpls_vpn_rd", PM_PARQUET_BYTE_ARRAY, PM_PARQUET_CT_UTF8, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & (COUNT_SRC_HOST|COUNT_SUM_HOST)) p_parquet_add_column(w, "ip_src", PM_PARQUET_BYTE_ARRAY, PM_PARQUET_CT_UTF8, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & (COUNT_SRC_NET|COUNT_SUM_NET)) p_parquet_add_column(w, "net_src", PM_PARQUET_BYTE_ARRAY, PM_PARQUET_CT_UTF8, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & COUNT_DST_HOST) p_parquet_add_column(w, "ip_dst", PM_PARQUET_BYTE_ARRAY, PM_PARQUET_CT_UTF8, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & COUNT_DST_NET) p_parquet_add_column(w, "net_dst", PM_PARQUET_BYTE_ARRAY, PM_PARQUET_CT_UTF8, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & COUNT_SRC_NMASK) p_parquet_add_column(w, "mask_src", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & COUNT_DST_NMASK) p_parquet_add_column(w, "mask_dst", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & (COUNT_SRC_PORT|COUNT_SUM_PORT)) p_parquet_add_column(w, "port_src", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & COUNT_DST_PORT) p_parquet_add_column(w, "port_dst", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & COUNT_TCPFLAGS) p_parquet_add_column(w, "tcp_flags", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count & COUNT_IP_PROTO) {
+    if (!config.num_protos) p_parquet_add_column(w, "ip_proto", PM_PARQUET_BYTE_ARRAY, PM_PARQUET_CT_UTF8, PM_PARQUET_HINT_DICT);
+    else p_parquet_add_column(w, "ip_proto", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DICT);
+  }
+  if (config.what_to_count & COUNT_IP_TOS) p_parquet_add_column(w, "tos", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DICT);
+#if defined (WITH_GEOIP) || defined (WITH_GEOIPV2)
+  if (config.what_to_count_2 & COUNT_SRC_HOST_COUNTRY) p_parquet_add_column(w, "country_ip_src", PM_PARQUET_BYTE_ARRAY, PM_PARQUET_CT_UTF8, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count_2 & COUNT_DST_HOST_COUNTRY) p_parquet_add_column(w, "country_ip_dst", PM_PARQUET_BYTE_ARRAY, PM_PARQUET_CT_UTF8, PM_PARQUET_HINT_DICT);
+#endif
+#if defined (WITH_GEOIPV2)
+  if (config.what_to_count_2 & COUNT_SRC_HOST_POCODE) p_parquet_add_column(w, "pocode_ip_src", PM_PARQUET_BYTE_ARRAY, PM_PARQUET_CT_UTF8, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count_2 & COUNT_DST_HOST_POCODE) p_parquet_add_column(w, "pocode_ip_dst", PM_PARQUET_BYTE_ARRAY, PM_PARQUET_CT_UTF8, PM_PARQUET_HINT_DICT);
+#endif
+  if (config.what_to_count_2 & COUNT_SAMPLING_RATE) p_parquet_add_column(w, "sampling_rate", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count_2 & COUNT_PKT_LEN_DISTRIB) p_parquet_add_column(w, "pkt_len_distrib", PM_PARQUET_BYTE_ARRAY, PM_PARQUET_CT_UTF8, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count_2 & COUNT_POST_NAT_SRC_HOST) p_parquet_add_column(w, "post_nat_ip_src", PM_PARQUET_BYTE_ARRAY, PM_PARQUET_CT_UTF8, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count_2 & COUNT_POST_NAT_DST_HOST) p_parquet_add_column(w, "post_nat_ip_dst", PM_PARQUET_BYTE_ARRAY, PM_PARQUET_CT_UTF8, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count_2 & COUNT_POST_NAT_SRC_PORT) p_parquet_add_column(w, "post_nat_port_src", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count_2 & COUNT_POST_NAT_DST_PORT) p_parquet_add_column(w, "post_nat_port_dst", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count_2 & COUNT_NAT_EVENT) p_parquet_add_column(w, "nat_event", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count_2 & COUNT_MPLS_LABEL_TOP) p_parquet_add_column(w, "mpls_label_top", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count_2 & COUNT_MPLS_LABEL_BOTTOM) p_parquet_add_column(w, "mpls_label_bottom", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count_2 & COUNT_MPLS_STACK_DEPTH) p_parquet_add_column(w, "mpls_stack_depth", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DICT);
+  if (config.what_to_count_2 & COUNT_TIMESTAMP_START) p_parquet_add_column(w, "timestamp_start", PM_PARQUET_INT64, PM_PARQUET_CT_TIMESTAMP_MICROS, PM_PARQUET_HINT_DELTA);
+  if (config.what_to_count_2 & COUNT_TIMESTAMP_END) p_parquet_add_column(w, "timestamp_end", PM_PARQUET_INT64, PM_PARQUET_CT_TIMESTAMP_MICROS, PM_PARQUET_HINT_DELTA);
+  if (config.what_to_count_2 & COUNT_TIMESTAMP_ARRIVAL) p_parquet_add_column(w, "timestamp_arrival", PM_PARQUET_INT64, PM_PARQUET_CT_TIMESTAMP_MICROS, PM_PARQUET_HINT_DELTA);
+  if (config.nfacctd_stitching) {
+    p_parquet_add_column(w, "timestamp_min", PM_PARQUET_INT64, PM_PARQUET_CT_TIMESTAMP_MICROS, PM_PARQUET_HINT_DELTA);
+    p_parquet_add_column(w, "timestamp_max", PM_PARQUET_INT64, PM_PARQUET_CT_TIMESTAMP_MICROS, PM_PARQUET_HINT_DELTA);
+  }
+  if (config.what_to_count_2 & COUNT_EXPORT_PROTO_SEQNO) p_parquet_add_column(w, "export_proto_seqno", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DELTA);
+  if (config.what_to_count_2 & COUNT_EXPORT_PROTO_VERSION) p_parquet_add_column(w, "export_proto_version", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DICT);
+
+  for (cp_idx = 0; cp_idx < config.cpptrs.num; cp_idx++)
+    p_parquet_add_column(w, config.cpptrs.primitive[cp_idx].name, PM_PARQUET_BYTE_ARRAY, PM_PARQUET_CT_UTF8, PM_PARQUET_HINT_DICT);
+
+  if (config.sql_history) {
+    p_parquet_add_column(w, "stamp_inserted", PM_PARQUET_INT64, PM_PARQUET_CT_TIMESTAMP_MICROS, PM_PARQUET_HINT_DICT);
+    p_parquet_add_column(w, "stamp_updated", PM_PARQUET_INT64, PM_PARQUET_CT_TIMESTAMP_MICROS, PM_PARQUET_HINT_DICT);
+  }
+
+  p_parquet_add_column(w, "packets", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DELTA);
+  if (config.what_to_count & COUNT_FLOWS) p_parquet_add_column(w, "flows", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DELTA);
+  p_parquet_add_column(w, "bytes", PM_PARQUET_INT64, PM_PARQUET_CT_UINT_64, PM_PARQUET_HINT_DELTA);
+}
+
+static void P_parquet_put_vlen(struct p_parquet_writer *w, int col, struct pkt_vlen_hdr_primitives *pvlen, pm_cfgreg_t wtc)
+{
+  char *string_ptr = NULL;
+
+  vlen_prims_get(pvlen, wtc, &string_ptr);
+  p_parquet_put_string(w, col, string_ptr);
+}
+
+static void P_parquet_put_addr(struct p_parquet_writer *w, int col, struct host_addr *addr)
+{
+  char ip_address[INET6_ADDRSTRLEN];
+
+  addr_to_str(ip_address, addr);
+  p_parquet_put_string(w, col, ip_address);
+}
+
+static u_int64_t P_parquet_tstamp(struct timeval *tv)
+{
+  return ((u_int64_t) tv->tv_sec * 1000000) + tv->tv_usec;
+}
+
+int P_parquet_write_entry(struct p_parquet_writer *w, struct chained_cache *cache_elem, struct pkt_bgp_primitives *pbgp,
+			  struct pkt_nat_primitives *pnat, struct pkt_mpls_primitives *pmpls, char *pcust,
+			  struct pkt_vlen_hdr_primitives *pvlen, time_t stamp_updated)
+{
+  struct pkt_primitives *data = &cache_elem->primitives;
+  char misc_str[SRVBUFLEN];
+  int cp_idx, col = 0;
+
+  if (config.what_to_count & COUNT_TAG) p_parquet_put_int64(w, col++, data->tag);
+  if (config.what_to_count & COUNT_TAG2) p_parquet_put_int64(w, col++, data->tag2);
+  if (config.what_to_count_2 & COUNT_LABEL) P_parquet_put_vlen(w, col++, pvlen, COUNT_INT_LABEL);
+  if (config.what_to_count & COUNT_CLASS) p_parquet_put_string(w, col++, ((data->class && class[(data->class)-1].id) ? class[(data->class)-1].protocol : "unknown" ));
+#if defined (HAVE_L2)
+  if (config.what_to_count & (COUNT_SRC_MAC|COUNT_SUM_MAC)) {
+    etheraddr_string(data->eth_shost, misc_str);
+    p_parquet_put_string(w, col++, misc_str);
+  }
+  if (config.what_to_count & COUNT_DST_MAC) {
+    etheraddr_string(data->eth_dhost, misc_str);
+    p_parquet_put_string(w, col++, misc_str);
+  }
+  if (config.what_to_count & COUNT_VLAN) p_parquet_put_int64(w, col++, data->vlan_id);
+  if (config.what_to_count & COUNT_COS) p_parquet_put_int64(w, col++, data->cos);
+  if (config.what_to_count & COUNT_ETHERTYPE) p_parquet_put_int64(w, col++, data->etype);
+#endif
+  if (config.what_to_count & (COUNT_SRC_AS|COUNT_SUM_AS)) p_parquet_put_int64(w, col++, data->src_as);
+  if (config.what_to_count & COUNT_DST_AS) p_parquet_put_int64(w, col++, data->dst_as);
+  if (config.what_to_count & COUNT_STD_COMM) P_parquet_put_vlen(w, col++, pvlen, COUNT_INT_STD_COMM);
+  if (config.what_to_count & COUNT_EXT_COMM) P_parquet_put_vlen(w, col++, pvlen, COUNT_INT_EXT_COMM);
+  if (config.what_to_count_2 & COUNT_LRG_COMM) P_parquet_put_vlen(w, col++, pvlen, COUNT_INT_LRG_COMM);
+  if (config.what_to_count & COUNT_SRC_STD_COMM) P_parquet_put_vlen(w, col++, pvlen, COUNT_INT_SRC_STD_COMM);
+  if (config.what_to_count & COUNT_SRC_EXT_COMM) P_parquet_put_vlen(w, col++, pvlen, COUNT_INT_SRC_EXT_COMM);
+  if (config.what_to_count_2 & COUNT_SRC_LRG_COMM) P_parquet_put_vlen(w, col++, pvlen, COUNT_INT_SRC_LRG_COMM);
+  if (config.what_to_count & COUNT_AS_PATH) P_parquet_put_vlen(w, col++, pvlen, COUNT_INT_AS_PATH);
+  if (config.what_to_count & COUNT_SRC_AS_PATH) P_parquet_put_vlen(w, col++, pvlen, COUNT_INT_SRC_AS_PATH);
+  if (config.what_to_count & COUNT_LOCAL_PREF) p_parquet_put_int64(w, col++, pbgp->local_pref);
+  if (config.what_to_count & COUNT_SRC_LOCAL_PREF) p_parquet_put_int64(w, col++, pbgp->src_local_pref);
+  if (config.what_to_count & COUNT_MED) p_parquet_put_int64(w, col++, pbgp->med);
+  if (config.what_to_count & COUNT_SRC_MED) p_parquet_put_int64(w, col++, pbgp->src_med);
+  if (config.what_to_count & COUNT_PEER_SRC_AS) p_parquet_put_int64(w, col++, pbgp->peer_src_as);
+  if (config.what_to_count & COUNT_PEER_DST_AS) p_parquet_put_int64(w, col++, pbgp->peer_dst_as);
+  if (config.what_to_count & COUNT_PEER_SRC_IP) P_parquet_put_addr(w, col++, &pbgp->peer_src_ip);
+  if (config.what_to_count & COUNT_PEER_DST_IP) P_parquet_put_addr(w, col++, &pbgp->peer_dst_ip);
+  if (config.what_to_count & COUNT_IN_IFACE) p_parquet_put_int64(w, col++, data->ifindex_in);
+  if (config.what_to_count & COUNT_OUT_IFACE) p_parquet_put_int64(w, col++, data->ifindex_out);
+  if (config.what_to_count & COUNT_MPLS_VPN_RD) {
+    bgp_rd2str(misc_str, &pbgp->mpls_vpn_rd);
+    p_parquet_put_string(w, col++, misc_str);
+  }
+  if (config.what_to_count & (COUNT_SRC_HOST|COUNT_SUM_HOST)) P_parquet_put_addr(w, col++, &data->src_ip);
+  if (config.what_to_count & (COUNT_SRC_NET|COUNT_SUM_NET)) P_parquet_put_addr(w, col++, &data->src_net);
+  if (config.what_to_count & COUNT_DST_HOST) P_parquet_put_addr(w, col++, &data->dst_ip);
+  if (config.what_to_count & COUNT_DST_NET) P_parquet_put_addr(w, col++, &data->dst_net);
+  if (config.what_to_count & COUNT_SRC_NMASK) p_parquet_put_int64(w, col++, data->src_nmask);
+  if (config.what_to_count & COUNT_DST_NMASK) p_parquet_put_int64(w, col++, data->dst_nmask);
+  if (config.what_to_count & (COUNT_SRC_PORT|COUNT_SUM_PORT)) p_parquet_put_int64(w, col++, data->src_port);
+  if (config.what_to_count & COUNT_DST_PORT) p_parquet_put_int64(w, col++, data->dst_port);
+  if (config.what_to_count & COUNT_TCPFLAGS) p_parquet_put_int64(w, col++, cache_elem->tcp_flags);
+  if (config.what_to_count & COUNT_IP_PROTO) {
+    if (!config.num_protos) {
+      if (data->proto < protocols_number) p_parquet_put_string(w, col++, (char *) _protocols[data->proto].name);
+      else {
+        snprintf(misc_str, SRVBUFLEN, "%u", data->proto);
+        p_parquet_put_string(w, col++, misc_str);
+      }
+    }
+    else p_parquet_put_int64(w, col++, data->proto);
+  }
+  if (config.what_to_count & COUNT_IP_TOS) p_parquet_put_int64(w, col++, data->tos);
+#if defined (WITH_GEOIP)
+  if (config.what_to_count_2 & COUNT_SRC_HOST_COUNTRY) p_parquet_put_string(w, col++, (data->src_ip_country.id > 0) ? (char *) GeoIP_code_by_id(data->src_ip_country.id) : NULL);
+  if (config.what_to_count_2 & COUNT_DST_HOST_COUNTRY) p_parquet_put_string(w, col++, (data->dst_ip_country.id > 0) ? (char *) GeoIP_code_by_id(data->dst_ip_country.id) : NULL);
+#endif
+#if defined (WITH_GEOIPV2)
+  if (config.what_to_count_2 & COUNT_SRC_HOST_COUNTRY) p_parquet_put_string(w, col++, data->src_ip_country.str);
+  if (config.what_to_count_2 & COUNT_DST_HOST_COUNTRY) p_parquet_put_string(w, col++, data->dst_ip_country.str);
+  if (config.what_to_count_2 & COUNT_SRC_HOST_POCODE) p_parquet_put_string(w, col++, data->src_ip_pocode.str);
+  if (config.what_to_count_2 & COUNT_DST_HOST_POCODE) p_parquet_put_string(w, col++, data->dst_ip_pocode.str);
+#endif
+  if (config.what_to_count_2 & COUNT_SAMPLING_RATE) p_parquet_put_int64(w, col++, data->sampling_rate);
+  if (config.what_to_count_2 & COUNT_PKT_LEN_DISTRIB) p_parquet_put_string(w, col++, config.pkt_len_distrib_bins[data->pkt_len_distrib]);
+  if (config.what_to_count_2 & COUNT_POST_NAT_SRC_HOST) P_parquet_put_addr(w, col++, &pnat->post_nat_src_ip);
+  if (config.what_to_count_2 & COUNT_POST_NAT_DST_HOST) P_parquet_put_addr(w, col++, &pnat->post_nat_dst_ip);
+  if (config.what_to_count_2 & COUNT_POST_NAT_SRC_PORT) p_parquet_put_int64(w, col++, pnat->post_nat_src_port);
+  if (config.what_to_count_2 & COUNT_POST_NAT_DST_PORT) p_parquet_put_int64(w, col++, pnat->post_nat_dst_port);
+  if (config.what_to_count_2 & COUNT_NAT_EVENT) p_parquet_put_int64(w, col++, pnat->nat_event);
+  if (config.what_to_count_2 & COUNT_MPLS_LABEL_TOP) p_parquet_put_int64(w, col++, pmpls->mpls_label_top);
+  if (config.what_to_count_2 & COUNT_MPLS_LABEL_BOTTOM) p_parquet_put_int64(w, col++, pmpls->mpls_label_bottom);
+  if (config.what_to_count_2 & COUNT_MPLS_STACK_DEPTH) p_parquet_put_int64(w, col++, pmpls->mpls_stack_depth);
+  if (config.what_to_count_2 & COUNT_TIMESTAMP_START) p_parquet_put_int64(w, col++, P_parquet_tstamp(&pnat->timestamp_start));
+  if (config.what_to_count_2 & COUNT_TIMESTAMP_END) p_parquet_put_int64(w, col++, P_parquet_tstamp(&pnat->timestamp_end));
+  if (config.what_to_count_2 & COUNT_TIMESTAMP_ARRIVAL) p_parquet_put_int64(w, col++, P_parquet_tstamp(&pnat->timestamp_arrival));
+  if (config.nfacctd_stitching) {
+    p_parquet_put_int64(w, col++, cache_elem->stitch ? P_parquet_tstamp(&cache_elem->stitch->timestamp_min) : 0);
+    p_parquet_put_int64(w, col++, cache_elem->stitch ? P_parquet_tstamp(&cache_elem->stitch->timestamp_max) : 0);
+  }
+  if (config.what_to_count_2 & COUNT_EXPORT_PROTO_SEQNO) p_parquet_put_int64(w, col++, data->export_proto_seqno);
+  if (config.what_to_count_2 & COUNT_EXPORT_PROTO_VERSION) p_parquet_put_int64(w, col++, data->export_proto_version);
+
+  for (cp_idx = 0; cp_idx < config.cpptrs.num; cp_idx++) {
+    if (config.cpptrs.primitive[cp_idx].ptr->len != PM_VARIABLE_LENGTH) {
+      custom_primitive_value_print(misc_str, SRVBUFLEN, pcust, &config.cpptrs.primitive[cp_idx], FALSE);
+      p_parquet_put_string(w, col++, misc_str);
+    }
+    else P_parquet_put_vlen(w, col++, pvlen, config.cpptrs.primitive[cp_idx].ptr->type);
+  }
+
+  if (config.sql_history) {
+    p_parquet_put_int64(w, col++, (u_int64_t) cache_elem->basetime.tv_sec * 1000000);
+    p_parquet_put_int64(w, col++, (u_int64_t) stamp_updated * 1000000);
+  }
+
+  p_parquet_put_int64(w, col++, cache_elem->packet_counter);
+  if (config.what_to_count & COUNT_FLOWS) p_parquet_put_int64(w, col++, cache_elem->flow_counter);
+  p_parquet_put_int64(w, col++, cache_elem->bytes_counter);
+
+  return p_parquet_end_row(w);
+}
@@ -33,6 +33,10 @@ EXT void P_cache_purge(struct chained_cache *[], int);
 EXT void P_write_stats_header_formatted(FILE *, int);
 EXT void P_write_stats_header_csv(FILE *, int);
 EXT void P_fprintf_csv_string(FILE *, struct pkt_vlen_hdr_primitives *, pm_cfgreg_t, char *, char *);
+EXT void P_parquet_init_schema(struct p_parquet_writer *);
+EXT int P_parquet_write_entry(struct p_parquet_writer *, struct chained_cache *, struct pkt_bgp_primitives *,
+				struct pkt_nat_primitives *, struct pkt_mpls_primitives *, char *,
+				struct pkt_vlen_hdr_primitives *, time_t);
 #undef EXT
 
 /* global variables */
@@ -42,8 +46,10 @@ EXT void P_fprintf_csv_string(FILE *, struct pkt_vlen_hdr_primitives *, pm_cfgre
 #define EXT
 #endif
 EXT int print_output_stdout_header;
+EXT struct p_parquet_writer parquet_acct_writer;
 
 #ifdef WITH_AVRO
 EXT avro_schema_t avro_acct_schema;
+EXT struct p_avro_encoder avro_acct_enc;
 #endif
 #undef EXT
@@ -28,6 +28,10 @@
 #include "classifier.h"
 #include "bgp/bgp_packet.h"
 #include "bgp/bgp.h"
+#include "crc32.h"
+#if defined ENABLE_THREADS
+#include "thread_pool.h"
+#endif
 
 /* functions */
 int build_query_server(char *path_ptr)
@@ -65,7 +69,8 @@ int build_query_server(char *path_ptr)
 
 void process_query_data(int sd, unsigned char *buf, int len, struct extra_primitives *extras, int datasize, int forked)
 {
-  struct acc *acc_elem = 0, tmpbuf;
+  struct acc *acc_elem = 0, *out_elem, hist_elem;
+  struct imt_history_query hq, *hqp = NULL;
   struct bucket_desc bd;
   struct query_header *q, *uq;
   struct query_entry request;
@@ -157,13 +162,37 @@ void process_query_data(int sd, unsigned char *buf, int len, struct extra_primit
 
   reset_counter = q->type & WANT_RESET;
 
-  if (q->type & WANT_STATS) {
+  /* history: counters are summed up over the most recent bins; if history
+     is not enabled, we reply with hist_bins set to zero and no entries */
+  if (uq->hist_bins) {
+    if (imt_history_query_init(&hq, uq->hist_bins) == SUCCESS) {
+      hqp = &hq;
+      q->hist_bins = MIN(uq->hist_bins, hist.bins);
+      q->hist_span = hq.span;
+      if (q->type & WANT_STATS) imt_history_query_sum(hqp);
+    }
+    else {
+      q->hist_bins = 0;
+      q->hist_span = 0;
+      q->type = 0;
+      send(sd, rb.buf, rb.packed, 0);
+    }
+  }
+
+  if (q->type & WANT_STATS && imt_rank_query_check(uq)) {
+    q->what_to_count = config.what_to_count;
+    q->what_to_count_2 = config.what_to_count_2;
+    imt_query_rank(sd, &rb, q, extras, hqp, datasize);
+    if (rb.packed) send(sd, rb.buf, rb.packed, 0); /* send remainder data */
+  }
+  else if (q->type & WANT_STATS) {
     q->what_to_count = config.what_to_count; 
     q->what_to_count_2 = config.what_to_count_2; 
     for (idx = 0; idx < config.buckets; idx++) {
       if (!following_chain) acc_elem = (struct acc *) elem;
-      if (!test_zero_elem(acc_elem)) {
-	enQueue_elem(sd, &rb, acc_elem, PdataSz, datasize);
+      out_elem = imt_history_view(acc_elem, hqp, &hist_elem);
+      if (out_elem) {
+	enQueue_elem(sd, &rb, out_elem, PdataSz, datasize);
 
         if (extras->off_pkt_bgp_primitives && acc_elem->pbgp) {
           enQueue_elem(sd, &rb, acc_elem->pbgp, PbgpSz, datasize - extras->off_pkt_bgp_primitives);
@@ -253,8 +282,9 @@ void process_query_data(int sd, unsigned char *buf, int len, struct extra_primit
 
         acc_elem = search_accounting_structure(&prim_ptrs);
         if (acc_elem) { 
-	  if (!test_zero_elem(acc_elem)) {
-	    enQueue_elem(sd, &rb, acc_elem, PdataSz, datasize);
+	  out_elem = imt_history_view(acc_elem, hqp, &hist_elem);
+	  if (out_elem) {
+	    enQueue_elem(sd, &rb, out_elem, PdataSz, datasize);
 
             if (extras->off_pkt_bgp_primitives && acc_elem->pbgp) {
               enQueue_elem(sd, &rb, acc_elem->pbgp, PbgpSz, datasize - extras->off_pkt_bgp_primitives);
@@ -339,69 +369,55 @@ void process_query_data(int sd, unsigned char *buf, int len, struct extra_primit
 	}
       }
       else {
-        struct pkt_primitives tbuf;  
-	struct pkt_bgp_primitives bbuf;
-	struct pkt_legacy_bgp_primitives lbbuf;
-	struct pkt_nat_primitives nbuf;
-	struct pkt_mpls_primitives mbuf;
 	struct pkt_data abuf;
+	int ix;
+
         following_chain = FALSE;
 	elem = (unsigned char *) a;
 	memset(&abuf, 0, sizeof(abuf));
 
-        for (idx = 0; idx < config.buckets; idx++) {
-          if (!following_chain) acc_elem = (struct acc *) elem;
-	  if (!test_zero_elem(acc_elem)) {
-	    /* XXX: support for custom and vlen primitives */
-	    mask_elem(&tbuf, &bbuf, &lbbuf, &nbuf, &mbuf, acc_elem, request.what_to_count, request.what_to_count_2, extras); 
-            if (!memcmp(&tbuf, &request.data, sizeof(struct pkt_primitives)) &&
-		!memcmp(&bbuf, &request.pbgp, sizeof(struct pkt_bgp_primitives)) &&
-		!memcmp(&lbbuf, &request.plbgp, sizeof(struct pkt_legacy_bgp_primitives)) &&
-		!memcmp(&nbuf, &request.pnat, sizeof(struct pkt_nat_primitives)) &&
-		!memcmp(&mbuf, &request.pmpls, sizeof(struct pkt_mpls_primitives))) {
-	      if (q->type & WANT_COUNTER) Accumulate_Counters(&abuf, acc_elem); 
-	      else {
-		enQueue_elem(sd, &rb, acc_elem, PdataSz, datasize); /* q->type == WANT_MATCH */
-
-                if (extras->off_pkt_bgp_primitives && acc_elem->pbgp) {
-                  enQueue_elem(sd, &rb, acc_elem->pbgp, PbgpSz, datasize - extras->off_pkt_bgp_primitives);
-                }
-
-                if (extras->off_pkt_lbgp_primitives) {
-                  if (acc_elem->clbgp) {
-                    struct pkt_legacy_bgp_primitives tmp_plbgp;
-
-                    cache_to_pkt_legacy_bgp_primitives(&tmp_plbgp, acc_elem->clbgp);
-                    enQueue_elem(sd, &rb, &tmp_plbgp, PlbgpSz, datasize - extras->off_pkt_lbgp_primitives);
-                  }
-                }
-
-                if (extras->off_pkt_nat_primitives && acc_elem->pnat) {
-                  enQueue_elem(sd, &rb, acc_elem->pnat, PnatSz, datasize - extras->off_pkt_nat_primitives);
-                }
-		if (extras->off_pkt_mpls_primitives && acc_elem->pmpls) {
-		  enQueue_elem(sd, &rb, acc_elem->pmpls, PmplsSz, datasize - extras->off_pkt_mpls_primitives);
-		}
-                if (extras->off_custom_primitives && acc_elem->pcust) {
-                  enQueue_elem(sd, &rb, acc_elem->pcust, config.cpptrs.len, datasize - extras->off_custom_primitives);
-                }
-		if (extras->off_pkt_vlen_hdr_primitives && acc_elem->pvlen) {
-		  enQueue_elem(sd, &rb, acc_elem->pvlen, PvhdrSz + acc_elem->pvlen->tot_len, datasize - extras->off_pkt_vlen_hdr_primitives);
-		}
-	      }
+	/* an index over one of the primitives to match narrows the walk down
+	   to a single chain of candidates; history is then summed up per hit
+	   by imt_history_view() rather than over the whole table, as this may
+	   be served in-line by the plugin */
+	if ((ix = imt_index_select(&request)) != ERR) {
+	  for (acc_elem = imt_index_lookup(ix, &request.data); acc_elem; acc_elem = acc_elem->inext[ix]) {
+	    out_elem = imt_history_view(acc_elem, hqp, &hist_elem);
+	    if (out_elem && imt_query_match(acc_elem, &request, extras)) {
+	      if (q->type & WANT_COUNTER) Accumulate_Counters(&abuf, out_elem);
+	      else enQueue_acc(sd, &rb, out_elem, extras, datasize); /* q->type == WANT_MATCH */
 	      if (reset_counter) set_reset_flag(acc_elem);
 	    }
+	  }
+	}
+#if defined ENABLE_THREADS
+	else if (config.imt_query_threads > 1) {
+	  if (hqp) imt_history_query_sum(hqp);
+	  imt_query_scan(sd, &rb, &request, hqp, extras, datasize, q->type, reset_counter, &abuf);
+	}
+#endif
+	else {
+	  if (hqp) imt_history_query_sum(hqp);
+
+          for (idx = 0; idx < config.buckets; idx++) {
+            if (!following_chain) acc_elem = (struct acc *) elem;
+	    out_elem = imt_history_view(acc_elem, hqp, &hist_elem);
+	    if (out_elem && imt_query_match(acc_elem, &request, extras)) {
+	      if (q->type & WANT_COUNTER) Accumulate_Counters(&abuf, out_elem); 
+	      else enQueue_acc(sd, &rb, out_elem, extras, datasize); /* q->type == WANT_MATCH */
+	      if (reset_counter) set_reset_flag(acc_elem);
+	    }
+            if (acc_elem->next) {
+              acc_elem = acc_elem->next;
+              following_chain = TRUE;
+              idx--;
+            }
+            else {
+              elem += sizeof(struct acc);
+              following_chain = FALSE;
+            }
           }
-          if (acc_elem->next) {
-            acc_elem = acc_elem->next;
-            following_chain = TRUE;
-            idx--;
-          }
-          else {
-            elem += sizeof(struct acc);
-            following_chain = FALSE;
-          }
-        }
+	}
 	if (q->type & WANT_COUNTER) enQueue_elem(sd, &rb, &abuf, PdataSz, PdataSz); /* enqueue accumulated data */
       }
     }
@@ -477,6 +493,7 @@ void process_query_data(int sd, unsigned char *buf, int len, struct extra_primit
 
   if (dummy_pcust) free(dummy_pcust);
   if (custbuf) free(custbuf);
+  if (hqp) imt_history_query_free(hqp);
 }
 
 void mask_elem(struct pkt_primitives *d1, struct pkt_bgp_primitives *d2, struct pkt_legacy_bgp_primitives *d5,
@@ -575,6 +592,61 @@ void mask_elem(struct pkt_primitives *d1, struct pkt_bgp_primitives *d2, struct
   }
 }
 
+/* XXX: support for custom and vlen primitives */
+int imt_query_match(struct acc *elem, struct query_entry *request, struct extra_primitives *extras)
+{
+  struct pkt_primitives tbuf;
+  struct pkt_bgp_primitives bbuf;
+  struct pkt_legacy_bgp_primitives lbbuf;
+  struct pkt_nat_primitives nbuf;
+  struct pkt_mpls_primitives mbuf;
+
+  mask_elem(&tbuf, &bbuf, &lbbuf, &nbuf, &mbuf, elem, request->what_to_count, request->what_to_count_2, extras);
+
+  if (!memcmp(&tbuf, &request->data, sizeof(struct pkt_primitives)) &&
+      !memcmp(&bbuf, &request->pbgp, sizeof(struct pkt_bgp_primitives)) &&
+      !memcmp(&lbbuf, &request->plbgp, sizeof(struct pkt_legacy_bgp_primitives)) &&
+      !memcmp(&nbuf, &request->pnat, sizeof(struct pkt_nat_primitives)) &&
+      !memcmp(&mbuf, &request->pmpls, sizeof(struct pkt_mpls_primitives))) return TRUE;
+
+  return FALSE;
+}
+
+/* enqueues an element along with its extra primitives */
+void enQueue_acc(int sd, struct reply_buffer *rb, struct acc *acc_elem, struct extra_primitives *extras, int datasize)
+{
+  enQueue_elem(sd, rb, acc_elem, PdataSz, datasize);
+
+  if (extras->off_pkt_bgp_primitives && acc_elem->pbgp) {
+    enQueue_elem(sd, rb, acc_elem->pbgp, PbgpSz, datasize - extras->off_pkt_bgp_primitives);
+  }
+
+  if (extras->off_pkt_lbgp_primitives) {
+    if (acc_elem->clbgp) {
+      struct pkt_legacy_bgp_primitives tmp_plbgp;
+
+      cache_to_pkt_legacy_bgp_primitives(&tmp_plbgp, acc_elem->clbgp);
+      enQueue_elem(sd, rb, &tmp_plbgp, PlbgpSz, datasize - extras->off_pkt_lbgp_primitives);
+    }
+  }
+
+  if (extras->off_pkt_nat_primitives && acc_elem->pnat) {
+    enQueue_elem(sd, rb, acc_elem->pnat, PnatSz, datasize - extras->off_pkt_nat_primitives);
+  }
+
+  if (extras->off_pkt_mpls_primitives && acc_elem->pmpls) {
+    enQueue_elem(sd, rb, acc_elem->pmpls, PmplsSz, datasize - extras->off_pkt_mpls_primitives);
+  }
+
+  if (extras->off_custom_primitives && acc_elem->pcust) {
+    enQueue_elem(sd, rb, acc_elem->pcust, config.cpptrs.len, datasize - extras->off_custom_primitives);
+  }
+
+  if (extras->off_pkt_vlen_hdr_primitives && acc_elem->pvlen) {
+    enQueue_elem(sd, rb, acc_elem->pvlen, PvhdrSz + acc_elem->pvlen->tot_len, datasize - extras->off_pkt_vlen_hdr_primitives);
+  }
+}
+
 void enQueue_elem(int sd, struct reply_buffer *rb, void *elem, int size, int tot_size)
 {
   if ((rb->packed + tot_size) < rb->len) {
@@ -621,3 +693,458 @@ int test_zero_elem(struct acc *elem)
 
   return TRUE;
 }
+
+int imt_history_query_init(struct imt_history_query *hq, u_int32_t bins)
+{
+  time_t now_epoch, first, step, begin;
+
+  memset(hq, 0, sizeof(struct imt_history_query));
+  if (!hist.bins) return ERR;
+
+  if (bins > hist.bins) bins = hist.bins;
+  now_epoch = cycle_stamp.tv_sec/hist.bin_time;
+  first = now_epoch-bins+1;
+
+  /* bins not yet reached or already overwritten by the ring are skipped */
+  for (step = first; step <= now_epoch; step++) {
+    if (step > hist.epoch || step <= (hist.epoch-(time_t)hist.bins)) continue;
+    hq->pos[hq->num] = (step % hist.bins);
+    hq->num++;
+  }
+
+  begin = MAX(first*hist.bin_time, hist.start);
+  if (cycle_stamp.tv_sec > begin) hq->span = (cycle_stamp.tv_sec-begin);
+  else hq->span = 1;
+
+  return SUCCESS;
+}
+
+/* sums every slot in use across the selected bins in one pass per column;
+   the inner loops walk contiguous memory and are left to the compiler to
+   vectorise. Meant for queries walking the whole table */
+void imt_history_query_sum(struct imt_history_query *hq)
+{
+  pm_counter_t *col;
+  u_int32_t idx, slot;
+  size_t off;
+
+  if (hq->bytes || !hq->num) return;
+
+  hq->slots = hist.next_slot;
+  hq->bytes = calloc((size_t) hq->slots*3, sizeof(pm_counter_t));
+  if (!hq->bytes) {
+    Log(LOG_WARNING, "WARN ( %s/%s ): Unable to malloc() history sums. Summing up per entry.\n", config.name, config.type);
+    hq->slots = 0;
+    return;
+  }
+  hq->packets = hq->bytes+hq->slots;
+  hq->flows = hq->packets+hq->slots;
+
+  for (idx = 0; idx < hq->num; idx++) {
+    off = (size_t) hq->pos[idx]*hist.slots;
+
+    col = &hist.bytes[off];
+    for (slot = 0; slot < hq->slots; slot++) hq->bytes[slot] += col[slot];
+
+    col = &hist.packets[off];
+    for (slot = 0; slot < hq->slots; slot++) hq->packets[slot] += col[slot];
+
+    col = &hist.flows[off];
+    for (slot = 0; slot < hq->slots; slot++) hq->flows[slot] += col[slot];
+  }
+}
+
+void imt_history_query_free(struct imt_history_query *hq)
+{
+  if (hq->bytes) free(hq->bytes);
+  hq->bytes = hq->packets = hq->flows = NULL;
+  hq->slots = 0;
+}
+
+/* returns the element to be sent back to the client, NULL if none: without
+   history, the element itself as long as it is in use; with history, a copy
+   of it into 'buf' carrying the summed up counters in place of the current
+   ones, as long as there was any traffic in the selected bins */
+struct acc *imt_history_view(struct acc *elem, struct imt_history_query *hq, struct acc *buf)
+{
+  u_int32_t slot, idx;
+  size_t off;
+
+  if (!hq) {
+    if (test_zero_elem(elem)) return NULL;
+    else return elem;
+  }
+
+  if (!elem->hslot) return NULL;
+  slot = elem->hslot-1;
+
+  memcpy(buf, elem, sizeof(struct acc));
+  buf->bytes_counter = 0;
+  buf->packet_counter = 0;
+  buf->flow_counter = 0;
+
+  if (slot < hq->slots) {
+    buf->bytes_counter = hq->bytes[slot];
+    buf->packet_counter = hq->packets[slot];
+    buf->flow_counter = hq->flows[slot];
+  }
+  else {
+    for (idx = 0; idx < hq->num; idx++) {
+      off = (size_t) hq->pos[idx]*hist.slots+slot;
+      buf->bytes_counter += hist.bytes[off];
+      buf->packet_counter += hist.packets[off];
+      buf->flow_counter += hist.flows[off];
+    }
+  }
+
+  if (!buf->bytes_counter && !buf->packet_counter && !buf->flow_counter) return NULL;
+
+  return buf;
+}
+
+/* tells whether every entry of a match query can be served by the primary
+   hash or by a secondary index, ie. without walking the whole table */
+int imt_index_query_check(unsigned char *buf, int len)
+{
+  struct query_header *qh = (struct query_header *) buf;
+  struct query_entry request;
+  unsigned char *bufptr = buf+sizeof(struct query_header);
+  unsigned int j;
+
+  if (!config.imt_index) return FALSE;
+  if (len < (sizeof(struct query_header)+(qh->num*sizeof(struct query_entry)))) return FALSE;
+
+  for (j = 0; j < qh->num; j++, bufptr += sizeof(struct query_entry)) {
+    memcpy(&request, bufptr, sizeof(struct query_entry));
+    if (request.what_to_count == config.what_to_count && request.what_to_count_2 == config.what_to_count_2) continue;
+    if (imt_index_select(&request) == ERR) return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* tells whether a -s query asks for re-aggregation, a threshold or
+   a top-N ranking to be carried out at the server */
+int imt_rank_query_check(struct query_header *q)
+{
+  if (q->agg_what_to_count || q->agg_what_to_count_2 || q->topN_counter || q->thr_counter) return TRUE;
+
+  return FALSE;
+}
+
+static pm_counter_t imt_rank_value(u_int8_t counter, pm_counter_t bytes, pm_counter_t packets, pm_counter_t flows)
+{
+  switch (counter) {
+  case 2:
+    return packets;
+  case 3:
+    return flows;
+  default:
+    return bytes;
+  }
+}
+
+static int imt_rank_push(struct imt_rank_entry **ent, u_int32_t *num, u_int32_t *size, void *ptr, pm_counter_t value)
+{
+  struct imt_rank_entry *new_ent;
+
+  if (*num == *size) {
+    new_ent = realloc(*ent, (*size ? *size*2 : 1024)*sizeof(struct imt_rank_entry));
+    if (!new_ent) return ERR;
+
+    *ent = new_ent;
+    *size = *size ? *size*2 : 1024;
+  }
+
+  (*ent)[*num].ptr = ptr;
+  (*ent)[*num].value = value;
+  (*num)++;
+
+  return SUCCESS;
+}
+
+static void imt_rank_heap_down(struct imt_rank_entry *heap, u_int32_t num, u_int32_t idx)
+{
+  struct imt_rank_entry tmp;
+  u_int32_t child;
+
+  while ((child = 2*idx+1) < num) {
+    if (child+1 < num && heap[child+1].value < heap[child].value) child++;
+    if (heap[idx].value <= heap[child].value) break;
+
+    tmp = heap[idx];
+    heap[idx] = heap[child];
+    heap[child] = tmp;
+    idx = child;
+  }
+}
+
+/* selects the 'howmany' entries with the highest value (all of them
+   if zero) through a min-heap, then sorts them in descending order;
+   returns how many entries were selected */
+static u_int32_t imt_rank_select(struct imt_rank_entry *ent, u_int32_t num, u_int32_t howmany)
+{
+  struct imt_rank_entry tmp;
+  u_int32_t size, idx;
+
+  size = (howmany && howmany < num) ? howmany : num;
+  if (!size) return 0;
+
+  for (idx = size/2; idx > 0; idx--) imt_rank_heap_down(ent, size, idx-1);
+
+  for (idx = size; idx < num; idx++) {
+    if (ent[idx].value > ent[0].value) {
+      ent[0] = ent[idx];
+      imt_rank_heap_down(ent, size, 0);
+    }
+  }
+
+  for (idx = size-1; idx > 0; idx--) {
+    tmp = ent[0];
+    ent[0] = ent[idx];
+    ent[idx] = tmp;
+    imt_rank_heap_down(ent, idx, 0);
+  }
+
+  return size;
+}
+
+/* serves a -s query asking for re-aggregation, a threshold or a top-N
+   ranking, so that only the final rows are sent back. Re-aggregated rows
+   carry only the extra primitives structures required by the selected
+   primitives: the reply header describes such compact layout */
+void imt_query_rank(int sd, struct reply_buffer *rb, struct query_header *q, struct extra_primitives *extras,
+		    struct imt_history_query *hq, int datasize)
+{
+  struct acc *acc_elem, *out_elem, hist_elem;
+  struct imt_rank_group **groups = NULL, *grp, *next_grp;
+  struct imt_rank_entry *ent = NULL;
+  struct pkt_primitives tbuf;
+  struct pkt_bgp_primitives bbuf;
+  struct pkt_legacy_bgp_primitives lbbuf;
+  struct pkt_nat_primitives nbuf;
+  struct pkt_mpls_primitives mbuf;
+  struct extra_primitives rextras;
+  struct pkt_data *row = NULL, *grow;
+  pm_cfgreg_t w = 0, w2 = 0;
+  u_int32_t idx, num = 0, size = 0, cnt, hash;
+  int reaggr = FALSE, rdatasize = PdataSz;
+
+  if (q->agg_what_to_count || q->agg_what_to_count_2) {
+    reaggr = TRUE;
+    w = config.what_to_count & q->agg_what_to_count;
+    w2 = config.what_to_count_2 & q->agg_what_to_count_2 & ~COUNT_LABEL;
+    memset(&rextras, 0, sizeof(struct extra_primitives));
+
+    if (extras->off_pkt_bgp_primitives && (w & (COUNT_LOCAL_PREF|COUNT_SRC_LOCAL_PREF|COUNT_MED|COUNT_SRC_MED|
+	COUNT_PEER_SRC_AS|COUNT_PEER_DST_AS|COUNT_PEER_SRC_IP|COUNT_PEER_DST_IP|COUNT_MPLS_VPN_RD))) {
+      rextras.off_pkt_bgp_primitives = rdatasize;
+      rdatasize += PbgpSz;
+    }
+    if (extras->off_pkt_lbgp_primitives && ((w & (COUNT_STD_COMM|COUNT_EXT_COMM|COUNT_AS_PATH|COUNT_SRC_STD_COMM|
+	COUNT_SRC_EXT_COMM|COUNT_SRC_AS_PATH)) || (w2 & (COUNT_LRG_COMM|COUNT_SRC_LRG_COMM)))) {
+      rextras.off_pkt_lbgp_primitives = rdatasize;
+      rdatasize += PlbgpSz;
+    }
+    if (extras->off_pkt_nat_primitives && (w2 & (COUNT_POST_NAT_SRC_HOST|COUNT_POST_NAT_DST_HOST|COUNT_POST_NAT_SRC_PORT|
+	COUNT_POST_NAT_DST_PORT|COUNT_NAT_EVENT|COUNT_TIMESTAMP_START|COUNT_TIMESTAMP_END|COUNT_TIMESTAMP_ARRIVAL))) {
+      rextras.off_pkt_nat_primitives = rdatasize;
+      rdatasize += PnatSz;
+    }
+    if (extras->off_pkt_mpls_primitives && (w2 & (COUNT_MPLS_LABEL_TOP|COUNT_MPLS_LABEL_BOTTOM|COUNT_MPLS_STACK_DEPTH))) {
+      rextras.off_pkt_mpls_primitives = rdatasize;
+      rdatasize += PmplsSz;
+    }
+
+    /* custom and variable-length primitives are not re-aggregated */
+    q->what_to_count = w;
+    q->what_to_count_2 = w2;
+    memcpy(&q->extras, &rextras, sizeof(struct extra_primitives));
+    q->datasize = rdatasize;
+
+    groups = calloc(config.buckets, sizeof(struct imt_rank_group *));
+    row = malloc(rdatasize);
+    if (!groups || !row) goto err_lane;
+  }
+
+  for (idx = 0; idx < config.buckets; idx++) {
+    for (acc_elem = ((struct acc *) a)+idx; acc_elem; acc_elem = acc_elem->next) {
+      out_elem = imt_history_view(acc_elem, hq, &hist_elem);
+      if (!out_elem) continue;
+
+      if (reaggr) {
+	memset(row, 0, rdatasize);
+	mask_elem(&tbuf, &bbuf, &lbbuf, &nbuf, &mbuf, out_elem, w, w2, extras);
+	memcpy(&row->primitives, &tbuf, sizeof(struct pkt_primitives));
+	if (rextras.off_pkt_bgp_primitives) memcpy((u_char *)row + rextras.off_pkt_bgp_primitives, &bbuf, PbgpSz);
+	if (rextras.off_pkt_lbgp_primitives) memcpy((u_char *)row + rextras.off_pkt_lbgp_primitives, &lbbuf, PlbgpSz);
+	if (rextras.off_pkt_nat_primitives) memcpy((u_char *)row + rextras.off_pkt_nat_primitives, &nbuf, PnatSz);
+	if (rextras.off_pkt_mpls_primitives) memcpy((u_char *)row + rextras.off_pkt_mpls_primitives, &mbuf, PmplsSz);
+
+	hash = cache_crc32((unsigned char *) &row->primitives, sizeof(struct pkt_primitives));
+	if (rdatasize > PdataSz) hash ^= cache_crc32((unsigned char *)row + PdataSz, rdatasize - PdataSz);
+
+	for (grp = groups[hash % config.buckets]; grp; grp = grp->next) {
+	  if (grp->hash == hash && !memcmp(&grp->row->primitives, &row->primitives, sizeof(struct pkt_primitives)) &&
+	      !memcmp((u_char *)grp->row + PdataSz, (u_char *)row + PdataSz, rdatasize - PdataSz)) break;
+	}
+
+	if (!grp) {
+	  grp = malloc(sizeof(struct imt_rank_group)+rdatasize);
+	  if (!grp) goto err_lane;
+
+	  grp->row = (struct pkt_data *) (grp+1);
+	  memcpy(grp->row, row, rdatasize);
+	  grp->row->flow_type = out_elem->flow_type;
+	  grp->hash = hash;
+	  grp->next = groups[hash % config.buckets];
+	  groups[hash % config.buckets] = grp;
+
+	  if (imt_rank_push(&ent, &num, &size, grp, 0) == ERR) goto err_lane;
+	}
+
+	grp->row->pkt_len += out_elem->bytes_counter;
+	grp->row->pkt_num += out_elem->packet_counter;
+	grp->row->flo_num += out_elem->flow_counter;
+      }
+      else {
+	if (q->thr_counter && imt_rank_value(q->thr_counter, out_elem->bytes_counter, out_elem->packet_counter,
+					     out_elem->flow_counter) < q->thr_value) continue;
+
+	if (imt_rank_push(&ent, &num, &size, acc_elem, imt_rank_value(q->topN_counter, out_elem->bytes_counter,
+			  out_elem->packet_counter, out_elem->flow_counter)) == ERR) goto err_lane;
+      }
+    }
+  }
+
+  /* re-aggregated rows are complete only now: thresholds can be applied */
+  if (reaggr) {
+    for (idx = 0, cnt = 0; idx < num; idx++) {
+      grow = ((struct imt_rank_group *) ent[idx].ptr)->row;
+      if (q->thr_counter && imt_rank_value(q->thr_counter, grow->pkt_len, grow->pkt_num, grow->flo_num) < q->thr_value) continue;
+
+      ent[cnt].ptr = ent[idx].ptr;
+      ent[cnt].value = imt_rank_value(q->topN_counter, grow->pkt_len, grow->pkt_num, grow->flo_num);
+      cnt++;
+    }
+    num = cnt;
+  }
+
+  if (q->topN_counter) num = imt_rank_select(ent, num, q->topN_howmany);
+
+  for (idx = 0; idx < num; idx++) {
+    if (reaggr) enQueue_elem(sd, rb, ((struct imt_rank_group *) ent[idx].ptr)->row, rdatasize, rdatasize);
+    else {
+      out_elem = imt_history_view(ent[idx].ptr, hq, &hist_elem);
+      if (out_elem) enQueue_acc(sd, rb, out_elem, extras, datasize);
+    }
+  }
+
+  goto exit_lane;
+
+  err_lane:
+  Log(LOG_ERR, "ERROR ( %s/%s ): Unable to malloc() query ranking buffers. Reply dropped.\n", config.name, config.type);
+
+  exit_lane:
+  if (groups) {
+    for (idx = 0; idx < config.buckets; idx++) {
+      for (grp = groups[idx]; grp; grp = next_grp) {
+	next_grp = grp->next;
+	free(grp);
+      }
+    }
+    free(groups);
+  }
+  if (row) free(row);
+  if (ent) free(ent);
+}
+
+#if defined ENABLE_THREADS
+void imt_query_scan_worker(struct imt_query_job *job)
+{
+  struct acc *acc_elem, *out_elem, hist_elem, **matches;
+  u_int32_t idx;
+
+  for (idx = job->first; idx < job->last; idx++) {
+    for (acc_elem = ((struct acc *) a)+idx; acc_elem; acc_elem = acc_elem->next) {
+      out_elem = imt_history_view(acc_elem, job->hq, &hist_elem);
+      if (!out_elem || !imt_query_match(acc_elem, job->request, job->extras)) continue;
+
+      if (job->type & WANT_COUNTER) Accumulate_Counters(&job->abuf, out_elem);
+      else {
+	if (job->num == job->size) {
+	  job->size = job->size ? job->size*2 : 1024;
+	  matches = realloc(job->matches, job->size*sizeof(struct acc *));
+	  if (!matches) {
+	    job->size = job->num;
+	    job->truncated = TRUE;
+	    return;
+	  }
+	  job->matches = matches;
+	}
+	job->matches[job->num] = acc_elem;
+	job->num++;
+      }
+
+      if (job->reset) set_reset_flag(acc_elem);
+    }
+  }
+}
+
+/* splits the buckets of the table among imt_query_threads workers, then
+   merges their results in bucket order, so that the reply is the same as
+   for a sequential walk */
+void imt_query_scan(int sd, struct reply_buffer *rb, struct query_entry *request, struct imt_history_query *hq,
+		    struct extra_primitives *extras, int datasize, int type, int reset, struct pkt_data *abuf)
+{
+  struct imt_query_job job[MAX_IMT_QUERY_THREADS];
+  struct acc *out_elem, hist_elem;
+  thread_pool_t *pool;
+  u_int32_t step, idx;
+  int threads, t;
+
+  threads = MIN(config.imt_query_threads, config.buckets);
+  step = (config.buckets+threads-1)/threads;
+  memset(job, 0, sizeof(job));
+
+  for (t = 0; t < threads; t++) {
+    job[t].request = request;
+    job[t].hq = hq;
+    job[t].extras = extras;
+    job[t].type = type;
+    job[t].reset = reset;
+    job[t].first = MIN(t*step, config.buckets);
+    job[t].last = MIN((t+1)*step, config.buckets);
+  }
+
+  pool = allocate_thread_pool(threads);
+  if (pool) {
+    for (t = 0; t < threads; t++) send_to_pool(pool, imt_query_scan_worker, &job[t]);
+    wait_thread_pool(pool);
+    deallocate_thread_pool(&pool);
+  }
+  else {
+    Log(LOG_WARNING, "WARN ( %s/%s ): Unable to allocate query threads. Serving query sequentially.\n", config.name, config.type);
+    for (t = 0; t < threads; t++) imt_query_scan_worker(&job[t]);
+  }
+
+  for (t = 0; t < threads; t++) {
+    if (type & WANT_COUNTER) {
+      abuf->pkt_len += job[t].abuf.pkt_len;
+      abuf->pkt_num += job[t].abuf.pkt_num;
+      abuf->flo_num += job[t].abuf.flo_num;
+      /* not a time: entries accumulated, see Accumulate_Counters() */
+      abuf->time_start.tv_sec += job[t].abuf.time_start.tv_sec;
+    }
+    else {
+      for (idx = 0; idx < job[t].num; idx++) {
+	out_elem = imt_history_view(job[t].matches[idx], hq, &hist_elem);
+	if (out_elem) enQueue_acc(sd, rb, out_elem, extras, datasize);
+      }
+    }
+
+    if (job[t].truncated) Log(LOG_WARNING, "WARN ( %s/%s ): Unable to malloc() query matches. Reply truncated.\n", config.name, config.type);
+    if (job[t].matches) free(job[t].matches);
+  }
+}
+#endif
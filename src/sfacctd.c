@@ -105,6 +105,7 @@ int main(int argc,char **argv, char **envp)
   struct id_table sampling_table;
   u_int32_t idx;
   int ret;
+  struct timespec decode_tstamp;
   SFSample spp;
 
 #if defined ENABLE_IPV6
@@ -954,6 +955,9 @@ int main(int argc,char **argv, char **envp)
 #endif
   }
 
+  /* live statistics for external tools, if a segment is configured */
+  stats_shm_wrapper();
+
   /* Main loop */
   for (;;) {
     ret = recvfrom(config.sock, sflow_packet, SFLOW_MAX_MSG_SIZE, 0, (struct sockaddr *) &client, &clen);
@@ -1037,6 +1041,9 @@ int main(int argc,char **argv, char **envp)
 #endif
     }
 
+    if (config.nfacctd_stats_refresh_time) clock_gettime(CLOCK_MONOTONIC, &decode_tstamp);
+    pptrs.v4.f_status = NULL;
+
     if (data_plugins) {
       switch(spp.datagramVersion = getData32(&spp)) {
       case 5:
@@ -1097,15 +1104,26 @@ int main(int argc,char **argv, char **envp)
     else if (tee_plugins) {
       process_SF_raw_packet(&spp, &pptrs, &req, (struct sockaddr *) &client);
     }
+
+    update_datagram_status_table((struct xflow_status_entry *) pptrs.v4.f_status, ret,
+				 config.nfacctd_stats_refresh_time ? &decode_tstamp : NULL);
+    if (config.nfacctd_stats_refresh_time) print_status_table_periodic(&decode_tstamp);
   }
 }
 
 void InterSampleCleanup(SFSample *spp)
 {
-  u_char *start = (u_char *) spp;
   u_char *ptr = (u_char *) &spp->sampleType;
-
-  memset(ptr, 0, SFSampleSz-(ptr-start));
+  u_char *end = (u_char *) spp->dst_as_path;
+
+  /* zero the decoded fields only; string buffers just need resetting */
+  memset(ptr, 0, end-ptr);
+  spp->dst_as_path[0] = '\0';
+  spp->comms[0] = '\0';
+  spp->src_user[0] = '\0';
+  spp->dst_user[0] = '\0';
+  spp->url[0] = '\0';
+  spp->host[0] = '\0';
 }
 
 void process_SFv2v4_packet(SFSample *spp, struct packet_ptrs_vector *pptrsv,
@@ -1143,6 +1161,7 @@ SFv2v4_read_sampleType:
     switch (sampleType) {
     case SFLFLOW_SAMPLE:
       readv2v4FlowSample(spp, pptrsv, req);
+      if (pptrsv->v4.f_status) ((struct xflow_status_entry *) pptrsv->v4.f_status)->counters.flows++;
       break;
     case SFLCOUNTERS_SAMPLE:
       readv2v4CountersSample(spp);
@@ -1194,12 +1213,14 @@ SFv5_read_sampleType:
     switch (sampleType) {
     case SFLFLOW_SAMPLE:
       readv5FlowSample(spp, FALSE, pptrsv, req, TRUE);
+      if (pptrsv->v4.f_status) ((struct xflow_status_entry *) pptrsv->v4.f_status)->counters.flows++;
       break;
     case SFLCOUNTERS_SAMPLE:
       readv5CountersSample(spp, FALSE, pptrsv, req);
       break;
     case SFLFLOW_SAMPLE_EXPANDED:
       readv5FlowSample(spp, TRUE, pptrsv, req, TRUE);
+      if (pptrsv->v4.f_status) ((struct xflow_status_entry *) pptrsv->v4.f_status)->counters.flows++;
       break;
     case SFLCOUNTERS_SAMPLE_EXPANDED:
       readv5CountersSample(spp, TRUE, pptrsv, req);
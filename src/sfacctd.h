@@ -156,32 +156,26 @@ typedef struct _SFSample {
   u_int32_t src_peer_as;
 
   u_int32_t dst_as_path_len;
-  char dst_as_path[LARGEBUFLEN];
 
   u_int32_t dst_peer_as;
   u_int32_t dst_as;
 
   u_int32_t communities_len;
-  char comms[LARGEBUFLEN];
   u_int32_t localpref;
 
   /* user id */
 #define SA_MAX_EXTENDED_USER_LEN 200
   u_int32_t src_user_charset;
   u_int32_t src_user_len;
-  char src_user[SA_MAX_EXTENDED_USER_LEN+1];
   u_int32_t dst_user_charset;
   u_int32_t dst_user_len;
-  char dst_user[SA_MAX_EXTENDED_USER_LEN+1];
 
   /* url */
 #define SA_MAX_EXTENDED_URL_LEN 200
 #define SA_MAX_EXTENDED_HOST_LEN 200
   u_int32_t url_direction;
   u_int32_t url_len;
-  char url[SA_MAX_EXTENDED_URL_LEN+1];
   u_int32_t host_len;
-  char host[SA_MAX_EXTENDED_HOST_LEN+1];
 
   /* mpls */
   SFLAddress mpls_nextHop;
@@ -202,6 +196,15 @@ typedef struct _SFSample {
 
   SFLAddress ipsrc;
   SFLAddress ipdst;
+
+  /* string buffers: kept last so that InterSampleCleanup() can avoid
+     zeroing them in full; they are always rebuilt null-terminated */
+  char dst_as_path[LARGEBUFLEN];
+  char comms[LARGEBUFLEN];
+  char src_user[SA_MAX_EXTENDED_USER_LEN+1];
+  char dst_user[SA_MAX_EXTENDED_USER_LEN+1];
+  char url[SA_MAX_EXTENDED_URL_LEN+1];
+  char host[SA_MAX_EXTENDED_HOST_LEN+1];
 } SFSample;
 
 /* define my own IP header struct - to ease portability */
@@ -276,6 +279,7 @@ EXT int SF_find_id(struct id_table *, struct packet_ptrs *, pm_id_t *, pm_id_t *
 EXT char *getPointer(SFSample *);
 EXT u_int32_t getData32(SFSample *);
 EXT u_int32_t getData32_nobswap(SFSample *);
+EXT int getData32_bulk(SFSample *, u_int32_t *, int);
 EXT u_int64_t getData64(SFSample *);
 EXT u_int32_t getAddress(SFSample *, SFLAddress *);
 EXT void skipBytes(SFSample *, int);
@@ -342,6 +342,22 @@ u_int32_t getData32_nobswap(SFSample *sample)
   return *(sample->datap)++;
 }
 
+/* bulk variant of getData32(): bounds are checked once for the whole
+   run of 32-bit words, which are then byte-swapped in a single pass */
+int getData32_bulk(SFSample *sample, u_int32_t *dst, int words)
+{
+  u_int32_t *src = sample->datap;
+  int idx;
+
+  if ((u_char *)sample->datap > sample->endp) return ERR;
+  if ((sample->endp - (u_char *)sample->datap) < (words * sizeof(u_int32_t))) return ERR;
+
+  for (idx = 0; idx < words; idx++) dst[idx] = ntohl(src[idx]);
+  sample->datap += words;
+
+  return FALSE;
+}
+
 u_int64_t getData64(SFSample *sample)
 {
   u_int64_t tmpLo, tmpHi;
@@ -363,6 +379,9 @@ u_int32_t getString(SFSample *sample, char *buf, int bufLen)
   len = getData32(sample);
   // truncate if too long
   read_len = (len >= bufLen) ? (bufLen - 1) : len;
+  // never read past the end of the datagram
+  if ((u_char *)sample->datap > sample->endp) read_len = 0;
+  else if (read_len > (sample->endp - (u_char *)sample->datap)) read_len = (sample->endp - (u_char *)sample->datap);
   memcpy(buf, sample->datap, read_len);
   buf[read_len] = '\0';   // null terminate
   skipBytes(sample, len);
@@ -434,12 +453,19 @@ void readExtendedGateway_v2(SFSample *sample)
   sample->dst_as_path_len = getData32(sample);
   /* just point at the dst_as_path array */
   if(sample->dst_as_path_len > 0) {
-    // sample->dst_as_path = sample->datap;
+    u_int32_t *as_path = sample->datap;
+
+    if ((u_char *)sample->datap > sample->endp ||
+        sample->dst_as_path_len > ((sample->endp - (u_char *)sample->datap) / 4)) {
+      sample->datap = (u_int32_t *) (sample->endp + 1);
+      return;
+    }
+
     /* and skip over it in the input */
     skipBytes(sample, sample->dst_as_path_len * 4);
     // fill in the dst and dst_peer fields too
-    sample->dst_peer_as = ntohl(sample->dst_as_path[0]);
-    sample->dst_as = ntohl(sample->dst_as_path[sample->dst_as_path_len - 1]);
+    sample->dst_peer_as = ntohl(as_path[0]);
+    sample->dst_as = ntohl(as_path[sample->dst_as_path_len - 1]);
   }
   
   sample->extended_data_tag |= SASAMPLE_EXTENDED_DATA_GATEWAY;
@@ -826,6 +852,10 @@ void readFlowSample_header(SFSample *sample)
   sample->headerLen = getData32(sample);
   
   sample->header = (u_char *)sample->datap; /* just point at the header */
+
+  /* endp is confined to the enclosing sample: don't let decoders run past it */
+  if (sample->header > sample->endp) sample->headerLen = 0;
+  else if (sample->headerLen > (sample->endp - sample->header)) sample->headerLen = (sample->endp - sample->header);
   
   switch(sample->headerProtocol) {
     /* the header protocol tells us where to jump into the decode */
@@ -1020,50 +1050,73 @@ void readv5FlowSample(SFSample *sample, int expanded, struct packet_ptrs_vector
 {
   struct sfv5_modules_db_field *db_field = NULL;
   u_int32_t num_elements, sampleLength, actualSampleLength;
-  u_char *sampleStart;
+  u_char *sampleStart, *datagramEnd;
 
   sampleLength = getData32(sample);
   sampleStart = (u_char *)sample->datap;
-  sample->samplesGenerated = getData32(sample);
-  if(expanded) {
-    sample->ds_class = getData32(sample);
-    sample->ds_index = getData32(sample);
-  }
-  else {
-    u_int32_t samplerId = getData32(sample);
-    sample->ds_class = samplerId >> 24;
-    sample->ds_index = samplerId & 0x00ffffff;
+
+  /*
+     Bounds are validated once per sample record: if the whole sample does
+     not fit in the datagram the rest of the datagram is discarded, else
+     element readers are confined to the sample by narrowing endp.
+  */
+  if (sampleStart > sample->endp || sampleLength > (sample->endp - sampleStart)) {
+    sample->datap = (u_int32_t *) (sample->endp + 1);
+    return;
   }
 
-  sample->meanSkipCount = getData32(sample);
-  sample->samplePool = getData32(sample);
-  sample->dropEvents = getData32(sample);
-  if(expanded) {
-    sample->inputPortFormat = getData32(sample);
-    sample->inputPort = getData32(sample);
-    sample->outputPortFormat = getData32(sample);
-    sample->outputPort = getData32(sample);
+  datagramEnd = sample->endp;
+  sample->endp = sampleStart + sampleLength;
+
+  if (expanded) {
+    SFLFlow_sample_expanded_hdr hdr;
+
+    if (getData32_bulk(sample, (u_int32_t *) &hdr, sizeof(hdr) / sizeof(u_int32_t)) == ERR) goto exit_lane;
+
+    sample->samplesGenerated = hdr.sequence_number;
+    sample->ds_class = hdr.ds_class;
+    sample->ds_index = hdr.ds_index;
+    sample->meanSkipCount = hdr.sampling_rate;
+    sample->samplePool = hdr.sample_pool;
+    sample->dropEvents = hdr.drops;
+    sample->inputPortFormat = hdr.inputFormat;
+    sample->inputPort = hdr.input;
+    sample->outputPortFormat = hdr.outputFormat;
+    sample->outputPort = hdr.output;
+    num_elements = hdr.num_elements;
   }
   else {
-    u_int32_t inp, outp;
-    inp = getData32(sample);
-    outp = getData32(sample);
-    sample->inputPortFormat = inp >> 30;
-    sample->outputPortFormat = outp >> 30;
-    sample->inputPort = inp; // skip 0x3fffffff mask
-    sample->outputPort = outp; // skip 0x3fffffff mask
+    SFLFlow_sample_hdr hdr;
+
+    if (getData32_bulk(sample, (u_int32_t *) &hdr, sizeof(hdr) / sizeof(u_int32_t)) == ERR) goto exit_lane;
+
+    sample->samplesGenerated = hdr.sequence_number;
+    sample->ds_class = hdr.source_id >> 24;
+    sample->ds_index = hdr.source_id & 0x00ffffff;
+    sample->meanSkipCount = hdr.sampling_rate;
+    sample->samplePool = hdr.sample_pool;
+    sample->dropEvents = hdr.drops;
+    sample->inputPortFormat = hdr.input >> 30;
+    sample->outputPortFormat = hdr.output >> 30;
+    sample->inputPort = hdr.input; // skip 0x3fffffff mask
+    sample->outputPort = hdr.output; // skip 0x3fffffff mask
+    num_elements = hdr.num_elements;
   }
 
-  num_elements = getData32(sample);
   {
     int el;
     for (el = 0; el < num_elements; el++) {
-      u_int32_t tag, length;
+      u_int32_t tl[2], tag, length;
       u_char *start;
-      tag = getData32(sample);
-      length = getData32(sample);
+
+      if (getData32_bulk(sample, tl, 2) == ERR) goto exit_lane;
+      tag = tl[0];
+      length = tl[1];
       start = (u_char *)sample->datap;
 
+      /* element must fit in the sample; readers need no further checks */
+      if (length > (sample->endp - start)) goto exit_lane;
+
       switch(tag) {
       case SFLFLOW_HEADER:     readFlowSample_header(sample); break;
       case SFLFLOW_ETHERNET:   readFlowSample_ethernet(sample); break;
@@ -1085,8 +1138,6 @@ void readv5FlowSample(SFSample *sample, int expanded, struct packet_ptrs_vector
       case SFLFLOW_EX_CLASS:	    readExtendedClass(sample); break;
       case SFLFLOW_EX_TAG:	    readExtendedTag(sample); break;
       default:
-	// lengthCheck() here for extra security before skipBytes()
-	if (lengthCheck(sample, start, length) == ERR) return;
 	skipBytes(sample, length);
 	break;
       }
@@ -1099,13 +1150,21 @@ void readv5FlowSample(SFSample *sample, int expanded, struct packet_ptrs_vector
       }
       else Log(LOG_WARNING, "WARN ( %s/core ): readv5FlowSample(): no IEs available in SFv5 modules DB.\n", config.name);
 
-      if (lengthCheck(sample, start, length) == ERR) return;
+      if (lengthCheck(sample, start, length) == ERR) goto exit_lane;
     }
   }
 
-  if (lengthCheck(sample, sampleStart, sampleLength) == ERR) return;
+  if (lengthCheck(sample, sampleStart, sampleLength) == ERR) goto exit_lane;
 
+  sample->endp = datagramEnd;
   if (finalize) finalizeSample(sample, pptrsv, req);
+
+  return;
+
+exit_lane:
+  /* malformed sample: skip it, resuming from the next one in the datagram */
+  sample->datap = (u_int32_t *) (sampleStart + sampleLength);
+  sample->endp = datagramEnd;
 }
 
 void readv5CountersSample(SFSample *sample, int expanded, struct packet_ptrs_vector *pptrsv, struct plugin_requests *req)
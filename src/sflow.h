@@ -391,6 +391,34 @@ typedef struct _SFLFlow_sample_expanded {
   SFLFlow_sample_element *elements;
 } SFLFlow_sample_expanded;
 
+/* fixed-layout heads of the two flow sample formats above, as laid out
+   on the wire: all 32-bit words, so they can be byte-swapped in bulk */
+
+typedef struct _SFLFlow_sample_hdr {
+  u_int32_t sequence_number;
+  u_int32_t source_id;
+  u_int32_t sampling_rate;
+  u_int32_t sample_pool;
+  u_int32_t drops;
+  u_int32_t input;
+  u_int32_t output;
+  u_int32_t num_elements;
+} SFLFlow_sample_hdr;
+
+typedef struct _SFLFlow_sample_expanded_hdr {
+  u_int32_t sequence_number;
+  u_int32_t ds_class;
+  u_int32_t ds_index;
+  u_int32_t sampling_rate;
+  u_int32_t sample_pool;
+  u_int32_t drops;
+  u_int32_t inputFormat;
+  u_int32_t input;
+  u_int32_t outputFormat;
+  u_int32_t output;
+  u_int32_t num_elements;
+} SFLFlow_sample_expanded_hdr;
+
 /* Counter types */
 
 /* Generic interface counters - see RFC 1573, 2233 */
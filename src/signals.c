@@ -27,6 +27,7 @@
 #include "pmacct-data.h"
 #include "plugin_hooks.h"
 #include "bgp/bgp.h"
+#include "tpacket.h"
 
 /* extern */
 extern struct plugins_list_entry *plugin_list;
@@ -150,6 +151,16 @@ void my_sigint_handler(int signum)
   Log(LOG_INFO, "INFO ( %s/%s ): OK, Exiting ...\n", config.name, config.type);
 
   if (config.acct_type == ACCT_PM && !config.uacctd_group /* XXX */) {
+#if defined (HAVE_TPACKET_V3)
+    /* glob_pcapt is then a dead handle, only used to compile the filter */
+    if (config.dev && glob_tpacket_ring) {
+      tpacket_v3_stats(glob_tpacket_ring);
+      printf("\n");
+      printf("%llu packets received by filter\n", (unsigned long long)glob_tpacket_ring->packets);
+      printf("%llu packets dropped by kernel\n", (unsigned long long)glob_tpacket_ring->drops);
+    }
+    else
+#endif
     if (config.dev) {
       if (pcap_stats(glob_pcapt, &ps) < 0) printf("\npcap_stats: %s\n", pcap_geterr(glob_pcapt));
       printf("\n");
@@ -195,6 +206,18 @@ void push_stats()
   time_t now = time(NULL);
 
   if (config.acct_type == ACCT_PM) {
+#if defined (HAVE_TPACKET_V3)
+    if (config.dev && glob_tpacket_ring) {
+      tpacket_v3_stats(glob_tpacket_ring);
+      Log(LOG_NOTICE, "NOTICE ( %s/%s ): %s: (%u) %llu packets received by filter\n",
+		config.name, config.type, config.dev, now, (unsigned long long)glob_tpacket_ring->packets);
+      Log(LOG_NOTICE, "NOTICE ( %s/%s ): %s: (%u) %llu packets dropped by kernel\n",
+		config.name, config.type, config.dev, now, (unsigned long long)glob_tpacket_ring->drops);
+      Log(LOG_NOTICE, "NOTICE ( %s/%s ): %s: (%u) %llu ring freezes\n",
+		config.name, config.type, config.dev, now, (unsigned long long)glob_tpacket_ring->freeze_q_cnt);
+    }
+    else
+#endif
     if (config.dev) {
       if (pcap_stats(glob_pcapt, &ps) < 0) Log(LOG_INFO, "INFO ( %s/%s ): pcap_stats: %s\n",
 						config.name, config.type, pcap_geterr(glob_pcapt));
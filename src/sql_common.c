@@ -27,6 +27,7 @@
 #include "plugin_hooks.h"
 #include "sql_common.h"
 #include "crc32.h"
+#include "addr.h"
 #include "sql_common_m.c"
 
 /* Functions */
@@ -134,6 +135,16 @@ void sql_init_default_values(struct extra_primitives *extras)
   dump_writers.list = malloc(config.dump_max_writers * sizeof(pid_t));
   dump_writers_init();
 
+  if (config.sql_parallel_writers > 1) {
+    if (!strcmp(config.type, "sqlite3")) {
+      Log(LOG_WARNING, "WARN ( %s/%s ): sql_parallel_writers is not supported by SQLite. Ignored.\n", config.name, config.type);
+      config.sql_parallel_writers = FALSE;
+    }
+    else if ((!config.sql_locking_style || !strcasecmp(config.sql_locking_style, "table")) &&
+	     (!strcmp(config.type, "mysql") || !config.sql_dont_try_update))
+      Log(LOG_WARNING, "WARN ( %s/%s ): table locking serializes parallel writers. See sql_locking_style.\n", config.name, config.type);
+  }
+
   if (config.sql_aggressive_classification) {
     if (config.acct_type == ACCT_PM && config.what_to_count & COUNT_CLASS);
     else config.sql_aggressive_classification = FALSE;
@@ -432,8 +443,11 @@ int sql_cache_flush_pending(struct db_cache *queue[], int index, struct insert_d
 
 void sql_cache_handle_flush_event(struct insert_data *idata, time_t *refresh_deadline, struct ports_table *pt)
 {
+  struct timeval purge_start;
   int ret;
 
+  stats_shm_update_cache(qq_ptr, config.sql_cache_entries);
+
   dump_writers_count();
   if (dump_writers_get_flags() != CHLD_ALERT) { 
     switch (ret = fork()) {
@@ -442,19 +456,24 @@ void sql_cache_handle_flush_event(struct insert_data *idata, time_t *refresh_dea
       signal(SIGINT, SIG_IGN);
       signal(SIGHUP, SIG_IGN);
       pm_setproctitle("%s %s [%s]", config.type, "Plugin -- DB Writer", config.name);
+      gettimeofday(&purge_start, NULL);
 
-      if (qq_ptr) {
-        if (dump_writers_get_flags() == CHLD_WARNING) sql_db_fail(&p);
-        if (!strcmp(config.type, "mysql"))
-          (*sqlfunc_cbr.connect)(&p, config.sql_host);
-        else
-          (*sqlfunc_cbr.connect)(&p, NULL);
-      }
+      if (qq_ptr && config.sql_parallel_writers > 1) sql_parallel_purge(queries_queue, qq_ptr, idata);
+      else {
+        if (qq_ptr) {
+          if (dump_writers_get_flags() == CHLD_WARNING) sql_db_fail(&p);
+          if (!strcmp(config.type, "mysql"))
+            (*sqlfunc_cbr.connect)(&p, config.sql_host);
+          else
+            (*sqlfunc_cbr.connect)(&p, NULL);
+        }
 
-      /* qq_ptr check inside purge function along with a Log() call */
-      (*sqlfunc_cbr.purge)(queries_queue, qq_ptr, idata);
+        /* qq_ptr check inside purge function along with a Log() call */
+        (*sqlfunc_cbr.purge)(queries_queue, qq_ptr, idata);
 
-      if (qq_ptr) (*sqlfunc_cbr.close)(&bed);
+        if (qq_ptr) (*sqlfunc_cbr.close)(&bed);
+      }
+      stats_shm_update_purge(&purge_start);
 
       if (config.sql_trigger_exec) {
         if (idata->now > idata->triggertime) sql_trigger_exec(config.sql_trigger_exec);
@@ -492,6 +511,121 @@ void sql_cache_handle_flush_event(struct insert_data *idata, time_t *refresh_dea
   }
 }
 
+/*
+  Spreads a cache flush across config.sql_parallel_writers writers, each
+  with its own connection. Entries are partitioned by their signature so
+  that all queries about the same key are sent, in order, by one writer.
+*/
+void sql_parallel_purge(struct db_cache *queue[], int index, struct insert_data *idata)
+{
+  struct sql_writer_report report, total;
+  struct db_cache **part;
+  struct timeval start, end;
+  int writers = config.sql_parallel_writers, id, idx, part_len, fd[2], forked = 0;
+  pid_t writer_pid = getpid();
+
+  part = malloc(index*sizeof(struct db_cache *));
+  if (!part || pipe(fd)) {
+    Log(LOG_WARNING, "WARN ( %s/%s ): Unable to set up parallel writers. Purging with one writer.\n", config.name, config.type);
+    if (part) free(part);
+
+    sql_parallel_writer(0, queue, index, idata, &report);
+    return;
+  }
+
+  Log(LOG_INFO, "INFO ( %s/%s ): *** Parallel purge - START (PID: %u, writers: %u) ***\n", config.name, config.type, writer_pid, writers);
+  gettimeofday(&start, NULL);
+  memset(&total, 0, sizeof(total));
+
+  for (id = 0; id < writers; id++) {
+    for (idx = 0, part_len = 0; idx < index; idx++) {
+      if (queue[idx]->signature % writers == id) {
+	part[part_len] = queue[idx];
+	part_len++;
+      }
+    }
+    if (!part_len) continue;
+
+    switch (fork()) {
+    case 0: /* Child */
+      close(fd[0]);
+      sql_parallel_writer(id, part, part_len, idata, &report);
+      if (write(fd[1], &report, sizeof(report)) != sizeof(report))
+	Log(LOG_WARNING, "WARN ( %s/%s ): writer %u unable to report: %s\n", config.name, config.type, id, strerror(errno));
+      exit(0);
+    case -1: /* Parent, failed: this partition is purged inline */
+      Log(LOG_WARNING, "WARN ( %s/%s ): Unable to fork writer %u: %s\n", config.name, config.type, id, strerror(errno));
+      sql_parallel_writer(id, part, part_len, idata, &report);
+      if (write(fd[1], &report, sizeof(report)) != sizeof(report))
+	Log(LOG_WARNING, "WARN ( %s/%s ): writer %u unable to report: %s\n", config.name, config.type, id, strerror(errno));
+      break;
+    default: /* Parent */
+      forked++;
+      break;
+    }
+  }
+
+  close(fd[1]);
+  while (read(fd[0], &report, sizeof(report)) == sizeof(report)) {
+    Log(LOG_INFO, "INFO ( %s/%s ): writer %u/%u (PID: %u): QN: %u/%u, ET: %u.%03u\n", config.name, config.type,
+	report.id, writers, report.pid, report.qn, report.ten, report.elap_ms/1000, report.elap_ms%1000);
+
+    total.ten += report.ten;
+    total.een += report.een;
+    total.qn += report.qn;
+    total.iqn += report.iqn;
+    total.uqn += report.uqn;
+  }
+  close(fd[0]);
+  while (forked && wait(NULL) > 0) forked--;
+  free(part);
+
+  gettimeofday(&end, NULL);
+  idata->ten = total.ten;
+  idata->een = total.een;
+  idata->qn = total.qn;
+  idata->iqn = total.iqn;
+  idata->uqn = total.uqn;
+  idata->elap_time = end.tv_sec-start.tv_sec;
+
+  Log(LOG_INFO, "INFO ( %s/%s ): *** Parallel purge - END (PID: %u, writers: %u, QN: %u/%u, ET: %u) ***\n",
+		config.name, config.type, writer_pid, writers, idata->qn, index, idata->elap_time);
+
+  if (config.sql_trigger_exec) {
+    idata->basetime = queue[0]->basetime;
+    SQL_SetENV_child(idata);
+  }
+}
+
+/* one of the writers of sql_parallel_purge(): runs the regular purge */
+void sql_parallel_writer(int id, struct db_cache *queue[], int index, struct insert_data *idata, struct sql_writer_report *report)
+{
+  struct timeval start, end;
+
+  pm_setproctitle("%s %s [%s] #%u", config.type, "Plugin -- DB Writer", config.name, id);
+  gettimeofday(&start, NULL);
+
+  if (dump_writers_get_flags() == CHLD_WARNING) sql_db_fail(&p);
+  if (!strcmp(config.type, "mysql"))
+    (*sqlfunc_cbr.connect)(&p, config.sql_host);
+  else
+    (*sqlfunc_cbr.connect)(&p, NULL);
+
+  (*sqlfunc_cbr.purge)(queue, index, idata);
+  (*sqlfunc_cbr.close)(&bed);
+
+  gettimeofday(&end, NULL);
+  memset(report, 0, sizeof(struct sql_writer_report));
+  report->id = id;
+  report->pid = getpid();
+  report->ten = idata->ten;
+  report->een = idata->een;
+  report->qn = idata->qn;
+  report->iqn = idata->iqn;
+  report->uqn = idata->uqn;
+  report->elap_ms = (end.tv_sec-start.tv_sec)*1000+(end.tv_usec-start.tv_usec)/1000;
+}
+
 struct db_cache *sql_cache_search(struct primitives_ptrs *prim_ptrs, time_t basetime)
 {
   struct pkt_data *pdata = prim_ptrs->data;
@@ -3227,6 +3361,208 @@ int sql_compose_static_set(int have_flows)
   return set_primitives;
 }
 
+/*
+  Turns a printf-style clause fragment into its prepared statement form:
+  each conversion, quotes included if any, becomes a '?' placeholder and
+  is saved in 'convs'; returns the number of conversions or ERR.
+*/
+static int sql_prep_transform(const char *src, char *dst, int dstlen, char convs[][SRVBUFLEN], int max_convs)
+{
+  const char *conv;
+  int nconv = 0, dlen = 0, quoted;
+
+  while (*src && dlen < dstlen-1) {
+    if (*src != '%') {
+      dst[dlen++] = *src++;
+      continue;
+    }
+
+    if (*(src+1) == '%') {
+      dst[dlen++] = '%';
+      src += 2;
+      continue;
+    }
+
+    conv = src++;
+    while (*src && strchr("-+ #0123456789.hlLqjzt", *src)) src++;
+    if (!*src) return ERR;
+    src++;
+
+    if (nconv == max_convs) return ERR;
+    memset(convs[nconv], 0, SRVBUFLEN);
+    memcpy(convs[nconv], conv, MIN(src-conv, SRVBUFLEN-1));
+    nconv++;
+
+    quoted = (dlen && dst[dlen-1] == '\'' && *src == '\'');
+    if (quoted) {
+      dlen--;
+      src++;
+    }
+    dst[dlen++] = '?';
+  }
+
+  dst[dlen] = '\0';
+
+  return nconv;
+}
+
+static int sql_prep_add(struct sql_prep_field *fields, int *nfields, int num, int sub, u_int8_t source, sql_bind_getter get, char *fmt)
+{
+  struct sql_prep_field *f;
+
+  if (*nfields >= N_PRIMITIVES+8) return ERR;
+
+  f = &fields[*nfields];
+  memset(f, 0, sizeof(struct sql_prep_field));
+  f->num = num;
+  f->sub = sub;
+  f->source = source;
+  f->get = get;
+  if (fmt) strlcpy(f->fmt, fmt, sizeof(f->fmt));
+  (*nfields)++;
+
+  return SUCCESS;
+}
+
+/*
+  Compiles values[], where[] and set[] into the clauses and placeholder lists
+  used by prepared statements; primitives with a known native value are bound
+  directly, the others are rendered by their handler. Returns ERR if some
+  fragment can't be expressed with placeholders, ie. MySQL *_aton handlers.
+*/
+int sql_prep_compile(int num_primitives, int have_flows)
+{
+  struct sql_bind_native *native;
+  char convs_v[4][SRVBUFLEN], convs_w[4][SRVBUFLEN], frag[SRVBUFLEN];
+  int num, idx, nconv_v, nconv_w, ret = SUCCESS;
+  u_int8_t source;
+  sql_bind_getter get;
+
+  sql_prep_values_num = sql_prep_where_num = sql_prep_set_num = 0;
+  memset(sql_prep_values_clause, 0, sizeof(sql_prep_values_clause));
+  memset(sql_prep_where_clause, 0, sizeof(sql_prep_where_clause));
+  memset(sql_prep_set_clause, 0, sizeof(sql_prep_set_clause));
+
+  for (num = 0; num < num_primitives && ret == SUCCESS; num++) {
+    nconv_v = sql_prep_transform(values[num].string, frag, sizeof(frag), convs_v, 4);
+    if (nconv_v == ERR) goto unsupported;
+    strncat(sql_prep_values_clause, frag, SPACELEFT(sql_prep_values_clause));
+
+    nconv_w = sql_prep_transform(where[num].string, frag, sizeof(frag), convs_w, 4);
+    if (nconv_w == ERR || nconv_w > nconv_v) goto unsupported;
+    strncat(sql_prep_where_clause, frag, SPACELEFT(sql_prep_where_clause));
+
+    /* fake_mac_handler() renders zeroes differently than etheraddr_string() */
+    native = sql_bind_lookup(values[num].handler);
+    if (native && values[num].handler != fake_mac_handler) {
+      source = (native->source == SQL_BIND_TIME ? SQL_BIND_INT : native->source);
+      get = native->get;
+    }
+    else if (nconv_v == 1) {
+      source = SQL_BIND_TEXT;
+      get = NULL;
+    }
+    else goto unsupported;
+
+    /* where[] reuses the trailing values of the primitive, ie. stamp_inserted */
+    for (idx = 0; idx < nconv_v && ret == SUCCESS; idx++)
+      ret = sql_prep_add(sql_prep_values, &sql_prep_values_num, num, idx, source, get, convs_v[0]);
+    for (idx = 0; idx < nconv_w && ret == SUCCESS; idx++)
+      ret = sql_prep_add(sql_prep_where, &sql_prep_where_num, num, (nconv_v-nconv_w)+idx, source, get, convs_v[0]);
+  }
+
+  if (ret == SUCCESS) {
+    if (have_flows) strncat(sql_prep_values_clause, ", ?, ?, ?)", SPACELEFT(sql_prep_values_clause));
+    else strncat(sql_prep_values_clause, ", ?, ?)", SPACELEFT(sql_prep_values_clause));
+
+    ret = sql_prep_add(sql_prep_values, &sql_prep_values_num, -1, 0, SQL_BIND_INT, sql_bind_get_packets, NULL);
+    if (ret == SUCCESS) ret = sql_prep_add(sql_prep_values, &sql_prep_values_num, -1, 0, SQL_BIND_INT, sql_bind_get_bytes, NULL);
+    if (ret == SUCCESS && have_flows) ret = sql_prep_add(sql_prep_values, &sql_prep_values_num, -1, 0, SQL_BIND_INT, sql_bind_get_flows, NULL);
+  }
+
+  for (num = 0; set[num].type && ret == SUCCESS; num++) {
+    if (set[num].handler == count_noop_setclause_handler) {
+      strncat(sql_prep_set_clause, set[num].string, SPACELEFT(sql_prep_set_clause));
+      continue;
+    }
+
+    nconv_v = sql_prep_transform(set[num].string, frag, sizeof(frag), convs_v, 4);
+    if (nconv_v == ERR) goto unsupported;
+    strncat(sql_prep_set_clause, frag, SPACELEFT(sql_prep_set_clause));
+
+    if (set[num].handler == count_counters_setclause_handler && nconv_v == 2) {
+      ret = sql_prep_add(sql_prep_set, &sql_prep_set_num, -1, 0, SQL_BIND_INT, sql_bind_get_packets, NULL);
+      if (ret == SUCCESS) ret = sql_prep_add(sql_prep_set, &sql_prep_set_num, -1, 0, SQL_BIND_INT, sql_bind_get_bytes, NULL);
+    }
+    else if (set[num].handler == count_flows_setclause_handler && nconv_v == 1)
+      ret = sql_prep_add(sql_prep_set, &sql_prep_set_num, -1, 0, SQL_BIND_INT, sql_bind_get_flows, NULL);
+    else if (set[num].handler == count_tcpflags_setclause_handler && nconv_v == 1)
+      ret = sql_prep_add(sql_prep_set, &sql_prep_set_num, -1, 0, SQL_BIND_INT, sql_bind_get_tcpflags, NULL);
+    else goto unsupported;
+  }
+
+  if (ret == ERR) Log(LOG_WARNING, "WARN ( %s/%s ): too many fields for prepared statements.\n", config.name, config.type);
+
+  return ret;
+
+  unsupported:
+  Log(LOG_WARNING, "WARN ( %s/%s ): primitive #%d can't be bound in prepared statements.\n", config.name, config.type, num);
+
+  return ERR;
+}
+
+/*
+  Returns the value of a prepared statement field, either as an integer
+  (SQL_BIND_INT) or as a string (SQL_BIND_TEXT).
+*/
+int sql_prep_value(struct sql_prep_field *f, const struct db_cache *cache_elem, struct insert_data *idata,
+		   u_int64_t *ival, char *buf, int buflen, int *len)
+{
+  struct sql_bind_value v;
+  char saved_values[SRVBUFLEN], saved_where[SRVBUFLEN], *ptr_values, *ptr_where;
+
+  memset(&v, 0, sizeof(v));
+
+  switch (f->source) {
+  case SQL_BIND_INT:
+    f->get(cache_elem, idata, f->sub, &v);
+    *ival = v.u64;
+    return SQL_BIND_INT;
+  case SQL_BIND_ADDR:
+    f->get(cache_elem, idata, f->sub, &v);
+    if (buflen < INET6_ADDRSTRLEN) return ERR;
+    addr_to_str(buf, v.addr);
+    break;
+  case SQL_BIND_MAC:
+    f->get(cache_elem, idata, f->sub, &v);
+    if (buflen < 18) return ERR;
+    etheraddr_string(v.mac, buf);
+    break;
+  case SQL_BIND_TEXT:
+    /* let the handler render the bare value */
+    strlcpy(saved_values, values[f->num].string, SRVBUFLEN);
+    strlcpy(saved_where, where[f->num].string, SRVBUFLEN);
+    strlcpy(values[f->num].string, f->fmt, SRVBUFLEN);
+    strlcpy(where[f->num].string, f->fmt, SRVBUFLEN);
+
+    values_clause[0] = where_clause[0] = '\0';
+    ptr_values = values_clause;
+    ptr_where = where_clause;
+    (*values[f->num].handler)(cache_elem, idata, f->num, &ptr_values, &ptr_where);
+    strlcpy(buf, values_clause, buflen);
+
+    strlcpy(values[f->num].string, saved_values, SRVBUFLEN);
+    strlcpy(where[f->num].string, saved_where, SRVBUFLEN);
+    break;
+  default:
+    return ERR;
+  }
+
+  *len = strlen(buf);
+
+  return SQL_BIND_TEXT;
+}
+
 void primptrs_set_all_from_db_cache(struct primitives_ptrs *prim_ptrs, struct db_cache *entry)
 {
   struct pkt_data *data = prim_ptrs->data;
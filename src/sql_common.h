@@ -115,6 +115,18 @@ struct insert_data {
   unsigned int uqn; /* UPDATEs query number */
 };
 
+/* parallel cache flush: sent by each writer to the one coordinating them */
+struct sql_writer_report {
+  int id;
+  pid_t pid;
+  unsigned int ten;
+  unsigned int een;
+  unsigned int qn;
+  unsigned int iqn;
+  unsigned int uqn;
+  u_int32_t elap_ms;
+};
+
 struct db_cache {
   struct pkt_primitives primitives;
   pm_counter_t bytes_counter;
@@ -150,6 +162,37 @@ struct frags {
   char string[SRVBUFLEN];
 };
 
+/* native values of primitives, see sql_bind_lookup() */
+#define SQL_BIND_INT		1
+#define SQL_BIND_ADDR		2
+#define SQL_BIND_MAC		3
+#define SQL_BIND_TIME		4
+#define SQL_BIND_TEXT		5	/* rendered by the handler */
+
+struct sql_bind_value {
+  u_int64_t u64;
+  time_t t;
+  const struct host_addr *addr;
+  const u_char *mac;
+};
+
+typedef void (*sql_bind_getter) (const struct db_cache *, struct insert_data *, int, struct sql_bind_value *);
+
+struct sql_bind_native {
+  dbop_handler handler;
+  u_int8_t source;
+  sql_bind_getter get;
+};
+
+/* prepared statements: one per placeholder */
+struct sql_prep_field {
+  int num;			/* primitive, -1 for counters */
+  int sub;			/* value within the primitive */
+  u_int8_t source;
+  sql_bind_getter get;
+  char fmt[SRVBUFLEN];		/* conversion, for SQL_BIND_TEXT */
+};
+
 /* Backend descriptors */
 struct DBdesc {
   void *desc;
@@ -300,6 +343,12 @@ EXT void count_flows_setclause_handler(const struct db_cache *, struct insert_da
 EXT void count_tcpflags_setclause_handler(const struct db_cache *, struct insert_data *, int, char **, char **);
 EXT void count_noop_setclause_handler(const struct db_cache *, struct insert_data *, int, char **, char **);
 EXT void count_noop_setclause_event_handler(const struct db_cache *, struct insert_data *, int, char **, char **);
+
+EXT struct sql_bind_native *sql_bind_lookup(dbop_handler);
+EXT void sql_bind_get_packets(const struct db_cache *, struct insert_data *, int, struct sql_bind_value *);
+EXT void sql_bind_get_bytes(const struct db_cache *, struct insert_data *, int, struct sql_bind_value *);
+EXT void sql_bind_get_flows(const struct db_cache *, struct insert_data *, int, struct sql_bind_value *);
+EXT void sql_bind_get_tcpflags(const struct db_cache *, struct insert_data *, int, struct sql_bind_value *);
 #undef EXT
 
 #if (defined __SQL_COMMON_C)
@@ -322,6 +371,8 @@ EXT void sql_cache_modulo(struct primitives_ptrs *, struct insert_data *);
 EXT int sql_cache_flush(struct db_cache *[], int, struct insert_data *, int);
 EXT int sql_cache_flush_pending(struct db_cache *[], int, struct insert_data *);
 EXT void sql_cache_handle_flush_event(struct insert_data *, time_t *, struct ports_table *);
+EXT void sql_parallel_purge(struct db_cache *[], int, struct insert_data *);
+EXT void sql_parallel_writer(int, struct db_cache *[], int, struct insert_data *, struct sql_writer_report *);
 EXT void sql_cache_insert(struct primitives_ptrs *, struct insert_data *);
 EXT struct db_cache *sql_cache_search(struct primitives_ptrs *, time_t);
 EXT int sql_trigger_exec(char *);
@@ -337,6 +388,8 @@ EXT int sql_select_locking_style(char *);
 EXT int sql_compose_static_set(int); 
 EXT int sql_compose_static_set_event(); 
 EXT void primptrs_set_all_from_db_cache(struct primitives_ptrs *, struct db_cache *);
+EXT int sql_prep_compile(int, int);
+EXT int sql_prep_value(struct sql_prep_field *, const struct db_cache *, struct insert_data *, u_int64_t *, char *, int, int *);
 
 EXT void sql_sum_host_insert(struct primitives_ptrs *, struct insert_data *);
 EXT void sql_sum_port_insert(struct primitives_ptrs *, struct insert_data *);
@@ -382,6 +435,13 @@ EXT struct frags values[N_PRIMITIVES+2];
 EXT struct frags copy_values[N_PRIMITIVES+2];
 EXT struct frags set[N_PRIMITIVES+2];
 EXT struct frags set_event[N_PRIMITIVES+2];
+EXT struct sql_prep_field sql_prep_values[N_PRIMITIVES+8];
+EXT struct sql_prep_field sql_prep_where[N_PRIMITIVES+8];
+EXT struct sql_prep_field sql_prep_set[N_PRIMITIVES+8];
+EXT int sql_prep_values_num, sql_prep_where_num, sql_prep_set_num;
+EXT char sql_prep_values_clause[LONGLONGSRVBUFLEN];
+EXT char sql_prep_where_clause[LONGLONGSRVBUFLEN];
+EXT char sql_prep_set_clause[LONGSRVBUFLEN];
 EXT int glob_num_primitives; /* last resort for signal handling */
 EXT int glob_basetime; /* last resort for signal handling */
 EXT time_t glob_new_basetime; /* last resort for signal handling */
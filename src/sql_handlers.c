@@ -1061,3 +1061,128 @@ void fake_host_aton_handler(const struct db_cache *cache_elem, struct insert_dat
   *ptr_where += strlen(*ptr_where);
   *ptr_values += strlen(*ptr_values);
 }
+
+/*
+  Bind getters next: they supply the native value of a primitive to binary
+  protocols and bound statements, in place of the text rendered by handlers
+*/
+static struct host_addr fake_host_addr = { AF_INET };
+
+#if defined (HAVE_L2)
+static void sql_bind_get_src_mac(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->mac = c->primitives.eth_shost; }
+static void sql_bind_get_dst_mac(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->mac = c->primitives.eth_dhost; }
+static void sql_bind_get_vlan(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->u64 = c->primitives.vlan_id; }
+#endif
+static void sql_bind_get_fake_mac(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v)
+{
+  static const u_char zero_mac[ETH_ADDR_LEN];
+
+  v->mac = zero_mac;
+}
+static void sql_bind_get_src_host(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->addr = &c->primitives.src_ip; }
+static void sql_bind_get_dst_host(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->addr = &c->primitives.dst_ip; }
+static void sql_bind_get_src_net(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->addr = &c->primitives.src_net; }
+static void sql_bind_get_dst_net(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->addr = &c->primitives.dst_net; }
+static void sql_bind_get_peer_src_ip(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->addr = &c->pbgp->peer_src_ip; }
+static void sql_bind_get_peer_dst_ip(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v)
+{
+  /* same as count_peer_dst_ip_handler() */
+  if (c->pbgp->peer_dst_ip.family) v->addr = &c->pbgp->peer_dst_ip;
+  else v->addr = &fake_host_addr;
+}
+static void sql_bind_get_post_nat_src_ip(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->addr = &c->pnat->post_nat_src_ip; }
+static void sql_bind_get_post_nat_dst_ip(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->addr = &c->pnat->post_nat_dst_ip; }
+static void sql_bind_get_fake_host(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->addr = &fake_host_addr; }
+static void sql_bind_get_src_as(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->u64 = c->primitives.src_as; }
+static void sql_bind_get_dst_as(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->u64 = c->primitives.dst_as; }
+static void sql_bind_get_peer_src_as(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->u64 = c->pbgp->peer_src_as; }
+static void sql_bind_get_peer_dst_as(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->u64 = c->pbgp->peer_dst_as; }
+static void sql_bind_get_fake_as(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->u64 = 0; }
+static void sql_bind_get_in_iface(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->u64 = c->primitives.ifindex_in; }
+static void sql_bind_get_out_iface(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->u64 = c->primitives.ifindex_out; }
+static void sql_bind_get_src_nmask(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->u64 = c->primitives.src_nmask; }
+static void sql_bind_get_dst_nmask(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->u64 = c->primitives.dst_nmask; }
+static void sql_bind_get_src_port(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->u64 = c->primitives.src_port; }
+static void sql_bind_get_dst_port(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->u64 = c->primitives.dst_port; }
+static void sql_bind_get_tos(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->u64 = c->primitives.tos; }
+static void sql_bind_get_proto(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->u64 = c->primitives.proto; }
+static void sql_bind_get_tag(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->u64 = c->primitives.tag; }
+static void sql_bind_get_tag2(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->u64 = c->primitives.tag2; }
+static void sql_bind_get_sampling_rate(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->u64 = c->primitives.sampling_rate; }
+void sql_bind_get_packets(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->u64 = c->packet_counter; }
+void sql_bind_get_bytes(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->u64 = c->bytes_counter; }
+void sql_bind_get_flows(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->u64 = c->flows_counter; }
+void sql_bind_get_tcpflags(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->u64 = c->tcp_flags; }
+
+/* stamp_updated, stamp_inserted */
+static void sql_bind_get_history(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v)
+{
+  v->t = (sub ? c->basetime : idata->now);
+  v->u64 = v->t;
+}
+
+static void sql_bind_get_timestamp_start(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->t = c->pnat->timestamp_start.tv_sec; v->u64 = v->t; }
+static void sql_bind_get_timestamp_end(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->t = c->pnat->timestamp_end.tv_sec; v->u64 = v->t; }
+static void sql_bind_get_timestamp_arrival(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->t = c->pnat->timestamp_arrival.tv_sec; v->u64 = v->t; }
+static void sql_bind_get_timestamp_min(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->t = c->stitch->timestamp_min.tv_sec; v->u64 = v->t; }
+static void sql_bind_get_timestamp_max(const struct db_cache *c, struct insert_data *idata, int sub, struct sql_bind_value *v) { v->t = c->stitch->timestamp_max.tv_sec; v->u64 = v->t; }
+
+/* primitives not listed here are rendered by their SQL handler and sent as text */
+static struct sql_bind_native sql_bind_natives[] = {
+#if defined (HAVE_L2)
+  { count_src_mac_handler, SQL_BIND_MAC, sql_bind_get_src_mac },
+  { count_dst_mac_handler, SQL_BIND_MAC, sql_bind_get_dst_mac },
+  { count_vlan_handler, SQL_BIND_INT, sql_bind_get_vlan },
+#endif
+  { fake_mac_handler, SQL_BIND_MAC, sql_bind_get_fake_mac },
+  { count_src_host_handler, SQL_BIND_ADDR, sql_bind_get_src_host },
+  { count_dst_host_handler, SQL_BIND_ADDR, sql_bind_get_dst_host },
+  { count_src_net_handler, SQL_BIND_ADDR, sql_bind_get_src_net },
+  { count_dst_net_handler, SQL_BIND_ADDR, sql_bind_get_dst_net },
+  { count_peer_src_ip_handler, SQL_BIND_ADDR, sql_bind_get_peer_src_ip },
+  { count_peer_dst_ip_handler, SQL_BIND_ADDR, sql_bind_get_peer_dst_ip },
+  { count_post_nat_src_ip_handler, SQL_BIND_ADDR, sql_bind_get_post_nat_src_ip },
+  { count_post_nat_dst_ip_handler, SQL_BIND_ADDR, sql_bind_get_post_nat_dst_ip },
+  { fake_host_handler, SQL_BIND_ADDR, sql_bind_get_fake_host },
+  { count_src_as_handler, SQL_BIND_INT, sql_bind_get_src_as },
+  { count_dst_as_handler, SQL_BIND_INT, sql_bind_get_dst_as },
+  { count_peer_src_as_handler, SQL_BIND_INT, sql_bind_get_peer_src_as },
+  { count_peer_dst_as_handler, SQL_BIND_INT, sql_bind_get_peer_dst_as },
+  { fake_as_handler, SQL_BIND_INT, sql_bind_get_fake_as },
+  { count_in_iface_handler, SQL_BIND_INT, sql_bind_get_in_iface },
+  { count_out_iface_handler, SQL_BIND_INT, sql_bind_get_out_iface },
+  { count_src_nmask_handler, SQL_BIND_INT, sql_bind_get_src_nmask },
+  { count_dst_nmask_handler, SQL_BIND_INT, sql_bind_get_dst_nmask },
+  { count_src_port_handler, SQL_BIND_INT, sql_bind_get_src_port },
+  { count_dst_port_handler, SQL_BIND_INT, sql_bind_get_dst_port },
+  { count_tcpflags_handler, SQL_BIND_INT, sql_bind_get_tcpflags },
+  { count_ip_tos_handler, SQL_BIND_INT, sql_bind_get_tos },
+  { PG_count_ip_proto_handler, SQL_BIND_INT, sql_bind_get_proto },
+  { count_tag_handler, SQL_BIND_INT, sql_bind_get_tag },
+  { count_tag2_handler, SQL_BIND_INT, sql_bind_get_tag2 },
+  { count_sampling_rate_handler, SQL_BIND_INT, sql_bind_get_sampling_rate },
+  { count_copy_timestamp_handler, SQL_BIND_TIME, sql_bind_get_history },
+  { count_timestamp_handler, SQL_BIND_INT, sql_bind_get_history },
+  { PG_copy_count_timestamp_start_handler, SQL_BIND_TIME, sql_bind_get_timestamp_start },
+  { count_timestamp_start_handler, SQL_BIND_INT, sql_bind_get_timestamp_start },
+  { PG_copy_count_timestamp_end_handler, SQL_BIND_TIME, sql_bind_get_timestamp_end },
+  { count_timestamp_end_handler, SQL_BIND_INT, sql_bind_get_timestamp_end },
+  { PG_copy_count_timestamp_arrival_handler, SQL_BIND_TIME, sql_bind_get_timestamp_arrival },
+  { count_timestamp_arrival_handler, SQL_BIND_INT, sql_bind_get_timestamp_arrival },
+  { PG_copy_count_timestamp_min_handler, SQL_BIND_TIME, sql_bind_get_timestamp_min },
+  { count_timestamp_min_handler, SQL_BIND_INT, sql_bind_get_timestamp_min },
+  { PG_copy_count_timestamp_max_handler, SQL_BIND_TIME, sql_bind_get_timestamp_max },
+  { count_timestamp_max_handler, SQL_BIND_INT, sql_bind_get_timestamp_max },
+  { NULL, 0, NULL }
+};
+
+struct sql_bind_native *sql_bind_lookup(dbop_handler handler)
+{
+  int idx;
+
+  for (idx = 0; sql_bind_natives[idx].handler; idx++) {
+    if (sql_bind_natives[idx].handler == handler) return &sql_bind_natives[idx];
+  }
+
+  return NULL;
+}
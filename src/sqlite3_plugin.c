@@ -198,6 +198,7 @@ void sqlite3_plugin(int pipe_fd, struct configuration *cfgptr, void *ptr)
         pollagain = FALSE;
         memcpy(pipebuf, rg->ptr, bufsz);
         rg->ptr += bufsz;
+        stats_shm_update_ring_rd(((struct ch_buf_hdr *) pipebuf)->seq);
       }
 #ifdef WITH_RABBITMQ
       else {
@@ -283,6 +284,9 @@ int SQLI_cache_dbop(struct DBdesc *db, struct db_cache *cache_elem, struct inser
 
     return FALSE;
   }
+
+  if (config.sql_prepared_statements && cache_elem->flow_type != NF9_FTYPE_EVENT &&
+      cache_elem->flow_type != NF9_FTYPE_OPTION) return SQLI_cache_dbop_prepared(db, cache_elem, idata);
   
   if (config.what_to_count & COUNT_FLOWS) have_flows = TRUE;
 
@@ -406,6 +410,99 @@ int SQLI_cache_dbop(struct DBdesc *db, struct db_cache *cache_elem, struct inser
   return ret;
 }
 
+/*
+  Same as SQLI_cache_dbop() but UPDATE and INSERT are prepared once per table
+  and only the values of the cache entry are bound for each of them.
+*/
+int SQLI_cache_dbop_prepared(struct DBdesc *db, struct db_cache *cache_elem, struct insert_data *idata)
+{
+  struct SQLI_prep *prep = (db->type == BE_TYPE_PRIMARY ? &SQLI_prep_p : &SQLI_prep_b);
+  int ret = SQLITE_OK, updated = FALSE;
+
+  /* table name may change across purges with dynamic tables */
+  if (strncmp(prep->key, insert_clause, sizeof(prep->key))) {
+    SQLI_prep_finalize(prep);
+
+    snprintf(sql_data, sizeof(sql_data), "%s%s%s", insert_clause, insert_counters_clause, sql_prep_values_clause);
+    if ((ret = sqlite3_prepare_v2(db->desc, sql_data, -1, &prep->insert, NULL))) goto signal_error;
+
+    if (!config.sql_dont_try_update && sql_prep_set_num) {
+      snprintf(sql_data, sizeof(sql_data), "%s%s%s", update_clause, sql_prep_set_clause, sql_prep_where_clause);
+      if ((ret = sqlite3_prepare_v2(db->desc, sql_data, -1, &prep->update, NULL))) goto signal_error;
+    }
+
+    strlcpy(prep->key, insert_clause, sizeof(prep->key));
+  }
+
+  if (prep->update) {
+    if ((ret = SQLI_prep_bind(prep->update, sql_prep_set, sql_prep_set_num, 0, cache_elem, idata))) goto signal_error;
+    if ((ret = SQLI_prep_bind(prep->update, sql_prep_where, sql_prep_where_num, sql_prep_set_num, cache_elem, idata))) goto signal_error;
+    if ((ret = sqlite3_step(prep->update)) != SQLITE_DONE) goto signal_error;
+    sqlite3_reset(prep->update);
+    ret = SQLITE_OK;
+
+    if (sqlite3_changes(db->desc)) updated = TRUE;
+  }
+
+  if (!updated) {
+    if ((ret = SQLI_prep_bind(prep->insert, sql_prep_values, sql_prep_values_num, 0, cache_elem, idata))) goto signal_error;
+    if ((ret = sqlite3_step(prep->insert)) != SQLITE_DONE) goto signal_error;
+    sqlite3_reset(prep->insert);
+    ret = SQLITE_OK;
+    idata->iqn++;
+  }
+  else idata->uqn++;
+
+  idata->een++;
+
+  return ret;
+
+  signal_error:
+  SQLI_get_errmsg(db);
+  if (db->errmsg) Log(LOG_ERR, "ERROR ( %s/%s ): %s\n\n", config.name, config.type, db->errmsg);
+  if (prep->update) sqlite3_reset(prep->update);
+  if (prep->insert) sqlite3_reset(prep->insert);
+  if (!prep->key[0]) {
+    Log(LOG_DEBUG, "DEBUG ( %s/%s ): FAILED query follows:\n%s\n", config.name, config.type, sql_data);
+    SQLI_prep_finalize(prep);
+  }
+
+  return ret;
+}
+
+/* placeholders are numbered from 1 on; 'offset' accounts for earlier ones */
+int SQLI_prep_bind(sqlite3_stmt *stmt, struct sql_prep_field *fields, int num, int offset, struct db_cache *cache_elem, struct insert_data *idata)
+{
+  char buf[LONGSRVBUFLEN];
+  u_int64_t ival;
+  int idx, len, ret;
+
+  for (idx = 0; idx < num; idx++) {
+    switch (sql_prep_value(&fields[idx], cache_elem, idata, &ival, buf, sizeof(buf), &len)) {
+    case SQL_BIND_INT:
+      ret = sqlite3_bind_int64(stmt, offset+idx+1, (sqlite3_int64) ival);
+      break;
+    case SQL_BIND_TEXT:
+      ret = sqlite3_bind_text(stmt, offset+idx+1, buf, len, SQLITE_TRANSIENT);
+      break;
+    default:
+      ret = SQLITE_MISUSE;
+      break;
+    }
+
+    if (ret != SQLITE_OK) return ret;
+  }
+
+  return SQLITE_OK;
+}
+
+void SQLI_prep_finalize(struct SQLI_prep *prep)
+{
+  if (prep->insert) sqlite3_finalize(prep->insert);
+  if (prep->update) sqlite3_finalize(prep->update);
+  memset(prep, 0, sizeof(struct SQLI_prep));
+}
+
 void SQLI_cache_purge(struct db_cache *queue[], int index, struct insert_data *idata)
 {
   struct db_cache *LastElemCommitted = NULL;
@@ -632,6 +729,11 @@ int SQLI_compose_static_queries()
     }
   }
 
+  if (config.sql_prepared_statements && sql_prep_compile(primitives, have_flows) == ERR) {
+    Log(LOG_WARNING, "WARN ( %s/%s ): sql_prepared_statements disabled.\n", config.name, config.type);
+    config.sql_prepared_statements = FALSE;
+  }
+
   return primitives;
 }
 
@@ -666,6 +768,9 @@ void SQLI_DB_Connect(struct DBdesc *db, char *host)
 
 void SQLI_DB_Close(struct BE_descs *bed)
 {
+  SQLI_prep_finalize(&SQLI_prep_p);
+  SQLI_prep_finalize(&SQLI_prep_b);
+
   if (bed->p->connected) sqlite3_close(bed->p->desc);
   if (bed->b->connected) sqlite3_close(bed->b->desc);
 }
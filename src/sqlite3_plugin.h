@@ -22,9 +22,19 @@
 /* includes */
 #include <sqlite3.h>
 
+/* structures */
+struct SQLI_prep {
+  char key[LONGSRVBUFLEN];	/* insert_clause the statements were prepared for */
+  sqlite3_stmt *insert;
+  sqlite3_stmt *update;
+};
+
 /* prototypes */
 void sqlite3_plugin(int, struct configuration *, void *);
 int SQLI_cache_dbop(struct DBdesc *, struct db_cache *, struct insert_data *);
+int SQLI_cache_dbop_prepared(struct DBdesc *, struct db_cache *, struct insert_data *);
+int SQLI_prep_bind(sqlite3_stmt *, struct sql_prep_field *, int, int, struct db_cache *, struct insert_data *);
+void SQLI_prep_finalize(struct SQLI_prep *);
 void SQLI_cache_purge(struct db_cache *[], int, struct insert_data *);
 int SQLI_evaluate_history(int);
 int SQLI_compose_static_queries();
@@ -49,3 +59,4 @@ static char sqlite3_table_v6[] = "acct_v6";
 static char sqlite3_table_v7[] = "acct_v7";
 static char sqlite3_table_v8[] = "acct_v8";
 static char sqlite3_table_bgp[] = "acct_bgp";
+static struct SQLI_prep SQLI_prep_p, SQLI_prep_b;
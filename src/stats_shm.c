@@ -0,0 +1,280 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2017 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+#define __STATS_SHM_C
+
+/* includes */
+#include "pmacct.h"
+#include "plugin_hooks.h"
+#include "pkt_handlers.h"
+#include "bgp/bgp.h"
+#include "bmp/bmp.h"
+#if defined ENABLE_THREADS
+#include "thread_pool.h"
+#endif
+
+/* variables */
+#if defined ENABLE_THREADS
+thread_pool_t *stats_shm_pool;
+#endif
+static u_int32_t stats_shm_plugins_max;
+extern struct channels_list_entry channels_list[MAX_N_PLUGINS];
+
+/* functions */
+static void stats_shm_gen_begin(u_int32_t *gen)
+{
+  __sync_fetch_and_add(gen, 1);
+  __sync_synchronize();
+}
+
+/*
+   Plugin slots have more than one writer: the plugin itself and the writer
+   processes it forks at purge time, which may overlap. Each takes the
+   generation from even to odd with a CAS, hence writers are serialized; an
+   update is given up, rather than waited for forever, if the generation
+   stays odd, ie. a writer was killed half way through.
+*/
+static int stats_shm_gen_begin_shared(u_int32_t *gen)
+{
+  u_int32_t cur;
+  int tries;
+
+  for (tries = 0; tries < STATS_SHM_GEN_TRIES; tries++) {
+    cur = *((volatile u_int32_t *) gen);
+    if (!(cur & 1) && __sync_bool_compare_and_swap(gen, cur, (cur + 1))) return TRUE;
+
+    usleep(1);
+  }
+
+  return FALSE;
+}
+
+static void stats_shm_gen_end(u_int32_t *gen)
+{
+  __sync_synchronize();
+  __sync_fetch_and_add(gen, 1);
+}
+
+int stats_shm_init(int plugins_num)
+{
+  u_int32_t seg_len;
+  int fd;
+
+  if (!config.stats_shm_file) return FALSE;
+
+  seg_len = sizeof(struct stats_shm_hdr);
+  seg_len += plugins_num * sizeof(struct stats_shm_plugin);
+  seg_len += STATS_SHM_MAX_EXPORTERS * sizeof(struct stats_shm_exporter);
+
+  fd = open(config.stats_shm_file, (O_RDWR|O_CREAT|O_TRUNC), (S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH));
+  if (fd == ERR) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): stats_shm_init(): unable to open '%s': %s\n", config.name, config.type, config.stats_shm_file, strerror(errno));
+    return ERR;
+  }
+
+  if (ftruncate(fd, seg_len) == ERR) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): stats_shm_init(): unable to size '%s': %s\n", config.name, config.type, config.stats_shm_file, strerror(errno));
+    close(fd);
+    return ERR;
+  }
+
+  stats_shm = mmap(NULL, seg_len, (PROT_READ|PROT_WRITE), MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (stats_shm == MAP_FAILED) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): stats_shm_init(): unable to mmap '%s': %s\n", config.name, config.type, config.stats_shm_file, strerror(errno));
+    stats_shm = NULL;
+    return ERR;
+  }
+
+  memset(stats_shm, 0, seg_len);
+  stats_shm->version = STATS_SHM_VERSION;
+  stats_shm->hdr_len = sizeof(struct stats_shm_hdr);
+  stats_shm->seg_len = seg_len;
+  strlcpy(stats_shm->name, config.name, STATS_SHM_MAX_NAME_LEN);
+  stats_shm->core_pid = getpid();
+  stats_shm->acct_type = config.acct_type;
+  stats_shm->started = time(NULL);
+
+  stats_shm->plugins_off = sizeof(struct stats_shm_hdr);
+  stats_shm->plugins_slot_len = sizeof(struct stats_shm_plugin);
+  stats_shm->exporters_off = stats_shm->plugins_off + (plugins_num * sizeof(struct stats_shm_plugin));
+  stats_shm->exporters_slot_len = sizeof(struct stats_shm_exporter);
+  stats_shm->exporters_max = STATS_SHM_MAX_EXPORTERS;
+  stats_shm_plugins_max = plugins_num;
+
+  if (!config.stats_shm_refresh_time) config.stats_shm_refresh_time = DEFAULT_STATS_SHM_REFRESH_TIME;
+
+  /* magic goes last: readers can tell a segment is ready to be parsed */
+  __sync_synchronize();
+  stats_shm->magic = STATS_SHM_MAGIC;
+
+  Log(LOG_INFO, "INFO ( %s/%s ): statistics segment '%s' initialized (%u bytes)\n", config.name, config.type, config.stats_shm_file, seg_len);
+
+  return TRUE;
+}
+
+struct stats_shm_plugin *stats_shm_plugin_slot(int idx, char *name, char *type)
+{
+  struct stats_shm_plugin *slot;
+
+  if (!stats_shm || idx >= stats_shm_plugins_max) return NULL;
+
+  slot = (struct stats_shm_plugin *) ((char *)stats_shm + stats_shm->plugins_off + (idx * stats_shm->plugins_slot_len));
+  strlcpy(slot->name, name, STATS_SHM_MAX_NAME_LEN);
+  strlcpy(slot->type, type, STATS_SHM_MAX_NAME_LEN);
+  if (idx >= stats_shm->plugins_num) stats_shm->plugins_num = idx+1;
+
+  return slot;
+}
+
+static void stats_shm_updater()
+{
+  for (;;) {
+    stats_shm_update();
+    sleep(config.stats_shm_refresh_time);
+  }
+}
+
+void stats_shm_wrapper()
+{
+  if (!stats_shm) return;
+
+#if defined ENABLE_THREADS
+  stats_shm_pool = allocate_thread_pool(1);
+  assert(stats_shm_pool);
+
+  send_to_pool(stats_shm_pool, stats_shm_updater, NULL);
+#else
+  Log(LOG_WARNING, "WARN ( %s/%s ): statistics segment is refreshed only at startup: threads support (--enable-threads) is missing.\n",
+	config.name, config.type);
+  stats_shm_update();
+#endif
+}
+
+/*
+   Runs in its own thread in the Core Process: it only reads counters that
+   the data path maintains anyway, so it adds nothing to the hot path. The
+   xFlow status table is walked under its lock; BGP/BMP peers are not walked
+   at all, their threads publish counters instead.
+*/
+void stats_shm_update()
+{
+  struct stats_shm_exporter *exp;
+  struct xflow_status_entry *entry;
+  int idx, exp_idx;
+
+  if (!stats_shm) return;
+
+  stats_shm_gen_begin(&stats_shm->gen);
+
+  for (idx = 0; channels_list[idx].aggregation || channels_list[idx].aggregation_2; idx++) {
+    struct stats_shm_plugin *slot = channels_list[idx].stats;
+
+    if (!slot) continue;
+
+    slot->pid = channels_list[idx].plugin->pid;
+    slot->ring_size = channels_list[idx].plugin->cfg.pipe_size;
+    slot->buffer_size = channels_list[idx].plugin->cfg.buffer_size;
+    slot->ring_wr_off = channels_list[idx].status->last_buf_off;
+    slot->ring_wr_seq = channels_list[idx].hdr.seq;
+    slot->ring_backlog = channels_list[idx].status->backlog;
+    slot->sampling_rate = channels_list[idx].s.rate;
+    slot->sampling_pool = channels_list[idx].s.pool_tot;
+    slot->sampling_sampled = channels_list[idx].s.sampled_tot;
+  }
+
+  if (config.acct_type == ACCT_NF || config.acct_type == ACCT_SF) {
+    exp = (struct stats_shm_exporter *) ((char *)stats_shm + stats_shm->exporters_off);
+
+    xflow_status_table_lock();
+
+    for (idx = 0, exp_idx = 0; idx < XFLOW_STATUS_TABLE_SZ && exp_idx < stats_shm->exporters_max; idx++) {
+      for (entry = xflow_status_table[idx]; entry && exp_idx < stats_shm->exporters_max; entry = entry->next, exp_idx++) {
+	memcpy(&exp[exp_idx].agent_addr, &entry->agent_addr, sizeof(struct host_addr));
+	exp[exp_idx].aux1 = entry->aux1;
+	exp[exp_idx].aux2 = entry->aux2;
+	memcpy(&exp[exp_idx].counters, &entry->counters, sizeof(struct xflow_status_entry_counters));
+      }
+    }
+
+    stats_shm->exporters_tot = xflow_status_table_entries;
+
+    xflow_status_table_unlock();
+
+    stats_shm->exporters_num = exp_idx;
+    stats_shm->xflow_bad_datagrams = xflow_tot_bad_datagrams;
+  }
+
+  /* peers are owned by the BGP/BMP threads, which publish their counters */
+  if (config.nfacctd_bgp) {
+    stats_shm->bgp_peers = bgp_peers_num;
+    stats_shm->bgp_peers_established = bgp_peers_established;
+  }
+
+  if (config.nfacctd_bmp) stats_shm->bmp_peers = bmp_peers_num;
+
+  stats_shm->enrich_computed = enrich_stats.computed;
+  stats_shm->enrich_reused = enrich_stats.reused;
+
+  stats_shm->updated = time(NULL);
+
+  stats_shm_gen_end(&stats_shm->gen);
+}
+
+/* plugin side */
+void stats_shm_update_ring_rd(u_int32_t seq)
+{
+  if (!stats_shm_plugin) return;
+
+  if (!stats_shm_gen_begin_shared(&stats_shm_plugin->gen)) return;
+  stats_shm_plugin->ring_rd_seq = seq;
+  stats_shm_gen_end(&stats_shm_plugin->gen);
+}
+
+void stats_shm_update_cache(u_int32_t entries, u_int32_t size)
+{
+  if (!stats_shm_plugin) return;
+
+  if (!stats_shm_gen_begin_shared(&stats_shm_plugin->gen)) return;
+  stats_shm_plugin->cache_entries = entries;
+  stats_shm_plugin->cache_size = size;
+  stats_shm_gen_end(&stats_shm_plugin->gen);
+}
+
+/* called by writer processes once the purge is complete */
+void stats_shm_update_purge(struct timeval *start)
+{
+  struct timeval end;
+  u_int32_t delta;
+
+  if (!stats_shm_plugin) return;
+
+  gettimeofday(&end, NULL);
+  delta = (end.tv_sec - start->tv_sec) * 1000000 + (end.tv_usec - start->tv_usec);
+
+  if (!stats_shm_gen_begin_shared(&stats_shm_plugin->gen)) return;
+  stats_shm_plugin->purges++;
+  stats_shm_plugin->purge_last = start->tv_sec;
+  stats_shm_plugin->purge_last_usecs = delta;
+  if (delta > stats_shm_plugin->purge_max_usecs) stats_shm_plugin->purge_max_usecs = delta;
+  stats_shm_gen_end(&stats_shm_plugin->gen);
+}
@@ -0,0 +1,124 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2017 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+/* defines */
+#define STATS_SHM_MAGIC			0x504d5354	/* "PMST" */
+#define STATS_SHM_VERSION		2
+#define STATS_SHM_MAX_EXPORTERS		1024
+#define STATS_SHM_MAX_NAME_LEN		32
+#define DEFAULT_STATS_SHM_REFRESH_TIME	5	/* secs */
+#define STATS_SHM_GEN_TRIES		1000	/* plugin slot writers waiting on each other */
+
+/*
+   Layout of the segment: a header followed by an array of plugin slots
+   and an array of exporter slots; offsets and slot sizes are published
+   in the header so that readers can cope with future (appended) fields.
+   Every area is guarded by a generation counter, seqlock style: it is
+   odd while the area is being written; readers copy the area and retry
+   if the counter was odd or has changed meanwhile. The Core Process never
+   waits; a plugin slot is written by the plugin and by its purge writer
+   processes, which take the counter with a compare-and-swap and briefly
+   wait for each other.
+*/
+struct stats_shm_plugin {
+  u_int32_t gen;			/* guards fields written by the plugin */
+  char name[STATS_SHM_MAX_NAME_LEN];
+  char type[STATS_SHM_MAX_NAME_LEN];
+  pid_t pid;
+
+  /* written by the Core Process, guarded by stats_shm_hdr.gen */
+  u_int64_t ring_size;			/* plugin_pipe_size */
+  u_int64_t buffer_size;		/* plugin_buffer_size */
+  u_int64_t ring_wr_off;		/* offset of last committed buffer */
+  u_int32_t ring_wr_seq;		/* sequence number of last committed buffer */
+  u_int32_t ring_backlog;		/* ch_status backlog */
+
+  /* written by the plugin; backlog, in buffers, is ring_wr_seq - ring_rd_seq */
+  u_int32_t ring_rd_seq;		/* sequence number of last buffer read */
+  u_int32_t cache_size;			/* max cache entries, if any */
+  u_int32_t cache_entries;		/* cache entries at last purge */
+  u_int32_t purges;
+  u_int32_t purge_last;			/* timestamp of last purge start */
+  u_int32_t purge_last_usecs;		/* duration of last purge */
+  u_int32_t purge_max_usecs;
+
+  /* written by the Core Process, guarded by stats_shm_hdr.gen */
+  u_int64_t sampling_rate;		/* configured, 0 if disabled */
+  u_int64_t sampling_pool;		/* packets seen by the sampler */
+  u_int64_t sampling_sampled;		/* packets sampled; effective rate is pool/sampled */
+};
+
+struct stats_shm_exporter {
+  struct host_addr agent_addr;
+  u_int32_t aux1;
+  u_int32_t aux2;
+  struct xflow_status_entry_counters counters;
+};
+
+struct stats_shm_hdr {
+  u_int32_t magic;
+  u_int16_t version;
+  u_int16_t hdr_len;
+  u_int32_t seg_len;
+  u_int32_t gen;
+  char name[STATS_SHM_MAX_NAME_LEN];	/* core process name */
+  pid_t core_pid;
+  u_int32_t acct_type;			/* ACCT_PM, ACCT_NF, etc. */
+  u_int32_t started;
+  u_int32_t updated;
+
+  u_int32_t plugins_off;
+  u_int32_t plugins_slot_len;
+  u_int32_t plugins_num;
+
+  u_int32_t exporters_off;
+  u_int32_t exporters_slot_len;
+  u_int32_t exporters_max;
+  u_int32_t exporters_num;		/* exporters in the segment */
+  u_int32_t exporters_tot;		/* exporters known to the Core Process */
+  u_int32_t xflow_bad_datagrams;
+
+  u_int32_t bgp_peers;
+  u_int32_t bgp_peers_established;
+  u_int32_t bmp_peers;
+
+  /* enrichment lookups shared across plugin channels, see exec_plugins() */
+  u_int64_t enrich_computed;
+  u_int64_t enrich_reused;
+};
+
+/* prototypes */
+#if (!defined __STATS_SHM_C)
+#define EXT extern
+#else
+#define EXT
+#endif
+EXT int stats_shm_init(int);
+EXT struct stats_shm_plugin *stats_shm_plugin_slot(int, char *, char *);
+EXT void stats_shm_wrapper();
+EXT void stats_shm_update();
+EXT void stats_shm_update_ring_rd(u_int32_t);
+EXT void stats_shm_update_cache(u_int32_t, u_int32_t);
+EXT void stats_shm_update_purge(struct timeval *);
+
+EXT struct stats_shm_hdr *stats_shm;
+EXT struct stats_shm_plugin *stats_shm_plugin;	/* plugins: own slot */
+#undef EXT
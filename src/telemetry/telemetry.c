@@ -38,6 +38,34 @@
 /* variables to be exported away */
 thread_pool_t *telemetry_pool;
 
+#if defined ENABLE_THREADS
+/* work items handed over by the reader to the workers */
+#define TELEMETRY_WORK_DATA	0
+#define TELEMETRY_WORK_CLOSE	1
+
+struct telemetry_work {
+  struct telemetry_work *next;
+  int peers_idx;
+  u_int8_t type;
+  char *base;			/* TELEMETRY_WORK_DATA: receive buffer, owned by the item */
+  u_int32_t base_len;		/* TELEMETRY_WORK_DATA: size of base */
+  u_int32_t len;		/* TELEMETRY_WORK_DATA: framed bytes in base */
+  u_int32_t frames_num;		/* TELEMETRY_WORK_DATA: frames following the header */
+};
+
+struct telemetry_worker {
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  struct telemetry_work *head;
+  struct telemetry_work *tail;
+  struct telemetry_data *t_data;
+};
+
+static thread_pool_t *telemetry_workers_pool;
+static struct telemetry_worker *telemetry_workers;
+static pthread_mutex_t telemetry_output_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
 /* Functions */
 #if defined ENABLE_THREADS
 void telemetry_wrapper()
@@ -61,14 +89,285 @@ void telemetry_wrapper()
 }
 #endif
 
+/*
+   Log/dump backends, log sequence and peer stats are shared by all peers:
+   with workers, whoever touches them (workers decoding messages, the reader
+   accepting peers, logging stats or dumping) has to hold the output lock.
+*/
+void telemetry_output_lock()
+{
+#if defined ENABLE_THREADS
+  if (telemetry_workers) pthread_mutex_lock(&telemetry_output_mutex);
+#endif
+}
+
+void telemetry_output_unlock()
+{
+#if defined ENABLE_THREADS
+  if (telemetry_workers) pthread_mutex_unlock(&telemetry_output_mutex);
+#endif
+}
+
+#if defined ENABLE_THREADS
+static void telemetry_worker_thread(struct telemetry_worker *w)
+{
+  struct telemetry_work *item;
+  struct telemetry_frame *frames;
+  telemetry_peer *peer;
+  telemetry_peer_z *peer_z;
+  telemetry_peer_rx *peer_rx;
+
+  for (;;) {
+    pthread_mutex_lock(&w->mutex);
+    while (!w->head) pthread_cond_wait(&w->cond, &w->mutex);
+
+    item = w->head;
+    w->head = item->next;
+    if (!w->head) w->tail = NULL;
+    pthread_mutex_unlock(&w->mutex);
+
+    peer = &telemetry_peers[item->peers_idx];
+    peer_z = (telemetry_peers_z ? &telemetry_peers_z[item->peers_idx] : NULL);
+    peer_rx = &telemetry_peers_rx[item->peers_idx];
+
+    if (item->type == TELEMETRY_WORK_DATA) {
+      /* decompression and validation run unlocked, the lock is taken per message for output */
+      frames = (struct telemetry_frame *) (item + 1);
+      telemetry_process_frames(peer, peer_z, peer_rx, w->t_data, item->base, frames, item->frames_num);
+
+      /* hand the buffer back to the reader for its next read */
+      pthread_mutex_lock(&w->mutex);
+      if (!peer_rx->spare) {
+	peer_rx->spare = item->base;
+	peer_rx->spare_len = item->base_len;
+      }
+      else free(item->base);
+      pthread_mutex_unlock(&w->mutex);
+
+      __sync_fetch_and_sub(&peer_rx->queued, item->len);
+    }
+    else if (item->type == TELEMETRY_WORK_CLOSE) {
+      telemetry_output_lock();
+      telemetry_peer_close(peer, FUNC_TYPE_TELEMETRY);
+      telemetry_output_unlock();
+      if (peer_z) telemetry_peer_z_close(peer_z);
+
+      /* slot can be reused by the reader from now on */
+      __sync_synchronize();
+      peer_rx->closing = FALSE;
+    }
+
+    free(item);
+  }
+}
+
+static void telemetry_workers_init(struct telemetry_data *t_data)
+{
+  int idx;
+
+  telemetry_workers = malloc(config.telemetry_threads * sizeof(struct telemetry_worker));
+  if (!telemetry_workers) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): Unable to malloc() telemetry workers. Terminating.\n", config.name, t_data->log_str);
+    exit_all(1);
+  }
+
+  telemetry_workers_pool = allocate_thread_pool(config.telemetry_threads);
+  assert(telemetry_workers_pool);
+
+  for (idx = 0; idx < config.telemetry_threads; idx++) {
+    pthread_mutex_init(&telemetry_workers[idx].mutex, NULL);
+    pthread_cond_init(&telemetry_workers[idx].cond, NULL);
+    telemetry_workers[idx].head = NULL;
+    telemetry_workers[idx].tail = NULL;
+    telemetry_workers[idx].t_data = t_data;
+
+    send_to_pool(telemetry_workers_pool, telemetry_worker_thread, &telemetry_workers[idx]);
+  }
+
+  Log(LOG_INFO, "INFO ( %s/%s ): %d telemetry worker thread(s) initialized\n", config.name, t_data->log_str, config.telemetry_threads);
+}
+
+/*
+   messages of a peer always go to the same worker, hence are processed in order;
+   framed data is not copied: the buffer it lives in is handed over to the worker
+*/
+static void telemetry_work_enqueue(int peers_idx, u_int8_t type, char *base, u_int32_t base_len, u_int32_t len, struct telemetry_frame *frames, u_int32_t frames_num)
+{
+  struct telemetry_worker *w = &telemetry_workers[peers_idx % config.telemetry_threads];
+  struct telemetry_work *item;
+
+  item = malloc(sizeof(struct telemetry_work) + (frames_num * sizeof(struct telemetry_frame)));
+  if (!item) {
+    Log(LOG_ERR, "ERROR ( %s/core/TELE ): Unable to malloc() telemetry work item. Terminating.\n", config.name);
+    exit_all(1);
+  }
+
+  item->next = NULL;
+  item->peers_idx = peers_idx;
+  item->type = type;
+  item->len = len;
+  item->base = base;
+  item->base_len = base_len;
+  item->frames_num = frames_num;
+  if (len) {
+    memcpy((char *) (item + 1), frames, (frames_num * sizeof(struct telemetry_frame)));
+    __sync_fetch_and_add(&telemetry_peers_rx[peers_idx].queued, len);
+  }
+
+  pthread_mutex_lock(&w->mutex);
+  if (w->tail) w->tail->next = item;
+  else w->head = item;
+  w->tail = item;
+  pthread_cond_signal(&w->cond);
+  pthread_mutex_unlock(&w->mutex);
+}
+#endif
+
+static void telemetry_peer_rx_close(int peers_idx, int decoder)
+{
+  telemetry_peer *peer = &telemetry_peers[peers_idx];
+
+  if (config.telemetry_port_udp) {
+    telemetry_peer_udp_cache tpuc;
+
+    memcpy(&tpuc.addr, &peer->addr, sizeof(struct host_addr));
+    pm_tdelete(&tpuc, &telemetry_peers_udp_cache, telemetry_tpuc_addr_cmp);
+  }
+
+#if defined ENABLE_THREADS
+  if (telemetry_workers) {
+    telemetry_peers_rx[peers_idx].closing = TRUE;
+    telemetry_work_enqueue(peers_idx, TELEMETRY_WORK_CLOSE, NULL, 0, 0, NULL, 0);
+    return;
+  }
+#endif
+
+  telemetry_peer_close(peer, FUNC_TYPE_TELEMETRY);
+  if (telemetry_is_zjson(decoder)) telemetry_peer_z_close(&telemetry_peers_z[peers_idx]);
+}
+
+/*
+   Reads from a telemetry peer into its receive buffer, which grows to fit
+   the message being reassembled; one byte is always kept spare so that JSON
+   can be NUL-terminated in place. Whole messages are then framed out and
+   either processed inline or handed over to the peer's worker, the remainder
+   is moved to the head of the buffer. Returns ERR if the session is to be
+   closed.
+*/
+static int telemetry_peer_recv(int peers_idx, int decoder, struct telemetry_data *t_data)
+{
+  telemetry_peer *peer = &telemetry_peers[peers_idx];
+  telemetry_peer_rx *peer_rx = &telemetry_peers_rx[peers_idx];
+  telemetry_peer_z *peer_z = (telemetry_peers_z ? &telemetry_peers_z[peers_idx] : NULL);
+  u_int32_t needed = 0, consumed, remaining_len;
+  int ret;
+
+  if (decoder >= TELEMETRY_DECODER_CISCO && peer->buf.truncated_len >= TELEMETRY_CISCO_HDR_LEN)
+    needed = (TELEMETRY_CISCO_HDR_LEN + telemetry_cisco_hdr_get_len(peer->buf.base) + 1);
+  else if (peer->buf.truncated_len >= (peer->buf.len - 1))
+    needed = (peer->buf.len * 2);
+
+  if (needed > peer->buf.len) {
+    char *new_base;
+
+    if (needed > (TELEMETRY_MAX_MSG_SIZE + TELEMETRY_CISCO_HDR_LEN + 1)) {
+      Log(LOG_INFO, "INFO ( %s/%s ): [%s] telemetry message too big (%u bytes). Closing connection.\n",
+	  config.name, t_data->log_str, peer->addr_str, needed);
+      return ERR;
+    }
+
+    new_base = realloc(peer->buf.base, needed);
+    if (!new_base) {
+      Log(LOG_ERR, "ERROR ( %s/%s ): [%s] Unable to grow telemetry receive buffer (%u bytes). Closing connection.\n",
+	  config.name, t_data->log_str, peer->addr_str, needed);
+      return ERR;
+    }
+
+    peer->buf.base = new_base;
+    peer->buf.len = needed;
+  }
+
+  ret = recv(peer->fd, &peer->buf.base[peer->buf.truncated_len], (peer->buf.len - peer->buf.truncated_len - 1), 0);
+  if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return SUCCESS;
+
+  if (ret <= 0) {
+    Log(LOG_INFO, "INFO ( %s/%s ): [%s] connection reset by peer (%d).\n", config.name, t_data->log_str, peer->addr_str, errno);
+    return ERR;
+  }
+
+  telemetry_output_lock();
+  peer->stats.packets++;
+  peer->stats.packet_bytes += ret;
+  telemetry_output_unlock();
+
+  peer->msglen = (ret + peer->buf.truncated_len);
+
+  /* a datagram can't carry over a partial message */
+  if (telemetry_frame(peer, peer_rx, decoder, (config.telemetry_port_udp ? TRUE : FALSE), &consumed) == ERR) {
+    Log(LOG_INFO, "INFO ( %s/%s ): [%s] telemetry message too big. Closing connection.\n", config.name, t_data->log_str, peer->addr_str);
+    return ERR;
+  }
+
+  remaining_len = (peer->msglen - consumed);
+
+  if (peer_rx->frames_num) {
+#if defined ENABLE_THREADS
+    if (telemetry_workers) {
+      struct telemetry_worker *w = &telemetry_workers[peers_idx % config.telemetry_threads];
+      char *new_base = NULL;
+      u_int32_t new_len = peer->buf.len;
+
+      /*
+	 the buffer goes along with its frames, the partial tail moves to the
+	 one the worker handed back last, if large enough, or to a fresh one
+      */
+      pthread_mutex_lock(&w->mutex);
+      if (peer_rx->spare) {
+	if (peer_rx->spare_len >= peer->buf.len) {
+	  new_base = peer_rx->spare;
+	  new_len = peer_rx->spare_len;
+	}
+	else free(peer_rx->spare);
+
+	peer_rx->spare = NULL;
+      }
+      pthread_mutex_unlock(&w->mutex);
+
+      if (!new_base) {
+	new_base = malloc(new_len);
+	if (!new_base) {
+	  Log(LOG_ERR, "ERROR ( %s/%s ): [%s] Unable to malloc() telemetry receive buffer. Terminating.\n", config.name, t_data->log_str, peer->addr_str);
+	  exit_all(1);
+	}
+      }
+
+      if (remaining_len) memcpy(new_base, &peer->buf.base[consumed], remaining_len);
+      telemetry_work_enqueue(peers_idx, TELEMETRY_WORK_DATA, peer->buf.base, peer->buf.len, consumed, peer_rx->frames, peer_rx->frames_num);
+
+      peer->buf.base = new_base;
+      peer->buf.len = new_len;
+      peer->buf.truncated_len = remaining_len;
+
+      return SUCCESS;
+    }
+#endif
+    telemetry_process_frames(peer, peer_z, peer_rx, t_data, peer->buf.base, peer_rx->frames, peer_rx->frames_num);
+  }
+
+  if (remaining_len && consumed) memmove(peer->buf.base, &peer->buf.base[consumed], remaining_len);
+  peer->buf.truncated_len = remaining_len;
+
+  return SUCCESS;
+}
+
 void telemetry_daemon(void *t_data_void)
 {
   struct telemetry_data *t_data = t_data_void;
   telemetry_peer_udp_cache tpuc;
 
   int slen, clen, ret, rc, peers_idx, allowed, yes=1, no=0;
-  int peers_idx_rr = 0, max_peers_idx = 0, peers_num = 0;
-  int decoder = 0, data_decoder = 0, recv_flags = 0;
+  int peers_idx_rr = 0, max_peers_idx = 0, peers_num = 0, udp_peers_idx, throttled;
+  int decoder = 0;
   u_int16_t port = 0;
   char *srv_proto = NULL;
   time_t last_udp_timeout_check;
@@ -219,6 +518,15 @@ void telemetry_daemon(void *t_data_void)
     memset(telemetry_peers_z, 0, config.telemetry_max_peers*sizeof(telemetry_peer_z));
   }
 
+  telemetry_peers_rx = malloc(config.telemetry_max_peers*sizeof(telemetry_peer_rx));
+  if (!telemetry_peers_rx) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): Unable to malloc() telemetry_peers_rx structure. Terminating.\n", config.name, t_data->log_str);
+    exit_all(1);
+  }
+  memset(telemetry_peers_rx, 0, config.telemetry_max_peers*sizeof(telemetry_peer_rx));
+
+  if (!config.telemetry_queue_size) config.telemetry_queue_size = TELEMETRY_QUEUE_SIZE_DEFAULT;
+
   if (config.telemetry_port_udp) {
     telemetry_peers_udp_timeout = malloc(config.telemetry_max_peers*sizeof(telemetry_peer_udp_timeout));
     if (!telemetry_peers_udp_timeout) {
@@ -418,6 +726,14 @@ void telemetry_daemon(void *t_data_void)
 
   telemetry_link_misc_structs(telemetry_misc_db);
 
+  if (config.telemetry_threads) {
+#if defined ENABLE_THREADS
+    telemetry_workers_init(t_data);
+#else
+    Log(LOG_WARNING, "WARN ( %s/%s ): 'telemetry_daemon_threads' requires threads support (--enable-threads). Ignored.\n", config.name, t_data->log_str);
+#endif
+  }
+
   for (;;) {
     select_again:
 
@@ -441,6 +757,16 @@ void telemetry_daemon(void *t_data_void)
     else select_fd = bkp_select_fd;
 
     memcpy(&read_descs, &bkp_read_descs, sizeof(bkp_read_descs));
+
+    /* TCP peers whose workers lag behind are not read for a while: TCP pushes back on them only */
+    for (throttled = FALSE, peers_idx = 0; config.telemetry_port_tcp && peers_idx < max_peers_idx; peers_idx++) {
+      if (telemetry_peers[peers_idx].fd && !telemetry_peers_rx[peers_idx].closing &&
+	  telemetry_peers_rx[peers_idx].queued > config.telemetry_queue_size) {
+	FD_CLR(telemetry_peers[peers_idx].fd, &read_descs);
+	throttled = TRUE;
+      }
+    }
+
     if (telemetry_misc_db->dump_backend_methods) {
       int delta;
 
@@ -451,6 +777,12 @@ void telemetry_daemon(void *t_data_void)
     }
     else drt_ptr = NULL;
 
+    if (throttled) {
+      dump_refresh_timeout.tv_sec = 0;
+      dump_refresh_timeout.tv_usec = TELEMETRY_THROTTLE_USECS;
+      drt_ptr = &dump_refresh_timeout;
+    }
+
     select_num = select(select_fd, &read_descs, NULL, NULL, drt_ptr);
     if (select_num < 0) goto select_again;
 
@@ -463,14 +795,12 @@ void telemetry_daemon(void *t_data_void)
 	  telemetry_peer_udp_timeout *peer_udp_timeout;
 
 	  peer = &telemetry_peers[peers_idx];
-	  peer_z = &telemetry_peers_z[peers_idx];
 	  peer_udp_timeout = &telemetry_peers_udp_timeout[peers_idx];
 
-	  if (peer->fd) {
+	  if (peer->fd && !telemetry_peers_rx[peers_idx].closing) {
 	    if (t_data->now > (peer_udp_timeout->last_msg + config.telemetry_udp_timeout)) {
 	      Log(LOG_INFO, "INFO ( %s/%s ): [%s] telemetry UDP peer removed (timeout).\n", config.name, t_data->log_str, peer->addr_str);
-	      telemetry_peer_close(peer, FUNC_TYPE_TELEMETRY);
-	      if (telemetry_is_zjson(decoder)) telemetry_peer_z_close(peer_z);
+	      telemetry_peer_rx_close(peers_idx, decoder);
 	      recalc_fds = TRUE;
 	    }
 	  }
@@ -479,6 +809,8 @@ void telemetry_daemon(void *t_data_void)
     }
 
     if (reload_log_telemetry_thread) {
+      telemetry_output_lock();
+
       for (peers_idx = 0; peers_idx < config.telemetry_max_peers; peers_idx++) {
         if (telemetry_misc_db->peers_log[peers_idx].fd) {
           fclose(telemetry_misc_db->peers_log[peers_idx].fd);
@@ -488,6 +820,7 @@ void telemetry_daemon(void *t_data_void)
         else break;
       }
 
+      telemetry_output_unlock();
       reload_log_telemetry_thread = FALSE;
     }
 
@@ -502,7 +835,9 @@ void telemetry_daemon(void *t_data_void)
           compose_timestamp(telemetry_misc_db->dump.tstamp_str, SRVBUFLEN, &telemetry_misc_db->dump.tstamp, FALSE, config.timestamps_since_epoch);
 	  telemetry_misc_db->dump.period = config.telemetry_dump_refresh_time;
 
+          telemetry_output_lock();
           telemetry_handle_dump_event(t_data);
+          telemetry_output_unlock();
           dump_refresh_deadline += config.telemetry_dump_refresh_time;
         }
       }
@@ -534,15 +869,18 @@ void telemetry_daemon(void *t_data_void)
 	telemetry_peer *stats_peer;
 	int peers_idx;
 
+	telemetry_output_lock();
+
 	for (stats_peer = NULL, peers_idx = 0; peers_idx < config.telemetry_max_peers; peers_idx++) {
 	  if (telemetry_peers[peers_idx].fd) {
 	    stats_peer = &telemetry_peers[peers_idx];
-	    telemetry_log_peer_stats(stats_peer, t_data);
+	    telemetry_log_peer_stats(stats_peer, &telemetry_peers_rx[peers_idx], t_data);
 	    stats_peer->stats.last_check = t_data->now;
 	  }
 	}
 
 	telemetry_log_global_stats(t_data);
+	telemetry_output_unlock();
       }
 
       t_data->global_stats.last_check = t_data->now;
@@ -555,6 +893,8 @@ void telemetry_daemon(void *t_data_void)
     */
     if (!select_num) goto select_again;
 
+    udp_peers_idx = ERR;
+
     /* New connection is coming in */
     if (FD_ISSET(config.telemetry_sock, &read_descs)) {
       if (config.telemetry_port_tcp) {
@@ -585,13 +925,15 @@ void telemetry_daemon(void *t_data_void)
       /* XXX: UDP case may be optimized further */
       if (config.telemetry_port_udp) {
 	telemetry_peer_udp_cache *tpuc_ret;
+	void *ret_node;
 	u_int16_t client_port;
 
         sa_to_addr((struct sockaddr *)&client, &tpuc.addr, &client_port);
-	tpuc_ret = pm_tfind(&tpuc, &telemetry_peers_udp_cache, telemetry_tpuc_addr_cmp);
+	ret_node = pm_tfind(&tpuc, &telemetry_peers_udp_cache, telemetry_tpuc_addr_cmp);
 
-	if (tpuc_ret) {
-	  peer = &telemetry_peers[tpuc_ret->index];
+	if (ret_node) {
+	  tpuc_ret = (*(telemetry_peer_udp_cache **) ret_node);
+	  udp_peers_idx = tpuc_ret->index;
 	  telemetry_peers_udp_timeout[tpuc_ret->index].last_msg = t_data->now;
 
 	  goto read_data;
@@ -599,7 +941,7 @@ void telemetry_daemon(void *t_data_void)
       }
 
       for (peer = NULL, peers_idx = 0; peers_idx < config.telemetry_max_peers; peers_idx++) {
-        if (!telemetry_peers[peers_idx].fd) {
+        if (!telemetry_peers[peers_idx].fd && !telemetry_peers_rx[peers_idx].closing) {
 	  peer = &telemetry_peers[peers_idx];
 
 	  if (telemetry_peer_init(peer, FUNC_TYPE_TELEMETRY)) peer = NULL;
@@ -614,6 +956,9 @@ void telemetry_daemon(void *t_data_void)
 
 	  if (peer) {
 	    recalc_fds = TRUE;
+	    peer->stats.last_check = t_data->now;
+	    telemetry_peers_rx[peers_idx].msgs = 0;
+	    memset(&telemetry_peers_rx[peers_idx].json_scan, 0, sizeof(struct telemetry_json_scan));
 
 	    if (config.telemetry_port_udp) {
 	      tpuc.index = peers_idx;
@@ -637,7 +982,11 @@ void telemetry_daemon(void *t_data_void)
       }
 
       peer->fd = fd;
-      if (config.telemetry_port_tcp) FD_SET(peer->fd, &bkp_read_descs);
+      if (config.telemetry_port_tcp) {
+        fcntl(peer->fd, F_SETFL, (fcntl(peer->fd, F_GETFL) | O_NONBLOCK));
+        FD_SET(peer->fd, &bkp_read_descs);
+      }
+      else udp_peers_idx = peers_idx;
       peer->addr.family = ((struct sockaddr *)&client)->sa_family;
       if (peer->addr.family == AF_INET) {
         peer->addr.address.ipv4.s_addr = ((struct sockaddr_in *)&client)->sin_addr.s_addr;
@@ -651,11 +1000,15 @@ void telemetry_daemon(void *t_data_void)
 #endif
       addr_to_str(peer->addr_str, &peer->addr);
 
+      telemetry_output_lock();
+
       if (telemetry_misc_db->msglog_backend_methods)
         telemetry_peer_log_init(peer, config.telemetry_msglog_output, FUNC_TYPE_TELEMETRY);
 
       if (telemetry_misc_db->dump_backend_methods)
-        telemetry_dump_init_peer(peer);
+        telemetry_dump_init_peer(peer, t_data);
+
+      telemetry_output_unlock();
 
       peers_num++;
       Log(LOG_INFO, "INFO ( %s/%s ): [%s] telemetry peers usage: %u/%u\n",
@@ -664,78 +1017,43 @@ void telemetry_daemon(void *t_data_void)
 
     read_data:
 
+    if (config.telemetry_port_udp) {
+      if (udp_peers_idx != ERR && !telemetry_peers_rx[udp_peers_idx].closing) {
+        if (telemetry_peer_recv(udp_peers_idx, decoder, t_data) == ERR) {
+          telemetry_peer_rx_close(udp_peers_idx, decoder);
+          recalc_fds = TRUE;
+	}
+      }
+      /* ACL-denied or no free slot: the datagram is to be discarded */
+      else if (udp_peers_idx == ERR) {
+	char dummy_local_buf[TRUE];
+
+	recv(config.telemetry_sock, dummy_local_buf, TRUE, 0);
+      }
+
+      continue;
+    }
+
     /*
-       We have something coming in: let's lookup which peer is that.
-       FvD: To avoid starvation of the "later established" peers, we
-       offset the start of the search in a round-robin style.
+       We have something coming in: let's serve all peers that are ready,
+       one recv() each per round. FvD: To avoid starvation of the "later
+       established" peers, we offset the start in a round-robin style.
     */
-    if (config.telemetry_port_tcp) {
-      for (peer = NULL, peers_idx = 0; peers_idx < max_peers_idx; peers_idx++) {
-        int loc_idx = (peers_idx + peers_idx_rr) % max_peers_idx;
+    for (peers_idx = 0; peers_idx < max_peers_idx; peers_idx++) {
+      int loc_idx = (peers_idx + peers_idx_rr) % max_peers_idx;
 
-        if (telemetry_peers[loc_idx].fd && FD_ISSET(telemetry_peers[loc_idx].fd, &read_descs)) {
-          peer = &telemetry_peers[loc_idx];
+      peer = &telemetry_peers[loc_idx];
 
-	  if (telemetry_is_zjson(decoder)) peer_z = &telemetry_peers_z[loc_idx];
+      if (!peer->fd || telemetry_peers_rx[loc_idx].closing || !FD_ISSET(peer->fd, &read_descs)) continue;
 
-          peers_idx_rr = (peers_idx_rr + 1) % max_peers_idx;
-          break;
-        }
+      if (telemetry_peer_recv(loc_idx, decoder, t_data) == ERR) {
+        FD_CLR(peer->fd, &bkp_read_descs);
+        telemetry_peer_rx_close(loc_idx, decoder);
+        recalc_fds = TRUE;
       }
     }
 
-    if (!peer) goto select_again;
-
-    recv_flags = 0;
-
-    switch (decoder) {
-    case TELEMETRY_DECODER_JSON:
-      ret = telemetry_recv_json(peer, 0, &recv_flags);
-      data_decoder = TELEMETRY_DATA_DECODER_JSON;
-      break;
-    case TELEMETRY_DECODER_ZJSON:
-      ret = telemetry_recv_zjson(peer, peer_z, 0, &recv_flags);
-      data_decoder = TELEMETRY_DATA_DECODER_JSON;
-      break;
-    case TELEMETRY_DECODER_CISCO:
-      ret = telemetry_recv_cisco(peer, &recv_flags, &data_decoder);
-      break;
-    case TELEMETRY_DECODER_CISCO_JSON:
-      ret = telemetry_recv_cisco_json(peer, &recv_flags);
-      data_decoder = TELEMETRY_DATA_DECODER_JSON;
-      break;
-    case TELEMETRY_DECODER_CISCO_ZJSON:
-      ret = telemetry_recv_cisco_zjson(peer, peer_z, &recv_flags);
-      data_decoder = TELEMETRY_DATA_DECODER_JSON;
-      break;
-    case TELEMETRY_DECODER_CISCO_GPB:
-      ret = telemetry_recv_cisco_gpb(peer);
-      data_decoder = TELEMETRY_DATA_DECODER_GPB;
-      break;
-    case TELEMETRY_DECODER_CISCO_GPB_KV:
-      ret = telemetry_recv_cisco_gpb_kv(peer, &recv_flags);
-      data_decoder = TELEMETRY_DATA_DECODER_GPB;
-      break;
-    default:
-      ret = TRUE; recv_flags = ERR;
-      data_decoder = TELEMETRY_DATA_DECODER_UNKNOWN;
-      break;
-    }
-
-    if (ret <= 0) {
-      Log(LOG_INFO, "INFO ( %s/%s ): [%s] connection reset by peer (%d).\n", config.name, t_data->log_str, peer->addr_str, errno);
-      FD_CLR(peer->fd, &bkp_read_descs);
-      telemetry_peer_close(peer, FUNC_TYPE_TELEMETRY);
-      if (telemetry_is_zjson(decoder)) telemetry_peer_z_close(peer_z);
-      recalc_fds = TRUE;
-    }
-    else {
-      peer->stats.packets++;
-      if (recv_flags != ERR) {
-        peer->stats.msg_bytes += ret;
-        telemetry_process_data(peer, t_data, data_decoder);
-      }
-    }
+    if (max_peers_idx) peers_idx_rr = (peers_idx_rr + 1) % max_peers_idx;
   }
 }
 
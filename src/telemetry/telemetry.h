@@ -29,6 +29,10 @@
 #define TELEMETRY_UDP_MAXMSG		65535
 #define TELEMETRY_CISCO_HDR_LEN		12
 #define TELEMETRY_LOG_STATS_INTERVAL	120	
+#define TELEMETRY_MAX_MSG_SIZE		(16 * 1024 * 1024)	/* receive/inflate buffers grow up to this */
+#define TELEMETRY_QUEUE_SIZE_DEFAULT	(8 * 1024 * 1024)	/* per-peer bytes queued to workers */
+#define TELEMETRY_THROTTLE_USECS	10000
+#define TELEMETRY_INFLATE_BUF_INIT	65536
 
 #define TELEMETRY_DECODER_UNKNOWN	0
 #define TELEMETRY_DECODER_JSON		1
@@ -48,6 +52,12 @@
 #define TELEMETRY_CISCO_GPB_COMPACT		3
 #define TELEMETRY_CISCO_GPB_KV			4
 
+/* frames cut by the reader out of the receive buffer */
+#define TELEMETRY_FRAME_JSON		1
+#define TELEMETRY_FRAME_GPB		2
+#define TELEMETRY_FRAME_ZJSON		3	/* deflated JSON message (cisco_zjson) */
+#define TELEMETRY_FRAME_ZJSON_STREAM	4	/* chunk of a deflated stream of JSON messages (zjson) */
+
 #define TELEMETRY_LOGDUMP_ET_NONE	BGP_LOGDUMP_ET_NONE
 #define TELEMETRY_LOGDUMP_ET_LOG	BGP_LOGDUMP_ET_LOG
 #define TELEMETRY_LOGDUMP_ET_DUMP	BGP_LOGDUMP_ET_DUMP
@@ -59,16 +69,57 @@ struct telemetry_data {
   char *log_str;
 
   telemetry_stats global_stats;
+  u_int32_t global_msgs;
   time_t now;
 };
 
+struct telemetry_frame {
+  u_int32_t off;
+  u_int32_t len;
+  u_int8_t type;
+};
+
+/*
+   Framing state of the partial JSON message at the head of a receive or
+   inflate buffer: a read only scans the bytes it appended to it
+*/
+struct telemetry_json_scan {
+  u_int32_t off;			/* bytes of the partial message scanned */
+  u_int32_t depth;			/* braces open */
+  u_int8_t in_string;
+  u_int8_t escape;
+  u_int8_t closed;			/* first object closed, only whitespace may follow */
+  u_int8_t invalid;			/* not a single object, ie. depth going negative */
+  u_int32_t rejected;			/* messages dropped as malformed, for the caller to count */
+};
+
+/*
+   Inflated data is written straight into a growable buffer, where messages
+   are then decoded in place; with the zjson decoder the trailing partial
+   message is carried over to the next chunk.
+*/
 struct _telemetry_peer_z {
-  char inflate_buf[BGP_BUFFER_SIZE];
+  char *inflate_buf;
+  u_int32_t inflate_len;
+  u_int32_t inflate_used;
+  struct telemetry_json_scan json_scan;	/* zjson: carried over partial message */
 #if defined (HAVE_ZLIB)
   z_stream stm;
 #endif
 };
 
+struct _telemetry_peer_rx {
+  struct telemetry_frame *frames;	/* framed by the last read */
+  u_int32_t frames_num;
+  u_int32_t frames_alloc;
+  struct telemetry_json_scan json_scan;	/* json: partial message left in the buffer */
+  u_int32_t queued;			/* bytes handed over to a worker, not yet processed */
+  u_int8_t closing;			/* close handed over to a worker, slot not yet free */
+  u_int32_t msgs;			/* messages decoded since last stats */
+  char *spare;				/* receive buffer handed back by the worker, under its lock */
+  u_int32_t spare_len;
+};
+
 struct _telemetry_peer_udp_cache {
   struct host_addr addr;
   int index;
@@ -101,6 +152,7 @@ typedef struct bgp_misc_structs telemetry_misc_structs;
 typedef struct _telemetry_dump_se_ll telemetry_dump_se_ll;
 typedef struct _telemetry_dump_se_ll_elem telemetry_dump_se_ll_elem;
 typedef struct _telemetry_peer_z telemetry_peer_z;
+typedef struct _telemetry_peer_rx telemetry_peer_rx;
 typedef struct _telemetry_peer_udp_cache telemetry_peer_udp_cache;
 typedef struct _telemetry_peer_udp_timeout telemetry_peer_udp_timeout;
 
@@ -119,6 +171,8 @@ EXT void telemetry_wrapper();
 EXT void telemetry_daemon(void *);
 EXT void telemetry_prepare_thread(struct telemetry_data *);
 EXT void telemetry_prepare_daemon(struct telemetry_data *);
+EXT void telemetry_output_lock();
+EXT void telemetry_output_unlock();
 #undef EXT
 
 /* global variables */
@@ -131,6 +185,7 @@ EXT telemetry_misc_structs *telemetry_misc_db;
 
 EXT telemetry_peer *telemetry_peers;
 EXT telemetry_peer_z *telemetry_peers_z;
+EXT telemetry_peer_rx *telemetry_peers_rx;
 EXT void *telemetry_peers_udp_cache;
 EXT telemetry_peer_udp_timeout *telemetry_peers_udp_timeout; 
 #undef EXT
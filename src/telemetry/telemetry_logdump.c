@@ -156,7 +156,7 @@ int telemetry_log_msg(telemetry_peer *peer, struct telemetry_data *t_data, void
   return (ret | amqp_ret | kafka_ret);
 }
 
-void telemetry_dump_se_ll_append(telemetry_peer *peer, struct telemetry_data *t_data, int data_decoder)
+void telemetry_dump_se_ll_append(telemetry_peer *peer, struct telemetry_data *t_data, char *data, u_int32_t len, int data_decoder)
 {
   telemetry_misc_structs *tms;
   telemetry_dump_se_ll *se_ll;
@@ -178,13 +178,13 @@ void telemetry_dump_se_ll_append(telemetry_peer *peer, struct telemetry_data *t_
 
   memset(se_ll_elem, 0, sizeof(telemetry_dump_se_ll_elem));
 
-  se_ll_elem->rec.data = malloc(peer->msglen);
+  se_ll_elem->rec.data = malloc(len);
   if (!se_ll_elem->rec.data) {
     Log(LOG_ERR, "ERROR ( %s/%s ): Unable to malloc() se_ll_elem->rec.data structure. Terminating.\n", config.name, t_data->log_str);
     exit_all(1);
   }
-  memcpy(se_ll_elem->rec.data, peer->buf.base, peer->msglen); 
-  se_ll_elem->rec.len = peer->msglen;
+  memcpy(se_ll_elem->rec.data, data, len); 
+  se_ll_elem->rec.len = len;
   se_ll_elem->rec.decoder = data_decoder;
   se_ll_elem->rec.seq = tms->log_seq;
 
@@ -236,9 +236,19 @@ int telemetry_peer_dump_close(telemetry_peer *peer, int output, int type)
   return bgp_peer_dump_close(peer, NULL, output, type);
 }
 
-void telemetry_dump_init_peer(telemetry_peer *peer)
+void telemetry_dump_init_peer(telemetry_peer *peer, struct telemetry_data *t_data)
 {
-  bmp_dump_init_peer(peer);
+  if (!peer || !t_data) return;
+
+  assert(!peer->bmp_se);
+
+  peer->bmp_se = malloc(sizeof(telemetry_dump_se_ll));
+  if (!peer->bmp_se) {
+    Log(LOG_ERR, "ERROR ( %s/%s ): Unable to malloc() bmp_se structure. Terminating.\n", config.name, t_data->log_str);
+    exit_all(1);
+  }
+
+  memset(peer->bmp_se, 0, sizeof(telemetry_dump_se_ll));
 }
 
 void telemetry_dump_se_ll_destroy(telemetry_dump_se_ll *tdsell)
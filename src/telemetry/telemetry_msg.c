@@ -34,11 +34,11 @@
 #endif
 
 /* Functions */
-void telemetry_process_data(telemetry_peer *peer, struct telemetry_data *t_data, int data_decoder)
+void telemetry_process_data(telemetry_peer *peer, struct telemetry_data *t_data, char *data, u_int32_t len, int data_decoder)
 {
   telemetry_misc_structs *tms;
 
-  if (!peer || !t_data) return;
+  if (!peer || !t_data || !data) return;
 
   tms = bgp_select_misc_db(peer->type);
 
@@ -48,13 +48,13 @@ void telemetry_process_data(telemetry_peer *peer, struct telemetry_data *t_data,
     char event_type[] = "log";
 
     if (!telemetry_validate_input_output_decoders(data_decoder, config.telemetry_msglog_output)) {
-      telemetry_log_msg(peer, t_data, peer->buf.base, peer->msglen, data_decoder, tms->log_seq, event_type, config.telemetry_msglog_output);
+      telemetry_log_msg(peer, t_data, data, len, data_decoder, tms->log_seq, event_type, config.telemetry_msglog_output);
     }
   }
 
   if (tms->dump_backend_methods) { 
     if (!telemetry_validate_input_output_decoders(data_decoder, config.telemetry_dump_output)) {
-      telemetry_dump_se_ll_append(peer, t_data, data_decoder);
+      telemetry_dump_se_ll_append(peer, t_data, data, len, data_decoder);
     }
   }
 
@@ -62,224 +62,348 @@ void telemetry_process_data(telemetry_peer *peer, struct telemetry_data *t_data,
     telemetry_log_seq_increment(&tms->log_seq);
 }
 
-int telemetry_recv_generic(telemetry_peer *peer, u_int32_t len)
+/*
+   Scans [ptr, end) on top of what was scanned before: braces are counted
+   outside of strings, escapes within strings are skipped. Once the message
+   can't be a single JSON object, possibly surrounded by whitespace, there
+   is nothing more to learn from it.
+*/
+static void telemetry_json_scan_update(struct telemetry_json_scan *scan, char *ptr, char *end)
 {
-  int ret = 0;
-  sigset_t mask, oldmask;
+  for (; ptr < end && !scan->invalid; ptr++) {
+    if (scan->in_string) {
+      if (scan->escape) scan->escape = FALSE;
+      else if ((*ptr) == '\\') scan->escape = TRUE;
+      else if ((*ptr) == '"') scan->in_string = FALSE;
 
-  sigemptyset(&mask);
-  sigemptyset(&oldmask);
+      continue;
+    }
 
-  /* Block SIGCHLD so it doesn't kick us out of recv. */
-  sigaddset(&mask, SIGCHLD);
-  if (sigprocmask(SIG_BLOCK, &mask, &oldmask) < 0) {
-      return ret;
-  }
+    if (isspace((unsigned char) (*ptr))) continue;
 
-  if (!len) {
-    ret = recv(peer->fd, &peer->buf.base[peer->buf.truncated_len], (peer->buf.len - peer->buf.truncated_len), 0);
-  }
-  else {
-    if (len <= (peer->buf.len - peer->buf.truncated_len)) { 
-      ret = recv(peer->fd, &peer->buf.base[peer->buf.truncated_len], len, MSG_WAITALL);
+    if (scan->closed) scan->invalid = TRUE;
+    else if ((*ptr) == '{') scan->depth++;
+    else if (!scan->depth) scan->invalid = TRUE;
+    else if ((*ptr) == '"') scan->in_string = TRUE;
+    else if ((*ptr) == '}') {
+      scan->depth--;
+      if (!scan->depth) scan->closed = TRUE;
     }
   }
-  if (ret > 0) {
-    peer->stats.packet_bytes += ret;
-    peer->msglen = (ret + peer->buf.truncated_len);
-  }
-
-  /* Restore the original procmask. */
-  sigprocmask(SIG_SETMASK, &oldmask, NULL);
-
-  return ret;
 }
 
-void telemetry_basic_process_json(telemetry_peer *peer)
+static void telemetry_json_scan_reset(struct telemetry_json_scan *scan)
 {
-  int idx;
+  u_int32_t rejected = scan->rejected;
 
-  for (idx = 0; idx < peer->msglen; idx++) {
-    if (!isprint(peer->buf.base[idx])) peer->buf.base[idx] = '\0';
-  }
-
-  if (peer->buf.len >= (peer->msglen + 1)) {
-    peer->buf.base[peer->msglen] = '\0';
-    peer->msglen++;
-  }
+  memset(scan, 0, sizeof(struct telemetry_json_scan));
+  scan->rejected = rejected;
 }
 
-int telemetry_recv_json(telemetry_peer *peer, u_int32_t len, int *flags)
+/*
+   Looks for the next JSON message in an unframed stream, starting at *pos:
+   messages are delimited by newlines or NULs; a trailing message with no
+   delimiter is taken if it is a whole JSON object, ie. a stream sender which
+   doesn't delimit its messages. At the end of a datagram (eof) a trailing
+   message that is not, ie. unbalanced or ending within a string, is dropped
+   and counted in scan->rejected. The partial message left at *pos is
+   remembered in scan, so that the next call only scans the bytes appended
+   to it. Messages are NUL-terminated in place, which requires one spare byte
+   past len. Returns FALSE, with *pos at the start of the unprocessed tail,
+   once no more complete messages are found.
+*/
+int telemetry_json_next(char *base, u_int32_t len, u_int32_t *pos, u_int32_t *msg_off, u_int32_t *msg_len, int eof,
+			struct telemetry_json_scan *scan)
 {
-  int ret = 0, idx;
-  if (!flags) return ret;
+  char *start, *end = (base + len), *scanned, *delim, *nul;
+  u_int32_t loc_len;
 
-  (*flags) = FALSE;
-  ret = telemetry_recv_generic(peer, len);
+  for (start = (base + (*pos)); start < end; start = (delim + 1)) {
+    /* the partial message is known not to hold delimiters this far */
+    scanned = (start + MIN(scan->off, (end - start)));
 
-  telemetry_basic_process_json(peer);
+    delim = memchr(scanned, '\n', (end - scanned));
+    nul = memchr(scanned, '\0', ((delim ? delim : end) - scanned));
+    if (nul) delim = nul;
 
-  if (ret) (*flags) = telemetry_basic_validate_json(peer);
+    if (!delim) {
+      telemetry_json_scan_update(scan, scanned, end);
+      scan->off = (end - start);
 
-  return ret;
-}
+      if (scan->closed && !scan->invalid) {
+        (*end) = '\0';
+        (*msg_off) = (start - base);
+        (*msg_len) = (end - start);
+        (*pos) = len;
+        telemetry_json_scan_reset(scan);
 
-int telemetry_recv_zjson(telemetry_peer *peer, telemetry_peer_z *peer_z, u_int32_t len, int *flags)
-{
-  int ret = 0;
+        return TRUE;
+      }
 
-#if defined (HAVE_ZLIB)
-  if (!flags) return ret;
-  (*flags) = FALSE;
+      if (eof) {
+        /* anything but whitespace is a broken message */
+        if (scan->depth || scan->invalid) scan->rejected++;
 
-  ret = telemetry_recv_generic(peer, len);
+        start = end;
+        telemetry_json_scan_reset(scan);
+      }
 
+      break;
+    }
 
-  if (ret > 0) { 
-    int zret;
+    telemetry_json_scan_reset(scan);
 
-    memset(peer_z->inflate_buf, 0, sizeof(peer_z->inflate_buf));
-    peer_z->stm.avail_out = (uInt) sizeof(peer_z->inflate_buf);
-    peer_z->stm.next_out = (Bytef *) peer_z->inflate_buf;
+    loc_len = (delim - start);
+    if (loc_len && start[loc_len - 1] == '\r') loc_len--;
 
-    peer_z->stm.avail_in = (uInt) peer->msglen;
-    peer_z->stm.next_in = (Bytef *) peer->buf.base;
+    if (loc_len) {
+      start[loc_len] = '\0';
+      (*msg_off) = (start - base);
+      (*msg_len) = loc_len;
+      (*pos) = ((delim + 1) - base);
 
-    ret = FALSE;
-    zret = inflate(&peer_z->stm, Z_NO_FLUSH);
-    if (zret == Z_OK || zret == Z_STREAM_END) {
-      strlcpy(peer->buf.base, peer_z->inflate_buf, peer->buf.len);
-      peer->msglen = strlen(peer->buf.base) + 1;
-      ret = peer->msglen;
-
-      (*flags) = telemetry_basic_validate_json(peer);
-      if (zret == Z_STREAM_END) {
-        inflateReset(&peer_z->stm);
-      }
+      return TRUE;
     }
   }
-#endif
 
-  return ret;
-}
+  (*pos) = ((start < end ? start : end) - base);
 
-int telemetry_recv_cisco_json(telemetry_peer *peer, int *flags)
-{
-  int ret = 0;
-  u_int32_t len;
-
-  ret = telemetry_recv_generic(peer, TELEMETRY_CISCO_HDR_LEN);
-  if (ret <= 0) return ret;
-  
-  if (ret == TELEMETRY_CISCO_HDR_LEN) {
-    len = telemetry_cisco_hdr_get_len(peer);
-    ret = telemetry_recv_json(peer, len, flags);
-  }
-  
-  return ret;
+  return FALSE;
 }
 
-int telemetry_recv_cisco_zjson(telemetry_peer *peer, telemetry_peer_z *peer_z, int *flags)
+static void telemetry_frame_add(telemetry_peer_rx *peer_rx, u_int32_t off, u_int32_t len, u_int8_t type)
 {
-  int ret = 0;
-  u_int32_t len;
-  if (!flags) return FALSE;
-  *flags = FALSE;
-
-  ret = telemetry_recv_generic(peer, TELEMETRY_CISCO_HDR_LEN);
-  if (ret == TELEMETRY_CISCO_HDR_LEN) {
-    len = telemetry_cisco_hdr_get_len(peer); 
-    ret = telemetry_recv_zjson(peer, peer_z, len, flags); 
+  if (peer_rx->frames_num == peer_rx->frames_alloc) {
+    u_int32_t new_alloc = (peer_rx->frames_alloc ? (peer_rx->frames_alloc * 2) : 64);
+    struct telemetry_frame *new_frames;
+
+    new_frames = realloc(peer_rx->frames, (new_alloc * sizeof(struct telemetry_frame)));
+    if (!new_frames) {
+      Log(LOG_ERR, "ERROR ( %s/core/TELE ): Unable to realloc() telemetry frames. Terminating.\n", config.name);
+      exit_all(1);
+    }
+
+    peer_rx->frames = new_frames;
+    peer_rx->frames_alloc = new_alloc;
   }
 
-  return ret;
+  peer_rx->frames[peer_rx->frames_num].off = off;
+  peer_rx->frames[peer_rx->frames_num].len = len;
+  peer_rx->frames[peer_rx->frames_num].type = type;
+  peer_rx->frames_num++;
 }
 
-int telemetry_recv_cisco(telemetry_peer *peer, int *flags, int *data_decoder)
+/*
+   Cuts whole messages out of the peer receive buffer, in place: frames are
+   described in peer_rx, *consumed is set past the last whole message. eof
+   is set for datagrams, which can't carry over a partial message. Returns
+   ERR if the stream can't be framed.
+*/
+int telemetry_frame(telemetry_peer *peer, telemetry_peer_rx *peer_rx, int decoder, int eof, u_int32_t *consumed)
 {
-  int ret = 0;
-  u_int32_t type, len;
-
-  if (!flags || !data_decoder) return ret;
-  *flags = FALSE;
-  *data_decoder = TELEMETRY_DATA_DECODER_UNKNOWN;
-
-  ret = telemetry_recv_generic(peer, TELEMETRY_CISCO_HDR_LEN);
-  if (ret == TELEMETRY_CISCO_HDR_LEN) {
-    type = telemetry_cisco_hdr_get_type(peer);
-    len = telemetry_cisco_hdr_get_len(peer);
-
-    switch (type) {
-    case TELEMETRY_CISCO_RESET_COMPRESSOR:
-      ret = telemetry_recv_jump(peer, len, flags);
-      (*data_decoder) = TELEMETRY_DATA_DECODER_UNKNOWN; /* XXX: JSON instead? */
-      break;
-    case TELEMETRY_CISCO_JSON:
-      ret = telemetry_recv_json(peer, len, flags);
-      (*data_decoder) = TELEMETRY_DATA_DECODER_JSON;
-      break;
-    case TELEMETRY_CISCO_GPB_COMPACT:
-      ret = telemetry_recv_generic(peer, len);
-      (*data_decoder) = TELEMETRY_DATA_DECODER_GPB;
-      break;
-    case TELEMETRY_CISCO_GPB_KV:
-      ret = telemetry_recv_generic(peer, len);
-      (*data_decoder) = TELEMETRY_DATA_DECODER_GPB;
-      break;
+  char *base = peer->buf.base;
+  u_int32_t len = peer->msglen, pos = 0, msg_off, msg_len, type;
+
+  peer_rx->frames_num = 0;
+
+  switch (decoder) {
+  case TELEMETRY_DECODER_JSON:
+    while (telemetry_json_next(base, len, &pos, &msg_off, &msg_len, eof, &peer_rx->json_scan))
+      telemetry_frame_add(peer_rx, msg_off, msg_len, TELEMETRY_FRAME_JSON);
+
+    if (peer_rx->json_scan.rejected) {
+      telemetry_output_lock();
+      peer->stats.msg_errors += peer_rx->json_scan.rejected;
+      telemetry_output_unlock();
+
+      peer_rx->json_scan.rejected = 0;
+    }
+    break;
+  case TELEMETRY_DECODER_ZJSON:
+    /* a deflated stream: messages can only be told apart once inflated */
+    if (len) telemetry_frame_add(peer_rx, 0, len, TELEMETRY_FRAME_ZJSON_STREAM);
+    pos = len;
+    break;
+  case TELEMETRY_DECODER_CISCO:
+  case TELEMETRY_DECODER_CISCO_JSON:
+  case TELEMETRY_DECODER_CISCO_ZJSON:
+  case TELEMETRY_DECODER_CISCO_GPB:
+  case TELEMETRY_DECODER_CISCO_GPB_KV:
+    while ((len - pos) >= TELEMETRY_CISCO_HDR_LEN) {
+      msg_len = telemetry_cisco_hdr_get_len(&base[pos]);
+      if (msg_len > TELEMETRY_MAX_MSG_SIZE) return ERR;
+      if ((len - pos - TELEMETRY_CISCO_HDR_LEN) < msg_len) break;
+
+      msg_off = (pos + TELEMETRY_CISCO_HDR_LEN);
+
+      switch (decoder) {
+      case TELEMETRY_DECODER_CISCO_JSON:
+	telemetry_frame_add(peer_rx, msg_off, msg_len, TELEMETRY_FRAME_JSON);
+	break;
+      case TELEMETRY_DECODER_CISCO_ZJSON:
+	telemetry_frame_add(peer_rx, msg_off, msg_len, TELEMETRY_FRAME_ZJSON);
+	break;
+      case TELEMETRY_DECODER_CISCO_GPB:
+      case TELEMETRY_DECODER_CISCO_GPB_KV:
+	telemetry_frame_add(peer_rx, msg_off, msg_len, TELEMETRY_FRAME_GPB);
+	break;
+      case TELEMETRY_DECODER_CISCO:
+	type = telemetry_cisco_hdr_get_type(&base[pos]);
+
+	if (type == TELEMETRY_CISCO_JSON) telemetry_frame_add(peer_rx, msg_off, msg_len, TELEMETRY_FRAME_JSON);
+	else if (type == TELEMETRY_CISCO_GPB_COMPACT || type == TELEMETRY_CISCO_GPB_KV)
+	  telemetry_frame_add(peer_rx, msg_off, msg_len, TELEMETRY_FRAME_GPB);
+	/* else, ie. TELEMETRY_CISCO_RESET_COMPRESSOR, skipped */
+	break;
+      }
+
+      pos = (msg_off + msg_len);
     }
+
+    if (eof) pos = len;
+    break;
+  default:
+    pos = len;
+    break;
   }
 
-  return ret;
+  (*consumed) = pos;
+
+  return SUCCESS;
 }
 
-int telemetry_recv_jump(telemetry_peer *peer, u_int32_t len, int *flags)
+/* stats and output are shared with the telemetry thread, hence accessed under the output lock */
+static void telemetry_process_msg(telemetry_peer *peer, telemetry_peer_rx *peer_rx, struct telemetry_data *t_data,
+				  char *data, u_int32_t len, int data_decoder)
 {
-  int ret = 0;
-  if (!flags) return ret;
+  int valid = TRUE;
+  char saved = '\0';
 
-  ret = telemetry_recv_generic(peer, len);
+  if (data_decoder == TELEMETRY_DATA_DECODER_JSON) {
+    saved = data[len];
+    data[len] = '\0';
+    if (data[0] != '{') valid = FALSE;
+  }
 
-  (*flags) = ERR;
+  telemetry_output_lock();
 
-  return ret;
-}
+  if (valid) {
+    peer_rx->msgs++;
+    peer->stats.msg_bytes += len;
 
-int telemetry_recv_cisco_gpb(telemetry_peer *peer)
-{
-  int ret = 0;
-  u_int32_t len;
+    /* JSON is handed over as a string, including its NUL */
+    telemetry_process_data(peer, t_data, data, ((data_decoder == TELEMETRY_DATA_DECODER_JSON) ? (len + 1) : len), data_decoder);
+  }
+  else peer->stats.msg_errors++;
 
-  if (!peer) return ret;
+  telemetry_output_unlock();
 
-  ret = telemetry_recv_generic(peer, TELEMETRY_CISCO_HDR_LEN);
-  if (ret == TELEMETRY_CISCO_HDR_LEN) {
-    len = telemetry_cisco_hdr_get_len(peer);
-    ret = telemetry_recv_generic(peer, len);
-  }
+  if (data_decoder == TELEMETRY_DATA_DECODER_JSON) data[len] = saved;
+}
 
-  return ret;
+#if defined (HAVE_ZLIB)
+static void telemetry_msg_error(telemetry_peer *peer)
+{
+  telemetry_output_lock();
+  peer->stats.msg_errors++;
+  telemetry_output_unlock();
 }
 
-int telemetry_recv_cisco_gpb_kv(telemetry_peer *peer, int *flags)
+/*
+   Inflates into the peer inflate buffer, after what is already there; the
+   buffer grows as needed, keeping one spare byte to NUL-terminate messages.
+*/
+static int telemetry_inflate(telemetry_peer_z *peer_z, char *in, u_int32_t in_len)
 {
-  int ret = 0;
-  u_int32_t len;
+  int zret;
+
+  peer_z->stm.next_in = (Bytef *) in;
+  peer_z->stm.avail_in = (uInt) in_len;
+
+  for (;;) {
+    if ((peer_z->inflate_len - peer_z->inflate_used) < 2) {
+      u_int32_t new_len = (peer_z->inflate_len ? (peer_z->inflate_len * 2) : TELEMETRY_INFLATE_BUF_INIT);
+      char *new_buf;
+
+      if (new_len > TELEMETRY_MAX_MSG_SIZE) return ERR;
+
+      new_buf = realloc(peer_z->inflate_buf, new_len);
+      if (!new_buf) return ERR;
+
+      peer_z->inflate_buf = new_buf;
+      peer_z->inflate_len = new_len;
+    }
+
+    peer_z->stm.next_out = (Bytef *) &peer_z->inflate_buf[peer_z->inflate_used];
+    peer_z->stm.avail_out = (uInt) (peer_z->inflate_len - peer_z->inflate_used - 1);
+
+    zret = inflate(&peer_z->stm, Z_NO_FLUSH);
+    peer_z->inflate_used = (peer_z->inflate_len - 1 - peer_z->stm.avail_out);
 
-  ret = telemetry_recv_generic(peer, TELEMETRY_CISCO_HDR_LEN);
-  if (ret == TELEMETRY_CISCO_HDR_LEN) {
-    len = telemetry_cisco_hdr_get_len(peer);
-    ret = telemetry_recv_generic(peer, len);
+    if (zret == Z_STREAM_END) inflateReset(&peer_z->stm);
+    else if (zret != Z_OK && zret != Z_BUF_ERROR) return ERR;
+
+    /* done when input is over and output did not fill the buffer up */
+    if (peer_z->stm.avail_out && (!peer_z->stm.avail_in || zret == Z_BUF_ERROR)) break;
   }
 
-  return ret;
+  return SUCCESS;
 }
+#endif
 
-int telemetry_basic_validate_json(telemetry_peer *peer)
+/* decodes frames cut by telemetry_frame(); run by the telemetry thread or by the peer worker */
+void telemetry_process_frames(telemetry_peer *peer, telemetry_peer_z *peer_z, telemetry_peer_rx *peer_rx, struct telemetry_data *t_data,
+			      char *base, struct telemetry_frame *frames, u_int32_t frames_num)
 {
-  if (peer->buf.base[peer->buf.truncated_len] != '{') {
-    peer->stats.msg_errors++;
-    return ERR;
+  u_int32_t idx, pos, msg_off, msg_len;
+  char *data;
+
+  for (idx = 0; idx < frames_num; idx++) {
+    data = &base[frames[idx].off];
+
+    switch (frames[idx].type) {
+    case TELEMETRY_FRAME_JSON:
+      telemetry_process_msg(peer, peer_rx, t_data, data, strnlen(data, frames[idx].len), TELEMETRY_DATA_DECODER_JSON);
+      break;
+    case TELEMETRY_FRAME_GPB:
+      telemetry_process_msg(peer, peer_rx, t_data, data, frames[idx].len, TELEMETRY_DATA_DECODER_GPB);
+      break;
+#if defined (HAVE_ZLIB)
+    case TELEMETRY_FRAME_ZJSON:
+      peer_z->inflate_used = 0;
+
+      if (telemetry_inflate(peer_z, data, frames[idx].len) == ERR) {
+	inflateReset(&peer_z->stm);
+	telemetry_msg_error(peer);
+      }
+      else {
+	msg_len = strnlen(peer_z->inflate_buf, peer_z->inflate_used);
+	telemetry_process_msg(peer, peer_rx, t_data, peer_z->inflate_buf, msg_len, TELEMETRY_DATA_DECODER_JSON);
+      }
+
+      peer_z->inflate_used = 0;
+      break;
+    case TELEMETRY_FRAME_ZJSON_STREAM:
+      if (telemetry_inflate(peer_z, data, frames[idx].len) == ERR) {
+	inflateReset(&peer_z->stm);
+	peer_z->inflate_used = 0;
+	memset(&peer_z->json_scan, 0, sizeof(struct telemetry_json_scan));
+	telemetry_msg_error(peer);
+	break;
+      }
+
+      for (pos = 0; telemetry_json_next(peer_z->inflate_buf, peer_z->inflate_used, &pos, &msg_off, &msg_len, FALSE, &peer_z->json_scan); )
+	telemetry_process_msg(peer, peer_rx, t_data, &peer_z->inflate_buf[msg_off], msg_len, TELEMETRY_DATA_DECODER_JSON);
+
+      /* partial message is carried over */
+      if (pos) {
+	memmove(peer_z->inflate_buf, &peer_z->inflate_buf[pos], (peer_z->inflate_used - pos));
+	peer_z->inflate_used -= pos;
+      }
+      break;
+#endif
+    default:
+      break;
+    }
   }
-  else
-    return FALSE;
 }
@@ -41,6 +41,10 @@ int telemetry_peer_init(telemetry_peer *peer, int type)
 
 int telemetry_peer_z_init(telemetry_peer_z *peer_z)
 {
+  /* inflate_buf, if any, is retained from the previous peer in this slot */
+  peer_z->inflate_used = 0;
+  memset(&peer_z->json_scan, 0, sizeof(struct telemetry_json_scan));
+
 #if defined (HAVE_ZLIB)
   peer_z->stm.zalloc = Z_NULL;
   peer_z->stm.zfree = Z_NULL;
@@ -74,14 +78,8 @@ void telemetry_peer_close(telemetry_peer *peer, int type)
     peer->bmp_se = NULL;
   }
 
-  if (config.telemetry_port_udp) {
-    telemetry_peer_udp_cache tpuc;
-
-    memcpy(&tpuc.addr, &peer->addr, sizeof(struct host_addr));
-    pm_tdelete(&tpuc, &telemetry_peers_udp_cache, telemetry_tpuc_addr_cmp);
-
-    peer->fd = ERR; /* dirty trick to prevent close() a valid fd in bgp_peer_close() */
-  }
+  /* UDP peers cache is maintained by the telemetry thread, see telemetry_peer_rx_close() */
+  if (config.telemetry_port_udp) peer->fd = ERR; /* dirty trick to prevent close() a valid fd in bgp_peer_close() */
 
   bgp_peer_close(peer, type, FALSE, NULL);
 }
@@ -93,21 +91,21 @@ void telemetry_peer_z_close(telemetry_peer_z *peer_z)
 #endif
 }
 
-u_int32_t telemetry_cisco_hdr_get_len(telemetry_peer *peer)
+u_int32_t telemetry_cisco_hdr_get_len(char *hdr)
 {
   u_int32_t len;
 
-  memcpy(&len, (peer->buf.base + 8), 4);
+  memcpy(&len, (hdr + 8), 4);
   len = ntohl(len);
 
   return len;
 }
 
-u_int32_t telemetry_cisco_hdr_get_type(telemetry_peer *peer)
+u_int32_t telemetry_cisco_hdr_get_type(char *hdr)
 {
   u_int32_t type;
 
-  memcpy(&type, peer->buf.base, 4);
+  memcpy(&type, hdr, 4);
   type = ntohl(type);
 
   return type;
@@ -160,29 +158,37 @@ int telemetry_validate_input_output_decoders(int input, int output)
   }
 }
 
-void telemetry_log_peer_stats(telemetry_peer *peer, struct telemetry_data *t_data)
+void telemetry_log_peer_stats(telemetry_peer *peer, telemetry_peer_rx *peer_rx, struct telemetry_data *t_data)
 {
-  Log(LOG_INFO, "INFO ( %s/%s ): [%s:%u] Packets: %u Packet_Bytes: %u Msg_Bytes: %u Msg_Errors: %u\n",
+  time_t elapsed = (t_data->now - peer->stats.last_check);
+
+  if (elapsed <= 0) elapsed = 1;
+
+  Log(LOG_INFO, "INFO ( %s/%s ): [%s:%u] Packets: %u Packet_Bytes: %u Msg_Bytes: %u Msg_Errors: %u Msgs: %u Msg_Rate: %u/s Byte_Rate: %u/s\n",
 	config.name, t_data->log_str, peer->addr_str, peer->tcp_port, peer->stats.packets,
-	peer->stats.packet_bytes, peer->stats.msg_bytes, peer->stats.msg_errors);
+	peer->stats.packet_bytes, peer->stats.msg_bytes, peer->stats.msg_errors, peer_rx->msgs,
+	(u_int32_t) (peer_rx->msgs / elapsed), (u_int32_t) (peer->stats.packet_bytes / elapsed));
 
   t_data->global_stats.packets += peer->stats.packets;
   t_data->global_stats.packet_bytes += peer->stats.packet_bytes;
   t_data->global_stats.msg_bytes += peer->stats.msg_bytes;
   t_data->global_stats.msg_errors += peer->stats.msg_errors;
+  t_data->global_msgs += peer_rx->msgs;
 
   peer->stats.packets = 0;
   peer->stats.packet_bytes = 0;
   peer->stats.msg_bytes = 0;
   peer->stats.msg_errors = 0;
+  peer_rx->msgs = 0;
 }
 
 void telemetry_log_global_stats(struct telemetry_data *t_data)
 {
-  Log(LOG_INFO, "INFO ( %s/%s ): Packets: %u Packet_Bytes: %u Msg_Bytes: %u Msg_Errors: %u\n",
+  Log(LOG_INFO, "INFO ( %s/%s ): Packets: %u Packet_Bytes: %u Msg_Bytes: %u Msg_Errors: %u Msgs: %u\n",
         config.name, t_data->log_str, t_data->global_stats.packets, t_data->global_stats.packet_bytes,
-	t_data->global_stats.msg_bytes, t_data->global_stats.msg_errors);
+	t_data->global_stats.msg_bytes, t_data->global_stats.msg_errors, t_data->global_msgs);
 
+  t_data->global_msgs = 0;
   t_data->global_stats.packets = 0;
   t_data->global_stats.packet_bytes = 0;
   t_data->global_stats.msg_bytes = 0;
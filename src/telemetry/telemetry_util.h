@@ -33,12 +33,12 @@ EXT int telemetry_peer_init(telemetry_peer *, int);
 EXT int telemetry_peer_z_init(telemetry_peer_z *);
 EXT void telemetry_peer_close(telemetry_peer *, int);
 EXT void telemetry_peer_z_close(telemetry_peer_z *);
-EXT u_int32_t telemetry_cisco_hdr_get_len(telemetry_peer *);
-EXT u_int32_t telemetry_cisco_hdr_get_type(telemetry_peer *);
+EXT u_int32_t telemetry_cisco_hdr_get_len(char *);
+EXT u_int32_t telemetry_cisco_hdr_get_type(char *);
 EXT int telemetry_is_zjson(int);
 EXT void telemetry_link_misc_structs(telemetry_misc_structs *);
 EXT int telemetry_tpuc_addr_cmp(const void *, const void *);
 EXT int telemetry_validate_input_output_decoders(int, int);
-EXT void telemetry_log_peer_stats(telemetry_peer *, struct telemetry_data *);
+EXT void telemetry_log_peer_stats(telemetry_peer *, telemetry_peer_rx *, struct telemetry_data *);
 EXT void telemetry_log_global_stats(struct telemetry_data *);
 #undef EXT
@@ -153,7 +153,7 @@ thread_pool_t *allocate_thread_pool(int count)
 void deallocate_thread_pool(thread_pool_t **pool)
 {
   thread_pool_t *pool_ptr = NULL;
-  thread_pool_item_t *worker = NULL;
+  thread_pool_item_t *worker = NULL, *next = NULL;
 
   if (!pool || !(*pool)) return;
 
@@ -179,8 +179,9 @@ void deallocate_thread_pool(thread_pool_t **pool)
  
     free(worker->thread);
 
-    worker = worker->next;
+    next = worker->next;
     free(worker);
+    worker = next;
   }
 
   if (pool_ptr->mutex) free(pool_ptr->mutex);
@@ -248,3 +249,20 @@ void send_to_pool(thread_pool_t *pool, void *function, void *data)
   pthread_cond_signal(worker->cond);
   pthread_mutex_unlock(worker->mutex);
 }
+
+/* waits for all workers to be back in the free list, ie. for all the
+   work sent to the pool to be done */
+void wait_thread_pool(thread_pool_t *pool)
+{
+  thread_pool_item_t *worker;
+  int count;
+
+  pthread_mutex_lock(pool->mutex);
+  for (;;) {
+    for (count = 0, worker = pool->free_list; worker; worker = worker->next) count++;
+    if (count == pool->count) break;
+
+    pthread_cond_wait(pool->cond, pool->mutex);
+  }
+  pthread_mutex_unlock(pool->mutex);
+}
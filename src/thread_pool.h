@@ -70,6 +70,7 @@ typedef struct thread_pool {
 EXT thread_pool_t *allocate_thread_pool(int);
 EXT void deallocate_thread_pool(thread_pool_t **);
 EXT void send_to_pool(thread_pool_t *, void *, void *);
+EXT void wait_thread_pool(thread_pool_t *);
 EXT void *thread_runner(void *);
 #undef EXT
 
@@ -0,0 +1,363 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2017 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+/* defines */
+#define __TPACKET_C
+
+/* includes */
+#include "pmacct.h"
+#include "tpacket.h"
+
+/* Functions */
+#if defined (PCAP_TYPE_linux) && defined (PACKET_FANOUT)
+int tpacket_set_fanout(int fd, int group, int type)
+{
+  int fanout_arg, fanout_type;
+
+  switch (type) {
+  case FANOUT_TYPE_LB:
+    fanout_type = PACKET_FANOUT_LB;
+    break;
+  case FANOUT_TYPE_CPU:
+    fanout_type = PACKET_FANOUT_CPU;
+    break;
+  case FANOUT_TYPE_RND:
+#if defined (PACKET_FANOUT_RND)
+    fanout_type = PACKET_FANOUT_RND;
+    break;
+#else
+    Log(LOG_ERR, "ERROR ( %s/core ): tpacket_set_fanout(): 'rnd' fanout type not supported by this build.\n", config.name);
+    return ERR;
+#endif
+  case FANOUT_TYPE_QM:
+#if defined (PACKET_FANOUT_QM)
+    fanout_type = PACKET_FANOUT_QM;
+    break;
+#else
+    Log(LOG_ERR, "ERROR ( %s/core ): tpacket_set_fanout(): 'qm' fanout type not supported by this build.\n", config.name);
+    return ERR;
+#endif
+  case FANOUT_TYPE_HASH:
+  default:
+    /* fragments must land on the same instance as fragment and flow
+       tables are per-instance */
+    fanout_type = PACKET_FANOUT_HASH|PACKET_FANOUT_FLAG_DEFRAG;
+    break;
+  }
+
+  fanout_arg = ((group & 0xffff) | (fanout_type << 16));
+
+  if (setsockopt(fd, SOL_PACKET, PACKET_FANOUT, &fanout_arg, sizeof(fanout_arg)) == -1) {
+    Log(LOG_ERR, "ERROR ( %s/core ): tpacket_set_fanout(): unable to join fanout group %d: %s\n",
+	config.name, group, strerror(errno));
+    return ERR;
+  }
+
+  Log(LOG_INFO, "INFO ( %s/core ): joined PACKET_FANOUT group %d\n", config.name, group);
+
+  return SUCCESS;
+}
+#endif
+
+#if defined (HAVE_TPACKET_V3)
+int tpacket_v3_open(struct tpacket_v3_ring *ring, char *dev, int snaplen, int promisc)
+{
+  struct tpacket_req3 req;
+  struct sockaddr_ll sll;
+  struct packet_mreq mr;
+  struct ifreq ifr;
+  u_int64_t packets, drops, freeze_q_cnt;
+  int version = TPACKET_V3, idx, ifindex;
+
+  /* counters survive re-opening the device */
+  packets = ring->packets;
+  drops = ring->drops;
+  freeze_q_cnt = ring->freeze_q_cnt;
+
+  memset(ring, 0, sizeof(struct tpacket_v3_ring));
+  ring->fd = ERR;
+  ring->packets = packets;
+  ring->drops = drops;
+  ring->freeze_q_cnt = freeze_q_cnt;
+
+  if (!config.pmacctd_tpacket_block_size) config.pmacctd_tpacket_block_size = DEFAULT_TPACKET_BLOCK_SIZE;
+  if (!config.pmacctd_tpacket_block_num) config.pmacctd_tpacket_block_num = DEFAULT_TPACKET_BLOCK_NUM;
+
+  ring->snaplen = snaplen;
+  ring->block_size = config.pmacctd_tpacket_block_size;
+  ring->block_num = config.pmacctd_tpacket_block_num;
+
+  if (ring->block_size % getpagesize()) {
+    Log(LOG_ERR, "ERROR ( %s/core ): pmacctd_tpacket_block_size must be a multiple of the page size (%d).\n",
+	config.name, getpagesize());
+    return ERR;
+  }
+
+  if ((ring->fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL))) == -1) {
+    Log(LOG_ERR, "ERROR ( %s/core ): tpacket_v3_open(): socket() failed: %s\n", config.name, strerror(errno));
+    return ERR;
+  }
+
+  memset(&ifr, 0, sizeof(ifr));
+  strlcpy(ifr.ifr_name, dev, sizeof(ifr.ifr_name));
+  if (ioctl(ring->fd, SIOCGIFINDEX, &ifr) == -1) {
+    Log(LOG_ERR, "ERROR ( %s/core ): tpacket_v3_open(): %s: %s\n", config.name, dev, strerror(errno));
+    goto err_lane;
+  }
+  ifindex = ifr.ifr_ifindex;
+
+  if (ioctl(ring->fd, SIOCGIFHWADDR, &ifr) == -1) {
+    Log(LOG_ERR, "ERROR ( %s/core ): tpacket_v3_open(): %s: %s\n", config.name, dev, strerror(errno));
+    goto err_lane;
+  }
+
+  switch (ifr.ifr_hwaddr.sa_family) {
+  case ARPHRD_ETHER:
+  case ARPHRD_LOOPBACK:
+    ring->link_type = DLT_EN10MB;
+    break;
+  default:
+    Log(LOG_ERR, "ERROR ( %s/core ): tpacket_v3_open(): %s: unsupported hardware type %u (use pcap instead).\n",
+	config.name, dev, ifr.ifr_hwaddr.sa_family);
+    goto err_lane;
+  }
+
+  if (setsockopt(ring->fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) == -1) {
+    Log(LOG_ERR, "ERROR ( %s/core ): tpacket_v3_open(): TPACKET_V3 not supported: %s\n", config.name, strerror(errno));
+    goto err_lane;
+  }
+
+  memset(&req, 0, sizeof(req));
+  req.tp_block_size = ring->block_size;
+  req.tp_block_nr = ring->block_num;
+  req.tp_frame_size = TPACKET_ALIGNMENT << 7; /* ignored by TPACKET_V3 but sanity-checked */
+  req.tp_frame_nr = (req.tp_block_size * req.tp_block_nr) / req.tp_frame_size;
+  req.tp_retire_blk_tov = TPACKET_BLOCK_TMO;
+  req.tp_feature_req_word = TP_FT_REQ_FILL_RXHASH;
+
+  if (setsockopt(ring->fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) == -1) {
+    Log(LOG_ERR, "ERROR ( %s/core ): tpacket_v3_open(): PACKET_RX_RING failed: %s\n", config.name, strerror(errno));
+    goto err_lane;
+  }
+
+  ring->map_len = (size_t) req.tp_block_size * req.tp_block_nr;
+  ring->map = mmap(NULL, ring->map_len, PROT_READ|PROT_WRITE, MAP_SHARED, ring->fd, 0);
+  if (ring->map == MAP_FAILED) {
+    ring->map = NULL;
+    Log(LOG_ERR, "ERROR ( %s/core ): tpacket_v3_open(): mmap() failed: %s\n", config.name, strerror(errno));
+    goto err_lane;
+  }
+
+  ring->rd = malloc(ring->block_num * sizeof(struct iovec));
+  ring->vlan_buf = malloc(ring->snaplen + 4 /* 802.1Q header */);
+  if (!ring->rd || !ring->vlan_buf) {
+    Log(LOG_ERR, "ERROR ( %s/core ): tpacket_v3_open(): malloc() failed.\n", config.name);
+    goto err_lane;
+  }
+
+  for (idx = 0; idx < ring->block_num; idx++) {
+    ring->rd[idx].iov_base = ring->map + (idx * ring->block_size);
+    ring->rd[idx].iov_len = ring->block_size;
+  }
+
+  memset(&sll, 0, sizeof(sll));
+  sll.sll_family = AF_PACKET;
+  sll.sll_protocol = htons(ETH_P_ALL);
+  sll.sll_ifindex = ifindex;
+
+  if (bind(ring->fd, (struct sockaddr *) &sll, sizeof(sll)) == -1) {
+    Log(LOG_ERR, "ERROR ( %s/core ): tpacket_v3_open(): bind() failed: %s\n", config.name, strerror(errno));
+    goto err_lane;
+  }
+
+  if (promisc) {
+    memset(&mr, 0, sizeof(mr));
+    mr.mr_ifindex = ifindex;
+    mr.mr_type = PACKET_MR_PROMISC;
+
+    if (setsockopt(ring->fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mr, sizeof(mr)) == -1)
+      Log(LOG_WARNING, "WARN ( %s/core ): tpacket_v3_open(): unable to set promiscuous mode: %s\n", config.name, strerror(errno));
+  }
+
+  Log(LOG_INFO, "INFO ( %s/core ): TPACKET_V3 ring on %s: %u blocks of %u bytes\n",
+	config.name, dev, ring->block_num, ring->block_size);
+
+  return SUCCESS;
+
+  err_lane:
+  tpacket_v3_close(ring);
+
+  return ERR;
+}
+
+int tpacket_v3_setfilter(struct tpacket_v3_ring *ring, struct bpf_program *filter)
+{
+  struct sock_fprog fprog;
+
+  fprog.len = filter->bf_len;
+  fprog.filter = (struct sock_filter *) filter->bf_insns;
+
+  if (setsockopt(ring->fd, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog)) == -1) {
+    Log(LOG_WARNING, "WARN ( %s/core ): tpacket_v3_setfilter(): SO_ATTACH_FILTER failed: %s\n", config.name, strerror(errno));
+    return ERR;
+  }
+
+  return SUCCESS;
+}
+
+/* 
+   Walks the ring one block at a time, handing packets to the supplied
+   callback as pcap_loop() would. Returns on unrecoverable socket errors
+   (ie. device going down) so that the caller can re-open the device;
+   other socket errors are backed off and, if they persist, treated the
+   same way rather than spinning on poll().
+   On poll() timeouts the callback is invoked with a NULL packet so that
+   periodic work (ie. maps reload) is carried out in idle times too.
+*/
+void tpacket_v3_loop(struct tpacket_v3_ring *ring, pcap_handler callback, u_char *user)
+{
+  struct tpacket_block_desc *pbd;
+  struct pollfd pfd;
+  socklen_t errlen;
+  int ret, sock_err, err_cnt = 0;
+
+  memset(&pfd, 0, sizeof(pfd));
+  pfd.fd = ring->fd;
+  pfd.events = POLLIN|POLLERR;
+
+  for (;;) {
+    pbd = (struct tpacket_block_desc *) ring->rd[ring->block_idx].iov_base;
+
+    if (!(pbd->hdr.bh1.block_status & TP_STATUS_USER)) {
+      pfd.revents = 0;
+      ret = poll(&pfd, 1, TPACKET_POLL_TMO);
+
+      if (ret < 0 && errno != EINTR) {
+	Log(LOG_ERR, "ERROR ( %s/core ): tpacket_v3_loop(): poll() failed: %s\n", config.name, strerror(errno));
+	return;
+      }
+      else if (!ret) (*callback)(user, NULL, NULL);
+
+      if (pfd.revents & (POLLERR|POLLHUP|POLLNVAL)) {
+	sock_err = 0;
+	errlen = sizeof(sock_err);
+	getsockopt(ring->fd, SOL_SOCKET, SO_ERROR, &sock_err, &errlen);
+
+	if (sock_err == ENETDOWN || sock_err == ENXIO || (pfd.revents & (POLLHUP|POLLNVAL))) return;
+
+	if (++err_cnt >= TPACKET_POLL_ERR_MAX) {
+	  Log(LOG_ERR, "ERROR ( %s/core ): tpacket_v3_loop(): persistent socket error: %s\n",
+	      config.name, sock_err ? strerror(sock_err) : "unknown");
+	  return;
+	}
+
+	usleep(TPACKET_POLL_ERR_BACKOFF * 1000);
+      }
+      else if (ret > 0) err_cnt = 0;
+
+      continue;
+    }
+
+    tpacket_v3_walk_block(ring, pbd, callback, user);
+
+    /* give the block back to the kernel */
+    __sync_synchronize();
+    pbd->hdr.bh1.block_status = TP_STATUS_KERNEL;
+    ring->block_idx = ((ring->block_idx + 1) % ring->block_num);
+  }
+}
+
+void tpacket_v3_walk_block(struct tpacket_v3_ring *ring, struct tpacket_block_desc *pbd, pcap_handler callback, u_char *user)
+{
+  struct tpacket3_hdr *ppd;
+  struct pcap_pkthdr pkthdr;
+  u_int32_t num_pkts, idx, vlan_hdr, rest;
+  u_int16_t tpid;
+  u_char *pkt;
+
+  num_pkts = pbd->hdr.bh1.num_pkts;
+  ppd = (struct tpacket3_hdr *) ((u_char *)pbd + pbd->hdr.bh1.offset_to_first_pkt);
+
+  for (idx = 0; idx < num_pkts; idx++) {
+    pkthdr.ts.tv_sec = ppd->tp_sec;
+    pkthdr.ts.tv_usec = (ppd->tp_nsec / 1000);
+    pkthdr.len = ppd->tp_len;
+    pkthdr.caplen = MIN(ppd->tp_snaplen, ring->snaplen);
+    pkt = ((u_char *)ppd + ppd->tp_mac);
+
+    /* 802.1Q tag has been stripped by the kernel, re-insert it so that
+       link layer handlers can find it where they expect it */
+    if ((ppd->tp_status & TP_STATUS_VLAN_VALID) && pkthdr.caplen >= (2 * ETH_ADDR_LEN) &&
+	ring->snaplen >= ((2 * ETH_ADDR_LEN) + 4)) {
+      tpid = ETHERTYPE_8021Q;
+#if defined (TP_STATUS_VLAN_TPID_VALID)
+      if (ppd->tp_status & TP_STATUS_VLAN_TPID_VALID) tpid = ppd->hv1.tp_vlan_tpid;
+#endif
+      vlan_hdr = ((tpid << 16) | ppd->hv1.tp_vlan_tci);
+      vlan_hdr = htonl(vlan_hdr);
+      rest = MIN(pkthdr.caplen - (2 * ETH_ADDR_LEN), ring->snaplen - (2 * ETH_ADDR_LEN) - 4);
+
+      memcpy(ring->vlan_buf, pkt, (2 * ETH_ADDR_LEN));
+      memcpy(ring->vlan_buf + (2 * ETH_ADDR_LEN), &vlan_hdr, 4);
+      memcpy(ring->vlan_buf + (2 * ETH_ADDR_LEN) + 4, pkt + (2 * ETH_ADDR_LEN), rest);
+
+      pkt = ring->vlan_buf;
+      pkthdr.caplen = ((2 * ETH_ADDR_LEN) + 4 + rest);
+      pkthdr.len += 4;
+    }
+
+    (*callback)(user, &pkthdr, pkt);
+
+    ppd = (struct tpacket3_hdr *) ((u_char *)ppd + ppd->tp_next_offset);
+  }
+}
+
+void tpacket_v3_stats(struct tpacket_v3_ring *ring)
+{
+  struct tpacket_stats_v3 st;
+  socklen_t len = sizeof(st);
+
+  if (!ring || ring->fd == ERR) return;
+
+  memset(&st, 0, sizeof(st));
+  if (getsockopt(ring->fd, SOL_PACKET, PACKET_STATISTICS, &st, &len) == -1) return;
+
+  ring->packets += st.tp_packets;
+  ring->drops += st.tp_drops;
+  ring->freeze_q_cnt += st.tp_freeze_q_cnt;
+}
+
+void tpacket_v3_close(struct tpacket_v3_ring *ring)
+{
+  tpacket_v3_stats(ring);
+
+  if (ring->map) munmap(ring->map, ring->map_len);
+  if (ring->fd != ERR) close(ring->fd);
+  if (ring->rd) free(ring->rd);
+  if (ring->vlan_buf) free(ring->vlan_buf);
+
+  ring->map = NULL;
+  ring->fd = ERR;
+  ring->rd = NULL;
+  ring->vlan_buf = NULL;
+  ring->block_idx = 0;
+}
+#endif
@@ -0,0 +1,82 @@
+/*
+    pmacct (Promiscuous mode IP Accounting package)
+    pmacct is Copyright (C) 2003-2017 by Paolo Lucente
+*/
+
+/*
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+/* includes */
+#if defined (PCAP_TYPE_linux)
+#include <linux/if_packet.h>
+#include <linux/if_ether.h>
+#include <net/if_arp.h>
+#include <linux/filter.h>
+#include <sys/uio.h>
+#include <sys/poll.h>
+#if defined (PACKET_FANOUT) && defined (TP_STATUS_BLK_TMO)
+#define HAVE_TPACKET_V3
+#endif
+#endif
+
+/* defines */
+#define DEFAULT_TPACKET_BLOCK_SIZE	1048576	/* 1 Mb */
+#define DEFAULT_TPACKET_BLOCK_NUM	64
+#define TPACKET_BLOCK_TMO		100	/* msecs */
+#define TPACKET_POLL_TMO		1000	/* msecs, same as pcap_open_live() */
+#define TPACKET_POLL_ERR_BACKOFF	100	/* msecs */
+#define TPACKET_POLL_ERR_MAX		50	/* consecutive error wake-ups before giving up */
+
+/* structures */
+struct tpacket_v3_ring {
+  int fd;
+  int link_type;
+  u_int32_t snaplen;
+  u_char *map;
+  size_t map_len;
+  struct iovec *rd;
+  u_int32_t block_size;
+  u_int32_t block_num;
+  u_int32_t block_idx;
+  u_char *vlan_buf;		/* scratch to re-insert 802.1Q tags stripped by the kernel */
+
+  /* PACKET_STATISTICS are reset on read: we accumulate them */
+  u_int64_t packets;
+  u_int64_t drops;
+  u_int64_t freeze_q_cnt;
+};
+
+/* prototypes */
+#if (!defined __TPACKET_C)
+#define EXT extern
+#else
+#define EXT
+#endif
+#if defined (PCAP_TYPE_linux) && defined (PACKET_FANOUT)
+EXT int tpacket_set_fanout(int, int, int);
+#endif
+#if defined (HAVE_TPACKET_V3)
+EXT int tpacket_v3_open(struct tpacket_v3_ring *, char *, int, int);
+EXT int tpacket_v3_setfilter(struct tpacket_v3_ring *, struct bpf_program *);
+EXT void tpacket_v3_loop(struct tpacket_v3_ring *, pcap_handler, u_char *);
+EXT void tpacket_v3_walk_block(struct tpacket_v3_ring *, struct tpacket_block_desc *, pcap_handler, u_char *);
+EXT void tpacket_v3_stats(struct tpacket_v3_ring *);
+EXT void tpacket_v3_close(struct tpacket_v3_ring *);
+#endif
+
+/* global vars */
+EXT struct tpacket_v3_ring *glob_tpacket_ring; /* SIGUSR1 stats handling */
+#undef EXT
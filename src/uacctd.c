@@ -39,10 +39,21 @@
 #include <netinet/ip.h>
 #include <libnfnetlink/libnfnetlink.h>
 #include <libnetfilter_log/libnetfilter_log.h>
+#include <linux/sock_diag.h>
+#include <sys/poll.h>
 
 /* variables to be exported away */
 struct channels_list_entry channels_list[MAX_N_PLUGINS]; /* communication channels: core <-> plugins */
 
+/* NFLOG groups and batched receive buffers */
+static struct nflog_group_ctl nflog_groups[MAX_NFLOG_GROUPS];
+static int nflog_groups_num;
+static unsigned char *nflog_buffer;
+#if defined HAVE_RECVMMSG
+static struct mmsghdr *nflog_msgs;
+static struct iovec *nflog_iovs;
+#endif
+
 /* Functions */
 static int nflog_incoming(struct nflog_g_handle *gh, struct nfgenmsg *nfmsg,
                           struct nflog_data *nfa, void *p)
@@ -52,7 +63,16 @@ static int nflog_incoming(struct nflog_g_handle *gh, struct nfgenmsg *nfmsg,
   char *pkt = NULL;
   ssize_t pkt_len = nflog_get_payload(nfa, &pkt);
   ssize_t mac_len = nflog_get_msg_packet_hwhdrlen(nfa);
-  struct pcap_callback_data *cb_data = p;
+  struct nflog_group_ctl *ngc = p;
+  struct pcap_callback_data *cb_data = ngc->cb_data;
+  u_int32_t seq;
+
+  if (!nflog_get_seq(nfa, &seq)) {
+    if (ngc->seq_valid && seq != ngc->seq_next) ngc->seq_gaps += (u_int32_t)(seq - ngc->seq_next);
+    ngc->seq_next = (seq + 1);
+    ngc->seq_valid = TRUE;
+  }
+  ngc->packets++;
 
   /* Check we can handle this packet */
   switch (nfmsg->nfgen_family) {
@@ -105,6 +125,183 @@ static int nflog_incoming(struct nflog_g_handle *gh, struct nfgenmsg *nfmsg,
 #else
   pcap_cb((u_char *) cb_data, &hdr, pkt);
 #endif
+
+  return 0;
+}
+
+static int nflog_group_open(struct nflog_group_ctl *ngc, int group, int bind_pf, struct pcap_callback_data *cb_data)
+{
+  int one = 1;
+
+  memset(ngc, 0, sizeof(struct nflog_group_ctl));
+  ngc->group = group;
+  ngc->cb_data = cb_data;
+
+  ngc->nfh = nflog_open();
+  if (ngc->nfh == NULL) {
+    Log(LOG_ERR, "ERROR ( %s/core ): Failed to create Netlink NFLOG socket\n", config.name);
+    return ERR;
+  }
+
+  /* Bind to IPv4 (and IPv6); this is global to the kernel so it is done once */
+  if (bind_pf) {
+    if (nflog_unbind_pf(ngc->nfh, AF_INET) < 0) {
+      Log(LOG_ERR, "ERROR ( %s/core ): Failed to unbind Netlink NFLOG socket from IPv4\n", config.name);
+      goto err_lane;
+    }
+    if (nflog_bind_pf(ngc->nfh, AF_INET) < 0) {
+      Log(LOG_ERR, "ERROR ( %s/core ): Failed to bind Netlink NFLOG socket from IPv4\n", config.name);
+      goto err_lane;
+    }
+#if defined ENABLE_IPV6
+    if (nflog_unbind_pf(ngc->nfh, AF_INET6) < 0) {
+      Log(LOG_ERR, "ERROR ( %s/core ): Failed to unbind Netlink NFLOG socket from IPv6\n", config.name);
+      goto err_lane;
+    }
+    if (nflog_bind_pf(ngc->nfh, AF_INET6) < 0) {
+      Log(LOG_ERR, "ERROR ( %s/core ): Failed to bind Netlink NFLOG socket from IPv6\n", config.name);
+      goto err_lane;
+    }
+#endif
+  }
+
+  /* Bind to group */
+  if ((ngc->nfgh = nflog_bind_group(ngc->nfh, group)) == NULL) {
+    Log(LOG_ERR, "ERROR ( %s/core ): Failed to join NFLOG group %d\n", config.name, group);
+    goto err_lane;
+  }
+
+  /* Set snaplen */
+  if (nflog_set_mode(ngc->nfgh, NFULNL_COPY_PACKET, config.snaplen) < 0) {
+    Log(LOG_ERR, "ERROR ( %s/core ): Failed to set snaplen to %d\n", config.name, config.snaplen);
+    goto err_lane;
+  }
+
+  /* Set threshold */
+  if (nflog_set_qthresh(ngc->nfgh, config.uacctd_threshold) < 0) {
+    Log(LOG_ERR, "ERROR ( %s/core ): Failed to set threshold to %d\n", config.name, config.uacctd_threshold);
+    goto err_lane;
+  }
+
+  /* Set buffer size */
+  if (nflog_set_nlbufsiz(ngc->nfgh, config.uacctd_nl_size) < 0) {
+    Log(LOG_ERR, "ERROR ( %s/core ): Failed to set receive buffer size to %d\n", config.name, config.uacctd_nl_size);
+    goto err_lane;
+  }
+
+  /* Ask for per-instance sequence numbers to spot losses */
+  if (nflog_set_flags(ngc->nfgh, NFULNL_CFG_F_SEQ) < 0)
+    Log(LOG_WARNING, "WARN ( %s/core ): Failed to enable sequence numbers on NFLOG group %d\n", config.name, group);
+
+  ngc->fd = nflog_fd(ngc->nfh);
+
+  /* Turn off netlink errors from overrun: overruns show up in sock_drops */
+  if (setsockopt(ngc->fd, SOL_NETLINK, NETLINK_NO_ENOBUFS, &one, sizeof(one)))
+    Log(LOG_ERR, "ERROR ( %s/core ): Failed to turn off netlink ENOBUFS\n", config.name);
+
+  nflog_callback_register(ngc->nfgh, &nflog_incoming, ngc);
+
+  Log(LOG_INFO, "INFO ( %s/core ): Successfully joined NFLOG group %d\n", config.name, group);
+
+  return SUCCESS;
+
+  err_lane:
+  if (ngc->nfgh) nflog_unbind_group(ngc->nfgh);
+  nflog_close(ngc->nfh);
+  ngc->nfgh = NULL;
+  ngc->nfh = NULL;
+
+  return ERR;
+}
+
+/* A message larger than uacctd_nl_size can't be parsed: it is counted
+   and skipped */
+static void nflog_group_truncated(struct nflog_group_ctl *ngc)
+{
+  if (!ngc->truncated)
+    Log(LOG_WARNING, "WARN ( %s/core ): NFLOG group %d: message larger than uacctd_nl_size (%d bytes) skipped\n",
+	config.name, ngc->group, config.uacctd_nl_size);
+
+  ngc->truncated++;
+}
+
+/* Drains up to uacctd_nl_batch netlink messages from the group socket
+   with as few system calls as possible */
+static void nflog_group_recv(struct nflog_group_ctl *ngc)
+{
+  int idx, num = 0;
+#if !defined HAVE_RECVMMSG
+  ssize_t len;
+#endif
+
+#if defined HAVE_RECVMMSG
+  for (idx = 0; idx < config.uacctd_nl_batch; idx++) nflog_msgs[idx].msg_len = 0;
+  num = recvmmsg(ngc->fd, nflog_msgs, config.uacctd_nl_batch, MSG_DONTWAIT, NULL);
+  if (num < 0) {
+    /* ENOBUFS: only if NETLINK_NO_ENOBUFS could not be set, counted in sock_drops anyway */
+    if (errno != EAGAIN && errno != EINTR && errno != ENOBUFS)
+      Log(LOG_ERR, "ERROR ( %s/core ): NFLOG group %d: recvmmsg() failed: %s\n", config.name, ngc->group, strerror(errno));
+    return;
+  }
+
+  for (idx = 0; idx < num; idx++) {
+    if (nflog_msgs[idx].msg_hdr.msg_flags & MSG_TRUNC) {
+      nflog_group_truncated(ngc);
+      continue;
+    }
+
+    nflog_handle_packet(ngc->nfh, (char *) nflog_iovs[idx].iov_base, nflog_msgs[idx].msg_len);
+  }
+#else
+  for (idx = 0; idx < config.uacctd_nl_batch; idx++, num++) {
+    /* MSG_TRUNC: netlink returns the real length of a truncated message */
+    len = recv(ngc->fd, nflog_buffer, config.uacctd_nl_size, MSG_DONTWAIT|MSG_TRUNC);
+    if (len < 0) {
+      if (errno != EAGAIN && errno != EINTR && errno != ENOBUFS)
+        Log(LOG_ERR, "ERROR ( %s/core ): NFLOG group %d: recv() failed: %s\n", config.name, ngc->group, strerror(errno));
+      break;
+    }
+
+    if (len > config.uacctd_nl_size) {
+      nflog_group_truncated(ngc);
+      continue;
+    }
+
+    nflog_handle_packet(ngc->nfh, (char *) nflog_buffer, len);
+  }
+#endif
+
+  if (num) ngc->batches++;
+}
+
+static void nflog_group_sock_drops(struct nflog_group_ctl *ngc)
+{
+#if defined SO_MEMINFO
+  u_int32_t meminfo[SK_MEMINFO_VARS];
+  socklen_t len = sizeof(meminfo);
+
+  memset(meminfo, 0, sizeof(meminfo));
+  if (!getsockopt(ngc->fd, SOL_SOCKET, SO_MEMINFO, meminfo, &len))
+    ngc->sock_drops = meminfo[SK_MEMINFO_DROPS];
+#endif
+}
+
+void uacctd_push_stats()
+{
+  time_t now = time(NULL);
+  int idx;
+
+  for (idx = 0; idx < nflog_groups_num; idx++) {
+    nflog_group_sock_drops(&nflog_groups[idx]);
+
+    Log(LOG_NOTICE, "NOTICE ( %s/%s ): NFLOG group %d: (%u) packets=%llu batches=%llu seq_gaps=%llu truncated=%llu sock_drops=%u\n",
+	config.name, config.type, nflog_groups[idx].group, now,
+	(unsigned long long)nflog_groups[idx].packets, (unsigned long long)nflog_groups[idx].batches,
+	(unsigned long long)nflog_groups[idx].seq_gaps, (unsigned long long)nflog_groups[idx].truncated,
+	nflog_groups[idx].sock_drops);
+  }
+
+  signal(SIGUSR1, uacctd_push_stats);
 }
 
 void usage_daemon(char *prog_name)
@@ -127,7 +324,7 @@ void usage_daemon(char *prog_name)
   printf("  -S  \t[ auth | mail | daemon | kern | user | local[0-7] ] \n\tLog to the specified syslog facility\n");
   printf("  -F  \tWrite Core Process PID into the specified file\n");
   printf("  -R  \tRenormalize sampled data\n");
-  printf("  -g  \tNetlink NFLOG group\n");
+  printf("  -g  \tNetlink NFLOG group(s), comma-separated\n");
   printf("  -L  \tSnapshot length\n");
   printf("  -u  \tLeave IP protocols in numerical format\n");
   printf("\nMemory plugin (-P memory) options:\n");
@@ -170,11 +367,8 @@ int main(int argc,char **argv, char **envp)
   int errflag, cp;
 
   /* NFLOG stuff */
-  struct nflog_handle *nfh = NULL;
-  struct nflog_g_handle *nfgh = NULL;
-  int one = 1;
-  ssize_t len = 0;
-  unsigned char *nflog_buffer;
+  struct pollfd nflog_pfds[MAX_NFLOG_GROUPS];
+  int nflog_idx;
 
 #if defined ENABLE_IPV6
   struct sockaddr_storage client;
@@ -386,6 +580,7 @@ int main(int argc,char **argv, char **envp)
 
   if (!config.snaplen) config.snaplen = DEFAULT_SNAPLEN;
   if (!config.uacctd_nl_size) config.uacctd_nl_size = DEFAULT_NFLOG_BUFLEN;
+  if (!config.uacctd_nl_batch) config.uacctd_nl_batch = DEFAULT_NFLOG_BATCH;
   if (!config.uacctd_threshold) config.uacctd_threshold = DEFAULT_NFLOG_THRESHOLD;
 
   /* Let's check whether we need superuser privileges */
@@ -404,6 +599,11 @@ int main(int argc,char **argv, char **envp)
     }
   }
 
+  if (!config.uacctd_groups_num) {
+    config.uacctd_groups[0] = config.uacctd_group;
+    config.uacctd_groups_num = 1;
+  }
+
   if (config.daemon) {
     list = plugins_list;
     while (list) {
@@ -719,83 +919,38 @@ int main(int argc,char **argv, char **envp)
   signal(SIGUSR2, reload_maps); /* sets to true the reload_maps flag */
   signal(SIGPIPE, SIG_IGN); /* we want to exit gracefully when a pipe is broken */
 
-  nfh = nflog_open();
-  if (nfh == NULL) {
-    Log(LOG_ERR, "ERROR ( %s/core ): Failed to create Netlink NFLOG socket\n", config.name);
-    nflog_close(nfh);
-    exit_all(1);
-  }
-
-  Log(LOG_INFO, "INFO ( %s/core ): Successfully connected Netlink NFLOG socket\n", config.name);
+  for (nflog_idx = 0; nflog_idx < config.uacctd_groups_num; nflog_idx++) {
+    if (nflog_group_open(&nflog_groups[nflog_idx], config.uacctd_groups[nflog_idx], !nflog_idx, &cb_data) == ERR)
+      exit_all(1);
 
-  /* Bind to IPv4 (and IPv6) */
-  if (nflog_unbind_pf(nfh, AF_INET) < 0) {
-    Log(LOG_ERR, "ERROR ( %s/core ): Failed to unbind Netlink NFLOG socket from IPv4\n", config.name);
-    nflog_close(nfh);
-    exit_all(1);
-  }
-  if (nflog_bind_pf(nfh, AF_INET) < 0) {
-    Log(LOG_ERR, "ERROR ( %s/core ): Failed to bind Netlink NFLOG socket from IPv4\n", config.name);
-    nflog_close(nfh);
-    exit_all(1);
-  }
-#if defined ENABLE_IPV6
-  if (nflog_unbind_pf(nfh, AF_INET6) < 0) {
-    Log(LOG_ERR, "ERROR ( %s/core ): Failed to unbind Netlink NFLOG socket from IPv6\n", config.name);
-    nflog_close(nfh);
-    exit_all(1);
-  }
-  if (nflog_bind_pf(nfh, AF_INET6) < 0) {
-    Log(LOG_ERR, "ERROR ( %s/core ): Failed to bind Netlink NFLOG socket from IPv6\n", config.name);
-    nflog_close(nfh);
-    exit_all(1);
-  }
-#endif
-
-  /* Bind to group */
-  if ((nfgh = nflog_bind_group(nfh, config.uacctd_group)) == NULL) {
-    Log(LOG_ERR, "ERROR ( %s/core ): Failed to join NFLOG group %d\n", config.name, config.uacctd_group);
-    nflog_close(nfh);
-    exit_all(1);
-  }
-
-  /* Set snaplen */
-  if (nflog_set_mode(nfgh, NFULNL_COPY_PACKET, config.snaplen) < 0) {
-    Log(LOG_ERR, "ERROR ( %s/core ): Failed to set snaplen to %d\n", config.name, config.snaplen);
-    nflog_unbind_group(nfgh);
-    nflog_close(nfh);
-    exit_all(1);
-  }
-
-  /* Set threshold */
-  if (nflog_set_qthresh(nfgh, config.uacctd_threshold) < 0) {
-    Log(LOG_ERR, "ERROR ( %s/core ): Failed to set threshold to %d\n", config.name, config.uacctd_threshold);
-    nflog_unbind_group(nfgh);
-    nflog_close(nfh);
-    exit_all(1);
-  }
-
-  /* Set buffer size */
-  if (nflog_set_nlbufsiz(nfgh, config.uacctd_nl_size) < 0) {
-    Log(LOG_ERR, "ERROR ( %s/core ): Failed to set receive buffer size to %d\n", config.name, config.uacctd_nl_size);
-    nflog_unbind_group(nfgh);
-    nflog_close(nfh);
-    exit_all(1);
+    nflog_pfds[nflog_idx].fd = nflog_groups[nflog_idx].fd;
+    nflog_pfds[nflog_idx].events = POLLIN;
+    nflog_groups_num++;
   }
 
-  /* Turn off netlink errors from overrun. */
-  if (setsockopt(nflog_fd(nfh), SOL_NETLINK, NETLINK_NO_ENOBUFS, &one, sizeof(one)))
-    Log(LOG_ERR, "ERROR ( %s/core ): Failed to turn off netlink ENOBUFS\n", config.name);
+  Log(LOG_INFO, "INFO ( %s/core ): Successfully connected Netlink NFLOG socket(s)\n", config.name);
 
-  nflog_callback_register(nfgh, &nflog_incoming, &cb_data);
-  nflog_buffer = malloc(config.uacctd_nl_size);
+  nflog_buffer = malloc((size_t) config.uacctd_nl_size * config.uacctd_nl_batch);
+#if defined HAVE_RECVMMSG
+  nflog_msgs = malloc(sizeof(struct mmsghdr) * config.uacctd_nl_batch);
+  nflog_iovs = malloc(sizeof(struct iovec) * config.uacctd_nl_batch);
+  if (nflog_msgs == NULL || nflog_iovs == NULL) nflog_buffer = NULL;
+#endif
   if (nflog_buffer == NULL) {
     Log(LOG_ERR, "ERROR ( %s/core ): NFLOG buffer malloc() failed\n", config.name);
-    nflog_unbind_group(nfgh);
-    nflog_close(nfh);
     exit_all(1);
   }
 
+#if defined HAVE_RECVMMSG
+  memset(nflog_msgs, 0, sizeof(struct mmsghdr) * config.uacctd_nl_batch);
+  for (nflog_idx = 0; nflog_idx < config.uacctd_nl_batch; nflog_idx++) {
+    nflog_iovs[nflog_idx].iov_base = nflog_buffer + ((size_t) nflog_idx * config.uacctd_nl_size);
+    nflog_iovs[nflog_idx].iov_len = config.uacctd_nl_size;
+    nflog_msgs[nflog_idx].msg_hdr.msg_iov = &nflog_iovs[nflog_idx];
+    nflog_msgs[nflog_idx].msg_hdr.msg_iovlen = 1;
+  }
+#endif
+
 #if defined ENABLE_THREADS
   /* starting the ISIS threa */
   if (config.nfacctd_isis) {
@@ -908,23 +1063,38 @@ int main(int argc,char **argv, char **envp)
   signal(SIGINT, my_sigint_handler);
   signal(SIGTERM, my_sigint_handler);
   signal(SIGCHLD, handle_falling_child);
+  signal(SIGUSR1, uacctd_push_stats); /* per NFLOG group counters */
   kill(getpid(), SIGCHLD);
 
-  /* Main loop: if pcap_loop() exits maybe an error occurred; we will try closing
-     and reopening again our listening device */
+  /* live statistics for external tools, if a segment is configured */
+  stats_shm_wrapper();
+
+  /* Main loop: NFLOG groups are multiplexed and each ready socket is
+     drained in batches; on timeouts pcap_cb() is invoked with no packet
+     so that maps get reloaded in idle times too. All groups are served
+     by this one thread: pcap_cb() and the plugin rings it feeds have a
+     single producer. Using more cores takes one uacctd per group. */
   for (;;) {
-    if (len == -1) {
-      if (errno != EAGAIN) {
+    ret = poll(nflog_pfds, nflog_groups_num, NFLOG_POLL_TMO);
+
+    if (ret < 0) {
+      if (errno != EINTR) {
         /* We can't deal with permanent errors.
          * Just sleep a bit.
          */
         Log(LOG_ERR, "ERROR ( %s/core ): Syscall returned %d: %s. Sleeping for 1 sec.\n", config.name, errno, strerror(errno));
         sleep(1);
       }
+      continue;
+    }
+    else if (!ret) {
+      pcap_cb((u_char *) &cb_data, NULL, NULL);
+      continue;
     }
 
-    len = recv(nflog_fd(nfh), nflog_buffer, config.uacctd_nl_size, 0);
-    if (len < 0) continue;
-    if (nflog_handle_packet(nfh, nflog_buffer, len) != 0) continue;
+    for (nflog_idx = 0; nflog_idx < nflog_groups_num; nflog_idx++) {
+      if (nflog_pfds[nflog_idx].revents & (POLLIN|POLLERR))
+        nflog_group_recv(&nflog_groups[nflog_idx]);
+    }
   }
 }
@@ -1,3 +1,24 @@
 #define DEFAULT_NFLOG_BUFLEN (1024*128)
 #define DEFAULT_NFLOG_GROUP 0
 #define DEFAULT_NFLOG_THRESHOLD 1
+#define DEFAULT_NFLOG_BATCH 16
+#define NFLOG_POLL_TMO 1000 /* msecs */
+
+struct nflog_group_ctl {
+  int group;
+  int fd;
+  struct nflog_handle *nfh;
+  struct nflog_g_handle *nfgh;
+  struct pcap_callback_data *cb_data;
+
+  /* NFULNL_CFG_F_SEQ: gaps in the per-instance sequence number
+     account for messages lost between the kernel and us */
+  u_int32_t seq_next;
+  int seq_valid;
+
+  u_int64_t packets;
+  u_int64_t batches;
+  u_int64_t seq_gaps;
+  u_int64_t truncated;		/* messages larger than uacctd_nl_size, skipped */
+  u_int32_t sock_drops;
+};
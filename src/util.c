@@ -2626,23 +2626,36 @@ avro_value_t compose_avro(u_int64_t wtc, u_int64_t wtc_2, u_int8_t flow_type, st
   char *pcust, struct pkt_vlen_hdr_primitives *pvlen, pm_counter_t bytes_counter,
   pm_counter_t packet_counter, pm_counter_t flow_counter, u_int32_t tcp_flags, struct timeval *basetime,
   struct pkt_stitching *stitch, avro_value_iface_t *iface)
+{
+  avro_value_t value;
+
+  check_i(avro_generic_value_new(iface, &value));
+  compose_avro_value(wtc, wtc_2, flow_type, pbase, pbgp, pnat, pmpls, pcust, pvlen, bytes_counter,
+		     packet_counter, flow_counter, tcp_flags, basetime, stitch, &value);
+
+  return value;
+}
+
+void compose_avro_value(u_int64_t wtc, u_int64_t wtc_2, u_int8_t flow_type, struct pkt_primitives *pbase,
+  struct pkt_bgp_primitives *pbgp, struct pkt_nat_primitives *pnat, struct pkt_mpls_primitives *pmpls,
+  char *pcust, struct pkt_vlen_hdr_primitives *pvlen, pm_counter_t bytes_counter,
+  pm_counter_t packet_counter, pm_counter_t flow_counter, u_int32_t tcp_flags, struct timeval *basetime,
+  struct pkt_stitching *stitch, avro_value_t *value)
 {
   char src_mac[18], dst_mac[18], src_host[INET6_ADDRSTRLEN], dst_host[INET6_ADDRSTRLEN], ip_address[INET6_ADDRSTRLEN];
   char rd_str[SRVBUFLEN], misc_str[SRVBUFLEN], *as_path, *bgp_comm, empty_string[] = "", *str_ptr;
   char tstamp_str[SRVBUFLEN];
 
-  avro_value_t value;
   avro_value_t field;
   avro_value_t branch;
-  check_i(avro_generic_value_new(iface, &value));
 
   if (wtc & COUNT_TAG) {
-    check_i(avro_value_get_by_name(&value, "tag", &field, NULL));
+    check_i(avro_value_get_by_name(value, "tag", &field, NULL));
     check_i(avro_value_set_long(&field, pbase->tag));
   }
 
   if (wtc & COUNT_TAG2) {
-    check_i(avro_value_get_by_name(&value, "tag2", &field, NULL));
+    check_i(avro_value_get_by_name(value, "tag2", &field, NULL));
     check_i(avro_value_set_long(&field, pbase->tag2));
   }
 
@@ -2650,52 +2663,52 @@ avro_value_t compose_avro(u_int64_t wtc, u_int64_t wtc_2, u_int8_t flow_type, st
     vlen_prims_get(pvlen, COUNT_INT_LABEL, &str_ptr);
     if (!str_ptr) str_ptr = empty_string;
 
-    check_i(avro_value_get_by_name(&value, "label", &field, NULL));
+    check_i(avro_value_get_by_name(value, "label", &field, NULL));
     check_i(avro_value_set_string(&field, str_ptr));
   }
 
   if (wtc & COUNT_CLASS) {
-    check_i(avro_value_get_by_name(&value, "class", &field, NULL));
+    check_i(avro_value_get_by_name(value, "class", &field, NULL));
     check_i(avro_value_set_string(&field, ((pbase->class && class[(pbase->class)-1].id) ? class[(pbase->class)-1].protocol : "unknown" )));
   }
 
 #if defined (HAVE_L2)
   if (wtc & (COUNT_SRC_MAC|COUNT_SUM_MAC)) {
     etheraddr_string(pbase->eth_shost, src_mac);
-    check_i(avro_value_get_by_name(&value, "mac_src", &field, NULL));
+    check_i(avro_value_get_by_name(value, "mac_src", &field, NULL));
     check_i(avro_value_set_string(&field, src_mac));
   }
 
   if (wtc & COUNT_DST_MAC) {
     etheraddr_string(pbase->eth_dhost, dst_mac);
-    check_i(avro_value_get_by_name(&value, "mac_dst", &field, NULL));
+    check_i(avro_value_get_by_name(value, "mac_dst", &field, NULL));
     check_i(avro_value_set_string(&field, dst_mac));
   }
 
   if (wtc & COUNT_VLAN) {
-    check_i(avro_value_get_by_name(&value, "vlan", &field, NULL));
+    check_i(avro_value_get_by_name(value, "vlan", &field, NULL));
     check_i(avro_value_set_long(&field, pbase->vlan_id));
   }
 
   if (wtc & COUNT_COS) {
-    check_i(avro_value_get_by_name(&value, "cos", &field, NULL));
+    check_i(avro_value_get_by_name(value, "cos", &field, NULL));
     check_i(avro_value_set_long(&field, pbase->cos));
   }
 
   if (wtc & COUNT_ETHERTYPE) {
     sprintf(misc_str, "%x", pbase->etype);
-    check_i(avro_value_get_by_name(&value, "etype", &field, NULL));
+    check_i(avro_value_get_by_name(value, "etype", &field, NULL));
     check_i(avro_value_set_string(&field, misc_str));
   }
 #endif
 
   if (wtc & (COUNT_SRC_AS|COUNT_SUM_AS)) {
-    check_i(avro_value_get_by_name(&value, "as_src", &field, NULL));
+    check_i(avro_value_get_by_name(value, "as_src", &field, NULL));
     check_i(avro_value_set_long(&field, pbase->src_as));
   }
 
   if (wtc & COUNT_DST_AS) {
-    check_i(avro_value_get_by_name(&value, "as_dst", &field, NULL));
+    check_i(avro_value_get_by_name(value, "as_dst", &field, NULL));
     check_i(avro_value_set_long(&field, pbase->dst_as));
   }
 
@@ -2710,7 +2723,7 @@ avro_value_t compose_avro(u_int64_t wtc, u_int64_t wtc_2, u_int8_t flow_type, st
     }
     else str_ptr = empty_string;
 
-    check_i(avro_value_get_by_name(&value, "comms", &field, NULL));
+    check_i(avro_value_get_by_name(value, "comms", &field, NULL));
     check_i(avro_value_set_string(&field, str_ptr));
   }
 
@@ -2726,9 +2739,9 @@ avro_value_t compose_avro(u_int64_t wtc, u_int64_t wtc_2, u_int8_t flow_type, st
     else str_ptr = empty_string;
 
     if (!config.tmp_comms_same_field)
-      check_i(avro_value_get_by_name(&value, "ecomms", &field, NULL));
+      check_i(avro_value_get_by_name(value, "ecomms", &field, NULL));
     else 
-      check_i(avro_value_get_by_name(&value, "comms", &field, NULL));
+      check_i(avro_value_get_by_name(value, "comms", &field, NULL));
 
     check_i(avro_value_set_string(&field, str_ptr));
   }
@@ -2744,7 +2757,7 @@ avro_value_t compose_avro(u_int64_t wtc, u_int64_t wtc_2, u_int8_t flow_type, st
     }
     else str_ptr = empty_string;
 
-    check_i(avro_value_get_by_name(&value, "lcomms", &field, NULL));
+    check_i(avro_value_get_by_name(value, "lcomms", &field, NULL));
     check_i(avro_value_set_string(&field, str_ptr));
   }
 
@@ -2759,38 +2772,38 @@ avro_value_t compose_avro(u_int64_t wtc, u_int64_t wtc_2, u_int8_t flow_type, st
     }
     else str_ptr = empty_string;
 
-    check_i(avro_value_get_by_name(&value, "as_path", &field, NULL));
+    check_i(avro_value_get_by_name(value, "as_path", &field, NULL));
     check_i(avro_value_set_string(&field, str_ptr));
   }
 
   if (wtc & COUNT_LOCAL_PREF) {
-    check_i(avro_value_get_by_name(&value, "local_pref", &field, NULL));
+    check_i(avro_value_get_by_name(value, "local_pref", &field, NULL));
     check_i(avro_value_set_long(&field, pbgp->local_pref));
   }
 
   if (wtc & COUNT_MED) {
-    check_i(avro_value_get_by_name(&value, "med", &field, NULL));
+    check_i(avro_value_get_by_name(value, "med", &field, NULL));
     check_i(avro_value_set_long(&field, pbgp->med));
   }
 
   if (wtc & COUNT_PEER_SRC_AS) {
-    check_i(avro_value_get_by_name(&value, "peer_as_src", &field, NULL));
+    check_i(avro_value_get_by_name(value, "peer_as_src", &field, NULL));
     check_i(avro_value_set_long(&field, pbgp->peer_src_as));
   }
 
   if (wtc & COUNT_PEER_DST_AS) {
-    check_i(avro_value_get_by_name(&value, "peer_as_dst", &field, NULL));
+    check_i(avro_value_get_by_name(value, "peer_as_dst", &field, NULL));
     check_i(avro_value_set_long(&field, pbgp->peer_dst_as));
   }
 
   if (wtc & COUNT_PEER_SRC_IP) {
-    check_i(avro_value_get_by_name(&value, "peer_ip_src", &field, NULL));
+    check_i(avro_value_get_by_name(value, "peer_ip_src", &field, NULL));
     addr_to_str(ip_address, &pbgp->peer_src_ip);
     check_i(avro_value_set_string(&field, ip_address));
   }
 
   if (wtc & COUNT_PEER_DST_IP) {
-    check_i(avro_value_get_by_name(&value, "peer_ip_dst", &field, NULL));
+    check_i(avro_value_get_by_name(value, "peer_ip_dst", &field, NULL));
     addr_to_str(ip_address, &pbgp->peer_dst_ip);
     check_i(avro_value_set_string(&field, ip_address));
   }
@@ -2806,7 +2819,7 @@ avro_value_t compose_avro(u_int64_t wtc, u_int64_t wtc_2, u_int8_t flow_type, st
     }
     else str_ptr = empty_string;
 
-    check_i(avro_value_get_by_name(&value, "src_comms", &field, NULL));
+    check_i(avro_value_get_by_name(value, "src_comms", &field, NULL));
     check_i(avro_value_set_string(&field, str_ptr));
   }
 
@@ -2822,9 +2835,9 @@ avro_value_t compose_avro(u_int64_t wtc, u_int64_t wtc_2, u_int8_t flow_type, st
     else str_ptr = empty_string;
 
     if (!config.tmp_comms_same_field)
-      check_i(avro_value_get_by_name(&value, "src_ecomms", &field, NULL));
+      check_i(avro_value_get_by_name(value, "src_ecomms", &field, NULL));
     else
-      check_i(avro_value_get_by_name(&value, "src_comms", &field, NULL));
+      check_i(avro_value_get_by_name(value, "src_comms", &field, NULL));
 
     check_i(avro_value_set_string(&field, str_ptr));
   }
@@ -2840,7 +2853,7 @@ avro_value_t compose_avro(u_int64_t wtc, u_int64_t wtc_2, u_int8_t flow_type, st
     }
     else str_ptr = empty_string;
 
-    check_i(avro_value_get_by_name(&value, "src_lcomms", &field, NULL));
+    check_i(avro_value_get_by_name(value, "src_lcomms", &field, NULL));
     check_i(avro_value_set_string(&field, str_ptr));
   }
 
@@ -2855,95 +2868,95 @@ avro_value_t compose_avro(u_int64_t wtc, u_int64_t wtc_2, u_int8_t flow_type, st
     }
     else str_ptr = empty_string;
 
-    check_i(avro_value_get_by_name(&value, "src_as_path", &field, NULL));
+    check_i(avro_value_get_by_name(value, "src_as_path", &field, NULL));
     check_i(avro_value_set_string(&field, str_ptr));
   }
 
   if (wtc & COUNT_SRC_LOCAL_PREF) {
-    check_i(avro_value_get_by_name(&value, "src_local_pref", &field, NULL));
+    check_i(avro_value_get_by_name(value, "src_local_pref", &field, NULL));
     check_i(avro_value_set_long(&field, pbgp->src_local_pref));
   }
 
   if (wtc & COUNT_SRC_MED) {
-    check_i(avro_value_get_by_name(&value, "src_med", &field, NULL));
+    check_i(avro_value_get_by_name(value, "src_med", &field, NULL));
     check_i(avro_value_set_long(&field, pbgp->src_med));
   }
 
   if (wtc & COUNT_IN_IFACE) {
-    check_i(avro_value_get_by_name(&value, "iface_in", &field, NULL));
+    check_i(avro_value_get_by_name(value, "iface_in", &field, NULL));
     check_i(avro_value_set_long(&field, pbase->ifindex_in));
   }
 
   if (wtc & COUNT_OUT_IFACE) {
-    check_i(avro_value_get_by_name(&value, "iface_out", &field, NULL));
+    check_i(avro_value_get_by_name(value, "iface_out", &field, NULL));
     check_i(avro_value_set_long(&field, pbase->ifindex_out));
   }
 
   if (wtc & COUNT_MPLS_VPN_RD) {
     bgp_rd2str(rd_str, &pbgp->mpls_vpn_rd);
-    check_i(avro_value_get_by_name(&value, "mpls_vpn_rd", &field, NULL));
+    check_i(avro_value_get_by_name(value, "mpls_vpn_rd", &field, NULL));
     check_i(avro_value_set_string(&field, rd_str));
   }
 
   if (wtc & (COUNT_SRC_HOST|COUNT_SUM_HOST)) {
     addr_to_str(src_host, &pbase->src_ip);
-    check_i(avro_value_get_by_name(&value, "ip_src", &field, NULL));
+    check_i(avro_value_get_by_name(value, "ip_src", &field, NULL));
     check_i(avro_value_set_string(&field, src_host));
   }
 
   if (wtc & (COUNT_SRC_NET|COUNT_SUM_NET)) {
     addr_to_str(src_host, &pbase->src_net);
     if (config.tmp_net_own_field) {
-      check_i(avro_value_get_by_name(&value, "net_src", &field, NULL));
+      check_i(avro_value_get_by_name(value, "net_src", &field, NULL));
       check_i(avro_value_set_string(&field, src_host));
     }
     else {
-      check_i(avro_value_get_by_name(&value, "ip_src", &field, NULL));
+      check_i(avro_value_get_by_name(value, "ip_src", &field, NULL));
       check_i(avro_value_set_string(&field, src_host));
     }
   }
 
   if (wtc & COUNT_DST_HOST) {
     addr_to_str(dst_host, &pbase->dst_ip);
-    check_i(avro_value_get_by_name(&value, "ip_dst", &field, NULL));
+    check_i(avro_value_get_by_name(value, "ip_dst", &field, NULL));
     check_i(avro_value_set_string(&field, dst_host));
   }
 
   if (wtc & COUNT_DST_NET) {
     addr_to_str(dst_host, &pbase->dst_net);
     if (config.tmp_net_own_field) {
-      check_i(avro_value_get_by_name(&value, "net_dst", &field, NULL));
+      check_i(avro_value_get_by_name(value, "net_dst", &field, NULL));
       check_i(avro_value_set_string(&field, dst_host));
     }
     else {
-      check_i(avro_value_get_by_name(&value, "ip_dst", &field, NULL));
+      check_i(avro_value_get_by_name(value, "ip_dst", &field, NULL));
       check_i(avro_value_set_string(&field, dst_host));
     }
   }
 
   if (wtc & COUNT_SRC_NMASK) {
-    check_i(avro_value_get_by_name(&value, "mask_src", &field, NULL));
+    check_i(avro_value_get_by_name(value, "mask_src", &field, NULL));
     check_i(avro_value_set_long(&field, pbase->src_nmask));
   }
 
   if (wtc & COUNT_DST_NMASK) {
-    check_i(avro_value_get_by_name(&value, "mask_dst", &field, NULL));
+    check_i(avro_value_get_by_name(value, "mask_dst", &field, NULL));
     check_i(avro_value_set_long(&field, pbase->dst_nmask));
   }
 
   if (wtc & (COUNT_SRC_PORT|COUNT_SUM_PORT)) {
-    check_i(avro_value_get_by_name(&value, "port_src", &field, NULL));
+    check_i(avro_value_get_by_name(value, "port_src", &field, NULL));
     check_i(avro_value_set_long(&field, pbase->src_port));
   }
 
   if (wtc & COUNT_DST_PORT) {
-    check_i(avro_value_get_by_name(&value, "port_dst", &field, NULL));
+    check_i(avro_value_get_by_name(value, "port_dst", &field, NULL));
     check_i(avro_value_set_long(&field, pbase->dst_port));
   }
 
 #if defined (WITH_GEOIP)
   if (wtc_2 & COUNT_SRC_HOST_COUNTRY) {
-    check_i(avro_value_get_by_name(&value, "country_ip_src", &field, NULL));
+    check_i(avro_value_get_by_name(value, "country_ip_src", &field, NULL));
     if (pbase->src_ip_country.id > 0)
       check_i(avro_value_set_string(&field, GeoIP_code_by_id(pbase->src_ip_country.id)));
     else
@@ -2951,7 +2964,7 @@ avro_value_t compose_avro(u_int64_t wtc, u_int64_t wtc_2, u_int8_t flow_type, st
   }
 
   if (wtc_2 & COUNT_DST_HOST_COUNTRY) {
-    check_i(avro_value_get_by_name(&value, "country_ip_dst", &field, NULL));
+    check_i(avro_value_get_by_name(value, "country_ip_dst", &field, NULL));
     if (pbase->dst_ip_country.id > 0)
       check_i(avro_value_set_string(&field, GeoIP_code_by_id(pbase->dst_ip_country.id)));
     else
@@ -2960,7 +2973,7 @@ avro_value_t compose_avro(u_int64_t wtc, u_int64_t wtc_2, u_int8_t flow_type, st
 #endif
 #if defined (WITH_GEOIPV2)
   if (wtc_2 & COUNT_SRC_HOST_COUNTRY) {
-    check_i(avro_value_get_by_name(&value, "country_ip_src", &field, NULL));
+    check_i(avro_value_get_by_name(value, "country_ip_src", &field, NULL));
     if (strlen(pbase->src_ip_country.str))
       check_i(avro_value_set_string(&field, pbase->src_ip_country.str));
     else
@@ -2968,7 +2981,7 @@ avro_value_t compose_avro(u_int64_t wtc, u_int64_t wtc_2, u_int8_t flow_type, st
   }
 
   if (wtc_2 & COUNT_DST_HOST_COUNTRY) {
-    check_i(avro_value_get_by_name(&value, "country_ip_dst", &field, NULL));
+    check_i(avro_value_get_by_name(value, "country_ip_dst", &field, NULL));
     if (strlen(pbase->dst_ip_country.str))
       check_i(avro_value_set_string(&field, pbase->dst_ip_country.str));
     else
@@ -2976,7 +2989,7 @@ avro_value_t compose_avro(u_int64_t wtc, u_int64_t wtc_2, u_int8_t flow_type, st
   }
 
   if (wtc_2 & COUNT_SRC_HOST_POCODE) {
-    check_i(avro_value_get_by_name(&value, "pocode_ip_src", &field, NULL));
+    check_i(avro_value_get_by_name(value, "pocode_ip_src", &field, NULL));
     if (strlen(pbase->src_ip_pocode.str))
       check_i(avro_value_set_string(&field, pbase->src_ip_pocode.str));
     else
@@ -2984,7 +2997,7 @@ avro_value_t compose_avro(u_int64_t wtc, u_int64_t wtc_2, u_int8_t flow_type, st
   }
 
   if (wtc_2 & COUNT_DST_HOST_POCODE) {
-    check_i(avro_value_get_by_name(&value, "pocode_ip_dst", &field, NULL));
+    check_i(avro_value_get_by_name(value, "pocode_ip_dst", &field, NULL));
     if (strlen(pbase->dst_ip_pocode.str))
       check_i(avro_value_set_string(&field, pbase->dst_ip_pocode.str));
     else
@@ -2994,12 +3007,12 @@ avro_value_t compose_avro(u_int64_t wtc, u_int64_t wtc_2, u_int8_t flow_type, st
 
   if (wtc & COUNT_TCPFLAGS) {
     sprintf(misc_str, "%u", tcp_flags);
-    check_i(avro_value_get_by_name(&value, "tcp_flags", &field, NULL));
+    check_i(avro_value_get_by_name(value, "tcp_flags", &field, NULL));
     check_i(avro_value_set_string(&field, misc_str));
   }
 
   if (wtc & COUNT_IP_PROTO) {
-    check_i(avro_value_get_by_name(&value, "ip_proto", &field, NULL));
+    check_i(avro_value_get_by_name(value, "ip_proto", &field, NULL));
     if (!config.num_protos && (pbase->proto < protocols_number))
       check_i(avro_value_set_string(&field, _protocols[pbase->proto].name));
     else {
@@ -3010,114 +3023,114 @@ avro_value_t compose_avro(u_int64_t wtc, u_int64_t wtc_2, u_int8_t flow_type, st
   }
 
   if (wtc & COUNT_IP_TOS) {
-    check_i(avro_value_get_by_name(&value, "tos", &field, NULL));
+    check_i(avro_value_get_by_name(value, "tos", &field, NULL));
     check_i(avro_value_set_long(&field, pbase->tos));
   }
 
   if (wtc_2 & COUNT_SAMPLING_RATE) {
-    check_i(avro_value_get_by_name(&value, "sampling_rate", &field, NULL));
+    check_i(avro_value_get_by_name(value, "sampling_rate", &field, NULL));
     check_i(avro_value_set_long(&field, pbase->sampling_rate));
   }
 
   if (wtc_2 & COUNT_PKT_LEN_DISTRIB) {
-    check_i(avro_value_get_by_name(&value, "pkt_len_distrib", &field, NULL));
+    check_i(avro_value_get_by_name(value, "pkt_len_distrib", &field, NULL));
     check_i(avro_value_set_string(&field, config.pkt_len_distrib_bins[pbase->pkt_len_distrib]));
   }
 
   if (wtc_2 & COUNT_POST_NAT_SRC_HOST) {
     addr_to_str(src_host, &pnat->post_nat_src_ip);
-    check_i(avro_value_get_by_name(&value, "post_nat_ip_src", &field, NULL));
+    check_i(avro_value_get_by_name(value, "post_nat_ip_src", &field, NULL));
     check_i(avro_value_set_string(&field, src_host));
   }
 
   if (wtc_2 & COUNT_POST_NAT_DST_HOST) {
     addr_to_str(dst_host, &pnat->post_nat_dst_ip);
-    check_i(avro_value_get_by_name(&value, "post_nat_ip_dst", &field, NULL));
+    check_i(avro_value_get_by_name(value, "post_nat_ip_dst", &field, NULL));
     check_i(avro_value_set_string(&field, dst_host));
   }
 
   if (wtc_2 & COUNT_POST_NAT_SRC_PORT) {
-    check_i(avro_value_get_by_name(&value, "post_nat_port_src", &field, NULL));
+    check_i(avro_value_get_by_name(value, "post_nat_port_src", &field, NULL));
     check_i(avro_value_set_long(&field, pnat->post_nat_src_port));
   }
 
   if (wtc_2 & COUNT_POST_NAT_DST_PORT) {
-    check_i(avro_value_get_by_name(&value, "post_nat_port_dst", &field, NULL));
+    check_i(avro_value_get_by_name(value, "post_nat_port_dst", &field, NULL));
     check_i(avro_value_set_long(&field, pnat->post_nat_dst_port));
   }
 
   if (wtc_2 & COUNT_NAT_EVENT) {
-    check_i(avro_value_get_by_name(&value, "nat_event", &field, NULL));
+    check_i(avro_value_get_by_name(value, "nat_event", &field, NULL));
     check_i(avro_value_set_long(&field, pnat->nat_event));
   }
 
   if (wtc_2 & COUNT_MPLS_LABEL_TOP) {
-    check_i(avro_value_get_by_name(&value, "mpls_label_top", &field, NULL));
+    check_i(avro_value_get_by_name(value, "mpls_label_top", &field, NULL));
     check_i(avro_value_set_long(&field, pmpls->mpls_label_top));
   }
 
   if (wtc_2 & COUNT_MPLS_LABEL_BOTTOM) {
-    check_i(avro_value_get_by_name(&value, "mpls_label_bottom", &field, NULL));
+    check_i(avro_value_get_by_name(value, "mpls_label_bottom", &field, NULL));
     check_i(avro_value_set_long(&field, pmpls->mpls_label_bottom));
   }
 
   if (wtc_2 & COUNT_MPLS_STACK_DEPTH) {
-    check_i(avro_value_get_by_name(&value, "mpls_stack_depth", &field, NULL));
+    check_i(avro_value_get_by_name(value, "mpls_stack_depth", &field, NULL));
     check_i(avro_value_set_long(&field, pmpls->mpls_stack_depth));
   }
 
   if (wtc_2 & COUNT_TIMESTAMP_START) {
     compose_timestamp(tstamp_str, SRVBUFLEN, &pnat->timestamp_start, TRUE, config.timestamps_since_epoch);
-    check_i(avro_value_get_by_name(&value, "timestamp_start", &field, NULL));
+    check_i(avro_value_get_by_name(value, "timestamp_start", &field, NULL));
     check_i(avro_value_set_string(&field, tstamp_str));
   }
 
   if (wtc_2 & COUNT_TIMESTAMP_END) {
     compose_timestamp(tstamp_str, SRVBUFLEN, &pnat->timestamp_end, TRUE, config.timestamps_since_epoch);
-    check_i(avro_value_get_by_name(&value, "timestamp_end", &field, NULL));
+    check_i(avro_value_get_by_name(value, "timestamp_end", &field, NULL));
     check_i(avro_value_set_string(&field, tstamp_str));
   }
 
   if (wtc_2 & COUNT_TIMESTAMP_ARRIVAL) {
     compose_timestamp(tstamp_str, SRVBUFLEN, &pnat->timestamp_arrival, TRUE, config.timestamps_since_epoch);
-    check_i(avro_value_get_by_name(&value, "timestamp_arrival", &field, NULL));
+    check_i(avro_value_get_by_name(value, "timestamp_arrival", &field, NULL));
     check_i(avro_value_set_string(&field, tstamp_str));
   }
 
   if (config.nfacctd_stitching) {
     if (stitch) {
       compose_timestamp(tstamp_str, SRVBUFLEN, &stitch->timestamp_min, TRUE, config.timestamps_since_epoch);
-      check_i(avro_value_get_by_name(&value, "timestamp_min", &field, NULL));
+      check_i(avro_value_get_by_name(value, "timestamp_min", &field, NULL));
       check_i(avro_value_set_branch(&field, 1, &branch));
       check_i(avro_value_set_string(&branch, tstamp_str));
 
       compose_timestamp(tstamp_str, SRVBUFLEN, &stitch->timestamp_max, TRUE, config.timestamps_since_epoch);
-      check_i(avro_value_get_by_name(&value, "timestamp_max", &field, NULL));
+      check_i(avro_value_get_by_name(value, "timestamp_max", &field, NULL));
       check_i(avro_value_set_branch(&field, 1, &branch));
       check_i(avro_value_set_string(&branch, tstamp_str));
     }
     else {
-      check_i(avro_value_get_by_name(&value, "timestamp_min", &field, NULL));
+      check_i(avro_value_get_by_name(value, "timestamp_min", &field, NULL));
       check_i(avro_value_set_branch(&field, 0, &branch));
-      check_i(avro_value_get_by_name(&value, "timestamp_max", &field, NULL));
+      check_i(avro_value_get_by_name(value, "timestamp_max", &field, NULL));
       check_i(avro_value_set_branch(&field, 0, &branch));
     }
   }
 
   if (wtc_2 & COUNT_EXPORT_PROTO_SEQNO) {
-    check_i(avro_value_get_by_name(&value, "export_proto_seqno", &field, NULL));
+    check_i(avro_value_get_by_name(value, "export_proto_seqno", &field, NULL));
     check_i(avro_value_set_long(&field, pbase->export_proto_seqno));
   }
 
   if (wtc_2 & COUNT_EXPORT_PROTO_VERSION) {
-    check_i(avro_value_get_by_name(&value, "export_proto_version", &field, NULL));
+    check_i(avro_value_get_by_name(value, "export_proto_version", &field, NULL));
     check_i(avro_value_set_long(&field, pbase->export_proto_version));
   }
 
   /* all custom primitives printed here */
   {
     if (config.cpptrs.num > 0)
-      check_i(avro_value_get_by_name(&value, "custom_primitives", &field, NULL));
+      check_i(avro_value_get_by_name(value, "custom_primitives", &field, NULL));
 
     int cp_idx;
     for (cp_idx = 0; cp_idx < config.cpptrs.num; cp_idx++) {
@@ -3144,31 +3157,31 @@ avro_value_t compose_avro(u_int64_t wtc, u_int64_t wtc_2, u_int8_t flow_type, st
       tv.tv_sec = basetime->tv_sec;
       tv.tv_usec = 0;
       compose_timestamp(tstamp_str, SRVBUFLEN, &tv, FALSE, config.timestamps_since_epoch);
-      check_i(avro_value_get_by_name(&value, "stamp_inserted", &field, NULL));
+      check_i(avro_value_get_by_name(value, "stamp_inserted", &field, NULL));
       check_i(avro_value_set_branch(&field, 1, &branch));
       check_i(avro_value_set_string(&branch, tstamp_str));
 
       tv.tv_sec = time(NULL);
       tv.tv_usec = 0;
       compose_timestamp(tstamp_str, SRVBUFLEN, &tv, FALSE, config.timestamps_since_epoch);
-      check_i(avro_value_get_by_name(&value, "stamp_updated", &field, NULL));
+      check_i(avro_value_get_by_name(value, "stamp_updated", &field, NULL));
       check_i(avro_value_set_branch(&field, 1, &branch));
       check_i(avro_value_set_string(&branch, tstamp_str));
     }
     else {
-      check_i(avro_value_get_by_name(&value, "stamp_inserted", &field, NULL));
+      check_i(avro_value_get_by_name(value, "stamp_inserted", &field, NULL));
       check_i(avro_value_set_branch(&field, 0, &branch));
-      check_i(avro_value_get_by_name(&value, "stamp_updated", &field, NULL));
+      check_i(avro_value_get_by_name(value, "stamp_updated", &field, NULL));
       check_i(avro_value_set_branch(&field, 0, &branch));
     }
   }
 
   if (flow_type != NF9_FTYPE_EVENT && flow_type != NF9_FTYPE_OPTION) {
-    check_i(avro_value_get_by_name(&value, "packets", &field, NULL));
+    check_i(avro_value_get_by_name(value, "packets", &field, NULL));
     check_i(avro_value_set_branch(&field, 1, &branch));
     check_i(avro_value_set_long(&branch, packet_counter));
 
-    check_i(avro_value_get_by_name(&value, "flows", &field, NULL));
+    check_i(avro_value_get_by_name(value, "flows", &field, NULL));
     if (wtc & COUNT_FLOWS) {
       check_i(avro_value_set_branch(&field, 1, &branch));
       check_i(avro_value_set_long(&branch, flow_counter));
@@ -3176,20 +3189,18 @@ avro_value_t compose_avro(u_int64_t wtc, u_int64_t wtc_2, u_int8_t flow_type, st
     else {
       check_i(avro_value_set_branch(&field, 0, &branch));
     }
-    check_i(avro_value_get_by_name(&value, "bytes", &field, NULL));
+    check_i(avro_value_get_by_name(value, "bytes", &field, NULL));
     check_i(avro_value_set_branch(&field, 1, &branch));
     check_i(avro_value_set_long(&branch, bytes_counter));
   }
   else {
-    check_i(avro_value_get_by_name(&value, "packets", &field, NULL));
+    check_i(avro_value_get_by_name(value, "packets", &field, NULL));
     check_i(avro_value_set_branch(&field, 0, &branch));
-    check_i(avro_value_get_by_name(&value, "flows", &field, NULL));
+    check_i(avro_value_get_by_name(value, "flows", &field, NULL));
     check_i(avro_value_set_branch(&field, 0, &branch));
-    check_i(avro_value_get_by_name(&value, "bytes", &field, NULL));
+    check_i(avro_value_get_by_name(value, "bytes", &field, NULL));
     check_i(avro_value_set_branch(&field, 0, &branch));
   }
-
-  return value;
 }
 #endif
 
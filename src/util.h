@@ -126,6 +126,11 @@ EXT avro_value_t compose_avro(u_int64_t wtc, u_int64_t wtc_2, u_int8_t flow_type
   char *pcust, struct pkt_vlen_hdr_primitives *pvlen, pm_counter_t bytes_counter,
   pm_counter_t packet_counter, pm_counter_t flow_counter, u_int32_t tcp_flags, struct timeval *basetime,
   struct pkt_stitching *stitch, avro_value_iface_t *iface);
+EXT void compose_avro_value(u_int64_t wtc, u_int64_t wtc_2, u_int8_t flow_type, struct pkt_primitives *pbase,
+  struct pkt_bgp_primitives *pbgp, struct pkt_nat_primitives *pnat, struct pkt_mpls_primitives *pmpls,
+  char *pcust, struct pkt_vlen_hdr_primitives *pvlen, pm_counter_t bytes_counter,
+  pm_counter_t packet_counter, pm_counter_t flow_counter, u_int32_t tcp_flags, struct timeval *basetime,
+  struct pkt_stitching *stitch, avro_value_t *value);
 #endif
 
 EXT void compose_timestamp(char *, int, struct timeval *, int, int);
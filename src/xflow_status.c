@@ -24,8 +24,35 @@
 /* includes */
 #include "pmacct.h"
 #include "addr.h"
+#if defined ENABLE_THREADS
+#include "thread_pool.h"
+#endif
+
+/* variables */
+#if defined ENABLE_THREADS
+static pthread_mutex_t xflow_status_table_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
 
 /* functions */
+/*
+   The table is only changed by the Core Process main thread, which hence
+   can walk it unlocked; other threads walking it, ie. stats_shm_update(),
+   hold the lock, which is taken by the main thread to link new entries.
+*/
+void xflow_status_table_lock()
+{
+#if defined ENABLE_THREADS
+  pthread_mutex_lock(&xflow_status_table_mutex);
+#endif
+}
+
+void xflow_status_table_unlock()
+{
+#if defined ENABLE_THREADS
+  pthread_mutex_unlock(&xflow_status_table_mutex);
+#endif
+}
+
 u_int32_t hash_status_table(u_int32_t data, struct sockaddr *sa, u_int32_t size)
 {
   int hash = -1;
@@ -70,10 +97,12 @@ struct xflow_status_entry *search_status_table(struct sockaddr *sa, u_int32_t au
 	entry->aux2 = aux2;
 	entry->seqno = 0;
 	entry->next = FALSE;
+	xflow_status_table_lock();
         if (!saved) xflow_status_table[hash] = entry;
         else saved->next = entry;
 	xflow_status_table_error = TRUE;
 	xflow_status_table_entries++;
+	xflow_status_table_unlock();
       }
     }
     else {
@@ -117,7 +146,7 @@ void update_status_table(struct xflow_status_entry *entry, u_int32_t seqno)
 		config.name, config.type, entry->seqno+entry->inc, seqno, collector_ip_address,
 		config.nfacctd_port, agent_ip_address, entry->aux1);
       if (seqno > entry->seqno+entry->inc) {
-        // entry->counters.missed += (seqno-entry->seqno);
+        entry->counters.missed += (seqno-(entry->seqno+entry->inc));
         entry->counters.jumps_f++;
 	// entry->seqno = seqno;
       }
@@ -166,6 +195,15 @@ void print_status_table(time_t now, int buckets)
       Log(LOG_NOTICE, "NOTICE ( %s/%s ): Good datagrams:  %u\n", config.name, config.type, entry->counters.good);
       Log(LOG_NOTICE, "NOTICE ( %s/%s ): Forward jumps:   %u\n", config.name, config.type, entry->counters.jumps_f);
       Log(LOG_NOTICE, "NOTICE ( %s/%s ): Backward jumps:  %u\n", config.name, config.type, entry->counters.jumps_b);
+      Log(LOG_NOTICE, "NOTICE ( %s/%s ): Missed (est.):   %llu\n", config.name, config.type, (unsigned long long)entry->counters.missed);
+      Log(LOG_NOTICE, "NOTICE ( %s/%s ): Datagrams:       %llu\n", config.name, config.type, (unsigned long long)entry->counters.datagrams);
+      Log(LOG_NOTICE, "NOTICE ( %s/%s ): Bytes:           %llu\n", config.name, config.type, (unsigned long long)entry->counters.bytes);
+      Log(LOG_NOTICE, "NOTICE ( %s/%s ): Flows:           %llu\n", config.name, config.type, (unsigned long long)entry->counters.flows);
+      if (config.acct_type == ACCT_NF)
+	Log(LOG_NOTICE, "NOTICE ( %s/%s ): Template misses: %u\n", config.name, config.type, entry->counters.tpl_misses);
+      if (config.nfacctd_stats_refresh_time && entry->counters.datagrams)
+	Log(LOG_NOTICE, "NOTICE ( %s/%s ): Decode time:     %llu usecs avg, %llu usecs max\n", config.name, config.type,
+		(unsigned long long)(entry->counters.decode_usecs / entry->counters.datagrams), (unsigned long long)entry->counters.decode_max_usecs);
       Log(LOG_NOTICE, "NOTICE ( %s/%s ): ---\n", config.name, config.type);
 
       if (entry->next) {
@@ -180,6 +218,40 @@ void print_status_table(time_t now, int buckets)
   Log(LOG_NOTICE, "NOTICE ( %s/%s ): ---\n", config.name, config.type);
 }
 
+void update_datagram_status_table(struct xflow_status_entry *entry, u_int32_t len, struct timespec *start)
+{
+  if (!entry) return;
+
+  entry->counters.datagrams++;
+  entry->counters.bytes += len;
+
+  if (start) {
+    struct timespec end;
+    u_int64_t delta;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    delta = ((u_int64_t) (end.tv_sec - start->tv_sec) * 1000000) + ((end.tv_nsec - start->tv_nsec) / 1000);
+    entry->counters.decode_usecs += delta;
+    if (delta > entry->counters.decode_max_usecs) entry->counters.decode_max_usecs = delta;
+  }
+}
+
+/* now is monotonic: it only paces dumps, which are stamped with wall clock time */
+void print_status_table_periodic(struct timespec *now)
+{
+  if (!config.nfacctd_stats_refresh_time) return;
+
+  if (!xflow_status_table_dump_tstamp) {
+    xflow_status_table_dump_tstamp = now->tv_sec;
+    return;
+  }
+
+  if (now->tv_sec >= (xflow_status_table_dump_tstamp + config.nfacctd_stats_refresh_time)) {
+    print_status_table(time(NULL), XFLOW_STATUS_TABLE_SZ);
+    xflow_status_table_dump_tstamp = now->tv_sec;
+  }
+}
+
 struct xflow_status_entry_sampling *
 search_smp_if_status_table(struct xflow_status_entry_sampling *sentry, u_int32_t interface)
 {
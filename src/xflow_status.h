@@ -30,6 +30,13 @@ struct xflow_status_entry_counters
   u_int32_t good;
   u_int32_t jumps_f;
   u_int32_t jumps_b;
+  u_int32_t tpl_misses;		/* NetFlow v9/IPFIX: data flowsets with unknown template */
+  u_int64_t missed;		/* sum of forward sequence gaps */
+  u_int64_t datagrams;
+  u_int64_t flows;		/* flow records (NetFlow/IPFIX) or flow samples (sFlow) */
+  u_int64_t bytes;
+  u_int64_t decode_usecs;	/* cumulative datagram decode time */
+  u_int64_t decode_max_usecs;
 };
 
 struct xflow_status_entry_sampling
@@ -60,25 +67,27 @@ struct xflow_status_map_cache
 
 struct xflow_status_entry
 {
+  /* lookup keys, chaining and per-datagram counters first: hot path */
   struct host_addr agent_addr;  /* xFlow agent IP address */
-  u_int32_t seqno;              /* Sequence number */
   u_int32_t aux1;               /* Some more distinguishing fields:
                                    NetFlow v5-v8: Engine Type + Engine ID
                                    NetFlow v9: Source ID
                                    IPFIX: ObservedDomainID
                                    sFlow v5: agentSubID */
   u_int32_t aux2;		/* Some more distinguishing (internal) flags */
+  struct xflow_status_entry *next;
+  u_int32_t seqno;              /* Sequence number */
   u_int16_t inc;		/* increment, NetFlow v5: required by flow sequence number */
+  struct xflow_status_entry_counters counters;
+
   u_int32_t peer_v4_idx;        /* last known BGP peer index for ipv4 address family */
   u_int32_t peer_v6_idx;        /* last known BGP peer index for ipv6 address family */
   struct xflow_status_map_cache bta_v4;			/* last known bgp_agent_map IPv4 result */
   struct xflow_status_map_cache bta_v6;			/* last known bgp_agent_map IPv6 result */
   struct xflow_status_map_cache st;			/* last known sampling_map result */
-  struct xflow_status_entry_counters counters;
   struct xflow_status_entry_sampling *sampling;
   struct xflow_status_entry_class *class;
   void *sf_cnt;			/* struct (ab)used for sFlow counters logging */
-  struct xflow_status_entry *next;
 };
 
 /* prototypes */
@@ -87,11 +96,15 @@ struct xflow_status_entry
 #else
 #define EXT
 #endif
+EXT void xflow_status_table_lock();
+EXT void xflow_status_table_unlock();
 EXT u_int32_t hash_status_table(u_int32_t, struct sockaddr *, u_int32_t);
 EXT struct xflow_status_entry *search_status_table(struct sockaddr *, u_int32_t, u_int32_t, int, int);
 EXT void update_good_status_table(struct xflow_status_entry *, u_int32_t);
 EXT void update_bad_status_table(struct xflow_status_entry *);
 EXT void print_status_table(time_t, int);
+EXT void update_datagram_status_table(struct xflow_status_entry *, u_int32_t, struct timespec *);
+EXT void print_status_table_periodic(struct timespec *);
 EXT struct xflow_status_entry_sampling *search_smp_if_status_table(struct xflow_status_entry_sampling *, u_int32_t);
 EXT struct xflow_status_entry_sampling *search_smp_id_status_table(struct xflow_status_entry_sampling *, u_int32_t, u_int8_t);
 EXT struct xflow_status_entry_sampling *create_smp_entry_status_table(struct xflow_status_entry *);
@@ -102,6 +115,7 @@ EXT struct xflow_status_entry *xflow_status_table[XFLOW_STATUS_TABLE_SZ];
 EXT u_int32_t xflow_status_table_entries;
 EXT u_int8_t xflow_status_table_error;
 EXT u_int32_t xflow_tot_bad_datagrams;
+EXT time_t xflow_status_table_dump_tstamp;
 EXT u_int8_t smp_entry_status_table_memerr, class_entry_status_table_memerr;
 EXT void set_vector_f_status(struct packet_ptrs_vector *);
 EXT void set_vector_f_status_g(struct packet_ptrs_vector *);